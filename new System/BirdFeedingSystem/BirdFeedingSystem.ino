@@ -40,9 +40,14 @@
 #include <HTTPClient.h>
 #include <ArduinoOTA.h>
 #include <Wire.h>
+#include <RTClib.h>
 #include <LiquidCrystal_I2C.h>
 #include <DHT.h>
 #include "RDTRC_LCD_Library.h"
+#include "RDTRC_Notify_Library.h"
+#include "RDTRC_Alert_Library.h"
+#include "RDTRC_TimeSync_Library.h"
+#include "RDTRC_Scheduler_Library.h"
 
 // System Configuration
 #define FIRMWARE_VERSION "4.0"
@@ -90,6 +95,14 @@ const char* lineToken = "YOUR_LINE_NOTIFY_TOKEN";
 #define FOOD_CONTAINER_HEIGHT 15  // cm (smaller container)
 #define LOW_FOOD_THRESHOLD 2      // cm
 #define EMPTY_FEEDER_THRESHOLD 3  // grams
+#define NO_BIRDS_HOURS 12         // daylight hours without motion before alerting
+
+// Alert rate limiting
+// A condition must show in two consecutive sensor readings before it alerts.
+// Holding it for half an interval lets a reading that runs late still count.
+#define SENSOR_READ_INTERVAL 30000 // 30 seconds
+#define ALERT_HOLD_TIME (SENSOR_READ_INTERVAL / 2)
+#define ALERT_COOLDOWN 1800000    // at most one alert per rule every 30 minutes
 
 // Light sensor thresholds
 #define DAYLIGHT_THRESHOLD 500    // ADC value for daylight detection
@@ -115,9 +128,27 @@ const char* lineToken = "YOUR_LINE_NOTIFY_TOKEN";
 WebServer server(80);
 WiFiUDP ntpUDP;
 NTPClient timeClient(ntpUDP, "pool.ntp.org", 25200, 60000); // UTC+7 Thailand
+RTC_DS3231 rtc;                 // Optional, keeps time offline and between NTP syncs
+RDTRC_TimeSync timeSync;
+RDTRC_Scheduler scheduler;
 HX711 scale;
 Servo feedingServo;
 RDTRC_LCD systemLCD;
+Adafruit_I2CBus i2cBus;         // Wire, shared by the LCD and the RTC
+RDTRC_LineNotifier lineNotifier;
+RDTRC_AlertEngine alertEngine;
+
+// Signals fed to the alert engine from readSensors()
+enum AlertSignal {
+  SIGNAL_FOOD_LEVEL,
+  SIGNAL_FEEDER_WEIGHT,
+  SIGNAL_IDLE_HOURS
+};
+
+// Alert rule handles, assigned in setupAlerts()
+int lowFoodRule = -1;
+int emptyFeederRule = -1;
+int noBirdsRule = -1;
 DHT dht(DHT_PIN, DHT_TYPE);
 
 // Sensor Status Structure
@@ -146,8 +177,6 @@ SensorStatus lcdSensor;
 bool isWiFiConnected = false;
 bool isHotspotMode = false;
 unsigned long lastHeartbeat = 0;
-unsigned long lastDataLog = 0;
-unsigned long lastStatusCheck = 0;
 unsigned long lastLCDUpdate = 0;
 unsigned long bootTime = 0;
 
@@ -210,9 +239,12 @@ void setupWiFi();
 void setupWebServer();
 void setupBlynk();
 void setupOTA();
+void setupAlerts();
 void displayBootScreen();
 void handleSystemLoop();
 void readSensors();
+void sensorJob();
+void maintenanceJob();
 void checkFeedingSchedule();
 void performFeeding(int portion);
 void handleWebInterface();
@@ -240,6 +272,13 @@ void setup() {
   displayBootScreen();
   setupSystem();
   
+  // Timed work runs from the scheduler; loop() only polls I/O
+  scheduler.begin();
+  scheduler.every(SENSOR_READ_INTERVAL, sensorJob, SENSOR_READ_INTERVAL);
+  scheduler.every(60000, checkFeedingSchedule, 60000);
+  scheduler.every(900000, logData, 900000);
+  scheduler.every(300000, maintenanceJob, 300000);
+  
   Serial.println("RDTRC Bird Feeding System with LCD Ready!");
   Serial.println("Web Interface: http://bird-feeder.local");
   Serial.println("Blynk App: Connected");
@@ -274,34 +313,21 @@ void loop() {
   // Update LCD display
   updateLCDDisplay();
   
-  // Read sensors every 30 seconds
-  static unsigned long lastSensorRead = 0;
-  if (millis() - lastSensorRead > 30000) {
-    readSensors();
-    lastSensorRead = millis();
-  }
-  
-  // Check feeding schedule every minute
-  static unsigned long lastScheduleCheck = 0;
-  if (millis() - lastScheduleCheck > 60000) {
-    checkFeedingSchedule();
-    lastScheduleCheck = millis();
-  }
-  
-  // Log data every 15 minutes
-  if (millis() - lastDataLog > 900000) {
-    logData();
-    lastDataLog = millis();
-  }
-  
-  // System status check every 5 minutes
-  if (millis() - lastStatusCheck > 300000) {
-    performSystemMaintenance();
-    checkAlerts();
-    lastStatusCheck = millis();
-  }
+  // Run the jobs that are due, then sleep until the next one; web,
+  // Blynk and OTA are polled again after at most RDTRC_SCHED_IO_POLL ms
+  scheduler.run();
+  scheduler.idle(RDTRC_SCHED_IO_POLL);
+}
+
+void sensorJob() {
+  readSensors();
   
-  delay(100);
+  // Dispatch alert events raised by this reading
+  checkAlerts();
+}
+
+void maintenanceJob() {
+  performSystemMaintenance();
 }
 
 void displayBootScreen() {
@@ -388,9 +414,19 @@ void setupSystem() {
   setupBlynk();
   setupOTA();
   
+  // Start background LINE notification sender
+  lineNotifier.begin(lineToken);
+  
+  // Declare alert rules before the first sensor reading
+  setupAlerts();
+  
   // Initialize NTP
   timeClient.begin();
-  timeClient.update();
+  timeClient.addServer("time.google.com");
+  timeClient.addServer("time.cloudflare.com");
+  bool rtcFound = rtc.begin();
+  if (rtcFound) rtc.setBus(&i2cBus);
+  timeSync.begin(timeClient, rtcFound ? &rtc : NULL);
   
   // Initialize today's stats
   todayStats.date = "01/01/2024";
@@ -437,7 +473,11 @@ void setupLCD() {
   // Initialize I2C
   Wire.begin(I2C_SDA, I2C_SCL);
   
-  // Scan for I2C devices first
+  // Transfers from both tasks queue on one worker, clock first
+  i2cBus.begin();
+  systemLCD.setBus(i2cBus);
+  
+  // Scan for I2C devices first; the LCD's address comes from this scan
   systemLCD.scanI2C();
   
   // Initialize LCD with auto detection
@@ -612,9 +652,7 @@ void handleSystemLoop() {
   }
   
   // Update time
-  if (isWiFiConnected) {
-    timeClient.update();
-  }
+  timeSync.update(isWiFiConnected);
 }
 
 void handleLCDControls() {
@@ -668,6 +706,7 @@ void readSensors() {
       currentWeight = scale.get_units(3); // Average of 3 readings
       if (currentWeight < 0) currentWeight = 0;
       updateSensorStatus(1, true, currentWeight);
+      alertEngine.update(SIGNAL_FEEDER_WEIGHT, currentWeight, millis());
     } else {
       handleSensorError(1, loadCellSensor.sensorName);
     }
@@ -709,6 +748,13 @@ void readSensors() {
       motionDetected = false;
     }
     updateSensorStatus(3, true, currentMotion ? 1 : 0);
+    
+    // Hours of daylight without a visit, nights do not count
+    float idleHours = 0;
+    if (isDaylight && lastMotionTime > 0) {
+      idleHours = (millis() - lastMotionTime) / 3600000.0;
+    }
+    alertEngine.update(SIGNAL_IDLE_HOURS, idleHours, millis());
   }
   
   // Read pH sensor
@@ -756,6 +802,7 @@ void readSensors() {
   // Calculate food level (assuming ultrasonic sensor exists)
   // This would be implemented if ultrasonic sensor is connected
   foodLevel = FOOD_CONTAINER_HEIGHT * 0.8; // Placeholder
+  alertEngine.update(SIGNAL_FOOD_LEVEL, foodLevel, millis());
   
   // Check sensor status and apply graceful degradation
   checkSensorStatus();
@@ -797,7 +844,6 @@ void readSensors() {
 }
 
 void checkFeedingSchedule() {
-  timeClient.update();
   int currentHour = timeClient.getHours();
   int currentMinute = timeClient.getMinutes();
   
@@ -865,34 +911,46 @@ void performFeeding(int portion) {
   Serial.println("Bird feeding completed: " + String(portion) + "g");
 }
 
+void setupAlerts() {
+  // signal, comparator, threshold, hysteresis, hold time, cooldown, severity
+  lowFoodRule = alertEngine.addRule(SIGNAL_FOOD_LEVEL, RDTRC_ALERT_BELOW, LOW_FOOD_THRESHOLD,
+                                    1, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_WARNING);
+  emptyFeederRule = alertEngine.addRule(SIGNAL_FEEDER_WEIGHT, RDTRC_ALERT_BELOW, EMPTY_FEEDER_THRESHOLD,
+                                        2, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_WARNING);
+  noBirdsRule = alertEngine.addRule(SIGNAL_IDLE_HOURS, RDTRC_ALERT_ABOVE, NO_BIRDS_HOURS,
+                                    0, 0, ALERT_COOLDOWN, RDTRC_ALERT_INFO);
+}
+
 void checkAlerts() {
-  // Low food alert
-  if (foodLevel < LOW_FOOD_THRESHOLD) {
-    String alertMsg = "Low Food Level Alert!\n";
-    alertMsg += "Current Level: " + String(foodLevel) + "cm\n";
-    alertMsg += "Please refill the bird feeder.";
-    sendLineNotification(alertMsg);
-    systemLCD.showAlert("LOW FOOD");
-    todayStats.alerts++;
-  }
-  
-  // Empty feeder alert
-  if (currentWeight < EMPTY_FEEDER_THRESHOLD) {
-    String alertMsg = "Empty Bird Feeder Alert!\n";
-    alertMsg += "Feeder Weight: " + String(currentWeight) + "g\n";
-    alertMsg += "Birds may not have food available.";
-    sendLineNotification(alertMsg);
-    systemLCD.showAlert("EMPTY FEEDER");
-    todayStats.alerts++;
-  }
-  
-  // No bird visits alert (if no motion for 12 hours during day)
-  if (isDaylight && (millis() - lastMotionTime > 43200000) && lastMotionTime > 0) {
-    String alertMsg = "No Bird Activity Alert!\n";
-    alertMsg += "No birds detected for over 12 hours\n";
-    alertMsg += "Check feeder location and food quality.";
+  // Only transitions reach here, steady conditions produce no events
+  RDTRC_AlertEvent event;
+  while (alertEngine.poll(event)) {
+    if (!event.raised) {
+      Serial.println("Alert cleared (rule " + String(event.rule) + "), value: " + String(event.value));
+      continue;
+    }
+    
+    String alertMsg;
+    if (event.rule == lowFoodRule) {
+      alertMsg = "Low Food Level Alert!\n";
+      alertMsg += "Current Level: " + String(event.value) + "cm\n";
+      alertMsg += "Please refill the bird feeder.";
+      systemLCD.showAlert("LOW FOOD");
+    } else if (event.rule == emptyFeederRule) {
+      alertMsg = "Empty Bird Feeder Alert!\n";
+      alertMsg += "Feeder Weight: " + String(event.value) + "g\n";
+      alertMsg += "Birds may not have food available.";
+      systemLCD.showAlert("EMPTY FEEDER");
+    } else if (event.rule == noBirdsRule) {
+      alertMsg = "No Bird Activity Alert!\n";
+      alertMsg += "No birds detected for over " + String(NO_BIRDS_HOURS) + " hours\n";
+      alertMsg += "Check feeder location and food quality.";
+      systemLCD.showAlert("NO BIRDS");
+    } else {
+      continue;
+    }
+    
     sendLineNotification(alertMsg);
-    systemLCD.showAlert("NO BIRDS");
     todayStats.alerts++;
   }
 }
@@ -1021,23 +1079,12 @@ void performSystemMaintenance() {
 }
 
 void sendLineNotification(String message) {
-  if (!isWiFiConnected || strlen(lineToken) < 10) return;
-  
-  HTTPClient http;
-  http.begin("https://notify-api.line.me/api/notify");
-  http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-  http.addHeader("Authorization", "Bearer " + String(lineToken));
-  
-  String payload = "message=" + message;
-  int httpResponseCode = http.POST(payload);
+  if (strlen(lineToken) < 10) return;
   
-  if (httpResponseCode == 200) {
-    Serial.println("LINE notification sent");
-  } else {
-    Serial.println("LINE notification failed: " + String(httpResponseCode));
+  // Queued for the background sender, so alerts never stall loop()
+  if (!lineNotifier.send(message)) {
+    Serial.println("LINE notification not queued (duplicate or queue full)");
   }
-  
-  http.end();
 }
 
 void handleWebInterface() {
@@ -0,0 +1,249 @@
+/*
+ * RDTRC Alert Library - Event Driven Threshold Alerts
+ * Version: 4.0
+ * Firmware made by: RDTRC
+ * Updated: 2024
+ *
+ * Features:
+ * - Rules declared once: signal, comparator, threshold, hysteresis,
+ *   hold time, cooldown and severity
+ * - Only the rules of a signal are evaluated when that signal updates
+ * - Edge triggered: one event when a rule trips, one when it clears
+ * - Hysteresis band stops flapping around the threshold
+ * - Per-rule cooldown rate limits repeated notifications
+ * - Bounded event queue, no heap allocation
+ *
+ * Usage:
+ * #include "RDTRC_Alert_Library.h"
+ * RDTRC_AlertEngine alerts;
+ * int lowWater = alerts.addRule(SIGNAL_WATER, RDTRC_ALERT_BELOW, 8, 2);  // in setup()
+ * alerts.update(SIGNAL_WATER, waterLevel, millis());                      // after each reading
+ * RDTRC_AlertEvent event;
+ * while (alerts.poll(event)) { ... }                                      // in loop()
+ */
+
+#ifndef RDTRC_ALERT_LIBRARY_H
+#define RDTRC_ALERT_LIBRARY_H
+
+#include <Arduino.h>
+
+#ifndef RDTRC_ALERT_MAX_RULES
+#define RDTRC_ALERT_MAX_RULES 16
+#endif
+
+#ifndef RDTRC_ALERT_MAX_SIGNALS
+#define RDTRC_ALERT_MAX_SIGNALS 16
+#endif
+
+#ifndef RDTRC_ALERT_QUEUE_SIZE
+#define RDTRC_ALERT_QUEUE_SIZE 8
+#endif
+
+enum RDTRC_AlertCompare {
+  RDTRC_ALERT_ABOVE,  // trips when value > threshold
+  RDTRC_ALERT_BELOW   // trips when value < threshold
+};
+
+enum RDTRC_AlertSeverity {
+  RDTRC_ALERT_INFO,
+  RDTRC_ALERT_WARNING,
+  RDTRC_ALERT_CRITICAL
+};
+
+struct RDTRC_AlertEvent {
+  int rule;
+  RDTRC_AlertSeverity severity;
+  bool raised;          // true when the rule tripped, false when it cleared
+  float value;          // signal value that caused the transition
+  unsigned long time;
+};
+
+class RDTRC_AlertEngine {
+  private:
+    enum State : uint8_t {
+      STATE_CLEAR,
+      STATE_PENDING,  // condition true, waiting for hold time / cooldown
+      STATE_ACTIVE
+    };
+
+    struct Rule {
+      float threshold;
+      float hysteresis;
+      unsigned long holdTime;
+      unsigned long cooldown;
+      unsigned long pendingSince;
+      unsigned long lastRaised;
+      uint8_t signal;
+      uint8_t compare;
+      uint8_t severity;
+      State state;
+      bool everRaised;
+      int8_t nextRule;  // next rule watching the same signal, -1 for none
+    };
+
+    Rule rules[RDTRC_ALERT_MAX_RULES];
+    int ruleCount;
+    int8_t firstRule[RDTRC_ALERT_MAX_SIGNALS];
+    float lastValue[RDTRC_ALERT_MAX_SIGNALS];
+
+    RDTRC_AlertEvent events[RDTRC_ALERT_QUEUE_SIZE];
+    uint8_t eventHead;
+    uint8_t eventCount;
+    unsigned long droppedEvents;
+
+    static bool tripped(const Rule& rule, float value) {
+      return rule.compare == RDTRC_ALERT_ABOVE ? value > rule.threshold
+                                               : value < rule.threshold;
+    }
+
+    // Once active, a rule only clears after the value is back past the
+    // threshold by the hysteresis margin
+    static bool recovered(const Rule& rule, float value) {
+      return rule.compare == RDTRC_ALERT_ABOVE ? value < rule.threshold - rule.hysteresis
+                                               : value > rule.threshold + rule.hysteresis;
+    }
+
+    void emit(int index, bool raised, float value, unsigned long now) {
+      if (eventCount >= RDTRC_ALERT_QUEUE_SIZE) {
+        droppedEvents++;
+        return;
+      }
+      RDTRC_AlertEvent& event = events[(eventHead + eventCount) % RDTRC_ALERT_QUEUE_SIZE];
+      event.rule = index;
+      event.severity = (RDTRC_AlertSeverity)rules[index].severity;
+      event.raised = raised;
+      event.value = value;
+      event.time = now;
+      eventCount++;
+    }
+
+    void evaluate(int index, float value, unsigned long now) {
+      Rule& rule = rules[index];
+
+      if (rule.state == STATE_ACTIVE) {
+        if (recovered(rule, value)) {
+          rule.state = STATE_CLEAR;
+          emit(index, false, value, now);
+        }
+        return;
+      }
+
+      if (!tripped(rule, value)) {
+        rule.state = STATE_CLEAR;
+        return;
+      }
+
+      if (rule.state == STATE_CLEAR) {
+        rule.state = STATE_PENDING;
+        rule.pendingSince = now;
+      }
+
+      if (now - rule.pendingSince < rule.holdTime) return;
+      // Still cooling down from the last raise: stay pending, the event
+      // goes out on the first update after the cooldown
+      if (rule.everRaised && now - rule.lastRaised < rule.cooldown) return;
+
+      rule.state = STATE_ACTIVE;
+      rule.lastRaised = now;
+      rule.everRaised = true;
+      emit(index, true, value, now);
+    }
+
+  public:
+    RDTRC_AlertEngine() {
+      clear();
+    }
+
+    // Remove all rules and pending events
+    void clear() {
+      ruleCount = 0;
+      for (int i = 0; i < RDTRC_ALERT_MAX_SIGNALS; i++) {
+        firstRule[i] = -1;
+        lastValue[i] = NAN;
+      }
+      eventHead = 0;
+      eventCount = 0;
+      droppedEvents = 0;
+    }
+
+    // Declare a rule. Returns its index, used to identify its events, or
+    // -1 if the signal is out of range or the rule table is full.
+    int addRule(uint8_t signal, RDTRC_AlertCompare compare, float threshold,
+                float hysteresis = 0, unsigned long holdTime = 0,
+                unsigned long cooldown = 0,
+                RDTRC_AlertSeverity severity = RDTRC_ALERT_WARNING) {
+      if (signal >= RDTRC_ALERT_MAX_SIGNALS || ruleCount >= RDTRC_ALERT_MAX_RULES) {
+        return -1;
+      }
+
+      Rule& rule = rules[ruleCount];
+      rule.threshold = threshold;
+      rule.hysteresis = hysteresis < 0 ? -hysteresis : hysteresis;
+      rule.holdTime = holdTime;
+      rule.cooldown = cooldown;
+      rule.pendingSince = 0;
+      rule.lastRaised = 0;
+      rule.signal = signal;
+      rule.compare = compare;
+      rule.severity = severity;
+      rule.state = STATE_CLEAR;
+      rule.everRaised = false;
+
+      // Append to the signal's list so rules fire in declaration order
+      rule.nextRule = -1;
+      if (firstRule[signal] < 0) {
+        firstRule[signal] = ruleCount;
+      } else {
+        int last = firstRule[signal];
+        while (rules[last].nextRule >= 0) last = rules[last].nextRule;
+        rules[last].nextRule = ruleCount;
+      }
+
+      return ruleCount++;
+    }
+
+    // Feed a new sensor reading. NaN readings (sensor offline) are ignored
+    // and leave every rule in its current state.
+    void update(uint8_t signal, float value, unsigned long now) {
+      if (signal >= RDTRC_ALERT_MAX_SIGNALS || isnan(value)) return;
+      lastValue[signal] = value;
+      for (int i = firstRule[signal]; i >= 0; i = rules[i].nextRule) {
+        evaluate(i, value, now);
+      }
+    }
+
+    // Take the oldest event. Returns false when there is none.
+    bool poll(RDTRC_AlertEvent& event) {
+      if (eventCount == 0) return false;
+      event = events[eventHead];
+      eventHead = (eventHead + 1) % RDTRC_ALERT_QUEUE_SIZE;
+      eventCount--;
+      return true;
+    }
+
+    bool isActive(int rule) const {
+      return rule >= 0 && rule < ruleCount && rules[rule].state == STATE_ACTIVE;
+    }
+
+    int activeCount() const {
+      int active = 0;
+      for (int i = 0; i < ruleCount; i++) {
+        if (rules[i].state == STATE_ACTIVE) active++;
+      }
+      return active;
+    }
+
+    float value(uint8_t signal) const {
+      return signal < RDTRC_ALERT_MAX_SIGNALS ? lastValue[signal] : NAN;
+    }
+
+    int pending() const {
+      return eventCount;
+    }
+
+    unsigned long dropped() const {
+      return droppedEvents;
+    }
+};
+
+#endif // RDTRC_ALERT_LIBRARY_H
@@ -0,0 +1,276 @@
+/*
+ * RDTRC Scheduler Library - Deadline Driven Cooperative Jobs
+ * Version: 4.0
+ * Firmware made by: RDTRC
+ * Updated: 2024
+ *
+ * Features:
+ * - Periodic and one-shot jobs in a min-heap ordered by deadline
+ * - Only due jobs run, the loop never scans every timer
+ * - Periodic jobs keep their phase: no drift from late runs
+ * - The loop sleeps exactly until the next job or the I/O poll interval
+ * - On ESP32 the loop task blocks, so the core idles (and enters light
+ *   sleep when power management is enabled); an ISR can wake it early
+ * - Fixed-size tables, no heap allocation
+ *
+ * Usage:
+ * #include "RDTRC_Scheduler_Library.h"
+ * RDTRC_Scheduler scheduler;
+ * scheduler.every(30000, readSensors);   // in setup()
+ * scheduler.after(5000, stopPump);       // one-shot
+ * scheduler.run();                       // in loop(), runs due jobs
+ * scheduler.idle(RDTRC_SCHED_IO_POLL);   // at the end of loop()
+ * scheduler.wakeFromISR();               // in a button interrupt
+ */
+
+#ifndef RDTRC_SCHEDULER_LIBRARY_H
+#define RDTRC_SCHEDULER_LIBRARY_H
+
+#include <Arduino.h>
+#include <limits.h>
+
+#ifndef RDTRC_SCHED_MAX_JOBS
+#define RDTRC_SCHED_MAX_JOBS 16
+#endif
+
+// Longest sleep while web, Blynk and OTA still need polling, in ms
+#ifndef RDTRC_SCHED_IO_POLL
+#define RDTRC_SCHED_IO_POLL 10
+#endif
+
+typedef void (*RDTRC_JobCallback)();
+
+class RDTRC_Scheduler {
+  private:
+    struct Job {
+      RDTRC_JobCallback callback;
+      unsigned long deadline;
+      unsigned long period;     // 0 for one-shot jobs
+      uint8_t heapIndex;        // position in heap, 0xFF when not scheduled
+    };
+
+    Job jobs[RDTRC_SCHED_MAX_JOBS];
+    uint8_t heap[RDTRC_SCHED_MAX_JOBS];  // job ids, earliest deadline first
+    uint8_t heapSize;
+
+    unsigned long runCount;
+    unsigned long wakeCount;
+    unsigned long maxLate;
+
+#if defined(ESP32)
+    TaskHandle_t loopTask;
+#endif
+
+    // Deadlines are compared through their difference, so the order stays
+    // right across the millis() rollover
+    bool earlier(uint8_t a, uint8_t b) const {
+      return (long)(jobs[heap[a]].deadline - jobs[heap[b]].deadline) < 0;
+    }
+
+    void place(uint8_t index, uint8_t id) {
+      heap[index] = id;
+      jobs[id].heapIndex = index;
+    }
+
+    void swap(uint8_t a, uint8_t b) {
+      uint8_t id = heap[a];
+      place(a, heap[b]);
+      place(b, id);
+    }
+
+    void siftUp(uint8_t index) {
+      while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!earlier(index, parent)) break;
+        swap(index, parent);
+        index = parent;
+      }
+    }
+
+    void siftDown(uint8_t index) {
+      for (;;) {
+        uint8_t child = 2 * index + 1;
+        if (child >= heapSize) break;
+        if (child + 1 < heapSize && earlier(child + 1, child)) child++;
+        if (!earlier(child, index)) break;
+        swap(index, child);
+        index = child;
+      }
+    }
+
+    void push(uint8_t id) {
+      place(heapSize, id);
+      siftUp(heapSize++);
+    }
+
+    void remove(uint8_t id) {
+      uint8_t index = jobs[id].heapIndex;
+      jobs[id].heapIndex = 0xFF;
+      if (--heapSize == index) return;
+      uint8_t moved = heap[heapSize];
+      place(index, moved);
+      siftDown(index);
+      siftUp(jobs[moved].heapIndex);
+    }
+
+    int add(RDTRC_JobCallback callback, unsigned long delayMs, unsigned long period) {
+      if (!callback) return -1;
+      for (uint8_t id = 0; id < RDTRC_SCHED_MAX_JOBS; id++) {
+        if (jobs[id].callback) continue;
+        jobs[id].callback = callback;
+        jobs[id].period = period;
+        jobs[id].deadline = millis() + delayMs;
+        push(id);
+        return id;
+      }
+      return -1;
+    }
+
+    bool valid(int id) const {
+      return id >= 0 && id < RDTRC_SCHED_MAX_JOBS && jobs[id].callback;
+    }
+
+  public:
+    RDTRC_Scheduler() : heapSize(0), runCount(0), wakeCount(0), maxLate(0) {
+      for (uint8_t i = 0; i < RDTRC_SCHED_MAX_JOBS; i++) {
+        jobs[i].callback = NULL;
+        jobs[i].heapIndex = 0xFF;
+      }
+#if defined(ESP32)
+      loopTask = NULL;
+#endif
+    }
+
+    // Call from setup(): idle() and the wake functions then refer to the
+    // task running loop()
+    void begin() {
+#if defined(ESP32)
+      loopTask = xTaskGetCurrentTaskHandle();
+#endif
+    }
+
+    // Run callback every period ms, the first time after firstDelay ms.
+    // Returns the job id, or -1 if the job table is full.
+    int every(unsigned long period, RDTRC_JobCallback callback, unsigned long firstDelay = 0) {
+      if (period == 0) return -1;
+      return add(callback, firstDelay, period);
+    }
+
+    // Run callback once, after delayMs
+    int after(unsigned long delayMs, RDTRC_JobCallback callback) {
+      return add(callback, delayMs, 0);
+    }
+
+    void cancel(int id) {
+      if (!valid(id)) return;
+      if (jobs[id].heapIndex != 0xFF) remove(id);
+      jobs[id].callback = NULL;
+    }
+
+    // Move the next run of a job to delayMs from now, e.g. 0 to run a
+    // periodic job right away; its period restarts from there
+    void reschedule(int id, unsigned long delayMs) {
+      if (!valid(id)) return;
+      if (jobs[id].heapIndex != 0xFF) remove(id);
+      jobs[id].deadline = millis() + delayMs;
+      push(id);
+    }
+
+    void setPeriod(int id, unsigned long period) {
+      if (valid(id) && period > 0 && jobs[id].period > 0) jobs[id].period = period;
+    }
+
+    bool isScheduled(int id) const {
+      return valid(id) && jobs[id].heapIndex != 0xFF;
+    }
+
+    // Run every job that is due. A job that schedules or cancels jobs from
+    // its callback is fine; each call runs at most as many jobs as were
+    // queued when it started, so a job that keeps itself due can't stall it.
+    void run(unsigned long now = millis()) {
+      uint8_t budget = heapSize;
+      while (heapSize > 0 && budget-- > 0) {
+        uint8_t id = heap[0];
+        Job& job = jobs[id];
+        unsigned long late = now - job.deadline;
+        if ((long)late < 0) break;
+
+        if (late > maxLate) maxLate = late;
+        RDTRC_JobCallback callback = job.callback;
+        if (job.period) {
+          // Keep the phase, unless a whole period was missed: then restart
+          // from now rather than running a burst of catch-up calls
+          job.deadline += job.period;
+          if ((long)(now - job.deadline) >= 0) job.deadline = now + job.period;
+          siftDown(0);
+        } else {
+          remove(id);
+          job.callback = NULL;
+        }
+        runCount++;
+        callback();
+      }
+    }
+
+    // ms until the next job is due, 0 if one is due, ULONG_MAX without jobs
+    unsigned long timeUntilNext(unsigned long now = millis()) const {
+      if (heapSize == 0) return ULONG_MAX;
+      long remaining = (long)(jobs[heap[0]].deadline - now);
+      return remaining > 0 ? (unsigned long)remaining : 0;
+    }
+
+    // Sleep until the next job, at most maxSleep ms. Returns early when an
+    // interrupt calls wakeFromISR().
+    void idle(unsigned long maxSleep = RDTRC_SCHED_IO_POLL) {
+      unsigned long sleep = min(timeUntilNext(), maxSleep);
+      if (sleep == 0) {
+        yield();
+        return;
+      }
+      wakeCount++;
+#if defined(ESP32)
+      if (loopTask) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleep));
+        return;
+      }
+#endif
+      delay(sleep);
+    }
+
+    // Cut the current idle() short, e.g. from a button interrupt
+    void wakeFromISR() {
+#if defined(ESP32)
+      if (!loopTask) return;
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(loopTask, &woken);
+      if (woken) portYIELD_FROM_ISR();
+#endif
+    }
+
+    // Same, from another task
+    void wake() {
+#if defined(ESP32)
+      if (loopTask) xTaskNotifyGive(loopTask);
+#endif
+    }
+
+    int jobCount() const {
+      return heapSize;
+    }
+
+    // Diagnostics: jobs run, idle() sleeps, and the largest delay between
+    // a deadline and the start of its job, in ms
+    unsigned long runs() const {
+      return runCount;
+    }
+
+    unsigned long wakeups() const {
+      return wakeCount;
+    }
+
+    unsigned long maxLateness() const {
+      return maxLate;
+    }
+};
+
+#endif // RDTRC_SCHEDULER_LIBRARY_H
@@ -17,6 +17,7 @@
 
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
+#include <Adafruit_I2CBus.h>
 
 class RDTRC_LCD {
   private:
@@ -29,6 +30,7 @@ class RDTRC_LCD {
     bool autoScroll;
     unsigned long scrollInterval;
     unsigned long lastScroll;
+    Adafruit_I2CBus* bus;  // the sketch's shared bus, if it has one
     
     // Status data structure
     struct StatusData {
@@ -54,6 +56,7 @@ class RDTRC_LCD {
       autoScroll = true;
       scrollInterval = 3000; // 3 seconds per page
       lastScroll = 0;
+      bus = nullptr;
     }
     
     ~RDTRC_LCD() {
@@ -62,6 +65,12 @@ class RDTRC_LCD {
       }
     }
     
+    // Share the sketch's bus: scanI2C() and begin() use its scan, and the
+    // display's writes queue behind the RTC and expanders on it
+    void setBus(Adafruit_I2CBus& sharedBus) {
+      bus = &sharedBus;
+    }
+    
     // Initialize LCD with auto address detection
     bool begin() {
       Serial.println("Scanning for I2C LCD...");
@@ -72,30 +81,31 @@ class RDTRC_LCD {
       
       Wire.begin();
       
-      for (int i = 0; i < numAddresses; i++) {
-        Wire.beginTransmission(addresses[i]);
-        if (Wire.endTransmission() == 0) {
-          address = addresses[i];
-          Serial.println("LCD found at address: 0x" + String(address, HEX));
-          
-          // Try to initialize LCD
-          if (lcd) delete lcd;
-          lcd = new LiquidCrystal_I2C(address, 16, 2);
-          lcd->init();
-          lcd->backlight();
-          
-          // Test LCD
-          lcd->clear();
-          lcd->setCursor(0, 0);
-          lcd->print("RDTRC LCD Test");
-          lcd->setCursor(0, 1);
-          lcd->print("Addr: 0x" + String(address, HEX));
-          
-          delay(2000);
-          isConnected = true;
-          showBootScreen();
-          return true;
-        }
+      // From the shared bus's scan; without one, only the candidates
+      // are probed
+      Adafruit_I2CBus probeOnly;
+      address = (bus ? bus : &probeOnly)->find(addresses, numAddresses);
+      if (address != 0) {
+        Serial.println("LCD found at address: 0x" + String(address, HEX));
+        
+        // Try to initialize LCD
+        if (lcd) delete lcd;
+        lcd = new LiquidCrystal_I2C(address, 16, 2);
+        if (bus) lcd->setBus(bus);
+        lcd->init();
+        lcd->backlight();
+        
+        // Test LCD
+        lcd->clear();
+        lcd->setCursor(0, 0);
+        lcd->print("RDTRC LCD Test");
+        lcd->setCursor(0, 1);
+        lcd->print("Addr: 0x" + String(address, HEX));
+        
+        delay(2000);
+        isConnected = true;
+        showBootScreen();
+        return true;
       }
       
       Serial.println("No I2C LCD found");
@@ -349,12 +359,14 @@ class RDTRC_LCD {
       Serial.println("Scanning I2C bus...");
       int deviceCount = 0;
       
-      for (uint8_t address = 1; address < 127; address++) {
-        Wire.beginTransmission(address);
-        if (Wire.endTransmission() == 0) {
-          Serial.println("I2C device found at address 0x" + String(address, HEX));
-          deviceCount++;
-        }
+      // Probe again, a device may have been plugged in since. On the
+      // shared bus this is the scan begin() and the sketch look up.
+      Adafruit_I2CBus own;
+      Adafruit_I2CBus* scanned = bus ? bus : &own;
+      scanned->scan(true);
+      for (uint8_t address = scanned->next(); address; address = scanned->next(address)) {
+        Serial.println("I2C device found at address 0x" + String(address, HEX));
+        deviceCount++;
       }
       
       if (deviceCount == 0) {
@@ -40,9 +40,14 @@
 #include <ArduinoOTA.h>
 #include <WiFiClientSecure.h>
 #include <Wire.h>
+#include <RTClib.h>
 #include <LiquidCrystal_I2C.h>
 #include <DHT.h>
 #include "RDTRC_LCD_Library.h"
+#include "RDTRC_Notify_Library.h"
+#include "RDTRC_Alert_Library.h"
+#include "RDTRC_TimeSync_Library.h"
+#include "RDTRC_Scheduler_Library.h"
 
 // System Configuration
 #define FIRMWARE_VERSION "4.0"
@@ -95,6 +100,13 @@ const char* lineToken = "YOUR_LINE_NOTIFY_TOKEN";
 #define LOW_FOOD_THRESHOLD 3      // cm
 #define EMPTY_BOWL_THRESHOLD 5    // grams
 
+// Alert rate limiting
+// A condition must show in two consecutive sensor readings before it alerts.
+// Holding it for half an interval lets a reading that runs late still count.
+#define SENSOR_READ_INTERVAL 30000 // 30 seconds
+#define ALERT_HOLD_TIME (SENSOR_READ_INTERVAL / 2)
+#define ALERT_COOLDOWN 1800000    // at most one alert per rule every 30 minutes
+
 // Environmental thresholds
 #define TEMP_MIN 15.0                   // Minimum temperature
 #define TEMP_MAX 35.0                   // Maximum temperature
@@ -115,10 +127,26 @@ const char* lineToken = "YOUR_LINE_NOTIFY_TOKEN";
 WebServer server(80);
 WiFiUDP ntpUDP;
 NTPClient timeClient(ntpUDP, "pool.ntp.org", 25200, 60000); // UTC+7 Thailand
+RTC_DS3231 rtc;                 // Optional, keeps time offline and between NTP syncs
+RDTRC_TimeSync timeSync;
+RDTRC_Scheduler scheduler;
 HX711 scale;
 Servo feedingServo;
 DHT dht(DHT_PIN, DHT_TYPE);
 RDTRC_LCD systemLCD;
+Adafruit_I2CBus i2cBus;         // Wire, shared by the LCD and the RTC
+RDTRC_LineNotifier lineNotifier;
+RDTRC_AlertEngine alertEngine;
+
+// Signals fed to the alert engine from readSensors()
+enum AlertSignal {
+  SIGNAL_FOOD_LEVEL,
+  SIGNAL_BOWL_WEIGHT
+};
+
+// Alert rule handles, assigned in setupAlerts()
+int lowFoodRule = -1;
+int emptyBowlRule = -1;
 
 // Sensor status tracking
 struct SensorStatus {
@@ -146,8 +174,6 @@ SensorStatus lcdSensor;
 bool isWiFiConnected = false;
 bool isHotspotMode = false;
 unsigned long lastHeartbeat = 0;
-unsigned long lastDataLog = 0;
-unsigned long lastStatusCheck = 0;
 unsigned long lastLCDUpdate = 0;
 
 // Environmental Variables
@@ -208,9 +234,12 @@ void setupWiFi();
 void setupWebServer();
 void setupBlynk();
 void setupOTA();
+void setupAlerts();
 void displayBootScreen();
 void handleSystemLoop();
 void readSensors();
+void sensorJob();
+void maintenanceJob();
 void checkFeedingSchedule();
 void performFeeding(int portion);
 void handleWebInterface();
@@ -238,6 +267,13 @@ void setup() {
   displayBootScreen();
   setupSystem();
   
+  // Timed work runs from the scheduler; loop() only polls I/O
+  scheduler.begin();
+  scheduler.every(SENSOR_READ_INTERVAL, sensorJob, SENSOR_READ_INTERVAL);
+  scheduler.every(60000, checkFeedingSchedule, 60000);
+  scheduler.every(900000, logData, 900000);
+  scheduler.every(300000, maintenanceJob, 300000);
+  
   Serial.println("RDTRC Cat Feeding System with LCD Ready!");
   Serial.println("Web Interface: http://cat-feeder.local");
   Serial.println("Blynk App: Connected");
@@ -272,34 +308,21 @@ void loop() {
   // Update LCD display
   updateLCDDisplay();
   
-  // Read sensors every 30 seconds
-  static unsigned long lastSensorRead = 0;
-  if (millis() - lastSensorRead > 30000) {
-    readSensors();
-    lastSensorRead = millis();
-  }
-  
-  // Check feeding schedule every minute
-  static unsigned long lastScheduleCheck = 0;
-  if (millis() - lastScheduleCheck > 60000) {
-    checkFeedingSchedule();
-    lastScheduleCheck = millis();
-  }
-  
-  // Log data every 15 minutes
-  if (millis() - lastDataLog > 900000) {
-    logData();
-    lastDataLog = millis();
-  }
-  
-  // System status check every 5 minutes
-  if (millis() - lastStatusCheck > 300000) {
-    performSystemMaintenance();
-    checkAlerts();
-    lastStatusCheck = millis();
-  }
+  // Run the jobs that are due, then sleep until the next one; web,
+  // Blynk and OTA are polled again after at most RDTRC_SCHED_IO_POLL ms
+  scheduler.run();
+  scheduler.idle(RDTRC_SCHED_IO_POLL);
+}
+
+void sensorJob() {
+  readSensors();
   
-  delay(100);
+  // Dispatch alert events raised by this reading
+  checkAlerts();
+}
+
+void maintenanceJob() {
+  performSystemMaintenance();
 }
 
 void displayBootScreen() {
@@ -386,9 +409,19 @@ void setupSystem() {
   setupBlynk();
   setupOTA();
   
+  // Start background LINE notification sender
+  lineNotifier.begin(lineToken);
+  
+  // Declare alert rules before the first sensor reading
+  setupAlerts();
+  
   // Initialize NTP
   timeClient.begin();
-  timeClient.update();
+  timeClient.addServer("time.google.com");
+  timeClient.addServer("time.cloudflare.com");
+  bool rtcFound = rtc.begin();
+  if (rtcFound) rtc.setBus(&i2cBus);
+  timeSync.begin(timeClient, rtcFound ? &rtc : NULL);
   
   // Initialize today's stats
   todayStats.date = "01/01/2024";
@@ -433,7 +466,11 @@ void setupLCD() {
   // Initialize I2C
   Wire.begin(I2C_SDA, I2C_SCL);
   
-  // Scan for I2C devices first
+  // Transfers from both tasks queue on one worker, clock first
+  i2cBus.begin();
+  systemLCD.setBus(i2cBus);
+  
+  // Scan for I2C devices first; the LCD's address comes from this scan
   systemLCD.scanI2C();
   
   // Initialize LCD with auto detection
@@ -604,9 +641,7 @@ void handleSystemLoop() {
   }
   
   // Update time
-  if (isWiFiConnected) {
-    timeClient.update();
-  }
+  timeSync.update(isWiFiConnected);
 }
 
 void handleLCDControls() {
@@ -660,6 +695,7 @@ void readSensors() {
       currentWeight = scale.get_units(3); // Average of 3 readings
       if (currentWeight < 0) currentWeight = 0;
       updateSensorStatus(1, true, currentWeight);
+      alertEngine.update(SIGNAL_BOWL_WEIGHT, currentWeight, millis());
     } else {
       handleSensorError(1, loadCellSensor.sensorName);
     }
@@ -679,6 +715,7 @@ void readSensors() {
       if (foodLevel < 0) foodLevel = 0;
       if (foodLevel > FOOD_CONTAINER_HEIGHT) foodLevel = FOOD_CONTAINER_HEIGHT;
       updateSensorStatus(3, true, foodLevel);
+      alertEngine.update(SIGNAL_FOOD_LEVEL, foodLevel, millis());
     } else {
       handleSensorError(3, ultrasonicSensor.sensorName);
     }
@@ -790,7 +827,6 @@ void readSensors() {
 }
 
 void checkFeedingSchedule() {
-  timeClient.update();
   int currentHour = timeClient.getHours();
   int currentMinute = timeClient.getMinutes();
   
@@ -850,24 +886,39 @@ void performFeeding(int portion) {
   Serial.println("Feeding completed: " + String(portion) + "g");
 }
 
+void setupAlerts() {
+  // signal, comparator, threshold, hysteresis, hold time, cooldown, severity
+  lowFoodRule = alertEngine.addRule(SIGNAL_FOOD_LEVEL, RDTRC_ALERT_BELOW, LOW_FOOD_THRESHOLD,
+                                    1, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_WARNING);
+  emptyBowlRule = alertEngine.addRule(SIGNAL_BOWL_WEIGHT, RDTRC_ALERT_BELOW, EMPTY_BOWL_THRESHOLD,
+                                      3, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_WARNING);
+}
+
 void checkAlerts() {
-  // Low food alert
-  if (foodLevel < LOW_FOOD_THRESHOLD) {
-    String alertMsg = "Low Food Level Alert!\n";
-    alertMsg += "Current Level: " + String(foodLevel) + "cm\n";
-    alertMsg += "Please refill the food container.";
-    sendLineNotification(alertMsg);
-    systemLCD.showAlert("LOW FOOD");
-    todayStats.alerts++;
-  }
-  
-  // Empty bowl alert (no food detected for long time)
-  if (currentWeight < EMPTY_BOWL_THRESHOLD) {
-    String alertMsg = "Empty Food Bowl Alert!\n";
-    alertMsg += "Bowl Weight: " + String(currentWeight) + "g\n";
-    alertMsg += "Cat may not be eating.";
+  // Only transitions reach here, steady conditions produce no events
+  RDTRC_AlertEvent event;
+  while (alertEngine.poll(event)) {
+    if (!event.raised) {
+      Serial.println("Alert cleared (rule " + String(event.rule) + "), value: " + String(event.value));
+      continue;
+    }
+    
+    String alertMsg;
+    if (event.rule == lowFoodRule) {
+      alertMsg = "Low Food Level Alert!\n";
+      alertMsg += "Current Level: " + String(event.value) + "cm\n";
+      alertMsg += "Please refill the food container.";
+      systemLCD.showAlert("LOW FOOD");
+    } else if (event.rule == emptyBowlRule) {
+      alertMsg = "Empty Food Bowl Alert!\n";
+      alertMsg += "Bowl Weight: " + String(event.value) + "g\n";
+      alertMsg += "Cat may not be eating.";
+      systemLCD.showAlert("EMPTY BOWL");
+    } else {
+      continue;
+    }
+    
     sendLineNotification(alertMsg);
-    systemLCD.showAlert("EMPTY BOWL");
     todayStats.alerts++;
   }
 }
@@ -989,23 +1040,12 @@ void performSystemMaintenance() {
 }
 
 void sendLineNotification(String message) {
-  if (!isWiFiConnected || strlen(lineToken) < 10) return;
+  if (strlen(lineToken) < 10) return;
   
-  HTTPClient http;
-  http.begin("https://notify-api.line.me/api/notify");
-  http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-  http.addHeader("Authorization", "Bearer " + String(lineToken));
-  
-  String payload = "message=" + message;
-  int httpResponseCode = http.POST(payload);
-  
-  if (httpResponseCode == 200) {
-    Serial.println("LINE notification sent");
-  } else {
-    Serial.println("LINE notification failed: " + String(httpResponseCode));
+  // Queued for the background sender, so alerts never stall loop()
+  if (!lineNotifier.send(message)) {
+    Serial.println("LINE notification not queued (duplicate or queue full)");
   }
-  
-  http.end();
 }
 
 void handleWebInterface() {
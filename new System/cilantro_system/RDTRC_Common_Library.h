@@ -25,6 +25,9 @@
 #include <HTTPClient.h>
 #include <ArduinoOTA.h>
 #include <DHT.h>
+#include "RDTRC_Notify_Library.h"
+#include "RDTRC_Alert_Library.h"
+#include "RDTRC_Scheduler_Library.h"
 
 // Common System Configuration
 #define RDTRC_FIRMWARE_VERSION "4.0"
@@ -106,7 +109,7 @@ class RDTRCCommon {
     static float readWaterLevel(int trigPin, int echoPin, int tankHeight);
     
     // Communication utilities
-    static void sendLineNotification(const char* token, String message);
+    static void sendLineNotification(RDTRC_LineNotifier& notifier, String message);
     static void sendBlynkUpdate(int pin, float value);
     
     // File system utilities
@@ -121,7 +124,7 @@ class RDTRCCommon {
     static void handleEmergencyStop();
     
     // Alert management
-    static void checkCommonAlerts(RDTRCEnvironmentalData& data, void (*alertCallback)(String));
+    static void checkCommonAlerts(RDTRCEnvironmentalData& data, unsigned long sensorInterval, void (*alertCallback)(String));
     
     // Time utilities
     static String getFormattedDate(NTPClient& timeClient);
@@ -312,24 +315,12 @@ float RDTRCCommon::readWaterLevel(int trigPin, int echoPin, int tankHeight) {
   return 0;
 }
 
-void RDTRCCommon::sendLineNotification(const char* token, String message) {
-  if (WiFi.status() != WL_CONNECTED || strlen(token) < 10) return;
-  
-  HTTPClient http;
-  http.begin("https://notify-api.line.me/api/notify");
-  http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-  http.addHeader("Authorization", "Bearer " + String(token));
-  
-  String payload = "message=" + message;
-  int httpResponseCode = http.POST(payload);
-  
-  if (httpResponseCode == 200) {
-    Serial.println("📱 LINE notification sent");
-  } else {
-    Serial.println("❌ LINE notification failed: " + String(httpResponseCode));
+// The sketch passes its own notifier, already begun with the token, so that
+// there is only one sender task and one connection to LINE.
+void RDTRCCommon::sendLineNotification(RDTRC_LineNotifier& notifier, String message) {
+  if (!notifier.send(message)) {
+    Serial.println("📱 LINE notification not queued (duplicate or queue full)");
   }
-  
-  http.end();
 }
 
 bool RDTRCCommon::initializeSPIFFS() {
@@ -382,43 +373,66 @@ void RDTRCCommon::checkSystemHealth() {
   }
 }
 
-void RDTRCCommon::checkCommonAlerts(RDTRCEnvironmentalData& data, void (*alertCallback)(String)) {
-  if (!alertCallback) return;
+// Call once per sensor reading, every sensorInterval ms. The rules are set
+// up on the first call.
+void RDTRCCommon::checkCommonAlerts(RDTRCEnvironmentalData& data, unsigned long sensorInterval, void (*alertCallback)(String)) {
+  enum { SIGNAL_WATER, SIGNAL_CO2, SIGNAL_PH, SIGNAL_TEMPERATURE };
+  static RDTRC_AlertEngine engine;
+  static int lowWater, highCO2, lowPH, highPH, highTemp, lowTemp;
+  static bool rulesReady = false;
   
-  // Low water alert
-  if (data.waterLevel < RDTRC_LOW_WATER_THRESHOLD) {
-    String alertMsg = "⚠️ Low Water Level Alert!\n" +
-                     "Current Level: " + String(data.waterLevel) + "cm\n" +
-                     "Please refill the water tank.";
-    alertCallback(alertMsg);
-  }
+  if (!alertCallback) return;
   
-  // High CO2 alert
-  if (data.co2Level > RDTRC_HIGH_CO2_THRESHOLD) {
-    String alertMsg = "⚠️ High CO2 Level Alert!\n" +
-                     "Current Level: " + String(data.co2Level) + "ppm\n" +
-                     "Ventilation activated.";
-    alertCallback(alertMsg);
+  if (!rulesReady) {
+    // Two consecutive readings over the threshold, one alert per rule per
+    // 30 minutes. Half an interval: the second reading is at least that far
+    // past the first even when the first one ran late.
+    const unsigned long hold = sensorInterval / 2;
+    const unsigned long cooldown = 1800000;
+    lowWater = engine.addRule(SIGNAL_WATER, RDTRC_ALERT_BELOW, RDTRC_LOW_WATER_THRESHOLD, 2, hold, cooldown, RDTRC_ALERT_CRITICAL);
+    highCO2 = engine.addRule(SIGNAL_CO2, RDTRC_ALERT_ABOVE, RDTRC_HIGH_CO2_THRESHOLD, 100, hold, cooldown);
+    lowPH = engine.addRule(SIGNAL_PH, RDTRC_ALERT_BELOW, RDTRC_OPTIMAL_PH_MIN, 0.2, hold, cooldown);
+    highPH = engine.addRule(SIGNAL_PH, RDTRC_ALERT_ABOVE, RDTRC_OPTIMAL_PH_MAX, 0.2, hold, cooldown);
+    highTemp = engine.addRule(SIGNAL_TEMPERATURE, RDTRC_ALERT_ABOVE, 35.0, 1.0, hold, cooldown, RDTRC_ALERT_CRITICAL);
+    lowTemp = engine.addRule(SIGNAL_TEMPERATURE, RDTRC_ALERT_BELOW, 10.0, 1.0, hold, cooldown, RDTRC_ALERT_CRITICAL);
+    rulesReady = true;
   }
   
-  // pH out of range alert
-  if (data.phLevel < RDTRC_OPTIMAL_PH_MIN || data.phLevel > RDTRC_OPTIMAL_PH_MAX) {
-    String alertMsg = "⚠️ pH Level Alert!\n" +
-                     "Current pH: " + String(data.phLevel) + "\n" +
-                     "Optimal range: " + String(RDTRC_OPTIMAL_PH_MIN) + "-" + String(RDTRC_OPTIMAL_PH_MAX);
-    alertCallback(alertMsg);
-  }
+  unsigned long now = millis();
+  engine.update(SIGNAL_WATER, data.waterLevel, now);
+  engine.update(SIGNAL_CO2, data.co2Level, now);
+  engine.update(SIGNAL_PH, data.phLevel, now);
+  engine.update(SIGNAL_TEMPERATURE, data.temperature, now);
   
-  // Temperature alerts
-  if (data.temperature > 35.0) {
-    String alertMsg = "🌡️ High Temperature Alert!\n" +
-                     "Current: " + String(data.temperature) + "°C\n" +
-                     "Check cooling systems.";
-    alertCallback(alertMsg);
-  } else if (data.temperature < 10.0) {
-    String alertMsg = "🌡️ Low Temperature Alert!\n" +
-                     "Current: " + String(data.temperature) + "°C\n" +
-                     "Check heating systems.";
+  // Only newly raised alerts are reported, not every call while a condition persists
+  RDTRC_AlertEvent event;
+  while (engine.poll(event)) {
+    if (!event.raised) continue;
+    
+    String alertMsg;
+    if (event.rule == lowWater) {
+      alertMsg = "⚠️ Low Water Level Alert!\n";
+      alertMsg += "Current Level: " + String(event.value) + "cm\n";
+      alertMsg += "Please refill the water tank.";
+    } else if (event.rule == highCO2) {
+      alertMsg = "⚠️ High CO2 Level Alert!\n";
+      alertMsg += "Current Level: " + String((int)event.value) + "ppm\n";
+      alertMsg += "Ventilation activated.";
+    } else if (event.rule == lowPH || event.rule == highPH) {
+      alertMsg = "⚠️ pH Level Alert!\n";
+      alertMsg += "Current pH: " + String(event.value) + "\n";
+      alertMsg += "Optimal range: " + String(RDTRC_OPTIMAL_PH_MIN) + "-" + String(RDTRC_OPTIMAL_PH_MAX);
+    } else if (event.rule == highTemp) {
+      alertMsg = "🌡️ High Temperature Alert!\n";
+      alertMsg += "Current: " + String(event.value) + "°C\n";
+      alertMsg += "Check cooling systems.";
+    } else if (event.rule == lowTemp) {
+      alertMsg = "🌡️ Low Temperature Alert!\n";
+      alertMsg += "Current: " + String(event.value) + "°C\n";
+      alertMsg += "Check heating systems.";
+    } else {
+      continue;
+    }
     alertCallback(alertMsg);
   }
 }
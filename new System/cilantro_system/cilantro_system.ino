@@ -40,8 +40,13 @@
 #include <ArduinoOTA.h>
 #include <DHT.h>
 #include <Wire.h>
+#include <RTClib.h>
 #include <LiquidCrystal_I2C.h>
 #include "RDTRC_LCD_Library.h"
+#include "RDTRC_Notify_Library.h"
+#include "RDTRC_Alert_Library.h"
+#include "RDTRC_TimeSync_Library.h"
+#include "RDTRC_Scheduler_Library.h"
 
 // System Configuration
 #define FIRMWARE_VERSION "4.0"
@@ -106,6 +111,15 @@ const char* lineToken = "YOUR_LINE_NOTIFY_TOKEN";
 #define HIGH_CO2_THRESHOLD 1000          // ppm
 #define OPTIMAL_PH_MIN 6.0
 #define OPTIMAL_PH_MAX 7.0
+#define HIGH_TEMP_ALERT 35.0             // C
+#define LOW_TEMP_ALERT 10.0              // C
+
+// Alert rate limiting
+// A condition must show in two consecutive sensor readings before it alerts.
+// Holding it for half an interval lets a reading that runs late still count.
+#define SENSOR_READ_INTERVAL 45000       // 45 seconds
+#define ALERT_HOLD_TIME (SENSOR_READ_INTERVAL / 2)
+#define ALERT_COOLDOWN 1800000           // at most one alert per rule every 30 minutes
 
 // Environmental thresholds for cilantro growing
 #define TEMP_MIN 15.0
@@ -124,8 +138,30 @@ const char* lineToken = "YOUR_LINE_NOTIFY_TOKEN";
 WebServer server(80);
 WiFiUDP ntpUDP;
 NTPClient timeClient(ntpUDP, "pool.ntp.org", 25200, 60000); // UTC+7 Thailand
+RTC_DS3231 rtc;                 // Optional, keeps time offline and between NTP syncs
+RDTRC_TimeSync timeSync;
+RDTRC_Scheduler scheduler;
 DHT dht(DHT_PIN, DHT_TYPE);
 RDTRC_LCD systemLCD;
+Adafruit_I2CBus i2cBus;         // Wire, shared by the LCD and the RTC
+RDTRC_LineNotifier lineNotifier;
+RDTRC_AlertEngine alertEngine;
+
+// Signals fed to the alert engine from readSensors()
+enum AlertSignal {
+  SIGNAL_WATER_LEVEL,
+  SIGNAL_CO2,
+  SIGNAL_PH,
+  SIGNAL_TEMPERATURE
+};
+
+// Alert rule handles, assigned in setupAlerts()
+int lowWaterRule = -1;
+int highCO2Rule = -1;
+int lowPHRule = -1;
+int highPHRule = -1;
+int highTempRule = -1;
+int lowTempRule = -1;
 
 // Sensor Status Structure
 struct SensorStatus {
@@ -156,8 +192,6 @@ SensorStatus lcdSensor;
 bool isWiFiConnected = false;
 bool isHotspotMode = false;
 unsigned long lastHeartbeat = 0;
-unsigned long lastDataLog = 0;
-unsigned long lastStatusCheck = 0;
 unsigned long lastLCDUpdate = 0;
 unsigned long bootTime = 0;
 
@@ -273,10 +307,13 @@ void setupWiFi();
 void setupWebServer();
 void setupBlynk();
 void setupOTA();
+void setupAlerts();
 void displayBootScreen();
 void handleSystemLoop();
 void controlEnvironment();
 void readSensors();
+void sensorJob();
+void maintenanceJob();
 void controlCilantro();
 void controlLighting();
 void logData();
@@ -306,6 +343,12 @@ void setup() {
   displayBootScreen();
   setupSystem();
   
+  // Timed work runs from the scheduler; loop() only polls I/O
+  scheduler.begin();
+  scheduler.every(SENSOR_READ_INTERVAL, sensorJob, SENSOR_READ_INTERVAL);
+  scheduler.every(900000, logData, 900000);
+  scheduler.every(300000, maintenanceJob, 300000);
+  
   Serial.println("RDTRC Cilantro Growing System with LCD Ready!");
   Serial.println("Web Interface: http://cilantro-system.local");
   Serial.println("Blynk App: Connected");
@@ -345,28 +388,22 @@ void loop() {
   // Update LCD display
   updateLCDDisplay();
   
-  // Read sensors every 45 seconds
-  static unsigned long lastSensorRead = 0;
-  if (millis() - lastSensorRead > 45000) {
-    readSensors();
-    lastSensorRead = millis();
-  }
-  
-  // Log data every 15 minutes
-  if (millis() - lastDataLog > 900000) {
-    logData();
-    lastDataLog = millis();
-  }
-  
-  // System status check every 5 minutes
-  if (millis() - lastStatusCheck > 300000) {
-    performSystemMaintenance();
-    updateGrowthPhases();
-    checkAlerts();
-    lastStatusCheck = millis();
-  }
+  // Run the jobs that are due, then sleep until the next one; web,
+  // Blynk and OTA are polled again after at most RDTRC_SCHED_IO_POLL ms
+  scheduler.run();
+  scheduler.idle(RDTRC_SCHED_IO_POLL);
+}
+
+void sensorJob() {
+  readSensors();
   
-  delay(100);
+  // Dispatch alert events raised by this reading
+  checkAlerts();
+}
+
+void maintenanceJob() {
+  performSystemMaintenance();
+  updateGrowthPhases();
 }
 
 void displayBootScreen() {
@@ -454,9 +491,19 @@ void setupSystem() {
   setupBlynk();
   setupOTA();
   
+  // Start background LINE notification sender
+  lineNotifier.begin(lineToken);
+  
+  // Declare alert rules before the first sensor reading
+  setupAlerts();
+  
   // Initialize NTP
   timeClient.begin();
-  timeClient.update();
+  timeClient.addServer("time.google.com");
+  timeClient.addServer("time.cloudflare.com");
+  bool rtcFound = rtc.begin();
+  if (rtcFound) rtc.setBus(&i2cBus);
+  timeSync.begin(timeClient, rtcFound ? &rtc : NULL);
   
   // Initialize today's stats
   todayStats.date = "01/01/2024";
@@ -511,7 +558,11 @@ void setupLCD() {
   // Initialize I2C with custom pins if needed
   Wire.begin(I2C_SDA, I2C_SCL);
   
-  // Scan for I2C devices first
+  // Transfers from both tasks queue on one worker, clock first
+  i2cBus.begin();
+  systemLCD.setBus(i2cBus);
+  
+  // Scan for I2C devices first; the LCD's address comes from this scan
   systemLCD.scanI2C();
   
   // Initialize LCD with auto detection
@@ -820,9 +871,7 @@ void handleSystemLoop() {
   }
   
   // Update time
-  if (isWiFiConnected) {
-    timeClient.update();
-  }
+  timeSync.update(isWiFiConnected);
 }
 
 void handleLCDControls() {
@@ -929,7 +978,6 @@ void controlCilantro() {
 void controlLighting() {
   if (!cilantro.enabled) return;
   
-  timeClient.update();
   int currentHour = timeClient.getHours();
   int currentMinute = timeClient.getMinutes();
   int currentTimeMinutes = currentHour * 60 + currentMinute;
@@ -987,6 +1035,7 @@ void readSensors() {
       ambientHumidity = 0;
     } else {
       updateSensorStatus(-1, true, ambientTemperature);
+      alertEngine.update(SIGNAL_TEMPERATURE, ambientTemperature, millis());
     }
   }
   
@@ -995,6 +1044,7 @@ void readSensors() {
     int co2Raw = analogRead(CO2_SENSOR_PIN);
     co2Level = map(co2Raw, 0, 4095, 400, 2000); // Map to ppm range
     updateSensorStatus(1, true, co2Level);
+    alertEngine.update(SIGNAL_CO2, co2Level, millis());
   }
   
   // Read pH sensor
@@ -1002,6 +1052,7 @@ void readSensors() {
     int phRaw = analogRead(PH_SENSOR_PIN);
     phLevel = map(phRaw, 0, 4095, 4.0 * 100, 10.0 * 100) / 100.0; // Map to pH range
     updateSensorStatus(2, true, phLevel);
+    alertEngine.update(SIGNAL_PH, phLevel, millis());
   }
   
   // Read EC sensor
@@ -1030,6 +1081,7 @@ void readSensors() {
     int wlRaw = analogRead(WATER_LEVEL_SENSOR_PIN);
     waterLevel = map(wlRaw, 0, 4095, 0, 100); // Convert to percentage
     updateSensorStatus(6, true, waterLevel);
+    alertEngine.update(SIGNAL_WATER_LEVEL, waterLevel, millis());
   }
   
   // Read flow sensor
@@ -1124,51 +1176,62 @@ void readSensors() {
   }
 }
 
+void setupAlerts() {
+  // signal, comparator, threshold, hysteresis, hold time, cooldown, severity
+  lowWaterRule = alertEngine.addRule(SIGNAL_WATER_LEVEL, RDTRC_ALERT_BELOW, LOW_WATER_THRESHOLD,
+                                     2, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_CRITICAL);
+  highCO2Rule = alertEngine.addRule(SIGNAL_CO2, RDTRC_ALERT_ABOVE, HIGH_CO2_THRESHOLD,
+                                    100, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_WARNING);
+  lowPHRule = alertEngine.addRule(SIGNAL_PH, RDTRC_ALERT_BELOW, OPTIMAL_PH_MIN,
+                                  0.2, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_WARNING);
+  highPHRule = alertEngine.addRule(SIGNAL_PH, RDTRC_ALERT_ABOVE, OPTIMAL_PH_MAX,
+                                   0.2, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_WARNING);
+  highTempRule = alertEngine.addRule(SIGNAL_TEMPERATURE, RDTRC_ALERT_ABOVE, HIGH_TEMP_ALERT,
+                                     1.0, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_CRITICAL);
+  lowTempRule = alertEngine.addRule(SIGNAL_TEMPERATURE, RDTRC_ALERT_BELOW, LOW_TEMP_ALERT,
+                                    1.0, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_CRITICAL);
+}
+
 void checkAlerts() {
-  // Low water alert
-  if (waterLevel < LOW_WATER_THRESHOLD) {
-    String alertMsg = "Low Water Level Alert!\n";
-    alertMsg += "Current Level: " + String(waterLevel) + "cm\n";
-    alertMsg += "Please refill the water tank.";
-    sendLineNotification(alertMsg);
-    systemLCD.showAlert("LOW WATER");
-    todayStats.alerts++;
-  }
-  
-  // High CO2 alert
-  if (co2Level > HIGH_CO2_THRESHOLD) {
-    String alertMsg = "High CO2 Level Alert!\n";
-    alertMsg += "Current Level: " + String(co2Level) + "ppm\n";
-    alertMsg += "Ventilation activated.";
-    sendLineNotification(alertMsg);
-    systemLCD.showAlert("HIGH CO2");
-    todayStats.alerts++;
-  }
-  
-  // pH out of range alert
-  if (phLevel < OPTIMAL_PH_MIN || phLevel > OPTIMAL_PH_MAX) {
-    String alertMsg = "pH Level Alert!\n";
-    alertMsg += "Current pH: " + String(phLevel) + "\n";
-    alertMsg += "Optimal range: " + String(OPTIMAL_PH_MIN) + "-" + String(OPTIMAL_PH_MAX);
-    sendLineNotification(alertMsg);
-    systemLCD.showAlert("pH ALERT");
-    todayStats.alerts++;
-  }
-  
-  // Temperature alerts
-  if (ambientTemperature > 35.0) {
-    String alertMsg = "High Temperature Alert!\n";
-    alertMsg += "Current: " + String(ambientTemperature) + "C\n";
-    alertMsg += "Check cooling systems.";
-    sendLineNotification(alertMsg);
-    systemLCD.showAlert("HIGH TEMP");
-    todayStats.alerts++;
-  } else if (ambientTemperature < 10.0) {
-    String alertMsg = "Low Temperature Alert!\n";
-    alertMsg += "Current: " + String(ambientTemperature) + "C\n";
-    alertMsg += "Check heating systems.";
+  // Only transitions reach here, steady conditions produce no events
+  RDTRC_AlertEvent event;
+  while (alertEngine.poll(event)) {
+    if (!event.raised) {
+      Serial.println("Alert cleared (rule " + String(event.rule) + "), value: " + String(event.value));
+      continue;
+    }
+    
+    String alertMsg;
+    if (event.rule == lowWaterRule) {
+      alertMsg = "Low Water Level Alert!\n";
+      alertMsg += "Current Level: " + String(event.value) + "cm\n";
+      alertMsg += "Please refill the water tank.";
+      systemLCD.showAlert("LOW WATER");
+    } else if (event.rule == highCO2Rule) {
+      alertMsg = "High CO2 Level Alert!\n";
+      alertMsg += "Current Level: " + String((int)event.value) + "ppm\n";
+      alertMsg += "Ventilation activated.";
+      systemLCD.showAlert("HIGH CO2");
+    } else if (event.rule == lowPHRule || event.rule == highPHRule) {
+      alertMsg = "pH Level Alert!\n";
+      alertMsg += "Current pH: " + String(event.value) + "\n";
+      alertMsg += "Optimal range: " + String(OPTIMAL_PH_MIN) + "-" + String(OPTIMAL_PH_MAX);
+      systemLCD.showAlert("pH ALERT");
+    } else if (event.rule == highTempRule) {
+      alertMsg = "High Temperature Alert!\n";
+      alertMsg += "Current: " + String(event.value) + "C\n";
+      alertMsg += "Check cooling systems.";
+      systemLCD.showAlert("HIGH TEMP");
+    } else if (event.rule == lowTempRule) {
+      alertMsg = "Low Temperature Alert!\n";
+      alertMsg += "Current: " + String(event.value) + "C\n";
+      alertMsg += "Check heating systems.";
+      systemLCD.showAlert("LOW TEMP");
+    } else {
+      continue;
+    }
+    
     sendLineNotification(alertMsg);
-    systemLCD.showAlert("LOW TEMP");
     todayStats.alerts++;
   }
 }
@@ -1376,23 +1439,12 @@ void performSystemMaintenance() {
 }
 
 void sendLineNotification(String message) {
-  if (!isWiFiConnected || strlen(lineToken) < 10) return;
-  
-  HTTPClient http;
-  http.begin("https://notify-api.line.me/api/notify");
-  http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-  http.addHeader("Authorization", "Bearer " + String(lineToken));
-  
-  String payload = "message=" + message;
-  int httpResponseCode = http.POST(payload);
+  if (strlen(lineToken) < 10) return;
   
-  if (httpResponseCode == 200) {
-    Serial.println("LINE notification sent");
-  } else {
-    Serial.println("LINE notification failed: " + String(httpResponseCode));
+  // Queued for the background sender, so alerts never stall loop()
+  if (!lineNotifier.send(message)) {
+    Serial.println("LINE notification not queued (duplicate or queue full)");
   }
-  
-  http.end();
 }
 
 void handleWebInterface() {
@@ -56,6 +56,12 @@ SOFTWARE.
 // file manually, right after the `#include <AceWire.h>`.
 //#include "ace_wire/SimpleWireFastInterface.h"
 
+// Template on compile-time pin and delay policies, and its ESP32 instance.
+#include "ace_wire/SimpleWirePolicyInterface.h"
+#if defined(ARDUINO_ARCH_ESP32)
+#include "ace_wire/SimpleWireEsp32Interface.h"
+#endif
+
 // Wrapper around pre-installed <Wire.h>.
 #include "ace_wire/TwoWireInterface.h"
 
@@ -0,0 +1,180 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_WIRE_SIMPLE_WIRE_ESP32_INTERFACE_H
+#define ACE_WIRE_SIMPLE_WIRE_ESP32_INTERFACE_H
+
+#include <stdint.h>
+#include <Arduino.h> // ESP, F_CPU
+#include <driver/gpio.h>
+#include <soc/gpio_reg.h>
+#include <soc/soc.h> // REG_READ(), REG_WRITE()
+#include <soc/soc_caps.h> // SOC_GPIO_PIN_COUNT
+#include "SimpleWirePolicyInterface.h"
+
+namespace ace_wire {
+
+/**
+ * SDA and SCL pins for SimpleWirePolicyInterface, configured as ESP32
+ * open-drain outputs with the input enabled. Pulling a line LOW and releasing
+ * it are single writes to the GPIO set/clear registers, and reading it is a
+ * single read of the input register, instead of the pinMode() calls
+ * SimpleWireInterface makes for every transition.
+ *
+ * The internal pull-ups are enabled, but are too weak for more than 100 kHz;
+ * the bus still needs external pull-up resistors.
+ *
+ * @tparam T_DATA_PIN SDA pin
+ * @tparam T_CLOCK_PIN SCL pin
+ */
+template <uint8_t T_DATA_PIN, uint8_t T_CLOCK_PIN>
+class Esp32OpenDrainPins {
+  public:
+    static void begin() {
+      setup(T_DATA_PIN);
+      setup(T_CLOCK_PIN);
+    }
+
+    static void end() {
+      dataHigh();
+      clockHigh();
+    }
+
+    static void dataHigh() { release(T_DATA_PIN); }
+    static void dataLow() { pull(T_DATA_PIN); }
+    static void clockHigh() { release(T_CLOCK_PIN); }
+    static void clockLow() { pull(T_CLOCK_PIN); }
+
+    static uint8_t readData() { return level(T_DATA_PIN); }
+    static uint8_t readClock() { return level(T_CLOCK_PIN); }
+
+  private:
+    static void setup(uint8_t pin) {
+      gpio_reset_pin((gpio_num_t) pin);
+      // Latch the output HIGH (released) before enabling the driver.
+      gpio_set_level((gpio_num_t) pin, 1);
+      gpio_set_direction((gpio_num_t) pin, GPIO_MODE_INPUT_OUTPUT_OD);
+      gpio_set_pull_mode((gpio_num_t) pin, GPIO_PULLUP_ONLY);
+    }
+
+    // The pins are template constants, so each of these folds to one
+    // register access.
+
+    static void release(uint8_t pin) {
+#if SOC_GPIO_PIN_COUNT > 32
+      if (pin >= 32) {
+        REG_WRITE(GPIO_OUT1_W1TS_REG, 1UL << (pin - 32));
+        return;
+      }
+#endif
+      REG_WRITE(GPIO_OUT_W1TS_REG, 1UL << pin);
+    }
+
+    static void pull(uint8_t pin) {
+#if SOC_GPIO_PIN_COUNT > 32
+      if (pin >= 32) {
+        REG_WRITE(GPIO_OUT1_W1TC_REG, 1UL << (pin - 32));
+        return;
+      }
+#endif
+      REG_WRITE(GPIO_OUT_W1TC_REG, 1UL << pin);
+    }
+
+    static uint8_t level(uint8_t pin) {
+#if SOC_GPIO_PIN_COUNT > 32
+      if (pin >= 32) {
+        return (REG_READ(GPIO_IN1_REG) >> (pin - 32)) & 0x1;
+      }
+#endif
+      return (REG_READ(GPIO_IN_REG) >> pin) & 0x1;
+    }
+};
+
+/**
+ * Bit delay for SimpleWirePolicyInterface that busy-waits on the CPU cycle
+ * counter, for delays well below the 1 microsecond resolution of
+ * delayMicroseconds(). Each delay() ends T_DELAY_NANOS after the previous one
+ * ended, so the cycles spent toggling the pin in between are not added on top.
+ * An interrupt taken in between only lengthens that one line state.
+ *
+ * The cycle count is computed at compile time from F_CPU. If the sketch
+ * lowers the clock with setCpuFrequencyMhz(), the bus slows down in
+ * proportion, which stays within the I2C timing limits.
+ *
+ * @tparam T_DELAY_NANOS minimum time between line transitions
+ */
+template <uint16_t T_DELAY_NANOS>
+class Esp32CycleDelay {
+  public:
+    static void delay() {
+      uint32_t now;
+      do {
+        now = ESP.getCycleCount();
+      } while ((uint32_t) (now - sLast) < kCycles);
+      sLast = now;
+    }
+
+  private:
+    static const uint32_t kCycles =
+        (uint32_t) ((uint64_t) F_CPU * T_DELAY_NANOS / 1000000000UL);
+
+    static uint32_t sLast;
+};
+
+template <uint16_t T_DELAY_NANOS>
+uint32_t Esp32CycleDelay<T_DELAY_NANOS>::sLast;
+
+/**
+ * SimpleWirePolicyInterface on ESP32 GPIO registers. The SCL HIGH period is
+ * one T_DELAY_NANOS and the LOW period two, so 850 gives a 392 kHz clock that
+ * meets the Fast-mode timing, and Standard-mode devices (tHIGH >= 4 us) need
+ * 4000, an 83 kHz clock.
+ *
+ * Usage:
+ * @code
+ * using WireInterface = SimpleWireEsp32Interface<SDA_PIN, SCL_PIN, 850>;
+ * WireInterface wireInterface;
+ * @endcode
+ *
+ * @tparam T_DATA_PIN SDA pin
+ * @tparam T_CLOCK_PIN SCL pin
+ * @tparam T_DELAY_NANOS minimum time between line transitions
+ * @tparam T_STRETCH_LIMIT bit delays to wait for a stretched clock, 0 to
+ *    disable clock stretching
+ */
+template <
+    uint8_t T_DATA_PIN,
+    uint8_t T_CLOCK_PIN,
+    uint16_t T_DELAY_NANOS,
+    uint16_t T_STRETCH_LIMIT = 0
+>
+using SimpleWireEsp32Interface = SimpleWirePolicyInterface<
+    Esp32OpenDrainPins<T_DATA_PIN, T_CLOCK_PIN>,
+    Esp32CycleDelay<T_DELAY_NANOS>,
+    T_STRETCH_LIMIT
+>;
+
+}
+
+#endif
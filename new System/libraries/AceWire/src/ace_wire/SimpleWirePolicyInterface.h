@@ -0,0 +1,282 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_WIRE_SIMPLE_WIRE_POLICY_INTERFACE_H
+#define ACE_WIRE_SIMPLE_WIRE_POLICY_INTERFACE_H
+
+#include <stdint.h>
+
+namespace ace_wire {
+
+/**
+ * A version of SimpleWireInterface whose pin access and bit delay are supplied
+ * at compile time as policy classes, so that each line transition can compile
+ * down to a single register write. The protocol is the same as
+ * SimpleWireInterface, with two differences:
+ *
+ * * The SCL LOW period is always at least 2 bit delays, including between the
+ *   bits of read(), so the clock meets the I2C tLOW >= 2*tHIGH ratio and a
+ *   bit delay of T gives an SCL period of 3*T. A delay of 850 ns gives a
+ *   conforming 392 kHz Fast-mode clock.
+ * * The START condition releases SDA before SCL, so a repeated START after
+ *   `endTransmission(false)` cannot be mistaken for a STOP.
+ * * If T_STRETCH_LIMIT is not 0, every release of SCL waits for the line to
+ *   actually go HIGH, for up to T_STRETCH_LIMIT bit delays, so that slaves can
+ *   stretch the clock. When the limit runs out the transfer carries on, and a
+ *   slave that was still holding the clock will normally NACK.
+ *
+ * The T_PINS class provides the open-drain lines as static methods:
+ *
+ *  * `static void begin()`: configure both pins, lines released
+ *  * `static void end()`: release both lines
+ *  * `static void dataHigh()`, `static void dataLow()`: release or pull SDA
+ *  * `static void clockHigh()`, `static void clockLow()`: same for SCL
+ *  * `static uint8_t readData()`, `static uint8_t readClock()`: line level
+ *
+ * The T_DELAY class provides `static void delay()`, which returns once a bit
+ * delay has passed since the previous call returned. Measuring from the
+ * previous transition, rather than sleeping a fixed time after it, means the
+ * time spent inside the pin methods does not slow the clock down.
+ *
+ * See SimpleWireEsp32Interface.h for the ESP32 policies.
+ *
+ * @tparam T_PINS class providing the SDA and SCL lines
+ * @tparam T_DELAY class providing the bit delay
+ * @tparam T_STRETCH_LIMIT bit delays to wait for a stretched clock, 0 to not
+ *    read SCL at all
+ */
+template <
+    typename T_PINS,
+    typename T_DELAY,
+    uint16_t T_STRETCH_LIMIT = 0
+>
+class SimpleWirePolicyInterface {
+  public:
+    /** Constructor. */
+    explicit SimpleWirePolicyInterface() = default;
+
+    /** Configure the pins, leaving both lines released HIGH. */
+    void begin() const {
+      T_PINS::begin();
+      clockHigh();
+      dataHigh();
+    }
+
+    /** Release the clock and data lines. */
+    void end() const {
+      clockHigh();
+      dataHigh();
+      T_PINS::end();
+    }
+
+    /**
+     * Send I2C START condition.
+     *
+     * @param addr I2C address of slave device
+     * @return 0 if ACK, 1 if NACK
+     */
+    uint8_t beginTransmission(uint8_t addr) const {
+      startCondition();
+
+      // Send I2C addr (7 bits) and the R/W bit set to "write" (0x00).
+      uint8_t effectiveAddr = (addr << 1) | 0x00;
+      uint8_t res = write(effectiveAddr);
+      return res ^ 0x1;
+    }
+
+    /**
+     * Send the data byte on the data bus, with MSB first as specified by I2C.
+     *
+     * @return 1 if successful with ACK, 0 for NACK.
+     */
+    uint8_t write(uint8_t data) const {
+      for (uint8_t i = 0;  i < 8; ++i) {
+        if (data & 0x80) {
+          dataHigh();
+        } else {
+          dataLow();
+        }
+        clockHigh();
+        clockLow();
+        data <<= 1;
+      }
+
+      uint8_t ack = readAck();
+      return ack ^ 0x1;
+    }
+
+    /**
+     * Send the I2C STOP condition.
+     *
+     * @return always returns 0 to indicate success
+     */
+    uint8_t endTransmission(bool sendStop = true) const {
+      // clock will always be LOW when this is called
+      if (sendStop) {
+        dataLow();
+        clockHigh();
+        dataHigh();
+      }
+
+      return 0;
+    }
+
+    /**
+     * Prepare to read bytes by sending I2C START condition. If `sendStop` is
+     * true, then a STOP condition will be sent by `read()` after the last byte.
+     *
+     * @return 'quantity' if addr was written successfully and the device
+     * responded with ACK, 0 if device responded with NACK
+     */
+    uint8_t requestFrom(
+        uint8_t addr, uint8_t quantity, bool sendStop = true) const {
+      mQuantity = quantity;
+      mSendStop = sendStop;
+
+      startCondition();
+
+      // Send I2C addr (7 bits) and the R/W bit set to "read" (0x01).
+      uint8_t effectiveAddr = (addr << 1) | 0x01;
+      uint8_t status = write(effectiveAddr);
+
+      return (status == 0) ? 0 : quantity;
+    }
+
+    /**
+     * Read byte, then send an ACK if more bytes are wanted, or a NACK and the
+     * STOP condition (if requested) after the last one. Same as
+     * SimpleWireInterface::read().
+     *
+     * If called when the number of remaining bytes is 0, this method returns
+     * immediately with a 0xff.
+     */
+    uint8_t read() const {
+      // Caller should not call when mQuantity is 0, but let's guard against it.
+      if (! mQuantity) return 0xff;
+
+      // Read one byte
+      dataHigh();
+      uint8_t data = 0;
+      for (uint8_t i = 0; i < 8; ++i) {
+        clockHigh();
+        data <<= 1;
+        data |= (T_PINS::readData() & 0x1);
+        clockLow();
+        // Nothing to change on SDA between bits, so hold the LOW period
+        // explicitly. After the 8th bit, sendAck() or sendNack() does it.
+        if (i < 7) bitDelay();
+      }
+
+      // Decrement quantity to determine if NACK or ACK should be sent.
+      mQuantity--;
+      if (mQuantity) {
+        sendAck();
+      } else {
+        sendNack();
+        endTransmission(mSendStop);
+      }
+
+      return data;
+    }
+
+    // Use default copy constructor and assignment operator.
+    SimpleWirePolicyInterface(const SimpleWirePolicyInterface&) = default;
+    SimpleWirePolicyInterface& operator=(const SimpleWirePolicyInterface&) =
+        default;
+
+  private:
+    /**
+     * Send the START (or repeated START) condition. The clock is HIGH on the
+     * first transaction and LOW after a write without a STOP; in the second
+     * case SDA is released while SCL is still LOW.
+     */
+    static void startCondition() {
+      dataHigh();
+      clockHigh();
+
+      dataLow();
+      clockLow();
+    }
+
+    /**
+     * Read the ACK/NACK bit from the device which is expected to be set after
+     * the falling edge of the 8th CLK, which happens in the write() loop above.
+     *
+     * @return 0 for ACK (active LOW), 1 or NACK (passive HIGH).
+     */
+    static uint8_t readAck() {
+      dataHigh();
+      clockHigh();
+      uint8_t ack = T_PINS::readData();
+
+      // Device releases SDA upon falling edge of the 9th CLK.
+      clockLow();
+      return ack;
+    }
+
+    /** Send ACK to slave. */
+    static void sendAck() {
+      dataLow();
+      clockHigh();
+      clockLow();
+    }
+
+    /** Send NACK to slave. */
+    static void sendNack() {
+      dataHigh();
+      clockHigh();
+      clockLow();
+    }
+
+    static void bitDelay() { T_DELAY::delay(); }
+
+    /**
+     * Release SCL. With clock stretching enabled, wait for the line to follow
+     * before starting the HIGH period, since a slave holding it LOW is not
+     * sampling yet.
+     */
+    static void clockHigh() {
+      T_PINS::clockHigh();
+      if (T_STRETCH_LIMIT) {
+        for (uint16_t i = 0; i < T_STRETCH_LIMIT && ! T_PINS::readClock(); ++i) {
+          bitDelay();
+        }
+      }
+      bitDelay();
+    }
+
+    static void clockLow() { T_PINS::clockLow(); bitDelay(); }
+
+    static void dataHigh() { T_PINS::dataHigh(); bitDelay(); }
+
+    static void dataLow() { T_PINS::dataLow(); bitDelay(); }
+
+  private:
+    mutable bool mSendStop;
+    mutable uint8_t mQuantity;
+};
+
+}
+
+#endif
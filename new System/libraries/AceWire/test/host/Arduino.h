@@ -0,0 +1,19 @@
+// Host stand-in for the Arduino core: just what SimpleWireInterface calls.
+// wire_sim.cpp implements the functions on its simulated bus.
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void delayMicroseconds(unsigned int us);
+
+#endif
@@ -0,0 +1,488 @@
+/*
+ * SimpleWirePolicyInterface on simulated pins: a wired-AND bus with a
+ * register device that decodes START, STOP, bytes and ACKs edge by edge,
+ * can stretch the clock, and checks the line timing against the I2C
+ * Fast-mode limits. SimpleWireInterface runs on the same bus through a
+ * pinMode()/digitalRead() shim for comparison.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -I../../test -Isrc -Itest/host test/wire_sim.cpp -o wire_sim
+ *   ./wire_sim          # tests
+ *   ./wire_sim bench    # edges, pin operations and bus time per byte
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "ace_wire/SimpleWireInterface.h"
+#include "ace_wire/SimpleWirePolicyInterface.h"
+#include "host_test.h"
+
+using ace_wire::SimpleWireInterface;
+using ace_wire::SimpleWirePolicyInterface;
+
+/*
+ * Register device: 32 registers behind an auto-incrementing pointer, which
+ * the first byte of a write sets. It logs what it sees on the bus, e.g.
+ * "S D0 A 05 A 41 A P" or "S D1 A <41 A <42 N P".
+ */
+
+struct Device {
+  enum Phase { IDLE, RECV, ACK_OUT, SEND, ACK_IN };
+
+  uint8_t address;
+  uint8_t regs[32];
+  uint8_t pointer;
+  uint32_t stretchNanos;  // hold SCL LOW this long after each ACK
+
+  Phase phase;
+  uint8_t bits;
+  uint8_t shift;
+  bool expectAddress;
+  bool havePointer;
+  bool reading;
+  bool masterAck;
+  std::string log;
+
+  void reset() {
+    address = 0x68;
+    memset(regs, 0, sizeof(regs));
+    pointer = 0;
+    stretchNanos = 0;
+    phase = IDLE;
+    log.clear();
+  }
+
+  void note(const char *fmt, unsigned value = 0) {
+    char buf[8];
+    snprintf(buf, sizeof(buf), fmt, value);
+    if (!log.empty()) log += ' ';
+    log += buf;
+  }
+} device;
+
+/*
+ * The bus: each line is LOW if the master or the device pulls it. Time
+ * only passes in delays, so pin operations are free.
+ */
+
+struct Bus {
+  bool masterSda, masterScl, deviceSda, deviceScl;
+  bool sda, scl;
+  uint64_t now;
+  uint64_t stretchUntil;
+
+  // counters
+  uint32_t sdaEdges, sclEdges, pinOps, delays;
+
+  // timing, in ns: minimum seen of each I2C parameter
+  uint64_t lastSclRise, lastSclFall, lastSdaChange, lastStart, lastStop;
+  uint64_t tLow, tHigh, period, tSuDat, tHdSta, tSuSta, tSuSto, tBuf;
+  bool started;
+
+  void reset() {
+    masterSda = masterScl = deviceSda = deviceScl = true;
+    sda = scl = true;
+    now = 1000000;
+    stretchUntil = 0;
+    resetStats();
+  }
+
+  void resetStats() {
+    sdaEdges = sclEdges = pinOps = delays = 0;
+    lastSclRise = lastSclFall = lastSdaChange = lastStart = lastStop = 0;
+    tLow = tHigh = period = tSuDat = tHdSta = tSuSta = tSuSto = tBuf =
+        UINT64_MAX;
+    started = false;
+  }
+
+  static void least(uint64_t &slot, uint64_t value) {
+    if (value < slot) slot = value;
+  }
+
+  void settle();
+  void advance(uint64_t ns);
+} bus;
+
+static void deviceStart() {
+  device.note(device.phase == Device::IDLE ? "S" : "Sr");
+  device.phase = Device::RECV;
+  device.bits = 0;
+  device.shift = 0;
+  device.expectAddress = true;
+  device.havePointer = false;
+  bus.deviceSda = true;
+}
+
+static void deviceStop() {
+  device.note("P");
+  device.phase = Device::IDLE;
+  bus.deviceSda = true;
+}
+
+static void deviceLoad() {
+  uint8_t value = device.regs[device.pointer++ & 31];
+  device.note("<%02X", value);
+  device.shift = value;
+  device.bits = 0;
+  device.phase = Device::SEND;
+  bus.deviceSda = value & 0x80;
+}
+
+static void deviceSclRise() {
+  switch (device.phase) {
+    case Device::RECV:
+      device.shift = (device.shift << 1) | bus.sda;
+      device.bits++;
+      break;
+    case Device::SEND:
+      device.bits++;
+      break;
+    case Device::ACK_IN:
+      device.masterAck = !bus.sda;
+      break;
+    default:
+      break;
+  }
+}
+
+static void deviceSclFall() {
+  switch (device.phase) {
+    case Device::RECV:
+      if (device.bits < 8) break;
+      if (device.expectAddress) {
+        device.note("%02X", device.shift);
+        if ((device.shift >> 1) != device.address) {
+          device.note("N");
+          device.phase = Device::IDLE;
+          break;
+        }
+        device.reading = device.shift & 0x01;
+        device.expectAddress = false;
+      } else if (!device.havePointer) {
+        device.pointer = device.shift & 31;
+        device.havePointer = true;
+        device.note("%02X", device.shift);
+      } else {
+        device.regs[device.pointer++ & 31] = device.shift;
+        device.note("%02X", device.shift);
+      }
+      device.note("A");
+      bus.deviceSda = false;
+      device.phase = Device::ACK_OUT;
+      break;
+    case Device::ACK_OUT:
+      bus.deviceSda = true;
+      if (device.stretchNanos) {
+        bus.deviceScl = false;
+        bus.stretchUntil = bus.now + device.stretchNanos;
+      }
+      if (device.reading) {
+        deviceLoad();
+      } else {
+        device.phase = Device::RECV;
+        device.bits = 0;
+      }
+      break;
+    case Device::SEND:
+      if (device.bits == 8) {
+        bus.deviceSda = true;
+        device.phase = Device::ACK_IN;
+      } else {
+        bus.deviceSda = (device.shift << device.bits) & 0x80;
+      }
+      break;
+    case Device::ACK_IN:
+      device.note(device.masterAck ? "A" : "N");
+      if (device.masterAck) {
+        deviceLoad();
+      } else {
+        device.phase = Device::IDLE;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void Bus::settle() {
+  for (;;) {
+    bool newScl = masterScl && deviceScl;
+    bool newSda = masterSda && deviceSda;
+    if (newScl != scl) {
+      scl = newScl;
+      sclEdges++;
+      if (scl) {
+        if (started) {
+          least(tLow, now - lastSclFall);
+          if (lastSclRise) least(period, now - lastSclRise);
+          if (lastSdaChange > lastSclFall) least(tSuDat, now - lastSdaChange);
+        }
+        lastSclRise = now;
+        deviceSclRise();
+      } else {
+        if (started) least(tHigh, now - lastSclRise);
+        if (lastStart > lastSclRise || lastStart == lastSclRise) {
+          least(tHdSta, now - lastStart);
+        }
+        lastSclFall = now;
+        deviceSclFall();
+      }
+    } else if (newSda != sda) {
+      sda = newSda;
+      sdaEdges++;
+      lastSdaChange = now;
+      if (scl) {
+        if (sda) {
+          if (started) least(tSuSto, now - lastSclRise);
+          lastStop = now;
+          deviceStop();
+        } else {
+          if (lastStop) least(tBuf, now - lastStop);
+          if (started && lastSclRise > lastStop) least(tSuSta, now - lastSclRise);
+          lastStart = now;
+          started = true;
+          deviceStart();
+        }
+      }
+    } else {
+      return;
+    }
+  }
+}
+
+void Bus::advance(uint64_t ns) {
+  delays++;
+  uint64_t end = now + ns;
+  if (!deviceScl && stretchUntil <= end) {
+    now = stretchUntil > now ? stretchUntil : now;
+    deviceScl = true;
+    settle();
+  }
+  now = end;
+}
+
+/*
+ * Policies for SimpleWirePolicyInterface
+ */
+
+struct SimPins {
+  static void begin() {}
+  static void end() {}
+  static void dataHigh() { bus.pinOps++; bus.masterSda = true; bus.settle(); }
+  static void dataLow() { bus.pinOps++; bus.masterSda = false; bus.settle(); }
+  static void clockHigh() { bus.pinOps++; bus.masterScl = true; bus.settle(); }
+  static void clockLow() { bus.pinOps++; bus.masterScl = false; bus.settle(); }
+  static uint8_t readData() { bus.pinOps++; return bus.sda; }
+  static uint8_t readClock() { bus.pinOps++; return bus.scl; }
+};
+
+template <uint16_t T_DELAY_NANOS>
+struct SimDelay {
+  static void delay() { bus.advance(T_DELAY_NANOS); }
+};
+
+/*
+ * Arduino core on the same bus, for SimpleWireInterface: OUTPUT pulls the
+ * line LOW (the latch is always LOW), INPUT releases it.
+ */
+
+static const uint8_t SDA_PIN = 21;
+static const uint8_t SCL_PIN = 22;
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  bool release = mode == INPUT;
+  if (pin == SDA_PIN) release ? SimPins::dataHigh() : SimPins::dataLow();
+  if (pin == SCL_PIN) release ? SimPins::clockHigh() : SimPins::clockLow();
+}
+
+void digitalWrite(uint8_t, uint8_t) {
+  bus.pinOps++;
+}
+
+int digitalRead(uint8_t pin) {
+  return pin == SCL_PIN ? SimPins::readClock() : SimPins::readData();
+}
+
+void delayMicroseconds(unsigned int us) {
+  bus.advance(us * 1000ULL);
+}
+
+/*
+ * Tests
+ */
+
+typedef SimpleWirePolicyInterface<SimPins, SimDelay<850> > FastWire;
+typedef SimpleWirePolicyInterface<SimPins, SimDelay<850>, 16> StretchWire;
+
+static void reset() {
+  bus.reset();
+  device.reset();
+}
+
+// Writes 'A' 'B' to registers 5 and 6, then reads them back through a
+// repeated START. Returns the two bytes read.
+template <typename T_WIREI>
+static uint16_t writeThenRead(const T_WIREI &wire) {
+  wire.beginTransmission(0x68);
+  wire.write(0x05);
+  wire.write('A');
+  wire.write('B');
+  wire.endTransmission();
+
+  wire.beginTransmission(0x68);
+  wire.write(0x05);
+  wire.endTransmission(false);
+  uint16_t value = 0;
+  if (wire.requestFrom(0x68, 2) == 2) {
+    value = wire.read() << 8;
+    value |= wire.read();
+  }
+  return value;
+}
+
+static const char kTranscript[] =
+    "S D0 A 05 A 41 A 42 A P S D0 A 05 A Sr D1 A <41 A <42 N P";
+
+static bool fastModeTiming() {
+  return bus.tLow >= 1300 && bus.tHigh >= 600 && bus.period >= 2500
+      && bus.tSuDat >= 100 && bus.tHdSta >= 600 && bus.tSuSta >= 600
+      && bus.tSuSto >= 600 && bus.tBuf >= 1300;
+}
+
+static void test_write_read() {
+  printf("write, repeated START and read decode as sent, within Fast-mode timing\n");
+  reset();
+  FastWire wire;
+  wire.begin();
+
+  CHECK(wire.beginTransmission(0x68) == 0);
+  CHECK(wire.write(0x05) == 1);
+  CHECK(wire.write('A') == 1);
+  CHECK(wire.write('B') == 1);
+  CHECK(wire.endTransmission() == 0);
+  CHECK(device.regs[5] == 'A' && device.regs[6] == 'B');
+
+  wire.beginTransmission(0x68);
+  wire.write(0x05);
+  wire.endTransmission(false);
+  CHECK(wire.requestFrom(0x68, 2) == 2);
+  CHECK(wire.read() == 'A');
+  CHECK(wire.read() == 'B');
+  CHECK(wire.read() == 0xff);
+
+  CHECK(device.log == kTranscript);
+  CHECK(fastModeTiming());
+  CHECK(bus.sda && bus.scl);
+}
+
+static void test_nack() {
+  printf("an absent device NACKs its address\n");
+  reset();
+  FastWire wire;
+  wire.begin();
+  CHECK(wire.beginTransmission(0x50) == 1);
+  wire.endTransmission();
+  CHECK(wire.requestFrom(0x50, 4) == 0);
+  wire.endTransmission();
+  CHECK(device.log == "S A0 N P S A1 N P");
+}
+
+static void test_stretch() {
+  printf("a stretched clock is waited for, or garbles the transfer when ignored\n");
+  reset();
+  device.stretchNanos = 5000;
+  StretchWire stretching;
+  stretching.begin();
+  CHECK(writeThenRead(stretching) == 0x4142);
+  CHECK(device.log == kTranscript);
+  CHECK(fastModeTiming());
+
+  reset();
+  device.stretchNanos = 5000;
+  FastWire ignoring;
+  ignoring.begin();
+  writeThenRead(ignoring);
+  CHECK(device.log != kTranscript);
+}
+
+static void test_stretch_limit() {
+  printf("a clock held past the limit does not hang the master\n");
+  reset();
+  device.stretchNanos = 1000000;
+  StretchWire wire;
+  wire.begin();
+  uint64_t start = bus.now;
+  wire.beginTransmission(0x68);
+  wire.write(0x05);
+  // The address ACK is followed by a stretch, so each clock of the next
+  // byte waits out the limit and the device misses the data byte.
+  CHECK(bus.now - start < 9 * 20 * 850 + 50 * 850);
+  CHECK(device.regs[5] == 0);
+}
+
+static void test_simple_wire_same_bus() {
+  printf("SimpleWireInterface produces the same transcript on the model\n");
+  reset();
+  SimpleWireInterface wire(SDA_PIN, SCL_PIN, 3);
+  wire.begin();
+  CHECK(writeThenRead(wire) == 0x4142);
+  CHECK(device.log == kTranscript);
+}
+
+/*
+ * Benchmark: a 16 byte register write and a 16 byte read
+ */
+
+template <typename T_WIREI>
+static void burst(const char *name, const T_WIREI &wire) {
+  reset();
+  for (int i = 0; i < 32; i++) device.regs[i] = 0x5A ^ (i * 37);
+  wire.begin();
+  bus.resetStats();
+
+  uint64_t start = bus.now;
+  wire.beginTransmission(0x68);
+  wire.write(0x00);
+  for (int i = 0; i < 16; i++) wire.write(0xA5 ^ (i * 29));
+  wire.endTransmission();
+  wire.requestFrom(0x68, 16);
+  for (int i = 0; i < 16; i++) wire.read();
+
+  double bytes = 2 + 17 + 16;  // addresses, pointer and data
+  double us = (bus.now - start) / 1000.0 / bytes;
+  printf("  %-34s %5.1f %5.1f %5.1f %5.1f  %5.1f us  %3.0f kHz   %s\n", name,
+         bus.sdaEdges / bytes, bus.sclEdges / bytes, bus.pinOps / bytes,
+         bus.delays / bytes, us, 1e6 / bus.period,
+         fastModeTiming() ? "yes" : "no");
+}
+
+static void bench() {
+  // Pin operations cost nothing here; on ESP32 each pinMode() call of
+  // SimpleWireInterface reconfigures the pad, which stretches every
+  // transition well beyond its delay.
+  printf("per byte, 16+16 byte burst           SDA   SCL   pin delay"
+         "   time    clock   Fast-mode\n");
+  burst("SimpleWireInterface, 1 us", SimpleWireInterface(SDA_PIN, SCL_PIN, 1));
+  burst("SimpleWireInterface, 2 us", SimpleWireInterface(SDA_PIN, SCL_PIN, 2));
+  burst("SimpleWirePolicyInterface, 850 ns", FastWire());
+  burst("  with stretching", StretchWire());
+  burst("SimpleWirePolicyInterface, 4 us",
+        SimpleWirePolicyInterface<SimPins, SimDelay<4000> >());
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    bench();
+    return 0;
+  }
+
+  test_write_read();
+  test_nack();
+  test_stretch();
+  test_stretch_limit();
+  test_simple_wire_same_bus();
+
+  return test_summary();
+}
@@ -0,0 +1,506 @@
+#include "Adafruit_I2CBus.h"
+
+// The queues are shared with the submitting tasks; the wire itself is
+// guarded separately by lock(), which code outside the bus also takes
+#ifdef I2CBUS_RTOS
+#define QUEUE_LOCK() portENTER_CRITICAL(&_mux)
+#define QUEUE_UNLOCK() portEXIT_CRITICAL(&_mux)
+#else
+#define QUEUE_LOCK()
+#define QUEUE_UNLOCK()
+#endif
+
+/*!
+ *    @brief  Create an empty transfer
+ */
+Adafruit_I2CTransfer::Adafruit_I2CTransfer() {
+  priority = I2C_PRIORITY_NORMAL;
+  callback = nullptr;
+  context = nullptr;
+  queued = 0;
+  latency = 0;
+  _device = nullptr;
+  _prefix = nullptr;
+  _prefixLen = 0;
+  _wbuf = nullptr;
+  _wlen = 0;
+  _rbuf = nullptr;
+  _rlen = 0;
+  _reg = 0;
+  _mergeable = false;
+  _stop = false;
+  _state = IDLE;
+  _next = nullptr;
+#ifdef I2CBUS_RTOS
+  _waiter = NULL;
+#endif
+}
+
+void Adafruit_I2CTransfer::set(Adafruit_I2CDevice *device,
+                               const uint8_t *write_buffer, size_t write_len,
+                               uint8_t *read_buffer, size_t read_len) {
+  _device = device;
+  _prefix = nullptr;
+  _prefixLen = 0;
+  _wbuf = write_buffer;
+  _wlen = write_len;
+  _rbuf = read_buffer;
+  _rlen = read_len;
+  _mergeable = false;
+  _stop = false;
+}
+
+/*!
+ *    @brief  Set up a write. Cannot be more than maxBufferSize() bytes,
+ *    prefix included.
+ *    @param  device The device to write to
+ *    @param  buffer Data to write
+ *    @param  len Number of bytes from buffer to write
+ *    @param  prefix_buffer Optional data to write before buffer, usually a
+ *    register address
+ *    @param  prefix_len Number of bytes from prefix_buffer to write
+ */
+void Adafruit_I2CTransfer::write(Adafruit_I2CDevice *device,
+                                 const uint8_t *buffer, size_t len,
+                                 const uint8_t *prefix_buffer,
+                                 size_t prefix_len) {
+  set(device, buffer, len, nullptr, 0);
+  _prefix = prefix_buffer;
+  _prefixLen = prefix_buffer ? prefix_len : 0;
+}
+
+/*!
+ *    @brief  Set up a read
+ *    @param  device The device to read from
+ *    @param  buffer Buffer to read into
+ *    @param  len Number of bytes to read
+ */
+void Adafruit_I2CTransfer::read(Adafruit_I2CDevice *device, uint8_t *buffer,
+                                size_t len) {
+  set(device, nullptr, 0, buffer, len);
+}
+
+/*!
+ *    @brief  Set up a write followed by a read, with a repeated start
+ *    @param  device The device to talk to
+ *    @param  write_buffer Data to write
+ *    @param  write_len Number of bytes from write_buffer to write
+ *    @param  read_buffer Buffer to read into
+ *    @param  read_len Number of bytes to read
+ *    @param  stop Whether to send a stop between the write and the read
+ */
+void Adafruit_I2CTransfer::writeThenRead(Adafruit_I2CDevice *device,
+                                         const uint8_t *write_buffer,
+                                         size_t write_len,
+                                         uint8_t *read_buffer,
+                                         size_t read_len, bool stop) {
+  set(device, write_buffer, write_len, read_buffer, read_len);
+  _stop = stop;
+}
+
+/*!
+ *    @brief  Set up a read of consecutive registers, for devices with a one
+ *    byte register address that auto-increments while reading (DS1307,
+ *    DS3231, PCF8523, MCP23017 in its default sequential mode, most
+ *    sensors). The bus may serve it from a merged read.
+ *    @param  device The device to read from
+ *    @param  reg First register
+ *    @param  buffer Buffer to read into
+ *    @param  len Number of registers to read
+ */
+void Adafruit_I2CTransfer::readRegisters(Adafruit_I2CDevice *device,
+                                         uint8_t reg, uint8_t *buffer,
+                                         size_t len) {
+  _reg = reg;
+  set(device, &_reg, 1, buffer, len);
+  _mergeable = true;
+}
+
+/*!
+ *    @brief  Create a bus manager
+ *    @param  theWire The I2C bus to manage, defaults to &Wire
+ */
+Adafruit_I2CBus::Adafruit_I2CBus(TwoWire *theWire) {
+  _wire = theWire;
+  for (uint8_t p = 0; p < I2C_PRIORITIES; p++) {
+    _head[p] = nullptr;
+    _tail[p] = nullptr;
+  }
+  memset(_present, 0, sizeof(_present));
+  _scanned = false;
+  resetStats();
+#ifdef I2CBUS_RTOS
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+  _mux = mux;
+  _mutex = NULL;
+  _task = NULL;
+#endif
+}
+
+/*!
+ *    @brief  Start running queued transfers in the background. The sketch
+ *    still calls Wire.begin() with its pins; the bus never does.
+ *    @param  taskPriority FreeRTOS priority of the worker task, on ESP32
+ *    @param  core Core to pin the worker to, -1 for either
+ *    @return True if the worker is running, or there is no need for one
+ */
+bool Adafruit_I2CBus::begin(uint8_t taskPriority, int core) {
+#ifdef I2CBUS_RTOS
+  if (!_mutex) {
+    _mutex = xSemaphoreCreateRecursiveMutex();
+    if (!_mutex)
+      return false;
+  }
+  if (!_task) {
+    BaseType_t affinity = core < 0 ? tskNO_AFFINITY : core;
+    if (xTaskCreatePinnedToCore(worker, "i2cbus", 3072, this, taskPriority,
+                                &_task, affinity) != pdPASS) {
+      _task = NULL;
+      return false;
+    }
+  }
+#else
+  (void)taskPriority;
+  (void)core;
+#endif
+  return true;
+}
+
+#ifdef I2CBUS_RTOS
+void Adafruit_I2CBus::worker(void *arg) {
+  Adafruit_I2CBus *bus = (Adafruit_I2CBus *)arg;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (bus->poll())
+      ;
+  }
+}
+#endif
+
+/*!
+ *    @brief  Queue a transfer and return at once
+ *    @param  transfer The transfer, which must not be busy
+ *    @return True if queued
+ */
+bool Adafruit_I2CBus::submit(Adafruit_I2CTransfer *transfer) {
+  if (!transfer || !transfer->_device || transfer->busy())
+    return false;
+  if (transfer->priority >= I2C_PRIORITIES)
+    transfer->priority = I2C_PRIORITY_LOW;
+
+  uint8_t p = transfer->priority;
+  transfer->queued = micros();
+  transfer->_next = nullptr;
+  transfer->_state = Adafruit_I2CTransfer::QUEUED;
+
+  QUEUE_LOCK();
+  if (_tail[p])
+    _tail[p]->_next = transfer;
+  else
+    _head[p] = transfer;
+  _tail[p] = transfer;
+  QUEUE_UNLOCK();
+
+#ifdef I2CBUS_RTOS
+  if (_task)
+    xTaskNotifyGive(_task);
+#endif
+  return true;
+}
+
+/*!
+ *    @brief  Queue a transfer and wait for it, like the synchronous
+ *    Adafruit_I2CDevice calls but in priority order with everyone else
+ *    @param  transfer The transfer, which must not be busy
+ *    @return True if the transfer completed and the device acked it
+ */
+bool Adafruit_I2CBus::transfer(Adafruit_I2CTransfer *transfer) {
+#ifdef I2CBUS_RTOS
+  if (_task && xTaskGetCurrentTaskHandle() != _task) {
+    StaticSemaphore_t storage;
+    SemaphoreHandle_t done = xSemaphoreCreateBinaryStatic(&storage);
+    transfer->_waiter = done;
+    if (!submit(transfer)) {
+      transfer->_waiter = NULL;
+      return false;
+    }
+    // complete() gives it exactly once, so the semaphore on this stack
+    // is not touched after we return
+    xSemaphoreTake(done, portMAX_DELAY);
+    return transfer->ok();
+  }
+#endif
+  if (!submit(transfer))
+    return false;
+  while (transfer->busy() && poll())
+    ;
+  return transfer->ok();
+}
+
+/*!
+ *    @brief  Run the next transaction, if any. Call from loop() when
+ *    there is no worker task.
+ *    @return True if a transaction ran
+ */
+bool Adafruit_I2CBus::poll(void) {
+  Adafruit_I2CTransfer *batch = take();
+  if (!batch)
+    return false;
+
+  lock();
+  uint32_t start = micros();
+  bool ok = run(batch);
+  _busy += micros() - start;
+  unlock();
+  _transactions++;
+
+  // A callback may submit its transfer again, which relinks it
+  while (batch) {
+    Adafruit_I2CTransfer *next = batch->_next;
+    complete(batch, ok);
+    batch = next;
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Take the wire for direct Wire calls, waiting for the
+ *    transaction in progress. Recursive. Only needed on ESP32.
+ */
+void Adafruit_I2CBus::lock(void) {
+#ifdef I2CBUS_RTOS
+  if (_mutex)
+    xSemaphoreTakeRecursive(_mutex, portMAX_DELAY);
+#endif
+}
+
+/*!
+ *    @brief  Release the wire after lock()
+ */
+void Adafruit_I2CBus::unlock(void) {
+#ifdef I2CBUS_RTOS
+  if (_mutex)
+    xSemaphoreGiveRecursive(_mutex);
+#endif
+}
+
+void Adafruit_I2CBus::unlink(uint8_t priority, Adafruit_I2CTransfer *prev,
+                             Adafruit_I2CTransfer *t) {
+  if (prev)
+    prev->_next = t->_next;
+  else
+    _head[priority] = t->_next;
+  if (_tail[priority] == t)
+    _tail[priority] = prev;
+  t->_next = nullptr;
+}
+
+// Dequeues the highest priority transfer and, if it is a register read,
+// every queued read of the same device it can be merged with. Returns
+// them chained through _next.
+Adafruit_I2CTransfer *Adafruit_I2CBus::take(void) {
+  QUEUE_LOCK();
+  Adafruit_I2CTransfer *head = nullptr;
+  for (uint8_t p = 0; p < I2C_PRIORITIES && !head; p++) {
+    if (_head[p]) {
+      head = _head[p];
+      unlink(p, nullptr, head);
+    }
+  }
+  if (!head) {
+    QUEUE_UNLOCK();
+    return nullptr;
+  }
+  head->_state = Adafruit_I2CTransfer::RUNNING;
+
+  if (head->_mergeable) {
+    uint8_t addr = head->_device->address();
+    unsigned lo = head->_reg, hi = lo + head->_rlen;
+    Adafruit_I2CTransfer *last = head;
+    bool grew = true;
+
+    // A merge widens the range, which may reach reads passed over before
+    while (grew) {
+      grew = false;
+      for (uint8_t p = 0; p < I2C_PRIORITIES; p++) {
+        Adafruit_I2CTransfer *prev = nullptr, *t = _head[p];
+        while (t) {
+          Adafruit_I2CTransfer *next = t->_next;
+          if (t->_device->address() == addr) {
+            // Reads queued behind anything else for this device stay
+            // behind it
+            if (!t->_mergeable)
+              break;
+            unsigned tlo = t->_reg, thi = tlo + t->_rlen;
+            unsigned nlo = tlo < lo ? tlo : lo, nhi = thi > hi ? thi : hi;
+            if (tlo <= hi && thi >= lo && nhi - nlo <= I2CBUS_MERGE_MAX) {
+              unlink(p, prev, t);
+              t->_state = Adafruit_I2CTransfer::RUNNING;
+              last->_next = t;
+              last = t;
+              lo = nlo;
+              hi = nhi;
+              _merged++;
+              grew = true;
+              t = next;
+              continue;
+            }
+          }
+          prev = t;
+          t = next;
+        }
+      }
+    }
+  }
+  QUEUE_UNLOCK();
+  return head;
+}
+
+// Talks to the device through its unrouted calls: the routed ones would
+// queue the transfer here again
+bool Adafruit_I2CBus::run(Adafruit_I2CTransfer *batch) {
+  Adafruit_I2CDevice *dev = batch->_device;
+
+  if (!batch->_next) {
+    if (batch->_mergeable)
+      return dev->_write_then_read(&batch->_reg, 1, batch->_rbuf,
+                                   batch->_rlen, false);
+    if (batch->_wlen && batch->_rlen)
+      return dev->_write_then_read(batch->_wbuf, batch->_wlen, batch->_rbuf,
+                                   batch->_rlen, batch->_stop);
+    if (batch->_wlen || batch->_prefixLen)
+      return dev->_write(batch->_wbuf, batch->_wlen, true, batch->_prefix,
+                         batch->_prefixLen);
+    return dev->_read(batch->_rbuf, batch->_rlen, true);
+  }
+
+  // Merged register reads: one read covering all of them
+  unsigned lo = batch->_reg, hi = lo + batch->_rlen;
+  for (Adafruit_I2CTransfer *t = batch->_next; t; t = t->_next) {
+    if (t->_reg < lo)
+      lo = t->_reg;
+    if (t->_reg + t->_rlen > hi)
+      hi = t->_reg + t->_rlen;
+  }
+  uint8_t reg = lo;
+  if (!dev->_write_then_read(&reg, 1, _scratch, hi - lo, false))
+    return false;
+  for (Adafruit_I2CTransfer *t = batch; t; t = t->_next)
+    memcpy(t->_rbuf, _scratch + (t->_reg - lo), t->_rlen);
+  return true;
+}
+
+void Adafruit_I2CBus::complete(Adafruit_I2CTransfer *t, bool ok) {
+  t->latency = micros() - t->queued;
+  if (t->latency > _maxLatency[t->priority])
+    _maxLatency[t->priority] = t->latency;
+#ifdef I2CBUS_RTOS
+  SemaphoreHandle_t waiter = t->_waiter;
+  t->_waiter = NULL;
+#endif
+  t->_state = ok ? Adafruit_I2CTransfer::DONE : Adafruit_I2CTransfer::FAILED;
+  if (t->callback)
+    t->callback(t, ok);
+#ifdef I2CBUS_RTOS
+  if (waiter)
+    xSemaphoreGive(waiter);
+#endif
+}
+
+/*!
+ *    @brief  Clear the transaction counters and latency maxima
+ */
+void Adafruit_I2CBus::resetStats(void) {
+  _transactions = 0;
+  _merged = 0;
+  _busy = 0;
+  for (uint8_t p = 0; p < I2C_PRIORITIES; p++)
+    _maxLatency[p] = 0;
+}
+
+bool Adafruit_I2CBus::probe(uint8_t addr) {
+  _wire->beginTransmission(addr);
+#ifdef ARDUINO_ARCH_MBED
+  _wire->write(0); // forces a write request instead of a read
+#endif
+  return _wire->endTransmission() == 0;
+}
+
+/*!
+ *    @brief  Find the devices on the bus. Only the first call probes the
+ *    bus; later ones return the cached result.
+ *    @param  force Probe again, e.g. after plugging in a device
+ *    @return Number of devices that acked
+ */
+uint8_t Adafruit_I2CBus::scan(bool force) {
+  if (force || !_scanned) {
+    memset(_present, 0, sizeof(_present));
+    lock();
+    // 0x00-0x07 and 0x78-0x7F are reserved
+    for (uint8_t addr = 0x08; addr <= 0x77; addr++) {
+      if (probe(addr))
+        _present[addr >> 3] |= 1 << (addr & 7);
+    }
+    unlock();
+    _scanned = true;
+  }
+
+  uint8_t count = 0;
+  for (uint8_t addr = next(); addr; addr = next(addr))
+    count++;
+  return count;
+}
+
+/*!
+ *    @brief  Whether a device acked its address in the scan
+ *    @param  addr The 7-bit I2C address
+ *    @return True if present, scanning first if needed
+ */
+bool Adafruit_I2CBus::present(uint8_t addr) {
+  if (!_scanned)
+    scan();
+  return addr < 0x80 && (_present[addr >> 3] & (1 << (addr & 7)));
+}
+
+/*!
+ *    @brief  The first of several candidate addresses with a device on it.
+ *    Answered from the scan if there was one; otherwise only the
+ *    candidates are probed, up to the first that acks, and nothing is
+ *    cached.
+ *    @param  candidates Addresses to try, in order of preference
+ *    @param  count Number of candidates
+ *    @return The address found, or 0 if none
+ */
+uint8_t Adafruit_I2CBus::find(const uint8_t *candidates, size_t count) {
+  if (_scanned) {
+    for (size_t i = 0; i < count; i++) {
+      if (present(candidates[i]))
+        return candidates[i];
+    }
+    return 0;
+  }
+
+  uint8_t found = 0;
+  lock();
+  for (size_t i = 0; i < count && !found; i++) {
+    if (candidates[i] < 0x80 && probe(candidates[i]))
+      found = candidates[i];
+  }
+  unlock();
+  return found;
+}
+
+/*!
+ *    @brief  Walk the devices found in the scan, in address order
+ *    @param  after The previous address returned, 0 to start
+ *    @return The next address with a device, or 0 after the last one
+ */
+uint8_t Adafruit_I2CBus::next(uint8_t after) {
+  if (!_scanned)
+    scan();
+  for (uint8_t addr = after + 1; addr < 0x80; addr++) {
+    if (_present[addr >> 3] & (1 << (addr & 7)))
+      return addr;
+  }
+  return 0;
+}
@@ -0,0 +1,176 @@
+#ifndef Adafruit_I2CBus_h
+#define Adafruit_I2CBus_h
+
+#include "Adafruit_I2CDevice.h"
+
+#if defined(ESP32) || defined(ESP_PLATFORM)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#define I2CBUS_RTOS 1 ///< Transfers run on a worker task
+#endif
+
+/*! Largest merged register read, in bytes. Reads are only merged while
+ * the combined range fits, so this also bounds the bus time one merged
+ * read can hold off a higher priority transfer. */
+#ifndef I2CBUS_MERGE_MAX
+#define I2CBUS_MERGE_MAX 32
+#endif
+
+/*! Transfer priorities, highest first */
+typedef enum {
+  I2C_PRIORITY_HIGH = 0, ///< Clocks, IO expanders: anything timing critical
+  I2C_PRIORITY_NORMAL,   ///< Sensors
+  I2C_PRIORITY_LOW,      ///< Displays and other bulk writes
+  I2C_PRIORITIES
+} i2c_priority_t;
+
+class Adafruit_I2CBus;
+
+/*!
+ * @brief One queued I2C transaction on an Adafruit_I2CDevice. The caller
+ * owns it and keeps it, and its buffers, alive until it completes: the
+ * bus links transfers into its queues and never allocates.
+ */
+class Adafruit_I2CTransfer {
+public:
+  Adafruit_I2CTransfer();
+
+  void write(Adafruit_I2CDevice *device, const uint8_t *buffer, size_t len,
+             const uint8_t *prefix_buffer = nullptr, size_t prefix_len = 0);
+  void read(Adafruit_I2CDevice *device, uint8_t *buffer, size_t len);
+  void writeThenRead(Adafruit_I2CDevice *device, const uint8_t *write_buffer,
+                     size_t write_len, uint8_t *read_buffer, size_t read_len,
+                     bool stop = false);
+  void readRegisters(Adafruit_I2CDevice *device, uint8_t reg, uint8_t *buffer,
+                     size_t len);
+
+  /*! @brief  Whether the transfer is queued or on the bus
+   *  @return True until it completes */
+  bool busy(void) const { return _state == QUEUED || _state == RUNNING; }
+  /*! @brief  Whether the transfer completed and the device acked it
+   *  @return True on success */
+  bool ok(void) const { return _state == DONE; }
+
+  uint8_t priority; ///< One of i2c_priority_t, I2C_PRIORITY_NORMAL by default
+  /*! Called from the context running the bus once the transfer is done */
+  void (*callback)(Adafruit_I2CTransfer *transfer, bool ok);
+  void *context;    ///< For the callback's use
+  uint32_t queued;  ///< micros() when submitted
+  uint32_t latency; ///< Microseconds from submit to completion
+
+private:
+  friend class Adafruit_I2CBus;
+
+  enum { IDLE, QUEUED, RUNNING, DONE, FAILED };
+
+  void set(Adafruit_I2CDevice *device, const uint8_t *write_buffer,
+           size_t write_len, uint8_t *read_buffer, size_t read_len);
+
+  Adafruit_I2CDevice *_device;
+  const uint8_t *_prefix;
+  size_t _prefixLen;
+  const uint8_t *_wbuf;
+  size_t _wlen;
+  uint8_t *_rbuf;
+  size_t _rlen;
+  uint8_t _reg;           // register, for reads that may be merged
+  bool _mergeable;        // a register read on an auto-incrementing device
+  bool _stop;             // stop instead of a repeated start before a read
+  volatile uint8_t _state;
+  Adafruit_I2CTransfer *_next;
+#ifdef I2CBUS_RTOS
+  TaskHandle_t _waiter;
+#endif
+};
+
+/*!
+ * @brief Arbitrates one TwoWire between the libraries sharing it.
+ *
+ * Clients submit Adafruit_I2CTransfers, or attach their
+ * Adafruit_I2CDevice with setBus() so its read(), write() and
+ * write_then_read() queue here and wait. The bus runs transfers one at a
+ * time, highest priority first and in submission order within a priority.
+ * Register reads of the same device whose ranges touch or overlap are
+ * merged into one write-then-read, so several clients polling an RTC or
+ * an expander cost one transaction. A transfer already on the wire is
+ * never interrupted: a high priority transfer waits at most for one
+ * lower priority transaction.
+ *
+ * On ESP32 a worker task runs the queue once begin() is called; a
+ * synchronous call waits for the worker. Elsewhere, or before begin(),
+ * the caller runs the queue itself, and poll() from loop() runs what was
+ * submitted asynchronously. Code that still drives Wire directly takes
+ * lock() around it.
+ *
+ * The bus also keeps the result of the device scan, so address detection
+ * after the first scan() costs no bus time.
+ *
+ * There is no global instance: the sketch owns one per TwoWire, so boards
+ * that never share a bus pay nothing for it.
+ */
+class Adafruit_I2CBus {
+public:
+  Adafruit_I2CBus(TwoWire *theWire = &Wire);
+
+  bool begin(uint8_t taskPriority = 2, int core = -1);
+
+  bool submit(Adafruit_I2CTransfer *transfer);
+  bool transfer(Adafruit_I2CTransfer *transfer);
+  bool poll(void);
+
+  void lock(void);
+  void unlock(void);
+
+  uint8_t scan(bool force = false);
+  bool present(uint8_t addr);
+  uint8_t find(const uint8_t *candidates, size_t count);
+  uint8_t next(uint8_t after = 0);
+
+  /*! @brief  Transactions put on the wire, merged ones counted once
+   *  @return Count since begin */
+  uint32_t transactions(void) const { return _transactions; }
+  /*! @brief  Transfers that rode along with another one's read
+   *  @return Count since begin */
+  uint32_t merged(void) const { return _merged; }
+  /*! @brief  Time spent on the wire running transfers
+   *  @return Microseconds since begin */
+  uint32_t busyMicros(void) const { return _busy; }
+  /*! @brief  Worst submit-to-completion time seen at a priority
+   *  @param  priority One of i2c_priority_t
+   *  @return Microseconds */
+  uint32_t maxLatency(uint8_t priority) const {
+    return priority < I2C_PRIORITIES ? _maxLatency[priority] : 0;
+  }
+  void resetStats(void);
+
+private:
+  Adafruit_I2CTransfer *take(void);
+  void unlink(uint8_t priority, Adafruit_I2CTransfer *prev,
+              Adafruit_I2CTransfer *t);
+  bool run(Adafruit_I2CTransfer *batch);
+  void complete(Adafruit_I2CTransfer *t, bool ok);
+  bool probe(uint8_t addr);
+
+  TwoWire *_wire;
+  Adafruit_I2CTransfer *_head[I2C_PRIORITIES];
+  Adafruit_I2CTransfer *_tail[I2C_PRIORITIES];
+  uint8_t _scratch[I2CBUS_MERGE_MAX];
+
+  uint8_t _present[16]; // one bit per 7-bit address
+  bool _scanned;
+
+  uint32_t _transactions;
+  uint32_t _merged;
+  uint32_t _busy;
+  uint32_t _maxLatency[I2C_PRIORITIES];
+
+#ifdef I2CBUS_RTOS
+  static void worker(void *arg);
+  SemaphoreHandle_t _mutex;
+  portMUX_TYPE _mux;
+  TaskHandle_t _task;
+#endif
+};
+
+#endif // Adafruit_I2CBus_h
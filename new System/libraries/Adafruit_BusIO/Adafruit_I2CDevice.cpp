@@ -1,4 +1,5 @@
 #include "Adafruit_I2CDevice.h"
+#include "Adafruit_I2CBus.h"
 
 // #define DEBUG_SERIAL Serial
 
@@ -11,6 +12,9 @@ Adafruit_I2CDevice::Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire) {
   _addr = addr;
   _wire = theWire;
   _begun = false;
+  _bus = nullptr;
+  _priority = I2C_PRIORITY_NORMAL;
+  _registerReads = false;
 #ifdef ARDUINO_ARCH_SAMD
   _maxBufferSize = 250; // as defined in Wire.h's RingBuffer
 #elif defined(ESP32)
@@ -66,6 +70,8 @@ bool Adafruit_I2CDevice::detected(void) {
   }
 
   // A basic scanner, see if it ACK's
+  if (_bus)
+    _bus->lock();
   _wire->beginTransmission(_addr);
 #ifdef DEBUG_SERIAL
   DEBUG_SERIAL.print(F("Address 0x"));
@@ -74,7 +80,10 @@ bool Adafruit_I2CDevice::detected(void) {
 #ifdef ARDUINO_ARCH_MBED
   _wire->write(0); // forces a write request instead of a read
 #endif
-  if (_wire->endTransmission() == 0) {
+  bool acked = _wire->endTransmission() == 0;
+  if (_bus)
+    _bus->unlock();
+  if (acked) {
 #ifdef DEBUG_SERIAL
     DEBUG_SERIAL.println(F(" Detected"));
 #endif
@@ -102,6 +111,27 @@ bool Adafruit_I2CDevice::detected(void) {
 bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
                                const uint8_t *prefix_buffer,
                                size_t prefix_len) {
+  if (!_bus)
+    return _write(buffer, len, stop, prefix_buffer, prefix_len);
+
+  if (!stop) {
+    // The caller's next call continues this transaction, so it cannot
+    // wait its turn in the queue: hold the wire like direct Wire code
+    _bus->lock();
+    bool ok = _write(buffer, len, stop, prefix_buffer, prefix_len);
+    _bus->unlock();
+    return ok;
+  }
+
+  Adafruit_I2CTransfer transfer;
+  transfer.write(this, buffer, len, prefix_buffer, prefix_len);
+  transfer.priority = _priority;
+  return _bus->transfer(&transfer);
+}
+
+bool Adafruit_I2CDevice::_write(const uint8_t *buffer, size_t len, bool stop,
+                                const uint8_t *prefix_buffer,
+                                size_t prefix_len) {
   if ((len + prefix_len) > maxBufferSize()) {
     // currently not guaranteed to work if more than 32 bytes!
     // we will need to find out if some platforms have larger
@@ -181,19 +211,35 @@ bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
  *    @return True if read was successful, otherwise false.
  */
 bool Adafruit_I2CDevice::read(uint8_t *buffer, size_t len, bool stop) {
+  if (!_bus || !stop) {
+    if (_bus)
+      _bus->lock();
+    bool ok = _read(buffer, len, stop);
+    if (_bus)
+      _bus->unlock();
+    return ok;
+  }
+
+  Adafruit_I2CTransfer transfer;
+  transfer.read(this, buffer, len);
+  transfer.priority = _priority;
+  return _bus->transfer(&transfer);
+}
+
+bool Adafruit_I2CDevice::_read(uint8_t *buffer, size_t len, bool stop) {
   size_t pos = 0;
   while (pos < len) {
     size_t read_len =
         ((len - pos) > maxBufferSize()) ? maxBufferSize() : (len - pos);
     bool read_stop = (pos < (len - read_len)) ? false : stop;
-    if (!_read(buffer + pos, read_len, read_stop))
+    if (!_readChunk(buffer + pos, read_len, read_stop))
       return false;
     pos += read_len;
   }
   return true;
 }
 
-bool Adafruit_I2CDevice::_read(uint8_t *buffer, size_t len, bool stop) {
+bool Adafruit_I2CDevice::_readChunk(uint8_t *buffer, size_t len, bool stop) {
 #if defined(TinyWireM_h)
   size_t recv = _wire->requestFrom((uint8_t)_addr, (uint8_t)len);
 #elif defined(ARDUINO_ARCH_MEGAAVR)
@@ -247,11 +293,50 @@ bool Adafruit_I2CDevice::_read(uint8_t *buffer, size_t len, bool stop) {
 bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer,
                                          size_t write_len, uint8_t *read_buffer,
                                          size_t read_len, bool stop) {
-  if (!write(write_buffer, write_len, stop)) {
+  if (!_bus)
+    return _write_then_read(write_buffer, write_len, read_buffer, read_len,
+                            stop);
+
+  Adafruit_I2CTransfer transfer;
+  if (_registerReads && write_len == 1 && !stop)
+    transfer.readRegisters(this, write_buffer[0], read_buffer, read_len);
+  else
+    transfer.writeThenRead(this, write_buffer, write_len, read_buffer,
+                           read_len, stop);
+  transfer.priority = _priority;
+  return _bus->transfer(&transfer);
+}
+
+bool Adafruit_I2CDevice::_write_then_read(const uint8_t *write_buffer,
+                                          size_t write_len,
+                                          uint8_t *read_buffer,
+                                          size_t read_len, bool stop) {
+  if (!_write(write_buffer, write_len, stop, nullptr, 0)) {
     return false;
   }
 
-  return read(read_buffer, read_len);
+  return _read(read_buffer, read_len, true);
+}
+
+/*!
+ *    @brief  Send this device's read(), write() and write_then_read() through
+ *    a bus manager, queued with the other devices on it, instead of driving
+ *    TwoWire directly. Each call still returns when its transfer is done.
+ *    Call it after begin(). A read() or write() without a stop leaves the
+ *    transaction open for the next call, so it bypasses the queue and only
+ *    holds the wire while it runs.
+ *    @param  bus The bus manager for this device's TwoWire, or nullptr to
+ *    drive TwoWire directly again
+ *    @param  priority One of i2c_priority_t
+ *    @param  registerReads True if the device takes a one byte register
+ *    address and auto-increments it while reading. Its one byte
+ *    write_then_read()s are then register reads, which the bus may merge.
+ */
+void Adafruit_I2CDevice::setBus(Adafruit_I2CBus *bus, uint8_t priority,
+                                bool registerReads) {
+  _bus = bus;
+  _priority = priority;
+  _registerReads = registerReads;
 }
 
 /*!
@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include <Wire.h>
 
+class Adafruit_I2CBus;
+
 ///< The class which defines how we will talk to this device over I2C
 class Adafruit_I2CDevice {
 public:
@@ -21,16 +23,34 @@ public:
                        bool stop = false);
   bool setSpeed(uint32_t desiredclk);
 
+  void setBus(Adafruit_I2CBus *bus, uint8_t priority,
+              bool registerReads = false);
+  /*!   @brief  The bus manager this device's transfers queue on
+   *    @return The bus, or nullptr if the device drives its TwoWire itself */
+  Adafruit_I2CBus *bus(void) { return _bus; }
+
   /*!   @brief  How many bytes we can read in a transaction
    *    @return The size of the Wire receive/transmit buffer */
   size_t maxBufferSize() { return _maxBufferSize; }
 
 private:
+  friend class Adafruit_I2CBus;
+
   uint8_t _addr;
   TwoWire *_wire;
   bool _begun;
   size_t _maxBufferSize;
+  Adafruit_I2CBus *_bus;
+  uint8_t _priority;
+  bool _registerReads;
+
+  // The transfers themselves, which the bus runs
+  bool _write(const uint8_t *buffer, size_t len, bool stop,
+              const uint8_t *prefix_buffer, size_t prefix_len);
   bool _read(uint8_t *buffer, size_t len, bool stop);
+  bool _readChunk(uint8_t *buffer, size_t len, bool stop);
+  bool _write_then_read(const uint8_t *write_buffer, size_t write_len,
+                        uint8_t *read_buffer, size_t read_len, bool stop);
 };
 
 #endif // Adafruit_I2CDevice_h
@@ -0,0 +1,582 @@
+/*
+ * Adafruit_I2CBus on a simulated 400 kHz bus with an RDTRC board's
+ * devices: a DS3231 and its EEPROM, an MCP23017 and a PCF8574 LCD.
+ * Tests ordering, read merging, failures, devices routed through the bus
+ * with setBus() and the scan cache; the bench compares bus use and the
+ * worst high priority latency with every library driving Wire in turn.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -I../../test -I. -Itest/host test/bus_sim.cpp Adafruit_I2CBus.cpp Adafruit_I2CDevice.cpp -o bus_sim
+ *   ./bus_sim          # tests
+ *   ./bus_sim bench    # utilization and latency over a simulated minute
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include "Adafruit_I2CBus.h"
+#include "host_test.h"
+
+/*
+ * Bus and devices. Time advances by the bit times of what goes on the
+ * wire: start and address 10 bits, 9 per data byte, 1 for the stop.
+ */
+
+static const double BUS_HZ = 400000;
+static double now_us;
+static uint32_t starts, probes, bytesMoved;
+
+unsigned long micros(void) {
+  return (unsigned long)now_us;
+}
+
+static void bits(double n) {
+  now_us += n * 1e6 / BUS_HZ;
+}
+
+struct Device {
+  uint8_t addr;
+  uint8_t regs[32];
+  uint8_t size;     // registers, 0 for a plain port like the PCF8574
+  uint8_t pointer;
+  uint32_t writes;
+
+  Device(uint8_t a, uint8_t n) : addr(a), size(n), pointer(0), writes(0) {
+    for (int i = 0; i < 32; i++) regs[i] = 0xA0 + i;
+  }
+  void write(const uint8_t *data, size_t len) {
+    writes++;
+    if (!size || !len) return;
+    pointer = data[0];
+    for (size_t i = 1; i < len; i++) regs[pointer++ % size] = data[i];
+  }
+  uint8_t read() {
+    return size ? regs[pointer++ % size] : 0xFF;
+  }
+};
+
+static Device rtc(0x68, 19), eeprom(0x57, 32), mcp(0x20, 22), lcd(0x27, 0);
+static Device *devices[] = { &rtc, &eeprom, &mcp, &lcd };
+
+static Device *find(uint8_t addr) {
+  for (Device *d : devices)
+    if (d->addr == addr) return d;
+  return nullptr;
+}
+
+TwoWire Wire;
+
+static uint8_t txAddr, txBuf[256], rxBuf[256];
+static size_t txLen, rxLen, rxPos;
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddr = address;
+  txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLen == sizeof(txBuf)) return 0;
+  txBuf[txLen++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n])) n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+  Device *d = find(txAddr);
+  starts++;
+  if (txLen == 0) probes++;
+  if (!d) {
+    bits(10 + 1);  // address nacked, stop
+    return 2;
+  }
+  bits(10 + 9 * txLen + (stop ? 1 : 0));
+  bytesMoved += txLen;
+  d->write(txBuf, txLen);
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t len, uint8_t stop) {
+  Device *d = find(address);
+  starts++;
+  if (!d) {
+    bits(10 + 1);
+    return 0;
+  }
+  bits(10 + 9 * len + (stop ? 1 : 0));
+  bytesMoved += len;
+  for (rxLen = 0; rxLen < len; rxLen++) rxBuf[rxLen] = d->read();
+  rxPos = 0;
+  return len;
+}
+
+int TwoWire::available() {
+  return rxLen - rxPos;
+}
+
+int TwoWire::read() {
+  return rxPos < rxLen ? rxBuf[rxPos++] : -1;
+}
+
+static void resetBus() {
+  now_us = 0;
+  starts = probes = bytesMoved = 0;
+}
+
+/*
+ * Tests
+ */
+
+static Adafruit_I2CDevice rtcDev(0x68), mcpDev(0x20), lcdDev(0x27),
+    ghostDev(0x50);
+
+static std::vector<Adafruit_I2CTransfer *> order;
+
+static void record(Adafruit_I2CTransfer *t, bool) {
+  order.push_back(t);
+}
+
+static void test_priority_order() {
+  printf("highest priority first, submission order within a priority\n");
+  Adafruit_I2CBus bus;
+  static const uint8_t page[4] = { 0x08, 0x0C, 0x08, 0x08 };
+  uint8_t buf[3][1];
+  Adafruit_I2CTransfer low1, low2, normal, high;
+
+  low1.write(&lcdDev, page, sizeof(page));
+  low1.priority = I2C_PRIORITY_LOW;
+  low2 = low1;
+  normal.readRegisters(&rtcDev, 0x11, buf[0], 1);
+  high.readRegisters(&mcpDev, 0x12, buf[1], 1);
+  high.priority = I2C_PRIORITY_HIGH;
+  for (Adafruit_I2CTransfer *t : { &low1, &low2, &normal, &high })
+    t->callback = record;
+
+  order.clear();
+  CHECK(bus.submit(&low1));
+  CHECK(bus.submit(&low2));
+  CHECK(bus.submit(&normal));
+  CHECK(bus.submit(&high));
+  CHECK(!bus.submit(&high));  // already queued
+  CHECK(low1.busy() && high.busy());
+  while (bus.poll()) {}
+
+  CHECK(order.size() == 4);
+  CHECK(order[0] == &high && order[1] == &normal);
+  CHECK(order[2] == &low1 && order[3] == &low2);
+  CHECK(high.ok() && low2.ok());
+  CHECK(bus.transactions() == 4);
+  CHECK(!bus.poll());
+}
+
+static void test_merge() {
+  printf("register reads of one device merge into one transaction\n");
+  Adafruit_I2CBus bus;
+  uint8_t a = 0, b = 0, time[7] = { 0 }, tail[3] = { 0 };
+  Adafruit_I2CTransfer gpioA, gpioB, now, seconds;
+
+  gpioA.readRegisters(&mcpDev, 0x12, &a, 1);
+  gpioB.readRegisters(&mcpDev, 0x13, &b, 1);
+  gpioB.priority = I2C_PRIORITY_LOW;
+  resetBus();
+  bus.submit(&gpioA);
+  bus.submit(&gpioB);
+  CHECK(bus.poll());
+  CHECK(!bus.poll());
+  CHECK(a == mcp.regs[0x12] && b == mcp.regs[0x13]);
+  CHECK(gpioA.ok() && gpioB.ok());
+  CHECK(bus.transactions() == 1 && bus.merged() == 1);
+  CHECK(starts == 2);  // register pointer write, then the read
+
+  // Overlapping, and one that only touches once the range has grown
+  now.readRegisters(&rtcDev, 0x00, time, 7);
+  seconds.readRegisters(&rtcDev, 0x00, tail, 1);
+  Adafruit_I2CTransfer date;
+  date.readRegisters(&rtcDev, 0x07, tail + 1, 2);
+  bus.submit(&date);
+  bus.submit(&seconds);
+  bus.submit(&now);
+  CHECK(bus.poll());
+  CHECK(!bus.poll());
+  CHECK(!memcmp(time, rtc.regs, 7));
+  CHECK(tail[0] == rtc.regs[0] && tail[1] == rtc.regs[7] && tail[2] == rtc.regs[8]);
+  CHECK(bus.transactions() == 2 && bus.merged() == 3);
+}
+
+static void test_merge_limits() {
+  printf("no merging across gaps, past the size limit or past a write\n");
+  Adafruit_I2CBus bus;
+  uint8_t time[7], temp[2], big[I2CBUS_MERGE_MAX], after[1];
+  static const uint8_t setPointer[2] = { 0x00, 0x12 };  // reg 0 = 0x12
+  Adafruit_I2CTransfer now, temperature, whole, write, read;
+
+  // 0x00-0x06 and 0x11-0x12 leave a gap
+  now.readRegisters(&rtcDev, 0x00, time, 7);
+  temperature.readRegisters(&rtcDev, 0x11, temp, 2);
+  bus.submit(&now);
+  bus.submit(&temperature);
+  while (bus.poll()) {}
+  CHECK(bus.transactions() == 2 && bus.merged() == 0);
+
+  // Would grow past I2CBUS_MERGE_MAX
+  whole.readRegisters(&mcpDev, 0x00, big, I2CBUS_MERGE_MAX);
+  read.readRegisters(&mcpDev, I2CBUS_MERGE_MAX, after, 1);
+  bus.resetStats();
+  bus.submit(&whole);
+  bus.submit(&read);
+  while (bus.poll()) {}
+  CHECK(bus.transactions() == 2 && bus.merged() == 0);
+
+  // A read queued after a write to the same device sees the write
+  now.readRegisters(&rtcDev, 0x01, time, 1);
+  write.write(&rtcDev, setPointer, 2);
+  read.readRegisters(&rtcDev, 0x00, after, 1);
+  bus.resetStats();
+  bus.submit(&now);
+  bus.submit(&write);
+  bus.submit(&read);
+  while (bus.poll()) {}
+  CHECK(bus.transactions() == 3 && bus.merged() == 0);
+  CHECK(after[0] == 0x12);
+}
+
+static Adafruit_I2CBus *callbackBus;
+static int calls;
+static bool lastOk = true;
+
+static void periodic(Adafruit_I2CTransfer *t, bool ok) {
+  calls++;
+  lastOk = ok;
+  if (calls < 5) callbackBus->submit(t);  // a client polling from its callback
+}
+
+static void test_failures_and_callbacks() {
+  printf("a missing device fails the transfer; callbacks may resubmit\n");
+  Adafruit_I2CBus bus;
+  uint8_t buf[2];
+  Adafruit_I2CTransfer missing, poll;
+
+  missing.readRegisters(&ghostDev, 0x00, buf, 2);
+  CHECK(!bus.transfer(&missing));
+  CHECK(!missing.busy() && !missing.ok());
+
+  Adafruit_I2CTransfer empty;
+  CHECK(!bus.submit(&empty));  // no device set up
+
+  calls = 0;
+  callbackBus = &bus;
+  poll.readRegisters(&mcpDev, 0x12, buf, 1);
+  poll.callback = periodic;
+  CHECK(bus.submit(&poll));
+  while (bus.poll()) {}
+  CHECK(calls == 5 && lastOk);
+  CHECK(!poll.busy());
+}
+
+static void test_routed_devices() {
+  printf("devices attached with setBus() queue their calls on the bus\n");
+  Adafruit_I2CBus bus;
+  static const uint8_t text[4] = { 0x49, 0x4D, 0x09, 0x0D };
+  static const uint8_t seconds[2] = { 0x30, 0x12 };  // 30 s, 12 min
+  uint8_t time[7] = { 0 }, reg = 0x00, ctrl = 0x0E;
+  Adafruit_I2CTransfer chunks[3];
+
+  rtcDev.setBus(&bus, I2C_PRIORITY_HIGH, true);
+  lcdDev.setBus(&bus, I2C_PRIORITY_LOW);
+  CHECK(rtcDev.bus() == &bus && ghostDev.bus() == nullptr);
+
+  // The display's queued chunks wait behind the clock read
+  for (Adafruit_I2CTransfer &c : chunks) {
+    c.write(&lcdDev, text, sizeof(text));
+    c.priority = I2C_PRIORITY_LOW;
+    bus.submit(&c);
+  }
+  CHECK(rtcDev.write_then_read(&reg, 1, time, 7));
+  CHECK(!memcmp(time, rtc.regs, 7));
+  CHECK(bus.transactions() == 1);
+  CHECK(chunks[0].busy() && chunks[2].busy());
+
+  // A routed call runs what is ahead of it in the queue, then itself
+  CHECK(lcdDev.write(text, sizeof(text)));
+  CHECK(bus.transactions() == 5);
+  CHECK(!chunks[2].busy() && chunks[2].ok());
+
+  // Writes with a register prefix, plain reads and failures
+  CHECK(rtcDev.write(seconds, 2, true, &reg, 1));
+  CHECK(rtc.regs[0] == seconds[0] && rtc.regs[1] == seconds[1]);
+  CHECK(rtcDev.write(&ctrl, 1));
+  CHECK(rtcDev.read(time, 1) && time[0] == rtc.regs[0x0E]);
+  CHECK(bus.transactions() == 8);
+  ghostDev.setBus(&bus, I2C_PRIORITY_NORMAL);
+  CHECK(!ghostDev.write(text, 1));
+  CHECK(!ghostDev.detected());
+
+  rtcDev.setBus(nullptr, I2C_PRIORITY_NORMAL);
+  lcdDev.setBus(nullptr, I2C_PRIORITY_NORMAL);
+  ghostDev.setBus(nullptr, I2C_PRIORITY_NORMAL);
+  CHECK(rtcDev.bus() == nullptr);
+}
+
+static void test_scan_cache() {
+  printf("the scan probes the bus once and answers from its cache\n");
+  Adafruit_I2CBus bus;
+  static const uint8_t lcdAddresses[] = { 0x3F, 0x27, 0x26 };
+
+  resetBus();
+  CHECK(bus.scan() == 4);
+  CHECK(probes == 0x78 - 0x08);
+  CHECK(bus.present(0x68) && bus.present(0x20) && !bus.present(0x21));
+  CHECK(bus.find(lcdAddresses, 3) == 0x27);
+  CHECK(bus.next() == 0x20 && bus.next(0x20) == 0x27);
+  CHECK(bus.next(0x27) == 0x57 && bus.next(0x57) == 0x68);
+  CHECK(bus.next(0x68) == 0);
+  CHECK(bus.scan() == 4);
+  CHECK(probes == 0x78 - 0x08);
+
+  CHECK(bus.scan(true) == 4);
+  CHECK(probes == 2 * (0x78 - 0x08));
+
+  // Before any scan, find() probes the candidates up to the first hit
+  Adafruit_I2CBus fresh;
+  static const uint8_t missing[] = { 0x3E, 0x3D };
+  resetBus();
+  CHECK(fresh.find(lcdAddresses, 3) == 0x27);
+  CHECK(probes == 2);
+  CHECK(fresh.find(missing, 2) == 0);
+  CHECK(probes == 4);
+}
+
+/*
+ * Workload of a feeder or watering board: the control side polls the
+ * expander inputs, writes its outputs and reads the clock; the display
+ * redraws a 16x2 page with LiquidCrystal_I2C's streamed writes (a
+ * setCursor and 16 characters per row, split at Wire's 32 bytes).
+ */
+
+enum Kind { GPIO, OUTPUTS, CLOCK, TEMPERATURE, PAGE, KINDS };
+
+static const char *kindName[KINDS] = { "inputs", "outputs", "clock",
+                                       "temperature", "lcd page" };
+static const uint8_t kindPriority[KINDS] = {
+  I2C_PRIORITY_HIGH, I2C_PRIORITY_HIGH, I2C_PRIORITY_HIGH,
+  I2C_PRIORITY_NORMAL, I2C_PRIORITY_LOW
+};
+static const uint32_t kindPeriod[KINDS] = { 10000, 500000, 100000, 1000000,
+                                            250000 };
+static const size_t pageChunks[] = { 7, 32, 32, 32, 1, 7, 32, 32, 32, 1 };
+static const size_t PAGE_CHUNKS = sizeof(pageChunks) / sizeof(pageChunks[0]);
+
+struct Arrival {
+  uint32_t at;
+  Kind kind;
+};
+
+static std::vector<Arrival> workload(uint32_t duration) {
+  std::vector<Arrival> arrivals;
+  uint32_t seed = 12345;
+  for (int k = 0; k < KINDS; k++) {
+    uint32_t phase = 1700 * k + 300;
+    for (uint32_t t = phase; t < duration; t += kindPeriod[k]) {
+      seed = seed * 1103515245 + 12345;
+      Arrival a = { t + (seed >> 16) % 2000, (Kind)k };  // up to 2 ms late
+      arrivals.push_back(a);
+    }
+  }
+  std::sort(arrivals.begin(), arrivals.end(),
+            [](const Arrival &x, const Arrival &y) { return x.at < y.at; });
+  return arrivals;
+}
+
+static uint8_t inputs[2], outputs[3] = { 0x14, 0x00, 0x00 }, clock[7],
+    temperature[2], page[32];
+
+struct Result {
+  double busyPercent;
+  uint32_t transactions;
+  uint32_t worstHigh;
+  uint32_t skipped;
+};
+
+// Every library drives Wire itself, one call after the other, so a call
+// waits for whatever call is on the bus, all of it
+static Result runDirect(const std::vector<Arrival> &arrivals, uint32_t duration) {
+  Result r = { 0, 0, 0, 0 };
+  resetBus();
+  double busy = 0;
+  for (const Arrival &a : arrivals) {
+    if (now_us < a.at) now_us = a.at;
+    double start = now_us;
+    uint8_t reg;
+    switch (a.kind) {
+    case GPIO:  // digitalRead() on either port: one register each
+      reg = 0x12;
+      mcpDev.write_then_read(&reg, 1, inputs, 1);
+      reg = 0x13;
+      mcpDev.write_then_read(&reg, 1, inputs + 1, 1);
+      break;
+    case OUTPUTS:
+      mcpDev.write(outputs, 3);
+      break;
+    case CLOCK:
+      reg = 0x00;
+      rtcDev.write_then_read(&reg, 1, clock, 7);
+      break;
+    case TEMPERATURE:
+      reg = 0x11;
+      rtcDev.write_then_read(&reg, 1, temperature, 2);
+      break;
+    default:
+      for (size_t len : pageChunks) lcdDev.write(page, len);
+      break;
+    }
+    busy += now_us - start;
+    if (kindPriority[a.kind] == I2C_PRIORITY_HIGH &&
+        now_us - a.at > r.worstHigh)
+      r.worstHigh = now_us - a.at;
+  }
+  r.busyPercent = 100 * busy / duration;
+  r.transactions = starts;
+  return r;
+}
+
+static Result runManaged(const std::vector<Arrival> &arrivals, uint32_t duration) {
+  Result r = { 0, 0, 0, 0 };
+  Adafruit_I2CBus bus;
+  Adafruit_I2CTransfer gpioA, gpioB, out, now, temp, chunks[PAGE_CHUNKS];
+
+  gpioA.readRegisters(&mcpDev, 0x12, inputs, 1);
+  gpioB.readRegisters(&mcpDev, 0x13, inputs + 1, 1);
+  out.write(&mcpDev, outputs, 3);
+  now.readRegisters(&rtcDev, 0x00, clock, 7);
+  temp.readRegisters(&rtcDev, 0x11, temperature, 2);
+  gpioA.priority = gpioB.priority = out.priority = now.priority =
+      I2C_PRIORITY_HIGH;
+  for (size_t i = 0; i < PAGE_CHUNKS; i++) {
+    chunks[i].write(&lcdDev, page, pageChunks[i]);
+    chunks[i].priority = I2C_PRIORITY_LOW;
+  }
+
+  resetBus();
+  size_t next = 0;
+  while (next < arrivals.size() || bus.poll()) {
+    // Submit whatever came due while the bus was busy
+    while (next < arrivals.size() && arrivals[next].at <= now_us) {
+      std::vector<Adafruit_I2CTransfer *> ts;
+      switch (arrivals[next].kind) {
+      case GPIO: ts = { &gpioA, &gpioB }; break;
+      case OUTPUTS: ts = { &out }; break;
+      case CLOCK: ts = { &now }; break;
+      case TEMPERATURE: ts = { &temp }; break;
+      default:
+        for (Adafruit_I2CTransfer &c : chunks) ts.push_back(&c);
+        break;
+      }
+      bool idle = true;
+      for (Adafruit_I2CTransfer *t : ts) idle &= !t->busy();
+      if (idle) {
+        // Clients run in other tasks: they submitted when the request
+        // came due, not when this loop got back from the bus
+        for (Adafruit_I2CTransfer *t : ts) {
+          bus.submit(t);
+          t->queued = arrivals[next].at;
+        }
+      } else {
+        r.skipped++;
+      }
+      next++;
+    }
+    if (!bus.poll() && next < arrivals.size() && now_us < arrivals[next].at)
+      now_us = arrivals[next].at;
+  }
+  r.busyPercent = 100.0 * bus.busyMicros() / duration;
+  r.transactions = starts;
+  r.worstHigh = bus.maxLatency(I2C_PRIORITY_HIGH);
+  return r;
+}
+
+static void test_latency_bound() {
+  printf("high priority waits at most one LCD chunk behind the display\n");
+  const uint32_t duration = 5000000;
+  std::vector<Arrival> arrivals = workload(duration);
+  Result direct = runDirect(arrivals, duration);
+  Result managed = runManaged(arrivals, duration);
+
+  // Longest low priority transaction, plus the longest high priority
+  // batch: both expander reads merged, then the clock read
+  double chunk = (10 + 9 * 32 + 1) * 1e6 / BUS_HZ;
+  double own = (10 + 9 + 10 + 9 * 2 + 1 + 10 + 9 + 10 + 9 * 7 + 1) * 1e6 / BUS_HZ;
+  CHECK(managed.worstHigh <= chunk + own + 1);
+  CHECK(direct.worstHigh > 3 * managed.worstHigh);
+  CHECK(managed.transactions < direct.transactions);
+  CHECK(managed.skipped == 0);
+}
+
+static void bench() {
+  const uint32_t duration = 60000000;
+  std::vector<Arrival> arrivals = workload(duration);
+
+  printf("one minute at 400 kHz, %zu client requests:", arrivals.size());
+  for (int k = 0; k < KINDS; k++)
+    printf(" %s every %u ms%s", kindName[k], kindPeriod[k] / 1000,
+           k + 1 < KINDS ? "," : "\n");
+
+  Result direct = runDirect(arrivals, duration);
+  Result managed = runManaged(arrivals, duration);
+  printf("                     bus busy  transactions  worst high priority\n");
+  printf("  direct Wire calls   %5.2f%%    %8u       %6u us\n",
+         direct.busyPercent, direct.transactions, direct.worstHigh);
+  printf("  Adafruit_I2CBus     %5.2f%%    %8u       %6u us\n",
+         managed.busyPercent, managed.transactions, managed.worstHigh);
+
+  // Boot: RDTRC_LCD::scanI2C() probes 1-126, then begin() probes its
+  // candidate list again until the LCD answers
+  static const uint8_t candidates[] = { 0x27, 0x3F, 0x26, 0x20, 0x38, 0x39,
+                                        0x3A, 0x3B, 0x3C, 0x3D, 0x3E };
+  resetBus();
+  for (uint8_t addr = 1; addr < 127; addr++) {
+    Wire.beginTransmission(addr);
+    Wire.endTransmission();
+  }
+  for (uint8_t addr : candidates) {
+    Wire.beginTransmission(addr);
+    if (Wire.endTransmission() == 0) break;
+  }
+  printf("boot scan and LCD detection:  probes  bus time\n");
+  printf("  direct Wire calls           %6u  %6.0f us\n", probes, now_us);
+
+  // The sketch scans its shared bus once; the LCD lookup and every later
+  // one answer from that scan
+  Adafruit_I2CBus bus;
+  resetBus();
+  bus.scan();
+  bus.find(candidates, sizeof(candidates));
+  printf("  shared, scanned bus         %6u  %6.0f us\n", probes, now_us);
+
+  // Without a scan only the candidates are probed
+  Adafruit_I2CBus unscanned;
+  resetBus();
+  unscanned.find(candidates, sizeof(candidates));
+  printf("  find() without a scan       %6u  %6.0f us\n", probes, now_us);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    bench();
+    return 0;
+  }
+
+  test_priority_order();
+  test_merge();
+  test_merge_limits();
+  test_failures_and_callbacks();
+  test_routed_devices();
+  test_scan_cache();
+  test_latency_bound();
+
+  return test_summary();
+}
@@ -0,0 +1,8 @@
+// Host stand-in for the Arduino core: micros() is the bus simulator's clock
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+unsigned long micros(void);
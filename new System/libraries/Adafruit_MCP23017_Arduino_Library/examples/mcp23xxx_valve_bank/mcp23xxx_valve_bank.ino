@@ -0,0 +1,72 @@
+// Six valves on GPA0-GPA5 and two buttons on GPB0-GPB1 of one MCP23017.
+// Valve changes are staged and written to both ports in one transaction
+// per tick. Buttons are not polled: INTA (mirrored) goes LOW on a change,
+// and one readInterrupts() call reads what changed and clears it.
+
+#include <Adafruit_MCP23X17.h>
+
+#define VALVES 0x003F  // GPA0-GPA5
+#define BUTTONS 0x0300 // GPB0-GPB1
+
+#define INT_PIN 27     // microcontroller pin attached to INTA
+
+Adafruit_MCP23X17 mcp;
+
+volatile bool changed = false;
+
+void onChange() { changed = true; }
+
+void setup() {
+  Serial.begin(9600);
+  //while (!Serial);
+  Serial.println("MCP23xxx Valve Bank Test!");
+
+  if (!mcp.begin_I2C()) {
+    Serial.println("Error.");
+    while (1);
+  }
+
+  for (uint8_t pin = 0; pin < 6; pin++)
+    mcp.pinMode(pin, OUTPUT);
+  mcp.pinMode(8, INPUT_PULLUP);
+  mcp.pinMode(9, INPUT_PULLUP);
+
+  // all valves closed
+  mcp.stageGPIO(0, VALVES);
+  mcp.commit();
+
+  // mirror INTA/B, active drive, signaled with a LOW
+  mcp.setupInterrupts(true, false, LOW);
+  mcp.setupInterruptPins(BUTTONS, CHANGE);
+  mcp.clearInterrupts();
+
+  pinMode(INT_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(INT_PIN), onChange, FALLING);
+
+  Serial.println("Looping...");
+}
+
+void loop() {
+  // open each valve in turn for two seconds: closing one and opening
+  // the next is a single write
+  uint8_t zone = (millis() / 2000) % 6;
+  mcp.stageGPIO(1 << zone, VALVES);
+  mcp.commit(); // nothing goes on the bus if no valve changed
+
+  if (changed || !digitalRead(INT_PIN)) {
+    changed = false;
+    uint16_t captured, current;
+    uint16_t flags = mcp.readInterrupts(&captured, &current);
+    // the capture holds the levels at the first change: a flagged button
+    // captured LOW was pressed, even if already released again
+    uint16_t pressed = flags & ~captured & BUTTONS;
+    if (pressed) {
+      Serial.print("Pressed: 0b");
+      Serial.print(pressed >> 8, BIN);
+      Serial.print(", pins now: 0b");
+      Serial.println((current & BUTTONS) >> 8, BIN);
+    }
+  }
+
+  delay(50);
+}
@@ -65,6 +65,7 @@ void Adafruit_MCP23X17::writeGPIOAB(uint16_t value) {
   Adafruit_BusIO_Register GPIO(i2c_dev, spi_dev, MCP23XXX_SPIREG,
                                getRegister(MCP23XXX_GPIO, 0), 2);
   GPIO.write(value, 2);
+  outputsValid = false;
 }
 
 /**************************************************************************/
@@ -35,6 +35,24 @@ bool Adafruit_MCP23XXX::begin_I2C(uint8_t i2c_addr, TwoWire *wire) {
   return i2c_dev->begin();
 }
 
+/**************************************************************************/
+/*!
+  @brief Queue this expander's transfers on a bus manager shared with the
+  other devices on its TwoWire, instead of driving it directly. Call after
+  begin_I2C(). Register reads may be merged with other reads of this chip,
+  which relies on sequential addressing (IOCON.SEQOP clear, the default).
+  @param bus The bus manager, or nullptr to drive the TwoWire directly again
+  @param priority One of i2c_priority_t
+  @return true if attached, false before begin_I2C() or on SPI.
+*/
+/**************************************************************************/
+bool Adafruit_MCP23XXX::setBus(Adafruit_I2CBus *bus, uint8_t priority) {
+  if (!i2c_dev)
+    return false;
+  i2c_dev->setBus(bus, priority, true);
+  return true;
+}
+
 /**************************************************************************/
 /*!
   @brief Initialize MCP using hardware SPI.
@@ -119,6 +137,7 @@ void Adafruit_MCP23XXX::digitalWrite(uint8_t pin, uint8_t value) {
   Adafruit_BusIO_RegisterBits pin_bit(&GPIO, 1, pin % 8);
 
   pin_bit.write((value == LOW) ? 0 : 1);
+  outputsValid = false; // the read-modify-write copied input levels too
 }
 
 /**************************************************************************/
@@ -145,6 +164,73 @@ void Adafruit_MCP23XXX::writeGPIO(uint8_t value, uint8_t port) {
   Adafruit_BusIO_Register GPIO(i2c_dev, spi_dev, MCP23XXX_SPIREG,
                                getRegister(MCP23XXX_GPIO, port));
   GPIO.write(value);
+  outputsValid = false;
+}
+
+/**************************************************************************/
+/*!
+  @brief Stage a HIGH or a LOW value for an output pin. Nothing goes on the
+  bus until commit(), so any number of pins can change together; only the
+  first staging after begin or a direct write reads the latches back.
+  @param pin the Arduino pin number
+  @param value HIGH or LOW
+*/
+/**************************************************************************/
+void Adafruit_MCP23XXX::stagePin(uint8_t pin, uint8_t value) {
+  stageGPIO((value == LOW) ? 0 : 0xFFFF, 1 << pin);
+}
+
+/**************************************************************************/
+/*!
+  @brief Stage several output pins at once.
+  @param value pin states, bit 0 for pin 0 (GPA0) up to bit 15 for GPB7.
+  @param mask the pins to change, the others keep their staged state.
+*/
+/**************************************************************************/
+void Adafruit_MCP23XXX::stageGPIO(uint16_t value, uint16_t mask) {
+  if (!outputsValid)
+    reloadOutputs();
+  outputs = (outputs & ~mask) | (value & mask);
+}
+
+/**************************************************************************/
+/*!
+  @brief Write the staged outputs of every port in one transaction, or
+  nothing if they did not change. Call once per control tick.
+  @returns true if the chip has the staged outputs.
+*/
+/**************************************************************************/
+bool Adafruit_MCP23XXX::commit() {
+  if (outputsValid && outputs == committed)
+    return true;
+
+  uint8_t ports = (pinCount > 8) ? 2 : 1;
+  Adafruit_BusIO_Register GPIO(i2c_dev, spi_dev, MCP23XXX_SPIREG,
+                               getRegister(MCP23XXX_GPIO, 0), ports);
+  if (!GPIO.write(outputs, ports))
+    return false; // still pending, the next commit() retries
+  committed = outputs;
+  outputsValid = true;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+  @brief Read the output latches back, discarding staged changes. Needed
+  only if something else wrote the chip.
+  @returns true if read successfully.
+*/
+/**************************************************************************/
+bool Adafruit_MCP23XXX::reloadOutputs() {
+  uint8_t ports = (pinCount > 8) ? 2 : 1;
+  uint8_t latches[2] = {0, 0};
+  Adafruit_BusIO_Register OLAT(i2c_dev, spi_dev, MCP23XXX_SPIREG,
+                               getRegister(MCP23XXX_OLAT, 0), ports);
+  if (!OLAT.read(latches, ports))
+    return false;
+  committed = outputs = latches[0] | ((uint16_t)latches[1] << 8);
+  outputsValid = true;
+  return true;
 }
 
 /**************************************************************************/
@@ -191,6 +277,31 @@ void Adafruit_MCP23XXX::setupInterruptPin(uint8_t pin, uint8_t mode) {
   defval_bit.write((mode == LOW) ? 1 : 0);    // set defval
 }
 
+/**************************************************************************/
+/*!
+  @brief Enable interrupts for several pins with one read-modify-write per
+  register, covering both ports.
+  @param pins Pins to enable, bit 0 for pin 0 (GPA0) up to bit 15 for GPB7.
+  @param mode CHANGE, LOW, HIGH
+*/
+/**************************************************************************/
+void Adafruit_MCP23XXX::setupInterruptPins(uint16_t pins, uint8_t mode) {
+  uint8_t ports = (pinCount > 8) ? 2 : 1;
+  Adafruit_BusIO_Register GPINTEN(i2c_dev, spi_dev, MCP23XXX_SPIREG,
+                                  getRegister(MCP23XXX_GPINTEN, 0), ports);
+  Adafruit_BusIO_Register INTCON(i2c_dev, spi_dev, MCP23XXX_SPIREG,
+                                 getRegister(MCP23XXX_INTCON, 0), ports);
+  Adafruit_BusIO_Register DEFVAL(i2c_dev, spi_dev, MCP23XXX_SPIREG,
+                                 getRegister(MCP23XXX_DEFVAL, 0), ports);
+
+  // Comparison first, so enabling cannot fire on a stale DEFVAL
+  uint32_t con = INTCON.read();
+  INTCON.write((mode == CHANGE) ? (con & ~pins) : (con | pins), ports);
+  uint32_t def = DEFVAL.read();
+  DEFVAL.write((mode == LOW) ? (def | pins) : (def & ~pins), ports);
+  GPINTEN.write(GPINTEN.read() | pins, ports);
+}
+
 /**************************************************************************/
 /*!
   @brief Disable interrupt for given pin.
@@ -279,6 +390,43 @@ uint16_t Adafruit_MCP23XXX::getCapturedInterrupt() {
   return intcap;
 }
 
+/**************************************************************************/
+/*!
+  @brief Service an interrupt in one transaction: INTF, INTCAP and GPIO
+  follow each other (both ports interleaved on the MCP23X17), so a single
+  sequential read gets all of them and clears the interrupt. Call it when
+  INTA/INTB goes active instead of polling the inputs.
+  @param captured if not null, receives the pin states captured when the
+  interrupt fired.
+  @param current if not null, receives the pin states now, which include
+  changes after the capture (the chip captures only the first one until
+  cleared).
+  @returns pins that caused the interrupt, 0 if none or the read failed.
+*/
+/**************************************************************************/
+uint16_t Adafruit_MCP23XXX::readInterrupts(uint16_t *captured,
+                                           uint16_t *current) {
+  uint8_t ports = (pinCount > 8) ? 2 : 1;
+  uint8_t regs[6] = {0, 0, 0, 0, 0, 0};
+  Adafruit_BusIO_Register INTF(i2c_dev, spi_dev, MCP23XXX_SPIREG,
+                               getRegister(MCP23XXX_INTF, 0));
+  if (!INTF.read(regs, 3 * ports))
+    return 0;
+
+  // INTF, INTCAP, GPIO; each port A then B
+  uint16_t value[3];
+  for (uint8_t i = 0; i < 3; i++) {
+    value[i] = regs[i * ports];
+    if (ports > 1)
+      value[i] |= (uint16_t)regs[i * ports + 1] << 8;
+  }
+  if (captured)
+    *captured = value[1];
+  if (current)
+    *current = value[2];
+  return value[0];
+}
+
 /**************************************************************************/
 /*!
   @brief helper to get register address
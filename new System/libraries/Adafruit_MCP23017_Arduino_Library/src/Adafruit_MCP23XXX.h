@@ -6,6 +6,7 @@
 #define __ADAFRUIT_MCP23XXX_H__
 
 #include <Adafruit_BusIO_Register.h>
+#include <Adafruit_I2CBus.h>
 #include <Adafruit_I2CDevice.h>
 #include <Adafruit_SPIDevice.h>
 #include <Arduino.h>
@@ -45,6 +46,7 @@ public:
                  uint8_t _hw_addr = 0x00);
   bool begin_SPI(int8_t cs_pin, int8_t sck_pin, int8_t miso_pin,
                  int8_t mosi_pin, uint8_t _hw_addr = 0x00);
+  bool setBus(Adafruit_I2CBus *bus, uint8_t priority = I2C_PRIORITY_HIGH);
 
   // main Arduino API methods
   void pinMode(uint8_t pin, uint8_t mode);
@@ -55,13 +57,22 @@ public:
   uint8_t readGPIO(uint8_t port = 0);
   void writeGPIO(uint8_t value, uint8_t port = 0);
 
+  // staged outputs, written to all ports at once by commit()
+  void stagePin(uint8_t pin, uint8_t value);
+  void stageGPIO(uint16_t value, uint16_t mask = 0xFFFF);
+  bool commit();
+  bool reloadOutputs();
+
   // interrupts
   void setupInterrupts(bool mirroring, bool openDrain, uint8_t polarity);
   void setupInterruptPin(uint8_t pin, uint8_t mode = CHANGE);
+  void setupInterruptPins(uint16_t pins, uint8_t mode = CHANGE);
   void disableInterruptPin(uint8_t pin);
   void clearInterrupts();
   uint8_t getLastInterruptPin();
   uint16_t getCapturedInterrupt();
+  uint16_t readInterrupts(uint16_t *captured = nullptr,
+                          uint16_t *current = nullptr);
 
 protected:
   Adafruit_I2CDevice *i2c_dev = nullptr; ///< Pointer to I2C bus interface
@@ -70,6 +81,10 @@ protected:
   uint8_t hw_addr;                       ///< HW address matching A2/A1/A0 pins
   uint16_t getRegister(uint8_t baseAddress, uint8_t port = 0);
 
+  uint16_t outputs = 0;      ///< Output latches with staged changes
+  uint16_t committed = 0;    ///< Output latches as last written or read
+  bool outputsValid = false; ///< committed matches the chip
+
 private:
   uint8_t buffer[4];
 };
@@ -0,0 +1,29 @@
+// Host stand-in for the Arduino core, enough for Adafruit_BusIO registers
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01 // ESP32 values; on AVR CHANGE and HIGH are both 1
+#define FALLING 0x02
+#define CHANGE 0x03
+#define LSBFIRST 0
+#define MSBFIRST 1
+#define HEX 16
+
+class Stream {
+public:
+  void print(const char *) {}
+  void print(uint32_t, int = 10) {}
+  void println() {}
+};
+
+extern Stream Serial;
+
+unsigned long micros(void);
@@ -0,0 +1,21 @@
+// Host stand-in for TwoWire: the test routes transactions to its MCP23017
+// model and counts them
+#pragma once
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+  void begin() {}
+  void end() {}
+  void setClock(uint32_t) {}
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  size_t write(const uint8_t *data, size_t len);
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t len, uint8_t stop = 1);
+  int available();
+  int read();
+};
+
+extern TwoWire Wire;
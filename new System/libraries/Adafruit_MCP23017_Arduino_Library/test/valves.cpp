@@ -0,0 +1,417 @@
+/*
+ * Staged outputs and interrupt-driven inputs against a register-level
+ * MCP23017 model (BANK = 0, sequential addressing, interrupt capture
+ * locked until INTCAP or GPIO is read), and I2C transaction counts for
+ * the orchid system's six valves and two buttons on one expander:
+ * per-pin digitalWrite()/digitalRead() polling against stage/commit
+ * and readInterrupts(), also with the expander queued on a shared
+ * Adafruit_I2CBus.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -I../../test -Isrc -Itest/host -I../Adafruit_BusIO test/valves.cpp src/Adafruit_MCP23XXX.cpp src/Adafruit_MCP23X17.cpp ../Adafruit_BusIO/Adafruit_BusIO_Register.cpp ../Adafruit_BusIO/Adafruit_I2CDevice.cpp ../Adafruit_BusIO/Adafruit_I2CBus.cpp ../Adafruit_BusIO/Adafruit_GenericDevice.cpp -o valves
+ *   ./valves          # tests
+ *   ./valves bench    # transactions for a watering run
+ */
+
+#include <stdio.h>
+
+#include "Adafruit_MCP23X17.h"
+#include "host_test.h"
+
+Stream Serial;
+SPIClass SPI;
+
+unsigned long micros(void) {
+  return 0;
+}
+
+/*
+ * MCP23017 model
+ */
+
+enum {
+  IODIRA = 0x00, IPOLA = 0x02, GPINTENA = 0x04, DEFVALA = 0x06,
+  INTCONA = 0x08, IOCONA = 0x0A, GPPUA = 0x0C, INTFA = 0x0E,
+  INTCAPA = 0x10, GPIOA = 0x12, OLATA = 0x14, REGS = 0x16
+};
+
+struct Mcp23017 {
+  uint8_t reg[REGS];
+  uint8_t pointer;
+  uint16_t pins;     // levels driven onto the pins from outside
+  uint8_t last[2];   // port values at the previous change check
+
+  void reset() {
+    memset(reg, 0, sizeof(reg));
+    reg[IODIRA] = reg[IODIRA + 1] = 0xFF;
+    pointer = 0;
+    pins = 0xFFFF;
+    last[0] = last[1] = 0xFF;
+  }
+
+  uint8_t port(int p) const {
+    uint8_t dir = reg[IODIRA + p];
+    uint8_t in = (uint8_t)(pins >> (8 * p)) ^ reg[IPOLA + p];
+    return (in & dir) | (reg[OLATA + p] & ~dir);
+  }
+
+  uint8_t read() {
+    uint8_t a = pointer;
+    pointer = (pointer + 1) % REGS;
+    if (a == GPIOA || a == GPIOA + 1) {
+      reg[INTFA + (a & 1)] = 0;  // reading the port clears its interrupt
+      return port(a & 1);
+    }
+    if (a == INTCAPA || a == INTCAPA + 1) reg[INTFA + (a & 1)] = 0;
+    return reg[a];
+  }
+
+  void write(uint8_t value) {
+    uint8_t a = pointer;
+    pointer = (pointer + 1) % REGS;
+    if (a == GPIOA || a == GPIOA + 1) {
+      reg[OLATA + (a & 1)] = value;
+    } else if (a == IOCONA || a == IOCONA + 1) {
+      reg[IOCONA] = reg[IOCONA + 1] = value;  // one register, two addresses
+    } else if (a < INTFA || a >= OLATA) {
+      reg[a] = value;  // INTF and INTCAP are read only
+    }
+  }
+
+  // Interrupt-on-change: the first change captures the port and sets INTF,
+  // later ones are not captured until the interrupt is cleared
+  void setPin(int pin, bool level) {
+    pins = level ? (pins | 1 << pin) : (pins & ~(1 << pin));
+    for (int p = 0; p < 2; p++) {
+      uint8_t value = port(p);
+      uint8_t ref = (reg[INTCONA + p] & reg[DEFVALA + p]) |
+                    (~reg[INTCONA + p] & last[p]);
+      uint8_t changed = (value ^ ref) & reg[GPINTENA + p] & reg[IODIRA + p];
+      if (changed && !reg[INTFA + p]) {
+        reg[INTFA + p] = changed;
+        reg[INTCAPA + p] = value;
+      }
+      last[p] = value;
+    }
+  }
+
+  bool interrupt() const {  // INTA with MIRROR set
+    return reg[INTFA] || reg[INTFA + 1];
+  }
+
+  uint16_t latches() const {
+    return reg[OLATA] | reg[OLATA + 1] << 8;
+  }
+} chip;
+
+/*
+ * TwoWire routed to the model. A transaction is one start to stop; a
+ * register read with a repeated start counts once.
+ */
+
+TwoWire Wire;
+
+static uint8_t txAddr, txBuf[64], rxBuf[64];
+static size_t txLen, rxLen, rxPos;
+static uint32_t transactions;
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddr = address;
+  txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLen == sizeof(txBuf)) return 0;
+  txBuf[txLen++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n])) n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+  if (stop) transactions++;
+  if (txAddr != 0x20) return 2;
+  if (txLen) chip.pointer = txBuf[0] % REGS;
+  for (size_t i = 1; i < txLen; i++) chip.write(txBuf[i]);
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t len, uint8_t stop) {
+  if (stop) transactions++;
+  if (address != 0x20) return 0;
+  for (rxLen = 0; rxLen < len; rxLen++) rxBuf[rxLen] = chip.read();
+  rxPos = 0;
+  return len;
+}
+
+int TwoWire::available() {
+  return rxLen - rxPos;
+}
+
+int TwoWire::read() {
+  return rxPos < rxLen ? rxBuf[rxPos++] : -1;
+}
+
+/*
+ * Tests
+ */
+
+static const uint16_t VALVES = 0x003F;   // GPA0-GPA5
+static const uint16_t BUTTONS = 0x0300;  // GPB0 LCD page, GPB1 reset
+
+static void start(Adafruit_MCP23X17 &mcp) {
+  chip.reset();
+  CHECK(mcp.begin_I2C());
+  for (uint8_t pin = 0; pin < 6; pin++) mcp.pinMode(pin, OUTPUT);
+  mcp.pinMode(8, INPUT_PULLUP);
+  mcp.pinMode(9, INPUT_PULLUP);
+  transactions = 0;
+}
+
+static void test_stage_commit() {
+  printf("staged pins go out together in one transaction\n");
+  Adafruit_MCP23X17 mcp;
+  start(mcp);
+  mcp.writeGPIOB(0x80);  // something else drives GPB7
+  transactions = 0;
+
+  mcp.stagePin(0, HIGH);  // reads the latches back, once
+  mcp.stagePin(3, HIGH);
+  mcp.stageGPIO(0x0030, 0x0030);
+  CHECK(transactions == 1);
+  CHECK(chip.latches() == 0x8000);  // nothing written yet
+  CHECK(mcp.commit());
+  CHECK(transactions == 2);
+  CHECK(chip.latches() == 0x8039);
+
+  // Unchanged outputs cost nothing
+  mcp.stagePin(0, HIGH);
+  CHECK(mcp.commit());
+  CHECK(transactions == 2);
+
+  // Close one, open another: still one write
+  mcp.stagePin(0, LOW);
+  mcp.stagePin(1, HIGH);
+  CHECK(mcp.commit());
+  CHECK(transactions == 3);
+  CHECK(chip.latches() == 0x803A);
+
+  // A direct write makes the next staging read back first. Its
+  // read-modify-write also copied the input levels of GPA6-7 into OLAT.
+  mcp.digitalWrite(5, LOW);
+  CHECK(chip.latches() == 0x80DA);
+  transactions = 0;
+  mcp.stagePin(1, LOW);
+  CHECK(mcp.commit());
+  CHECK(transactions == 2);
+  CHECK(chip.latches() == 0x80D8);
+}
+
+static void test_interrupt_setup() {
+  printf("interrupt pins set up for both ports in one pass\n");
+  Adafruit_MCP23X17 mcp;
+  start(mcp);
+
+  mcp.setupInterruptPins(BUTTONS | 0x0001, CHANGE);
+  CHECK(chip.reg[GPINTENA] == 0x01 && chip.reg[GPINTENA + 1] == 0x03);
+  CHECK(chip.reg[INTCONA] == 0 && chip.reg[INTCONA + 1] == 0);
+  CHECK(transactions == 6);
+
+  mcp.setupInterruptPins(0x0400, LOW);
+  CHECK(chip.reg[GPINTENA + 1] == 0x07);
+  CHECK(chip.reg[INTCONA + 1] == 0x04 && chip.reg[DEFVALA + 1] == 0x04);
+  mcp.setupInterruptPins(0x0400, HIGH);
+  CHECK(chip.reg[INTCONA + 1] == 0x04 && chip.reg[DEFVALA + 1] == 0x00);
+  mcp.setupInterruptPins(0x0400, CHANGE);
+  CHECK(chip.reg[INTCONA + 1] == 0x00);
+}
+
+static void test_read_interrupts() {
+  printf("one read returns flags, capture and current state, and clears\n");
+  Adafruit_MCP23X17 mcp;
+  start(mcp);
+  mcp.setupInterrupts(true, false, LOW);
+  mcp.setupInterruptPins(BUTTONS, CHANGE);
+  transactions = 0;
+
+  CHECK(!chip.interrupt());
+  chip.setPin(9, LOW);  // reset button pressed
+  CHECK(chip.interrupt());
+
+  uint16_t captured = 0, current = 0;
+  CHECK(mcp.readInterrupts(&captured, &current) == 0x0200);
+  CHECK(transactions == 1);
+  CHECK((captured & BUTTONS) == 0x0100 && (current & BUTTONS) == 0x0100);
+  CHECK(!chip.interrupt());
+
+  // Pressed and released before the tick: the capture keeps the press
+  chip.setPin(9, HIGH);
+  mcp.readInterrupts();
+  chip.setPin(8, LOW);
+  chip.setPin(8, HIGH);
+  CHECK(mcp.readInterrupts(&captured, &current) == 0x0100);
+  CHECK(!(captured & 0x0100) && (current & 0x0100));
+
+  CHECK(mcp.readInterrupts() == 0);  // nothing pending
+}
+
+/*
+ * Orchid watering run: each zone opens for 8 s in turn while the next one
+ * takes over in the same tick, then stopAllWatering() closes everything.
+ * Buttons are pressed four times, once for less than a control tick.
+ */
+
+static const uint32_t TICK_MS = 50, RUN_MS = 60000;
+
+struct Press {
+  uint32_t at, held;
+};
+static const Press presses[] = {
+  { 5003, 300 }, { 12017, 30 }, { 20001, 1000 }, { 33512, 120 }
+};
+
+static uint16_t valvesAt(uint32_t ms) {
+  if (ms < 1000 || ms >= 49000) return 0;
+  return 1 << ((ms - 1000) / 8000);
+}
+
+static bool buttonAt(uint32_t ms) {
+  for (const Press &p : presses)
+    if (ms >= p.at && ms < p.at + p.held) return true;
+  return false;
+}
+
+struct RunResult {
+  uint32_t transactions;
+  int presses;
+  bool valvesRight;
+};
+
+static RunResult run(bool staged, Adafruit_I2CBus *bus = nullptr) {
+  Adafruit_MCP23X17 mcp;
+  start(mcp);
+  if (bus) mcp.setBus(bus);
+  if (staged) {
+    mcp.setupInterrupts(true, false, LOW);
+    mcp.setupInterruptPins(BUTTONS, CHANGE);
+    mcp.clearInterrupts();
+  }
+  transactions = 0;
+  if (bus) bus->resetStats();
+
+  RunResult r = { 0, 0, true };
+  uint16_t applied = 0, buttons = BUTTONS;
+
+  // initializeValves(): every valve closed
+  if (staged) {
+    mcp.stageGPIO(0, VALVES);
+    mcp.commit();
+  } else {
+    for (uint8_t pin = 0; pin < 6; pin++) mcp.digitalWrite(pin, LOW);
+  }
+
+  for (uint32_t ms = 0; ms <= RUN_MS; ms++) {
+    bool pressed = buttonAt(ms);
+    if (pressed != !(chip.pins & 0x0100)) chip.setPin(8, !pressed);
+    if (ms % TICK_MS) continue;
+
+    uint16_t want = valvesAt(ms);
+    if (staged) {
+      mcp.stageGPIO(want, VALVES);
+      if (ms == 50000) mcp.stageGPIO(0, VALVES);  // stopAllWatering()
+      mcp.commit();
+
+      if (chip.interrupt()) {  // INTA went low: the ISR set a flag
+        uint16_t captured, current;
+        uint16_t flags = mcp.readInterrupts(&captured, &current);
+        // Edges up to the capture, then any after it
+        uint16_t seen[2] = { (uint16_t)((buttons & ~flags) | (captured & flags)),
+                             current };
+        for (uint16_t now : seen) {
+          if ((buttons & 0x0100) && !(now & 0x0100)) r.presses++;
+          buttons = (buttons & ~BUTTONS) | (now & BUTTONS);
+        }
+      }
+    } else {
+      for (uint8_t pin = 0; pin < 6; pin++) {
+        if ((want ^ applied) & (1 << pin))
+          mcp.digitalWrite(pin, (want >> pin) & 1);
+      }
+      if (ms == 50000) {
+        for (uint8_t pin = 0; pin < 6; pin++) mcp.digitalWrite(pin, LOW);
+      }
+      uint16_t now = (mcp.digitalRead(8) << 8) | (mcp.digitalRead(9) << 9);
+      if ((buttons & 0x0100) && !(now & 0x0100)) r.presses++;
+      buttons = now;
+    }
+    applied = want;
+    r.valvesRight &= (chip.latches() & VALVES) == want;
+  }
+  r.transactions = transactions;
+  return r;
+}
+
+static void test_orchid_run() {
+  printf("orchid run: same valve states, fewer transactions, no lost press\n");
+  RunResult polled = run(false), staged = run(true);
+  CHECK(polled.valvesRight && staged.valvesRight);
+  CHECK(staged.presses == 4);
+  CHECK(polled.presses == 3);  // the 30 ms press falls between polls
+  CHECK(staged.transactions * 50 < polled.transactions);
+}
+
+static void test_shared_bus() {
+  printf("on a shared bus: the same run, every transfer through the queue\n");
+  Adafruit_I2CBus bus;
+  RunResult direct = run(true), queued = run(true, &bus);
+  CHECK(queued.valvesRight && queued.presses == 4);
+  CHECK(queued.transactions == direct.transactions);
+  CHECK(bus.transactions() == queued.transactions);
+  CHECK(!bus.poll());
+
+  Adafruit_MCP23X17 spi;
+  CHECK(!spi.setBus(&bus));  // not started
+}
+
+static void bench() {
+  RunResult polled = run(false), staged = run(true);
+  printf("orchid run, 60 s, 6 valves, 2 buttons, %u ms ticks\n",
+         (unsigned)TICK_MS);
+  printf("                                  transactions  presses seen\n");
+  printf("  digitalWrite/digitalRead polls      %6u          %d of 4\n",
+         polled.transactions, polled.presses);
+  printf("  stage/commit, readInterrupts        %6u          %d of 4\n",
+         staged.transactions, staged.presses);
+
+  // The valve changes alone, without the button polls
+  Adafruit_MCP23X17 mcp;
+  start(mcp);
+  for (uint8_t zone = 0; zone < 6; zone++) mcp.digitalWrite(zone, HIGH);
+  printf("opening six valves: %u transactions with digitalWrite, ",
+         transactions);
+  start(mcp);
+  mcp.stageGPIO(0, VALVES);  // the first staging reads the latches once
+  transactions = 0;
+  for (uint8_t zone = 0; zone < 6; zone++) mcp.stagePin(zone, HIGH);
+  mcp.commit();
+  printf("%u with stage/commit\n", transactions);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    bench();
+    return 0;
+  }
+
+  test_stage_commit();
+  test_interrupt_setup();
+  test_read_interrupts();
+  test_orchid_run();
+  test_shared_bus();
+
+  return test_summary();
+}
@@ -0,0 +1,47 @@
+/*
+  This file is part of the ArduinoBLE library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _HCI_RECORDING_TRANSPORT_H_
+#define _HCI_RECORDING_TRANSPORT_H_
+
+#include "HCITransport.h"
+
+// Keeps the last packet sent to the controller, every packet is
+// completed immediately
+class HCIRecordingTransportClass : public HCITransportInterface
+{
+public:
+    HCIRecordingTransportClass();
+    ~HCIRecordingTransportClass();
+
+    int begin();
+    void end();
+    void wait(unsigned long timeout);
+    int available();
+    int peek();
+    int read();
+    size_t write(const uint8_t* data, size_t length);
+
+    uint8_t lastPacket[256];
+    size_t lastPacketLength;
+};
+
+extern HCIRecordingTransportClass HCIRecordingTransport;
+
+#endif
@@ -0,0 +1,86 @@
+/*
+  This file is part of the ArduinoBLE library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _HCI_CONTROLLER_TRANSPORT_H_
+#define _HCI_CONTROLLER_TRANSPORT_H_
+
+#include <vector>
+
+#include "HCITransport.h"
+
+/*
+ * Simulated controller with a simulated clock. Packets from the host
+ * go out in the connection events of their connection, a few per event,
+ * and their buffers are returned with Number Of Completed Packets
+ * events. Indications are confirmed by the peer in the next event.
+ * Polling with nothing to read costs pollCost microseconds, so a host
+ * spinning on controller buffers moves the clock to the next event.
+ */
+class HCIControllerTransportClass : public HCITransportInterface
+{
+public:
+    struct Packet {
+      unsigned long time;
+      uint16_t connectionHandle;
+      uint8_t opcode;
+      uint16_t handle;
+      uint8_t value;
+    };
+
+    HCIControllerTransportClass();
+    ~HCIControllerTransportClass();
+
+    void reset(unsigned int connections, unsigned long interval, unsigned int packetsPerEvent);
+
+    int begin();
+    void end();
+    void wait(unsigned long timeout);
+    int available();
+    int peek();
+    int read();
+    size_t write(const uint8_t* data, size_t length);
+
+    // run the connection events due at the current time
+    void run();
+
+    unsigned long now;
+    unsigned long pollCost;
+    std::vector<Packet> sent;
+    std::vector<Packet> delivered;
+
+private:
+    struct Connection {
+      unsigned long nextEvent;
+      std::vector<Packet> tx;
+      bool cnfDue;
+    };
+
+    void connectionEvent(unsigned int index);
+    void queueRx(const uint8_t* data, size_t length);
+
+    std::vector<Connection> _connections;
+    std::vector<uint8_t> _rx;
+    size_t _rxPos;
+    unsigned long _interval;
+    unsigned int _packetsPerEvent;
+};
+
+extern HCIControllerTransportClass HCIControllerTransport;
+
+#endif
@@ -0,0 +1,79 @@
+/*
+  This file is part of the ArduinoBLE library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+
+#define private public
+#include "HCI.h"
+
+#include "HCIRecordingTransport.h"
+
+HCIRecordingTransportClass::HCIRecordingTransportClass() :
+  lastPacketLength(0)
+{
+}
+
+HCIRecordingTransportClass::~HCIRecordingTransportClass()
+{
+}
+
+int HCIRecordingTransportClass::begin()
+{
+  return 0;
+}
+
+void HCIRecordingTransportClass::end()
+{
+}
+
+void HCIRecordingTransportClass::wait(unsigned long /*timeout*/)
+{
+}
+
+int HCIRecordingTransportClass::available()
+{
+  return 0;
+}
+
+int HCIRecordingTransportClass::peek()
+{
+  return 0;
+}
+
+int HCIRecordingTransportClass::read()
+{
+  return 0;
+}
+
+size_t HCIRecordingTransportClass::write(const uint8_t* data, size_t length)
+{
+  if (length > sizeof(lastPacket)) {
+    length = sizeof(lastPacket);
+  }
+  memcpy(lastPacket, data, length);
+  lastPacketLength = length;
+
+  // the controller has sent the packet
+  HCI._pendingPkt = 0;
+
+  return length;
+}
+
+HCIRecordingTransportClass HCIRecordingTransport;
+HCITransportInterface& HCITransport = HCIRecordingTransport;
@@ -0,0 +1,243 @@
+/*
+  This file is part of the ArduinoBLE library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FakeGATT.h"
+#include "HCIRecordingTransport.h"
+
+#define private public
+#define protected public
+#include "ATT.h"
+#include "HCI.h"
+#include "BLEService.h"
+#include "BLECharacteristic.h"
+#include "BLEProperty.h"
+
+// ATT opcodes, private to ATT.cpp
+#define ATT_OP_FIND_INFO_REQ      0x04
+#define ATT_OP_FIND_INFO_RESP     0x05
+#define ATT_OP_READ_BY_TYPE_REQ   0x08
+#define ATT_OP_READ_BY_TYPE_RESP  0x09
+#define ATT_OP_READ_BY_GROUP_REQ  0x10
+#define ATT_OP_READ_BY_GROUP_RESP 0x11
+
+/*
+ * A central discovering the local GATT database over fake HCI traffic:
+ * primary services, characteristics and then every handle, each step
+ * repeated from the last handle found until the server answers with an
+ * error, the same way a real central pages through the database.
+ */
+
+static const uint16_t CONNECTION_HANDLE = 0x0040;
+static const uint16_t ATT_HEADER_SIZE = 9; // HCI ACL + L2CAP headers
+
+struct Discovery {
+  unsigned int services;
+  unsigned int characteristics;
+  unsigned int handles;
+  unsigned int requests;
+};
+
+// Sends a request and returns the ATT response PDU
+static const uint8_t* request(const uint8_t* pdu, uint8_t length, uint8_t* responseLength)
+{
+  uint8_t data[32];
+  memcpy(data, pdu, length);
+
+  HCIRecordingTransport.lastPacketLength = 0;
+  ATT.handleData(CONNECTION_HANDLE, length, data);
+  REQUIRE(HCIRecordingTransport.lastPacketLength > ATT_HEADER_SIZE);
+
+  *responseLength = HCIRecordingTransport.lastPacketLength - ATT_HEADER_SIZE;
+  return &HCIRecordingTransport.lastPacket[ATT_HEADER_SIZE];
+}
+
+static uint16_t handleAt(const uint8_t* data)
+{
+  return data[0] | (data[1] << 8);
+}
+
+static Discovery discover()
+{
+  Discovery result = { 0, 0, 0, 0 };
+  uint8_t length;
+
+  // Read By Group Type: primary services
+  for (uint16_t start = 0x0001; ; ) {
+    uint8_t req[] = { ATT_OP_READ_BY_GROUP_REQ, uint8_t(start), uint8_t(start >> 8), 0xff, 0xff, 0x00, 0x28 };
+    const uint8_t* resp = request(req, sizeof(req), &length);
+    result.requests++;
+    if (resp[0] != ATT_OP_READ_BY_GROUP_RESP) {
+      break;
+    }
+    for (int i = 2; i + resp[1] <= length; i += resp[1]) {
+      result.services++;
+      start = handleAt(&resp[i + 2]) + 1;
+    }
+  }
+
+  // Read By Type: characteristic declarations
+  for (uint16_t start = 0x0001; ; ) {
+    uint8_t req[] = { ATT_OP_READ_BY_TYPE_REQ, uint8_t(start), uint8_t(start >> 8), 0xff, 0xff, 0x03, 0x28 };
+    const uint8_t* resp = request(req, sizeof(req), &length);
+    result.requests++;
+    if (resp[0] != ATT_OP_READ_BY_TYPE_RESP) {
+      break;
+    }
+    for (int i = 2; i + resp[1] <= length; i += resp[1]) {
+      result.characteristics++;
+      start = handleAt(&resp[i]) + 1;
+    }
+  }
+
+  // Find Information: every handle
+  for (uint16_t start = 0x0001; ; ) {
+    uint8_t req[] = { ATT_OP_FIND_INFO_REQ, uint8_t(start), uint8_t(start >> 8), 0xff, 0xff };
+    const uint8_t* resp = request(req, sizeof(req), &length);
+    result.requests++;
+    if (resp[0] != ATT_OP_FIND_INFO_RESP) {
+      break;
+    }
+    int entrySize = (resp[1] == 0x01) ? 4 : 18;
+    for (int i = 2; i + entrySize <= length; i += entrySize) {
+      uint16_t handle = handleAt(&resp[i]);
+      REQUIRE(handle == result.handles + 1);
+      result.handles++;
+      start = handle + 1;
+    }
+  }
+
+  return result;
+}
+
+// GATT.begin() adds 9 attributes, each extra service adds 10 more:
+// the declaration and 3 notify characteristics of 3 handles each
+static void setupDatabase(unsigned int extraServices)
+{
+  GATT.end();
+  GATT.begin();
+
+  for (unsigned int s = 0; s < extraServices; s++) {
+    char uuid[5];
+    sprintf(uuid, "%04x", 0xa000 + s);
+    BLEService service(uuid);
+
+    for (unsigned int c = 0; c < 3; c++) {
+      sprintf(uuid, "%04x", 0xb000 + s * 3 + c);
+      BLECharacteristic characteristic(uuid, BLERead | BLENotify, 20);
+      service.addCharacteristic(characteristic);
+    }
+
+    GATT.addService(service);
+  }
+
+  HCI._maxPkt = 1;
+}
+
+TEST_CASE("GATT attribute table", "[ArduinoBLE::GATT]")
+{
+  WHEN("Attributes are looked up by handle")
+  {
+    setupDatabase(9);
+    REQUIRE(GATT.attributeCount() == 99);
+
+    for (unsigned int i = 0; i < GATT.attributeCount(); i++) {
+      REQUIRE(GATT.attribute(i) != NULL);
+    }
+    REQUIRE(GATT.attribute(GATT.attributeCount()) == NULL);
+  }
+
+  WHEN("A range is clamped to the table")
+  {
+    setupDatabase(1);
+    unsigned int visited = 0;
+    for (GATTAttributeRange range = GATT.attributes(0x0001, 0xffff); range.valid(); range.next()) {
+      REQUIRE(range.attribute() == GATT.attribute(range.handle() - 1));
+      visited++;
+    }
+    REQUIRE(visited == GATT.attributeCount());
+
+    REQUIRE_FALSE(GATT.attributes(0x0000, 0xffff).valid());
+    REQUIRE_FALSE(GATT.attributes(0x0005, 0x0004).valid());
+    REQUIRE_FALSE(GATT.attributes(GATT.attributeCount() + 1, 0xffff).valid());
+  }
+
+  WHEN("A request near the end of a large table is served")
+  {
+    setupDatabase(49);
+    uint16_t last = GATT.attributeCount();
+    uint8_t req[] = { ATT_OP_FIND_INFO_REQ, uint8_t(last), uint8_t(last >> 8), uint8_t(last), uint8_t(last >> 8) };
+    uint8_t length;
+
+    FakeGATTObj.lookups = 0;
+    const uint8_t* resp = request(req, sizeof(req), &length);
+    REQUIRE(resp[0] == ATT_OP_FIND_INFO_RESP);
+    REQUIRE(handleAt(&resp[2]) == last);
+    // one table lookup, no walk from the first attribute
+    REQUIRE(FakeGATTObj.lookups == 1);
+  }
+}
+
+TEST_CASE("GATT discovery", "[ArduinoBLE::GATT]")
+{
+  const unsigned int extraServices[] = { 0, 9, 49 };
+
+  for (unsigned int extra : extraServices) {
+    setupDatabase(extra);
+    unsigned int count = GATT.attributeCount();
+
+    FakeGATTObj.lookups = 0;
+    Discovery result = discover();
+
+    INFO("attributes: " << count << ", requests: " << result.requests << ", lookups: " << FakeGATTObj.lookups);
+    REQUIRE(result.services == 2 + extra);
+    REQUIRE(result.characteristics == 3 + 3 * extra);
+    REQUIRE(result.handles == count);
+    // every request only visits the handles it answers with, plus the
+    // one that no longer fits: discovery is linear in attribute count
+    REQUIRE(FakeGATTObj.lookups <= 4 * count);
+  }
+
+  GATT.end();
+}
+
+TEST_CASE("GATT discovery benchmark", "[.][benchmark]")
+{
+  setupDatabase(0);
+  BENCHMARK("discovery, 9 attributes") {
+    return discover().requests;
+  };
+
+  setupDatabase(9);
+  BENCHMARK("discovery, 99 attributes") {
+    return discover().requests;
+  };
+
+  setupDatabase(49);
+  BENCHMARK("discovery, 499 attributes") {
+    return discover().requests;
+  };
+
+  GATT.end();
+}
@@ -0,0 +1,180 @@
+/*
+  This file is part of the ArduinoBLE library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+
+#include "HCIControllerTransport.h"
+
+#define HCI_ACLDATA_PKT   0x02
+#define HCI_EVENT_PKT     0x04
+#define EVT_NUM_COMP_PKTS 0x13
+
+#define ATT_OP_HANDLE_IND 0x1d
+#define ATT_OP_HANDLE_CNF 0x1e
+
+#define FIRST_CONNECTION_HANDLE 0x0040
+
+HCIControllerTransportClass::HCIControllerTransportClass() :
+  now(0),
+  pollCost(10),
+  _rxPos(0),
+  _interval(7500),
+  _packetsPerEvent(4)
+{
+}
+
+HCIControllerTransportClass::~HCIControllerTransportClass()
+{
+}
+
+void HCIControllerTransportClass::reset(unsigned int connections, unsigned long interval, unsigned int packetsPerEvent)
+{
+  now = 0;
+  sent.clear();
+  delivered.clear();
+  _rx.clear();
+  _rxPos = 0;
+  _interval = interval;
+  _packetsPerEvent = packetsPerEvent;
+
+  // spread the connection events over the interval
+  _connections.assign(connections, Connection());
+  for (unsigned int i = 0; i < connections; i++) {
+    _connections[i].nextEvent = interval * (i + 1) / connections;
+    _connections[i].cnfDue = false;
+  }
+}
+
+int HCIControllerTransportClass::begin()
+{
+  return 1;
+}
+
+void HCIControllerTransportClass::end()
+{
+}
+
+void HCIControllerTransportClass::wait(unsigned long timeout)
+{
+  now += timeout * 1000;
+}
+
+int HCIControllerTransportClass::available()
+{
+  if (_rxPos == _rx.size()) {
+    now += pollCost;
+    run();
+  }
+
+  return _rx.size() - _rxPos;
+}
+
+int HCIControllerTransportClass::peek()
+{
+  return (_rxPos < _rx.size()) ? _rx[_rxPos] : -1;
+}
+
+int HCIControllerTransportClass::read()
+{
+  return (_rxPos < _rx.size()) ? _rx[_rxPos++] : -1;
+}
+
+size_t HCIControllerTransportClass::write(const uint8_t* data, size_t length)
+{
+  // ACL packet: type, handle, ACL length, L2CAP length, CID, ATT PDU
+  if (length < 12 || data[0] != HCI_ACLDATA_PKT) {
+    return length;
+  }
+
+  Packet packet;
+  packet.time = now;
+  packet.connectionHandle = (data[1] | (data[2] << 8)) & 0x0fff;
+  packet.opcode = data[9];
+  packet.handle = data[10] | (data[11] << 8);
+  packet.value = (length > 12) ? data[12] : 0;
+
+  sent.push_back(packet);
+
+  unsigned int index = packet.connectionHandle - FIRST_CONNECTION_HANDLE;
+  if (index < _connections.size()) {
+    _connections[index].tx.push_back(packet);
+  }
+
+  return length;
+}
+
+void HCIControllerTransportClass::run()
+{
+  for (unsigned int i = 0; i < _connections.size(); i++) {
+    while (_connections[i].nextEvent <= now) {
+      connectionEvent(i);
+    }
+  }
+}
+
+void HCIControllerTransportClass::connectionEvent(unsigned int index)
+{
+  Connection& connection = _connections[index];
+  uint16_t connectionHandle = FIRST_CONNECTION_HANDLE + index;
+
+  if (connection.cnfDue) {
+    uint8_t cnf[] = {
+      HCI_ACLDATA_PKT, uint8_t(connectionHandle), uint8_t(0x20 | (connectionHandle >> 8)), 0x05, 0x00,
+      0x01, 0x00, 0x04, 0x00, ATT_OP_HANDLE_CNF
+    };
+    queueRx(cnf, sizeof(cnf));
+    connection.cnfDue = false;
+  }
+
+  unsigned int sent = 0;
+  while (sent < _packetsPerEvent && !connection.tx.empty()) {
+    Packet packet = connection.tx.front();
+    connection.tx.erase(connection.tx.begin());
+
+    packet.time = connection.nextEvent;
+    delivered.push_back(packet);
+    sent++;
+
+    if (packet.opcode == ATT_OP_HANDLE_IND) {
+      connection.cnfDue = true;
+    }
+  }
+
+  if (sent) {
+    uint8_t numCompPkts[] = {
+      HCI_EVENT_PKT, EVT_NUM_COMP_PKTS, 0x05, 0x01,
+      uint8_t(connectionHandle), uint8_t(connectionHandle >> 8), uint8_t(sent), 0x00
+    };
+    queueRx(numCompPkts, sizeof(numCompPkts));
+  }
+
+  connection.nextEvent += _interval;
+}
+
+void HCIControllerTransportClass::queueRx(const uint8_t* data, size_t length)
+{
+  if (_rxPos == _rx.size()) {
+    _rx.clear();
+    _rxPos = 0;
+  }
+  _rx.insert(_rx.end(), data, data + length);
+}
+
+HCIControllerTransportClass HCIControllerTransport;
+HCITransportInterface& HCITransport = HCIControllerTransport;
@@ -0,0 +1,287 @@
+/*
+  This file is part of the ArduinoBLE library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <stdio.h>
+
+#include "HCIControllerTransport.h"
+
+#define private public
+#define protected public
+#include "ATT.h"
+#include "HCI.h"
+#include "GATT.h"
+#include "BLEService.h"
+#include "BLECharacteristic.h"
+#include "BLEProperty.h"
+
+#define ATT_OP_HANDLE_NOTIFY 0x1b
+#define ATT_OP_HANDLE_IND    0x1d
+
+#define FIRST_CONNECTION_HANDLE 0x0040
+
+enum {
+  // more than fit in a peer's queue
+  NOTIFY_CHARACTERISTICS = ATT_NOTIFY_QUEUE_SIZE + 2,
+  INDICATE_CHARACTERISTICS = 2
+};
+
+static BLELocalCharacteristic* notifyCharacteristic[NOTIFY_CHARACTERISTICS];
+static BLELocalCharacteristic* indicateCharacteristic[INDICATE_CHARACTERISTICS];
+
+// Fresh database and controller, with subscribed peers
+static void setupLink(unsigned int connections, unsigned long interval, unsigned int packetsPerEvent, uint8_t controllerBuffers)
+{
+  for (int i = 0; i < ATT_MAX_PEERS; i++) {
+    ATT.removeConnection(FIRST_CONNECTION_HANDLE + i, 0x00);
+  }
+
+  GATT.end();
+  GATT.begin();
+
+  BLEService service("a000");
+  char uuid[5];
+  for (unsigned int i = 0; i < NOTIFY_CHARACTERISTICS + INDICATE_CHARACTERISTICS; i++) {
+    bool notify = i < NOTIFY_CHARACTERISTICS;
+    sprintf(uuid, "%04x", 0xb000 + i);
+    BLECharacteristic characteristic(uuid, BLERead | (notify ? BLENotify : BLEIndicate), 20);
+    service.addCharacteristic(characteristic);
+
+    BLELocalCharacteristic* local = characteristic.local();
+    local->writeCccdValue(BLEDevice(), notify ? 0x0001 : 0x0002);
+    if (notify) {
+      notifyCharacteristic[i] = local;
+    } else {
+      indicateCharacteristic[i - NOTIFY_CHARACTERISTICS] = local;
+    }
+  }
+  GATT.addService(service);
+
+  HCIControllerTransport.reset(connections, interval, packetsPerEvent);
+  HCI._recvIndex = 0;
+  HCI._pendingPkt = 0;
+  HCI._maxPkt = controllerBuffers;
+
+  for (unsigned int i = 0; i < connections; i++) {
+    uint8_t address[6] = { uint8_t(i), 0x11, 0x22, 0x33, 0x44, 0x55 };
+    ATT.addConnection(FIRST_CONNECTION_HANDLE + i, 0x01, 0x00, address, 0, 0, 0, 0);
+  }
+}
+
+static void pollUntil(unsigned long time)
+{
+  while (HCIControllerTransport.now < time) {
+    HCI.poll();
+  }
+}
+
+static int update(BLELocalCharacteristic* characteristic, uint8_t value)
+{
+  uint8_t data[20];
+  memset(data, value, sizeof(data));
+  return characteristic->writeValue(data, sizeof(data));
+}
+
+TEST_CASE("Notification queue", "[ArduinoBLE::ATT]")
+{
+  WHEN("The controller has a free buffer")
+  {
+    setupLink(1, 7500, 4, 4);
+
+    REQUIRE(update(notifyCharacteristic[0], 1) == 20);
+    REQUIRE(HCIControllerTransport.now == 0);
+    REQUIRE(HCIControllerTransport.sent.size() == 1);
+    REQUIRE(HCIControllerTransport.sent[0].opcode == ATT_OP_HANDLE_NOTIFY);
+    REQUIRE(HCIControllerTransport.sent[0].handle == notifyCharacteristic[0]->valueHandle());
+    REQUIRE(HCIControllerTransport.sent[0].value == 1);
+  }
+
+  WHEN("Updates to the same characteristic are coalesced")
+  {
+    setupLink(1, 7500, 4, 1);
+
+    for (uint8_t value = 1; value <= 5; value++) {
+      REQUIRE(update(notifyCharacteristic[0], value) == 20);
+    }
+    // nothing blocked on the controller
+    REQUIRE(HCIControllerTransport.now == 0);
+    REQUIRE(ATT._peers[0].queueLength == 1);
+
+    pollUntil(3 * 7500);
+    REQUIRE(HCIControllerTransport.delivered.size() == 2);
+    REQUIRE(HCIControllerTransport.delivered[0].value == 1);
+    REQUIRE(HCIControllerTransport.delivered[1].value == 5);
+  }
+
+  WHEN("Controller buffers are shared round robin between connections")
+  {
+    setupLink(3, 7500, 4, 3);
+
+    update(notifyCharacteristic[0], 1);
+    update(notifyCharacteristic[1], 2);
+
+    // one packet for each connection before any gets a second one
+    REQUIRE(HCIControllerTransport.sent.size() == 3);
+    unsigned int connectionsServed = 0;
+    for (unsigned int i = 0; i < 3; i++) {
+      connectionsServed |= 1 << (HCIControllerTransport.sent[i].connectionHandle - FIRST_CONNECTION_HANDLE);
+    }
+    REQUIRE(connectionsServed == 0x7);
+
+    pollUntil(3 * 7500);
+    REQUIRE(HCIControllerTransport.delivered.size() == 6);
+  }
+
+  WHEN("An indication waits for the confirmation of the previous one")
+  {
+    setupLink(1, 7500, 4, 4);
+
+    update(indicateCharacteristic[0], 1);
+    update(indicateCharacteristic[1], 2);
+    REQUIRE(HCIControllerTransport.now == 0);
+    REQUIRE(HCIControllerTransport.sent.size() == 1);
+
+    pollUntil(3 * 7500);
+    REQUIRE(HCIControllerTransport.delivered.size() == 2);
+    REQUIRE(HCIControllerTransport.delivered[0].opcode == ATT_OP_HANDLE_IND);
+    // confirmed in the event after the first one went out
+    REQUIRE(HCIControllerTransport.sent[1].time >= HCIControllerTransport.delivered[0].time + 7500);
+  }
+
+  WHEN("More characteristics change than fit in the queue")
+  {
+    setupLink(2, 7500, 4, 1);
+
+    for (unsigned int i = 0; i < NOTIFY_CHARACTERISTICS; i++) {
+      REQUIRE(update(notifyCharacteristic[i], i + 1) == 20);
+    }
+    REQUIRE(ATT._peers[0].queueLength == ATT_NOTIFY_QUEUE_SIZE);
+    REQUIRE(ATT._peers[1].queueLength == ATT_NOTIFY_QUEUE_SIZE);
+    // the overflow is coalesced like the queue
+    REQUIRE(update(notifyCharacteristic[NOTIFY_CHARACTERISTICS - 1], 100) == 20);
+
+    pollUntil((2 * NOTIFY_CHARACTERISTICS + 2) * 7500);
+    REQUIRE(ATT._peers[0].queueLength == 0);
+    REQUIRE(ATT._peers[1].queueLength == 0);
+    REQUIRE(HCIControllerTransport.delivered.size() == 2 * NOTIFY_CHARACTERISTICS);
+
+    // every peer got every characteristic once, with its latest value
+    for (unsigned int peer = 0; peer < 2; peer++) {
+      for (unsigned int i = 0; i < NOTIFY_CHARACTERISTICS; i++) {
+        unsigned int count = 0;
+        uint8_t value = 0;
+        for (auto& packet : HCIControllerTransport.delivered) {
+          if (packet.connectionHandle == FIRST_CONNECTION_HANDLE + peer && packet.handle == notifyCharacteristic[i]->valueHandle()) {
+            count++;
+            value = packet.value;
+          }
+        }
+        REQUIRE(count == 1);
+        REQUIRE(value == (i == NOTIFY_CHARACTERISTICS - 1 ? 100 : i + 1));
+      }
+    }
+  }
+
+  WHEN("A disconnect drops the queued notifications")
+  {
+    setupLink(1, 7500, 4, 1);
+
+    update(notifyCharacteristic[0], 1);
+    update(notifyCharacteristic[1], 2);
+    REQUIRE(ATT._peers[0].queueLength == 1);
+
+    for (unsigned int i = 2; i < NOTIFY_CHARACTERISTICS; i++) {
+      update(notifyCharacteristic[i], 3);
+    }
+    REQUIRE(ATT._peers[0].queueOverflow);
+
+    ATT.removeConnection(FIRST_CONNECTION_HANDLE, 0x13);
+    REQUIRE(ATT._peers[0].queueLength == 0);
+    REQUIRE(notifyCharacteristic[NOTIFY_CHARACTERISTICS - 1]->_overflowPeers == 0);
+  }
+}
+
+/*
+ * Throughput and caller latency: an application updating characteristics
+ * at a fixed rate and polling BLE in between, over two simulated seconds
+ */
+
+struct SimulationResult {
+  unsigned long updates;
+  unsigned long delivered;
+  unsigned long maxLatency;
+  double meanLatency;
+};
+
+static SimulationResult simulate(unsigned int connections, bool indicate, unsigned long updatePeriod)
+{
+  const unsigned long duration = 2000000;
+  SimulationResult result = { 0, 0, 0, 0 };
+  unsigned long totalLatency = 0;
+
+  setupLink(connections, 7500, 4, 8);
+
+  while (HCIControllerTransport.now < duration) {
+    unsigned long start = HCIControllerTransport.now;
+
+    if (indicate) {
+      update(indicateCharacteristic[result.updates % INDICATE_CHARACTERISTICS], uint8_t(result.updates));
+    } else {
+      update(notifyCharacteristic[result.updates % NOTIFY_CHARACTERISTICS], uint8_t(result.updates));
+    }
+    result.updates++;
+
+    unsigned long latency = HCIControllerTransport.now - start;
+    totalLatency += latency;
+    if (latency > result.maxLatency) {
+      result.maxLatency = latency;
+    }
+
+    pollUntil(start + updatePeriod);
+  }
+
+  result.delivered = HCIControllerTransport.delivered.size();
+  result.meanLatency = double(totalLatency) / result.updates;
+
+  return result;
+}
+
+TEST_CASE("Notification throughput simulation", "[.][benchmark]")
+{
+  struct {
+    const char* name;
+    unsigned int connections;
+    bool indicate;
+    unsigned long updatePeriod;
+  } scenarios[] = {
+    { "notify, 1 connection, update every 1 ms",    1, false, 1000 },
+    { "notify, 1 connection, update every 100 us",  1, false, 100 },
+    { "notify, 3 connections, update every 1 ms",   3, false, 1000 },
+    { "notify, 3 connections, update every 100 us", 3, false, 100 },
+    { "indicate, 2 connections, update every 1 ms", 2, true,  1000 },
+  };
+
+  printf("%-46s %10s %14s %12s %12s\n", "scenario", "updates/s", "delivered/s", "mean lat us", "max lat us");
+  for (auto& scenario : scenarios) {
+    SimulationResult result = simulate(scenario.connections, scenario.indicate, scenario.updatePeriod);
+    printf("%-46s %10lu %14lu %12.1f %12lu\n", scenario.name,
+           result.updates / 2, result.delivered / 2, result.meanLatency, result.maxLatency);
+  }
+}
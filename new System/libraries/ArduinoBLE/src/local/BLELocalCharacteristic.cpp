@@ -39,7 +39,8 @@ BLELocalCharacteristic::BLELocalCharacteristic(const char* uuid, uint16_t permis
   _handle(0x0000),
   _broadcast(false),
   _written(false),
-  _cccdValue(0x0000)
+  _cccdValue(0x0000),
+  _overflowPeers(0x00)
 {
   memset(_eventHandlers, 0x00, sizeof(_eventHandlers));
 
@@ -88,6 +88,8 @@ private:
   bool _written;
 
   uint16_t _cccdValue;
+  // ATT peers (one bit each) whose notify queue was full when the value changed
+  uint8_t _overflowPeers;
   BLELinkedList<BLELocalDescriptor*> _descriptors;
 
   BLECharacteristicEventHandler _eventHandlers[BLECharacteristicEventLast];
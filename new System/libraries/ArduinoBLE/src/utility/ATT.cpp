@@ -90,7 +90,8 @@ ATTClass::ATTClass() :
   _timeout(5000),
   _longWriteHandle(0x0000),
   _longWriteValue(NULL),
-  _longWriteValueLength(0)
+  _longWriteValueLength(0),
+  _nextQueuedPeer(0)
 {
   for (int i = 0; i < ATT_MAX_PEERS; i++) {
     _peers[i].connectionHandle = 0xffff;
@@ -100,6 +101,8 @@ ATTClass::ATTClass() :
     _peers[i].mtu = 23;
     _peers[i].device = NULL;
     _peers[i].encryption = 0x0;
+    _peers[i].queueOverflow = false;
+    clearQueue(i);
   }
 
   memset(_eventHandlers, 0x00, sizeof(_eventHandlers));
@@ -257,6 +260,7 @@ void ATTClass::addConnection(uint16_t handle, uint8_t role, uint8_t peerBdaddrTy
   _peers[peerIndex].mtu = 23;
   _peers[peerIndex].addressType = peerBdaddrType;
   memcpy(_peers[peerIndex].address, peerBdaddr, sizeof(_peers[peerIndex].address));
+  clearQueue(peerIndex);
   uint8_t BDADDr[6];
   for(int i=0; i<6; i++) BDADDr[5-i] = peerBdaddr[i];
   if(HCI.tryResolveAddress(BDADDr,_peers[peerIndex].resolvedAddress)){
@@ -443,6 +447,7 @@ void ATTClass::removeConnection(uint16_t handle, uint8_t /*reason*/)
   _peers[peerIndex].IOCap[0] = 0;
   _peers[peerIndex].IOCap[1] = 0;
   _peers[peerIndex].IOCap[2] = 0;
+  clearQueue(peerIndex);
 
   if (_peers[peerIndex].device) {
     delete _peers[peerIndex].device;
@@ -575,6 +580,7 @@ bool ATTClass::disconnect()
     memset(_peers[i].address, 0x00, sizeof(_peers[i].address));
     memset(_peers[i].resolvedAddress, 0x00, sizeof(_peers[i].resolvedAddress));
     _peers[i].mtu = 23;
+    clearQueue(i);
 
     if (_peers[i].device) {
       delete _peers[i].device;
@@ -598,75 +604,199 @@ BLEDevice ATTClass::central()
   return BLEDevice();
 }
 
-int ATTClass::handleNotify(uint16_t handle, const uint8_t* value, int length)
+int ATTClass::handleNotify(uint16_t handle, const uint8_t* /*value*/, int length)
 {
-  int numNotifications = 0;
+  return queueNotifyOrInd(ATT_OP_HANDLE_NOTIFY, handle, length);
+}
+
+int ATTClass::handleInd(uint16_t handle, const uint8_t* /*value*/, int length)
+{
+  return queueNotifyOrInd(ATT_OP_HANDLE_IND, handle, length);
+}
+
+void ATTClass::flushNotifications()
+{
+  // one packet per peer in turn while the controller has buffers, so a
+  // busy peer can't starve the others
+  int idle = 0;
+
+  while (idle < ATT_MAX_PEERS && HCI.availableAclPkts() > 0) {
+    int peer = _nextQueuedPeer;
+
+    _nextQueuedPeer = (_nextQueuedPeer + 1) % ATT_MAX_PEERS;
+
+    if (sendQueued(peer)) {
+      idle = 0;
+    } else {
+      idle++;
+    }
+  }
+}
+
+int ATTClass::queueNotifyOrInd(uint8_t opcode, uint16_t handle, int length)
+{
+  BLELocalAttribute* attribute = GATT.attribute(handle - 1);
+
+  if (attribute == NULL || attribute->type() != BLETypeCharacteristic) {
+    return 0;
+  }
+
+  BLELocalCharacteristic* characteristic = (BLELocalCharacteristic*)attribute;
+  int numQueued = 0;
 
   for (int i = 0; i < ATT_MAX_PEERS; i++) {
     if (_peers[i].connectionHandle == 0xffff) {
       continue;
     }
 
-    uint8_t notification[_peers[i].mtu];
-    uint16_t notificationLength = 0;
+    // a handle is queued at most once, the latest value is sent
+    bool queued = (characteristic->_overflowPeers & (1 << i)) != 0;
+
+    for (int j = 0; !queued && j < _peers[i].queueLength; j++) {
+      if (_peers[i].queue[j].handle == handle && _peers[i].queue[j].opcode == opcode) {
+        queued = true;
+      }
+    }
+
+    if (!queued && _peers[i].queueLength >= ATT_NOTIFY_QUEUE_SIZE) {
+      // no room: flag the characteristic, refillQueue() picks it up once
+      // the queue drains
+      characteristic->_overflowPeers |= (1 << i);
+      _peers[i].queueOverflow = true;
+    } else if (!queued) {
+      _peers[i].queue[_peers[i].queueLength].handle = handle;
+      _peers[i].queue[_peers[i].queueLength].opcode = opcode;
+      _peers[i].queueLength++;
+    }
+
+    length = min((uint16_t)(_peers[i].mtu - 3), (uint16_t)length);
+    numQueued++;
+  }
+
+  if (numQueued == 0) {
+    return 0;
+  }
+
+  flushNotifications();
+
+  return length;
+}
+
+bool ATTClass::sendQueued(int peer)
+{
+  if (_peers[peer].connectionHandle == 0xffff) {
+    return false;
+  }
+
+  if (_peers[peer].queueOverflow) {
+    refillQueue(peer);
+  }
+
+  for (int i = 0; i < _peers[peer].queueLength; i++) {
+    uint16_t handle = _peers[peer].queue[i].handle;
+    uint8_t opcode = _peers[peer].queue[i].opcode;
+
+    if (opcode == ATT_OP_HANDLE_IND && _peers[peer].cnfPending) {
+      // one indication at a time, wait for the confirmation
+      continue;
+    }
+
+    // drop the entry, keeping the others in order
+    _peers[peer].queueLength--;
+    memmove(&_peers[peer].queue[i], &_peers[peer].queue[i + 1], (_peers[peer].queueLength - i) * sizeof(_peers[peer].queue[0]));
+
+    BLELocalAttribute* attribute = GATT.attribute(handle - 1);
 
-    notification[0] = ATT_OP_HANDLE_NOTIFY;
-    notificationLength++;
+    if (attribute == NULL || attribute->type() != BLETypeCharacteristic) {
+      return true;
+    }
 
-    memcpy(&notification[1], &handle, sizeof(handle));
-    notificationLength += sizeof(handle);
+    BLELocalCharacteristic* characteristic = (BLELocalCharacteristic*)attribute;
 
-    length = min((uint16_t)(_peers[i].mtu - notificationLength), (uint16_t)length);
-    memcpy(&notification[notificationLength], value, length);
-    notificationLength += length;
+    uint8_t packet[_peers[peer].mtu];
+    uint16_t packetLength = 0;
+
+    packet[0] = opcode;
+    packetLength++;
+
+    memcpy(&packet[1], &handle, sizeof(handle));
+    packetLength += sizeof(handle);
+
+    uint16_t length = min((uint16_t)(_peers[peer].mtu - packetLength), (uint16_t)characteristic->valueLength());
+    memcpy(&packet[packetLength], characteristic->value(), length);
+    packetLength += length;
+
+    if (opcode == ATT_OP_HANDLE_IND) {
+      _peers[peer].cnfPending = true;
+    }
 
     /// TODO: Set encryption requirement on notify.
-    HCI.sendAclPkt(_peers[i].connectionHandle, ATT_CID, notificationLength, notification);
+    HCI.sendAclPkt(_peers[peer].connectionHandle, ATT_CID, packetLength, packet);
 
-    numNotifications++;
+    return true;
   }
 
-  return (numNotifications > 0) ? length : 0;
+  return false;
 }
 
-int ATTClass::handleInd(uint16_t handle, const uint8_t* value, int length)
+void ATTClass::refillQueue(int peer)
 {
-  int numIndications = 0;
+  bool overflow = false;
 
-  for (int i = 0; i < ATT_MAX_PEERS; i++) {
-    if (_peers[i].connectionHandle == 0xffff) {
+  for (unsigned int i = 0; i < GATT.attributeCount(); i++) {
+    BLELocalAttribute* attribute = GATT.attribute(i);
+
+    if (attribute->type() != BLETypeCharacteristic) {
       continue;
     }
 
-    uint8_t indication[_peers[i].mtu];
-    uint16_t indicationLength = 0;
+    BLELocalCharacteristic* characteristic = (BLELocalCharacteristic*)attribute;
 
-    indication[0] = ATT_OP_HANDLE_IND;
-    indicationLength++;
+    if (!(characteristic->_overflowPeers & (1 << peer))) {
+      continue;
+    }
 
-    memcpy(&indication[1], &handle, sizeof(handle));
-    indicationLength += sizeof(handle);
+    if (_peers[peer].queueLength >= ATT_NOTIFY_QUEUE_SIZE) {
+      overflow = true;
+      break;
+    }
 
-    length = min((uint16_t)(_peers[i].mtu - indicationLength), (uint16_t)length);
-    memcpy(&indication[indicationLength], value, length);
-    indicationLength += length;
+    characteristic->_overflowPeers &= ~(1 << peer);
 
-    _cnf = false;
+    // sent the way writeValue() would send it now
+    uint8_t opcode;
 
-    HCI.sendAclPkt(_peers[i].connectionHandle, ATT_CID, indicationLength, indication);
+    if ((characteristic->_properties & BLEIndicate) && (characteristic->_cccdValue & 0x0002)) {
+      opcode = ATT_OP_HANDLE_IND;
+    } else if ((characteristic->_properties & BLENotify) && (characteristic->_cccdValue & 0x0001)) {
+      opcode = ATT_OP_HANDLE_NOTIFY;
+    } else {
+      continue;
+    }
 
-    while (!_cnf) {
-      HCI.poll();
+    _peers[peer].queue[_peers[peer].queueLength].handle = characteristic->valueHandle();
+    _peers[peer].queue[_peers[peer].queueLength].opcode = opcode;
+    _peers[peer].queueLength++;
+  }
 
-      if (!connected(_peers[i].addressType, _peers[i].address)) {
-        break;
+  _peers[peer].queueOverflow = overflow;
+}
+
+void ATTClass::clearQueue(int peer)
+{
+  if (_peers[peer].queueOverflow) {
+    for (unsigned int i = 0; i < GATT.attributeCount(); i++) {
+      BLELocalAttribute* attribute = GATT.attribute(i);
+
+      if (attribute->type() == BLETypeCharacteristic) {
+        ((BLELocalCharacteristic*)attribute)->_overflowPeers &= ~(1 << peer);
       }
     }
-
-    numIndications++;
   }
 
-  return (numIndications > 0) ? length : 0;
+  _peers[peer].queueLength = 0;
+  _peers[peer].queueOverflow = false;
+  _peers[peer].cnfPending = false;
 }
 
 void ATTClass::error(uint16_t connectionHandle, uint8_t dlen, uint8_t data[])
@@ -768,9 +898,9 @@ void ATTClass::findInfoReq(uint16_t connectionHandle, uint16_t mtu, uint8_t dlen
   response[1] = 0x00;
   responseLength = 2;
 
-  for (uint16_t i = (findInfoReq->startHandle - 1); i < GATT.attributeCount() && i <= (findInfoReq->endHandle - 1); i++) {
-    BLELocalAttribute* attribute = GATT.attribute(i);
-    uint16_t handle = (i + 1);
+  for (GATTAttributeRange range = GATT.attributes(findInfoReq->startHandle, findInfoReq->endHandle); range.valid(); range.next()) {
+    BLELocalAttribute* attribute = range.attribute();
+    uint16_t handle = range.handle();
     bool isValueHandle = (attribute->type() == BLETypeCharacteristic) && (((BLELocalCharacteristic*)attribute)->valueHandle() == handle);
     bool isDescriptor = attribute->type() == BLETypeDescriptor;
     int uuidLen = (isValueHandle || isDescriptor) ? attribute->uuidLength() : BLE_ATTRIBUTE_TYPE_SIZE;
@@ -860,8 +990,8 @@ void ATTClass::findByTypeReq(uint16_t connectionHandle, uint16_t mtu, uint8_t dl
   responseLength = 1;
 
   if (findByTypeReq->type == BLETypeService) {
-    for (uint16_t i = (findByTypeReq->startHandle - 1); i < GATT.attributeCount() && i <= (findByTypeReq->endHandle - 1); i++) {
-      BLELocalAttribute* attribute = GATT.attribute(i);
+    for (GATTAttributeRange range = GATT.attributes(findByTypeReq->startHandle, findByTypeReq->endHandle); range.valid(); range.next()) {
+      BLELocalAttribute* attribute = range.attribute();
 
       if ((attribute->type() == findByTypeReq->type) && (attribute->uuidLength() == valueLength) && memcmp(attribute->uuidData(), value, valueLength) == 0) {
         BLELocalService* service = (BLELocalService*)attribute;
@@ -921,8 +1051,8 @@ void ATTClass::readByGroupReq(uint16_t connectionHandle, uint16_t mtu, uint8_t d
   Serial.print("readByGroupReq: attrcount: ");
   Serial.println(GATT.attributeCount());
 #endif
-  for (uint16_t i = (readByGroupReq->startHandle - 1); i < GATT.attributeCount() && i <= (readByGroupReq->endHandle - 1); i++) {
-    BLELocalAttribute* attribute = GATT.attribute(i);
+  for (GATTAttributeRange range = GATT.attributes(readByGroupReq->startHandle, readByGroupReq->endHandle); range.valid(); range.next()) {
+    BLELocalAttribute* attribute = range.attribute();
 
     if (readByGroupReq->uuid != attribute->type()) {
       // not the type
@@ -1140,9 +1270,9 @@ void ATTClass::readByTypeReq(uint16_t connectionHandle, uint16_t mtu, uint8_t dl
   response[1] = 0x00;
   responseLength = 2;
 
-  for (uint16_t i = (readByTypeReq->startHandle - 1); i < GATT.attributeCount() && i <= (readByTypeReq->endHandle - 1); i++) {
-    BLELocalAttribute* attribute = GATT.attribute(i);
-    uint16_t handle = (i + 1);
+  for (GATTAttributeRange range = GATT.attributes(readByTypeReq->startHandle, readByTypeReq->endHandle); range.valid(); range.next()) {
+    BLELocalAttribute* attribute = range.attribute();
+    uint16_t handle = range.handle();
 
     if (attribute->type() == readByTypeReq->uuid) {
       if (attribute->type() == BLETypeCharacteristic) {
@@ -1182,7 +1312,7 @@ void ATTClass::readByTypeReq(uint16_t connectionHandle, uint16_t mtu, uint8_t dl
         responseLength += uuidLen;
 
         // skip the next handle, it's a value handle
-        i++;
+        range.next();
 
         if ((responseLength + typeSize) > mtu) {
           break;
@@ -1568,9 +1698,13 @@ void ATTClass::handleNotifyOrInd(uint16_t connectionHandle, uint8_t opcode, uint
   }
 }
 
-void ATTClass::handleCnf(uint16_t /*connectionHandle*/, uint8_t /*dlen*/, uint8_t /*data*/[])
+void ATTClass::handleCnf(uint16_t connectionHandle, uint8_t /*dlen*/, uint8_t /*data*/[])
 {
-  _cnf = true;
+  for (int i = 0; i < ATT_MAX_PEERS; i++) {
+    if (_peers[i].connectionHandle == connectionHandle) {
+      _peers[i].cnfPending = false;
+    }
+  }
 }
 
 void ATTClass::sendError(uint16_t connectionHandle, uint8_t opcode, uint16_t handle, uint8_t code)
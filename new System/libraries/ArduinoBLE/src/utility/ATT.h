@@ -36,6 +36,19 @@
 #define ATT_MAX_PEERS 8
 #endif
 
+#if ATT_MAX_PEERS > 8
+#error "BLELocalCharacteristic::_overflowPeers has room for 8 peers"
+#endif
+
+// Notifications and indications waiting for controller buffers, per peer
+#ifndef ATT_NOTIFY_QUEUE_SIZE
+#if __AVR__
+#define ATT_NOTIFY_QUEUE_SIZE 4
+#else
+#define ATT_NOTIFY_QUEUE_SIZE 8
+#endif
+#endif
+
 enum PEER_ENCRYPTION {
   NO_ENCRYPTION         = 0,
   PAIRING_REQUEST       = 1 << 0,
@@ -85,6 +98,7 @@ public:
 
   virtual int handleNotify(uint16_t handle, const uint8_t* value, int length);
   virtual int handleInd(uint16_t handle, const uint8_t* value, int length);
+  virtual void flushNotifications();
 
   virtual void setEventHandler(BLEDeviceEvent event, BLEDeviceEventHandler eventHandler);
 
@@ -141,6 +155,11 @@ private:
 
   virtual int sendReq(uint16_t connectionHandle, void* requestBuffer, int requestLength, uint8_t responseBuffer[]);
 
+  virtual int queueNotifyOrInd(uint8_t opcode, uint16_t handle, int length);
+  virtual bool sendQueued(int peer);
+  virtual void refillQueue(int peer);
+  virtual void clearQueue(int peer);
+
 private:
   uint16_t _maxMtu;
   unsigned long _timeout;
@@ -154,9 +173,18 @@ private:
     BLERemoteDevice* device;
     uint8_t encryption;
     uint8_t IOCap[3];
+    // value handles with a pending update, the value is read when sent
+    struct {
+      uint16_t handle;
+      uint8_t opcode;
+    } queue[ATT_NOTIFY_QUEUE_SIZE];
+    uint8_t queueLength;
+    // updates that didn't fit are flagged on the characteristic instead
+    bool queueOverflow;
+    bool cnfPending;
   } _peers[ATT_MAX_PEERS];
 
-  volatile bool _cnf;
+  uint8_t _nextQueuedPeer;
 
   uint16_t _longWriteHandle;
   uint8_t* _longWriteValue;
@@ -27,7 +27,42 @@
 
 #include "GATT.h"
 
+GATTAttributeRange::GATTAttributeRange(const GATTClass& gatt, uint16_t startHandle, uint16_t endHandle) :
+  _gatt(gatt),
+  _handle(startHandle),
+  _endHandle(min((unsigned int)endHandle, gatt.attributeCount()))
+{
+  if (_handle == 0) {
+    // handle 0x0000 is reserved, the range is empty
+    _endHandle = 0;
+    _handle = 1;
+  }
+}
+
+bool GATTAttributeRange::valid() const
+{
+  return (_handle <= _endHandle);
+}
+
+void GATTAttributeRange::next()
+{
+  _handle++;
+}
+
+uint16_t GATTAttributeRange::handle() const
+{
+  return _handle;
+}
+
+BLELocalAttribute* GATTAttributeRange::attribute() const
+{
+  return _gatt.attribute(_handle - 1);
+}
+
 GATTClass::GATTClass() :
+  _attributes(NULL),
+  _attributeCount(0),
+  _attributeCapacity(0),
   _genericAccessService(NULL),
   _deviceNameCharacteristic(NULL),
   _appearanceCharacteristic(NULL),
@@ -119,12 +154,21 @@ void GATTClass::addService(BLEService& service)
 
 unsigned int GATTClass::attributeCount() const
 {
-  return _attributes.size();
+  return _attributeCount;
 }
 
 BLELocalAttribute* GATTClass::attribute(unsigned int index) const
 {
-  return _attributes.get(index);
+  if (index >= _attributeCount) {
+    return NULL;
+  }
+
+  return _attributes[index];
+}
+
+GATTAttributeRange GATTClass::attributes(uint16_t startHandle, uint16_t endHandle) const
+{
+  return GATTAttributeRange(*this, startHandle, endHandle);
 }
 
 uint16_t GATTClass::serviceUuidForCharacteristic(BLELocalCharacteristic* characteristic) const
@@ -158,7 +202,7 @@ uint16_t GATTClass::serviceUuidForCharacteristic(BLELocalCharacteristic* charact
 void GATTClass::addService(BLELocalService* service)
 {
   service->retain();
-  _attributes.add(service);
+  addAttribute(service);
   _services.add(service);
 
   uint16_t startHandle = attributeCount();
@@ -167,18 +211,18 @@ void GATTClass::addService(BLELocalService* service)
     BLELocalCharacteristic* characteristic = service->characteristic(i);
 
     characteristic->retain();
-    _attributes.add(characteristic);
+    addAttribute(characteristic);
     characteristic->setHandle(attributeCount());
     
     // add the characteristic again to make space of the characteristic value handle
     characteristic->retain();
-    _attributes.add(characteristic);
+    addAttribute(characteristic);
 
     for (unsigned int j = 0; j < characteristic->descriptorCount(); j++) {
       BLELocalDescriptor* descriptor = characteristic->descriptor(j);
 
       descriptor->retain();
-      _attributes.add(descriptor);
+      addAttribute(descriptor);
       descriptor->setHandle(attributeCount());
     }
   }
@@ -186,6 +230,24 @@ void GATTClass::addService(BLELocalService* service)
   service->setHandles(startHandle, attributeCount());
 }
 
+void GATTClass::addAttribute(BLELocalAttribute* attribute)
+{
+  if (_attributeCount == _attributeCapacity) {
+    // grow geometrically, services are usually added in a burst during setup
+    unsigned int capacity = _attributeCapacity ? (_attributeCapacity * 2) : 16;
+    BLELocalAttribute** attributes = (BLELocalAttribute**)realloc(_attributes, capacity * sizeof(BLELocalAttribute*));
+
+    if (attributes == NULL) {
+      return;
+    }
+
+    _attributes = attributes;
+    _attributeCapacity = capacity;
+  }
+
+  _attributes[_attributeCount++] = attribute;
+}
+
 void GATTClass::clearAttributes()
 {
   for (unsigned int i = 0; i < attributeCount(); i++) {
@@ -195,7 +257,10 @@ void GATTClass::clearAttributes()
       delete a;
     }
   }
-  _attributes.clear();
+  free(_attributes);
+  _attributes = NULL;
+  _attributeCount = 0;
+  _attributeCapacity = 0;
 
   for (unsigned int i = 0; i < _services.size(); i++) {
     _services.get(i)->clear();
@@ -28,6 +28,26 @@
 
 #include "BLEService.h"
 
+class GATTClass;
+
+// Walks the local attributes with handles in [startHandle, endHandle],
+// clamped to the attribute table. Each step is a direct table lookup.
+class GATTAttributeRange {
+public:
+  GATTAttributeRange(const GATTClass& gatt, uint16_t startHandle, uint16_t endHandle);
+
+  bool valid() const;
+  void next();
+
+  uint16_t handle() const;
+  BLELocalAttribute* attribute() const;
+
+private:
+  const GATTClass& _gatt;
+  unsigned int _handle;
+  unsigned int _endHandle;
+};
+
 class GATTClass {
 public:
   GATTClass();
@@ -43,9 +63,11 @@ public:
 
 protected:
   friend class ATTClass;
+  friend class GATTAttributeRange;
 
   virtual unsigned int attributeCount() const;
   virtual BLELocalAttribute* attribute(unsigned int index) const;
+  virtual GATTAttributeRange attributes(uint16_t startHandle, uint16_t endHandle) const;
 
 protected:
   friend class BLELocalCharacteristic;
@@ -54,11 +76,15 @@ protected:
 
 private:
   virtual void addService(BLELocalService* service);
+  virtual void addAttribute(BLELocalAttribute* attribute);
 
   virtual void clearAttributes();
 
 private:
-  BLELinkedList<BLELocalAttribute*> _attributes;
+  // indexed by handle - 1
+  BLELocalAttribute**               _attributes;
+  unsigned int                      _attributeCount;
+  unsigned int                      _attributeCapacity;
   BLELinkedList<BLELocalService*>   _services;
 
   BLELocalService*              _genericAccessService;
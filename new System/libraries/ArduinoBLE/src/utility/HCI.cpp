@@ -102,6 +102,7 @@ HCIClass::HCIClass() :
   _debug(NULL),
   _recvIndex(0),
   _pendingPkt(0),
+  _waitingForPkt(false),
   _l2CapPduBufferSize(0)
 {
 }
@@ -206,6 +207,12 @@ void HCIClass::poll(unsigned long timeout)
   digitalWrite(NINA_RTS, HIGH);
 #endif
   HCITransport.unlockForRead();
+
+  // hand freed controller buffers to queued notifications, unless a
+  // packet is already waiting for one
+  if (!_waitingForPkt) {
+    ATT.flushNotifications();
+  }
 }
 
 int HCIClass::reset()
@@ -637,9 +644,13 @@ int HCIClass::tryResolveAddress(uint8_t* BDAddr, uint8_t* address){
 
 int HCIClass::sendAclPkt(uint16_t handle, uint8_t cid, uint8_t plen, void* data)
 {
+  bool waiting = _waitingForPkt;
+
+  _waitingForPkt = true;
   while (_pendingPkt >= _maxPkt) {
     poll();
   }
+  _waitingForPkt = waiting;
 
   struct __attribute__ ((packed)) HCIACLHdr {
     uint8_t pktType;
@@ -671,6 +682,11 @@ int HCIClass::sendAclPkt(uint16_t handle, uint8_t cid, uint8_t plen, void* data)
   return 0;
 }
 
+int HCIClass::availableAclPkts() const
+{
+  return (_pendingPkt < _maxPkt) ? (_maxPkt - _pendingPkt) : 0;
+}
+
 int HCIClass::disconnect(uint16_t handle)
 {
     struct __attribute__ ((packed)) HCIDisconnectData {
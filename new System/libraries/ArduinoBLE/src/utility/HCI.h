@@ -112,6 +112,7 @@ public:
   virtual int tryResolveAddress(uint8_t* BDAddr, uint8_t* address);
 
   virtual int sendAclPkt(uint16_t handle, uint8_t cid, uint8_t plen, void* data);
+  virtual int availableAclPkts() const;
 
   virtual int disconnect(uint16_t handle);
 
@@ -158,6 +159,7 @@ private:
 
   uint8_t _maxPkt;
   uint8_t _pendingPkt;
+  bool _waitingForPkt;
 
   uint8_t _l2CapPduBuffer[255];
   uint8_t _l2CapPduBufferSize;
@@ -41,6 +41,8 @@ void HttpClient::resetState()
   iChunkLength = 0;
   iHttpResponseTimeout = kHttpResponseTimeout;
   iHttpWaitForDataDelay = kHttpWaitForDataDelay;
+  iRxBufferPos = 0;
+  iRxBufferLen = 0;
 }
 
 void HttpClient::stop()
@@ -67,7 +69,7 @@ void HttpClient::beginRequest()
 int HttpClient::startRequest(const char* aURLPath, const char* aHttpMethod, 
                                 const char* aContentType, int aContentLength, const byte aBody[])
 {
-    if (iState == eReadingBody || iState == eReadingChunkLength || iState == eReadingBodyChunk)
+    if (endOfHeadersReached())
     {
         flushClientRx();
 
@@ -261,10 +263,82 @@ void HttpClient::finishHeaders()
 
 void HttpClient::flushClientRx()
 {
+    iRxBufferPos = 0;
+    iRxBufferLen = 0;
     while (iClient->available())
     {
-        iClient->read();
+        iClient->read(iRxBuffer, sizeof(iRxBuffer));
+    }
+}
+
+bool HttpClient::fillRxBuffer()
+{
+    if (iRxBufferPos < iRxBufferLen)
+    {
+        return true;
+    }
+    iRxBufferPos = 0;
+    iRxBufferLen = 0;
+    if (iClient->available() <= 0)
+    {
+        return false;
     }
+    int ret = iClient->read(iRxBuffer, sizeof(iRxBuffer));
+    if (ret <= 0)
+    {
+        return false;
+    }
+    iRxBufferLen = ret;
+    return true;
+}
+
+int HttpClient::clientAvailable()
+{
+    return (iRxBufferLen - iRxBufferPos) + iClient->available();
+}
+
+int HttpClient::clientRead()
+{
+    if (!fillRxBuffer())
+    {
+        return -1;
+    }
+    return iRxBuffer[iRxBufferPos++];
+}
+
+int HttpClient::clientRead(uint8_t *buf, size_t size)
+{
+    size_t count = 0;
+
+    // Hand out whatever is already buffered first
+    if (iRxBufferPos < iRxBufferLen)
+    {
+        count = min(size, (size_t)(iRxBufferLen - iRxBufferPos));
+        memcpy(buf, iRxBuffer + iRxBufferPos, count);
+        iRxBufferPos += count;
+    }
+
+    if (count < size && iClient->available() > 0)
+    {
+        if (size - count >= sizeof(iRxBuffer))
+        {
+            // Large reads go straight into the caller's buffer
+            int ret = iClient->read(buf + count, size - count);
+            if (ret > 0)
+            {
+                count += ret;
+            }
+        }
+        else if (fillRxBuffer())
+        {
+            size_t n = min(size - count, (size_t)iRxBufferLen);
+            memcpy(buf + count, iRxBuffer, n);
+            iRxBufferPos = n;
+            count += n;
+        }
+    }
+
+    return (count > 0) ? (int)count : -1;
 }
 
 void HttpClient::endRequest()
@@ -540,7 +614,7 @@ int HttpClient::skipResponseHeaders()
 
 bool HttpClient::endOfHeadersReached()
 {
-    return (iState == eReadingBody || iState == eReadingChunkLength || iState == eReadingBodyChunk);
+    return (iState == eReadingBody || iState == eReadingChunkLength || iState == eReadingBodyChunk || iState == eReadingChunkTrailer || iState == eChunkedBodyEnd);
 };
 
 long HttpClient::contentLength()
@@ -554,9 +628,31 @@ long HttpClient::contentLength()
     return iContentLength;
 }
 
+static bool appendToString(const uint8_t* aData, size_t aLength, void* aContext)
+{
+    String* response = (String*)aContext;
+    char block[HTTP_CLIENT_RX_BUFFER_SIZE + 1];
+
+    // Copy into a terminated block so that this works with every core's String
+    while (aLength > 0)
+    {
+        size_t n = min(aLength, (size_t)HTTP_CLIENT_RX_BUFFER_SIZE);
+        memcpy(block, aData, n);
+        block[n] = '\0';
+        if (!response->concat(block))
+        {
+            *response = String((const char*)NULL);
+            return false;
+        }
+        aData += n;
+        aLength -= n;
+    }
+    return true;
+}
+
 String HttpClient::responseBody()
 {
-    int bodyLength = contentLength();
+    long bodyLength = contentLength();
     String response;
 
     if (bodyLength > 0)
@@ -568,35 +664,61 @@ String HttpClient::responseBody()
         }
     }
 
-    // keep on timedRead'ing, until:
-    //  - we have a content length: body length equals consumed or no bytes
-    //                              available
-    //  - no content length:        no bytes are available
-    while (iBodyLengthConsumed != bodyLength)
+    if (responseBody(appendToString, &response) != bodyLength && bodyLength > 0)
+    {
+        // failure, we did not read in response content length bytes
+        return String((const char*)NULL);
+    }
+
+    return response;
+}
+
+long HttpClient::responseBody(HttpBodyCallback aCallback, void* aContext)
+{
+    uint8_t block[HTTP_CLIENT_RX_BUFFER_SIZE];
+    long total = 0;
+
+    // skip the response headers, if they haven't been read already
+    contentLength();
+
+    // keep on reading blocks until:
+    //  - content length or chunked: the end of the body is reached
+    //  - no content length:         the server closes the connection
+    //  - no data arrives within the stream timeout
+    unsigned long timeoutStart = millis();
+    while (!endOfBodyReached() && (millis() - timeoutStart) < _timeout)
     {
-        int c = timedRead();
+        int n = read(block, sizeof(block));
 
-        if (c == -1) {
-            // read timed out, done
+        if (n > 0)
+        {
+            total += n;
+            if (!aCallback(block, n, aContext))
+            {
+                break;
+            }
+            timeoutStart = millis();
+        }
+        else if (!connected())
+        {
             break;
         }
-
-        if (!response.concat((char)c)) {
-            // adding char failed
-            return String((const char*)NULL);
+        else
+        {
+            yield();
         }
     }
 
-    if (bodyLength > 0 && (unsigned int)bodyLength != response.length()) {
-        // failure, we did not read in response content length bytes
-        return String((const char*)NULL);
-    }
-
-    return response;
+    return total;
 }
 
 bool HttpClient::endOfBodyReached()
 {
+    if (iState == eChunkedBodyEnd)
+    {
+        // We've read the last, zero-length, chunk
+        return true;
+    }
     if (endOfHeadersReached() && (contentLength() != kNoContentLengthHeader))
     {
         // We've got to the body and we know how long it will be
@@ -609,13 +731,20 @@ int HttpClient::available()
 {
     if (iState == eReadingChunkLength)
     {
-        while (iClient->available())
+        while (clientAvailable())
         {
-            char c = iClient->read();
+            char c = clientRead();
 
             if (c == '\n')
             {
-                iState = eReadingBodyChunk;
+                if (iChunkLength < 0)
+                {
+                    // This was the CRLF that ends the previous chunk's data
+                    continue;
+                }
+                // A zero-length chunk marks the end of the data, the
+                // trailer still follows it
+                iState = (iChunkLength == 0) ? eReadingChunkTrailer : eReadingBodyChunk;
                 break;
             }
             else if (c == '\r')
@@ -626,30 +755,54 @@ int HttpClient::available()
             {
                 char digit[2] = {c, '\0'};
 
+                if (iChunkLength < 0)
+                {
+                    iChunkLength = 0;
+                }
                 iChunkLength = (iChunkLength * 16) + strtol(digit, NULL, 16);
             }
         }
     }
 
-    if (iState == eReadingBodyChunk && iChunkLength == 0)
+    if (iState == eReadingChunkTrailer)
     {
-        iState = eReadingChunkLength;
+        // Skip any trailer fields up to the empty line that ends the body, so
+        // that none of it is left behind for the next response on this
+        // connection.  iChunkLength counts the characters of the current line
+        while (clientAvailable())
+        {
+            char c = clientRead();
+
+            if (c == '\n')
+            {
+                if (iChunkLength == 0)
+                {
+                    iState = eChunkedBodyEnd;
+                    break;
+                }
+                iChunkLength = 0;
+            }
+            else if (c != '\r')
+            {
+                iChunkLength++;
+            }
+        }
     }
-    
-    if (iState == eReadingChunkLength)
+
+    if (iState == eReadingChunkLength || iState == eReadingChunkTrailer || iState == eChunkedBodyEnd)
     {
         return 0;
     }
     
-    int clientAvailable = iClient->available();
+    int available = clientAvailable();
 
     if (iState == eReadingBodyChunk)
     {
-        return min(clientAvailable, iChunkLength);
+        return min(available, iChunkLength);
     }
     else
     {
-        return clientAvailable;
+        return available;
     }
 }
 
@@ -661,7 +814,7 @@ int HttpClient::read()
         return -1;
     }
 
-    int ret = iClient->read();
+    int ret = clientRead();
     if (ret >= 0)
     {
         if (endOfHeadersReached() && iContentLength > 0)
@@ -678,6 +831,7 @@ int HttpClient::read()
             if (iChunkLength == 0)
             {
                 iState = eReadingChunkLength;
+                iChunkLength = -1;
             }
         }
     }
@@ -748,19 +902,61 @@ String HttpClient::readHeaderValue()
 
 int HttpClient::read(uint8_t *buf, size_t size)
 {
-    int ret =iClient->read(buf, size);
-    if (endOfHeadersReached() && iContentLength > 0)
+    if (endOfHeadersReached())
     {
-        // We're outputting the body now and we've seen a Content-Length header
-        // So keep track of how many bytes are left
-        if (ret >= 0)
+        if (iIsChunked)
         {
+            // Process any chunk length line, then stay within this chunk
+            if (available() <= 0)
+            {
+                return (iState == eChunkedBodyEnd) ? 0 : -1;
+            }
+            size = min(size, (size_t)iChunkLength);
+        }
+        else if (iContentLength > 0)
+        {
+            // Don't read into whatever follows this response
+            if (iBodyLengthConsumed >= iContentLength)
+            {
+                return 0;
+            }
+            size = min(size, (size_t)(iContentLength - iBodyLengthConsumed));
+        }
+    }
+
+    int ret = clientRead(buf, size);
+    if (ret > 0)
+    {
+        if (endOfHeadersReached() && iContentLength > 0)
+        {
+            // We're outputting the body now and we've seen a Content-Length header
+            // So keep track of how many bytes are left
             iBodyLengthConsumed += ret;
         }
+
+        if (iState == eReadingBodyChunk)
+        {
+            iChunkLength -= ret;
+
+            if (iChunkLength == 0)
+            {
+                iState = eReadingChunkLength;
+                iChunkLength = -1;
+            }
+        }
     }
     return ret;
 }
 
+int HttpClient::peek()
+{
+    if (!fillRxBuffer())
+    {
+        return -1;
+    }
+    return iRxBuffer[iRxBufferPos];
+}
+
 int HttpClient::readHeader()
 {
     char c = HttpClient::read();
@@ -839,7 +1035,7 @@ int HttpClient::readHeader()
             if (iIsChunked)
             {
                 iState = eReadingChunkLength;
-                iChunkLength = 0;
+                iChunkLength = -1;
             }
             else
             {
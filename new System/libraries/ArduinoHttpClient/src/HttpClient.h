@@ -38,6 +38,21 @@ static const int HTTP_ERROR_INVALID_RESPONSE =-4;
 #define HTTP_HEADER_USER_AGENT     "User-Agent"
 #define HTTP_HEADER_VALUE_CHUNKED  "chunked"
 
+// Size of the receive buffer used to pull data from the underlying Client in
+// blocks rather than one byte per call.  Boards with plenty of RAM can raise
+// this for faster downloads.
+#ifndef HTTP_CLIENT_RX_BUFFER_SIZE
+  #define HTTP_CLIENT_RX_BUFFER_SIZE 64
+#endif
+
+/** Callback used by HttpClient::responseBody() to hand over the body in blocks
+  @param aData    Next block of the response body
+  @param aLength  Number of bytes in aData
+  @param aContext Pointer passed to responseBody()
+  @return true to keep reading, false to stop
+*/
+typedef bool (*HttpBodyCallback)(const uint8_t* aData, size_t aLength, void* aContext);
+
 class HttpClient : public Client
 {
 public:
@@ -287,6 +302,17 @@ public:
     */
     String responseBody();
 
+    /** Read the response body in blocks and pass each one to a callback,
+      without buffering the whole body.  Honours Content-Length and chunked
+      transfer encoding.
+      Also skips response headers if they have not been read already
+      MUST be called after responseStatusCode()
+      @param aCallback Function called for every block of the body
+      @param aContext  Pointer passed through to aCallback
+      @return Number of body bytes passed to aCallback
+    */
+    long responseBody(HttpBodyCallback aCallback, void* aContext = NULL);
+
     /** Enables connection keep-alive mode
     */
     void connectionKeepAlive();
@@ -306,15 +332,21 @@ public:
       @return Byte read or -1 if there are no bytes available.
     */
     virtual int read();
+    /** Read up to size bytes into buf.
+      Once the headers have been read this will not read past the end of the
+      body, and strips the framing of chunked responses.
+      @return Number of bytes read, 0 at the end of the body, or -1 if no
+      bytes are available yet
+    */
     virtual int read(uint8_t *buf, size_t size);
-    virtual int peek() { return iClient->peek(); };
+    virtual int peek();
     virtual void flush() { iClient->flush(); };
 
     // Inherited from Client
     virtual int connect(IPAddress ip, uint16_t port) { return iClient->connect(ip, port); };
     virtual int connect(const char *host, uint16_t port) { return iClient->connect(host, port); };
     virtual void stop();
-    virtual uint8_t connected() { return iClient->connected(); };
+    virtual uint8_t connected() { return (iRxBufferPos < iRxBufferLen) || iClient->connected(); };
     virtual operator bool() { return bool(iClient); };
     virtual uint32_t httpResponseTimeout() { return iHttpResponseTimeout; };
     virtual void setHttpResponseTimeout(uint32_t timeout) { iHttpResponseTimeout = timeout; };
@@ -341,6 +373,13 @@ protected:
     */
     void flushClientRx();
 
+    /** Helpers to read from the client through iRxBuffer
+    */
+    int clientAvailable();
+    int clientRead();
+    int clientRead(uint8_t *buf, size_t size);
+    bool fillRxBuffer();
+
     // Number of milliseconds that we wait each time there isn't any data
     // available to be read (during status code and header processing)
     static const int kHttpWaitForDataDelay = 100;
@@ -361,7 +400,9 @@ protected:
         eLineStartingCRFound,
         eReadingBody,
         eReadingChunkLength,
-        eReadingBodyChunk
+        eReadingBodyChunk,
+        eReadingChunkTrailer,
+        eChunkedBodyEnd
     } tHttpState;
     // Client we're using
     Client* iClient;
@@ -384,13 +425,19 @@ protected:
     const char* iTransferEncodingChunkedPtr;
     // Stores if the response body is chunked
     bool iIsChunked;
-    // Stores the value of the current chunk length, if present
+    // Stores the value of the current chunk length, if present, or -1 until
+    // the first digit of a chunk length line has been read.  While skipping
+    // the trailer it is the length of the current trailer line
     int iChunkLength;
     uint32_t iHttpResponseTimeout;
     uint32_t iHttpWaitForDataDelay;
     bool iConnectionClose;
     bool iSendDefaultRequestHeaders;
     String iHeaderLine;
+    // Data read from iClient but not yet consumed
+    uint8_t iRxBuffer[HTTP_CLIENT_RX_BUFFER_SIZE];
+    uint16_t iRxBufferPos;
+    uint16_t iRxBufferLen;
 };
 
 #endif
@@ -82,6 +82,7 @@ int WebSocketClient::beginMessage(int aType)
 
     iTxStarted = true;
     iTxMessageType = (aType & 0xf);
+    iTxFragmented = false;
     iTxSize = 0;
 
     return 0;
@@ -95,56 +96,99 @@ int WebSocketClient::endMessage()
         return 1;
     }
 
-    // send FIN + the message type (opcode)
-    HttpClient::write(0x80 | iTxMessageType);
+    iTxStarted = false;
+
+    return sendFrame(true);
+}
+
+int WebSocketClient::sendFrame(bool aFinal)
+{
+    uint8_t header[14];
+    size_t headerSize = 0;
+
+    // send FIN (on the last fragment) + the message type (opcode), or
+    // continuation for every fragment after the first one
+    header[headerSize++] = (aFinal ? 0x80 : 0x00) | (iTxFragmented ? TYPE_CONTINUATION : iTxMessageType);
 
     // the message is masked (0x80)
     // send the length
     if (iTxSize < 126)
     {
-        HttpClient::write(0x80 | (uint8_t)iTxSize);
+        header[headerSize++] = 0x80 | (uint8_t)iTxSize;
     }
     else if (iTxSize < 0xffff)
     {
-        HttpClient::write(0x80 | 126);
-        HttpClient::write((iTxSize >> 8) & 0xff);
-        HttpClient::write((iTxSize >> 0) & 0xff);
+        header[headerSize++] = 0x80 | 126;
+        header[headerSize++] = (iTxSize >> 8) & 0xff;
+        header[headerSize++] = (iTxSize >> 0) & 0xff;
     }
     else
     {
-        HttpClient::write(0x80 | 127);
-        HttpClient::write((iTxSize >> 56) & 0xff);
-        HttpClient::write((iTxSize >> 48) & 0xff);
-        HttpClient::write((iTxSize >> 40) & 0xff);
-        HttpClient::write((iTxSize >> 32) & 0xff);
-        HttpClient::write((iTxSize >> 24) & 0xff);
-        HttpClient::write((iTxSize >> 16) & 0xff);
-        HttpClient::write((iTxSize >> 8) & 0xff);
-        HttpClient::write((iTxSize >> 0) & 0xff);
+        header[headerSize++] = 0x80 | 127;
+        for (int shift = 56; shift >= 0; shift -= 8)
+        {
+            header[headerSize++] = (iTxSize >> shift) & 0xff;
+        }
     }
 
-    uint8_t maskKey[4];
-
-    // create a random mask for the data and send
-    for (int i = 0; i < (int)sizeof(maskKey); i++)
+    // create a random mask for the data
+    uint8_t* maskKey = header + headerSize;
+    for (int i = 0; i < 4; i++)
     {
         maskKey[i] = random(0xff);
     }
-    HttpClient::write(maskKey, sizeof(maskKey));
+    headerSize += 4;
 
     // mask the data and send
-    for (int i = 0; i < (int)iTxSize; i++) {
-        iTxBuffer[i] ^= maskKey[i % sizeof(maskKey)];
-    }
+    applyMask(iTxBuffer, iTxSize, maskKey);
 
     size_t txSize = iTxSize;
 
-    iTxStarted = false;
+    iTxFragmented = !aFinal;
     iTxSize = 0;
 
+    if (HttpClient::write(header, headerSize) != headerSize)
+    {
+        return 1;
+    }
     return (HttpClient::write(iTxBuffer, txSize) == txSize) ? 0 : 1;
 }
 
+void WebSocketClient::applyMask(uint8_t* aData, size_t aSize, const uint8_t aMaskKey[4], size_t aOffset)
+{
+    if (aSize >= sizeof(uint32_t))
+    {
+        // build a word holding the key rotated to the current offset, in
+        // memory order so that this works on either endianness
+        uint8_t pattern[sizeof(uint32_t)];
+        for (size_t i = 0; i < sizeof(pattern); i++)
+        {
+            pattern[i] = aMaskKey[(aOffset + i) & 3];
+        }
+        uint32_t maskWord;
+        memcpy(&maskWord, pattern, sizeof(maskWord));
+
+        // whole words keep the offset where it is; memcpy lets the compiler
+        // use plain loads and stores where unaligned access is allowed
+        while (aSize >= sizeof(uint32_t))
+        {
+            uint32_t word;
+            memcpy(&word, aData, sizeof(word));
+            word ^= maskWord;
+            memcpy(aData, &word, sizeof(word));
+            aData += sizeof(word);
+            aSize -= sizeof(word);
+        }
+    }
+
+    // and the remaining tail byte by byte
+    while (aSize > 0)
+    {
+        *aData++ ^= aMaskKey[aOffset++ & 3];
+        aSize--;
+    }
+}
+
 size_t WebSocketClient::write(uint8_t aByte)
 {
     return write(&aByte, sizeof(aByte));
@@ -164,18 +208,29 @@ size_t WebSocketClient::write(const uint8_t *aBuffer, size_t aSize)
         return 0;
     }
 
-    // check if the write size, fits in the buffer
-    if ((iTxSize + aSize) > sizeof(iTxBuffer))
+    size_t written = 0;
+
+    while (written < aSize)
     {
-        aSize = sizeof(iTxSize) - iTxSize;
-    }
+        if (iTxSize == sizeof(iTxBuffer))
+        {
+            // the buffer is full and there is more to come, send what we
+            // have as a fragment
+            if (sendFrame(false) != 0)
+            {
+                break;
+            }
+        }
 
-    // copy data into the buffer
-    memcpy(iTxBuffer + iTxSize, aBuffer, aSize);
+        // copy as much data as fits into the buffer
+        size_t n = min(aSize - written, (size_t)(sizeof(iTxBuffer) - iTxSize));
+        memcpy(iTxBuffer + iTxSize, aBuffer + written, n);
 
-    iTxSize += aSize;
-    
-    return aSize;
+        iTxSize += n;
+        written += n;
+    }
+
+    return written;
 }
 
 int WebSocketClient::parseMessage()
@@ -331,6 +386,19 @@ int WebSocketClient::read()
 
 int WebSocketClient::read(uint8_t *aBuffer, size_t aSize)
 {
+    if (iState >= eReadingBody)
+    {
+        // don't read past the end of the current message
+        if (iRxSize == 0)
+        {
+            return -1;
+        }
+        if (aSize > iRxSize)
+        {
+            aSize = iRxSize;
+        }
+    }
+
     int readCount = HttpClient::read(aBuffer, aSize);
 
     if (readCount > 0)
@@ -340,10 +408,8 @@ int WebSocketClient::read(uint8_t *aBuffer, size_t aSize)
         // unmask the RX data if needed
         if (iRxMasked)
         {
-            for (int i = 0; i < (int)aSize; i++, iRxMaskIndex++)
-            {
-                aBuffer[i] ^= iRxMaskKey[iRxMaskIndex % sizeof(iRxMaskKey)];
-            }
+            applyMask(aBuffer, readCount, iRxMaskKey, iRxMaskIndex);
+            iRxMaskIndex = (iRxMaskIndex + readCount) & 3;
         }
     }
 
@@ -357,7 +423,7 @@ int WebSocketClient::peek()
     if (p != -1 && iRxMasked)
     {
         // unmask the RX data if needed
-        p = (uint8_t)p ^ iRxMaskKey[iRxMaskIndex % sizeof(iRxMaskKey)];
+        p = (uint8_t)p ^ iRxMaskKey[iRxMaskIndex & 3];
     }
 
     return p;
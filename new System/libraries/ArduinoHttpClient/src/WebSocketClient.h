@@ -36,6 +36,8 @@ public:
     /** Begin to send a message of type (TYPE_TEXT or TYPE_BINARY)
         Use the write or Stream API's to set message content, followed by endMessage
         to complete the message.
+        Messages larger than WS_TX_BUFFER_SIZE are sent as a sequence of
+        fragments, each time the buffer fills up.
       @param aURLPath     Path to use in request
       @return 0 if successful, else error
     */
@@ -72,6 +74,15 @@ public:
     */
     int ping();
 
+    /** XOR a block of data with a WebSocket masking key, four bytes at a
+        time
+      @param aData    Data to mask or unmask, in place
+      @param aSize    Number of bytes in aData
+      @param aMaskKey 4 byte masking key
+      @param aOffset  Position of aData[0] within the frame payload
+    */
+    static void applyMask(uint8_t* aData, size_t aSize, const uint8_t aMaskKey[4], size_t aOffset = 0);
+
     // Inherited from Print
     virtual size_t write(uint8_t aByte);
     virtual size_t write(const uint8_t *aBuffer, size_t aSize);
@@ -86,10 +97,13 @@ public:
 
 private:
     void flushRx();
+    int sendFrame(bool aFinal);
 
 private:
     bool iTxStarted;
     uint8_t iTxMessageType;
+    // Set once the first fragment of the current message has been sent
+    bool iTxFragmented;
     uint8_t iTxBuffer[WS_TX_BUFFER_SIZE];
     uint64_t iTxSize;
 
@@ -0,0 +1,106 @@
+// Minimal Arduino core for building ArduinoHttpClient on a POSIX host.
+// millis() runs on a simulated clock that only delay() and yield() move, so
+// timeouts in the library cost no real time.
+#pragma once
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+inline unsigned long& hostClock() {
+  static unsigned long now;
+  return now;
+}
+
+inline unsigned long millis() {
+  return hostClock();
+}
+
+inline void delay(unsigned long ms) {
+  hostClock() += ms;
+}
+
+inline void yield() {
+  hostClock() += 1;
+}
+
+inline long random(long maxValue) {
+  return rand() % maxValue;
+}
+
+inline long random(long minValue, long maxValue) {
+  return minValue + rand() % (maxValue - minValue);
+}
+
+inline bool isHexadecimalDigit(int c) {
+  return isxdigit(c);
+}
+
+inline bool isSpace(int c) {
+  return isspace(c);
+}
+
+class String {
+  public:
+    String(const char* s = "") : _valid(s != NULL), _s(s ? s : "") {}
+    String(const std::string& s) : _valid(true), _s(s) {}
+    const char* c_str() const { return _valid ? _s.c_str() : NULL; }
+    unsigned int length() const { return _s.length(); }
+    unsigned char reserve(unsigned int size) { _s.reserve(size); return 1; }
+    unsigned char concat(const char* s) { _s += s; return 1; }
+    String& operator+=(char c) { _s += c; return *this; }
+    char operator[](unsigned int index) const { return _s[index]; }
+    int indexOf(char c) const {
+      size_t pos = _s.find(c);
+      return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(unsigned int from) const { return String(_s.substr(from)); }
+    String substring(unsigned int from, unsigned int to) const { return String(_s.substr(from, to - from)); }
+    bool operator==(const char* s) const { return _valid && _s == s; }
+    const std::string& str() const { return _s; }
+  private:
+    bool _valid;
+    std::string _s;
+};
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+      size_t n = 0;
+      while (size--) n += write(*buffer++);
+      return n;
+    }
+    size_t write(const char *str) {
+      return str ? write((const uint8_t *)str, strlen(str)) : 0;
+    }
+    size_t print(const char *str) { return write(str); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long value) { return print(std::to_string(value).c_str()); }
+    size_t print(int value) { return print((long)value); }
+    size_t print(unsigned int value) { return print((long)value); }
+    size_t println() { return print("\r\n"); }
+    size_t println(const char *str) { return print(str) + println(); }
+    size_t println(int value) { return print(value) + println(); }
+};
+
+class Stream : public Print {
+  public:
+    Stream() : _timeout(1000) {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  protected:
+    unsigned long _timeout;
+};
@@ -0,0 +1,454 @@
+/*
+ * HttpClient against a scripted Client stand-in: status line and header
+ * parsing, fixed length, chunked (with trailers) and read-until-close
+ * bodies delivered in odd sized pieces, and keep-alive connections where
+ * nothing of one response may leak into the next. The benchmark measures
+ * body throughput for the block reader and the byte-at-a-time read().
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -I../../test -Isrc -Itest/host test/http.cpp src/HttpClient.cpp src/b64.cpp -o http
+ *   ./http          # tests
+ *   ./http bench    # body throughput
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "HttpClient.h"
+#include "host_test.h"
+
+/*
+ * A Client that answers each request with the next scripted response.
+ * Responses arrive in segments, each one becoming readable a number of
+ * (simulated) milliseconds after the previous one, and read() hands out
+ * at most maxRead bytes per call, as a TCP stack would.
+ */
+
+struct Segment
+{
+  unsigned long delayMs;
+  std::string data;
+};
+
+struct Response
+{
+  std::vector<Segment> segments;
+  bool close;                   // the server closes the connection afterwards
+};
+
+class ScriptedClient : public Client
+{
+  public:
+    ScriptedClient() : maxRead(1460), connects(0), reads(0), _open(false), _closeWhenDrained(false) {}
+
+    void queue(const Response& response) { _script.push_back(response); }
+
+    // Bytes received but not read by HttpClient, released or still pending
+    size_t unread()
+    {
+      size_t n = _rx.size();
+      for (size_t i = 0; i < _pending.size(); i++)
+        n += _pending[i].data.size();
+      return n;
+    }
+
+    int connect(IPAddress, uint16_t) override { return connect("", 0); }
+    int connect(const char*, uint16_t) override
+    {
+      connects++;
+      _open = true;
+      _closeWhenDrained = false;
+      _rx.clear();
+      _pending.clear();
+      return 1;
+    }
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buf, size_t size) override
+    {
+      sent.append((const char*) buf, size);
+      // the end of the request headers starts the next response
+      size_t end = sent.find("\r\n\r\n", _requestStart);
+      if (end != std::string::npos)
+      {
+        _requestStart = end + 4;
+        if (!_script.empty())
+        {
+          Response r = _script.front();
+          _script.erase(_script.begin());
+          unsigned long at = millis();
+          for (size_t i = 0; i < r.segments.size(); i++)
+          {
+            at += r.segments[i].delayMs;
+            _pending.push_back(Segment { at, r.segments[i].data });
+          }
+          _closeWhenDrained = r.close;
+        }
+      }
+      return size;
+    }
+
+    int available() override
+    {
+      release();
+      return _rx.size() - _rxPos;
+    }
+
+    int read() override
+    {
+      uint8_t b;
+      return read(&b, 1) == 1 ? b : -1;
+    }
+
+    int read(uint8_t* buf, size_t size) override
+    {
+      if (available() <= 0)
+        return -1;
+      reads++;
+      size_t n = min(min(size, maxRead), _rx.size() - _rxPos);
+      memcpy(buf, _rx.data() + _rxPos, n);
+      _rxPos += n;
+      if (_rxPos == _rx.size())
+      {
+        _rx.clear();
+        _rxPos = 0;
+      }
+      return n;
+    }
+
+    int peek() override { return available() > 0 ? (uint8_t) _rx[_rxPos] : -1; }
+    void stop() override { _open = false; }
+
+    uint8_t connected() override
+    {
+      if (_open && _closeWhenDrained && available() == 0 && _pending.empty())
+        _open = false;
+      return _open || available() > 0;
+    }
+
+    operator bool() override { return true; }
+
+    size_t maxRead;
+    unsigned long connects;
+    unsigned long reads;
+    std::string sent;
+
+  private:
+    void release()
+    {
+      while (!_pending.empty() && millis() >= _pending.front().delayMs)
+      {
+        _rx += _pending.front().data;
+        _pending.erase(_pending.begin());
+      }
+    }
+
+    std::vector<Response> _script;
+    std::vector<Segment> _pending;    // delayMs holds the release time here
+    std::string _rx;
+    size_t _rxPos = 0;
+    size_t _requestStart = 0;
+    bool _open;
+    bool _closeWhenDrained;
+};
+
+static Response respond(const std::string& data, bool close = false)
+{
+  return Response { { Segment { 0, data } }, close };
+}
+
+// Splits data into segments of `size` bytes arriving `delayMs` apart
+static Response trickle(const std::string& data, size_t size, unsigned long delayMs, bool close = false)
+{
+  Response r { {}, close };
+  for (size_t i = 0; i < data.size(); i += size)
+    r.segments.push_back(Segment { i ? delayMs : 0, data.substr(i, size) });
+  return r;
+}
+
+static std::string chunked(const std::string& body, size_t chunkSize, const std::string& trailer = "")
+{
+  std::string out;
+  char line[16];
+  for (size_t i = 0; i < body.size(); i += chunkSize)
+  {
+    size_t n = min(chunkSize, body.size() - i);
+    snprintf(line, sizeof(line), "%zx\r\n", n);
+    out += line + body.substr(i, n) + "\r\n";
+  }
+  return out + "0\r\n" + trailer + "\r\n";
+}
+
+static std::string pattern(size_t size)
+{
+  std::string s(size, 0);
+  for (size_t i = 0; i < size; i++)
+    s[i] = 'a' + (i * 7 + i / 26) % 26;
+  return s;
+}
+
+/*
+ * Tests
+ */
+
+static void testFixedLength()
+{
+  printf("fixed length bodies end at Content-Length\n");
+
+  ScriptedClient client;
+  client.maxRead = 7;
+  client.queue(respond("HTTP/1.1 200 OK\r\nServer: test\r\nContent-Length: 11\r\n\r\nhello worldHTTP/1.1"));
+
+  HttpClient http(client, "example.com");
+  CHECK(http.get("/fixed") == HTTP_SUCCESS);
+  CHECK(client.sent.find("GET /fixed HTTP/1.1\r\nHost: example.com\r\n") == 0);
+  CHECK(http.responseStatusCode() == 200);
+
+  CHECK(http.headerAvailable());
+  CHECK(http.readHeaderName() == "Server");
+  CHECK(http.readHeaderValue() == "test");
+  CHECK(http.contentLength() == 11);
+  CHECK(!http.isResponseChunked());
+
+  uint8_t buf[64];
+  CHECK(http.read(buf, 5) == 5 && memcmp(buf, "hello", 5) == 0);
+  CHECK(http.read(buf, sizeof(buf)) == 6 && memcmp(buf, " world", 6) == 0);
+  CHECK(http.endOfBodyReached());
+  CHECK(http.read(buf, sizeof(buf)) == 0);
+}
+
+static void testChunked()
+{
+  printf("chunked bodies are reassembled whatever the segment and read sizes\n");
+
+  std::string body = pattern(5000);
+  static const size_t chunkSizes[] = { 1, 15, 16, 255, 4096 };
+  static const size_t segmentSizes[] = { 1, 3, 64, 1460 };
+
+  for (size_t c = 0; c < sizeof(chunkSizes) / sizeof(chunkSizes[0]); c++)
+    for (size_t s = 0; s < sizeof(segmentSizes) / sizeof(segmentSizes[0]); s++)
+    {
+      ScriptedClient client;
+      client.maxRead = segmentSizes[s];
+      client.queue(trickle("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n" + chunked(body, chunkSizes[c]),
+                           segmentSizes[s], 2));
+
+      HttpClient http(client, "example.com");
+      CHECK(http.get("/chunked") == HTTP_SUCCESS);
+      CHECK(http.responseStatusCode() == 200);
+      String response = http.responseBody();
+      CHECK(http.isResponseChunked());
+      CHECK(response.str() == body);
+      CHECK(http.endOfBodyReached());
+      CHECK(client.unread() == 0);
+    }
+}
+
+static void testByteReads()
+{
+  printf("read() one byte at a time gives the same body as the block reader\n");
+
+  std::string body = pattern(777);
+  ScriptedClient client;
+  client.maxRead = 5;
+  client.queue(respond("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n" + chunked(body, 100)));
+
+  HttpClient http(client, "example.com");
+  CHECK(http.get("/") == HTTP_SUCCESS);
+  CHECK(http.responseStatusCode() == 200);
+  CHECK(http.skipResponseHeaders() == HTTP_SUCCESS);
+
+  std::string got;
+  while (!http.endOfBodyReached())
+  {
+    if (http.available())
+      got += (char) http.read();
+    else
+      yield();
+  }
+  CHECK(got == body);
+}
+
+static bool stopAfterFirst(const uint8_t*, size_t, void* context)
+{
+  (*(int*) context)++;
+  return false;
+}
+
+static void testTrailersAndKeepAlive()
+{
+  printf("trailers after the last chunk are consumed, even when they arrive late\n");
+
+  ScriptedClient client;
+  // the trailer and the final CRLF come in a later segment than the last chunk
+  Response first = respond("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nfirst\r\n0\r\n");
+  first.segments.push_back(Segment { 50, "X-Checksum: 1234\r\nX-Other: x\r\n\r\n" });
+  client.queue(first);
+  Response second = respond("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n6\r\nsecond\r\n0\r\n");
+  second.segments.push_back(Segment { 50, "\r\n" });
+  client.queue(second);
+  client.queue(respond("HTTP/1.1 404 Not Found\r\nContent-Length: 5\r\n\r\nthird"));
+
+  HttpClient http(client, "example.com");
+  http.connectionKeepAlive();
+
+  CHECK(http.get("/1") == HTTP_SUCCESS);
+  CHECK(http.responseStatusCode() == 200);
+  CHECK(http.responseBody().str() == "first");
+  CHECK(client.unread() == 0);
+
+  CHECK(http.get("/2") == HTTP_SUCCESS);
+  CHECK(http.responseStatusCode() == 200);
+  CHECK(http.responseBody().str() == "second");
+  CHECK(client.unread() == 0);
+
+  CHECK(http.get("/3") == HTTP_SUCCESS);
+  CHECK(http.responseStatusCode() == 404);
+  CHECK(http.responseBody().str() == "third");
+
+  CHECK(client.connects == 1);
+  CHECK(client.sent.find("Connection: close") == std::string::npos);
+
+  // a callback that stops early ends responseBody() right away
+  client.queue(respond("HTTP/1.1 200 OK\r\nContent-Length: 3000\r\n\r\n" + pattern(3000)));
+  CHECK(http.get("/4") == HTTP_SUCCESS);
+  CHECK(http.responseStatusCode() == 200);
+  int calls = 0;
+  CHECK(http.responseBody(stopAfterFirst, &calls) == HTTP_CLIENT_RX_BUFFER_SIZE);
+  CHECK(calls == 1);
+}
+
+static void testConnectionClose()
+{
+  printf("bodies without a length are read until the server closes the connection\n");
+
+  std::string body = pattern(3000);
+  ScriptedClient client;
+  client.queue(trickle("HTTP/1.0 200 OK\r\nConnection: close\r\n\r\n" + body, 700, 20, true));
+
+  HttpClient http(client, "example.com");
+  CHECK(http.get("/close") == HTTP_SUCCESS);
+  CHECK(client.sent.find("Connection: close\r\n") != std::string::npos);
+  CHECK(http.responseStatusCode() == 200);
+  CHECK(http.contentLength() == HttpClient::kNoContentLengthHeader);
+  CHECK(http.responseBody().str() == body);
+  CHECK(!http.connected());
+}
+
+static void testInvalidStatus()
+{
+  printf("a response that is not HTTP is rejected\n");
+
+  ScriptedClient client;
+  client.queue(respond("HTTP/1.1 201 Created\r\nContent-Length: 2\r\n\r\nok"));
+  client.queue(respond("SMTP ready\r\n"));
+
+  HttpClient http(client, "example.com");
+  http.connectionKeepAlive();
+  CHECK(http.post("/", "text/plain", "x") == HTTP_SUCCESS);
+  CHECK(http.responseStatusCode() == 201);
+  CHECK(http.responseBody().str() == "ok");
+
+  CHECK(http.get("/") == HTTP_SUCCESS);
+  CHECK(http.responseStatusCode() == HTTP_ERROR_INVALID_RESPONSE);
+}
+
+/*
+ * Benchmark
+ */
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool countBytes(const uint8_t* data, size_t length, void* context)
+{
+  unsigned long* sum = (unsigned long*) context;
+  for (size_t i = 0; i < length; i++)
+    *sum += data[i];
+  return true;
+}
+
+enum ReadMode { CALLBACK, BLOCKS, BYTES };
+
+static void benchBody(const char* name, const std::string& response, size_t bodySize, ReadMode mode)
+{
+  static const int rounds = 20;
+  unsigned long sum = 0, reads = 0;
+  double elapsed = 0;
+
+  for (int r = 0; r < rounds; r++)
+  {
+    ScriptedClient client;
+    client.queue(respond(response));
+    HttpClient http(client, "example.com");
+    http.get("/");
+    http.responseStatusCode();
+    http.skipResponseHeaders();
+
+    double start = now();
+    if (mode == CALLBACK)
+    {
+      http.responseBody(countBytes, &sum);
+    }
+    else if (mode == BLOCKS)
+    {
+      uint8_t buf[512];
+      int n;
+      while ((n = http.read(buf, sizeof(buf))) > 0)
+        countBytes(buf, n, &sum);
+    }
+    else
+    {
+      while (!http.endOfBodyReached() && http.available())
+        sum += http.read();
+    }
+    elapsed += now() - start;
+    reads += client.reads;
+  }
+
+  printf("  %-44s %7.1f MB/s  %7.1f Client::read() calls per KiB\n",
+         name, bodySize * rounds / elapsed / 1e6, reads * 1024.0 / (bodySize * rounds));
+  if (sum == 0)
+    printf("  (no data)\n");
+}
+
+static void benchmark()
+{
+  const size_t size = 1 << 20;
+  std::string body = pattern(size);
+  std::string fixed = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(size) + "\r\n\r\n" + body;
+  std::string chunks = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n" + chunked(body, 4096);
+
+  printf("1 MiB body, Client::read() returns up to 1460 bytes, HTTP_CLIENT_RX_BUFFER_SIZE %d:\n",
+         HTTP_CLIENT_RX_BUFFER_SIZE);
+  benchBody("fixed length, responseBody(callback)", fixed, size, CALLBACK);
+  benchBody("fixed length, read(buf, 512)", fixed, size, BLOCKS);
+  benchBody("fixed length, read() per byte", fixed, size, BYTES);
+  benchBody("chunked 4 KiB, responseBody(callback)", chunks, size, CALLBACK);
+  benchBody("chunked 4 KiB, read(buf, 512)", chunks, size, BLOCKS);
+  benchBody("chunked 4 KiB, read() per byte", chunks, size, BYTES);
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 1 && strcmp(argv[1], "bench") == 0)
+  {
+    benchmark();
+    return 0;
+  }
+
+  testFixedLength();
+  testChunked();
+  testByteReads();
+  testTrailersAndKeepAlive();
+  testConnectionClose();
+  testInvalidStatus();
+
+  return test_summary();
+}
@@ -0,0 +1,317 @@
+/*
+ * WebSocketClient masking and framing: applyMask() against a byte-wise
+ * reference for every length, offset and alignment, masked frames as a
+ * server would decode them (including fragmented messages), and masked
+ * frames read back in pieces that split the key. The benchmark measures
+ * applyMask() throughput against the byte-wise loop.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -I../../test -Isrc -Itest/host test/websocket.cpp src/WebSocketClient.cpp src/HttpClient.cpp src/b64.cpp -o websocket
+ *   ./websocket          # tests
+ *   ./websocket bench    # applyMask throughput
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+#include "WebSocketClient.h"
+#include "host_test.h"
+
+/*
+ * A Client that accepts the connection upgrade, records what is sent to
+ * it afterwards, and hands out queued frames at most maxRead bytes at a
+ * time.
+ */
+
+class LoopbackClient : public Client
+{
+  public:
+    LoopbackClient() : maxRead(1460), _upgraded(false), _rxPos(0) {}
+
+    // Queue data for the client to read
+    void reply(const std::string& data) { _rx += data; }
+
+    int connect(IPAddress, uint16_t) override { return 1; }
+    int connect(const char*, uint16_t) override { return 1; }
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buf, size_t size) override
+    {
+      if (_upgraded)
+      {
+        frames.append((const char*) buf, size);
+        return size;
+      }
+      request.append((const char*) buf, size);
+      if (request.find("\r\n\r\n") != std::string::npos)
+      {
+        _upgraded = true;
+        reply("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n\r\n");
+      }
+      return size;
+    }
+
+    int available() override { return _rx.size() - _rxPos; }
+    int read() override
+    {
+      uint8_t b;
+      return read(&b, 1) == 1 ? b : -1;
+    }
+    int read(uint8_t* buf, size_t size) override
+    {
+      if (available() <= 0)
+        return -1;
+      size_t n = min(min(size, maxRead), _rx.size() - _rxPos);
+      memcpy(buf, _rx.data() + _rxPos, n);
+      _rxPos += n;
+      return n;
+    }
+    int peek() override { return available() > 0 ? (uint8_t) _rx[_rxPos] : -1; }
+    void stop() override {}
+    uint8_t connected() override { return 1; }
+    operator bool() override { return true; }
+
+    size_t maxRead;
+    std::string request;
+    std::string frames;
+
+  private:
+    bool _upgraded;
+    std::string _rx;
+    size_t _rxPos;
+};
+
+static void referenceMask(uint8_t* data, size_t size, const uint8_t key[4], size_t offset)
+{
+  for (size_t i = 0; i < size; i++)
+    data[i] ^= key[(offset + i) & 3];
+}
+
+struct Frame
+{
+  bool fin;
+  int opcode;
+  std::string payload;
+};
+
+// Decodes one client frame the way a server would, unmasking the payload
+static bool decodeFrame(const std::string& wire, size_t& pos, Frame& frame)
+{
+  if (wire.size() - pos < 2)
+    return false;
+  uint8_t b0 = wire[pos], b1 = wire[pos + 1];
+  pos += 2;
+  frame.fin = (b0 & 0x80) != 0;
+  frame.opcode = b0 & 0x0f;
+  if (!(b1 & 0x80))
+    return false;                       // client frames must be masked
+  uint64_t length = b1 & 0x7f;
+  int extra = (length == 126) ? 2 : (length == 127) ? 8 : 0;
+  if (extra)
+  {
+    length = 0;
+    for (int i = 0; i < extra; i++)
+      length = (length << 8) | (uint8_t) wire[pos++];
+  }
+  uint8_t key[4];
+  memcpy(key, wire.data() + pos, 4);
+  pos += 4;
+  if (wire.size() - pos < length)
+    return false;
+  frame.payload = wire.substr(pos, length);
+  referenceMask((uint8_t*) &frame.payload[0], length, key, 0);
+  pos += length;
+  return true;
+}
+
+static std::string pattern(size_t size)
+{
+  std::string s(size, 0);
+  for (size_t i = 0; i < size; i++)
+    s[i] = (char) (i * 131 + (i >> 8));
+  return s;
+}
+
+/*
+ * Tests
+ */
+
+static void testMaskMatchesReference()
+{
+  printf("applyMask matches the byte-wise reference for every length, offset and alignment\n");
+
+  static const uint8_t key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+  uint8_t buf[80], expect[80];
+  int mismatches = 0;
+
+  for (size_t align = 0; align < 8; align++)
+    for (size_t size = 0; size <= 64; size++)
+      for (size_t offset = 0; offset < 8; offset++)
+      {
+        for (size_t i = 0; i < sizeof(buf); i++)
+          buf[i] = expect[i] = (uint8_t) (i * 13 + 5);
+        WebSocketClient::applyMask(buf + align, size, key, offset);
+        referenceMask(expect + align, size, key, offset);
+        if (memcmp(buf, expect, sizeof(buf)) != 0)
+          mismatches++;
+      }
+  CHECK(mismatches == 0);
+}
+
+static void testMaskRoundTrip()
+{
+  printf("masking twice gives back the data, also when done in pieces\n");
+
+  static const uint8_t key[4] = { 0x01, 0x80, 0xff, 0x5a };
+  std::string data = pattern(1000);
+  std::string buf = data;
+
+  WebSocketClient::applyMask((uint8_t*) &buf[0], buf.size(), key);
+  CHECK(buf != data);
+
+  // unmask in uneven pieces, carrying the offset along as read() does
+  size_t pos = 0, piece = 1;
+  while (pos < buf.size())
+  {
+    size_t n = min(piece, buf.size() - pos);
+    WebSocketClient::applyMask((uint8_t*) &buf[pos], n, key, pos);
+    pos += n;
+    piece = piece * 3 % 17 + 1;
+  }
+  CHECK(buf == data);
+}
+
+static void testSentFrames()
+{
+  printf("sent messages decode to the original payload, fragmented past WS_TX_BUFFER_SIZE\n");
+
+  LoopbackClient client;
+  WebSocketClient ws(client, "example.com", 80);
+  CHECK(ws.begin("/ws") == 0);
+  CHECK(client.request.find("Upgrade: websocket\r\n") != std::string::npos);
+
+  static const size_t sizes[] = { 0, 1, 5, 125, 126, WS_TX_BUFFER_SIZE, WS_TX_BUFFER_SIZE + 1, 3 * WS_TX_BUFFER_SIZE + 44 };
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+  {
+    std::string message = pattern(sizes[s]);
+    client.frames.clear();
+
+    CHECK(ws.beginMessage(TYPE_BINARY) == 0);
+    // write in odd pieces so that the buffer fills at different points
+    for (size_t pos = 0; pos < message.size(); pos += 7)
+      ws.write((const uint8_t*) message.data() + pos, min((size_t) 7, message.size() - pos));
+    CHECK(ws.endMessage() == 0);
+
+    std::string received;
+    size_t pos = 0;
+    int frames = 0;
+    Frame frame;
+    bool fin = false;
+    while (!fin && decodeFrame(client.frames, pos, frame))
+    {
+      CHECK(frame.opcode == (frames == 0 ? TYPE_BINARY : TYPE_CONTINUATION));
+      received += frame.payload;
+      fin = frame.fin;
+      frames++;
+    }
+    CHECK(fin);
+    CHECK(pos == client.frames.size());
+    CHECK(received == message);
+    CHECK(frames == (int) max((size_t) 1, (sizes[s] + WS_TX_BUFFER_SIZE - 1) / WS_TX_BUFFER_SIZE));
+  }
+}
+
+static void testReadMasked()
+{
+  printf("masked frames are unmasked when read in pieces that split the key\n");
+
+  static const uint8_t key[4] = { 0xde, 0xad, 0xbe, 0xef };
+  std::string message = pattern(300);
+  std::string masked = message;
+  referenceMask((uint8_t*) &masked[0], masked.size(), key, 0);
+
+  LoopbackClient client;
+  client.maxRead = 13;
+  WebSocketClient ws(client, "example.com", 80);
+  CHECK(ws.begin("/ws") == 0);
+
+  std::string frame = "\x82\xfe";
+  frame += (char) (message.size() >> 8);
+  frame += (char) (message.size() & 0xff);
+  frame.append((const char*) key, 4);
+  client.reply(frame + masked);
+
+  CHECK(ws.parseMessage() == (int) message.size());
+  CHECK(ws.messageType() == TYPE_BINARY);
+  CHECK(ws.isFinal());
+
+  std::string received;
+  uint8_t buf[11];
+  int n;
+  while ((n = ws.read(buf, 1 + received.size() % sizeof(buf))) > 0)
+    received.append((const char*) buf, n);
+  CHECK(received == message);
+}
+
+/*
+ * Benchmark
+ */
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void benchMask(const char* name, size_t size, size_t align, bool reference)
+{
+  static const uint8_t key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+  static uint8_t buf[4096 + 8];
+  const size_t total = 256 << 20;
+  size_t rounds = total / size;
+
+  double start = now();
+  for (size_t r = 0; r < rounds; r++)
+  {
+    if (reference)
+      referenceMask(buf + align, size, key, r);
+    else
+      WebSocketClient::applyMask(buf + align, size, key, r);
+    // keep the compiler from merging the rounds
+    __asm__ __volatile__("" : : "r"(buf) : "memory");
+  }
+  double elapsed = now() - start;
+
+  printf("  %-36s %5zu B  %8.1f MB/s\n", name, size, rounds * size / elapsed / 1e6);
+}
+
+static void benchmark()
+{
+  printf("applyMask() over buffers of a given size (odd offsets, unaligned start where noted):\n");
+  benchMask("byte-wise reference", WS_TX_BUFFER_SIZE, 0, true);
+  benchMask("applyMask", WS_TX_BUFFER_SIZE, 0, false);
+  benchMask("applyMask, unaligned", WS_TX_BUFFER_SIZE, 1, false);
+  benchMask("byte-wise reference", 1460, 0, true);
+  benchMask("applyMask", 1460, 0, false);
+  benchMask("applyMask, unaligned", 1460, 3, false);
+  benchMask("byte-wise reference", 4096, 0, true);
+  benchMask("applyMask", 4096, 0, false);
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 1 && strcmp(argv[1], "bench") == 0)
+  {
+    benchmark();
+    return 0;
+  }
+
+  testMaskMatchesReference();
+  testMaskRoundTrip();
+  testSentFrames();
+  testReadMasked();
+
+  return test_summary();
+}
@@ -0,0 +1,101 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2025, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+#include "Literals.hpp"
+
+static const MsgPackColumn columns[] = {
+    {"temp", 1},
+    {"hum", 0},
+};
+
+TEST_CASE("MsgPackBatch") {
+  MsgPackBatch<2, 4> batch("t", columns);
+
+  SECTION("empty batch") {
+    std::string output;
+    size_t n = serializeMsgPackBatch(batch, output);
+
+    REQUIRE(output == "\x97\x01\x00\x93\xA1t\xA4temp\xA3hum\x92\x01\x00\x90\x90\x90"_s);
+    REQUIRE(n == output.size());
+  }
+
+  SECTION("writes keys once and deltas afterwards") {
+    batch.add(1000, {25.3f, 60});
+    batch.add(1300, {25.5f, 61});
+    batch.add(1600, {25.4f, 61});
+
+    std::string output;
+    size_t n = serializeMsgPackBatch(batch, output);
+
+    REQUIRE(output ==
+            "\x97\x01\x03"                    // version, count
+            "\x93\xA1t\xA4temp\xA3hum"        // keys
+            "\x92\x01\x00"                    // decimals
+            "\x93\xCD\x03\xE8\xCD\x01\x2C\x00"  // 1000, +300, +0
+            "\x93\xCC\xFD\x02\xFF"            // 253, +2, -1
+            "\x93\x3C\x01\x00"_s);            // 60, +1, +0
+    REQUIRE(n == output.size());
+    REQUIRE(measureMsgPackBatch(batch) == n);
+  }
+
+  SECTION("stores NaN as nil") {
+    batch.add(0, {NAN, 50});
+
+    std::string output;
+    serializeMsgPackBatch(batch, output);
+
+    REQUIRE(output.substr(output.size() - 4) == "\x91\xC0\x91\x32"_s);
+  }
+
+  SECTION("stores raw floats when decimals is negative") {
+    static const MsgPackColumn rawColumns[] = {{"ph", -1}};
+    MsgPackBatch<1, 2> raw("t", rawColumns);
+    raw.add(0, {6.5f});
+
+    std::string output;
+    serializeMsgPackBatch(raw, output);
+
+    REQUIRE(output.substr(output.size() - 6) == "\x91\xCA\x40\xD0\x00\x00"_s);
+  }
+
+  SECTION("add() fails when full") {
+    for (uint32_t i = 0; i < 4; i++)
+      REQUIRE(batch.add(i, {0, 0}) == true);
+
+    REQUIRE(batch.full() == true);
+    REQUIRE(batch.add(5, {0, 0}) == false);
+    REQUIRE(batch.size() == 4);
+
+    batch.clear();
+    REQUIRE(batch.size() == 0);
+  }
+
+  SECTION("output is a valid MessagePack document") {
+    batch.add(1000, {25.3f, 60});
+    batch.add(1300, {25.5f, 61});
+
+    std::string output;
+    serializeMsgPackBatch(batch, output);
+
+    JsonDocument doc;
+    REQUIRE(deserializeMsgPack(doc, output) == DeserializationError::Ok);
+    REQUIRE(doc[1] == 2);
+    REQUIRE(doc[2][1] == "temp");
+    REQUIRE(doc[4][0] == 1000);
+    REQUIRE(doc[4][1] == 300);
+  }
+
+  SECTION("serialize into a fixed-size buffer") {
+    batch.add(1000, {25.3f, 60});
+
+    char buffer[8];
+    size_t n = serializeMsgPackBatch(batch, buffer, sizeof(buffer));
+
+    REQUIRE(n == 8);
+    REQUIRE(std::string(buffer, n) == "\x97\x01\x01\x93\xA1t\xA4t"_s);
+  }
+}
@@ -0,0 +1,112 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2025, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+#include "Literals.hpp"
+
+static const MsgPackColumn columns[] = {
+    {"temp", 1},
+    {"hum", 0},
+    {"ph", -1},
+};
+
+TEST_CASE("MsgPackBatchReader") {
+  MsgPackBatchReader<3> reader;
+  uint32_t t;
+  float values[3];
+
+  SECTION("round-trip") {
+    MsgPackBatch<3, 8> batch("t", columns);
+    batch.add(1000, {25.3f, 60, 6.5f});
+    batch.add(1300, {25.5f, NAN, 6.25f});
+    batch.add(1600, {-3.4f, 61, 7.0f});
+    batch.add(1605, {-3.4f, 59, 7.0f});
+    std::string output;
+    serializeMsgPackBatch(batch, output);
+
+    REQUIRE(reader.begin(output.data(), output.size()) ==
+            DeserializationError::Ok);
+    REQUIRE(reader.size() == 4);
+    REQUIRE(reader.fields() == 3);
+    REQUIRE(reader.timeKey() == "t");
+    REQUIRE(reader.key(0) == "temp");
+    REQUIRE(reader.key(2) == "ph");
+    REQUIRE(reader.key(3).isNull());
+
+    REQUIRE(reader.next(t, values) == true);
+    REQUIRE(t == 1000);
+    REQUIRE(values[0] == Approx(25.3f));
+    REQUIRE(values[1] == 60);
+    REQUIRE(values[2] == 6.5f);
+
+    REQUIRE(reader.next(t, values) == true);
+    REQUIRE(t == 1300);
+    REQUIRE(values[0] == Approx(25.5f));
+    REQUIRE(values[1] != values[1]);  // NaN
+    REQUIRE(values[2] == 6.25f);
+
+    REQUIRE(reader.next(t, values) == true);
+    REQUIRE(t == 1600);
+    REQUIRE(values[0] == Approx(-3.4f));
+    REQUIRE(values[1] == 61);
+
+    REQUIRE(reader.next(t, values) == true);
+    REQUIRE(t == 1605);
+    REQUIRE(values[1] == 59);
+
+    REQUIRE(reader.next(t, values) == false);
+  }
+
+  SECTION("timestamps survive wrap-around") {
+    MsgPackBatch<3, 4> batch("t", columns);
+    batch.add(0xFFFFFFF0, {0, 0, 0});
+    batch.add(0x00000010, {0, 0, 0});
+    batch.add(0x7FFFFFFF, {0, 0, 0});
+    std::string output;
+    serializeMsgPackBatch(batch, output);
+
+    REQUIRE(reader.begin(output.data(), output.size()) ==
+            DeserializationError::Ok);
+    REQUIRE(reader.next(t, values));
+    REQUIRE(t == 0xFFFFFFF0);
+    REQUIRE(reader.next(t, values));
+    REQUIRE(t == 0x00000010);
+    REQUIRE(reader.next(t, values));
+    REQUIRE(t == 0x7FFFFFFF);
+  }
+
+  SECTION("EmptyInput") {
+    REQUIRE(reader.begin("", 0) == DeserializationError::EmptyInput);
+  }
+
+  SECTION("InvalidInput") {
+    REQUIRE(reader.begin("\x92\x01\x00", 3) ==
+            DeserializationError::InvalidInput);
+    REQUIRE(reader.next(t, values) == false);
+  }
+
+  SECTION("InvalidInput if version is unknown") {
+    auto input = "\x95\x02\x00\x91\xA1t\x90\x90"_s;
+    REQUIRE(reader.begin(input.data(), input.size()) ==
+            DeserializationError::InvalidInput);
+  }
+
+  SECTION("IncompleteInput") {
+    auto input = "\x96\x01\x02\x92\xA1t\xA1x\x91\x00\x92\x01\x01\x92\x01"_s;
+    REQUIRE(reader.begin(input.data(), input.size()) ==
+            DeserializationError::IncompleteInput);
+  }
+
+  SECTION("NoMemory if there are too many fields") {
+    MsgPackBatchReader<1> small;
+    MsgPackBatch<3, 1> batch("t", columns);
+    std::string output;
+    serializeMsgPackBatch(batch, output);
+
+    REQUIRE(small.begin(output.data(), output.size()) ==
+            DeserializationError::NoMemory);
+  }
+}
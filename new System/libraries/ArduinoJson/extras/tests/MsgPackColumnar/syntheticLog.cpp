@@ -0,0 +1,162 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2025, Benoit BLANCHON
+// MIT License
+
+#include <ArduinoJson.h>
+#include <catch.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// One week of RDTRC environmental samples, one every five minutes
+static const size_t logSize = 7 * 24 * 12;
+
+static const MsgPackColumn columns[] = {
+    {"temperature", 1}, {"humidity", 1}, {"soilMoisture", 0},
+    {"waterLevel", 1},  {"co2Level", 0}, {"lightLevel", 0},
+};
+
+struct Sample {
+  uint32_t timestamp;
+  float values[6];
+};
+
+static std::vector<Sample> generateLog() {
+  std::vector<Sample> log;
+  uint32_t seed = 42;
+  auto noise = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return int((seed >> 16) % 5) - 2;
+  };
+  float water = 40;
+  for (size_t i = 0; i < logSize; i++) {
+    double day = std::sin(2 * 3.14159265 * double(i % 288) / 288);
+    Sample s;
+    s.timestamp = uint32_t(1735689600 + i * 300 + (i % 97 == 0 ? 1 : 0));
+    s.values[0] = std::round(float(28 + 4 * day) * 10 + float(noise())) / 10;
+    s.values[1] = std::round(float(70 - 12 * day) * 10 + float(noise())) / 10;
+    s.values[2] = float(55 - int(i % 144) / 8 + noise());
+    water -= 0.01f;
+    s.values[3] = std::round(water * 10) / 10;
+    s.values[4] = float(450 + int(30 * day) + noise());
+    s.values[5] = float(day > 0 ? int(2500 * day) : 0);
+    log.push_back(s);
+  }
+  return log;
+}
+
+static std::string toJsonLines(const std::vector<Sample>& log) {
+  std::string output, line;
+  JsonDocument doc;
+  for (const Sample& s : log) {
+    doc.clear();
+    doc["timestamp"] = s.timestamp;
+    for (size_t f = 0; f < 6; f++)
+      doc[columns[f].key] = s.values[f];
+    serializeJson(doc, line);
+    output += line;
+    output += '\n';
+  }
+  return output;
+}
+
+static std::string toColumnar(const std::vector<Sample>& log) {
+  static MsgPackBatch<6, logSize> batch("timestamp", columns);
+  batch.clear();
+  for (const Sample& s : log)
+    batch.add(s.timestamp, s.values);
+  std::string output;
+  serializeMsgPackBatch(batch, output);
+  return output;
+}
+
+TEST_CASE("MsgPackBatch with a one-week synthetic log") {
+  std::vector<Sample> log = generateLog();
+  std::string json = toJsonLines(log);
+  std::string columnar = toColumnar(log);
+
+  SECTION("is much smaller than JSON lines") {
+    INFO("JSON lines: " << json.size() << " bytes, columnar: "
+                        << columnar.size() << " bytes");
+    REQUIRE(columnar.size() * 6 < json.size());
+  }
+
+  SECTION("decodes every record") {
+    MsgPackBatchReader<6> reader;
+    REQUIRE(reader.begin(columnar.data(), columnar.size()) ==
+            DeserializationError::Ok);
+    REQUIRE(reader.size() == logSize);
+
+    uint32_t t;
+    float values[6];
+    for (const Sample& s : log) {
+      REQUIRE(reader.next(t, values));
+      REQUIRE(t == s.timestamp);
+      for (size_t f = 0; f < 6; f++)
+        REQUIRE(values[f] == Approx(s.values[f]).margin(0.05));
+    }
+    REQUIRE(reader.next(t, values) == false);
+  }
+}
+
+// Run with: MsgPackColumnarTests "[benchmark]"
+TEST_CASE("MsgPackBatch throughput", "[.][benchmark]") {
+  typedef std::chrono::steady_clock clock;
+  const int rounds = 50;
+
+  std::vector<Sample> log = generateLog();
+  std::string json = toJsonLines(log);
+  std::string columnar = toColumnar(log);
+
+  auto seconds = [](clock::time_point start) {
+    return std::chrono::duration<double>(clock::now() - start).count();
+  };
+  auto rate = [&](double elapsed) {
+    return double(logSize) * rounds / elapsed / 1e6;
+  };
+
+  auto start = clock::now();
+  for (int i = 0; i < rounds; i++)
+    toJsonLines(log);
+  double jsonEncode = seconds(start);
+
+  start = clock::now();
+  for (int i = 0; i < rounds; i++)
+    toColumnar(log);
+  double columnarEncode = seconds(start);
+
+  start = clock::now();
+  for (int i = 0; i < rounds; i++) {
+    std::istringstream lines(json);
+    std::string line;
+    JsonDocument doc;
+    while (std::getline(lines, line))
+      deserializeJson(doc, line);
+  }
+  double jsonDecode = seconds(start);
+
+  start = clock::now();
+  for (int i = 0; i < rounds; i++) {
+    MsgPackBatchReader<6> reader;
+    reader.begin(columnar.data(), columnar.size());
+    uint32_t t;
+    float values[6];
+    while (reader.next(t, values)) {
+    }
+  }
+  double columnarDecode = seconds(start);
+
+  std::cout << "records:        " << logSize << "\n"
+            << "JSON lines:     " << json.size() << " bytes, encode "
+            << rate(jsonEncode) << " Mrec/s, decode " << rate(jsonDecode)
+            << " Mrec/s\n"
+            << "columnar:       " << columnar.size() << " bytes, encode "
+            << rate(columnarEncode) << " Mrec/s, decode "
+            << rate(columnarDecode) << " Mrec/s\n"
+            << "ratio:          "
+            << double(json.size()) / double(columnar.size()) << "x\n";
+}
@@ -0,0 +1,580 @@
+// ArduinoJson - https://arduinojson.org
+// Copyright © 2014-2025, Benoit BLANCHON
+// MIT License
+
+#pragma once
+
+#include <ArduinoJson/Deserialization/DeserializationError.hpp>
+#include <ArduinoJson/MsgPack/endianness.hpp>
+#include <ArduinoJson/Numbers/FloatTraits.hpp>
+#include <ArduinoJson/Polyfills/math.hpp>
+#include <ArduinoJson/Serialization/CountingDecorator.hpp>
+#include <ArduinoJson/Serialization/Writer.hpp>
+#include <ArduinoJson/Serialization/Writers/DummyWriter.hpp>
+#include <ArduinoJson/Strings/JsonString.hpp>
+
+// A columnar batch is a regular MessagePack array, so deserializeMsgPack() can
+// still read it, laid out as:
+//
+//   [ 1,                         format version
+//     N,                         number of records
+//     [timeKey, key1, ...],      key table, written once
+//     [decimals1, ...],          codec of each field
+//     [t0, t1-t0, dod2, ...],    timestamps, delta-of-delta
+//     [field1 x N], ...          one array per field ]
+//
+// A field with decimals >= 0 is stored as a fixed-point integer, the first
+// value absolute and the following ones as deltas; NaN is stored as nil.
+// A field with decimals < 0 is stored as raw float32.
+
+ARDUINOJSON_BEGIN_PRIVATE_NAMESPACE
+
+const uint8_t msgPackColumnarVersion = 1;
+
+inline float msgPackColumnarScale(int8_t decimals) {
+  float scale = 1;
+  for (int8_t i = 0; i < decimals; i++)
+    scale *= 10;
+  return scale;
+}
+
+// Converts a value to fixed-point; returns false if it can't be represented.
+inline bool msgPackColumnarToFixed(float value, float scale, int32_t& result) {
+  if (isnan(value))
+    return false;
+  float scaled = value * scale;
+  if (scaled >= 2147483520.0f || scaled <= -2147483520.0f)
+    return false;
+  result = int32_t(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+  return true;
+}
+
+template <typename TWriter>
+class MsgPackColumnarWriter {
+ public:
+  explicit MsgPackColumnarWriter(TWriter writer) : writer_(writer) {}
+
+  void writeArrayHeader(size_t n) {
+    if (n < 0x10) {
+      writeByte(uint8_t(0x90 + n));
+    } else if (n < 0x10000) {
+      writeByte(0xDC);
+      writeInteger(uint16_t(n));
+    } else {
+      writeByte(0xDD);
+      writeInteger(uint32_t(n));
+    }
+  }
+
+  void writeString(const char* s) {
+    size_t n = ::strlen(s);
+    if (n < 0x20) {
+      writeByte(uint8_t(0xA0 + n));
+    } else if (n < 0x100) {
+      writeByte(0xD9);
+      writeInteger(uint8_t(n));
+    } else {
+      writeByte(0xDA);
+      writeInteger(uint16_t(n));
+    }
+    writer_.write(reinterpret_cast<const uint8_t*>(s), n);
+  }
+
+  void writeSigned(int32_t value) {
+    if (value >= 0) {
+      writeUnsigned(uint32_t(value));
+    } else if (value >= -0x20) {
+      writeInteger(int8_t(value));
+    } else if (value >= -0x80) {
+      writeByte(0xD0);
+      writeInteger(int8_t(value));
+    } else if (value >= -0x8000) {
+      writeByte(0xD1);
+      writeInteger(int16_t(value));
+    } else {
+      writeByte(0xD2);
+      writeInteger(int32_t(value));
+    }
+  }
+
+  void writeUnsigned(uint32_t value) {
+    if (value <= 0x7F) {
+      writeInteger(uint8_t(value));
+    } else if (value <= 0xFF) {
+      writeByte(0xCC);
+      writeInteger(uint8_t(value));
+    } else if (value <= 0xFFFF) {
+      writeByte(0xCD);
+      writeInteger(uint16_t(value));
+    } else {
+      writeByte(0xCE);
+      writeInteger(uint32_t(value));
+    }
+  }
+
+  void writeFloat(float value) {
+    writeByte(0xCA);
+    writeInteger(value);
+  }
+
+  void writeNil() {
+    writeByte(0xC0);
+  }
+
+  size_t bytesWritten() const {
+    return writer_.count();
+  }
+
+ private:
+  void writeByte(uint8_t c) {
+    writer_.write(c);
+  }
+
+  template <typename T>
+  void writeInteger(T value) {
+    fixEndianness(value);
+    writer_.write(reinterpret_cast<uint8_t*>(&value), sizeof(value));
+  }
+
+  CountingDecorator<TWriter> writer_;
+};
+
+// Reads the subset of MessagePack produced by MsgPackColumnarWriter straight
+// from a memory buffer, without allocating.
+class MsgPackColumnarReader {
+ public:
+  MsgPackColumnarReader() : ptr_(nullptr), end_(nullptr) {}
+
+  MsgPackColumnarReader(const uint8_t* begin, const uint8_t* end)
+      : ptr_(begin), end_(end) {}
+
+  bool readArrayHeader(size_t& n) {
+    uint8_t code;
+    if (!readByte(code))
+      return false;
+    if ((code & 0xF0) == 0x90) {
+      n = code & 0x0F;
+      return true;
+    }
+    if (code == 0xDC) {
+      uint16_t size;
+      if (!readInteger(size))
+        return false;
+      n = size;
+      return true;
+    }
+    if (code == 0xDD) {
+      uint32_t size;
+      if (!readInteger(size))
+        return false;
+      n = size;
+      return true;
+    }
+    return false;
+  }
+
+  bool readString(JsonString& str) {
+    uint8_t code;
+    if (!readByte(code))
+      return false;
+    size_t n;
+    if ((code & 0xE0) == 0xA0) {
+      n = code & 0x1F;
+    } else if (code == 0xD9) {
+      uint8_t size;
+      if (!readInteger(size))
+        return false;
+      n = size;
+    } else if (code == 0xDA) {
+      uint16_t size;
+      if (!readInteger(size))
+        return false;
+      n = size;
+    } else {
+      return false;
+    }
+    if (size_t(end_ - ptr_) < n)
+      return false;
+    str = JsonString(reinterpret_cast<const char*>(ptr_), n, true);
+    ptr_ += n;
+    return true;
+  }
+
+  // Reads an integer that fits in 32 bits; the unsigned forms are returned
+  // bit-for-bit so that timestamps above INT32_MAX survive.
+  bool readInt32(int32_t& value) {
+    uint8_t code;
+    if (!readByte(code))
+      return false;
+    if (code <= 0x7F) {
+      value = code;
+      return true;
+    }
+    if (code >= 0xE0) {
+      value = int8_t(code);
+      return true;
+    }
+    switch (code) {
+      case 0xCC:
+        return readAs<uint8_t>(value);
+      case 0xCD:
+        return readAs<uint16_t>(value);
+      case 0xCE:
+        return readAs<uint32_t>(value);
+      case 0xD0:
+        return readAs<int8_t>(value);
+      case 0xD1:
+        return readAs<int16_t>(value);
+      case 0xD2:
+        return readAs<int32_t>(value);
+      default:
+        return false;
+    }
+  }
+
+  // Reads a fixed-point value; nil sets isNull.
+  bool readFixed(int32_t& value, bool& isNull) {
+    if (ptr_ < end_ && *ptr_ == 0xC0) {
+      ptr_++;
+      isNull = true;
+      return true;
+    }
+    isNull = false;
+    return readInt32(value);
+  }
+
+  bool readFloat(float& value) {
+    uint8_t code;
+    if (!readByte(code) || code != 0xCA)
+      return false;
+    return readInteger(value);
+  }
+
+ private:
+  bool readByte(uint8_t& c) {
+    if (ptr_ >= end_)
+      return false;
+    c = *ptr_++;
+    return true;
+  }
+
+  template <typename T>
+  bool readInteger(T& value) {
+    if (size_t(end_ - ptr_) < sizeof(T))
+      return false;
+    memcpy(&value, ptr_, sizeof(T));
+    fixEndianness(value);
+    ptr_ += sizeof(T);
+    return true;
+  }
+
+  template <typename T>
+  bool readAs(int32_t& value) {
+    T tmp;
+    if (!readInteger(tmp))
+      return false;
+    value = int32_t(tmp);
+    return true;
+  }
+
+  const uint8_t* ptr_;
+  const uint8_t* end_;
+};
+
+ARDUINOJSON_END_PRIVATE_NAMESPACE
+
+ARDUINOJSON_BEGIN_PUBLIC_NAMESPACE
+
+// Describes one field of a MsgPackBatch.
+struct MsgPackColumn {
+  const char* key;
+  // Number of decimals kept by the fixed-point codec, or -1 for raw float32.
+  int8_t decimals;
+};
+
+// Accumulates up to TCapacity records of TFields values, stored as
+// struct-of-arrays, and serializes them as a columnar MessagePack batch.
+// https://arduinojson.org/v7/api/msgpack/
+template <size_t TFields, size_t TCapacity>
+class MsgPackBatch {
+  static_assert(TFields > 0, "MsgPackBatch needs at least one field");
+
+ public:
+  MsgPackBatch(const char* timeKey, const MsgPackColumn (&cols)[TFields])
+      : timeKey_(timeKey), columns_(cols), size_(0) {}
+
+  // Appends a record; returns false if the batch is full.
+  bool add(uint32_t timestamp, const float (&values)[TFields]) {
+    if (size_ >= TCapacity)
+      return false;
+    timestamps_[size_] = timestamp;
+    for (size_t i = 0; i < TFields; i++)
+      values_[i][size_] = values[i];
+    size_++;
+    return true;
+  }
+
+  void clear() {
+    size_ = 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool full() const {
+    return size_ >= TCapacity;
+  }
+
+  template <typename TWriter>
+  size_t writeTo(TWriter writer) const {
+    detail::MsgPackColumnarWriter<TWriter> out(writer);
+
+    out.writeArrayHeader(5 + TFields);
+    out.writeUnsigned(detail::msgPackColumnarVersion);
+    out.writeUnsigned(uint32_t(size_));
+
+    out.writeArrayHeader(1 + TFields);
+    out.writeString(timeKey_);
+    for (size_t i = 0; i < TFields; i++)
+      out.writeString(columns_[i].key);
+
+    out.writeArrayHeader(TFields);
+    for (size_t i = 0; i < TFields; i++)
+      out.writeSigned(columns_[i].decimals);
+
+    out.writeArrayHeader(size_);
+    uint32_t previousDelta = 0;
+    for (size_t i = 0; i < size_; i++) {
+      if (i == 0) {
+        out.writeUnsigned(timestamps_[0]);
+        continue;
+      }
+      uint32_t delta = timestamps_[i] - timestamps_[i - 1];
+      if (i == 1)
+        out.writeSigned(int32_t(delta));
+      else
+        out.writeSigned(int32_t(delta - previousDelta));
+      previousDelta = delta;
+    }
+
+    for (size_t f = 0; f < TFields; f++) {
+      out.writeArrayHeader(size_);
+      int8_t decimals = columns_[f].decimals;
+      if (decimals < 0) {
+        for (size_t i = 0; i < size_; i++)
+          out.writeFloat(values_[f][i]);
+        continue;
+      }
+      float scale = detail::msgPackColumnarScale(decimals);
+      uint32_t previous = 0;
+      for (size_t i = 0; i < size_; i++) {
+        int32_t fixed;
+        if (!detail::msgPackColumnarToFixed(values_[f][i], scale, fixed)) {
+          out.writeNil();
+          continue;
+        }
+        out.writeSigned(int32_t(uint32_t(fixed) - previous));
+        previous = uint32_t(fixed);
+      }
+    }
+
+    return out.bytesWritten();
+  }
+
+ private:
+  const char* timeKey_;
+  const MsgPackColumn* columns_;
+  size_t size_;
+  uint32_t timestamps_[TCapacity];
+  float values_[TFields][TCapacity];
+};
+
+// Decodes a columnar MessagePack batch in place, one record at a time.
+// The input buffer must outlive the reader; keys point into it.
+// https://arduinojson.org/v7/api/msgpack/
+template <size_t TMaxFields>
+class MsgPackBatchReader {
+ public:
+  MsgPackBatchReader() : size_(0), fields_(0), remaining_(0) {}
+
+  DeserializationError begin(const void* data, size_t length) {
+    using detail::MsgPackColumnarReader;
+
+    size_ = fields_ = remaining_ = 0;
+    if (!data || !length)
+      return DeserializationError::EmptyInput;
+
+    auto p = reinterpret_cast<const uint8_t*>(data);
+    MsgPackColumnarReader in(p, p + length);
+
+    size_t outer, keyCount, codecCount, timeCount;
+    int32_t version, count;
+    if (!in.readArrayHeader(outer) || !in.readInt32(version) ||
+        !in.readInt32(count) || !in.readArrayHeader(keyCount))
+      return DeserializationError::InvalidInput;
+    if (version != detail::msgPackColumnarVersion || keyCount < 1 ||
+        outer != keyCount + 4 || count < 0)
+      return DeserializationError::InvalidInput;
+
+    size_t fields = keyCount - 1;
+    if (fields > TMaxFields)
+      return DeserializationError::NoMemory;
+
+    if (!in.readString(timeKey_))
+      return DeserializationError::InvalidInput;
+    for (size_t i = 0; i < fields; i++) {
+      if (!in.readString(keys_[i]))
+        return DeserializationError::InvalidInput;
+    }
+
+    if (!in.readArrayHeader(codecCount) || codecCount != fields)
+      return DeserializationError::InvalidInput;
+    for (size_t i = 0; i < fields; i++) {
+      int32_t decimals;
+      if (!in.readInt32(decimals) || decimals > 9)
+        return DeserializationError::InvalidInput;
+      decimals_[i] = int8_t(decimals < 0 ? -1 : decimals);
+    }
+
+    // Record where each column starts, validating it on the way, so that
+    // next() only has to advance the cursors.
+    if (!in.readArrayHeader(timeCount) || timeCount != size_t(count))
+      return DeserializationError::InvalidInput;
+    timeCursor_ = in;
+    for (size_t i = 0; i < timeCount; i++) {
+      int32_t dummy;
+      if (!in.readInt32(dummy))
+        return DeserializationError::IncompleteInput;
+    }
+    for (size_t f = 0; f < fields; f++) {
+      size_t n;
+      if (!in.readArrayHeader(n) || n != size_t(count))
+        return DeserializationError::InvalidInput;
+      cursors_[f] = in;
+      for (size_t i = 0; i < n; i++) {
+        bool ok;
+        if (decimals_[f] < 0) {
+          float dummy;
+          ok = in.readFloat(dummy);
+        } else {
+          int32_t dummy;
+          bool isNull;
+          ok = in.readFixed(dummy, isNull);
+        }
+        if (!ok)
+          return DeserializationError::IncompleteInput;
+      }
+      previous_[f] = 0;
+    }
+
+    size_ = remaining_ = size_t(count);
+    fields_ = fields;
+    index_ = 0;
+    timestamp_ = timeDelta_ = 0;
+    return DeserializationError::Ok;
+  }
+
+  // Number of records in the batch.
+  size_t size() const {
+    return size_;
+  }
+
+  // Number of fields per record, excluding the timestamp.
+  size_t fields() const {
+    return fields_;
+  }
+
+  JsonString timeKey() const {
+    return timeKey_;
+  }
+
+  JsonString key(size_t field) const {
+    return field < fields_ ? keys_[field] : JsonString();
+  }
+
+  // Decodes the next record; returns false when the batch is exhausted.
+  // values must have room for fields() entries; missing samples read as NaN.
+  bool next(uint32_t& timestamp, float* values) {
+    if (!remaining_)
+      return false;
+
+    int32_t t;
+    timeCursor_.readInt32(t);
+    if (index_ == 0) {
+      timestamp_ = uint32_t(t);
+    } else {
+      if (index_ == 1)
+        timeDelta_ = uint32_t(t);
+      else
+        timeDelta_ += uint32_t(t);
+      timestamp_ += timeDelta_;
+    }
+    timestamp = timestamp_;
+
+    for (size_t f = 0; f < fields_; f++) {
+      if (decimals_[f] < 0) {
+        cursors_[f].readFloat(values[f]);
+        continue;
+      }
+      int32_t delta;
+      bool isNull;
+      cursors_[f].readFixed(delta, isNull);
+      if (isNull) {
+        values[f] = detail::FloatTraits<float>::nan();
+        continue;
+      }
+      previous_[f] += uint32_t(delta);
+      values[f] = float(int32_t(previous_[f])) /
+                  detail::msgPackColumnarScale(decimals_[f]);
+    }
+
+    index_++;
+    remaining_--;
+    return true;
+  }
+
+ private:
+  size_t size_;
+  size_t fields_;
+  size_t remaining_;
+  size_t index_;
+  uint32_t timestamp_;
+  uint32_t timeDelta_;
+  JsonString timeKey_;
+  JsonString keys_[TMaxFields];
+  int8_t decimals_[TMaxFields];
+  uint32_t previous_[TMaxFields];
+  detail::MsgPackColumnarReader timeCursor_;
+  detail::MsgPackColumnarReader cursors_[TMaxFields];
+};
+
+// Produces a columnar MessagePack batch.
+// https://arduinojson.org/v7/api/msgpack/
+template <size_t TFields, size_t TCapacity, typename TDestination,
+          detail::enable_if_t<!detail::is_pointer<TDestination>::value, int> = 0>
+inline size_t serializeMsgPackBatch(
+    const MsgPackBatch<TFields, TCapacity>& batch, TDestination& output) {
+  detail::Writer<TDestination> writer(output);
+  return batch.writeTo(writer);
+}
+
+// Produces a columnar MessagePack batch.
+// https://arduinojson.org/v7/api/msgpack/
+template <size_t TFields, size_t TCapacity>
+inline size_t serializeMsgPackBatch(
+    const MsgPackBatch<TFields, TCapacity>& batch, void* output, size_t size) {
+  detail::StaticStringWriter writer(reinterpret_cast<char*>(output), size);
+  return batch.writeTo(writer);
+}
+
+// Computes the length of the batch that serializeMsgPackBatch() produces.
+// https://arduinojson.org/v7/api/msgpack/
+template <size_t TFields, size_t TCapacity>
+inline size_t measureMsgPackBatch(
+    const MsgPackBatch<TFields, TCapacity>& batch) {
+  detail::DummyWriter writer;
+  return batch.writeTo(writer);
+}
+
+ARDUINOJSON_END_PUBLIC_NAMESPACE
@@ -82,6 +82,21 @@ JSONVar JSONClass::parse(const String& s)
   return JSONVar::parse(s);
 }
 
+JSONVar JSONClass::parseArena(const char* s)
+{
+  return JSONVar::parseArena(s);
+}
+
+JSONVar JSONClass::parseArena(const String& s)
+{
+  return JSONVar::parseArena(s);
+}
+
+JSONVar JSONClass::parseInPlace(char* s)
+{
+  return JSONVar::parseInPlace(s);
+}
+
 String JSONClass::stringify(const JSONVar& value)
 {
   return JSONVar::stringify(value);
@@ -31,6 +31,9 @@ public:
 
   JSONVar parse(const char* s);
   JSONVar parse(const String& s);
+  JSONVar parseArena(const char* s);
+  JSONVar parseArena(const String& s);
+  JSONVar parseInPlace(char* s);
 
   String stringify(const JSONVar& value);
 
@@ -23,7 +23,8 @@
 
 JSONVar::JSONVar(struct cJSON* json, struct cJSON* parent) :
   _json(json),
-  _parent(parent)
+  _parent(parent),
+  _arena(NULL)
 {
 }
 
@@ -103,12 +104,15 @@ JSONVar::JSONVar(const JSONVar& v)
 {
   _json = cJSON_Duplicate(v._json, true);
   _parent = NULL;
+  _arena = NULL;
 }
 
 #if __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__)
-JSONVar::JSONVar(JSONVar&& v)
+JSONVar::JSONVar(JSONVar&& v) :
+  JSONVar()
 {
   cJSON* tmp;
+  cJSON_Arena* arena;
 
   // swap _json
   tmp = _json;
@@ -119,6 +123,11 @@ JSONVar::JSONVar(JSONVar&& v)
   tmp = _parent;
   _parent = v._parent;
   v._parent = tmp;
+
+  // swap arena
+  arena = _arena;
+  _arena = v._arena;
+  v._arena = arena;
 }
 #endif
 
@@ -140,6 +149,8 @@ JSONVar::~JSONVar()
 
     _json = NULL;
   }
+
+  deleteArena();
 }
 
 size_t JSONVar::printTo(Print& p) const
@@ -245,6 +256,7 @@ void JSONVar::operator=(const JSONVar& v)
 JSONVar& JSONVar::operator=(JSONVar&& v)
 {
   cJSON* tmp;
+  cJSON_Arena* arena;
 
   // swap _json
   tmp = _json;
@@ -256,6 +268,11 @@ JSONVar& JSONVar::operator=(JSONVar&& v)
   _parent = v._parent;
   v._parent = tmp;
 
+  // swap arena
+  arena = _arena;
+  _arena = v._arena;
+  v._arena = arena;
+
   return *this;
 }
 #endif
@@ -448,6 +465,41 @@ JSONVar JSONVar::parse(const String& s)
   return parse(s.c_str());
 }
 
+JSONVar JSONVar::parseArena(const char* s)
+{
+  size_t length = strlen(s) + 1;
+  JSONVar result;
+
+  result._arena = cJSON_CreateArena(cJSON_ArenaSizeFor(s, length, false));
+  result._json = cJSON_ParseInArena(result._arena, s, length);
+
+  if (result._json == NULL) {
+    result.deleteArena();
+  }
+
+  return result;
+}
+
+JSONVar JSONVar::parseArena(const String& s)
+{
+  return parseArena(s.c_str());
+}
+
+JSONVar JSONVar::parseInPlace(char* s)
+{
+  size_t length = strlen(s) + 1;
+  JSONVar result;
+
+  result._arena = cJSON_CreateArena(cJSON_ArenaSizeFor(s, length, true));
+  result._json = cJSON_ParseInPlace(result._arena, s, length);
+
+  if (result._json == NULL) {
+    result.deleteArena();
+  }
+
+  return result;
+}
+
 String JSONVar::stringify(const JSONVar& value)
 {
   if (value._json == NULL) {
@@ -501,10 +553,21 @@ void JSONVar::replaceJson(struct cJSON* json)
       }
     } else {
       cJSON_Delete(old);
+
+      deleteArena();
     }
   }
 }
 
+void JSONVar::deleteArena()
+{
+  if (_arena != NULL) {
+    cJSON_DeleteArena(_arena);
+
+    _arena = NULL;
+  }
+}
+
 //---------------------------------------------------------------------
 
 bool JSONVar::hasPropertyEqual(const char* key,  const char* value) const {
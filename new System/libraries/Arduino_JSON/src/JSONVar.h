@@ -23,6 +23,7 @@
 #include <Arduino.h>
 
 struct cJSON;
+struct cJSON_Arena;
 
 #define typeof typeof_
 #define null nullptr
@@ -107,6 +108,9 @@ public:
 
   static JSONVar parse(const char* s);
   static JSONVar parse(const String& s);
+  static JSONVar parseArena(const char* s);
+  static JSONVar parseArena(const String& s);
+  static JSONVar parseInPlace(char* s);
   static String stringify(const JSONVar& value);
   static String typeof_(const JSONVar& value);
 
@@ -114,10 +118,12 @@ private:
   JSONVar(struct cJSON* json, struct cJSON* parent);
 
   void replaceJson(struct cJSON* json);
+  void deleteArena();
 
 private:
   struct cJSON* _json;
   struct cJSON* _parent;
+  struct cJSON_Arena* _arena;
 };
 
 extern JSONVar undefined;
@@ -260,7 +260,7 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
         {
             cJSON_Delete(item->child);
         }
-        if (!(item->type & cJSON_IsReference) && (item->valuestring != NULL))
+        if (!(item->type & (cJSON_IsReference | cJSON_InArena)) && (item->valuestring != NULL))
         {
             global_hooks.deallocate(item->valuestring);
         }
@@ -268,11 +268,140 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
         {
             global_hooks.deallocate(item->string);
         }
-        global_hooks.deallocate(item);
+        if (!(item->type & cJSON_InArena))
+        {
+            global_hooks.deallocate(item);
+        }
         item = next;
     }
 }
 
+/* An arena hands out memory from a chain of blocks, newest first. Items are
+ * taken from the front of a block and strings from the back, so strings cost
+ * no alignment padding. The first block shares the arena's own allocation. */
+typedef struct cJSON_ArenaBlock
+{
+    struct cJSON_ArenaBlock *next;
+    size_t front;
+    size_t back;
+} cJSON_ArenaBlock;
+
+struct cJSON_Arena
+{
+    cJSON_ArenaBlock *blocks;
+    size_t block_size;
+};
+
+#define arena_align(size) (((size) + sizeof(double) - 1) & ~(sizeof(double) - 1))
+#define arena_block_data(block) ((unsigned char*)(block) + arena_align(sizeof(cJSON_ArenaBlock)))
+
+static cJSON_ArenaBlock *arena_init_block(void *memory, size_t size)
+{
+    cJSON_ArenaBlock *block = (cJSON_ArenaBlock*)memory;
+
+    block->next = NULL;
+    block->front = 0;
+    block->back = size;
+
+    return block;
+}
+
+CJSON_PUBLIC(cJSON_Arena *) cJSON_CreateArena(size_t block_size)
+{
+    cJSON_Arena *arena = NULL;
+
+    if (block_size == 0)
+    {
+        block_size = CJSON_ARENA_BLOCK_SIZE;
+    }
+
+    arena = (cJSON_Arena*)global_hooks.allocate(arena_align(sizeof(cJSON_Arena)) + arena_align(sizeof(cJSON_ArenaBlock)) + block_size);
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    arena->blocks = arena_init_block((unsigned char*)arena + arena_align(sizeof(cJSON_Arena)), block_size);
+    arena->block_size = block_size;
+
+    return arena;
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteArena(cJSON_Arena *arena)
+{
+    cJSON_ArenaBlock *block = NULL;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    /* every block but the last one in the chain was allocated on its own */
+    block = arena->blocks;
+    while (block->next != NULL)
+    {
+        cJSON_ArenaBlock *next = block->next;
+        global_hooks.deallocate(block);
+        block = next;
+    }
+
+    global_hooks.deallocate(arena);
+}
+
+static void *arena_allocate(cJSON_Arena * const arena, size_t size, cJSON_bool aligned)
+{
+    cJSON_ArenaBlock *block = arena->blocks;
+    size_t front = aligned ? arena_align(block->front) : block->front;
+
+    if ((front > block->back) || (size > (block->back - front)))
+    {
+        /* start a new block, the rest of the current one stays unused */
+        size_t block_size = (arena->block_size > size) ? arena->block_size : size;
+        void *memory = global_hooks.allocate(arena_align(sizeof(cJSON_ArenaBlock)) + block_size);
+        if (memory == NULL)
+        {
+            return NULL;
+        }
+
+        block = arena_init_block(memory, block_size);
+        block->next = arena->blocks;
+        arena->blocks = block;
+        front = 0;
+    }
+
+    if (aligned)
+    {
+        block->front = front + size;
+        return arena_block_data(block) + front;
+    }
+
+    block->back -= size;
+    return arena_block_data(block) + block->back;
+}
+
+CJSON_PUBLIC(size_t) cJSON_ArenaSizeFor(const char *value, size_t buffer_length, cJSON_bool in_place)
+{
+    /* every item but the root is created after a '[', '{' or ',' (counting those inside strings overestimates) */
+    size_t items = 1;
+    size_t i = 0;
+
+    if (value == NULL)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < buffer_length; i++)
+    {
+        if ((value[i] == ',') || (value[i] == '[') || (value[i] == '{'))
+        {
+            items++;
+        }
+    }
+
+    /* unescaped strings take at most the bytes of their quoted form */
+    return (items * arena_align(sizeof(cJSON))) + (in_place ? 0 : buffer_length);
+}
+
 /* get the decimal point character of the current locale */
 static unsigned char get_decimal_point(void)
 {
@@ -291,6 +420,8 @@ typedef struct
     size_t offset;
     size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
     internal_hooks hooks;
+    cJSON_Arena *arena; /* items and strings come from here instead of hooks when set */
+    cJSON_bool in_place; /* strings are unescaped into content itself */
 } parse_buffer;
 
 /* check if the given size is left to read in a given parse buffer (starting with 1) */
@@ -301,6 +432,25 @@ typedef struct
 /* get a pointer to the buffer at the position */
 #define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
 
+/* new item for the parser, from the arena if there is one */
+static cJSON *parse_new_item(parse_buffer * const buffer)
+{
+    cJSON *node = NULL;
+
+    if (buffer->arena == NULL)
+    {
+        return cJSON_New_Item(&(buffer->hooks));
+    }
+
+    node = (cJSON*)arena_allocate(buffer->arena, sizeof(cJSON), true);
+    if (node)
+    {
+        memset(node, '\0', sizeof(cJSON));
+    }
+
+    return node;
+}
+
 /* Parse the input text to generate a number, and populate the result into item. */
 static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -410,6 +560,11 @@ CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring)
         strcpy(object->valuestring, valuestring);
         return object->valuestring;
     }
+    /* an arena item cannot own a heap string */
+    if (object->type & cJSON_InArena)
+    {
+        return NULL;
+    }
     copy = (char*) cJSON_strdup((const unsigned char*)valuestring, &global_hooks);
     if (copy == NULL)
     {
@@ -800,6 +955,8 @@ fail:
     return 0;
 }
 
+static void* cast_away_const(const void* string);
+
 /* Parse the input text into an unescaped cinput, and populate item. */
 static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -840,7 +997,19 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 
         /* This is at most how much we need for the output */
         allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+        if (input_buffer->in_place)
+        {
+            /* unescaping never writes ahead of the input being read, and the closing quote takes the terminator */
+            output = (unsigned char*)cast_away_const(input_pointer);
+        }
+        else if (input_buffer->arena != NULL)
+        {
+            output = (unsigned char*)arena_allocate(input_buffer->arena, allocation_length + sizeof(""), false);
+        }
+        else
+        {
+            output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+        }
         if (output == NULL)
         {
             goto fail; /* allocation failure */
@@ -916,7 +1085,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     return true;
 
 fail:
-    if (output != NULL)
+    if ((output != NULL) && (input_buffer->arena == NULL))
     {
         input_buffer->hooks.deallocate(output);
     }
@@ -1122,10 +1291,53 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return
     return cJSON_ParseWithLengthOpts(value, buffer_length, return_parse_end, require_null_terminated);
 }
 
+/* Flag every item of an arena parse so that cJSON_Delete leaves its memory alone */
+static void mark_in_arena(cJSON *item)
+{
+    while (item != NULL)
+    {
+        /* keys are arena memory too, const keys are never freed and get replaced properly */
+        item->type |= cJSON_InArena;
+        if (item->string != NULL)
+        {
+            item->type |= cJSON_StringIsConst;
+        }
+        mark_in_arena(item->child);
+        item = item->next;
+    }
+}
+
+static cJSON *parse_root(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated, cJSON_Arena *arena, cJSON_bool in_place);
+
 /* Parse an object - create a new root, and populate. */
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    return parse_root(value, buffer_length, return_parse_end, require_null_terminated, NULL, false);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseInArena(cJSON_Arena *arena, const char *value, size_t buffer_length)
+{
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    return parse_root(value, buffer_length, 0, 0, arena, false);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseInPlace(cJSON_Arena *arena, char *value, size_t buffer_length)
+{
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    return parse_root(value, buffer_length, 0, 0, arena, true);
+}
+
+static cJSON *parse_root(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated, cJSON_Arena *arena, cJSON_bool in_place)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, 0, 0 };
     cJSON *item = NULL;
 
     /* reset error position */
@@ -1141,8 +1353,10 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer
     buffer.length = buffer_length; 
     buffer.offset = 0;
     buffer.hooks = global_hooks;
+    buffer.arena = arena;
+    buffer.in_place = in_place;
 
-    item = cJSON_New_Item(&global_hooks);
+    item = parse_new_item(&buffer);
     if (item == NULL) /* memory fail */
     {
         goto fail;
@@ -1168,10 +1382,16 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer
         *return_parse_end = (const char*)buffer_at_offset(&buffer);
     }
 
+    if (arena != NULL)
+    {
+        mark_in_arena(item);
+    }
+
     return item;
 
 fail:
-    if (item != NULL)
+    /* a failed arena parse leaves its garbage in the arena */
+    if ((item != NULL) && (arena == NULL))
     {
         cJSON_Delete(item);
     }
@@ -1507,7 +1727,7 @@ static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buf
     do
     {
         /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        cJSON *new_item = parse_new_item(input_buffer);
         if (new_item == NULL)
         {
             goto fail; /* allocation failure */
@@ -1558,7 +1778,7 @@ success:
     return true;
 
 fail:
-    if (head != NULL)
+    if ((head != NULL) && (input_buffer->arena == NULL))
     {
         cJSON_Delete(head);
     }
@@ -1665,7 +1885,7 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
     do
     {
         /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        cJSON *new_item = parse_new_item(input_buffer);
         if (new_item == NULL)
         {
             goto fail; /* allocation failure */
@@ -1733,7 +1953,7 @@ success:
     return true;
 
 fail:
-    if (head != NULL)
+    if ((head != NULL) && (input_buffer->arena == NULL))
     {
         cJSON_Delete(head);
     }
@@ -1980,6 +2200,7 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
     memcpy(reference, item, sizeof(cJSON));
     reference->string = NULL;
     reference->type |= cJSON_IsReference;
+    reference->type &= ~cJSON_InArena; /* the reference itself is heap memory */
     reference->next = reference->prev = NULL;
     return reference;
 }
@@ -2735,7 +2956,7 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
         goto fail;
     }
     /* Copy over all vars */
-    newitem->type = item->type & (~cJSON_IsReference);
+    newitem->type = item->type & (~(cJSON_IsReference | cJSON_InArena));
     newitem->valueint = item->valueint;
     newitem->valuedouble = item->valuedouble;
     if (item->valuestring)
@@ -2748,7 +2969,16 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
     }
     if (item->string)
     {
-        newitem->string = (item->type&cJSON_StringIsConst) ? item->string : (char*)cJSON_strdup((unsigned char*)item->string, &global_hooks);
+        /* keys of arena items only look constant, the copy must not point into the arena */
+        if ((item->type & cJSON_StringIsConst) && !(item->type & cJSON_InArena))
+        {
+            newitem->string = item->string;
+        }
+        else
+        {
+            newitem->string = (char*)cJSON_strdup((unsigned char*)item->string, &global_hooks);
+            newitem->type &= ~cJSON_StringIsConst;
+        }
         if (!newitem->string)
         {
             goto fail;
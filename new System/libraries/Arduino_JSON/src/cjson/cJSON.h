@@ -98,6 +98,7 @@ then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJ
 
 #define cJSON_IsReference 256
 #define cJSON_StringIsConst 512
+#define cJSON_InArena 1024 /* the item and its valuestring live in a cJSON_Arena */
 
 /* The cJSON structure: */
 typedef struct cJSON
@@ -131,12 +132,20 @@ typedef struct cJSON_Hooks
 
 typedef int cJSON_bool;
 
+/* Memory for the items of one parse, released all at once with cJSON_DeleteArena */
+typedef struct cJSON_Arena cJSON_Arena;
+
 /* Limits how deeply nested arrays/objects can be before cJSON rejects to parse them.
  * This is to prevent stack overflows. */
 #ifndef CJSON_NESTING_LIMIT
 #define CJSON_NESTING_LIMIT 1000
 #endif
 
+/* Size of the blocks a cJSON_Arena grows by when it is not given one. */
+#ifndef CJSON_ARENA_BLOCK_SIZE
+#define CJSON_ARENA_BLOCK_SIZE 1024
+#endif
+
 /* returns the version of cJSON as a string */
 CJSON_PUBLIC(const char*) cJSON_Version(void);
 
@@ -152,6 +161,17 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 
+/* Arena parsing: items and strings are carved out of the arena instead of being allocated one by one.
+ * The result is still released with cJSON_Delete (which skips arena memory), and the arena with cJSON_DeleteArena once nothing refers to it any more.
+ * Items added to an arena tree later are ordinary heap items. block_size 0 uses CJSON_ARENA_BLOCK_SIZE. */
+CJSON_PUBLIC(cJSON_Arena *) cJSON_CreateArena(size_t block_size);
+CJSON_PUBLIC(void) cJSON_DeleteArena(cJSON_Arena *arena);
+/* A block size that lets one parse of value fit in a single block. */
+CJSON_PUBLIC(size_t) cJSON_ArenaSizeFor(const char *value, size_t buffer_length, cJSON_bool in_place);
+CJSON_PUBLIC(cJSON *) cJSON_ParseInArena(cJSON_Arena *arena, const char *value, size_t buffer_length);
+/* In-situ parsing: strings are unescaped inside value and referenced from there, so value must outlive the result. value is modified even if parsing fails. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseInPlace(cJSON_Arena *arena, char *value, size_t buffer_length);
+
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
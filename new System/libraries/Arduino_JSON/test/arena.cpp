@@ -0,0 +1,427 @@
+/*
+ * JSONVar arena and in-place parsing: results identical to parse() for a
+ * config payload and for escapes, numbers and nesting edge cases, malformed
+ * input, editing an arena tree (replacing, adding and removing keys,
+ * assigning over the root), copies that outlive the arena, strings that
+ * point into the in-place buffer, and the cJSON calls that must not free
+ * arena memory. The benchmark parses a ~3 KB device config the three ways.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -I../../test -Isrc -Itest/host test/arena.cpp src/JSONVar.cpp src/JSON.cpp src/cjson/cJSON.c -o arena
+ *   ./arena          # tests
+ *   ./arena bench    # allocations, peak heap and parse time: parse vs parseArena vs parseInPlace
+ */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <utility>
+
+#include "Arduino_JSON.h"
+#include "cjson/cJSON.h"
+#include "host_test.h"
+
+/*
+ * Heap allocations and live bytes, counted by wrapping the C allocator
+ * (not under ASan, which has its own)
+ */
+
+static unsigned long allocations;
+static size_t heapInUse;
+static size_t heapPeak;
+
+#if !defined(__SANITIZE_ADDRESS__)
+extern "C" {
+  void *__libc_malloc(size_t);
+  void *__libc_calloc(size_t, size_t);
+  void *__libc_realloc(void *, size_t);
+  void __libc_free(void *);
+
+  static void *counted(void *p) {
+    if (p) {
+      heapInUse += malloc_usable_size(p);
+      if (heapInUse > heapPeak)
+        heapPeak = heapInUse;
+    }
+    return p;
+  }
+
+  void *malloc(size_t size) {
+    allocations++;
+    return counted(__libc_malloc(size));
+  }
+
+  void *calloc(size_t n, size_t size) {
+    allocations++;
+    return counted(__libc_calloc(n, size));
+  }
+
+  void *realloc(void *p, size_t size) {
+    allocations++;
+    if (p)
+      heapInUse -= malloc_usable_size(p);
+    return counted(__libc_realloc(p, size));
+  }
+
+  void free(void *p) {
+    if (p)
+      heapInUse -= malloc_usable_size(p);
+    __libc_free(p);
+  }
+}
+#define COUNTS_ALLOCATIONS 1
+#endif
+
+/*
+ * A device config like the ones pushed to the boards: network settings,
+ * a few strings with escapes, and a list of sensors
+ */
+
+static std::string configPayload()
+{
+  std::string s =
+    "{\n"
+    "  \"device\": {\"id\": \"esp32-7f3a\", \"name\": \"Greenhouse \\\"north\\\"\", \"firmware\": \"2.4.1\", \"tz\": \"Europe/Z\\u00fcrich\"},\n"
+    "  \"wifi\": {\"ssid\": \"greenhouse\", \"password\": \"s3cr3t\\\\pass\", \"dhcp\": false,\n"
+    "           \"ip\": \"192.168.10.40\", \"gateway\": \"192.168.10.1\", \"dns\": [\"1.1.1.1\", \"8.8.8.8\"]},\n"
+    "  \"mqtt\": {\"host\": \"broker.local\", \"port\": 1883, \"keepalive\": 60, \"qos\": 1, \"retain\": true,\n"
+    "           \"topic\": \"site/greenhouse/north\", \"will\": {\"topic\": \"site/greenhouse/north/status\", \"message\": \"offline\"}},\n"
+    "  \"sensors\": [\n";
+
+  for (int i = 0; i < 16; i++) {
+    char sensor[256];
+    snprintf(sensor, sizeof(sensor),
+             "    {\"id\": %d, \"type\": \"%s\", \"pin\": %d, \"interval\": %d, \"offset\": %.2f, \"label\": \"Bed %d\\tzone %c\", \"alarm\": {\"low\": %d, \"high\": %d}, \"enabled\": %s}%s\n",
+             i, (i % 3 == 0) ? "temperature" : (i % 3 == 1) ? "humidity" : "soil", 12 + i, 1000 * (1 + i % 4),
+             -0.25 * i, i, 'A' + i % 4, -5 + i, 30 + i, (i % 5) ? "true" : "false", (i < 15) ? "," : "");
+    s += sensor;
+  }
+
+  s += "  ],\n"
+       "  \"schedule\": [[6, 0, 1], [12, 30, 0], [18, 0, 1], [22, 15, 0]],\n"
+       "  \"notes\": null\n"
+       "}\n";
+
+  return s;
+}
+
+static std::string stringify(const JSONVar& v)
+{
+  String s = JSON.stringify(v);
+
+  return s.c_str() ? s.c_str() : "(null)";
+}
+
+/*
+ * Tests
+ */
+
+static void testSameAsParse()
+{
+  printf("parseArena and parseInPlace give the same values as parse\n");
+
+  static const char *docs[] = {
+    "{}", "[]", "[[], {}, [[]]]", "0", "-12.5e3", "\"\"", "true", "null",
+    "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"",
+    "{\"\\u00e9t\\u00e9\": \"\\ud83d\\ude00 ok\", \"a\\nb\": [1, \"x\\u0041y\"]}",
+    "  {\"k\": [1, 2, {\"k\": {\"k\": [true, false, null]}}], \"s\": \"comma, inside [and] {braces}\"}  ",
+  };
+
+  std::string payload = configPayload();
+  CHECK(payload.size() > 2048 && payload.size() < 4096);
+
+  for (size_t i = 0; i <= sizeof(docs) / sizeof(docs[0]); i++) {
+    std::string doc = (i < sizeof(docs) / sizeof(docs[0])) ? docs[i] : payload;
+    std::string buffer = doc;
+
+    JSONVar heap = JSON.parse(doc.c_str());
+    JSONVar arena = JSON.parseArena(doc.c_str());
+    JSONVar inPlace = JSON.parseInPlace(&buffer[0]);
+
+    CHECK(!(JSON.typeof(heap) == "undefined"));
+    CHECK(stringify(arena) == stringify(heap));
+    CHECK(stringify(inPlace) == stringify(heap));
+  }
+
+  std::string buffer = payload;
+  JSONVar config = JSON.parseInPlace(&buffer[0]);
+
+  CHECK(strcmp((const char*) config["device"]["name"], "Greenhouse \"north\"") == 0);
+  CHECK(strcmp((const char*) config["device"]["tz"], "Europe/Z\xc3\xbcrich") == 0);
+  CHECK(strcmp((const char*) config["wifi"]["password"], "s3cr3t\\pass") == 0);
+  CHECK((int) config["mqtt"]["port"] == 1883);
+  CHECK(config["sensors"].length() == 16);
+  CHECK((double) config["sensors"][3]["offset"] == -0.75);
+  CHECK((int) config["schedule"][1][1] == 30);
+}
+
+static void testMalformed()
+{
+  printf("malformed input gives undefined and leaks nothing\n");
+
+  static const char *docs[] = {
+    "", "{", "[1, 2", "{\"a\" 1}", "{\"a\": }", "[1,,2]", "\"unterminated", "\"bad \\x escape\"",
+    "\"\\ud83d alone\"", "{\"a\": [1, 2, {\"b\": tru}]}", "[\"ends in backslash\\",
+  };
+
+  for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); i++) {
+    std::string buffer = docs[i];
+
+    CHECK(JSON.typeof(JSON.parse(docs[i])) == "undefined");
+    CHECK(JSON.typeof(JSON.parseArena(docs[i])) == "undefined");
+    CHECK(JSON.typeof(JSON.parseInPlace(&buffer[0])) == "undefined");
+  }
+
+  // Trailing garbage is ignored by all three, as it always was
+  std::string buffer = "[1] trailing";
+  CHECK(stringify(JSON.parseArena("[1] trailing")) == "[1]");
+  CHECK(stringify(JSON.parseInPlace(&buffer[0])) == "[1]");
+}
+
+static void testEditing()
+{
+  printf("an arena tree can be edited like any other\n");
+
+  std::string payload = configPayload();
+  std::string buffer = payload;
+  JSONVar expected = JSON.parse(payload.c_str());
+
+  for (int mode = 0; mode < 2; mode++) {
+    JSONVar config = mode ? JSON.parseInPlace(&buffer[0]) : JSON.parseArena(payload.c_str());
+
+    for (JSONVar* v : { &expected, &config }) {
+      JSONVar& c = *v;
+
+      c["wifi"]["ssid"] = "a much longer network name than before";
+      c["mqtt"]["port"] = 8883;
+      c["mqtt"]["tls"] = true;
+      c["device"]["name"] = undefined;
+      c["sensors"][0] = c["sensors"][1];
+      c["sensors"][2]["alarm"] = JSON.parse("{\"low\": 1}");
+      c["schedule"][3] = nullptr;
+      c["notes"] = "watered";
+    }
+
+    CHECK(stringify(config) == stringify(expected));
+    CHECK(!config["device"].hasOwnProperty("name"));
+    CHECK(strcmp((const char*) config["wifi"]["ssid"], "a much longer network name than before") == 0);
+
+    // Assigning over the root releases the whole arena
+    config = 42;
+    CHECK(stringify(config) == "42");
+
+    expected = JSON.parse(payload.c_str());
+  }
+}
+
+static void testCopiesAndMoves()
+{
+  printf("copies own their memory, moves take the arena along\n");
+
+  std::string payload = configPayload();
+  JSONVar copy;
+  JSONVar moved;
+  JSONVar child;
+
+  {
+    std::string buffer = payload;
+    JSONVar config = JSON.parseInPlace(&buffer[0]);
+
+    JSONVar will = config["mqtt"]["will"];
+
+    copy = config;
+    child = will;
+
+    JSONVar temp = JSON.parseArena(payload.c_str());
+    moved = std::move(temp);
+
+    // The buffer and the arenas of config and temp go away here
+    memset(&buffer[0], '#', buffer.size());
+  }
+
+  JSONVar expected = JSON.parse(payload.c_str());
+
+  CHECK(stringify(copy) == stringify(expected));
+  CHECK(stringify(moved) == stringify(expected));
+  CHECK(stringify(child) == "{\"topic\":\"site/greenhouse/north/status\",\"message\":\"offline\"}");
+
+  JSONVar keys = moved.keys();
+  CHECK(keys.length() == 6);
+  CHECK(strcmp((const char*) keys[0], "device") == 0);
+}
+
+static void testInPlaceBuffer()
+{
+  printf("parseInPlace unescapes into the buffer and points at it\n");
+
+  char buffer[] = "{\"key\": \"a\\tb\\u00e9\", \"list\": [\"x\", \"\\\"y\\\"\"]}";
+  const char *end = buffer + sizeof(buffer);
+  JSONVar v = JSON.parseInPlace(buffer);
+
+  const char *value = (const char*) v["key"];
+  const char *second = (const char*) v["list"][1];
+
+  CHECK(value >= buffer && value < end);
+  CHECK(second >= buffer && second < end);
+  CHECK(strcmp(value, "a\tb\xc3\xa9") == 0);
+  CHECK(strcmp(second, "\"y\"") == 0);
+}
+
+static void testCJSON()
+{
+  printf("cJSON calls leave arena memory alone\n");
+
+  const char *text = "{\"name\": \"short\", \"list\": [1, 2], \"obj\": {\"inner\": \"v\"}}";
+  cJSON_Arena *arena = cJSON_CreateArena(0);
+  cJSON *root = cJSON_ParseInArena(arena, text, strlen(text) + 1);
+
+  CHECK(root != NULL && (root->type & cJSON_InArena));
+
+  // In-place change fits, a longer one would need a heap string
+  cJSON *name = cJSON_GetObjectItemCaseSensitive(root, "name");
+  CHECK(cJSON_SetValuestring(name, "tiny") != NULL);
+  CHECK(cJSON_SetValuestring(name, "far too long to fit") == NULL);
+  CHECK(strcmp(name->valuestring, "tiny") == 0);
+
+  // Duplicates are ordinary heap items with their own keys
+  cJSON *copy = cJSON_Duplicate(root, true);
+  cJSON *copied = cJSON_GetObjectItemCaseSensitive(copy, "obj");
+  CHECK(!(copy->type & cJSON_InArena) && !(copied->type & (cJSON_InArena | cJSON_StringIsConst)));
+  CHECK(copied->string != cJSON_GetObjectItemCaseSensitive(root, "obj")->string);
+
+  // References, renames, detaching and deleting
+  cJSON *other = cJSON_CreateObject();
+  cJSON_AddItemReferenceToObject(other, "ref", cJSON_GetObjectItemCaseSensitive(root, "list"));
+  cJSON_AddItemToObject(other, "moved", cJSON_DetachItemFromObject(root, "obj"));
+  cJSON_AddItemToObject(root, "added", cJSON_CreateString("heap"));
+  cJSON_ReplaceItemInObject(root, "list", cJSON_CreateNumber(3));
+  cJSON_DeleteItemFromObject(root, "name");
+
+  char *printed = cJSON_PrintUnformatted(root);
+  CHECK(strcmp(printed, "{\"list\":3,\"added\":\"heap\"}") == 0);
+  cJSON_free(printed);
+
+  printed = cJSON_PrintUnformatted(other);
+  CHECK(strcmp(printed, "{\"ref\":[1,2],\"moved\":{\"inner\":\"v\"}}") == 0);
+  cJSON_free(printed);
+
+  cJSON_Delete(other);
+  cJSON_Delete(root);
+  cJSON_DeleteArena(arena);
+  cJSON_Delete(copy);
+
+  // A small block forces the arena to grow
+  std::string payload = configPayload();
+  arena = cJSON_CreateArena(64);
+  root = cJSON_ParseInArena(arena, payload.c_str(), payload.size() + 1);
+  copy = cJSON_Parse(payload.c_str());
+  CHECK(cJSON_Compare(root, copy, true));
+  cJSON_Delete(root);
+  cJSON_DeleteArena(arena);
+  cJSON_Delete(copy);
+
+#ifdef COUNTS_ALLOCATIONS
+  printf("one allocation per parse\n");
+
+  std::string buffer = payload;
+  unsigned long before = allocations;
+  {
+    JSONVar config = JSON.parseArena(payload.c_str());
+    CHECK(allocations - before == 1);
+  }
+  before = allocations;
+  {
+    JSONVar config = JSON.parseInPlace(&buffer[0]);
+    CHECK(allocations - before == 1);
+  }
+#endif
+}
+
+/*
+ * Benchmark
+ */
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+enum Mode { HEAP, ARENA, IN_PLACE };
+
+static void bench(Mode mode, const char *name, const std::string& payload)
+{
+  const int rounds = 20000;
+  std::string buffer = payload;
+  unsigned long allocs = 0;
+  size_t peak = 0;
+  double t = 0;
+
+  for (int pass = 0; pass < 2; pass++) {
+    double start = now();
+
+    for (int i = 0; i < (pass ? rounds : 1); i++) {
+      size_t base = heapInUse;
+      unsigned long before = allocations;
+
+      heapPeak = heapInUse;
+
+      {
+        JSONVar config;
+
+        if (mode == HEAP) {
+          config = JSON.parse(payload.c_str());
+        } else if (mode == ARENA) {
+          config = JSON.parseArena(payload.c_str());
+        } else {
+          // The text is needed again next round, so the copy is part of the cost
+          memcpy(&buffer[0], payload.c_str(), payload.size() + 1);
+          config = JSON.parseInPlace(&buffer[0]);
+        }
+
+        if (pass == 0) {
+          allocs = allocations - before;
+          peak = heapPeak - base;
+        }
+      }
+    }
+
+    t = now() - start;
+  }
+
+  printf("  %-13s %5lu allocations  %6zu bytes peak heap  %6.1f us/parse  %5.1f MB/s\n",
+         name, allocs, peak, t / rounds * 1e6, payload.size() * rounds / t / 1e6);
+}
+
+static void benchmark()
+{
+  std::string payload = configPayload();
+
+  printf("%zu byte config, %d sensors\n", payload.size(), 16);
+#ifndef COUNTS_ALLOCATIONS
+  printf("  (allocation counts need a build without ASan)\n");
+#endif
+
+  bench(HEAP, "parse", payload);
+  bench(ARENA, "parseArena", payload);
+  bench(IN_PLACE, "parseInPlace", payload);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    benchmark();
+    return 0;
+  }
+
+  testSameAsParse();
+  testMalformed();
+  testEditing();
+  testCopiesAndMoves();
+  testInPlaceBuffer();
+  testCJSON();
+
+  return test_summary();
+}
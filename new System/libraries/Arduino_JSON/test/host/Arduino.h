@@ -0,0 +1,78 @@
+// Host stand-in for the Arduino core: just what JSONVar calls.
+// String allocates on the heap like the real one, so arena.cpp counts it.
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef decltype(nullptr) nullptr_t;
+
+class String
+{
+  public:
+    String(const char *s = "") : _buf(nullptr), _len(0) { if (s) assign(s, strlen(s)); }
+    String(const String &other) : _buf(nullptr), _len(0) { if (other._buf) assign(other._buf, other._len); }
+    ~String() { free(_buf); }
+
+    String &operator=(const String &other)
+    {
+      if (this != &other)
+      {
+        if (other._buf)
+          assign(other._buf, other._len);
+        else
+          invalidate();
+      }
+
+      return *this;
+    }
+
+    bool operator==(const char *s) const { return _buf ? (s && strcmp(_buf, s) == 0) : !s; }
+
+    const char *c_str() const { return _buf; }
+    size_t length() const { return _len; }
+
+  private:
+    char *_buf;
+    size_t _len;
+
+    void assign(const char *s, size_t len)
+    {
+      char *buf = (char *) malloc(len + 1);
+      memcpy(buf, s, len);
+      buf[len] = 0;
+      free(_buf);
+      _buf = buf;
+      _len = len;
+    }
+
+    void invalidate()
+    {
+      free(_buf);
+      _buf = nullptr;
+      _len = 0;
+    }
+};
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+    size_t print(const char *s) { return s ? write((const uint8_t *) s, strlen(s)) : 0; }
+};
+
+class Printable
+{
+  public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print &p) const = 0;
+};
+
+#endif
@@ -0,0 +1,76 @@
+/*
+  Arduino LSM6DS3 - FIFO Vibration
+
+  This example samples the accelerometer at 833 Hz into the LSM6DS3
+  FIFO and reads it in bursts of 200 samples, then prints the peak
+  vibration of each burst: the largest change of acceleration between
+  two samples.
+
+  The sketch is free to do other things between bursts: the FIFO
+  holds up to 682 samples, about 0.8 s at this rate.
+
+  The circuit:
+  - Arduino Uno WiFi Rev 2 or Arduino Nano 33 IoT
+
+  This example code is in the public domain.
+*/
+
+#include <Arduino_LSM6DS3.h>
+
+LSM6DS3Sample samples[200];
+float lastX, lastY, lastZ;
+
+void setup() {
+  Serial.begin(9600);
+  while (!Serial);
+
+  if (!IMU.begin()) {
+    Serial.println("Failed to initialize IMU!");
+
+    while (1);
+  }
+
+  if (!IMU.beginFIFO(833, 200)) {
+    Serial.println("Failed to start the FIFO!");
+
+    while (1);
+  }
+
+  Serial.print("Accelerometer sample rate = ");
+  Serial.print(IMU.accelerationSampleRate());
+  Serial.println(" Hz");
+  Serial.println();
+  Serial.println("Time (us)\tPeak change (g)");
+}
+
+void loop() {
+  if (IMU.fifoAvailable() < 200) {
+    return;
+  }
+
+  int n = IMU.readFIFO(samples, 200);
+  float peak = 0;
+
+  for (int i = 0; i < n; i++) {
+    float x, y, z;
+
+    samples[i].readAcceleration(x, y, z);
+
+    float change = fabs(x - lastX) + fabs(y - lastY) + fabs(z - lastZ);
+    if (change > peak) {
+      peak = change;
+    }
+
+    lastX = x;
+    lastY = y;
+    lastZ = z;
+  }
+
+  Serial.print(samples[n - 1].timestamp);
+  Serial.print('\t');
+  Serial.println(peak, 3);
+
+  if (IMU.fifoOverruns()) {
+    Serial.println("Samples were lost");
+  }
+}
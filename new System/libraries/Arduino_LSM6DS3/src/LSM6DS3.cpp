@@ -22,7 +22,9 @@
 LSM6DS3Class::LSM6DS3Class(TwoWire& wire, uint8_t slaveAddress) :
   _wire(&wire),
   _spi(NULL),
-  _slaveAddress(slaveAddress)
+  _slaveAddress(slaveAddress),
+  _sampleRate(104.0F),
+  _fifoOverruns(0)
 {
 }
 
@@ -31,7 +33,9 @@ LSM6DS3Class::LSM6DS3Class(SPIClass& spi, int csPin, int irqPin) :
   _spi(&spi),
   _csPin(csPin),
   _irqPin(irqPin),
-  _spiSettings(10E6, MSBFIRST, SPI_MODE0)
+  _spiSettings(10E6, MSBFIRST, SPI_MODE0),
+  _sampleRate(104.0F),
+  _fifoOverruns(0)
 {
 }
 
@@ -67,6 +71,8 @@ int LSM6DS3Class::begin()
   // Set the ODR config register to ODR/4
   writeRegister(LSM6DS3_CTRL8_XL, 0x09);
 
+  _sampleRate = 104.0F;
+
   return 1;
 }
 
@@ -113,7 +119,7 @@ int LSM6DS3Class::accelerationAvailable()
 
 float LSM6DS3Class::accelerationSampleRate()
 {
-  return 104.0F;
+  return _sampleRate;
 }
 
 int LSM6DS3Class::readGyroscope(float& x, float& y, float& z)
@@ -146,7 +152,7 @@ int LSM6DS3Class::gyroscopeAvailable()
 
 float LSM6DS3Class::gyroscopeSampleRate()
 {
-  return 104.0F;
+  return _sampleRate;
 }
 
 int LSM6DS3Class::readTemperature(float& t)
@@ -178,6 +184,221 @@ float LSM6DS3Class::temperatureSampleRate()
   return 52.0F;
 }
 
+int LSM6DS3Class::beginFIFO(float sampleRate, int watermark)
+{
+  // Output data rates shared by the accelerometer, the gyroscope and the FIFO
+  static const float rates[] = { 12.5F, 26.0F, 52.0F, 104.0F, 208.0F, 416.0F, 833.0F, 1660.0F };
+  uint8_t odr = 1;
+
+  while (odr < sizeof(rates) / sizeof(rates[0]) && rates[odr - 1] < sampleRate) {
+    odr++;
+  }
+
+  // The FIFO holds 4096 16-bit words, the threshold is a 12-bit word count
+  // and each sample is 6 words: gyroscope X, Y, Z then accelerometer X, Y, Z
+  if (watermark < 1) {
+    watermark = 1;
+  } else if (watermark > 682) {
+    watermark = 682;
+  }
+  int threshold = watermark * 6;
+
+  // Bypass mode empties the FIFO
+  if (!writeRegister(LSM6DS3_FIFO_CTRL5, 0x00)) {
+    return 0;
+  }
+
+  writeRegister(LSM6DS3_FIFO_CTRL1, threshold & 0xFF);
+  writeRegister(LSM6DS3_FIFO_CTRL2, (threshold >> 8) & 0x0F);
+
+  // gyroscope and accelerometer in the FIFO, without decimation
+  writeRegister(LSM6DS3_FIFO_CTRL3, 0x09);
+  writeRegister(LSM6DS3_FIFO_CTRL4, 0x00);
+
+  // same full scales and filters as begin(), at the new rate
+  writeRegister(LSM6DS3_CTRL2_G, (odr << 4) | 0x0C);
+  writeRegister(LSM6DS3_CTRL1_XL, (odr << 4) | 0x0A);
+
+  // FIFO threshold on INT1
+  writeRegister(LSM6DS3_INT1_CTRL, 0x08);
+
+  // continuous mode: when full, the oldest samples are overwritten
+  writeRegister(LSM6DS3_FIFO_CTRL5, (odr << 3) | 0x06);
+
+  _sampleRate = rates[odr - 1];
+  _fifoPeriod = 1000000.0F / _sampleRate;
+  _fifoIndex = 0;
+  _fifoSynced = false;
+  _fifoOverruns = 0;
+
+  return 1;
+}
+
+void LSM6DS3Class::endFIFO()
+{
+  writeRegister(LSM6DS3_FIFO_CTRL5, 0x00);
+  writeRegister(LSM6DS3_INT1_CTRL, 0x00);
+
+  // back to the begin() configuration
+  writeRegister(LSM6DS3_CTRL2_G, 0x4C);
+  writeRegister(LSM6DS3_CTRL1_XL, 0x4A);
+
+  _sampleRate = 104.0F;
+}
+
+int LSM6DS3Class::fifoAvailable()
+{
+  int words, pattern;
+
+  if (readFIFOStatus(words, pattern) < 0) {
+    return 0;
+  }
+
+  // a partial sample at the head is dropped by readFIFO()
+  if (pattern != 0) {
+    words -= 6 - pattern;
+  }
+
+  return words > 0 ? words / 6 : 0;
+}
+
+int LSM6DS3Class::readFIFO(LSM6DS3Sample* samples, int count)
+{
+  int words, pattern;
+  int flags = count > 0 ? readFIFOStatus(words, pattern) : -1;
+
+  if (flags < 0) {
+    return 0;
+  }
+
+  // every sample counted was taken before now
+  unsigned long now = micros();
+
+  if (flags & 0x40) {
+    // The oldest words were overwritten: samples were lost and the count
+    // no longer matches the time since the last read
+    _fifoOverruns++;
+    _fifoSynced = false;
+  }
+
+  if (pattern != 0) {
+    // Overwriting goes word by word, so the FIFO can start in the middle of
+    // a sample. Drop words up to the next gyroscope X.
+    uint8_t partial[10];
+    int skip = 6 - pattern;
+
+    if (words < skip) {
+      return 0;
+    }
+    if (readRegisters(LSM6DS3_FIFO_DATA_OUT_L, partial, skip * 2) != 1) {
+      return 0;
+    }
+    words -= skip;
+  }
+
+  int available = words / 6;
+  unsigned long newest = _fifoIndex + available - 1;
+
+  if (available == 0) {
+    return 0;
+  }
+
+  // The sample period follows the sensor's own clock, which may be a few
+  // percent off its nominal rate: measure it against micros() between reads
+  if (_fifoSynced && newest != _fifoLastNewest) {
+    float period = (float)(now - _fifoLastMicros) / (newest - _fifoLastNewest);
+    float nominal = 1000000.0F / _sampleRate;
+
+    if (period > nominal * 0.75F && period < nominal * 1.25F) {
+      _fifoPeriod += (period - _fifoPeriod) / 16;
+    }
+  }
+  _fifoLastNewest = newest;
+  _fifoLastMicros = now;
+  _fifoSynced = true;
+
+  if (count > available) {
+    count = available;
+  }
+
+  // 12 bytes per sample; the FIFO output address wraps from DATA_OUT_H back
+  // to DATA_OUT_L, so one burst reads any number of samples
+  int chunk = count;
+  if (_spi == NULL && chunk > LSM6DS3_WIRE_BUFFER_SIZE / 12) {
+    chunk = LSM6DS3_WIRE_BUFFER_SIZE / 12;
+  }
+
+  int read = 0;
+  while (read < count) {
+    int n = count - read;
+    if (n > chunk) {
+      n = chunk;
+    }
+
+    // Read the packed 12-byte samples into the start of the caller's buffer,
+    // then spread them out to the 16-byte structures, last first so that
+    // nothing is overwritten before it is moved
+    uint8_t* raw = (uint8_t*)&samples[read];
+
+    if (readRegisters(LSM6DS3_FIFO_DATA_OUT_L, raw, n * 12) != 1) {
+      break;
+    }
+
+    for (int i = n - 1; i >= 0; i--) {
+      LSM6DS3Sample& sample = samples[read + i];
+      unsigned long index = _fifoIndex + read + i;
+
+      memmove(sample.gyroscope, raw + i * 12, 12);
+
+      // the newest sample was taken in the last period before now
+      sample.timestamp = now - (unsigned long)((newest - index + 0.5F) * _fifoPeriod);
+    }
+
+    read += n;
+  }
+
+  _fifoIndex += read;
+
+  return read;
+}
+
+int LSM6DS3Class::readFIFOStatus(int& words, int& pattern)
+{
+  uint8_t status[4];
+
+  if (readRegisters(LSM6DS3_FIFO_STATUS1, status, sizeof(status)) != 1) {
+    return -1;
+  }
+
+  // the count is 12 bits: a full FIFO of 4096 words reads as 0
+  words = ((status[1] & 0x0F) << 8) | status[0];
+  if (words == 0 && (status[1] & 0x20)) {
+    words = 4096;
+  }
+  pattern = ((status[3] & 0x03) << 8) | status[2];
+
+  return status[1];
+}
+
+unsigned long LSM6DS3Class::fifoOverruns()
+{
+  return _fifoOverruns;
+}
+
+void LSM6DS3Sample::readAcceleration(float& x, float& y, float& z) const
+{
+  x = acceleration[0] * 4.0 / 32768.0;
+  y = acceleration[1] * 4.0 / 32768.0;
+  z = acceleration[2] * 4.0 / 32768.0;
+}
+
+void LSM6DS3Sample::readGyroscope(float& x, float& y, float& z) const
+{
+  x = gyroscope[0] * 2000.0 / 32768.0;
+  y = gyroscope[1] * 2000.0 / 32768.0;
+  z = gyroscope[2] * 2000.0 / 32768.0;
+}
+
 int LSM6DS3Class::readRegister(uint8_t address)
 {
   uint8_t value;
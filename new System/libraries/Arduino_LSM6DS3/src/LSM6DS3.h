@@ -23,6 +23,14 @@
 
 #define LSM6DS3_ADDRESS            0x6A
 
+#define LSM6DS3_FIFO_CTRL1         0X06
+#define LSM6DS3_FIFO_CTRL2         0X07
+#define LSM6DS3_FIFO_CTRL3         0X08
+#define LSM6DS3_FIFO_CTRL4         0X09
+#define LSM6DS3_FIFO_CTRL5         0X0A
+
+#define LSM6DS3_INT1_CTRL          0X0D
+
 #define LSM6DS3_WHO_AM_I_REG       0X0F
 #define LSM6DS3_CTRL1_XL           0X10
 #define LSM6DS3_CTRL2_G            0X11
@@ -49,6 +57,36 @@
 #define LSM6DS3_OUTZ_L_XL          0X2C
 #define LSM6DS3_OUTZ_H_XL          0X2D
 
+#define LSM6DS3_FIFO_STATUS1       0X3A
+#define LSM6DS3_FIFO_STATUS2       0X3B
+#define LSM6DS3_FIFO_STATUS3       0X3C
+#define LSM6DS3_FIFO_STATUS4       0X3D
+#define LSM6DS3_FIFO_DATA_OUT_L    0X3E
+#define LSM6DS3_FIFO_DATA_OUT_H    0X3F
+
+// Largest single I2C read: FIFO reads are split into chunks that fit the Wire
+// receive buffer. Over SPI all the samples are read in one transfer.
+#ifndef LSM6DS3_WIRE_BUFFER_SIZE
+#if defined(I2C_BUFFER_LENGTH)
+#define LSM6DS3_WIRE_BUFFER_SIZE   I2C_BUFFER_LENGTH
+#elif defined(BUFFER_LENGTH)
+#define LSM6DS3_WIRE_BUFFER_SIZE   BUFFER_LENGTH
+#elif defined(SERIAL_BUFFER_SIZE)
+#define LSM6DS3_WIRE_BUFFER_SIZE   SERIAL_BUFFER_SIZE
+#else
+#define LSM6DS3_WIRE_BUFFER_SIZE   32
+#endif
+#endif
+
+// One accelerometer and gyroscope sample read from the FIFO
+struct LSM6DS3Sample {
+  unsigned long timestamp;  // micros() when the sample was taken, reconstructed
+  int16_t gyroscope[3];     // raw X, Y, Z, 2000 dps full scale
+  int16_t acceleration[3];  // raw X, Y, Z, 4 g full scale
+
+  void readAcceleration(float& x, float& y, float& z) const; // Results are in g (earth gravity).
+  void readGyroscope(float& x, float& y, float& z) const; // Results are in degrees/second.
+};
 
 
 class LSM6DS3Class {
@@ -75,12 +113,22 @@ class LSM6DS3Class {
     virtual float temperatureSampleRate(); // Sampling rate of the sensor.
     virtual int temperatureAvailable(); // Check for available data from temperature sensor
 
+    // FIFO: the sensor buffers up to 682 samples, which are read in bursts.
+    // INT1 goes HIGH while at least 'watermark' samples are waiting.
+    int beginFIFO(float sampleRate = 104.0F, int watermark = 32); // sampleRate in Hz, 12.5 to 1660
+    void endFIFO();
+    int fifoAvailable(); // Number of samples waiting in the FIFO
+    int readFIFO(LSM6DS3Sample* samples, int count); // Reads up to count samples, returns the number read
+    unsigned long fifoOverruns(); // Times the FIFO overflowed and dropped samples since beginFIFO()
+
 
   protected:
     int readRegister(uint8_t address);
     int readRegisters(uint8_t address, uint8_t* data, size_t length);
     int writeRegister(uint8_t address, uint8_t value);
 
+    int readFIFOStatus(int& words, int& pattern); // Returns FIFO_STATUS2, -1 on failure
+
 
   private:
     TwoWire* _wire;
@@ -90,6 +138,17 @@ class LSM6DS3Class {
     int _irqPin;
 
     SPISettings _spiSettings;
+
+    float _sampleRate;
+
+    // FIFO sample timing: samples are numbered in the order they are read
+    // and timed from the period measured between reads
+    float _fifoPeriod;            // microseconds between samples
+    unsigned long _fifoIndex;     // number of the next sample in the FIFO
+    unsigned long _fifoLastNewest;
+    unsigned long _fifoLastMicros;
+    bool _fifoSynced;
+    unsigned long _fifoOverruns;
 };
 
 extern LSM6DS3Class IMU_LSM6DS3;
@@ -0,0 +1,478 @@
+/*
+ * FIFO reads against a register model of the LSM6DS3 on a simulated I2C
+ * bus: configuration, watermark on INT1, burst draining in Wire-sized
+ * chunks, realignment after an overrun and timestamps on a sensor clock
+ * that runs off its nominal rate. The benchmark compares polling the
+ * output registers with draining the FIFO at 833 Hz.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -I../../test -Isrc -Itest/host test/fifo.cpp src/LSM6DS3.cpp -o fifo
+ *   ./fifo          # tests
+ *   ./fifo bench    # bus time and samples kept, polling vs FIFO
+ */
+
+#include <stdio.h>
+#include <deque>
+#include <vector>
+
+#include "LSM6DS3.h"
+#include "host_test.h"
+
+/*
+ * Clock: only bus traffic and the sketch's own work take time
+ */
+
+static double now_us;
+static uint32_t busClock = 400000;
+
+unsigned long micros() {
+  return (unsigned long)now_us;
+}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+
+/*
+ * LSM6DS3 register model: one sample of each sensor per period, taken on
+ * the sensor's own clock; a 4096 word FIFO in continuous mode that
+ * overwrites its oldest word when full; auto-incrementing register address
+ * that wraps from FIFO_DATA_OUT_H back to FIFO_DATA_OUT_L.
+ */
+
+struct Imu {
+  uint8_t regs[0x80];
+  uint8_t pointer;
+  double drift;             // sensor clock error, e.g. 0.02 runs 2 % fast
+  double nextSampleAt;
+  uint32_t produced;        // samples taken since the rate was set
+  std::deque<int16_t> fifo;
+  unsigned pattern;         // position in its sample of the word at the head
+  bool overrun;
+  uint32_t lost;            // samples dropped from the FIFO
+
+  void reset() {
+    memset(regs, 0, sizeof(regs));
+    regs[LSM6DS3_WHO_AM_I_REG] = 0x69;
+    pointer = 0;
+    drift = 0;
+    nextSampleAt = 0;
+    produced = 0;
+    fifo.clear();
+    pattern = 0;
+    overrun = false;
+    lost = 0;
+  }
+
+  static double rate(uint8_t code) {
+    static const double rates[] = { 0, 12.5, 26, 52, 104, 208, 416, 833, 1666 };
+    return code < 9 ? rates[code] : 0;
+  }
+
+  double period() const {
+    return 1e6 / (rate(regs[LSM6DS3_CTRL1_XL] >> 4) * (1 + drift));
+  }
+
+  // Sample n: identifiable values that tie each gyroscope reading to its
+  // accelerometer reading
+  static void values(uint32_t n, int16_t v[6]) {
+    v[0] = (int16_t)n;
+    v[1] = (int16_t)(n * 7);
+    v[2] = -1000;
+    v[3] = (int16_t)(n * 3);
+    v[4] = (int16_t)(n ^ 0x5555);
+    v[5] = 8192;
+  }
+
+  bool fifoOn() const {
+    return (regs[LSM6DS3_FIFO_CTRL5] & 0x07) == 0x06;
+  }
+
+  uint32_t threshold() const {
+    return regs[LSM6DS3_FIFO_CTRL1] | (regs[LSM6DS3_FIFO_CTRL2] & 0x0F) << 8;
+  }
+
+  bool int1() const {
+    return (regs[LSM6DS3_INT1_CTRL] & 0x08) && fifoOn() && fifo.size() >= threshold();
+  }
+
+  void advance() {
+    if (!rate(regs[LSM6DS3_CTRL1_XL] >> 4)) return;
+    while (nextSampleAt <= now_us) {
+      int16_t v[6];
+      values(produced++, v);
+      memcpy(regs + LSM6DS3_OUTX_L_G, v, 12);
+      regs[LSM6DS3_STATUS_REG] |= 0x03;
+      if (fifoOn()) {
+        for (int i = 0; i < 6; i++) {
+          if (fifo.size() == 4096) {
+            pop();
+            overrun = true;
+            if (pattern == 0) lost++;
+          }
+          fifo.push_back(v[i]);
+        }
+      }
+      nextSampleAt += period();
+    }
+  }
+
+  int16_t pop() {
+    int16_t word = fifo.front();
+    fifo.pop_front();
+    pattern = (pattern + 1) % 6;
+    return word;
+  }
+
+  void write(uint8_t value) {
+    uint8_t reg = pointer++;
+    regs[reg] = value;
+    if (reg == LSM6DS3_CTRL1_XL) {
+      nextSampleAt = now_us + period();
+      produced = 0;
+    }
+    if (reg == LSM6DS3_FIFO_CTRL5 && !fifoOn()) {
+      fifo.clear();
+      pattern = 0;
+      overrun = false;
+    }
+  }
+
+  uint8_t read() {
+    uint8_t reg = pointer;
+    uint8_t value;
+    size_t words = fifo.size();
+
+    switch (reg) {
+      case LSM6DS3_FIFO_STATUS1:
+        value = words & 0xFF;
+        break;
+      case LSM6DS3_FIFO_STATUS2:
+        value = (words >= threshold() && fifoOn() ? 0x80 : 0) | (overrun ? 0x40 : 0)
+            | (words == 4096 ? 0x20 : 0) | (words == 0 ? 0x10 : 0) | ((words >> 8) & 0x0F);
+        break;
+      case LSM6DS3_FIFO_STATUS3:
+        value = words ? pattern : 0;
+        break;
+      case LSM6DS3_FIFO_STATUS4:
+        value = 0;
+        break;
+      case LSM6DS3_FIFO_DATA_OUT_L:
+        if (words) {
+          current = pop();
+          overrun = false;
+        } else {
+          current = 0;
+        }
+        value = current & 0xFF;
+        break;
+      case LSM6DS3_FIFO_DATA_OUT_H:
+        value = (uint16_t)current >> 8;
+        break;
+      default:
+        value = regs[reg];
+        if (reg >= LSM6DS3_OUTX_L_G && reg <= LSM6DS3_OUTZ_H_G) regs[LSM6DS3_STATUS_REG] &= ~0x02;
+        if (reg >= LSM6DS3_OUTX_L_XL && reg <= LSM6DS3_OUTZ_H_XL) regs[LSM6DS3_STATUS_REG] &= ~0x01;
+        break;
+    }
+
+    pointer = reg == LSM6DS3_FIFO_DATA_OUT_H ? LSM6DS3_FIFO_DATA_OUT_L : reg + 1;
+    return value;
+  }
+
+  int16_t current;
+} imu;
+
+/*
+ * TwoWire mock: a transaction costs a start, the address byte and a stop,
+ * each data byte 9 bits
+ */
+
+TwoWire Wire;
+
+static uint32_t transactions;
+static uint32_t bytes;
+static double busTime;
+static std::vector<uint8_t> txBuffer;
+static std::vector<uint8_t> rxBuffer;
+static size_t rxIndex;
+
+static void bus(double bits) {
+  double us = bits * 1e6 / busClock;
+  now_us += us;
+  busTime += us;
+  imu.advance();
+}
+
+void TwoWire::begin() {}
+void TwoWire::end() {}
+
+void TwoWire::beginTransmission(uint8_t) {
+  txBuffer.clear();
+}
+
+size_t TwoWire::write(uint8_t data) {
+  txBuffer.push_back(data);
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  bus(1 + 9 + 9 * txBuffer.size());
+  bytes += txBuffer.size();
+  if (!txBuffer.empty()) imu.pointer = txBuffer[0];
+  for (size_t i = 1; i < txBuffer.size(); i++) imu.write(txBuffer[i]);
+  if (sendStop) {
+    bus(1);
+    transactions++;
+  }
+  return 0;
+}
+
+size_t TwoWire::requestFrom(uint8_t, size_t size, bool) {
+  rxBuffer.clear();
+  rxIndex = 0;
+  // the ESP32 core refuses reads larger than its receive buffer
+  if (size > I2C_BUFFER_LENGTH) return 0;
+  bus(1 + 9);
+  for (size_t i = 0; i < size; i++) {
+    rxBuffer.push_back(imu.read());
+    bus(9);
+  }
+  bus(1);
+  bytes += size;
+  transactions++;
+  return size;
+}
+
+int TwoWire::read() {
+  return rxIndex < rxBuffer.size() ? rxBuffer[rxIndex++] : -1;
+}
+
+/*
+ * Tests
+ */
+
+static void start(LSM6DS3Class &sensor, uint32_t clock = 400000) {
+  busClock = clock;
+  now_us = 0;
+  imu.reset();
+  transactions = bytes = 0;
+  busTime = 0;
+  sensor.begin();
+}
+
+static void wait(double us) {
+  now_us += us;
+  imu.advance();
+}
+
+// Whether the samples are consecutive and each gyroscope reading matches
+// its accelerometer reading
+static bool consistent(const LSM6DS3Sample *samples, int count, int16_t first) {
+  for (int i = 0; i < count; i++) {
+    int16_t v[6];
+    Imu::values((uint16_t)(first + i), v);
+    if (memcmp(samples[i].gyroscope, v, 12)) return false;
+  }
+  return true;
+}
+
+static void test_config() {
+  printf("beginFIFO sets the rate, threshold, FIFO mode and INT1; endFIFO undoes it\n");
+  LSM6DS3Class sensor(Wire, LSM6DS3_ADDRESS);
+  start(sensor);
+
+  CHECK(sensor.beginFIFO(800, 100) == 1);
+  CHECK(sensor.accelerationSampleRate() == 833.0F);
+  CHECK(sensor.gyroscopeSampleRate() == 833.0F);
+  CHECK(imu.regs[LSM6DS3_CTRL1_XL] == 0x7A);
+  CHECK(imu.regs[LSM6DS3_CTRL2_G] == 0x7C);
+  CHECK(imu.threshold() == 600);
+  CHECK(imu.regs[LSM6DS3_FIFO_CTRL3] == 0x09);
+  CHECK(imu.regs[LSM6DS3_FIFO_CTRL5] == ((7 << 3) | 0x06));
+  CHECK(imu.regs[LSM6DS3_INT1_CTRL] == 0x08);
+
+  CHECK(sensor.beginFIFO(5000, 1000) == 1);
+  CHECK(sensor.accelerationSampleRate() == 1660.0F);
+  CHECK(imu.threshold() == 682 * 6);
+
+  sensor.endFIFO();
+  CHECK(!imu.fifoOn());
+  CHECK(imu.regs[LSM6DS3_INT1_CTRL] == 0);
+  CHECK(imu.regs[LSM6DS3_CTRL1_XL] == 0x4A);
+  CHECK(sensor.accelerationSampleRate() == 104.0F);
+}
+
+static void test_watermark_drain() {
+  printf("INT1 rises at the watermark and one readFIFO drains it in full chunks\n");
+  LSM6DS3Class sensor(Wire, LSM6DS3_ADDRESS);
+  start(sensor);
+  sensor.beginFIFO(833, 200);
+
+  while (!imu.int1()) wait(100);
+  CHECK(imu.fifo.size() == 1200);
+  CHECK(sensor.fifoAvailable() >= 200);
+
+  static LSM6DS3Sample samples[300];
+  transactions = 0;
+  int n = sensor.readFIFO(samples, 300);
+  CHECK(n >= 200);
+  CHECK(consistent(samples, n, 0));
+  CHECK(!imu.int1());
+  // status, then 10 samples per 128 byte Wire read
+  CHECK(transactions == 1 + (uint32_t)(n + 9) / 10);
+
+  float x, y, z;
+  samples[0].readAcceleration(x, y, z);
+  CHECK(z == 1.0F);
+  samples[0].readGyroscope(x, y, z);
+  CHECK(z < -61.0F && z > -61.1F);
+
+  // a short buffer leaves the rest for the next call
+  wait(50000);
+  int16_t next = (int16_t)n;
+  n = sensor.readFIFO(samples, 7);
+  CHECK(n == 7);
+  CHECK(consistent(samples, 7, next));
+  n = sensor.readFIFO(samples, 300);
+  CHECK(consistent(samples, n, next + 7));
+  CHECK(sensor.fifoOverruns() == 0);
+}
+
+static void test_overrun() {
+  printf("after an overrun the partial sample is dropped and the rest lines up\n");
+  LSM6DS3Class sensor(Wire, LSM6DS3_ADDRESS);
+  start(sensor);
+  sensor.beginFIFO(833, 100);
+
+  // 4096 words are 682.67 samples: overflowing leaves the head mid-sample
+  wait(1e6);
+  CHECK(imu.overrun);
+  CHECK(imu.pattern != 0);
+
+  static LSM6DS3Sample samples[700];
+  int n = sensor.readFIFO(samples, 700);
+  CHECK(n == 681 || n == 682);
+  CHECK(sensor.fifoOverruns() == 1);
+  CHECK(samples[0].gyroscope[0] == (int16_t)(samples[0].acceleration[0] / 3));
+  CHECK(consistent(samples, n, samples[0].gyroscope[0]));
+  CHECK(!imu.overrun);
+}
+
+static void test_timestamps() {
+  printf("timestamps follow a sensor clock running 3 %% fast\n");
+  LSM6DS3Class sensor(Wire, LSM6DS3_ADDRESS);
+  start(sensor);
+  imu.drift = 0.03;
+  sensor.beginFIFO(833, 64);
+  double t0 = now_us;
+  double truePeriod = imu.period();
+
+  static LSM6DS3Sample samples[128];
+  double worst = 0, worstSpacing = 0;
+  unsigned long previous = 0;
+  int total = 0;
+  for (int round = 0; round < 200; round++) {
+    while (!imu.int1()) wait(250);
+    wait(round % 7 * 300);  // the sketch is late by a varying amount
+    int n = sensor.readFIFO(samples, 128);
+    for (int i = 0; i < n; i++) {
+      // sample k is taken at t0 + (k + 1) * period
+      double truth = t0 + (samples[i].gyroscope[0] + 1) * truePeriod;
+      if (round >= 50) {
+        double error = fabs(samples[i].timestamp - truth);
+        if (error > worst) worst = error;
+        if (i) {
+          double spacing = fabs(samples[i].timestamp - previous - truePeriod);
+          if (spacing > worstSpacing) worstSpacing = spacing;
+        }
+      }
+      previous = samples[i].timestamp;
+    }
+    total += n;
+  }
+  printf("  %d samples, worst error %.0f us, worst spacing error %.1f us (period %.0f us)\n",
+         total, worst, worstSpacing, truePeriod);
+  CHECK(worst < truePeriod);
+  CHECK(worstSpacing < truePeriod / 200);
+}
+
+/*
+ * Benchmark: 10 s of vibration capture at 833 Hz on a 400 kHz bus, the
+ * sketch doing 'work' microseconds of other things between checks. A pass
+ * through loop() costs 10 us on top.
+ */
+
+static void bench_polling(double work) {
+  LSM6DS3Class sensor(Wire, LSM6DS3_ADDRESS);
+  start(sensor);
+  sensor.beginFIFO(833, 100);
+  sensor.endFIFO();
+  // endFIFO restores 104 Hz; run the output registers at 833 Hz instead
+  imu.regs[LSM6DS3_CTRL1_XL] = 0x7A;
+  imu.pointer = LSM6DS3_CTRL1_XL;
+  imu.write(0x7A);
+  transactions = bytes = 0;
+  busTime = 0;
+
+  double end = now_us + 10e6;
+  uint32_t kept = 0, first = imu.produced;
+  float x, y, z;
+  while (now_us < end) {
+    if (sensor.accelerationAvailable()) {
+      sensor.readAcceleration(x, y, z);
+      kept++;
+    }
+    if (sensor.gyroscopeAvailable()) {
+      sensor.readGyroscope(x, y, z);
+    }
+    wait(10 + work);
+  }
+  printf("  polling, %4.0f us work  %6.0f  %6.0f  %5.1f %%    %5.1f %%\n", work,
+         transactions / 10.0, bytes / 10.0, busTime / 10e6 * 100,
+         100.0 * kept / (imu.produced - first));
+}
+
+static void bench_fifo(double work) {
+  LSM6DS3Class sensor(Wire, LSM6DS3_ADDRESS);
+  start(sensor);
+  sensor.beginFIFO(833, 100);
+  transactions = bytes = 0;
+  busTime = 0;
+
+  static LSM6DS3Sample samples[256];
+  double end = now_us + 10e6;
+  uint32_t kept = 0, first = imu.produced;
+  while (now_us < end) {
+    if (imu.int1()) {  // the watermark pin, no bus traffic
+      kept += sensor.readFIFO(samples, 256);
+    }
+    wait(10 + work);
+  }
+  kept += sensor.readFIFO(samples, 256);
+  printf("  FIFO,    %4.0f us work  %6.0f  %6.0f  %5.1f %%    %5.1f %%\n", work,
+         transactions / 10.0, bytes / 10.0, busTime / 10e6 * 100,
+         100.0 * kept / (imu.produced - first));
+}
+
+static void bench() {
+  printf("833 Hz, 400 kHz I2C      transactions/s bytes/s  bus busy  samples kept\n");
+  bench_polling(0);
+  bench_polling(2000);
+  bench_fifo(0);
+  bench_fifo(2000);
+  bench_fifo(20000);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    bench();
+    return 0;
+  }
+
+  test_config();
+  test_watermark_drain();
+  test_overrun();
+  test_timestamps();
+
+  return test_summary();
+}
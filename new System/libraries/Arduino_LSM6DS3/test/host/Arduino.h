@@ -0,0 +1,23 @@
+// Host stand-in for the Arduino core: just what the library calls.
+// fifo.cpp implements the functions on its simulated clock.
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x0
+#define OUTPUT 0x1
+
+#define MSBFIRST 1
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+unsigned long micros();
+
+#endif
@@ -0,0 +1,26 @@
+// Host stand-in for SPI: enough to compile the SPI constructor.
+
+#ifndef SPI_H
+#define SPI_H
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+
+class SPISettings {
+public:
+  SPISettings() {}
+  SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class SPIClass {
+public:
+  void begin() {}
+  void end() {}
+  void beginTransaction(SPISettings) {}
+  void endTransaction() {}
+  uint8_t transfer(uint8_t) { return 0; }
+  void transfer(void*, size_t) {}
+};
+
+#endif
@@ -0,0 +1,24 @@
+// Host stand-in for Wire: the I2C bus of the register model in fifo.cpp.
+
+#ifndef TWOWIRE_H
+#define TWOWIRE_H
+
+#include <Arduino.h>
+
+// Receive buffer of the ESP32 core
+#define I2C_BUFFER_LENGTH 128
+
+class TwoWire {
+public:
+  void begin();
+  void end();
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  uint8_t endTransmission(bool sendStop = true);
+  size_t requestFrom(uint8_t address, size_t size, bool sendStop = true);
+  int read();
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -47,14 +47,19 @@ Arduino_SPIFFS::Arduino_SPIFFS(spiffs_read read_func, spiffs_write write_func, s
 
 int Arduino_SPIFFS::mount()
 {
-  return SPIFFS_mount(&_fs,
-                      &cfg,
-                      _spiffs_work_buf,
-                      _spiffs_fds,
-                      sizeof(_spiffs_fds),
-                      _spiffs_cache_buf,
-                      sizeof(_spiffs_cache_buf),
-                      0);
+  int res = SPIFFS_mount(&_fs,
+                         &cfg,
+                         _spiffs_work_buf,
+                         _spiffs_fds,
+                         sizeof(_spiffs_fds),
+                         _spiffs_cache_buf,
+                         sizeof(_spiffs_cache_buf),
+                         0);
+#if SPIFFS_NAME_INDEX && ARDUINO_SPIFFS_NAME_INDEX_FILES > 0
+  if (res == SPIFFS_OK)
+    res = SPIFFS_name_index(&_fs, _spiffs_name_index_buf, sizeof(_spiffs_name_index_buf));
+#endif
+  return res;
 }
 
 File Arduino_SPIFFS::open(const char *path, uint16_t const flags)
@@ -39,6 +39,13 @@ extern "C"
 
 #define SPIFFS_USE_W25Q16DV_FLASH
 
+/* Files whose names are looked up in RAM rather than on the flash, beyond that
+ * they are searched for on the flash. About 16 bytes per file, 0 disables it.
+ */
+#ifndef ARDUINO_SPIFFS_NAME_INDEX_FILES
+  #define ARDUINO_SPIFFS_NAME_INDEX_FILES 16
+#endif
+
 /**************************************************************************************
  * SANITY CHECK
  **************************************************************************************/
@@ -94,6 +101,7 @@ public:
          File        open    (const char * path, uint16_t const flags);
   inline int         remove  (const char * path)                          { return SPIFFS_remove(&_fs, path); }
   inline int         rename  (const char * old, const char * newPath)     { return SPIFFS_rename(&_fs, old, newPath); }
+  inline int         sync    ()                                           { return SPIFFS_sync(&_fs); } /* Write all cached data of all open files to flash */
 
   inline int         create  (String const & path)                        { return create(path.c_str()); }
   inline File        open    (String const & path, uint16_t const flags)  { return open(path.c_str(), flags); }
@@ -121,6 +129,9 @@ private:
   u8_t   _spiffs_work_buf[SPIFFS_CFG_LOG_PAGE_SZ(0)*2];
   u8_t   _spiffs_fds[32*4];
   u8_t   _spiffs_cache_buf[(SPIFFS_CFG_LOG_PAGE_SZ(0)+32)*4];
+#if SPIFFS_NAME_INDEX && ARDUINO_SPIFFS_NAME_INDEX_FILES > 0
+  u32_t  _spiffs_name_index_buf[SPIFFS_NAME_INDEX_MEM_SZ(ARDUINO_SPIFFS_NAME_INDEX_FILES)/sizeof(u32_t)];
+#endif
 
 
   inline int read  (spiffs_file fh, void * buf, int len)  { return SPIFFS_read(&_fs, fh, buf, len); }
@@ -62,6 +62,8 @@ extern "C" {
 
 #define SPIFFS_ERR_SEEK_BOUNDS          -10040
 
+#define SPIFFS_ERR_NAME_INDEX_MEM       -10041
+
 
 #define SPIFFS_ERR_INTERNAL             -10050
 
@@ -281,6 +283,11 @@ typedef struct spiffs_t {
 #endif
 #endif
 
+#if SPIFFS_NAME_INDEX
+  // name index memory, see SPIFFS_name_index
+  void *name_ix;
+#endif
+
   // check callback function
   spiffs_check_callback check_cb_f;
   // file callback function
@@ -337,6 +344,28 @@ typedef struct {
 
 #endif
 
+#if SPIFFS_NAME_INDEX
+
+// name index entry, one per file, see SPIFFS_name_index
+typedef struct {
+  // djb2 hash of the file name
+  u32_t name_hash;
+  // object id of the file
+  spiffs_obj_id obj_id;
+  // object index header page of the file
+  spiffs_page_ix pix;
+  // next entry in the same name hash bucket
+  u16_t name_next;
+  // next entry in the same object id bucket, or next unused entry
+  u16_t id_next;
+} spiffs_name_ix_entry;
+
+// bytes of memory SPIFFS_name_index needs to index given number of files
+#define SPIFFS_NAME_INDEX_MEM_SZ(files) \
+  (16 + (files) * (sizeof(spiffs_name_ix_entry) + 2 * sizeof(u16_t)))
+
+#endif
+
 // functions
 
 #if SPIFFS_USE_MAGIC && SPIFFS_USE_MAGIC_LENGTH && SPIFFS_SINGLETON==0
@@ -519,6 +548,14 @@ s32_t SPIFFS_fstat(spiffs *fs, spiffs_file fh, spiffs_stat *s);
  */
 s32_t SPIFFS_fflush(spiffs *fs, spiffs_file fh);
 
+/**
+ * Flushes all pending write operations from cache for all open files.
+ * Small writes are held in cache until their cache page fills, call this (or
+ * SPIFFS_fflush) at the points where data must have reached flash.
+ * @param fs            the file system struct
+ */
+s32_t SPIFFS_sync(spiffs *fs);
+
 /**
  * Closes a filehandle. If there are pending write operations, these are finalized before closing.
  * @param fs            the file system struct
@@ -782,6 +819,27 @@ s32_t SPIFFS_ix_map_entries_to_bytes(spiffs *fs, u32_t map_page_ix_entries);
 
 #endif // SPIFFS_IX_MAP
 
+#if SPIFFS_NAME_INDEX
+
+/**
+ * Gives the file system memory for an index from file names to object index
+ * header pages. SPIFFS_open, SPIFFS_stat, SPIFFS_remove and SPIFFS_rename
+ * then find a file, or find that it does not exist, with the index instead of
+ * searching the object lookup pages of the whole medium.
+ * The medium is scanned once to fill the index, after that the index follows
+ * all changes to the file system. If there are more files than fit in the
+ * memory, the ones left out are still found by searching the medium.
+ * Must be invoked after mount. The memory belongs to spiffs until unmount or
+ * until this is called again; call with mem 0 to stop using an index.
+ * @param fs        the file system struct
+ * @param mem       memory for the index
+ * @param mem_size  size of mem in bytes, SPIFFS_NAME_INDEX_MEM_SZ gives how
+ *                  much is needed for a number of files
+ */
+s32_t SPIFFS_name_index(spiffs *fs, void *mem, u32_t mem_size);
+
+#endif // SPIFFS_NAME_INDEX
+
 
 #if SPIFFS_TEST_VISUALISATION
 /**
@@ -10,20 +10,69 @@
 
 #if SPIFFS_CACHE
 
+// Read cache pages are kept in an lru list (most recent first) and in a
+// hash from page index to cache page, both linked through the cache page
+// headers, so looking up, touching and evicting a page never scans the
+// cache. Write cache pages belong to their fd and are in neither.
+
+static spiffs_cache_page *spiffs_cache_page_at(spiffs *fs, spiffs_cache *cache, u8_t ix) {
+  (void)fs;
+  return ix == SPIFFS_CACHE_NONE ? 0 : spiffs_get_cache_page_hdr(fs, cache, ix);
+}
+
+static void spiffs_cache_lru_unlink(spiffs *fs, spiffs_cache *cache, spiffs_cache_page *cp) {
+  spiffs_cache_page *prev = spiffs_cache_page_at(fs, cache, cp->prev);
+  spiffs_cache_page *next = spiffs_cache_page_at(fs, cache, cp->next);
+  if (prev) prev->next = cp->next; else cache->lru_head = cp->next;
+  if (next) next->prev = cp->prev; else cache->lru_tail = cp->prev;
+}
+
+static void spiffs_cache_lru_push(spiffs *fs, spiffs_cache *cache, spiffs_cache_page *cp) {
+  spiffs_cache_page *head = spiffs_cache_page_at(fs, cache, cache->lru_head);
+  cp->prev = SPIFFS_CACHE_NONE;
+  cp->next = cache->lru_head;
+  if (head) head->prev = cp->ix; else cache->lru_tail = cp->ix;
+  cache->lru_head = cp->ix;
+}
+
+// marks a read cache page as the most recently used
+static void spiffs_cache_lru_touch(spiffs *fs, spiffs_cache *cache, spiffs_cache_page *cp) {
+  if (cache->lru_head == cp->ix) return;
+  spiffs_cache_lru_unlink(fs, cache, cp);
+  spiffs_cache_lru_push(fs, cache, cp);
+}
+
+static spiffs_cache_page *spiffs_cache_bucket(spiffs *fs, spiffs_cache *cache, spiffs_page_ix pix) {
+  (void)fs;
+  return spiffs_get_cache_page_hdr(fs, cache, pix & cache->hash_mask);
+}
+
+static void spiffs_cache_hash_add(spiffs *fs, spiffs_cache *cache, spiffs_cache_page *cp) {
+  spiffs_cache_page *bucket = spiffs_cache_bucket(fs, cache, cp->pix);
+  cp->hash_next = bucket->bucket;
+  bucket->bucket = cp->ix;
+}
+
+static void spiffs_cache_hash_remove(spiffs *fs, spiffs_cache *cache, spiffs_cache_page *cp) {
+  u8_t *link = &spiffs_cache_bucket(fs, cache, cp->pix)->bucket;
+  while (*link != cp->ix) {
+    link = &spiffs_get_cache_page_hdr(fs, cache, *link)->hash_next;
+  }
+  *link = cp->hash_next;
+}
+
 // returns cached page for give page index, or null if no such cached page
 static spiffs_cache_page *spiffs_cache_page_get(spiffs *fs, spiffs_page_ix pix) {
   spiffs_cache *cache = spiffs_get_cache(fs);
   if ((cache->cpage_use_map & cache->cpage_use_mask) == 0) return 0;
-  int i;
-  for (i = 0; i < cache->cpage_count; i++) {
-    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, i);
-    if ((cache->cpage_use_map & (1<<i)) &&
-        (cp->flags & SPIFFS_CACHE_FLAG_TYPE_WR) == 0 &&
-        cp->pix == pix ) {
-      //SPIFFS_CACHE_DBG("CACHE_GET: have cache page "_SPIPRIi" for "_SPIPRIpg"\n", i, pix);
-      cp->last_access = cache->last_access;
+  spiffs_cache_page *cp = spiffs_cache_page_at(fs, cache, spiffs_cache_bucket(fs, cache, pix)->bucket);
+  while (cp) {
+    if (cp->pix == pix) {
+      //SPIFFS_CACHE_DBG("CACHE_GET: have cache page "_SPIPRIi" for "_SPIPRIpg"\n", cp->ix, pix);
+      spiffs_cache_lru_touch(fs, cache, cp);
       return cp;
     }
+    cp = spiffs_cache_page_at(fs, cache, cp->hash_next);
   }
   //SPIFFS_CACHE_DBG("CACHE_GET: no cache for "_SPIPRIpg"\n", pix);
   return 0;
@@ -50,17 +99,20 @@ static s32_t spiffs_cache_page_free(spiffs *fs, int ix, u8_t write_back) {
 #endif
     {
       SPIFFS_CACHE_DBG("CACHE_FREE: free cache page "_SPIPRIi" pix "_SPIPRIpg"\n", ix, cp->pix);
+      spiffs_cache_lru_unlink(fs, cache, cp);
+      spiffs_cache_hash_remove(fs, cache, cp);
     }
     cache->cpage_use_map &= ~(1 << ix);
     cp->flags = 0;
+    cp->next = cache->free_head;
+    cache->free_head = cp->ix;
   }
 
   return res;
 }
 
-// removes the oldest accessed cached page
-static s32_t spiffs_cache_page_remove_oldest(spiffs *fs, u8_t flag_mask, u8_t flags) {
-  s32_t res = SPIFFS_OK;
+// removes the least recently used read cache page if all cache pages are taken
+static s32_t spiffs_cache_page_remove_oldest(spiffs *fs) {
   spiffs_cache *cache = spiffs_get_cache(fs);
 
   if ((cache->cpage_use_map & cache->cpage_use_mask) != cache->cpage_use_mask) {
@@ -68,45 +120,26 @@ static s32_t spiffs_cache_page_remove_oldest(spiffs *fs, u8_t flag_mask, u8_t fl
     return SPIFFS_OK;
   }
 
-  // all busy, scan thru all to find the cpage which has oldest access
-  int i;
-  int cand_ix = -1;
-  u32_t oldest_val = 0;
-  for (i = 0; i < cache->cpage_count; i++) {
-    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, i);
-    if ((cache->last_access - cp->last_access) > oldest_val &&
-        (cp->flags & flag_mask) == flags) {
-      oldest_val = cache->last_access - cp->last_access;
-      cand_ix = i;
-    }
-  }
-
-  if (cand_ix >= 0) {
-    res = spiffs_cache_page_free(fs, cand_ix, 1);
+  if (cache->lru_tail == SPIFFS_CACHE_NONE) {
+    // all taken by write caches
+    return SPIFFS_OK;
   }
 
-  return res;
+  return spiffs_cache_page_free(fs, cache->lru_tail, 1);
 }
 
 // allocates a new cached page and returns it, or null if all cache pages are busy
 static spiffs_cache_page *spiffs_cache_page_allocate(spiffs *fs) {
   spiffs_cache *cache = spiffs_get_cache(fs);
-  if (cache->cpage_use_map == 0xffffffff) {
-    // out of cache memory
+  spiffs_cache_page *cp = spiffs_cache_page_at(fs, cache, cache->free_head);
+  if (cp == 0) {
+    // out of cache entries
     return 0;
   }
-  int i;
-  for (i = 0; i < cache->cpage_count; i++) {
-    if ((cache->cpage_use_map & (1<<i)) == 0) {
-      spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, i);
-      cache->cpage_use_map |= (1<<i);
-      cp->last_access = cache->last_access;
-      //SPIFFS_CACHE_DBG("CACHE_ALLO: allocated cache page "_SPIPRIi"\n", i);
-      return cp;
-    }
-  }
-  // out of cache entries
-  return 0;
+  cache->free_head = cp->next;
+  cache->cpage_use_map |= (1<<cp->ix);
+  //SPIFFS_CACHE_DBG("CACHE_ALLO: allocated cache page "_SPIPRIi"\n", cp->ix);
+  return cp;
 }
 
 // drops the cache page for give page index
@@ -131,13 +164,11 @@ s32_t spiffs_phys_rd(
   s32_t res = SPIFFS_OK;
   spiffs_cache *cache = spiffs_get_cache(fs);
   spiffs_cache_page *cp =  spiffs_cache_page_get(fs, SPIFFS_PADDR_TO_PAGE(fs, addr));
-  cache->last_access++;
   if (cp) {
     // we've already got one, you see
 #if SPIFFS_CACHE_STATS
     fs->cache_hits++;
 #endif
-    cp->last_access = cache->last_access;
     u8_t *mem =  spiffs_get_cache_page(fs, cache, cp->ix);
     _SPIFFS_MEMCPY(dst, &mem[SPIFFS_PADDR_TO_PAGE_OFFSET(fs, addr)], len);
   } else {
@@ -150,12 +181,14 @@ s32_t spiffs_phys_rd(
 #endif
     // this operation will always free one cache page (unless all already free),
     // the result code stems from the write operation of the possibly freed cache page
-    res = spiffs_cache_page_remove_oldest(fs, SPIFFS_CACHE_FLAG_TYPE_WR, 0);
+    res = spiffs_cache_page_remove_oldest(fs);
 
     cp = spiffs_cache_page_allocate(fs);
     if (cp) {
       cp->flags = SPIFFS_CACHE_FLAG_WRTHRU;
       cp->pix = SPIFFS_PADDR_TO_PAGE(fs, addr);
+      spiffs_cache_hash_add(fs, cache, cp);
+      spiffs_cache_lru_push(fs, cache, cp);
       SPIFFS_CACHE_DBG("CACHE_ALLO: allocated cache page "_SPIPRIi" for pix "_SPIPRIpg "\n", cp->ix, cp->pix);
 
       s32_t res2 = SPIFFS_HAL_READ(fs,
@@ -207,9 +240,6 @@ s32_t spiffs_phys_wr(
     u8_t *mem =  spiffs_get_cache_page(fs, cache, cp->ix);
     _SPIFFS_MEMCPY(&mem[SPIFFS_PADDR_TO_PAGE_OFFSET(fs, addr)], src, len);
 
-    cache->last_access++;
-    cp->last_access = cache->last_access;
-
     if (cp->flags & SPIFFS_CACHE_FLAG_WRTHRU) {
       // page is being updated, no write-cache, just pass thru
       return SPIFFS_HAL_WRITE(fs, addr, len, src);
@@ -250,7 +280,7 @@ spiffs_cache_page *spiffs_cache_page_get_by_fd(spiffs *fs, spiffs_fd *fd) {
 spiffs_cache_page *spiffs_cache_page_allocate_by_fd(spiffs *fs, spiffs_fd *fd) {
   // before this function is called, it is ensured that there is no already existing
   // cache page with same object id
-  spiffs_cache_page_remove_oldest(fs, SPIFFS_CACHE_FLAG_TYPE_WR, 0);
+  spiffs_cache_page_remove_oldest(fs);
   spiffs_cache_page *cp = spiffs_cache_page_allocate(fs);
   if (cp == 0) {
     // could not get cache page
@@ -304,6 +334,13 @@ void spiffs_cache_init(spiffs *fs) {
 
   cache.cpage_use_map = 0xffffffff;
   cache.cpage_use_mask = cache_mask;
+  cache.lru_head = SPIFFS_CACHE_NONE;
+  cache.lru_tail = SPIFFS_CACHE_NONE;
+  cache.free_head = 0;
+  // as many hash buckets as the largest power of 2 that is no more than the cache pages
+  while ((u32_t)cache.hash_mask * 2 + 1 < (u32_t)cache_entries) {
+    cache.hash_mask = cache.hash_mask * 2 + 1;
+  }
   _SPIFFS_MEMCPY(fs->cache, &cache, sizeof(spiffs_cache));
 
   spiffs_cache *c = spiffs_get_cache(fs);
@@ -312,7 +349,10 @@ void spiffs_cache_init(spiffs *fs) {
 
   c->cpage_use_map &= ~(c->cpage_use_mask);
   for (i = 0; i < cache.cpage_count; i++) {
-    spiffs_get_cache_page_hdr(fs, c, i)->ix = i;
+    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, c, i);
+    cp->ix = i;
+    cp->next = (i + 1 < cache.cpage_count) ? i + 1 : SPIFFS_CACHE_NONE;
+    cp->bucket = SPIFFS_CACHE_NONE;
   }
 }
 
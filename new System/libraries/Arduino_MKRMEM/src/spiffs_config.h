@@ -307,6 +307,19 @@ typedef uint8_t  u8_t;
 #define SPIFFS_IX_MAP                         1
 #endif
 
+// Enable to be able to give spiffs memory for an index from file names to
+// object index header pages. Without it, opening, stat'ing, removing or
+// renaming a file by name reads object lookup pages until the name is found,
+// and all of them if it is not there. With it, the file system is scanned
+// once when the memory is given and the index is kept up to date when files
+// are created, renamed, moved by the garbage collector and removed, so a name
+// is found or ruled out with at most one page read per name hash match.
+// Files that do not fit in the given memory are searched for on the medium
+// as before.
+#ifndef SPIFFS_NAME_INDEX
+#define SPIFFS_NAME_INDEX                     1
+#endif
+
 // By default SPIFFS in some cases relies on the property of NOR flash that bits
 // cannot be set from 0 to 1 by writing and that controllers will ignore such
 // bit changes. This results in fewer reads as SPIFFS can in some cases perform
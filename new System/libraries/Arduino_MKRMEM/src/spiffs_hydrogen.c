@@ -168,6 +168,9 @@ void SPIFFS_unmount(spiffs *fs) {
     }
   }
   fs->mounted = 0;
+#if SPIFFS_NAME_INDEX
+  fs->name_ix = 0;
+#endif
 
   SPIFFS_UNLOCK(fs);
 }
@@ -455,6 +458,39 @@ static s32_t spiffs_hydro_write(spiffs *fs, spiffs_fd *fd, void *buf, u32_t offs
 }
 #endif // !SPIFFS_READ_ONLY
 
+#if SPIFFS_CACHE_WR
+// writes the fd's cached data to flash and gives back its cache page
+static s32_t spiffs_fd_write_back(spiffs *fs, spiffs_fd *fd) {
+  s32_t res = spiffs_hydro_write(fs, fd,
+      spiffs_get_cache_page(fs, spiffs_get_cache(fs), fd->cache_page->ix),
+      fd->cache_page->offset, fd->cache_page->size);
+  spiffs_cache_fd_release(fs, fd->cache_page);
+  return res;
+}
+
+// writes the fd's cached data up to the last data page end in it and keeps
+// a short rest cached, so the next write back starts on a fresh data page.
+// A long rest is likely to be flushed on its own before its page fills,
+// which would cost an extra object index update, so it goes along now.
+static s32_t spiffs_fd_write_back_pages(spiffs *fs, spiffs_fd *fd) {
+  spiffs_cache_page *cp = fd->cache_page;
+  u32_t keep = (cp->offset + cp->size) % SPIFFS_DATA_PAGE_SIZE(fs);
+  if (keep == 0 || keep >= cp->size || keep > SPIFFS_DATA_PAGE_SIZE(fs) / 8) {
+    return spiffs_fd_write_back(fs, fd);
+  }
+  u8_t *cpage_data = spiffs_get_cache_page(fs, spiffs_get_cache(fs), cp->ix);
+  s32_t res = spiffs_hydro_write(fs, fd, cpage_data, cp->offset, cp->size - keep);
+  if (res < SPIFFS_OK) {
+    spiffs_cache_fd_release(fs, cp);
+    return res;
+  }
+  memmove(cpage_data, &cpage_data[cp->size - keep], keep);
+  cp->offset += cp->size - keep;
+  cp->size = keep;
+  return res;
+}
+#endif
+
 s32_t SPIFFS_write(spiffs *fs, spiffs_file fh, void *buf, s32_t len) {
   SPIFFS_API_DBG("%s "_SPIPRIfd " "_SPIPRIi "\n", __func__, fh, len);
 #if SPIFFS_READ_ONLY
@@ -505,49 +541,50 @@ s32_t SPIFFS_write(spiffs *fs, spiffs_file fh, void *buf, s32_t len) {
 #if SPIFFS_CACHE_WR
   if ((fd->flags & SPIFFS_O_DIRECT) == 0) {
     if (len < (s32_t)SPIFFS_CFG_LOG_PAGE_SZ(fs)) {
-      // small write, try to cache it
-      u8_t alloc_cpage = 1;
-      if (fd->cache_page) {
-        // have a cached page for this fd already, check cache page boundaries
-        if (offset < fd->cache_page->offset || // writing before cache
-            offset > fd->cache_page->offset + fd->cache_page->size || // writing after cache
-            offset + len > fd->cache_page->offset + SPIFFS_CFG_LOG_PAGE_SZ(fs)) // writing beyond cache page
+      // small write, try to cache it. A full cache page is written back up
+      // to the last data page end in it, so appends mostly reach flash as
+      // whole data pages instead of a partial program on each side of every
+      // write back.
+      u8_t *src = (u8_t *)buf;
+      s32_t left = len;
+      while (left > 0) {
+        if (fd->cache_page &&
+            (offset < fd->cache_page->offset || // writing before cache
+             offset > fd->cache_page->offset + fd->cache_page->size)) // writing after cache
         {
           // boundary violation, write back cache first and allocate new
           SPIFFS_CACHE_DBG("CACHE_WR_DUMP: dumping cache page "_SPIPRIi" for fd "_SPIPRIfd":"_SPIPRIid", boundary viol, offs:"_SPIPRIi" size:"_SPIPRIi"\n",
               fd->cache_page->ix, fd->file_nbr, fd->obj_id, fd->cache_page->offset, fd->cache_page->size);
-          res = spiffs_hydro_write(fs, fd,
-              spiffs_get_cache_page(fs, spiffs_get_cache(fs), fd->cache_page->ix),
-              fd->cache_page->offset, fd->cache_page->size);
-          spiffs_cache_fd_release(fs, fd->cache_page);
+          res = spiffs_fd_write_back(fs, fd);
           SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
-        } else {
-          // writing within cache
-          alloc_cpage = 0;
         }
-      }
 
-      if (alloc_cpage) {
-        fd->cache_page = spiffs_cache_page_allocate_by_fd(fs, fd);
-        if (fd->cache_page) {
+        if (fd->cache_page == 0) {
+          fd->cache_page = spiffs_cache_page_allocate_by_fd(fs, fd);
+          if (fd->cache_page == 0) {
+            // no cache page to be had, write thru
+            res = spiffs_hydro_write(fs, fd, src, offset, left);
+            SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+            fd->fdoffset += left;
+            break;
+          }
           fd->cache_page->offset = offset;
           fd->cache_page->size = 0;
           SPIFFS_CACHE_DBG("CACHE_WR_ALLO: allocating cache page "_SPIPRIi" for fd "_SPIPRIfd":"_SPIPRIid"\n",
               fd->cache_page->ix, fd->file_nbr, fd->obj_id);
         }
-      }
 
-      if (fd->cache_page) {
         u32_t offset_in_cpage = offset - fd->cache_page->offset;
+        u32_t chunk = MIN((u32_t)left, SPIFFS_CFG_LOG_PAGE_SZ(fs) - offset_in_cpage);
         SPIFFS_CACHE_DBG("CACHE_WR_WRITE: storing to cache page "_SPIPRIi" for fd "_SPIPRIfd":"_SPIPRIid", offs "_SPIPRIi":"_SPIPRIi" len "_SPIPRIi"\n",
             fd->cache_page->ix, fd->file_nbr, fd->obj_id,
-            offset, offset_in_cpage, len);
+            offset, offset_in_cpage, chunk);
         spiffs_cache *cache = spiffs_get_cache(fs);
         u8_t *cpage_data = spiffs_get_cache_page(fs, cache, fd->cache_page->ix);
 #ifdef _SPIFFS_TEST
         {
           intptr_t __a1 = (u8_t*)&cpage_data[offset_in_cpage]-(u8_t*)cache;
-          intptr_t __a2 = (u8_t*)&cpage_data[offset_in_cpage]+len-(u8_t*)cache;
+          intptr_t __a2 = (u8_t*)&cpage_data[offset_in_cpage]+chunk-(u8_t*)cache;
           intptr_t __b = sizeof(spiffs_cache) + cache->cpage_count * (sizeof(spiffs_cache_page) + SPIFFS_CFG_LOG_PAGE_SZ(fs));
           if (__a1 > __b || __a2 > __b) {
             printf("FATAL OOB: CACHE_WR: memcpy to cache buffer ixs:%4ld..%4ld of %4ld\n", __a1, __a2, __b);
@@ -555,18 +592,23 @@ s32_t SPIFFS_write(spiffs *fs, spiffs_file fh, void *buf, s32_t len) {
           }
         }
 #endif
-        _SPIFFS_MEMCPY(&cpage_data[offset_in_cpage], buf, len);
-        fd->cache_page->size = MAX(fd->cache_page->size, offset_in_cpage + len);
-        fd->fdoffset += len;
-        SPIFFS_UNLOCK(fs);
-        return len;
-      } else {
-        res = spiffs_hydro_write(fs, fd, buf, offset, len);
-        SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
-        fd->fdoffset += len;
-        SPIFFS_UNLOCK(fs);
-        return res;
+        _SPIFFS_MEMCPY(&cpage_data[offset_in_cpage], src, chunk);
+        fd->cache_page->size = MAX(fd->cache_page->size, offset_in_cpage + chunk);
+        fd->fdoffset += chunk;
+        offset += chunk;
+        src += chunk;
+        left -= chunk;
+
+        if (left > 0) {
+          // cache page full
+          SPIFFS_CACHE_DBG("CACHE_WR_DUMP: dumping cache page "_SPIPRIi" for fd "_SPIPRIfd":"_SPIPRIid", full, offs:"_SPIPRIi" size:"_SPIPRIi"\n",
+              fd->cache_page->ix, fd->file_nbr, fd->obj_id, fd->cache_page->offset, fd->cache_page->size);
+          res = spiffs_fd_write_back_pages(fs, fd);
+          SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+        }
       }
+      SPIFFS_UNLOCK(fs);
+      return len;
     } else {
       // big write, no need to cache it - but first check if there is a cached write already
       if (fd->cache_page) {
@@ -822,6 +864,8 @@ static s32_t spiffs_fflush_cache(spiffs *fs, spiffs_file fh) {
           fd->cache_page->offset, fd->cache_page->size);
       if (res < SPIFFS_OK) {
         fs->err_code = res;
+      } else {
+        res = SPIFFS_OK;
       }
       spiffs_cache_fd_release(fs, fd->cache_page);
     }
@@ -849,6 +893,31 @@ s32_t SPIFFS_fflush(spiffs *fs, spiffs_file fh) {
   return res;
 }
 
+s32_t SPIFFS_sync(spiffs *fs) {
+  SPIFFS_API_DBG("%s\n", __func__);
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  s32_t res = SPIFFS_OK;
+#if !SPIFFS_READ_ONLY && SPIFFS_CACHE_WR
+  SPIFFS_LOCK(fs);
+  u32_t i;
+  spiffs_fd *fds = (spiffs_fd *)fs->fd_space;
+  for (i = 0; i < fs->fd_count; i++) {
+    spiffs_fd *cur_fd = &fds[i];
+    if (cur_fd->file_nbr != 0) {
+      s32_t res2 = spiffs_fflush_cache(fs, cur_fd->file_nbr);
+      if (res == SPIFFS_OK) {
+        res = res2;
+      }
+    }
+  }
+  SPIFFS_API_CHECK_RES_UNLOCK(fs,res);
+  SPIFFS_UNLOCK(fs);
+#endif
+
+  return res;
+}
+
 s32_t SPIFFS_close(spiffs *fs, spiffs_file fh) {
   SPIFFS_API_DBG("%s "_SPIPRIfd "\n", __func__, fh);
   SPIFFS_API_CHECK_CFG(fs);
@@ -1115,6 +1184,13 @@ s32_t SPIFFS_check(spiffs *fs) {
 
   res = spiffs_obj_lu_scan(fs);
 
+#if SPIFFS_NAME_INDEX
+  // the check moves and deletes pages behind the index' back
+  if (res == SPIFFS_OK && fs->name_ix) {
+    res = spiffs_name_ix_build(fs);
+  }
+#endif
+
   SPIFFS_UNLOCK(fs);
   return res;
 #endif // SPIFFS_READ_ONLY
@@ -1375,6 +1451,32 @@ s32_t SPIFFS_ix_map_entries_to_bytes(spiffs *fs, u32_t map_page_ix_entries) {
 
 #endif // SPIFFS_IX_MAP
 
+#if SPIFFS_NAME_INDEX
+
+s32_t SPIFFS_name_index(spiffs *fs, void *mem, u32_t mem_size) {
+  SPIFFS_API_DBG("%s "_SPIPRIi "\n", __func__, mem_size);
+  s32_t res;
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  res = spiffs_name_ix_init(fs, mem, mem_size);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+
+  if (fs->name_ix) {
+    res = spiffs_name_ix_build(fs);
+    if (res != SPIFFS_OK) {
+      fs->name_ix = 0;
+    }
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+  }
+
+  SPIFFS_UNLOCK(fs);
+  return res;
+}
+
+#endif // SPIFFS_NAME_INDEX
+
 #if SPIFFS_TEST_VISUALISATION
 s32_t SPIFFS_vis(spiffs *fs) {
   s32_t res = SPIFFS_OK;
@@ -1141,6 +1141,12 @@ void spiffs_cb_object_event(
 
 #endif
 
+#if SPIFFS_NAME_INDEX
+  if (fs->name_ix && spix == 0) {
+    spiffs_name_ix_event(fs, objix, ev, obj_id, new_pix);
+  }
+#endif
+
   // callback to user if object index header
   if (fs->file_cb_f && spix == 0 && (obj_id_raw & SPIFFS_OBJ_ID_IX_FLAG)) {
     spiffs_fileop_type op;
@@ -1706,6 +1712,15 @@ s32_t spiffs_object_find_object_index_header_by_name(
   spiffs_block_ix bix;
   int entry;
 
+#if SPIFFS_NAME_INDEX
+  if (fs->name_ix) {
+    res = spiffs_name_ix_find(fs, name, pix);
+    if (res != SPIFFS_NAME_IX_UNKNOWN) {
+      return res;
+    }
+  }
+#endif
+
   res = spiffs_obj_lu_find_entry_visitor(fs,
       fs->cursor_block_ix,
       fs->cursor_obj_lu_entry,
@@ -2235,7 +2250,7 @@ s32_t spiffs_obj_lu_find_free_obj_id(spiffs *fs, spiffs_obj_id *obj_id, const u8
 }
 #endif // !SPIFFS_READ_ONLY
 
-#if SPIFFS_TEMPORAL_FD_CACHE
+#if SPIFFS_TEMPORAL_FD_CACHE || SPIFFS_NAME_INDEX
 // djb2 hash
 static u32_t spiffs_hash(spiffs *fs, const u8_t *name) {
   (void)fs;
@@ -2372,3 +2387,274 @@ void spiffs_fd_temporal_cache_rehash(
   }
 }
 #endif
+
+#if SPIFFS_NAME_INDEX
+
+// bytes before the entries, see SPIFFS_NAME_INDEX_MEM_SZ
+#define SPIFFS_NAME_IX_HDR_SZ   16
+
+static spiffs_name_ix_entry *spiffs_name_ix_entries(spiffs_name_ix *ix) {
+  return (spiffs_name_ix_entry *)((u8_t *)ix + SPIFFS_NAME_IX_HDR_SZ);
+}
+
+static u16_t *spiffs_name_ix_name_buckets(spiffs_name_ix *ix) {
+  return (u16_t *)(spiffs_name_ix_entries(ix) + ix->capacity);
+}
+
+static u16_t *spiffs_name_ix_id_buckets(spiffs_name_ix *ix) {
+  return spiffs_name_ix_name_buckets(ix) + ix->bucket_mask + 1;
+}
+
+static void spiffs_name_ix_clear(spiffs_name_ix *ix) {
+  spiffs_name_ix_entry *entries = spiffs_name_ix_entries(ix);
+  u32_t i;
+  memset(spiffs_name_ix_name_buckets(ix), 0xff, 2 * (ix->bucket_mask + 1) * sizeof(u16_t));
+  for (i = 0; i < ix->capacity; i++) {
+    entries[i].id_next = i + 1 < ix->capacity ? i + 1 : SPIFFS_NAME_IX_NONE;
+  }
+  ix->free_head = 0;
+  ix->count = 0;
+  ix->complete = 1;
+}
+
+s32_t spiffs_name_ix_init(
+    spiffs *fs,
+    void *mem,
+    u32_t mem_size) {
+  fs->name_ix = 0;
+  if (mem == 0) {
+    return SPIFFS_OK;
+  }
+  // entries start with an u32_t
+  u32_t skew = (4 - ((size_t)mem & 3)) & 3;
+  if (mem_size < skew + SPIFFS_NAME_INDEX_MEM_SZ(1)) {
+    return SPIFFS_ERR_NAME_INDEX_MEM;
+  }
+  mem_size -= skew + SPIFFS_NAME_IX_HDR_SZ;
+  u32_t capacity = MIN(mem_size / (sizeof(spiffs_name_ix_entry) + 2 * sizeof(u16_t)), 0xfffe);
+  u32_t buckets = 1;
+  while (buckets * 2 <= capacity) {
+    buckets *= 2;
+  }
+  // give what the bucket tables leave over to entries
+  capacity = MIN((mem_size - 2 * buckets * sizeof(u16_t)) / sizeof(spiffs_name_ix_entry), 0xfffe);
+
+  spiffs_name_ix *ix = (spiffs_name_ix *)((u8_t *)mem + skew);
+  ix->capacity = capacity;
+  ix->bucket_mask = buckets - 1;
+  spiffs_name_ix_clear(ix);
+  fs->name_ix = ix;
+  return SPIFFS_OK;
+}
+
+static spiffs_name_ix_entry *spiffs_name_ix_get(
+    spiffs_name_ix *ix,
+    spiffs_obj_id obj_id) {
+  spiffs_name_ix_entry *entries = spiffs_name_ix_entries(ix);
+  u16_t e = spiffs_name_ix_id_buckets(ix)[obj_id & ix->bucket_mask];
+  while (e != SPIFFS_NAME_IX_NONE && entries[e].obj_id != obj_id) {
+    e = entries[e].id_next;
+  }
+  return e == SPIFFS_NAME_IX_NONE ? 0 : &entries[e];
+}
+
+static void spiffs_name_ix_unlink_name(
+    spiffs_name_ix *ix,
+    u16_t e) {
+  spiffs_name_ix_entry *entries = spiffs_name_ix_entries(ix);
+  u16_t *link = &spiffs_name_ix_name_buckets(ix)[entries[e].name_hash & ix->bucket_mask];
+  while (*link != e) {
+    link = &entries[*link].name_next;
+  }
+  *link = entries[e].name_next;
+}
+
+static void spiffs_name_ix_link_name(
+    spiffs_name_ix *ix,
+    u16_t e,
+    u32_t name_hash) {
+  spiffs_name_ix_entry *entries = spiffs_name_ix_entries(ix);
+  u16_t *bucket = &spiffs_name_ix_name_buckets(ix)[name_hash & ix->bucket_mask];
+  entries[e].name_hash = name_hash;
+  entries[e].name_next = *bucket;
+  *bucket = e;
+}
+
+// adds or updates the entry of a file, if the index is full the index is
+// marked incomplete
+static void spiffs_name_ix_put(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    spiffs_page_ix pix,
+    const u8_t *name) {
+  spiffs_name_ix *ix = (spiffs_name_ix *)fs->name_ix;
+  spiffs_name_ix_entry *entries = spiffs_name_ix_entries(ix);
+  spiffs_name_ix_entry *entry = spiffs_name_ix_get(ix, obj_id);
+  u32_t name_hash = spiffs_hash(fs, name);
+  if (entry) {
+    u16_t e = entry - entries;
+    if (entry->name_hash != name_hash) {
+      spiffs_name_ix_unlink_name(ix, e);
+      spiffs_name_ix_link_name(ix, e, name_hash);
+    }
+    entry->pix = pix;
+    return;
+  }
+  if (ix->free_head == SPIFFS_NAME_IX_NONE) {
+    SPIFFS_DBG("name_ix: full, "_SPIPRIid" left out\n", obj_id);
+    ix->complete = 0;
+    return;
+  }
+  u16_t e = ix->free_head;
+  u16_t *id_bucket = &spiffs_name_ix_id_buckets(ix)[obj_id & ix->bucket_mask];
+  ix->free_head = entries[e].id_next;
+  entries[e].obj_id = obj_id;
+  entries[e].pix = pix;
+  entries[e].id_next = *id_bucket;
+  *id_bucket = e;
+  spiffs_name_ix_link_name(ix, e, name_hash);
+  ix->count++;
+}
+
+static void spiffs_name_ix_remove(
+    spiffs_name_ix *ix,
+    spiffs_name_ix_entry *entry) {
+  spiffs_name_ix_entry *entries = spiffs_name_ix_entries(ix);
+  u16_t e = entry - entries;
+  u16_t *link = &spiffs_name_ix_id_buckets(ix)[entry->obj_id & ix->bucket_mask];
+  while (*link != e) {
+    link = &entries[*link].id_next;
+  }
+  *link = entry->id_next;
+  spiffs_name_ix_unlink_name(ix, e);
+  entry->id_next = ix->free_head;
+  ix->free_head = e;
+  ix->count--;
+}
+
+static s32_t spiffs_name_ix_build_v(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    spiffs_block_ix bix,
+    int ix_entry,
+    const void *user_const_p,
+    void *user_var_p) {
+  (void)user_const_p;
+  (void)user_var_p;
+  s32_t res;
+  spiffs_page_object_ix_header objix_hdr;
+  spiffs_page_ix pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, ix_entry);
+  if (obj_id == SPIFFS_OBJ_ID_FREE || obj_id == SPIFFS_OBJ_ID_DELETED ||
+      (obj_id & SPIFFS_OBJ_ID_IX_FLAG) == 0) {
+    return SPIFFS_VIS_COUNTINUE;
+  }
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
+      0, SPIFFS_PAGE_TO_PADDR(fs, pix), sizeof(spiffs_page_object_ix_header), (u8_t *)&objix_hdr);
+  SPIFFS_CHECK_RES(res);
+  if (objix_hdr.p_hdr.span_ix == 0 &&
+      (objix_hdr.p_hdr.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_IXDELE)) ==
+          (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_IXDELE)) {
+    spiffs_name_ix_put(fs, obj_id & ~SPIFFS_OBJ_ID_IX_FLAG, pix, objix_hdr.name);
+  }
+  return SPIFFS_VIS_COUNTINUE;
+}
+
+// Fills the name index from the object lookup pages
+s32_t spiffs_name_ix_build(
+    spiffs *fs) {
+  s32_t res;
+  spiffs_name_ix_clear((spiffs_name_ix *)fs->name_ix);
+  res = spiffs_obj_lu_find_entry_visitor(fs,
+      0,
+      0,
+      0,
+      0,
+      spiffs_name_ix_build_v,
+      0,
+      0,
+      0,
+      0);
+  if (res == SPIFFS_VIS_END) {
+    res = SPIFFS_OK;
+  }
+  if (res != SPIFFS_OK) {
+    ((spiffs_name_ix *)fs->name_ix)->complete = 0;
+  }
+  return res;
+}
+
+// Finds object index header page by name in the name index. Returns
+// SPIFFS_NAME_IX_UNKNOWN if the name is not in the index but the index does
+// not hold all files.
+s32_t spiffs_name_ix_find(
+    spiffs *fs,
+    const u8_t name[SPIFFS_OBJ_NAME_LEN],
+    spiffs_page_ix *pix) {
+  s32_t res;
+  spiffs_name_ix *ix = (spiffs_name_ix *)fs->name_ix;
+  spiffs_name_ix_entry *entries = spiffs_name_ix_entries(ix);
+  spiffs_page_object_ix_header objix_hdr;
+  u32_t name_hash = spiffs_hash(fs, name);
+  u16_t e = spiffs_name_ix_name_buckets(ix)[name_hash & ix->bucket_mask];
+  while (e != SPIFFS_NAME_IX_NONE) {
+    spiffs_name_ix_entry *entry = &entries[e];
+    e = entry->name_next;
+    if (entry->name_hash != name_hash) continue;
+    // the hash may be shared, the name tells
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
+        0, SPIFFS_PAGE_TO_PADDR(fs, entry->pix), sizeof(spiffs_page_object_ix_header), (u8_t *)&objix_hdr);
+    SPIFFS_CHECK_RES(res);
+    if (objix_hdr.p_hdr.span_ix != 0 ||
+        (objix_hdr.p_hdr.obj_id & ~SPIFFS_OBJ_ID_IX_FLAG) != entry->obj_id ||
+        (objix_hdr.p_hdr.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_IXDELE)) !=
+            (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_IXDELE)) {
+      // should not happen, but if a change went by the index it can no
+      // longer tell what is missing
+      SPIFFS_DBG("name_ix: stale entry "_SPIPRIid" at "_SPIPRIpg"\n", entry->obj_id, entry->pix);
+      spiffs_name_ix_remove(ix, entry);
+      ix->complete = 0;
+      continue;
+    }
+    if (strcmp((const char *)name, (const char *)objix_hdr.name) == 0) {
+      if (pix) {
+        *pix = entry->pix;
+      }
+      return SPIFFS_OK;
+    }
+  }
+  return ix->complete ? SPIFFS_ERR_NOT_FOUND : SPIFFS_NAME_IX_UNKNOWN;
+}
+
+// Keeps the name index in step with object index header pages
+void spiffs_name_ix_event(
+    spiffs *fs,
+    spiffs_page_object_ix *objix,
+    int ev,
+    spiffs_obj_id obj_id,
+    spiffs_page_ix new_pix) {
+  spiffs_name_ix *ix = (spiffs_name_ix *)fs->name_ix;
+  spiffs_name_ix_entry *entry;
+  switch (ev) {
+  case SPIFFS_EV_IX_NEW:
+  case SPIFFS_EV_IX_UPD_HDR:
+    // both carry the whole header, with the name
+    spiffs_name_ix_put(fs, obj_id, new_pix, ((spiffs_page_object_ix_header *)objix)->name);
+    break;
+  case SPIFFS_EV_IX_UPD:
+  case SPIFFS_EV_IX_MOV:
+    entry = spiffs_name_ix_get(ix, obj_id);
+    if (entry) {
+      entry->pix = new_pix;
+    }
+    break;
+  case SPIFFS_EV_IX_DEL:
+    // gc also wipes leftover copies of a header, only the live one counts
+    entry = spiffs_name_ix_get(ix, obj_id);
+    if (entry && entry->pix == new_pix) {
+      spiffs_name_ix_remove(ix, entry);
+    }
+    break;
+  }
+}
+
+#endif // SPIFFS_NAME_INDEX
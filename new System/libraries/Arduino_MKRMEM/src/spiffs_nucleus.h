@@ -123,6 +123,9 @@
 // visitor result, stop searching
 #define SPIFFS_VIS_END                  (SPIFFS_ERR_INTERNAL - 22)
 
+// name index result, the name has to be searched for on the medium
+#define SPIFFS_NAME_IX_UNKNOWN          (SPIFFS_ERR_INTERNAL - 23)
+
 // updating an object index contents
 #define SPIFFS_EV_IX_UPD                (0)
 // creating a new object index
@@ -385,6 +388,9 @@
 #define SPIFFS_CACHE_FLAG_DATA        (1<<4)
 #define SPIFFS_CACHE_FLAG_TYPE_WR     (1<<7)
 
+// no cache page, ends the lru, hash and free lists
+#define SPIFFS_CACHE_NONE             (0xff)
+
 #define SPIFFS_CACHE_PAGE_SIZE(fs) \
   (sizeof(spiffs_cache_page) + SPIFFS_CFG_LOG_PAGE_SZ(fs))
 
@@ -403,8 +409,14 @@ typedef struct {
   u8_t flags;
   // cache page index
   u8_t ix;
-  // last access of this cache page
-  u32_t last_access;
+  // read cache pages: neighbours in the lru list, prev is more recent
+  // free cache pages: next free cache page in next
+  u8_t prev;
+  u8_t next;
+  // first read cache page of the hash bucket numbered by this page's ix
+  u8_t bucket;
+  // next read cache page in the same hash bucket
+  u8_t hash_next;
   union {
     // type read cache
     struct {
@@ -428,7 +440,13 @@ typedef struct {
 // cache struct
 typedef struct {
   u8_t cpage_count;
-  u32_t last_access;
+  // most and least recently used read cache page
+  u8_t lru_head;
+  u8_t lru_tail;
+  // first unused cache page
+  u8_t free_head;
+  // read cache pages hash by pix & hash_mask (number of buckets - 1)
+  u8_t hash_mask;
   u32_t cpage_use_map;
   u32_t cpage_use_mask;
   u8_t *cpages;
@@ -474,6 +492,29 @@ typedef struct {
 #endif
 } spiffs_fd;
 
+#if SPIFFS_NAME_INDEX
+
+// no name index entry, ends the bucket and free lists
+#define SPIFFS_NAME_IX_NONE           ((u16_t)-1)
+
+// name index header, at the start of the memory given to SPIFFS_name_index.
+// It is followed by the entries, the name hash buckets and the object id
+// buckets, each bucket holding the first entry of its list.
+typedef struct {
+  // number of entries
+  u16_t capacity;
+  // entries in use
+  u16_t count;
+  // first unused entry
+  u16_t free_head;
+  // number of buckets in each bucket table - 1
+  u16_t bucket_mask;
+  // all files are in the index, a name not in it is not on the medium
+  u8_t complete;
+} spiffs_name_ix;
+
+#endif
+
 
 // object structs
 
@@ -779,6 +820,28 @@ s32_t spiffs_fd_get(
     spiffs_file f,
     spiffs_fd **fd);
 
+#if SPIFFS_NAME_INDEX
+s32_t spiffs_name_ix_init(
+    spiffs *fs,
+    void *mem,
+    u32_t mem_size);
+
+s32_t spiffs_name_ix_build(
+    spiffs *fs);
+
+s32_t spiffs_name_ix_find(
+    spiffs *fs,
+    const u8_t name[SPIFFS_OBJ_NAME_LEN],
+    spiffs_page_ix *pix);
+
+void spiffs_name_ix_event(
+    spiffs *fs,
+    spiffs_page_object_ix *objix,
+    int ev,
+    spiffs_obj_id obj_id,
+    spiffs_page_ix new_pix);
+#endif
+
 #if SPIFFS_TEMPORAL_FD_CACHE
 void spiffs_fd_temporal_cache_rehash(
     spiffs *fs,
@@ -0,0 +1,517 @@
+/*
+ * SPIFFS cache on an emulated W25Q16DV: files written with small appends,
+ * overwrites and seeks read back intact after remounting, the read cache's
+ * lru list, hash and free list stay consistent, small appends reach flash
+ * as whole data pages, and SPIFFS_sync()/SPIFFS_fflush() are the points at
+ * which cached data is on flash. The benchmark counts page programs, sector
+ * erases and flash busy time for append heavy logging.
+ *
+ * Build & run (from the library root):
+ *   cc -O2 -Isrc -DSPIFFS_CACHE_STATS=1 -c src/spiffs_*.c
+ *   c++ -std=gnu++11 -O2 -I../../test -Isrc -Itest/host -DSPIFFS_CACHE_STATS=1 test/cache.cpp spiffs_*.o -o cache
+ *   ./cache          # tests
+ *   ./cache bench    # flash work for logging: write-through vs write-back cache
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "W25Q16DV.h"
+#include "host_test.h"
+
+extern "C" {
+#include "spiffs_nucleus.h"
+}
+
+static W25Q16DV *chip;
+
+static s32_t hal_read(u32_t addr, u32_t size, u8_t *dst) { return chip->read(addr, size, dst); }
+static s32_t hal_write(u32_t addr, u32_t size, u8_t *src) { return chip->program(addr, size, src); }
+static s32_t hal_erase(u32_t addr, u32_t size) { return chip->erase(addr, size); }
+
+/*
+ * A mounted file system with the same buffers Arduino_SPIFFS gives it:
+ * four cache pages and four file descriptors
+ */
+
+struct Volume
+{
+  spiffs fs;
+  spiffs_config cfg;
+  u8_t work[SPIFFS_CFG_LOG_PAGE_SZ(0) * 2];
+  u8_t fds[sizeof(spiffs_fd) * 4];
+  u32_t cache[(SPIFFS_CFG_LOG_PAGE_SZ(0) + 32) * 4 / sizeof(u32_t)];
+
+  s32_t mount()
+  {
+    memset(&fs, 0, sizeof(fs));
+    cfg.hal_read_f = hal_read;
+    cfg.hal_write_f = hal_write;
+    cfg.hal_erase_f = hal_erase;
+    return SPIFFS_mount(&fs, &cfg, work, fds, sizeof(fds), cache, sizeof(cache), 0);
+  }
+
+  void format()
+  {
+    if (mount() == SPIFFS_OK)
+      SPIFFS_unmount(&fs);
+    SPIFFS_format(&fs);
+    mount();
+  }
+};
+
+static W25Q16DV flash;
+static W25Q16DV shadow;
+static Volume volume;
+static spiffs *fs = &volume.fs;
+
+static void freshVolume()
+{
+  chip = &flash;
+  flash.reset();
+  volume.format();
+  flash.clearCounts();
+}
+
+static std::string readFile(const char *path)
+{
+  std::string data;
+  spiffs_file fh = SPIFFS_open(fs, path, SPIFFS_O_RDONLY, 0);
+  if (fh < 0)
+    return "(missing)";
+  char buf[97];
+  s32_t n;
+  while ((n = SPIFFS_read(fs, fh, buf, sizeof(buf))) > 0)
+    data.append(buf, n);
+  SPIFFS_close(fs, fh);
+  return data;
+}
+
+// What a board that lost power right now would find on flash
+static std::string readAfterPowerLoss(const char *path)
+{
+  static Volume other;
+
+  shadow = flash;
+  chip = &shadow;
+  other.mount();
+  spiffs *saved = fs;
+  fs = &other.fs;
+  std::string data = readFile(path);
+  SPIFFS_unmount(&other.fs);
+  fs = saved;
+  chip = &flash;
+  return data;
+}
+
+static std::string logLine(int i)
+{
+  char line[80];
+  int n = snprintf(line, sizeof(line), "%07d T=%d.%d H=%d%% soil=%d pump=%s\n",
+                   i * 250, 18 + i % 9, i % 10, 40 + i % 37, 300 + (i * 7) % 500, (i % 11) ? "off" : "on");
+  return std::string(line, n);
+}
+
+// Every used read cache page is in its hash bucket and the lru list once,
+// and every unused one is on the free list
+static bool cacheListsConsistent()
+{
+  spiffs_cache *cache = spiffs_get_cache(fs);
+  int readPages = 0, lruPages = 0, freePages = 0, hashed = 0;
+  u8_t prev = SPIFFS_CACHE_NONE;
+
+  for (int i = 0; i < cache->cpage_count; i++)
+  {
+    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, i);
+    if ((cache->cpage_use_map & (1u << i)) && !(cp->flags & SPIFFS_CACHE_FLAG_TYPE_WR))
+    {
+      readPages++;
+      int found = 0;
+      for (u8_t ix = spiffs_get_cache_page_hdr(fs, cache, cp->pix & cache->hash_mask)->bucket;
+           ix != SPIFFS_CACHE_NONE; ix = spiffs_get_cache_page_hdr(fs, cache, ix)->hash_next)
+      {
+        found += (ix == i);
+        hashed++;
+      }
+      if (found != 1)
+        return false;
+    }
+  }
+
+  for (u8_t ix = cache->lru_head; ix != SPIFFS_CACHE_NONE; ix = spiffs_get_cache_page_hdr(fs, cache, ix)->next)
+  {
+    spiffs_cache_page *cp = spiffs_get_cache_page_hdr(fs, cache, ix);
+    if (cp->prev != prev || !(cache->cpage_use_map & (1u << ix)) || (cp->flags & SPIFFS_CACHE_FLAG_TYPE_WR))
+      return false;
+    prev = ix;
+    lruPages++;
+  }
+
+  for (u8_t ix = cache->free_head; ix != SPIFFS_CACHE_NONE; ix = spiffs_get_cache_page_hdr(fs, cache, ix)->next)
+  {
+    if (cache->cpage_use_map & (1u << ix))
+      return false;
+    freePages++;
+  }
+
+  int used = 0;
+  for (int i = 0; i < cache->cpage_count; i++)
+    used += !!(cache->cpage_use_map & (1u << i));
+
+  return prev == cache->lru_tail && lruPages == readPages && hashed >= readPages &&
+         freePages == cache->cpage_count - used;
+}
+
+/*
+ * Tests
+ */
+
+static void testAppends()
+{
+  printf("small and large appends to two open files read back after remount\n");
+
+  freshVolume();
+
+  std::string expected[2];
+  spiffs_file fh[2] = {
+    SPIFFS_open(fs, "/system.log", SPIFFS_O_CREAT | SPIFFS_O_APPEND | SPIFFS_O_RDWR, 0),
+    SPIFFS_open(fs, "/sensor.csv", SPIFFS_O_CREAT | SPIFFS_O_APPEND | SPIFFS_O_RDWR, 0),
+  };
+  CHECK(fh[0] >= 0 && fh[1] >= 0);
+
+  srand(1);
+  for (int i = 0; i < 1500; i++)
+  {
+    int f = rand() % 2;
+    std::string chunk = (i % 97 == 0) ? std::string(300 + rand() % 400, 'A' + i % 26) : logLine(i).substr(0, 1 + rand() % 60);
+    CHECK(SPIFFS_write(fs, fh[f], &chunk[0], chunk.size()) == (s32_t) chunk.size());
+    expected[f] += chunk;
+    if (i % 200 == 0)
+      CHECK(SPIFFS_fflush(fs, fh[f]) == SPIFFS_OK);
+    if (i % 333 == 0)
+      CHECK(SPIFFS_sync(fs) == SPIFFS_OK);
+  }
+
+  SPIFFS_close(fs, fh[0]);
+  SPIFFS_close(fs, fh[1]);
+  SPIFFS_unmount(fs);
+  CHECK(volume.mount() == SPIFFS_OK);
+
+  CHECK(readFile("/system.log") == expected[0]);
+  CHECK(readFile("/sensor.csv") == expected[1]);
+  CHECK(SPIFFS_check(fs) == SPIFFS_OK);
+}
+
+static void testOverwrites()
+{
+  printf("overwrites, seeks and appends in one file match a model\n");
+
+  freshVolume();
+
+  std::string expected;
+  spiffs_file fh = SPIFFS_open(fs, "/settings.json", SPIFFS_O_CREAT | SPIFFS_O_RDWR, 0);
+  CHECK(fh >= 0);
+
+  srand(2);
+  for (int i = 0; i < 800; i++)
+  {
+    int size = expected.size();
+    int offset = (size && rand() % 3) ? rand() % size : size;
+    std::string chunk(1 + rand() % (i % 50 ? 80 : 600), 'a' + rand() % 26);
+    CHECK(SPIFFS_lseek(fs, fh, offset, SPIFFS_SEEK_SET) == offset);
+    CHECK(SPIFFS_write(fs, fh, &chunk[0], chunk.size()) == (s32_t) chunk.size());
+    expected.replace(offset, std::min(chunk.size(), expected.size() - offset), chunk);
+    if (i % 64 == 0)
+    {
+      std::string back(expected.size(), 0);
+      CHECK(SPIFFS_lseek(fs, fh, 0, SPIFFS_SEEK_SET) == 0);
+      CHECK(SPIFFS_read(fs, fh, &back[0], back.size()) == (s32_t) back.size());
+      CHECK(back == expected);
+    }
+  }
+
+  SPIFFS_close(fs, fh);
+  CHECK(readFile("/settings.json") == expected);
+  CHECK(SPIFFS_check(fs) == SPIFFS_OK);
+}
+
+static void testCacheLists()
+{
+  printf("read cache lru, hash and free list stay consistent\n");
+
+  freshVolume();
+  CHECK(cacheListsConsistent());
+
+  char name[32];
+  for (int i = 0; i < 24; i++)
+  {
+    snprintf(name, sizeof(name), "/cfg%02d.json", i);
+    spiffs_file fh = SPIFFS_open(fs, name, SPIFFS_O_CREAT | SPIFFS_O_RDWR, 0);
+    std::string body = logLine(i) + logLine(i + 1);
+    SPIFFS_write(fs, fh, &body[0], body.size());
+    SPIFFS_close(fs, fh);
+    CHECK(cacheListsConsistent());
+  }
+
+  spiffs_file log = SPIFFS_open(fs, "/system.log", SPIFFS_O_CREAT | SPIFFS_O_APPEND | SPIFFS_O_RDWR, 0);
+  bool removed[24] = {};
+  srand(3);
+  for (int i = 0; i < 400; i++)
+  {
+    int n = rand() % 24;
+    snprintf(name, sizeof(name), "/cfg%02d.json", n);
+    spiffs_stat s;
+    CHECK((SPIFFS_stat(fs, name, &s) == SPIFFS_OK) == !removed[n]);
+    if (i % 3 == 0 && !removed[n])
+      CHECK(readFile(name).size() == s.size);
+    if (i % 5 == 0)
+    {
+      std::string line = logLine(i);
+      SPIFFS_write(fs, log, &line[0], line.size());
+    }
+    if (i % 50 == 0 && !removed[n])
+      removed[n] = SPIFFS_remove(fs, name) == SPIFFS_OK;
+    if (!cacheListsConsistent())
+    {
+      CHECK(cacheListsConsistent());
+      break;
+    }
+  }
+  SPIFFS_close(fs, log);
+  CHECK(cacheListsConsistent());
+  CHECK(fs->cache_hits > 0);
+}
+
+static void testWholePages()
+{
+  printf("small appends are programmed as whole data pages\n");
+
+  freshVolume();
+
+  std::string line = logLine(7);
+  const int lines = (SPIFFS_DATA_PAGE_SIZE(fs) * 20) / line.size();
+  unsigned long programs[2];
+
+  for (int cached = 0; cached < 2; cached++)
+  {
+    spiffs_file fh = SPIFFS_open(fs, cached ? "/cached.log" : "/direct.log",
+                                 SPIFFS_O_CREAT | SPIFFS_O_APPEND | SPIFFS_O_RDWR | (cached ? 0 : SPIFFS_O_DIRECT), 0);
+    flash.clearCounts();
+    for (int i = 0; i < lines; i++)
+      SPIFFS_write(fs, fh, &line[0], line.size());
+    programs[cached] = flash.programs;
+    SPIFFS_close(fs, fh);
+  }
+
+  // A full data page costs the page itself, a new index header (the file
+  // size changed) and the lookup and flag updates for both: 8 programs
+  unsigned long pages = (lines * line.size()) / SPIFFS_DATA_PAGE_SIZE(fs);
+  CHECK(programs[1] <= pages * 8);
+  CHECK(programs[1] * 5 < programs[0]);
+  printf("  %d lines: %lu page programs write-through, %lu cached (%lu data pages)\n",
+         lines, programs[0], programs[1], pages);
+}
+
+static void testFlushPoints()
+{
+  printf("cached appends reach flash when the cache page fills, at fflush, sync and close\n");
+
+  freshVolume();
+
+  spiffs_file a = SPIFFS_open(fs, "/a.log", SPIFFS_O_CREAT | SPIFFS_O_APPEND | SPIFFS_O_RDWR, 0);
+  spiffs_file b = SPIFFS_open(fs, "/b.log", SPIFFS_O_CREAT | SPIFFS_O_APPEND | SPIFFS_O_RDWR, 0);
+  std::string data;
+
+  // Held in cache until the cache page is full, then programmed up to the
+  // end of the first data page
+  data = std::string(SPIFFS_DATA_PAGE_SIZE(fs) + 20, 'x');
+  SPIFFS_write(fs, a, &data[0], 100);
+  SPIFFS_write(fs, a, &data[100], SPIFFS_CFG_LOG_PAGE_SZ(fs) - 100);
+  CHECK(readAfterPowerLoss("/a.log") == "");
+  SPIFFS_write(fs, a, &data[SPIFFS_CFG_LOG_PAGE_SZ(fs)], data.size() - SPIFFS_CFG_LOG_PAGE_SZ(fs));
+  CHECK(readAfterPowerLoss("/a.log") == data.substr(0, SPIFFS_DATA_PAGE_SIZE(fs)));
+
+  SPIFFS_write(fs, a, (void *) "one\n", 4);
+  CHECK(readAfterPowerLoss("/a.log") == data.substr(0, SPIFFS_DATA_PAGE_SIZE(fs)));
+  CHECK(SPIFFS_fflush(fs, a) == SPIFFS_OK);
+  data += "one\n";
+  CHECK(readAfterPowerLoss("/a.log") == data);
+
+  SPIFFS_write(fs, a, (void *) "two\n", 4);
+  SPIFFS_write(fs, b, (void *) "three\n", 6);
+  CHECK(SPIFFS_sync(fs) == SPIFFS_OK);
+  CHECK(readAfterPowerLoss("/a.log") == data + "two\n");
+  CHECK(readAfterPowerLoss("/b.log") == "three\n");
+
+  SPIFFS_write(fs, b, (void *) "four\n", 5);
+  SPIFFS_close(fs, b);
+  CHECK(readAfterPowerLoss("/b.log") == "three\nfour\n");
+
+  SPIFFS_close(fs, a);
+}
+
+/*
+ * Benchmark
+ */
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, unsigned long lines, double cpu)
+{
+  printf("  %-40s %6lu programs %6.2f/line %4lu erases  max %3u per sector  %7.0f ms flash  %5.1f us cpu/line\n",
+         name, flash.programs, (double) flash.programs / lines, flash.erases, flash.maxSectorErases(),
+         flash.busyMs(), cpu / lines * 1e6);
+}
+
+// Appends log lines to a file kept open, syncing every `every` lines
+static void benchOpenLog(const char *name, spiffs_flags flags, int lines, int every)
+{
+  freshVolume();
+
+  spiffs_file fh = SPIFFS_open(fs, "/system.log", SPIFFS_O_CREAT | SPIFFS_O_APPEND | SPIFFS_O_RDWR | flags, 0);
+  double start = now();
+  for (int i = 0; i < lines; i++)
+  {
+    std::string line = logLine(i);
+    SPIFFS_write(fs, fh, &line[0], line.size());
+    if (every && (i + 1) % every == 0)
+      SPIFFS_fflush(fs, fh);
+  }
+  SPIFFS_close(fs, fh);
+  report(name, lines, now() - start);
+}
+
+// The sketches' pattern: open, append one line, close
+static void benchReopenLog(const char *name, int lines)
+{
+  freshVolume();
+
+  double start = now();
+  for (int i = 0; i < lines; i++)
+  {
+    std::string line = logLine(i);
+    spiffs_file fh = SPIFFS_open(fs, "/system.log", SPIFFS_O_CREAT | SPIFFS_O_APPEND | SPIFFS_O_WRONLY, 0);
+    SPIFFS_write(fs, fh, &line[0], line.size());
+    SPIFFS_close(fs, fh);
+  }
+  report(name, lines, now() - start);
+}
+
+// A 32 KB log rotated on a chip half full of other files, so garbage
+// collection erases. Write-through appends leave a deleted index page behind
+// per line and can outrun the collector; those writes fail with
+// SPIFFS_ERR_FULL and are counted.
+static void benchRotatingLog(const char *name, spiffs_flags flags, int lines, int every)
+{
+  freshVolume();
+
+  u32_t total, used;
+  spiffs_file fill = SPIFFS_open(fs, "/archive.bin", SPIFFS_O_CREAT | SPIFFS_O_WRONLY, 0);
+  std::vector<char> block(4096, 'z');
+  do
+  {
+    SPIFFS_write(fs, fill, &block[0], block.size());
+    SPIFFS_info(fs, &total, &used);
+  } while (used + 1024 * 1024 < total);
+  SPIFFS_close(fs, fill);
+  flash.clearCounts();
+
+  double start = now();
+  spiffs_file fh = -1;
+  u32_t size = 0;
+  int full = 0;
+  for (int i = 0; i < lines; i++)
+  {
+    if (fh < 0 || size > 32 * 1024)
+    {
+      if (fh >= 0)
+      {
+        SPIFFS_close(fs, fh);
+        SPIFFS_remove(fs, "/system.old");
+        SPIFFS_rename(fs, "/system.log", "/system.old");
+      }
+      fh = SPIFFS_open(fs, "/system.log", SPIFFS_O_CREAT | SPIFFS_O_APPEND | SPIFFS_O_RDWR | flags, 0);
+      size = 0;
+    }
+    std::string line = logLine(i);
+    if (SPIFFS_write(fs, fh, &line[0], line.size()) < 0)
+      full++;
+    size += line.size();
+    if (every && (i + 1) % every == 0)
+      SPIFFS_fflush(fs, fh);
+  }
+  SPIFFS_close(fs, fh);
+  report(name, lines, now() - start);
+  if (full)
+    printf("  %-40s %6d writes failed, file system full\n", "", full);
+  CHECK(SPIFFS_check(fs) == SPIFFS_OK);
+}
+
+// Config files read over and over, as the read cache sees them
+static void benchReads(int rounds)
+{
+  freshVolume();
+
+  char name[32];
+  for (int i = 0; i < 12; i++)
+  {
+    snprintf(name, sizeof(name), "/cfg%02d.json", i);
+    spiffs_file fh = SPIFFS_open(fs, name, SPIFFS_O_CREAT | SPIFFS_O_RDWR, 0);
+    std::string body = logLine(i) + logLine(i + 1) + logLine(i + 2);
+    SPIFFS_write(fs, fh, &body[0], body.size());
+    SPIFFS_close(fs, fh);
+  }
+  flash.clearCounts();
+  fs->cache_hits = fs->cache_misses = 0;
+
+  double start = now();
+  for (int i = 0; i < rounds; i++)
+  {
+    snprintf(name, sizeof(name), "/cfg%02d.json", (i * 7) % 12);
+    readFile(name);
+  }
+  double cpu = now() - start;
+  printf("  %-40s %6lu flash reads  %5.1f%% cache hits  %5.1f us cpu/file\n",
+         "read 12 config files round robin", flash.reads,
+         100.0 * fs->cache_hits / (fs->cache_hits + fs->cache_misses), cpu / rounds * 1e6);
+}
+
+static void benchmark()
+{
+  printf("logging %d-byte lines to an emulated W25Q16DV (%u us per page program, %u ms per sector erase)\n",
+         (int) logLine(0).size(), W25Q16DV::PAGE_PROGRAM_US, W25Q16DV::SECTOR_ERASE_US / 1000);
+
+  benchOpenLog("open log, write-through (O_DIRECT)", SPIFFS_O_DIRECT, 4000, 0);
+  benchOpenLog("open log, cached", 0, 4000, 0);
+  benchOpenLog("open log, cached, fflush every 10", 0, 4000, 10);
+  benchReopenLog("open/append/close per line", 1000);
+  benchRotatingLog("rotating log, half full, O_DIRECT", SPIFFS_O_DIRECT, 20000, 0);
+  benchRotatingLog("rotating log, half full, cached", 0, 20000, 0);
+  benchRotatingLog("rotating log, half full, fflush every 10", 0, 20000, 10);
+  benchReads(20000);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && strcmp(argv[1], "bench") == 0)
+  {
+    benchmark();
+    return 0;
+  }
+
+  testAppends();
+  testOverwrites();
+  testCacheLists();
+  testWholePages();
+  testFlushPoints();
+
+  return test_summary();
+}
@@ -0,0 +1,109 @@
+// Host stand-in for the W25Q16DV flash chip SPIFFS runs on: 2 MB of RAM
+// that behaves like NOR flash (programming only clears bits, erasing sets a
+// whole 4 KB sector back to 0xFF) and counts what the chip would be asked
+// to do. Flash busy time uses the datasheet's typical figures.
+
+#ifndef W25Q16DV_H
+#define W25Q16DV_H
+
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+#include "spiffs.h"
+}
+
+struct W25Q16DV
+{
+  static const uint32_t SIZE        = 2 * 1024 * 1024;
+  static const uint32_t PAGE_SIZE   = 256;
+  static const uint32_t SECTOR_SIZE = 4096;
+  static const uint32_t SECTORS     = SIZE / SECTOR_SIZE;
+
+  // typical page program and sector erase times, in microseconds
+  static const uint32_t PAGE_PROGRAM_US = 700;
+  static const uint32_t SECTOR_ERASE_US = 30000;
+  // SPI clock the MKR boards' SAMD21 runs the chip at
+  static const uint32_t SPI_HZ = 12000000;
+  // read command and address bytes sent before the data
+  static const uint32_t READ_CMD_BYTES = 4;
+
+  uint8_t mem[SIZE];
+  uint32_t sectorErases[SECTORS];
+
+  unsigned long reads;
+  unsigned long readBytes;
+  unsigned long programs;       // page program commands
+  unsigned long programBytes;
+  unsigned long erases;         // sector erase commands
+
+  void reset()
+  {
+    memset(mem, 0xff, sizeof(mem));
+    clearCounts();
+  }
+
+  void clearCounts()
+  {
+    reads = readBytes = programs = programBytes = erases = 0;
+    memset(sectorErases, 0, sizeof(sectorErases));
+  }
+
+  uint32_t maxSectorErases() const
+  {
+    uint32_t max = 0;
+    for (uint32_t i = 0; i < SECTORS; i++)
+      if (sectorErases[i] > max)
+        max = sectorErases[i];
+    return max;
+  }
+
+  double busyMs() const
+  {
+    return (programs * (double) PAGE_PROGRAM_US + erases * (double) SECTOR_ERASE_US) / 1000;
+  }
+
+  // time spent clocking read commands and data over SPI
+  double readMs() const
+  {
+    return (reads * (double) READ_CMD_BYTES + readBytes) * 8 * 1000 / SPI_HZ;
+  }
+
+  s32_t read(u32_t addr, u32_t size, u8_t *dst)
+  {
+    if (addr + size > SIZE)
+      return SPIFFS_ERR_INTERNAL;
+    reads++;
+    readBytes += size;
+    memcpy(dst, &mem[addr], size);
+    return SPIFFS_OK;
+  }
+
+  s32_t program(u32_t addr, u32_t size, const u8_t *src)
+  {
+    if (addr + size > SIZE)
+      return SPIFFS_ERR_INTERNAL;
+    // one page program command cannot cross a page
+    programs += (addr + size - 1) / PAGE_SIZE - addr / PAGE_SIZE + 1;
+    programBytes += size;
+    // SPIFFS leaves the bits it does not want cleared at 1 and relies on this
+    for (u32_t i = 0; i < size; i++)
+      mem[addr + i] &= src[i];
+    return SPIFFS_OK;
+  }
+
+  s32_t erase(u32_t addr, u32_t size)
+  {
+    if (addr % SECTOR_SIZE || size % SECTOR_SIZE || addr + size > SIZE)
+      return SPIFFS_ERR_INTERNAL;
+    for (u32_t s = addr / SECTOR_SIZE; s < (addr + size) / SECTOR_SIZE; s++)
+    {
+      erases++;
+      sectorErases[s]++;
+    }
+    memset(&mem[addr], 0xff, size);
+    return SPIFFS_OK;
+  }
+};
+
+#endif
@@ -0,0 +1,423 @@
+/*
+ * SPIFFS name index on an emulated W25Q16DV: SPIFFS_open, SPIFFS_stat,
+ * SPIFFS_remove and SPIFFS_rename give the same results with and without
+ * the index, the index follows creates, renames, removes, garbage
+ * collection and SPIFFS_check, and files beyond its memory budget are still
+ * found on flash. The benchmark counts flash reads and SPI time per lookup
+ * with 10, 100 and 1000 files.
+ *
+ * Build & run (from the library root):
+ *   cc -O2 -Isrc -c src/spiffs_*.c
+ *   c++ -std=gnu++11 -O2 -I../../test -Isrc -Itest/host test/name_index.cpp spiffs_*.o -o name_index
+ *   ./name_index          # tests
+ *   ./name_index bench    # lookups: flash search vs name index
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "W25Q16DV.h"
+#include "host_test.h"
+
+extern "C" {
+#include "spiffs_nucleus.h"
+}
+
+static W25Q16DV *chip;
+
+static s32_t hal_read(u32_t addr, u32_t size, u8_t *dst) { return chip->read(addr, size, dst); }
+static s32_t hal_write(u32_t addr, u32_t size, u8_t *src) { return chip->program(addr, size, src); }
+static s32_t hal_erase(u32_t addr, u32_t size) { return chip->erase(addr, size); }
+
+/*
+ * A mounted file system with the same buffers Arduino_SPIFFS gives it:
+ * four cache pages and four file descriptors, and a name index for up to
+ * `files` files (none for 0)
+ */
+
+struct Volume
+{
+  spiffs fs;
+  spiffs_config cfg;
+  u8_t work[SPIFFS_CFG_LOG_PAGE_SZ(0) * 2];
+  u8_t fds[sizeof(spiffs_fd) * 4];
+  u32_t cache[(SPIFFS_CFG_LOG_PAGE_SZ(0) + 32) * 4 / sizeof(u32_t)];
+  std::vector<u32_t> names;
+
+  s32_t mount(u32_t files)
+  {
+    memset(&fs, 0, sizeof(fs));
+    cfg.hal_read_f = hal_read;
+    cfg.hal_write_f = hal_write;
+    cfg.hal_erase_f = hal_erase;
+    s32_t res = SPIFFS_mount(&fs, &cfg, work, fds, sizeof(fds), cache, sizeof(cache), 0);
+    if (res != SPIFFS_OK || files == 0)
+      return res;
+    names.assign(SPIFFS_NAME_INDEX_MEM_SZ(files) / sizeof(u32_t), 0);
+    return SPIFFS_name_index(&fs, &names[0], names.size() * sizeof(u32_t));
+  }
+
+  void format(u32_t files)
+  {
+    if (mount(0) == SPIFFS_OK)
+      SPIFFS_unmount(&fs);
+    SPIFFS_format(&fs);
+    mount(files);
+  }
+};
+
+static W25Q16DV flash;
+static Volume volume;
+static spiffs *fs = &volume.fs;
+
+static void freshVolume(u32_t files)
+{
+  chip = &flash;
+  flash.reset();
+  volume.format(files);
+  flash.clearCounts();
+}
+
+static std::string fileName(int i)
+{
+  char name[SPIFFS_OBJ_NAME_LEN];
+  snprintf(name, sizeof(name), "/data/%04d.csv", i);
+  return name;
+}
+
+static void createFile(const std::string &name, int size)
+{
+  spiffs_file fh = SPIFFS_open(fs, name.c_str(), SPIFFS_O_CREAT | SPIFFS_O_TRUNC | SPIFFS_O_WRONLY, 0);
+  CHECK(fh >= 0);
+  std::string data(size, 'a' + size % 26);
+  CHECK(SPIFFS_write(fs, fh, &data[0], size) == size);
+  CHECK(SPIFFS_close(fs, fh) == SPIFFS_OK);
+}
+
+// Size of the file or the error SPIFFS_stat gave
+static s32_t statSize(const std::string &name)
+{
+  spiffs_stat s;
+  s32_t res = SPIFFS_stat(fs, name.c_str(), &s);
+  return res == SPIFFS_OK ? (s32_t) s.size : res;
+}
+
+static spiffs_name_ix *nameIndex()
+{
+  return (spiffs_name_ix *) fs->name_ix;
+}
+
+static spiffs_name_ix_entry *indexEntries()
+{
+  return (spiffs_name_ix_entry *) ((u8_t *) fs->name_ix + 16);
+}
+
+// Every file on flash is in the index at its header page, unless the index
+// says it is incomplete, and nothing else is
+static bool indexConsistent()
+{
+  spiffs_name_ix *ix = nameIndex();
+  spiffs_name_ix_entry *entries = indexEntries();
+  u16_t *nameBuckets = (u16_t *) (entries + ix->capacity);
+  u16_t *idBuckets = nameBuckets + ix->bucket_mask + 1;
+  int files = 0, inIndex = 0, chained = 0;
+
+  spiffs_DIR d;
+  struct spiffs_dirent de;
+  SPIFFS_opendir(fs, "/", &d);
+  while (SPIFFS_readdir(&d, &de))
+  {
+    files++;
+    u16_t e = idBuckets[de.obj_id & ix->bucket_mask];
+    while (e != SPIFFS_NAME_IX_NONE && entries[e].obj_id != de.obj_id)
+      e = entries[e].id_next;
+    if (e == SPIFFS_NAME_IX_NONE)
+      continue;
+    if (entries[e].pix != de.pix)
+      return false;
+    u32_t hash = entries[e].name_hash;
+    u16_t n = nameBuckets[hash & ix->bucket_mask];
+    while (n != SPIFFS_NAME_IX_NONE && n != e)
+      n = entries[n].name_next;
+    if (n != e)
+      return false;
+    inIndex++;
+  }
+  SPIFFS_closedir(&d);
+
+  for (u32_t b = 0; b <= ix->bucket_mask; b++)
+    for (u16_t e = nameBuckets[b]; e != SPIFFS_NAME_IX_NONE; e = entries[e].name_next)
+      chained++;
+
+  return inIndex == ix->count && chained == ix->count && (!ix->complete || inIndex == files);
+}
+
+/*
+ * Tests
+ */
+
+static void testLookups()
+{
+  printf("open, stat, rename and remove find the same files with the index as without\n");
+
+  freshVolume(64);
+  CHECK(nameIndex() && nameIndex()->complete);
+
+  for (int i = 0; i < 40; i++)
+    createFile(fileName(i), 10 + i);
+  CHECK(nameIndex()->count == 40);
+
+  for (int i = 0; i < 40; i += 3)
+    CHECK(SPIFFS_rename(fs, fileName(i).c_str(), fileName(100 + i).c_str()) == SPIFFS_OK);
+  for (int i = 1; i < 40; i += 5)
+    if (i % 3)
+      CHECK(SPIFFS_remove(fs, fileName(i).c_str()) == SPIFFS_OK);
+  // a rename onto an existing name is refused
+  CHECK(SPIFFS_rename(fs, fileName(2).c_str(), fileName(4).c_str()) == SPIFFS_ERR_CONFLICTING_NAME);
+  CHECK(indexConsistent());
+
+  std::vector<s32_t> withIndex;
+  for (int i = 0; i < 140; i++)
+    withIndex.push_back(statSize(fileName(i)));
+
+  // a name not on flash costs no flash reads at all
+  flash.clearCounts();
+  CHECK(statSize("/data/missing.csv") == SPIFFS_ERR_NOT_FOUND);
+  CHECK(SPIFFS_open(fs, "/data/missing.csv", SPIFFS_O_RDONLY, 0) == SPIFFS_ERR_NOT_FOUND);
+  CHECK(flash.reads == 0);
+
+  SPIFFS_unmount(fs);
+  CHECK(volume.mount(0) == SPIFFS_OK);
+  CHECK(fs->name_ix == 0);
+  for (int i = 0; i < 140; i++)
+    CHECK(statSize(fileName(i)) == withIndex[i]);
+  CHECK(withIndex[0] == SPIFFS_ERR_NOT_FOUND && withIndex[100] == 10);
+  CHECK(withIndex[1] == SPIFFS_ERR_NOT_FOUND && withIndex[2] == 12);
+
+  // rebuilt from flash on the next mount
+  SPIFFS_unmount(fs);
+  CHECK(volume.mount(64) == SPIFFS_OK);
+  CHECK(nameIndex()->complete && indexConsistent());
+  for (int i = 0; i < 140; i++)
+    CHECK(statSize(fileName(i)) == withIndex[i]);
+}
+
+static void testOpenFiles()
+{
+  printf("files written through open descriptors stay findable as their headers move\n");
+
+  freshVolume(16);
+
+  spiffs_file fh = SPIFFS_open(fs, "/log.txt", SPIFFS_O_CREAT | SPIFFS_O_APPEND | SPIFFS_O_RDWR, 0);
+  CHECK(fh >= 0);
+  for (int i = 0; i < 300; i++)
+  {
+    char line[40];
+    int n = snprintf(line, sizeof(line), "%05d sample\n", i);
+    CHECK(SPIFFS_write(fs, fh, line, n) == n);
+    if (i % 50 == 0)
+    {
+      CHECK(SPIFFS_fflush(fs, fh) == SPIFFS_OK);
+      CHECK(statSize("/log.txt") == (i + 1) * 13);
+    }
+  }
+  CHECK(SPIFFS_close(fs, fh) == SPIFFS_OK);
+  CHECK(statSize("/log.txt") == 300 * 13);
+
+  fh = SPIFFS_open(fs, "/log.txt", SPIFFS_O_RDWR, 0);
+  CHECK(SPIFFS_fremove(fs, fh) == SPIFFS_OK);
+  CHECK(statSize("/log.txt") == SPIFFS_ERR_NOT_FOUND);
+  CHECK(nameIndex()->count == 0 && nameIndex()->complete);
+  CHECK(indexConsistent());
+}
+
+static void testOverBudget()
+{
+  printf("files beyond the index budget are searched for on flash\n");
+
+  freshVolume(8);
+  u16_t capacity = nameIndex()->capacity;
+  CHECK(capacity >= 8);
+
+  for (int i = 0; i < 30; i++)
+    createFile(fileName(i), 20);
+  CHECK(nameIndex()->count == capacity && !nameIndex()->complete);
+  CHECK(indexConsistent());
+
+  for (int i = 0; i < 30; i++)
+    CHECK(statSize(fileName(i)) == 20);
+  CHECK(statSize("/data/missing.csv") == SPIFFS_ERR_NOT_FOUND);
+
+  for (int i = 0; i < 30 - capacity; i++)
+    CHECK(SPIFFS_remove(fs, fileName(i).c_str()) == SPIFFS_OK);
+  CHECK(!nameIndex()->complete && indexConsistent());
+  for (int i = 0; i < 30; i++)
+    CHECK(statSize(fileName(i)) == (i < 30 - capacity ? SPIFFS_ERR_NOT_FOUND : 20));
+
+  // the next scan of the medium finds that everything fits again
+  CHECK(SPIFFS_name_index(fs, &volume.names[0], volume.names.size() * sizeof(u32_t)) == SPIFFS_OK);
+  CHECK(nameIndex()->count == capacity && nameIndex()->complete && indexConsistent());
+}
+
+static void testGarbageCollection()
+{
+  printf("the index follows headers moved by garbage collection and SPIFFS_check\n");
+
+  freshVolume(64);
+
+  u32_t total, used;
+  SPIFFS_info(fs, &total, &used);
+  // a file that garbage collection has to move around
+  std::string big(total / 8, 'x');
+  spiffs_file fh = SPIFFS_open(fs, "/big.bin", SPIFFS_O_CREAT | SPIFFS_O_WRONLY, 0);
+  CHECK(SPIFFS_write(fs, fh, &big[0], big.size()) == (s32_t) big.size());
+  SPIFFS_close(fs, fh);
+
+  srand(3);
+  std::vector<s32_t> sizes(50, SPIFFS_ERR_NOT_FOUND);
+  for (int round = 0; round < 3000; round++)
+  {
+    int i = rand() % 50;
+    if (sizes[i] >= 0 && rand() % 4 == 0)
+    {
+      CHECK(SPIFFS_remove(fs, fileName(i).c_str()) == SPIFFS_OK);
+      sizes[i] = SPIFFS_ERR_NOT_FOUND;
+    }
+    else
+    {
+      sizes[i] = 100 + rand() % 1500;
+      createFile(fileName(i), sizes[i]);
+    }
+  }
+  CHECK(flash.erases > 100);
+  CHECK(nameIndex()->complete && indexConsistent());
+  for (int i = 0; i < 50; i++)
+    CHECK(statSize(fileName(i)) == sizes[i]);
+  CHECK(statSize("/big.bin") == (s32_t) big.size());
+
+  CHECK(SPIFFS_check(fs) == SPIFFS_OK);
+  CHECK(nameIndex()->complete && indexConsistent());
+  for (int i = 0; i < 50; i++)
+    CHECK(statSize(fileName(i)) == sizes[i]);
+}
+
+static void testMemory()
+{
+  printf("SPIFFS_name_index takes any buffer big enough for one file, or none\n");
+
+  freshVolume(0);
+  createFile("/a", 1);
+
+  u8_t mem[SPIFFS_NAME_INDEX_MEM_SZ(4) + 3];
+  CHECK(SPIFFS_name_index(fs, mem, SPIFFS_NAME_INDEX_MEM_SZ(1) - 1) == SPIFFS_ERR_NAME_INDEX_MEM);
+  CHECK(fs->name_ix == 0);
+  // unaligned memory is aligned within the budget
+  CHECK(SPIFFS_name_index(fs, mem + 1, sizeof(mem) - 1) == SPIFFS_OK);
+  CHECK(nameIndex()->capacity >= 4 && ((uintptr_t) fs->name_ix & 3) == 0);
+  CHECK((u8_t *) ((u16_t *) (indexEntries() + nameIndex()->capacity) + 2 * (nameIndex()->bucket_mask + 1)) <=
+        mem + sizeof(mem));
+  CHECK(nameIndex()->count == 1 && statSize("/a") == 1);
+  CHECK(SPIFFS_name_index(fs, 0, 0) == SPIFFS_OK);
+  CHECK(fs->name_ix == 0 && statSize("/a") == 1);
+}
+
+/*
+ * Benchmark
+ */
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, unsigned long ops, double cpu)
+{
+  printf("    %-28s %8.1f reads %8.0f bytes  %7.2f ms SPI  %7.1f us cpu  per lookup\n",
+         name, (double) flash.reads / ops, (double) flash.readBytes / ops, flash.readMs() / ops, cpu / ops * 1e6);
+}
+
+// Opens and closes, stats, and stats names that do not exist, in random order
+static void benchLookups(int files, u32_t indexFiles, int ops)
+{
+  SPIFFS_unmount(fs);
+  flash.clearCounts();
+  double start = now();
+  volume.mount(indexFiles);
+  double cpu = now() - start;
+  if (indexFiles)
+    printf("  index for %u files (%u bytes): built with %lu reads, %.1f ms SPI, %.0f us cpu\n",
+           indexFiles, (unsigned) SPIFFS_NAME_INDEX_MEM_SZ(indexFiles), flash.reads, flash.readMs(), cpu * 1e6);
+  else
+    printf("  no index\n");
+
+  std::vector<std::string> names, missing;
+  srand(7);
+  for (int i = 0; i < ops; i++)
+  {
+    names.push_back(fileName(rand() % files));
+    missing.push_back(fileName(files + rand() % 1000));
+  }
+
+  flash.clearCounts();
+  start = now();
+  for (int i = 0; i < ops; i++)
+  {
+    spiffs_file fh = SPIFFS_open(fs, names[i].c_str(), SPIFFS_O_RDONLY, 0);
+    SPIFFS_close(fs, fh);
+  }
+  report("open+close", ops, now() - start);
+
+  flash.clearCounts();
+  start = now();
+  for (int i = 0; i < ops; i++)
+    statSize(names[i]);
+  report("stat", ops, now() - start);
+
+  flash.clearCounts();
+  start = now();
+  for (int i = 0; i < ops; i++)
+    statSize(missing[i]);
+  report("stat, no such file", ops, now() - start);
+}
+
+static void benchmark()
+{
+  printf("file lookups on a W25Q16DV (SPI at %u MHz):\n", W25Q16DV::SPI_HZ / 1000000);
+
+  static const int counts[] = { 10, 100, 1000 };
+  for (unsigned c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+  {
+    int files = counts[c];
+    freshVolume(0);
+    for (int i = 0; i < files; i++)
+      createFile(fileName(i), 64);
+
+    printf("%d files:\n", files);
+    benchLookups(files, 0, 2000);
+    benchLookups(files, 16, 2000);
+    if (files > 16)
+      benchLookups(files, files, 2000);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1 && strcmp(argv[1], "bench") == 0)
+  {
+    benchmark();
+    return 0;
+  }
+
+  testLookups();
+  testOpenFiles();
+  testOverBudget();
+  testGarbageCollection();
+  testMemory();
+
+  return test_summary();
+}
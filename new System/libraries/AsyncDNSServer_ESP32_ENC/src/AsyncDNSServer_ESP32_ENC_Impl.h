@@ -51,7 +51,7 @@ struct DNSHeader
 
 ////////////////////////////////////////////////
 
-bool requestIncludesOnlyOneQuestion(DNSHeader * _dnsHeader)
+bool requestIncludesOnlyOneQuestion(const DNSHeader * _dnsHeader)
 {
   return ntohs(_dnsHeader->QDCount) == 1 &&
          _dnsHeader->ANCount == 0 &&
@@ -61,45 +61,112 @@ bool requestIncludesOnlyOneQuestion(DNSHeader * _dnsHeader)
 
 ////////////////////////////////////////////////
 
-void downcaseAndRemoveWwwPrefix(String &domainName)
+inline unsigned char asciiLower(unsigned char c)
 {
-  domainName.toLowerCase();
-  domainName.replace("www.", "");
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
 }
 
 ////////////////////////////////////////////////
 
-String getDomainNameWithoutWwwPrefix(unsigned char *start)
+// Length of the name starting at 'name', terminating zero included, or 0 if it
+// runs past 'end', is too long or uses compression (not expected in a question)
+size_t questionNameLength(const unsigned char *name, const unsigned char *end)
 {
-  String parsedDomainName = "";
+  const unsigned char *pos = name;
 
-  if (start == nullptr || *start == 0)
-    return parsedDomainName;
+  while (pos < end)
+  {
+    unsigned char labelLength = *pos;
+
+    if (labelLength == 0)
+      return pos + 1 - name;
+
+    if (labelLength > 63)
+      return 0;
+
+    pos += labelLength + 1;
+
+    // Count the zero length label that must still follow
+    if (pos + 1 - name > DNS_MAX_NAME_LENGTH)
+      return 0;
+  }
+
+  return 0;
+}
 
-  int pos = 0;
+////////////////////////////////////////////////
+
+bool isWwwLabel(const unsigned char *label)
+{
+  return label[0] == 3 && asciiLower(label[1]) == 'w' &&
+         asciiLower(label[2]) == 'w' && asciiLower(label[3]) == 'w';
+}
 
+////////////////////////////////////////////////
+
+// Compare a question name, already checked by questionNameLength(), with
+// labels from encodeDomainName(), ignoring case and "www" labels that are
+// followed by another label
+bool domainNameMatches(const unsigned char *name, const unsigned char *labels)
+{
   while (true)
   {
-    unsigned char labelLength = *(start + pos);
+    while (isWwwLabel(name) && name[4] != 0)
+      name += 4;
 
-    for (int i = 0; i < labelLength; i++)
-    {
-      pos++;
-      parsedDomainName += (char) * (start + pos);
-    }
+    unsigned char labelLength = *name;
+
+    if (labelLength != *labels)
+      return false;
 
-    pos++;
+    if (labelLength == 0)
+      return true;
 
-    if (*(start + pos) == 0)
+    for (int i = 1; i <= labelLength; i++)
     {
-      downcaseAndRemoveWwwPrefix(parsedDomainName);
-      return parsedDomainName;
+      if (asciiLower(name[i]) != labels[i])
+        return false;
     }
-    else
+
+    name += labelLength + 1;
+    labels += labelLength + 1;
+  }
+}
+
+////////////////////////////////////////////////
+
+// Encode a dotted domain name as DNS labels, lowercase and without "www."
+// labels. Returns false if it is not a valid name.
+bool encodeDomainName(const String &domainName, unsigned char *labels, size_t size)
+{
+  const char *name = domainName.c_str();
+  size_t out = 0;
+
+  while (*name)
+  {
+    const char *dot = strchr(name, '.');
+    size_t labelLength = dot ? (size_t) (dot - name) : strlen(name);
+
+    if (labelLength > 63 || out + labelLength + 2 > size)
+      return false;
+
+    if (labelLength > 0)
     {
-      parsedDomainName += ".";
+      labels[out] = labelLength;
+
+      for (size_t i = 0; i < labelLength; i++)
+        labels[out + 1 + i] = asciiLower(name[i]);
+
+      if (!dot || !isWwwLabel(labels + out))
+        out += labelLength + 1;
     }
+
+    name += labelLength + (dot ? 1 : 0);
   }
+
+  labels[out] = 0;
+
+  return true;
 }
 }
 
@@ -109,6 +176,10 @@ AsyncDNSServer::AsyncDNSServer()
 {
   _ttl = htonl(60);
   _errorReplyCode = AsyncDNSReplyCode::NonExistentDomain;
+  memset(_resolvedIP, 0, sizeof(_resolvedIP));
+  _domainLabels[0] = 0;
+  _anyDomain = false;
+  updateAnswer();
 }
 
 ////////////////////////////////////////////////
@@ -122,7 +193,17 @@ bool AsyncDNSServer::start(const uint16_t port, const String &domainName,
   _resolvedIP[1] = resolvedIP[1];
   _resolvedIP[2] = resolvedIP[2];
   _resolvedIP[3] = resolvedIP[3];
-  downcaseAndRemoveWwwPrefix(_domainName);
+  updateAnswer();
+
+  _anyDomain = (_domainName == "*");
+
+  if (!_anyDomain && !encodeDomainName(_domainName, _domainLabels, sizeof(_domainLabels)))
+  {
+    DNS_LOGERROR1(F("start: invalid domain name"), _domainName);
+
+    // Question labels are at most 63 long: this never matches
+    _domainLabels[0] = 0xFF;
+  }
 
   if (_udp.listen(_port))
   {
@@ -151,6 +232,28 @@ void AsyncDNSServer::setErrorReplyCode(const AsyncDNSReplyCode &replyCode)
 void AsyncDNSServer::setTTL(const uint32_t ttl)
 {
   _ttl = htonl(ttl);
+  updateAnswer();
+}
+
+////////////////////////////////////////////////
+
+void AsyncDNSServer::updateAnswer()
+{
+  _answer[0] = 192;   // answer name is a pointer
+  _answer[1] = 12;    // pointer to offset at 0x00c
+
+  _answer[2] = 0;     // 0x0001  answer is type A query (host address)
+  _answer[3] = 1;
+
+  _answer[4] = 0;     // 0x0001 answer is class IN (internet address)
+  _answer[5] = 1;
+
+  memcpy(_answer + 6, &_ttl, sizeof(_ttl));
+
+  // Length of RData is 4 bytes (because, in this case, RData is IPv4)
+  _answer[10] = 0;
+  _answer[11] = 4;
+  memcpy(_answer + 12, _resolvedIP, sizeof(_resolvedIP));
 }
 
 ////////////////////////////////////////////////
@@ -166,62 +269,50 @@ void AsyncDNSServer::stop()
 
 void AsyncDNSServer::processRequest(AsyncUDPPacket &packet)
 {
-  if (packet.length() >= sizeof(DNSHeader))
-  {
-    unsigned char * _buffer = packet.data();
-    DNSHeader * _dnsHeader = (DNSHeader*) _buffer;
+  const unsigned char * _buffer = packet.data();
+  size_t length = packet.length();
 
-    String domainNameWithoutWwwPrefix = (_buffer == nullptr ? "" : getDomainNameWithoutWwwPrefix(_buffer + sizeof(
-                                                                                                   DNSHeader)));
+  if (_buffer == nullptr || length < sizeof(DNSHeader))
+    return;
 
-    DNS_LOGDEBUG1("processRequest: domainNameWithoutWwwPrefix =", domainNameWithoutWwwPrefix);
+  const DNSHeader * _dnsHeader = (const DNSHeader *) _buffer;
 
-    if (_dnsHeader->QR == DNS_QR_QUERY && _dnsHeader->OPCode == DNS_OPCODE_QUERY &&
-        requestIncludesOnlyOneQuestion(_dnsHeader) &&
-        (_domainName == "*" || domainNameWithoutWwwPrefix == _domainName)
-       )
-    {
-      replyWithIP(packet);
-    }
-    else if (_dnsHeader->QR == DNS_QR_QUERY)
+  if (_dnsHeader->QR != DNS_QR_QUERY)
+    return;
+
+  if (_dnsHeader->OPCode == DNS_OPCODE_QUERY && requestIncludesOnlyOneQuestion(_dnsHeader))
+  {
+    const unsigned char * name = _buffer + sizeof(DNSHeader);
+    size_t nameLength = questionNameLength(name, _buffer + length);
+    size_t questionEnd = sizeof(DNSHeader) + nameLength + DNS_QUESTION_FIXED_SIZE;
+
+    if (nameLength > 0 && questionEnd <= length &&
+        (_anyDomain || domainNameMatches(name, _domainLabels)))
     {
-      replyWithCustomCode(packet);
+      replyWithIP(packet, questionEnd);
+
+      return;
     }
   }
+
+  replyWithCustomCode(packet);
 }
 
 ////////////////////////////////////////////////
 
-void AsyncDNSServer::replyWithIP(AsyncUDPPacket &packet)
+void AsyncDNSServer::replyWithIP(AsyncUDPPacket &packet, size_t questionEnd)
 {
-  //6 bytes below + szeof(ttl) + 2 bytes. Precalculate to avoid using default of 1460, which is way too much
-  AsyncUDPMessage msg(packet.length() + 12 + sizeof(_resolvedIP));
-
-  msg.write(packet.data(), packet.length());
-  DNSHeader * _dnsHeader = (DNSHeader *)msg.data();
+  // The query's header and question, then the answer
+  memcpy(_response, packet.data(), questionEnd);
+  DNSHeader * _dnsHeader = (DNSHeader *) _response;
 
   _dnsHeader->QR = DNS_QR_RESPONSE;
   _dnsHeader->ANCount = _dnsHeader->QDCount;
-  _dnsHeader->QDCount = _dnsHeader->QDCount;
   //_dnsHeader->RA = 1;
 
-  msg.write((uint8_t)192); //  answer name is a pointer
-  msg.write((uint8_t)12);  // pointer to offset at 0x00c
-
-  msg.write((uint8_t)0);   // 0x0001  answer is type A query (host address)
-  msg.write((uint8_t)1);
-
-  msg.write((uint8_t)0);   //0x0001 answer is class IN (internet address)
-  msg.write((uint8_t)1);
+  memcpy(_response + questionEnd, _answer, sizeof(_answer));
 
-  msg.write((uint8_t *)&_ttl, sizeof(_ttl));
-
-  // Length of RData is 4 bytes (because, in this case, RData is IPv4)
-  msg.write((uint8_t)0);
-  msg.write((uint8_t)4);
-  msg.write(_resolvedIP, sizeof(_resolvedIP));
-
-  packet.send(msg);
+  packet.write(_response, questionEnd + sizeof(_answer));
 
   DNS_LOGDEBUG1(F("replyWithIP: DNS responds: "), (IPAddress) _resolvedIP);
 }
@@ -230,16 +321,18 @@ void AsyncDNSServer::replyWithIP(AsyncUDPPacket &packet)
 
 void AsyncDNSServer::replyWithCustomCode(AsyncUDPPacket &packet)
 {
-  AsyncUDPMessage msg(packet.length());
-
-  msg.write(packet.data(), packet.length());
-  DNSHeader * _dnsHeader = (DNSHeader *)msg.data();
+  // Header only, as the ESP32 core's DNSServer does
+  memcpy(_response, packet.data(), sizeof(DNSHeader));
+  DNSHeader * _dnsHeader = (DNSHeader *) _response;
 
   _dnsHeader->QR = DNS_QR_RESPONSE;
   _dnsHeader->RCode = (unsigned char)_errorReplyCode; //default is AsyncDNSReplyCode::NonExistentDomain
   _dnsHeader->QDCount = 0;
+  _dnsHeader->ANCount = 0;
+  _dnsHeader->NSCount = 0;
+  _dnsHeader->ARCount = 0;
 
-  packet.send(msg);
+  packet.write(_response, sizeof(DNSHeader));
 }
 
 ////////////////////////////////////////////////
@@ -0,0 +1,512 @@
+/*
+ * AsyncDNSServer against a socket that never touches the network: name
+ * matching (case, "www." labels, wildcard), reply bytes compared with the
+ * String and AsyncUDPMessage based server it replaces, the error reply,
+ * malformed queries, and heap allocations per query. The benchmark answers
+ * the lookups phones make when they join a captive portal.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -I../../test -Isrc -Itest/host test/dns.cpp -o dns
+ *   ./dns          # tests
+ *   ./dns bench    # queries per second and allocations per query, before vs after
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "AsyncDNSServer_ESP32_ENC.h"
+#include "host_test.h"
+
+HostSerial Serial;
+AsyncUDP *hostSocket;
+uint8_t hostReply[1500];
+size_t hostReplyLength;
+unsigned hostReplies;
+
+/*
+ * Heap allocations, counted by wrapping the C allocator (not under ASan,
+ * which has its own)
+ */
+
+static unsigned long allocations;
+
+#if !defined(__SANITIZE_ADDRESS__)
+extern "C" {
+  void *__libc_malloc(size_t);
+  void *__libc_calloc(size_t, size_t);
+  void *__libc_realloc(void *, size_t);
+  void __libc_free(void *);
+
+  void *malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+  }
+
+  void *calloc(size_t n, size_t size) {
+    allocations++;
+    return __libc_calloc(n, size);
+  }
+
+  void *realloc(void *p, size_t size) {
+    allocations++;
+    return __libc_realloc(p, size);
+  }
+
+  void free(void *p) {
+    __libc_free(p);
+  }
+}
+#define COUNTS_ALLOCATIONS 1
+#else
+#define COUNTS_ALLOCATIONS 0
+#endif
+
+/*
+ * The server before: the name is parsed into a String per query and each
+ * reply is built in a heap allocated AsyncUDPMessage
+ */
+
+namespace legacy {
+
+void downcaseAndRemoveWwwPrefix(String &domainName)
+{
+  domainName.toLowerCase();
+  domainName.replace("www.", "");
+}
+
+String getDomainNameWithoutWwwPrefix(unsigned char *start)
+{
+  String parsedDomainName = "";
+
+  if (start == nullptr || *start == 0)
+    return parsedDomainName;
+
+  int pos = 0;
+
+  while (true)
+  {
+    unsigned char labelLength = *(start + pos);
+
+    for (int i = 0; i < labelLength; i++)
+    {
+      pos++;
+      parsedDomainName += (char) * (start + pos);
+    }
+
+    pos++;
+
+    if (*(start + pos) == 0)
+    {
+      downcaseAndRemoveWwwPrefix(parsedDomainName);
+      return parsedDomainName;
+    }
+    else
+    {
+      parsedDomainName += ".";
+    }
+  }
+}
+
+class DNSServer
+{
+  public:
+    DNSServer() : _ttl(htonl(60)), _errorReplyCode(AsyncDNSReplyCode::NonExistentDomain) {}
+
+    bool start(const uint16_t port, const String &domainName, const IPAddress &resolvedIP)
+    {
+      _domainName = domainName;
+
+      for (int i = 0; i < 4; i++)
+        _resolvedIP[i] = resolvedIP[i];
+
+      downcaseAndRemoveWwwPrefix(_domainName);
+
+      _udp.listen(port);
+      _udp.onPacket([&](AsyncUDPPacket & packet) { processRequest(packet); });
+
+      return true;
+    }
+
+    void setTTL(const uint32_t ttl) { _ttl = htonl(ttl); }
+
+  private:
+    AsyncUDP _udp;
+    String _domainName;
+    unsigned char _resolvedIP[4];
+    uint32_t _ttl;
+    AsyncDNSReplyCode _errorReplyCode;
+
+    void processRequest(AsyncUDPPacket &packet)
+    {
+      if (packet.length() >= sizeof(DNSHeader))
+      {
+        unsigned char * _buffer = packet.data();
+        DNSHeader * _dnsHeader = (DNSHeader*) _buffer;
+
+        String domainNameWithoutWwwPrefix = (_buffer == nullptr ? "" : getDomainNameWithoutWwwPrefix(_buffer + sizeof(
+                                                                                                       DNSHeader)));
+
+        if (_dnsHeader->QR == DNS_QR_QUERY && _dnsHeader->OPCode == DNS_OPCODE_QUERY &&
+            requestIncludesOnlyOneQuestion(_dnsHeader) &&
+            (_domainName == "*" || domainNameWithoutWwwPrefix == _domainName))
+        {
+          replyWithIP(packet);
+        }
+        else if (_dnsHeader->QR == DNS_QR_QUERY)
+        {
+          replyWithCustomCode(packet);
+        }
+      }
+    }
+
+    void replyWithIP(AsyncUDPPacket &packet)
+    {
+      AsyncUDPMessage msg(packet.length() + 12 + sizeof(_resolvedIP));
+
+      msg.write(packet.data(), packet.length());
+      DNSHeader * _dnsHeader = (DNSHeader *)msg.data();
+
+      _dnsHeader->QR = DNS_QR_RESPONSE;
+      _dnsHeader->ANCount = _dnsHeader->QDCount;
+
+      msg.write((uint8_t)192);
+      msg.write((uint8_t)12);
+      msg.write((uint8_t)0);
+      msg.write((uint8_t)1);
+      msg.write((uint8_t)0);
+      msg.write((uint8_t)1);
+      msg.write((uint8_t *)&_ttl, sizeof(_ttl));
+      msg.write((uint8_t)0);
+      msg.write((uint8_t)4);
+      msg.write(_resolvedIP, sizeof(_resolvedIP));
+
+      packet.send(msg);
+    }
+
+    void replyWithCustomCode(AsyncUDPPacket &packet)
+    {
+      AsyncUDPMessage msg(packet.length());
+
+      msg.write(packet.data(), packet.length());
+      DNSHeader * _dnsHeader = (DNSHeader *)msg.data();
+
+      _dnsHeader->QR = DNS_QR_RESPONSE;
+      _dnsHeader->RCode = (unsigned char)_errorReplyCode;
+      _dnsHeader->QDCount = 0;
+
+      packet.send(msg);
+    }
+};
+
+}  // namespace legacy
+
+/*
+ * Queries as a resolver sends them: 12 byte header with RD set, one
+ * question of type A, class IN
+ */
+
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes query(const char *name, uint16_t id = 0x1234, uint16_t type = 1)
+{
+  Bytes q = { (uint8_t)(id >> 8), (uint8_t)id, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0 };
+
+  while (*name)
+  {
+    const char *dot = strchr(name, '.');
+    size_t len = dot ? (size_t)(dot - name) : strlen(name);
+
+    q.push_back((uint8_t)len);
+    q.insert(q.end(), name, name + len);
+    name += len + (dot ? 1 : 0);
+  }
+
+  q.push_back(0);
+  q.push_back((uint8_t)(type >> 8));
+  q.push_back((uint8_t)type);
+  q.push_back(0);
+  q.push_back(1);
+
+  return q;
+}
+
+// Deliver to the socket, return the reply (empty if none)
+static Bytes ask(AsyncUDP *socket, Bytes q)
+{
+  AsyncUDPPacket packet(q.data(), q.size());
+  unsigned before = hostReplies;
+
+  socket->receive(packet);
+
+  if (hostReplies == before)
+    return Bytes();
+
+  return Bytes(hostReply, hostReply + hostReplyLength);
+}
+
+static bool answered(const Bytes &reply)
+{
+  return reply.size() > 12 && (reply[3] & 0x0F) == 0 && reply[7] == 1;
+}
+
+static const IPAddress portalIP(192, 168, 4, 1);
+
+static void testMatching() {
+  printf("names match regardless of case and \"www.\" labels\n");
+
+  AsyncDNSServer server;
+  server.start(53, "WWW.Portal.Example", portalIP);
+  AsyncUDP *socket = hostSocket;
+
+  CHECK(answered(ask(socket, query("portal.example"))));
+  CHECK(answered(ask(socket, query("PORTAL.example"))));
+  CHECK(answered(ask(socket, query("www.portal.example"))));
+  CHECK(answered(ask(socket, query("WwW.portal.EXAMPLE"))));
+  CHECK(answered(ask(socket, query("www.www.portal.example"))));
+  CHECK(answered(ask(socket, query("portal.www.example"))));
+
+  CHECK(!answered(ask(socket, query("portal.example.com"))));
+  CHECK(!answered(ask(socket, query("example"))));
+  CHECK(!answered(ask(socket, query("wwwportal.example"))));
+  CHECK(!answered(ask(socket, query("xportal.example"))));
+  CHECK(!answered(ask(socket, query("portal.example.www"))));
+  CHECK(!answered(ask(socket, query("portal"))));
+  CHECK(!answered(ask(socket, query(""))));
+}
+
+static void testSameBytesAsBefore() {
+  printf("answers are byte for byte those of the previous server\n");
+
+  static const char *names[] = {
+    "portal.example", "www.portal.example", "PoRtAl.ExAmPlE", "www.www.portal.example",
+  };
+
+  AsyncDNSServer server;
+  server.start(53, "portal.example", portalIP);
+  server.setTTL(300);
+  AsyncUDP *modern = hostSocket;
+
+  legacy::DNSServer before;
+  before.start(53, "portal.example", portalIP);
+  before.setTTL(300);
+  AsyncUDP *old = hostSocket;
+
+  for (const char *name : names) {
+    Bytes q = query(name, 0xBEEF);
+    Bytes reply = ask(modern, q);
+
+    CHECK(reply == ask(old, q));
+    CHECK(reply.size() == q.size() + 16);
+    CHECK(reply[0] == 0xBE && reply[1] == 0xEF);
+    CHECK(reply[2] == 0x81);
+    CHECK(memcmp(reply.data() + 12, q.data() + 12, q.size() - 12) == 0);
+
+    const uint8_t answer[] = { 0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0x01, 0x2C, 0, 4, 192, 168, 4, 1 };
+    CHECK(memcmp(reply.data() + q.size(), answer, sizeof(answer)) == 0);
+  }
+
+  // The answer follows TTL changes after start()
+  server.setTTL(1);
+  Bytes reply = ask(modern, query("portal.example"));
+  CHECK(reply.size() >= 4 && reply[reply.size() - 7] == 1 && reply[reply.size() - 10] == 0);
+}
+
+static void testWildcard() {
+  printf("\"*\" answers every name\n");
+
+  AsyncDNSServer server;
+  server.start(53, "*", portalIP);
+  AsyncUDP *socket = hostSocket;
+
+  CHECK(answered(ask(socket, query("connectivitycheck.gstatic.com"))));
+  CHECK(answered(ask(socket, query("captive.apple.com"))));
+  CHECK(answered(ask(socket, query("a"))));
+  CHECK(answered(ask(socket, query(""))));
+}
+
+static void testErrorReply() {
+  printf("other names get the error code in a bare header\n");
+
+  AsyncDNSServer server;
+  server.start(53, "portal.example", portalIP);
+  AsyncUDP *socket = hostSocket;
+
+  Bytes reply = ask(socket, query("elsewhere.example", 0x4242));
+  const uint8_t nxdomain[] = { 0x42, 0x42, 0x81, 0x03, 0, 0, 0, 0, 0, 0, 0, 0 };
+  CHECK(reply == Bytes(nxdomain, nxdomain + sizeof(nxdomain)));
+
+  server.setErrorReplyCode(AsyncDNSReplyCode::Refused);
+  reply = ask(socket, query("elsewhere.example"));
+  CHECK(reply.size() == 12 && (reply[3] & 0x0F) == 5);
+
+  // Two questions
+  Bytes q = query("portal.example");
+  q[5] = 2;
+  reply = ask(socket, q);
+  CHECK(reply.size() == 12 && (reply[3] & 0x0F) == 5);
+
+  // Not a standard query (opcode 2, status)
+  q = query("portal.example");
+  q[2] |= 2 << 3;
+  reply = ask(socket, q);
+  CHECK(reply.size() == 12 && (reply[3] & 0x0F) == 5);
+}
+
+static void testMalformed() {
+  printf("malformed queries are never answered and never overread\n");
+
+  AsyncDNSServer server;
+  server.start(53, "portal.example", portalIP);
+  AsyncUDP *socket = hostSocket;
+
+  // Shorter than a header
+  Bytes q = query("portal.example");
+  CHECK(ask(socket, Bytes(q.begin(), q.begin() + 11)).empty());
+
+  // A response, not a query
+  q[2] |= 0x80;
+  CHECK(ask(socket, q).empty());
+
+  // Cut inside the name, and before QTYPE/QCLASS
+  q = query("portal.example");
+  for (size_t len = 12; len < q.size(); len++) {
+    Bytes reply = ask(socket, Bytes(q.begin(), q.begin() + len));
+    CHECK(reply.size() == 12 && (reply[3] & 0x0F) == 3);
+  }
+
+  // Compression pointer in the question
+  q = { 0x12, 0x34, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0, 0xC0, 0x0C, 0, 1, 0, 1 };
+  Bytes reply = ask(socket, q);
+  CHECK(reply.size() == 12 && (reply[3] & 0x0F) == 3);
+
+  // Name longer than 255
+  std::string longName;
+  for (int i = 0; i < 5; i++)
+    longName += std::string(60, 'a') + ".";
+  longName += "portal.example";
+  reply = ask(socket, query(longName.c_str()));
+  CHECK(reply.size() == 12 && (reply[3] & 0x0F) == 3);
+
+  // At the limit: 255 bytes on the wire, terminating zero included, is the
+  // longest name. The reply to it fills the response buffer exactly.
+  AsyncDNSServer wildcard;
+  wildcard.start(53, "*", portalIP);
+  std::string longest = std::string(63, 'a') + "." + std::string(63, 'b') + "." +
+                        std::string(63, 'c') + "." + std::string(61, 'd');
+  reply = ask(hostSocket, query(longest.c_str()));
+  CHECK(answered(reply));
+  CHECK(reply.size() == DNS_MAX_RESPONSE_SIZE);
+
+  // One byte more (labels of 63, 63, 63 and 62) is 256 bytes
+  std::string tooLong = longest + "d";
+  reply = ask(hostSocket, query(tooLong.c_str()));
+  CHECK(reply.size() == 12 && (reply[3] & 0x0F) == 3);
+
+  // A configured name that cannot be a DNS name matches nothing
+  AsyncDNSServer invalid;
+  invalid.start(53, (std::string(64, 'x') + ".example").c_str(), portalIP);
+  reply = ask(hostSocket, query((std::string(63, 'x') + ".example").c_str()));
+  CHECK(reply.size() == 12);
+}
+
+static void testNoAllocations() {
+  printf("queries are answered without allocating\n");
+
+  AsyncDNSServer server;
+  server.start(53, "portal.example", portalIP);
+  AsyncUDP *socket = hostSocket;
+
+  Bytes hit = query("www.portal.example");
+  Bytes miss = query("connectivitycheck.gstatic.com");
+  AsyncUDPPacket hitPacket(hit.data(), hit.size());
+  AsyncUDPPacket missPacket(miss.data(), miss.size());
+
+  unsigned long before = allocations;
+  unsigned repliesBefore = hostReplies;
+
+  for (int i = 0; i < 100; i++) {
+    socket->receive(hitPacket);
+    socket->receive(missPacket);
+  }
+
+  CHECK(hostReplies - repliesBefore == 200);
+
+  if (COUNTS_ALLOCATIONS)
+    CHECK(allocations == before);
+}
+
+/*
+ * Benchmark: what phones look up when they join a captive portal, served
+ * by a portal that answers only its own name
+ */
+
+static const char *portalLookups[] = {
+  "connectivitycheck.gstatic.com", "www.google.com", "clients3.google.com",
+  "captive.apple.com", "www.apple.com", "www.msftconnecttest.com",
+  "dns.msftncsi.com", "detectportal.firefox.com", "portal.example",
+  "www.portal.example", "mtalk.google.com", "play.googleapis.com",
+  "time.android.com", "gateway.icloud.com", "PORTAL.example",
+  "nmcheck.gnome.org",
+};
+
+template<typename Server>
+static void bench(const char *label, Server &server) {
+  server.start(53, "portal.example", portalIP);
+  AsyncUDP *socket = hostSocket;
+
+  std::vector<Bytes> corpus;
+  uint16_t id = 1;
+  for (const char *name : portalLookups)
+    corpus.push_back(query(name, id++));
+
+  const int rounds = 200000;
+  unsigned long allocBefore = allocations;
+  unsigned repliesBefore = hostReplies;
+  clock_t start = clock();
+
+  for (int r = 0; r < rounds; r++) {
+    for (Bytes &q : corpus) {
+      AsyncUDPPacket packet(q.data(), q.size());
+      socket->receive(packet);
+    }
+  }
+
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  double queries = (double)rounds * corpus.size();
+
+  printf("  %-8s %6.2f M queries/s  %5.2f allocations/query  (%u replies)\n", label,
+         queries / seconds / 1e6, (allocations - allocBefore) / queries,
+         hostReplies - repliesBefore);
+}
+
+static void runBench() {
+  printf("captive portal lookups, %d names, one matching domain\n",
+         (int)(sizeof(portalLookups) / sizeof(portalLookups[0])));
+
+  legacy::DNSServer before;
+  bench("before", before);
+
+  AsyncDNSServer after;
+  bench("after", after);
+
+  if (!COUNTS_ALLOCATIONS)
+    printf("  (allocations not counted under ASan)\n");
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    runBench();
+    return 0;
+  }
+
+  testMatching();
+  testSameBytesAsBefore();
+  testWildcard();
+  testErrorReply();
+  testMalformed();
+  testNoAllocations();
+
+  return test_summary();
+}
@@ -0,0 +1,114 @@
+// Host stand-in for the Arduino core: just what the library calls.
+// String allocates on the heap like the real one, so dns.cpp can count it.
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define F(s) (s)
+
+class String
+{
+  public:
+    String(const char *s = "") : _buf(nullptr) { assign(s, strlen(s)); }
+    String(const String &other) : _buf(nullptr) { assign(other._buf, other._len); }
+    ~String() { free(_buf); }
+
+    String &operator=(const String &other)
+    {
+      if (this != &other)
+        assign(other._buf, other._len);
+
+      return *this;
+    }
+
+    String &operator+=(char c)
+    {
+      char s[2] = { c, 0 };
+      return append(s, 1);
+    }
+
+    String &operator+=(const char *s) { return append(s, strlen(s)); }
+
+    bool operator==(const String &other) const { return _len == other._len && memcmp(_buf, other._buf, _len) == 0; }
+    bool operator==(const char *s) const { return strcmp(_buf, s) == 0; }
+
+    const char *c_str() const { return _buf; }
+    size_t length() const { return _len; }
+
+    void toLowerCase()
+    {
+      for (size_t i = 0; i < _len; i++)
+        if (_buf[i] >= 'A' && _buf[i] <= 'Z')
+          _buf[i] += 'a' - 'A';
+    }
+
+    void replace(const char *find, const char *with)
+    {
+      size_t findLen = strlen(find);
+      String out;
+
+      for (size_t i = 0; i < _len; )
+      {
+        if (findLen && strncmp(_buf + i, find, findLen) == 0)
+        {
+          out += with;
+          i += findLen;
+        }
+        else
+          out += _buf[i++];
+      }
+
+      *this = out;
+    }
+
+  private:
+    char *_buf;
+    size_t _len;
+
+    void assign(const char *s, size_t len)
+    {
+      char *buf = (char *) malloc(len + 1);
+      memcpy(buf, s, len);
+      buf[len] = 0;
+      free(_buf);
+      _buf = buf;
+      _len = len;
+    }
+
+    String &append(const char *s, size_t len)
+    {
+      _buf = (char *) realloc(_buf, _len + len + 1);
+      memcpy(_buf + _len, s, len);
+      _len += len;
+      _buf[_len] = 0;
+
+      return *this;
+    }
+};
+
+class IPAddress
+{
+  public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : _bytes{ a, b, c, d } {}
+    IPAddress(const uint8_t *bytes) { memcpy(_bytes, bytes, 4); }
+    uint8_t operator[](int i) const { return _bytes[i]; }
+
+  private:
+    uint8_t _bytes[4];
+};
+
+struct HostSerial
+{
+  template<typename T> void print(const T &) {}
+  template<typename T> void println(const T &) {}
+};
+
+extern HostSerial Serial;
+
+#endif
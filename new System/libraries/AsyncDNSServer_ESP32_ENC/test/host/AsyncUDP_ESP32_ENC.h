@@ -0,0 +1,95 @@
+// Host stand-in for AsyncUDP_ESP32_ENC: a socket that never touches the
+// network. dns.cpp feeds packets to the handler given to onPacket() and
+// reads back what was written.
+
+#ifndef ASYNC_UDP_ESP32_ENC_H
+#define ASYNC_UDP_ESP32_ENC_H
+
+#include <functional>
+
+#include "Arduino.h"
+
+class AsyncUDPMessage
+{
+  public:
+    // Allocates its buffer like the real one
+    explicit AsyncUDPMessage(size_t size = 1460) : _size(size), _index(0) { _buffer = (uint8_t *) malloc(size); }
+    virtual ~AsyncUDPMessage() { free(_buffer); }
+
+    size_t write(const uint8_t *data, size_t len)
+    {
+      if (len > _size - _index)
+        len = _size - _index;
+
+      memcpy(_buffer + _index, data, len);
+      _index += len;
+
+      return len;
+    }
+
+    size_t write(uint8_t data) { return write(&data, 1); }
+
+    uint8_t *data() { return _buffer; }
+    size_t length() { return _index; }
+
+  private:
+    uint8_t *_buffer;
+    size_t _size;
+    size_t _index;
+};
+
+// Last datagram sent back, and how many were sent
+extern uint8_t hostReply[1500];
+extern size_t hostReplyLength;
+extern unsigned hostReplies;
+
+class AsyncUDPPacket
+{
+  public:
+    AsyncUDPPacket(uint8_t *data, size_t len) : _data(data), _len(len) {}
+
+    uint8_t *data() { return _data; }
+    size_t length() { return _len; }
+
+    size_t write(const uint8_t *data, size_t len)
+    {
+      memcpy(hostReply, data, len);
+      hostReplyLength = len;
+      hostReplies++;
+
+      return len;
+    }
+
+    size_t send(AsyncUDPMessage &message) { return write(message.data(), message.length()); }
+
+  private:
+    uint8_t *_data;
+    size_t _len;
+};
+
+typedef std::function<void(AsyncUDPPacket& packet)> AuPacketHandlerFunction;
+
+class AsyncUDP;
+
+// The socket that listened last
+extern AsyncUDP *hostSocket;
+
+class AsyncUDP
+{
+  public:
+    bool listen(uint16_t)
+    {
+      hostSocket = this;
+      return true;
+    }
+
+    void onPacket(AuPacketHandlerFunction cb) { _handler = cb; }
+    void close() {}
+
+    void receive(AsyncUDPPacket &packet) { _handler(packet); }
+
+  private:
+    AuPacketHandlerFunction _handler;
+};
+
+#endif
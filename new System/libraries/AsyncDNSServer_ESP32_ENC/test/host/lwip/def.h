@@ -0,0 +1,8 @@
+// Host stand-in for lwIP's byte order helpers.
+
+#ifndef LWIP_DEF_H
+#define LWIP_DEF_H
+
+#include <arpa/inet.h>
+
+#endif
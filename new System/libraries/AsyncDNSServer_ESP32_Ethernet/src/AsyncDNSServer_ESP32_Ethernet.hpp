@@ -198,6 +198,14 @@
 #define DNS_QR_RESPONSE 1
 #define DNS_OPCODE_QUERY 0
 
+#define DNS_HEADER_SIZE 12
+#define DNS_MAX_NAME_LENGTH 255
+#define DNS_QUESTION_FIXED_SIZE 4     // QTYPE and QCLASS after the name
+#define DNS_ANSWER_SIZE 16            // name pointer, type, class, TTL, length, IPv4 address
+
+// Largest reply: the query's header and question, then the answer
+#define DNS_MAX_RESPONSE_SIZE (DNS_HEADER_SIZE + DNS_MAX_NAME_LENGTH + DNS_QUESTION_FIXED_SIZE + DNS_ANSWER_SIZE)
+
 ////////////////////////////////////////////////
 
 enum class AsyncDNSReplyCode : unsigned char
@@ -236,8 +244,18 @@ class AsyncDNSServer
     uint32_t _ttl;
     AsyncDNSReplyCode _errorReplyCode;
 
+    // _domainName as DNS labels, lowercase and without "www" labels, compared
+    // in place against each query
+    unsigned char _domainLabels[DNS_MAX_NAME_LENGTH + 1];
+    bool _anyDomain;
+
+    // Replies are built here: no allocation per query
+    unsigned char _answer[DNS_ANSWER_SIZE];
+    unsigned char _response[DNS_MAX_RESPONSE_SIZE];
+
+    void updateAnswer();
     void processRequest(AsyncUDPPacket &packet);
-    void replyWithIP(AsyncUDPPacket &packet);
+    void replyWithIP(AsyncUDPPacket &packet, size_t questionEnd);
     void replyWithCustomCode(AsyncUDPPacket &packet);
 };
 
@@ -114,6 +114,7 @@
 ////////////////////////////////////////////////
 
 #include "AsyncUDP_ESP32_SC_Ethernet_Debug.h"
+#include "AsyncUDP_ESP32_SC_Ethernet_Pool.h"
 
 ////////////////////////////////////////////////////
 
@@ -306,6 +307,9 @@ class AsyncUDP : public Print
     operator  bool();
 
     static void _s_recv(void *arg, udp_pcb *upcb, pbuf *p, const ip_addr_t *addr, uint16_t port, struct netif * netif);
+
+    // Receive drops and buffer pool use, shared by all AsyncUDP instances
+    static AsyncUDPStats stats();
 };
 
 ////////////////////////////////////////////////
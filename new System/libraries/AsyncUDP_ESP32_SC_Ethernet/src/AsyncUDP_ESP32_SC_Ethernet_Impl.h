@@ -248,7 +248,10 @@ typedef struct
 
 ////////////////////////////////////////////////
 
-static xQueueHandle _udp_queue;
+// Received datagrams go from the lwIP thread to the async_udp task through
+// a fixed set of slots: no malloc() per datagram, and when the task falls
+// behind new datagrams are dropped instead of blocking the lwIP thread
+static AsyncUDPEventQueue<lwip_event_packet_t, ASYNC_UDP_PACKET_POOL_SIZE> _udp_events;
 static volatile TaskHandle_t _udp_task_handle = NULL;
 
 ////////////////////////////////////////////////
@@ -259,16 +262,16 @@ static void _udp_task(void *pvParameters)
 
   for (;;)
   {
-    if (xQueueReceive(_udp_queue, &e, portMAX_DELAY) == pdTRUE)
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    while ((e = _udp_events.next()) != NULL)
     {
-      if (!e->pb)
+      if (e->pb)
       {
-        free((void*)(e));
-        continue;
+        AsyncUDP::_s_recv(e->arg, e->pcb, e->pb, e->addr, e->port, e->netif);
       }
 
-      AsyncUDP::_s_recv(e->arg, e->pcb, e->pb, e->addr, e->port, e->netif);
-      free((void*)(e));
+      _udp_events.recycle(e);
     }
   }
 
@@ -280,16 +283,6 @@ static void _udp_task(void *pvParameters)
 
 static bool _udp_task_start()
 {
-  if (!_udp_queue)
-  {
-    _udp_queue = xQueueCreate(32, sizeof(lwip_event_packet_t *));
-
-    if (!_udp_queue)
-    {
-      return false;
-    }
-  }
-
   if (!_udp_task_handle)
   {
     xTaskCreateUniversal(_udp_task, "async_udp", 4096, NULL, CONFIG_ARDUINO_UDP_TASK_PRIORITY,
@@ -308,12 +301,12 @@ static bool _udp_task_start()
 
 static bool _udp_task_post(void *arg, udp_pcb *pcb, pbuf *pb, const ip_addr_t *addr, uint16_t port, struct netif *netif)
 {
-  if (!_udp_task_handle || !_udp_queue)
+  if (!_udp_task_handle)
   {
     return false;
   }
 
-  lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+  lwip_event_packet_t * e = _udp_events.reserve();
 
   if (!e)
   {
@@ -327,13 +320,13 @@ static bool _udp_task_post(void *arg, udp_pcb *pcb, pbuf *pb, const ip_addr_t *a
   e->port   = port;
   e->netif  = netif;
 
-  if (xQueueSend(_udp_queue, &e, portMAX_DELAY) != pdPASS)
+  if (!_udp_events.post(e))
   {
-    free((void*)(e));
-
     return false;
   }
 
+  xTaskNotifyGive(_udp_task_handle);
+
   return true;
 }
 
@@ -371,23 +364,34 @@ static void _udp_recv(void *arg, udp_pcb *pcb, pbuf *pb, const ip_addr_t *addr,
 
     lwip_event_packet_t * e;
 
-    while (xQueueReceive(_udp_queue, &e, 0) == pdTRUE)
+    while ((e = _udp_events.next()) != NULL)
     {
       if(e->pb)
       {
         pbuf_free(e->pb);
       }
 
-      free((void*)(e));
+      _udp_events.recycle(e);
     }
-
-    vQueueDelete(_udp_queue);
-    _udp_queue = NULL;
   }
 */
 
 ////////////////////////////////////////////////
 
+// AsyncUDPMessage buffers, reused instead of malloc()ed for each message
+typedef struct
+{
+  uint8_t data[CONFIG_TCP_MSS];
+} async_udp_message_buffer_t;
+
+#if (ASYNC_UDP_MESSAGE_POOL_SIZE > 0)
+static AsyncUDPPool<async_udp_message_buffer_t, ASYNC_UDP_MESSAGE_POOL_SIZE> _udp_message_pool;
+#endif
+
+static std::atomic<uint32_t> _udp_message_fallbacks(0);
+
+////////////////////////////////////////////////
+
 #define UDP_MUTEX_LOCK()    //xSemaphoreTake(_lock, portMAX_DELAY)
 #define UDP_MUTEX_UNLOCK()  //xSemaphoreGive(_lock)
 
@@ -403,6 +407,17 @@ AsyncUDPMessage::AsyncUDPMessage(size_t size)
   }
 
   _size = size;
+
+#if (ASYNC_UDP_MESSAGE_POOL_SIZE > 0)
+  _buffer = (uint8_t *) _udp_message_pool.acquire();
+
+  if (_buffer)
+  {
+    return;
+  }
+#endif
+
+  _udp_message_fallbacks.fetch_add(1, std::memory_order_relaxed);
   _buffer = (uint8_t *)malloc(size);
 }
 
@@ -410,6 +425,15 @@ AsyncUDPMessage::AsyncUDPMessage(size_t size)
 
 AsyncUDPMessage::~AsyncUDPMessage()
 {
+#if (ASYNC_UDP_MESSAGE_POOL_SIZE > 0)
+  if (_udp_message_pool.owns(_buffer))
+  {
+    _udp_message_pool.release((async_udp_message_buffer_t *) _buffer);
+
+    return;
+  }
+#endif
+
   if (_buffer)
   {
     free(_buffer);
@@ -1166,6 +1190,30 @@ void AsyncUDP::_s_recv(void *arg, udp_pcb *upcb, pbuf *p, const ip_addr_t *addr,
 
 ////////////////////////////////////////////////
 
+AsyncUDPStats AsyncUDP::stats()
+{
+  AsyncUDPStats stats;
+
+  stats.received          = _udp_events.posted();
+  stats.dropped           = _udp_events.dropped();
+  stats.packetPoolSize    = _udp_events.size();
+  stats.packetsHighWater  = _udp_events.highWater();
+
+#if (ASYNC_UDP_MESSAGE_POOL_SIZE > 0)
+  stats.messagePoolSize   = _udp_message_pool.size();
+  stats.messagesHighWater = _udp_message_pool.highWater();
+#else
+  stats.messagePoolSize   = 0;
+  stats.messagesHighWater = 0;
+#endif
+
+  stats.messageFallbacks  = _udp_message_fallbacks.load(std::memory_order_relaxed);
+
+  return stats;
+}
+
+////////////////////////////////////////////////
+
 bool AsyncUDP::listen(uint16_t port)
 {
   return listen(IP_ANY_TYPE, port);
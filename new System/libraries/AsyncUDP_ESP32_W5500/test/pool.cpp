@@ -0,0 +1,441 @@
+/*
+ * The receive path's slot pool and event queue, on host threads: objects
+ * handed out once at a time, the free list under contention, FIFO order,
+ * drops and counters when the consumer falls behind, and several producers
+ * racing one consumer with every event either delivered once or counted as
+ * dropped. The benchmark replays a broadcast storm against the previous
+ * path (malloc() per datagram, 32 entry queue that blocks the sender when
+ * full) and the pooled one on a simulated clock.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -pthread -I../../test -Isrc test/pool.cpp -o pool
+ *   ./pool          # tests
+ *   ./pool bench    # lwIP thread stalls, drops and hand-over cost, before vs after
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AsyncUDP_ESP32_W5500_Pool.h"
+#include "host_test.h"
+
+struct Event {
+  uint32_t producer;
+  uint32_t sequence;
+  std::atomic<int> owners;
+};
+
+// Globals, as the library keeps them: ready without running a constructor
+static AsyncUDPPool<Event, 8> globalPool;
+
+static void testPoolBasics() {
+  printf("pool hands out each object once, reuses returned ones, counts the rest\n");
+
+  AsyncUDPPool<Event, 8> &pool = globalPool;
+  Event *taken[8];
+
+  CHECK(pool.size() == 8 && pool.inUse() == 0);
+
+  for (int i = 0; i < 8; i++) {
+    taken[i] = pool.acquire();
+    CHECK(taken[i] != NULL && pool.owns(taken[i]));
+
+    for (int j = 0; j < i; j++)
+      CHECK(taken[i] != taken[j]);
+  }
+
+  CHECK(pool.acquire() == NULL);
+  CHECK(pool.exhausted() == 1);
+  CHECK(pool.inUse() == 8 && pool.highWater() == 8);
+
+  pool.release(taken[3]);
+  pool.release(taken[5]);
+  CHECK(pool.inUse() == 6);
+
+  // Last returned, first out
+  CHECK(pool.acquire() == taken[5]);
+  CHECK(pool.acquire() == taken[3]);
+  CHECK(pool.acquire() == NULL);
+
+  for (int i = 0; i < 8; i++)
+    pool.release(taken[i]);
+
+  CHECK(pool.inUse() == 0 && pool.highWater() == 8);
+
+  Event outside;
+  CHECK(!pool.owns(&outside));
+}
+
+static void testPoolContention() {
+  printf("pool under contention never hands one object to two threads\n");
+
+  static AsyncUDPPool<Event, 16> pool;
+  std::atomic<uint32_t> acquired(0);
+  std::atomic<int> shared(0);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < 6; t++) {
+    threads.push_back(std::thread([&, t] {
+      Event *held[3];
+
+      for (int i = 0; i < 200000; i++) {
+        int n = 1 + (i + t) % 3;
+        int got = 0;
+
+        for (int k = 0; k < n; k++) {
+          if ((held[got] = pool.acquire()) != NULL) {
+            if (held[got]->owners.fetch_add(1) != 0)
+              shared++;
+
+            got++;
+          }
+        }
+
+        acquired.fetch_add(got, std::memory_order_relaxed);
+
+        for (int k = 0; k < got; k++) {
+          held[k]->owners.fetch_sub(1);
+          pool.release(held[k]);
+        }
+      }
+    }));
+  }
+
+  for (std::thread &t : threads)
+    t.join();
+
+  CHECK(shared.load() == 0);
+  CHECK(pool.inUse() == 0);
+  CHECK(pool.highWater() <= 16);
+  CHECK(acquired.load() > 0);
+
+  // Every object is back on the free list exactly once
+  Event *all[16];
+  for (int i = 0; i < 16; i++) {
+    all[i] = pool.acquire();
+    CHECK(all[i] != NULL);
+  }
+  CHECK(pool.acquire() == NULL);
+  for (int i = 0; i < 16; i++)
+    pool.release(all[i]);
+}
+
+static void testQueueOrderAndDrops() {
+  printf("queue delivers in order and drops, counted, when full\n");
+
+  static AsyncUDPEventQueue<Event, 4> queue;
+
+  CHECK(queue.next() == NULL);
+
+  for (uint32_t i = 0; i < 6; i++) {
+    Event *e = queue.reserve();
+
+    if (i < 4) {
+      CHECK(e != NULL);
+      e->sequence = i;
+      CHECK(queue.post(e));
+    } else {
+      CHECK(e == NULL);
+    }
+  }
+
+  CHECK(queue.posted() == 4 && queue.dropped() == 2);
+  CHECK(queue.inUse() == 4 && queue.highWater() == 4);
+
+  for (uint32_t i = 0; i < 4; i++) {
+    Event *e = queue.next();
+    CHECK(e != NULL && e->sequence == i);
+
+    if (e)
+      queue.recycle(e);
+  }
+
+  CHECK(queue.next() == NULL);
+  CHECK(queue.inUse() == 0);
+
+  // Keeps going round the ring
+  for (uint32_t i = 0; i < 1000; i++) {
+    Event *e = queue.reserve();
+    e->sequence = i;
+    CHECK(queue.post(e));
+    e = queue.next();
+    CHECK(e != NULL && e->sequence == i);
+    queue.recycle(e);
+  }
+
+  CHECK(queue.posted() == 1004 && queue.dropped() == 2 && queue.highWater() == 4);
+}
+
+static void testProducersAndConsumer() {
+  printf("racing producers: each event delivered once, in order per producer, or dropped\n");
+
+  static AsyncUDPEventQueue<Event, 32> queue;
+  const int producers = 4;
+  const uint32_t perProducer = 300000;
+
+  std::atomic<int> running(producers);
+  std::atomic<uint32_t> rejected(0);
+  std::vector<uint32_t> delivered(producers, 0);
+  std::vector<uint32_t> last(producers, 0);
+  bool outOfOrder = false;
+
+  std::thread consumer([&] {
+    while (true) {
+      Event *e = queue.next();
+
+      if (!e) {
+        if (running.load() == 0 && (e = queue.next()) == NULL)
+          break;
+
+        if (!e) {
+          std::this_thread::yield();
+          continue;
+        }
+      }
+
+      if (e->owners.fetch_add(1) != 0)
+        outOfOrder = true;
+
+      if (delivered[e->producer] > 0 && e->sequence <= last[e->producer])
+        outOfOrder = true;
+
+      last[e->producer] = e->sequence;
+      delivered[e->producer]++;
+      e->owners.fetch_sub(1);
+      queue.recycle(e);
+    }
+  });
+
+  std::vector<std::thread> threads;
+
+  for (int p = 0; p < producers; p++) {
+    threads.push_back(std::thread([&, p] {
+      for (uint32_t i = 1; i <= perProducer; i++) {
+        Event *e = queue.reserve();
+
+        if (!e) {
+          rejected.fetch_add(1);
+          std::this_thread::yield();
+          continue;
+        }
+
+        e->producer = p;
+        e->sequence = i;
+
+        if (!queue.post(e))
+          rejected.fetch_add(1);
+      }
+
+      running.fetch_sub(1);
+    }));
+  }
+
+  for (std::thread &t : threads)
+    t.join();
+
+  consumer.join();
+
+  uint32_t total = 0;
+  for (int p = 0; p < producers; p++)
+    total += delivered[p];
+
+  CHECK(!outOfOrder);
+  CHECK(total + rejected.load() == producers * perProducer);
+  CHECK(total == queue.posted());
+  CHECK(rejected.load() == queue.dropped());
+  CHECK(queue.inUse() == 0);
+  CHECK(queue.highWater() <= 32);
+
+  printf("  %u delivered, %u dropped, high water %u/32\n", total, queue.dropped(), queue.highWater());
+}
+
+/*
+ * Benchmark, on a simulated clock so it does not depend on the host's
+ * cores: a broadcast storm of 64 datagram bursts, one every 5 us within a
+ * burst and a burst every 4 ms, while the async_udp task spends 40 us on
+ * each: fine on average, too much for each burst. Before: a malloc()ed descriptor per datagram through a 32 entry
+ * queue that blocks the lwIP thread when full (xQueueSend with
+ * portMAX_DELAY). After: the pooled queue, which drops instead. Then the
+ * host CPU cost of one hand-over, both ways.
+ */
+
+static const int stormBursts = 2000;
+static const int burst = 64;
+static const double arrivalUs = 5;
+static const double burstGapUs = 4000;
+static const double handlerUs = 40;
+
+struct StormResult {
+  uint32_t delivered;
+  uint32_t dropped;
+  double stalledUs;       // lwIP thread blocked in total
+  double worstLateUs;     // most the lwIP thread fell behind the wire
+  uint32_t mallocs;
+};
+
+static double arrival(int i) {
+  return (i / burst) * burstGapUs + (i % burst) * arrivalUs;
+}
+
+// Task takes a datagram off the queue (freeing the queue entry) when it
+// starts on it; the pooled slot is only handed back when it is done
+static StormResult stormBefore() {
+  StormResult r = { 0, 0, 0, 0, 0 };
+  std::deque<double> queued;      // times datagrams entered the queue
+  double taskFree = 0;            // when the task is next able to receive
+  double lwip = 0;                // lwIP thread's clock
+
+  for (int i = 0; i < stormBursts * burst; i++) {
+    lwip = std::max(lwip, arrival(i));
+
+    // Task drains what it can before now
+    while (!queued.empty() && std::max(taskFree, queued.front()) <= lwip) {
+      taskFree = std::max(taskFree, queued.front()) + handlerUs;
+      queued.pop_front();
+      r.delivered++;
+    }
+
+    if (queued.size() == 32) {
+      // Blocks until the task takes the oldest one
+      double unblocked = std::max(taskFree, queued.front());
+      taskFree = unblocked + handlerUs;
+      queued.pop_front();
+      r.delivered++;
+
+      r.stalledUs += unblocked - lwip;
+      lwip = unblocked;
+      r.worstLateUs = std::max(r.worstLateUs, lwip - arrival(i));
+    }
+
+    queued.push_back(lwip);
+    r.mallocs++;
+  }
+
+  r.delivered += queued.size();
+  return r;
+}
+
+static StormResult stormAfter() {
+  static AsyncUDPEventQueue<Event, 32> queue;
+  StormResult r = { 0, 0, 0, 0, 0 };
+  std::deque<std::pair<double, Event *> > running;   // finish time, slot being handled
+  double taskFree = 0;
+
+  for (int i = 0; i < stormBursts * burst; i++) {
+    double now = arrival(i);
+
+    // Task works through the queue in order up to now
+    while (true) {
+      while (!running.empty() && running.front().first <= now) {
+        queue.recycle(running.front().second);
+        running.pop_front();
+      }
+
+      if (taskFree > now)
+        break;
+
+      Event *e = queue.next();
+
+      if (!e)
+        break;
+
+      double start = std::max(taskFree, arrival(e->sequence));
+      taskFree = start + handlerUs;
+      running.push_back(std::make_pair(taskFree, e));
+      r.delivered++;
+    }
+
+    Event *e = queue.reserve();
+
+    if (e) {
+      e->sequence = i;
+      queue.post(e);
+    }
+  }
+
+  while (Event *e = queue.next()) {
+    r.delivered++;
+    queue.recycle(e);
+  }
+
+  r.dropped = queue.dropped();
+  return r;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static double handOverBefore(int rounds) {
+  std::mutex lock;
+  std::deque<Event *> items;
+  Clock::time_point start = Clock::now();
+
+  for (int i = 0; i < rounds; i++) {
+    Event *e = (Event *)malloc(sizeof(Event));
+    e->sequence = i;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      items.push_back(e);
+    }
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      e = items.front();
+      items.pop_front();
+    }
+    free(e);
+  }
+
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / rounds;
+}
+
+static double handOverAfter(int rounds) {
+  static AsyncUDPEventQueue<Event, 32> queue;
+  Clock::time_point start = Clock::now();
+
+  for (int i = 0; i < rounds; i++) {
+    Event *e = queue.reserve();
+    e->sequence = i;
+    queue.post(e);
+    queue.recycle(queue.next());
+  }
+
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / rounds;
+}
+
+static void runBench() {
+  printf("broadcast storm: %d bursts of %d datagrams, %.0f us apart, %.0f us handler\n",
+         stormBursts, burst, arrivalUs, handlerUs);
+
+  StormResult before = stormBefore();
+  StormResult after = stormAfter();
+
+  printf("  before  lwIP blocked %6.0f ms, up to %5.0f us behind, %6u delivered, %6u dropped, %6u malloc()\n",
+         before.stalledUs / 1000, before.worstLateUs, before.delivered, before.dropped, before.mallocs);
+  printf("  after   lwIP blocked %6.0f ms, up to %5.0f us behind, %6u delivered, %6u dropped, %6u malloc()\n",
+         after.stalledUs / 1000, after.worstLateUs, after.delivered, after.dropped, after.mallocs);
+
+  const int rounds = 5000000;
+  printf("hand-over cost on this host, one thread\n");
+  printf("  before  %5.1f ns (malloc, locked queue, free)\n", handOverBefore(rounds));
+  printf("  after   %5.1f ns (pool, lock-free ring)\n", handOverAfter(rounds));
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    runBench();
+    return 0;
+  }
+
+  testPoolBasics();
+  testPoolContention();
+  testQueueOrderAndDrops();
+  testProducersAndConsumer();
+
+  return test_summary();
+}
@@ -22,6 +22,7 @@
 ////////////////////////////////////////////////
 
 #include <WebServer_ESP32_W6100.hpp>     // https://github.com/khoih-prog/WebServer_ESP32_W6100
+#include "AsyncUDP_ESP32_W6100_Pool.h"
 
 class AsyncUDP;
 class AsyncUDPPacket;
@@ -175,6 +176,9 @@ class AsyncUDP : public Print
     operator  bool();
 
     static void _s_recv(void *arg, udp_pcb *upcb, pbuf *p, const ip_addr_t *addr, uint16_t port, struct netif * netif);
+
+    // Receive drops and buffer pool use, shared by all AsyncUDP instances
+    static AsyncUDPStats stats();
 };
 
 ////////////////////////////////////////////////
@@ -0,0 +1,310 @@
+/****************************************************************************************************************************
+  AsyncUdp_ESP32_ENC_Pool.h
+
+  AsyncUDP_ESP32_ENC is a Async UDP library for the ESP32_ENC (ESP32 + LAN8720)
+
+  Based on and modified from ESPAsyncUDP Library (https://github.com/me-no-dev/ESPAsyncUDP)
+  Built by Khoi Hoang https://github.com/khoih-prog/AsyncUDP_ESP32_ENC
+  Licensed under MIT license
+
+  Version: 2.0.0
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  2.0.0   K Hoang      28/11/2022 Initial coding for ESP32_ENC. Bump up version to v2.0.0 to sync with AsyncUDP v2.0.0
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef ASYNC_UDP_ESP32_ENC_POOL_H
+#define ASYNC_UDP_ESP32_ENC_POOL_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+////////////////////////////////////////////////
+
+// Received datagrams waiting for the async_udp task. When all are taken,
+// further datagrams are dropped rather than blocking the lwIP thread.
+// Must be a power of 2.
+#ifndef ASYNC_UDP_PACKET_POOL_SIZE
+  #define ASYNC_UDP_PACKET_POOL_SIZE      32
+#endif
+
+// AsyncUDPMessage buffers kept for reuse (CONFIG_TCP_MSS bytes each).
+// Messages beyond these fall back to malloc(). 0 to always use malloc().
+#ifndef ASYNC_UDP_MESSAGE_POOL_SIZE
+  #define ASYNC_UDP_MESSAGE_POOL_SIZE     4
+#endif
+
+////////////////////////////////////////////////
+
+struct AsyncUDPStats
+{
+  uint32_t received;            // datagrams queued for the handlers
+  uint32_t dropped;             // datagrams dropped because all packet slots were taken
+  uint16_t packetPoolSize;
+  uint16_t packetsHighWater;    // most packet slots in use at once
+  uint16_t messagePoolSize;
+  uint16_t messagesHighWater;   // most pooled AsyncUDPMessage buffers in use at once
+  uint32_t messageFallbacks;    // AsyncUDPMessage buffers that had to be malloc()ed
+};
+
+////////////////////////////////////////////////
+
+// N objects of type T, handed out and taken back from any task without a
+// lock. Returned objects go on a free list (a Treiber stack whose head
+// carries a tag against ABA); objects never handed out yet are taken in
+// order first. Everything starts at zero, so a global pool is ready before
+// any constructor runs.
+template<typename T, uint16_t N>
+class AsyncUDPPool
+{
+  public:
+
+    constexpr AsyncUDPPool() : _items{}, _next{}, _head(0), _fresh(0), _inUse(0), _highWater(0), _exhausted(0) {}
+
+    // NULL when every object is in use
+    T * acquire()
+    {
+      // Free list head: tag in the high half, index + 1 in the low half (0 when empty)
+      uint32_t head = _head.load(std::memory_order_acquire);
+
+      while ((head & 0xFFFF) != 0)
+      {
+        uint16_t index = (head & 0xFFFF) - 1;
+        uint32_t next  = (((head >> 16) + 1) << 16) | _next[index].load(std::memory_order_relaxed);
+
+        if (_head.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire))
+          return taken(index);
+      }
+
+      uint16_t fresh = _fresh.load(std::memory_order_relaxed);
+
+      while (fresh < N)
+      {
+        if (_fresh.compare_exchange_weak(fresh, fresh + 1, std::memory_order_relaxed))
+          return taken(fresh);
+      }
+
+      _exhausted.fetch_add(1, std::memory_order_relaxed);
+
+      return NULL;
+    }
+
+    void release(T * item)
+    {
+      uint16_t index = item - _items;
+      uint32_t head = _head.load(std::memory_order_relaxed);
+
+      _inUse.fetch_sub(1, std::memory_order_relaxed);
+
+      do
+      {
+        _next[index].store(head & 0xFFFF, std::memory_order_relaxed);
+      } while (!_head.compare_exchange_weak(head, (((head >> 16) + 1) << 16) | (index + 1),
+                                            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    bool owns(const void * p) const
+    {
+      return (uintptr_t) p >= (uintptr_t) _items && (uintptr_t) p < (uintptr_t) (_items + N);
+    }
+
+    uint16_t inUse() const
+    {
+      return _inUse.load(std::memory_order_relaxed);
+    }
+
+    uint16_t highWater() const
+    {
+      return _highWater.load(std::memory_order_relaxed);
+    }
+
+    // How many times acquire() found nothing left
+    uint32_t exhausted() const
+    {
+      return _exhausted.load(std::memory_order_relaxed);
+    }
+
+    static constexpr uint16_t size()
+    {
+      return N;
+    }
+
+  private:
+
+    T                      _items[N];
+    std::atomic<uint16_t>  _next[N];      // next free index + 1, for objects on the free list
+    std::atomic<uint32_t>  _head;
+    std::atomic<uint16_t>  _fresh;        // objects handed out at least once
+    std::atomic<uint16_t>  _inUse;
+    std::atomic<uint16_t>  _highWater;
+    std::atomic<uint32_t>  _exhausted;
+
+    T * taken(uint16_t index)
+    {
+      uint16_t inUse = _inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+      uint16_t highWater = _highWater.load(std::memory_order_relaxed);
+
+      while (inUse > highWater &&
+             !_highWater.compare_exchange_weak(highWater, inUse, std::memory_order_relaxed));
+
+      return &_items[index];
+    }
+};
+
+////////////////////////////////////////////////
+
+// Events of type T passed from producers that must never wait (the lwIP
+// thread) to one consumer task. Slots come from a pool of N; a bounded
+// ring of N pointers (Vyukov's sequence numbered cells) carries them in
+// order. When no slot is free the event is dropped and counted.
+template<typename T, uint16_t N>
+class AsyncUDPEventQueue
+{
+  public:
+
+    constexpr AsyncUDPEventQueue() : _pool(), _cells{}, _tail(0), _head(0), _posted(0), _dropped(0) {}
+
+    // Slot to fill in and post(), NULL (counted as a drop) when all are taken
+    T * reserve()
+    {
+      T * event = _pool.acquire();
+
+      if (!event)
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+
+      return event;
+    }
+
+    // Never blocks. On failure the slot is recycled and the event counted as dropped.
+    bool post(T * event)
+    {
+      uint32_t pos = _tail.load(std::memory_order_relaxed);
+
+      while (true)
+      {
+        Cell & cell = _cells[pos & (N - 1)];
+        int32_t diff = (int32_t) (sequence(cell, pos) - pos);
+
+        if (diff == 0)
+        {
+          if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          {
+            cell.event = event;
+            setSequence(cell, pos, pos + 1);
+            _posted.fetch_add(1, std::memory_order_relaxed);
+
+            return true;
+          }
+        }
+        else if (diff < 0)
+        {
+          _pool.release(event);
+          _dropped.fetch_add(1, std::memory_order_relaxed);
+
+          return false;
+        }
+        else
+        {
+          pos = _tail.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    // Oldest event, NULL when empty. Hand it back with recycle() once done.
+    T * next()
+    {
+      uint32_t pos = _head.load(std::memory_order_relaxed);
+
+      while (true)
+      {
+        Cell & cell = _cells[pos & (N - 1)];
+        int32_t diff = (int32_t) (sequence(cell, pos) - (pos + 1));
+
+        if (diff == 0)
+        {
+          if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          {
+            T * event = cell.event;
+            setSequence(cell, pos, pos + N);
+
+            return event;
+          }
+        }
+        else if (diff < 0)
+        {
+          return NULL;
+        }
+        else
+        {
+          pos = _head.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    void recycle(T * event)
+    {
+      _pool.release(event);
+    }
+
+    uint32_t posted() const
+    {
+      return _posted.load(std::memory_order_relaxed);
+    }
+
+    uint32_t dropped() const
+    {
+      return _dropped.load(std::memory_order_relaxed);
+    }
+
+    uint16_t inUse() const
+    {
+      return _pool.inUse();
+    }
+
+    uint16_t highWater() const
+    {
+      return _pool.highWater();
+    }
+
+    static constexpr uint16_t size()
+    {
+      return N;
+    }
+
+  private:
+
+    static_assert((N & (N - 1)) == 0, "ASYNC_UDP_PACKET_POOL_SIZE must be a power of 2");
+
+    // The sequence number is kept minus the cell's index so that the
+    // all-zero start is the ring's initial state
+    struct Cell
+    {
+      std::atomic<uint32_t> sequence{0};
+      T * event = NULL;
+    };
+
+    AsyncUDPPool<T, N>     _pool;
+    Cell                   _cells[N];
+    std::atomic<uint32_t>  _tail;
+    std::atomic<uint32_t>  _head;
+    std::atomic<uint32_t>  _posted;
+    std::atomic<uint32_t>  _dropped;
+
+    static uint32_t sequence(Cell & cell, uint32_t pos)
+    {
+      return cell.sequence.load(std::memory_order_acquire) + (pos & (N - 1));
+    }
+
+    static void setSequence(Cell & cell, uint32_t pos, uint32_t value)
+    {
+      cell.sequence.store(value - (pos & (N - 1)), std::memory_order_release);
+    }
+};
+
+////////////////////////////////////////////////
+
+#endif    //ASYNC_UDP_ESP32_ENC_POOL_H
@@ -525,6 +525,17 @@ void rpc_uart_flush() {
   // Wait for UART to output all the data
   SerialNCP.flush();
 }
+size_t rpc_uart_write_buf(const uint8_t* data, size_t len) {
+  // Put a block to the UART output buffer
+  return SerialNCP.write(data, len);
+}
+size_t rpc_uart_read_buf(uint8_t* data, size_t len) {
+  // Get up to len bytes that are already in the UART input buffer
+  int avail = SerialNCP.available();
+  if (avail <= 0) return 0;
+  if ((size_t)avail < len) len = avail;
+  return SerialNCP.readBytes((char*)data, len);
+}
 uint32_t rpc_system_millis() {
   // Return uptime in milliseconds
   // This is used to implement the RPC timeout
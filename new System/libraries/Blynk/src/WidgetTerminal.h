@@ -77,8 +77,8 @@ public:
     void process(const BlynkParam& param) {
         mRxBuff.put((uint8_t*)param.getBuffer(), param.getLength());
 
-        if (mAppendCR) { mRxBuff.put('\r'); }
-        if (mAppendLF) { mRxBuff.put('\n'); }
+        if (mAppendCR) { mRxBuff.tryPut('\r'); }
+        if (mAppendLF) { mRxBuff.tryPut('\n'); }
     }
 
     void onWrite(BlynkReq BLYNK_UNUSED &request, const BlynkParam& param) {
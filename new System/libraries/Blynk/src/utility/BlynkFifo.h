@@ -6,31 +6,118 @@
  * @date       Feb 2015
  * @brief      FIFO implementation
  *
+ * BlynkFifo is a lock-free ring for one writing and one reading context
+ * (task and ISR, or tasks on different cores). BlynkMpscFifo accepts any
+ * number of writing contexts and needs compare-and-swap (ESP32, ESP8266,
+ * Cortex-M3 and up, Linux, and AVR through a critical section).
+ *
+ * Both store N rounded up to a power of two elements, all of them usable.
  */
 
 #ifndef BlynkFifo_h
 #define BlynkFifo_h
 
+#include <string.h>
 #include <Blynk/BlynkUtility.h>
 
+#if defined(__AVR__)
+    #include <util/atomic.h>
+#endif
+
+// Smallest power of two not below N
+template <unsigned N, unsigned P = 1, bool Done = (P >= N)>
+struct BlynkFifoPow2 {
+    enum { value = BlynkFifoPow2<N, P * 2>::value };
+};
+
+template <unsigned N, unsigned P>
+struct BlynkFifoPow2<N, P, true> {
+    enum { value = P };
+};
+
+// Index access shared between contexts. Loads acquire and stores release,
+// so the element written before an index store is visible to whoever
+// loads the new index.
+#if defined(__AVR__)
+
+// Indices are wider than a byte here: read and write them with
+// interrupts off so an ISR never sees half an update
+static inline unsigned BlynkFifoLoad(const unsigned& v) {
+    unsigned r;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { r = v; }
+    return r;
+}
+
+static inline void BlynkFifoStore(unsigned& v, unsigned x) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { v = x; }
+}
+
+static inline bool BlynkFifoCas(unsigned& v, unsigned& expected, unsigned desired) {
+    bool ok = false;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ok = (v == expected);
+        if (ok) v = desired; else expected = v;
+    }
+    return ok;
+}
+
+#elif defined(__ATOMIC_ACQUIRE)
+
+static inline unsigned BlynkFifoLoad(const unsigned& v) {
+    return __atomic_load_n(&v, __ATOMIC_ACQUIRE);
+}
+
+static inline void BlynkFifoStore(unsigned& v, unsigned x) {
+    __atomic_store_n(&v, x, __ATOMIC_RELEASE);
+}
+
+static inline bool BlynkFifoCas(unsigned& v, unsigned& expected, unsigned desired) {
+    return __atomic_compare_exchange_n(&v, &expected, desired, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+#else
+
+static inline unsigned BlynkFifoLoad(const unsigned& v) {
+    unsigned r = *(const volatile unsigned*)&v;
+    __sync_synchronize();
+    return r;
+}
+
+static inline void BlynkFifoStore(unsigned& v, unsigned x) {
+    __sync_synchronize();
+    *(volatile unsigned*)&v = x;
+}
+
+static inline bool BlynkFifoCas(unsigned& v, unsigned& expected, unsigned desired) {
+    unsigned prev = __sync_val_compare_and_swap(&v, expected, desired);
+    if (prev == expected) return true;
+    expected = prev;
+    return false;
+}
+
+#endif
+
 template <class T, unsigned N>
 class BlynkFifo
 {
 public:
+    enum { CAPACITY = BlynkFifoPow2<N>::value };
+
     BlynkFifo()
-    {
-        clear();
-    }
+        : _w(0)
+        , _r(0)
+    {}
+
+    ~BlynkFifo(void)
+    {}
 
+    // Discards the content. Call from the reading context.
     void clear()
     {
-        _r = 0;
-        _w = 0;
+        BlynkFifoStore(_r, BlynkFifoLoad(_w));
     }
 
-    ~BlynkFifo(void)
-    {}
-
     // writing thread/context API
     //-------------------------------------------------------------
 
@@ -41,21 +128,24 @@ public:
 
     int free(void)
     {
-        int s = _r - _w;
-        if (s <= 0)
-            s += N;
-        return s - 1;
+        return CAPACITY - (_w - BlynkFifoLoad(_r));
+    }
+
+    bool tryPut(const T& c)
+    {
+        unsigned w = _w;
+        if (w - BlynkFifoLoad(_r) == CAPACITY)
+            return false;
+        _b[w & MASK] = c;
+        BlynkFifoStore(_w, w + 1);
+        return true;
     }
 
+    // Waits for the reading context to make room
     T put(const T& c)
     {
-        int i = _w;
-        int j = i;
-        i = _inc(i);
-        while (i == _r) // = !writeable()
+        while (!tryPut(c))
             /* nothing / just wait */;
-        _b[j] = c;
-        _w = i;
         return c;
     }
 
@@ -65,56 +155,75 @@ public:
         while (c)
         {
             int f;
-            while ((f = free()) == 0) // wait for space
+            T* span = writeSpan(f);
+            if (f == 0) // wait for space
             {
-                if (!blocking) return n - c; // no more space and not blocking
-                /* nothing / just wait */;
+                if (!blocking) break; // no more space and not blocking
+                continue;
             }
-            // check free space
             if (c < f) f = c;
-            int w = _w;
-            int m = N - w;
-            // check wrap
-            if (f > m) f = m;
-            memcpy(&_b[w], p, f);
-            _w = _inc(w, f);
+            memcpy(span, p, f * sizeof(T));
+            commitWrite(f);
             c -= f;
             p += f;
         }
         return n - c;
     }
 
+    // Zero-copy writing: up to len free elements, contiguous from the
+    // returned pointer. Fill some of them, then commitWrite() that many.
+    T* writeSpan(int& len)
+    {
+        unsigned w = _w;
+        unsigned f = CAPACITY - (w - BlynkFifoLoad(_r));
+        unsigned m = CAPACITY - (w & MASK);  // up to the end of the buffer
+        len = (f < m) ? f : m;
+        return &_b[w & MASK];
+    }
+
+    void commitWrite(int n)
+    {
+        BlynkFifoStore(_w, _w + n);
+    }
+
     // reading thread/context API
     // --------------------------------------------------------
 
     bool readable(void)
     {
-        return (_r != _w);
+        return _r != BlynkFifoLoad(_w);
     }
 
     size_t size(void)
     {
-        int s = _w - _r;
-        if (s < 0)
-            s += N;
-        return s;
+        return BlynkFifoLoad(_w) - _r;
+    }
+
+    bool tryGet(T& c)
+    {
+        unsigned r = _r;
+        if (r == BlynkFifoLoad(_w))
+            return false;
+        c = _b[r & MASK];
+        BlynkFifoStore(_r, r + 1);
+        return true;
     }
 
+    // Waits for the writing context to put something
     T get(void)
     {
-        int r = _r;
-        while (r == _w) // = !readable()
+        T t;
+        while (!tryGet(t))
             /* nothing / just wait */;
-        T t = _b[r];
-        _r = _inc(r);
         return t;
     }
 
     T peek(void)
     {
-        int r = _r;
-        while (r == _w);
-        return _b[r];
+        unsigned r = _r;
+        while (r == BlynkFifoLoad(_w))
+            /* nothing / just wait */;
+        return _b[r & MASK];
     }
 
     int get(T* p, int n, bool blocking = false)
@@ -123,36 +232,147 @@ public:
         while (c)
         {
             int f;
-            for (;;) // wait for data
+            const T* span = readSpan(f);
+            if (f == 0) // wait for data
             {
-                f = size();
-                if (f)  break;        // free space
-                if (!blocking) return n - c; // no space and not blocking
-                /* nothing / just wait */;
+                if (!blocking) break; // no data and not blocking
+                continue;
             }
-            // check available data
             if (c < f) f = c;
-            int r = _r;
-            int m = N - r;
-            // check wrap
-            if (f > m) f = m;
-            memcpy(p, &_b[r], f);
-            _r = _inc(r, f);
+            memcpy(p, span, f * sizeof(T));
+            commitRead(f);
             c -= f;
             p += f;
         }
         return n - c;
     }
 
+    // Zero-copy reading: up to len elements, contiguous from the returned
+    // pointer. Consume some of them, then commitRead() that many.
+    const T* readSpan(int& len)
+    {
+        unsigned r = _r;
+        unsigned s = BlynkFifoLoad(_w) - r;
+        unsigned m = CAPACITY - (r & MASK);  // up to the end of the buffer
+        len = (s < m) ? s : m;
+        return &_b[r & MASK];
+    }
+
+    void commitRead(int n)
+    {
+        BlynkFifoStore(_r, _r + n);
+    }
+
 private:
-    int _inc(int i, int n = 1)
+    enum { MASK = CAPACITY - 1 };
+
+    // Free-running counters, only masked to index the buffer. Each one
+    // is written by a single context.
+    unsigned _w;
+    unsigned _r;
+    T        _b[CAPACITY];
+};
+
+// Bounded FIFO for any number of writing contexts and one reading context.
+// Writers claim a slot with compare-and-swap and publish it through the
+// slot's sequence number, so a writer preempted halfway never corrupts
+// the others; the reader only sees fully written slots, in claim order.
+template <class T, unsigned N>
+class BlynkMpscFifo
+{
+public:
+    enum { CAPACITY = BlynkFifoPow2<N>::value };
+
+    BlynkMpscFifo()
+        : _w(0)
+        , _r(0)
+    {
+        for (unsigned i = 0; i < CAPACITY; i++) {
+            _cells[i].seq = i;
+        }
+    }
+
+    // writing threads/contexts API
+    //-------------------------------------------------------------
+
+    bool tryPut(const T& c)
+    {
+        unsigned w = BlynkFifoLoad(_w);
+        for (;;) {
+            Cell& cell = _cells[w & MASK];
+            int diff = (int)(BlynkFifoLoad(cell.seq) - w);
+            if (diff == 0) {
+                if (BlynkFifoCas(_w, w, w + 1)) {
+                    cell.value = c;
+                    BlynkFifoStore(cell.seq, w + 1);
+                    return true;
+                }
+                // Another writer took it, w now holds the new position
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                w = BlynkFifoLoad(_w);
+            }
+        }
+    }
+
+    int put(const T* p, int n)
     {
-        return (i + n) % N;
+        int c = 0;
+        while (c < n && tryPut(p[c])) c++;
+        return c;
     }
 
-    T             _b[N];
-    volatile int  _w;
-    volatile int  _r;
+    // Free slots. Only a hint while other writers are active.
+    int free(void)
+    {
+        return CAPACITY - (BlynkFifoLoad(_w) - BlynkFifoLoad(_r));
+    }
+
+    // reading thread/context API
+    // --------------------------------------------------------
+
+    bool readable(void)
+    {
+        return BlynkFifoLoad(_cells[_r & MASK].seq) == _r + 1;
+    }
+
+    // Claimed slots, including ones still being written
+    size_t size(void)
+    {
+        return BlynkFifoLoad(_w) - _r;
+    }
+
+    bool tryGet(T& c)
+    {
+        unsigned r = _r;
+        Cell& cell = _cells[r & MASK];
+        if (BlynkFifoLoad(cell.seq) != r + 1)
+            return false; // empty, or the next writer is not done yet
+        c = cell.value;
+        BlynkFifoStore(cell.seq, r + CAPACITY);
+        BlynkFifoStore(_r, r + 1);
+        return true;
+    }
+
+    int get(T* p, int n)
+    {
+        int c = 0;
+        while (c < n && tryGet(p[c])) c++;
+        return c;
+    }
+
+private:
+    enum { MASK = CAPACITY - 1 };
+
+    struct Cell {
+        unsigned seq;  // position + 1 once written, + CAPACITY once read
+        T        value;
+    };
+
+    unsigned _w;
+    unsigned _r;
+    Cell     _cells[CAPACITY];
 };
 
 #endif
@@ -0,0 +1,430 @@
+/*
+ * BlynkFifo and BlynkMpscFifo on the host: wrap-around, bulk and span
+ * access, producer and consumer threads, and a throughput comparison
+ * with the previous modulo based FIFO.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -pthread -DLINUX -I../../test -Isrc tests/fifo_host.cpp -o fifo_host
+ *   ./fifo_host          # tests
+ *   ./fifo_host bench    # throughput
+ *
+ * Under ThreadSanitizer:
+ *   c++ -std=gnu++11 -O1 -g -pthread -fsanitize=thread -DLINUX -I../../test -Isrc \
+ *       tests/fifo_host.cpp -o fifo_host_tsan && ./fifo_host_tsan
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <thread>
+#include <vector>
+
+#include <utility/BlynkFifo.h>
+#include "host_test.h"
+
+/*
+ * Single thread
+ */
+
+static void test_capacity() {
+    printf("capacity rounds up to a power of two, every slot usable\n");
+    CHECK((BlynkFifo<uint8_t, 1>::CAPACITY == 1));
+    CHECK((BlynkFifo<uint8_t, 100>::CAPACITY == 128));
+    CHECK((BlynkFifo<uint8_t, 256>::CAPACITY == 256));
+    CHECK((BlynkFifo<uint8_t, 257>::CAPACITY == 512));
+    CHECK((BlynkMpscFifo<int, 5>::CAPACITY == 8));
+
+    BlynkFifo<int, 8> fifo;
+    CHECK(fifo.free() == 8);
+    CHECK(!fifo.readable());
+    for (int i = 0; i < 8; i++) CHECK(fifo.tryPut(i));
+    CHECK(!fifo.tryPut(8));
+    CHECK(!fifo.writeable());
+    CHECK(fifo.size() == 8);
+    CHECK(fifo.peek() == 0);
+
+    // Wrap the counters around many times
+    bool inOrder = true;
+    int v;
+    for (int i = 8; i < 100000; i++) {
+        inOrder &= fifo.tryGet(v) && v == i - 8;
+        inOrder &= fifo.tryPut(i);
+    }
+    CHECK(inOrder);
+    fifo.clear();
+    CHECK(fifo.size() == 0);
+    CHECK(!fifo.tryGet(v));
+}
+
+struct Wide {
+    uint32_t a;
+    uint16_t b;
+};
+
+static void test_bulk() {
+    printf("bulk put/get copy whole elements across the wrap\n");
+    BlynkFifo<Wide, 16> fifo;
+    Wide in[40], out[40];
+    for (int i = 0; i < 40; i++) {
+        in[i].a = i * 1000003u;
+        in[i].b = (uint16_t)i;
+    }
+
+    // Start near the end of the buffer so the copies wrap
+    for (int i = 0; i < 11; i++) fifo.put(in[0]);
+    CHECK(fifo.get(out, 11) == 11);
+
+    CHECK(fifo.put(in, 40) == 16);          // not blocking: stops when full
+    CHECK(fifo.get(out, 40) == 16);         // and when empty
+    bool same = true;
+    for (int i = 0; i < 16; i++) same &= out[i].a == in[i].a && out[i].b == in[i].b;
+    CHECK(same);
+
+    // Terminal style: put() with a full buffer must not hang
+    BlynkFifo<uint8_t, 4> bytes;
+    CHECK(bytes.put((const uint8_t*)"hello", 5) == 4);
+    CHECK(!bytes.tryPut('\r'));
+}
+
+static void test_spans() {
+    printf("spans expose contiguous free space and data\n");
+    BlynkFifo<uint8_t, 8> fifo;
+    int len;
+
+    uint8_t* w = fifo.writeSpan(len);
+    CHECK(len == 8);
+    memcpy(w, "abcdef", 6);
+    fifo.commitWrite(6);
+
+    const uint8_t* r = fifo.readSpan(len);
+    CHECK(len == 6 && !memcmp(r, "abcdef", 6));
+    fifo.commitRead(5);
+
+    // Free space is split by the end of the buffer: 2 slots, then 5 more
+    w = fifo.writeSpan(len);
+    CHECK(len == 2);
+    memcpy(w, "gh", 2);
+    fifo.commitWrite(2);
+    w = fifo.writeSpan(len);
+    CHECK(len == 5);
+    memcpy(w, "ijklm", 5);
+    fifo.commitWrite(5);
+    w = fifo.writeSpan(len);
+    CHECK(len == 0);
+
+    r = fifo.readSpan(len);
+    CHECK(len == 3 && !memcmp(r, "fgh", 3));
+    fifo.commitRead(3);
+    r = fifo.readSpan(len);
+    CHECK(len == 5 && !memcmp(r, "ijklm", 5));
+    fifo.commitRead(5);
+    r = fifo.readSpan(len);
+    CHECK(len == 0);
+}
+
+static void test_mpsc_single() {
+    printf("MPSC FIFO fills, drains in order and wraps\n");
+    BlynkMpscFifo<int, 4> fifo;
+    int v;
+    CHECK(!fifo.readable());
+    CHECK(!fifo.tryGet(v));
+    for (int i = 0; i < 4; i++) CHECK(fifo.tryPut(i));
+    CHECK(!fifo.tryPut(4));
+    CHECK(fifo.free() == 0);
+    CHECK(fifo.size() == 4);
+
+    bool inOrder = true;
+    for (int i = 4; i < 100000; i++) {
+        inOrder &= fifo.tryGet(v) && v == i - 4;
+        inOrder &= fifo.tryPut(i);
+    }
+    CHECK(inOrder);
+
+    int out[8];
+    CHECK(fifo.get(out, 8) == 4);
+    CHECK(out[3] == 99999);
+}
+
+/*
+ * Threads
+ */
+
+static void test_spsc_threads() {
+    printf("SPSC between two threads: every byte once, in order\n");
+    static BlynkFifo<uint8_t, 64> fifo;
+    const uint32_t count = 2000000;
+
+    // Writer mixes single puts, bulk puts and spans, like a BLE callback
+    std::thread producer([&]() {
+        uint32_t i = 0;
+        uint8_t chunk[20];
+        while (i < count) {
+            switch (i % 3) {
+            case 0:
+                if (fifo.tryPut((uint8_t)i)) i++;
+                break;
+            case 1: {
+                int n = (count - i < 20) ? count - i : 20;
+                for (int k = 0; k < n; k++) chunk[k] = (uint8_t)(i + k);
+                i += fifo.put(chunk, n);
+                break;
+            }
+            default: {
+                int len;
+                uint8_t* span = fifo.writeSpan(len);
+                if (len > 7) len = 7;
+                if ((uint32_t)len > count - i) len = count - i;
+                for (int k = 0; k < len; k++) span[k] = (uint8_t)(i + k);
+                fifo.commitWrite(len);
+                i += len;
+            }
+            }
+            if (!fifo.writeable()) std::this_thread::yield();
+        }
+    });
+
+    uint32_t expected = 0;
+    bool inOrder = true;
+    uint8_t buf[32];
+    while (expected < count) {
+        int n;
+        if (expected & 1) {
+            n = fifo.get(buf, sizeof(buf));
+            for (int k = 0; k < n; k++) inOrder &= buf[k] == (uint8_t)(expected + k);
+            expected += n;
+        } else {
+            const uint8_t* span = fifo.readSpan(n);
+            for (int k = 0; k < n; k++) inOrder &= span[k] == (uint8_t)(expected + k);
+            fifo.commitRead(n);
+            expected += n;
+        }
+        if (!n) std::this_thread::yield();
+    }
+    producer.join();
+
+    CHECK(inOrder);
+    CHECK(expected == count);
+    CHECK(!fifo.readable());
+}
+
+static void test_mpsc_threads() {
+    printf("MPSC with 4 producer threads: nothing lost, per-producer order\n");
+    static BlynkMpscFifo<uint32_t, 32> fifo;
+    const int producers = 4;
+    const uint32_t perProducer = 300000;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.push_back(std::thread([p]() {
+            for (uint32_t i = 0; i < perProducer; i++) {
+                while (!fifo.tryPut((uint32_t)p << 24 | i))
+                    std::this_thread::yield();
+            }
+        }));
+    }
+
+    uint32_t next[producers] = { 0 };
+    uint32_t received = 0;
+    bool inOrder = true;
+    uint32_t buf[16];
+    while (received < producers * perProducer) {
+        int n = fifo.get(buf, 16);
+        for (int k = 0; k < n; k++) {
+            uint32_t p = buf[k] >> 24;
+            inOrder &= p < (uint32_t)producers && (buf[k] & 0xFFFFFF) == next[p];
+            if (p < (uint32_t)producers) next[p]++;
+        }
+        received += n;
+        if (!n) std::this_thread::yield();
+    }
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+
+    CHECK(inOrder);
+    for (int p = 0; p < producers; p++) CHECK(next[p] == perProducer);
+    CHECK(!fifo.readable());
+}
+
+/*
+ * Benchmark against the previous implementation: modulo indices, one
+ * slot always empty, byte-count memcpy (so bytes only here)
+ */
+
+template <unsigned N>
+class OldFifo
+{
+public:
+    OldFifo() : _w(0), _r(0) {}
+
+    int free(void) {
+        int s = _r - _w;
+        if (s <= 0) s += N;
+        return s - 1;
+    }
+
+    int size(void) {
+        int s = _w - _r;
+        if (s < 0) s += N;
+        return s;
+    }
+
+    void put(uint8_t c) {
+        int i = _w;
+        int j = i;
+        i = _inc(i);
+        while (i == _r)
+            /* nothing / just wait */;
+        _b[j] = c;
+        _w = i;
+    }
+
+    uint8_t get(void) {
+        int r = _r;
+        while (r == _w)
+            /* nothing / just wait */;
+        uint8_t t = _b[r];
+        _r = _inc(r);
+        return t;
+    }
+
+    int put(const uint8_t* p, int n) {
+        int c = n;
+        while (c) {
+            int f = free();
+            if (!f) break;
+            if (c < f) f = c;
+            int w = _w;
+            int m = N - w;
+            if (f > m) f = m;
+            memcpy(&_b[w], p, f);
+            _w = _inc(w, f);
+            c -= f;
+            p += f;
+        }
+        return n - c;
+    }
+
+    int get(uint8_t* p, int n) {
+        int c = n;
+        while (c) {
+            int f = size();
+            if (!f) break;
+            if (c < f) f = c;
+            int r = _r;
+            int m = N - r;
+            if (f > m) f = m;
+            memcpy(p, &_b[r], f);
+            _r = _inc(r, f);
+            c -= f;
+            p += f;
+        }
+        return n - c;
+    }
+
+private:
+    int _inc(int i, int n = 1) { return (i + n) % N; }
+
+    uint8_t       _b[N];
+    volatile int  _w;
+    volatile int  _r;
+};
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// BLYNK_MAX_READBYTES * 2 with the default 256 is a power of two already;
+// 300 is what a sketch raising it to 150 gets
+enum { BENCH_N = 300, BENCH_BYTES = 64 << 20 };
+
+template <class F>
+static double bench_bytes(F& fifo) {
+    double t = now_s();
+    for (uint32_t i = 0; i < BENCH_BYTES / 256; i++) {
+        for (int k = 0; k < 256; k++) fifo.put((uint8_t)k);
+        for (int k = 0; k < 256; k++) if (fifo.get() != (uint8_t)k) failures++;
+    }
+    return BENCH_BYTES / (now_s() - t) / 1e6;
+}
+
+template <class F>
+static double bench_chunks(F& fifo) {
+    uint8_t in[20], out[64];
+    memset(in, 0x5A, sizeof(in));
+    double t = now_s();
+    for (uint32_t i = 0; i < BENCH_BYTES / 240; i++) {
+        for (int k = 0; k < 12; k++) fifo.put(in, sizeof(in));
+        int got = 0;
+        while (got < 240) got += fifo.get(out, sizeof(out));
+    }
+    return BENCH_BYTES / (now_s() - t) / 1e6;
+}
+
+template <class F>
+static double bench_threads(F& fifo) {
+    const uint32_t count = BENCH_BYTES / 4;
+    double t = now_s();
+    std::thread producer([&]() {
+        uint8_t in[20];
+        memset(in, 0x5A, sizeof(in));
+        uint32_t sent = 0;
+        while (sent < count) {
+            int n = fifo.put(in, count - sent < 20 ? count - sent : 20);
+            sent += n;
+            if (!n) std::this_thread::yield();
+        }
+    });
+    uint8_t out[64];
+    uint32_t got = 0;
+    while (got < count) {
+        int n = fifo.get(out, sizeof(out));
+        got += n;
+        if (!n) std::this_thread::yield();
+    }
+    producer.join();
+    return count / (now_s() - t) / 1e6;
+}
+
+static void bench(void) {
+    static OldFifo<BENCH_N> oldFifo;
+    static BlynkFifo<uint8_t, BENCH_N> newFifo;
+    static BlynkMpscFifo<uint8_t, BENCH_N> mpscFifo;
+
+    printf("FIFO<uint8_t, %d>, MB/s           old      new\n", BENCH_N);
+    double o = bench_bytes(oldFifo);
+    double n = bench_bytes(newFifo);
+    printf("  put/get one byte:            %7.1f  %7.1f\n", o, n);
+    o = bench_chunks(oldFifo);
+    n = bench_chunks(newFifo);
+    printf("  put 20, get 64:              %7.1f  %7.1f\n", o, n);
+    o = bench_threads(oldFifo);
+    n = bench_threads(newFifo);
+    printf("  two threads, put 20, get 64: %7.1f  %7.1f\n", o, n);
+
+    double t = now_s();
+    uint8_t v;
+    for (uint32_t i = 0; i < BENCH_BYTES / 256; i++) {
+        for (int k = 0; k < 256; k++) mpscFifo.tryPut((uint8_t)k);
+        for (int k = 0; k < 256; k++) mpscFifo.tryGet(v);
+    }
+    printf("  MPSC tryPut/tryGet:                   %7.1f\n",
+           BENCH_BYTES / (now_s() - t) / 1e6);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && !strcmp(argv[1], "bench")) {
+        bench();
+        return 0;
+    }
+
+    test_capacity();
+    test_bulk();
+    test_spans();
+    test_mpsc_single();
+    test_spsc_threads();
+    test_mpsc_threads();
+
+    return test_summary();
+}
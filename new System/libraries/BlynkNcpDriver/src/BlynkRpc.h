@@ -185,6 +185,13 @@ typedef enum RpcFactoryTestStatus {
 
 typedef void (*rpc_handler_t)(MessageBuffer*);
 
+/* Completion callback of an asynchronous call.
+ * On RPC_STATUS_OK, rets is positioned at the serialized return values
+ * and is only valid during the callback. Otherwise rets is NULL.
+ * Called from rpc_run() or while waiting for another call, so it
+ * should not issue blocking RPC calls itself. */
+typedef void (*rpc_result_cb_t)(uint16_t seq, RpcStatus status, MessageBuffer* rets, void* ctx);
+
 void          rpc_set_status(RpcStatus status);
 RpcStatus     rpc_get_status(void);
 const char*   rpc_get_status_str(RpcStatus status);
@@ -197,12 +204,38 @@ bool          rpc_recv_msg(MessageBuffer* buff, uint32_t timeout);
 RpcStatus     rpc_wait_result(uint16_t expected_seq, MessageBuffer* buff, uint32_t timeout);
 void          rpc_run(void);
 
+/* Asynchronous calls:
+ *   rpc_async_wait_slot(timeout);                  // wait for the window
+ *   if (rpc_async_begin(uid, callback, ctx, timeout, &seq)) {
+ *     ... write arguments ...
+ *     MessageWriter_end();
+ *   }
+ * rpc_async_begin() starts the invoke only once the call is tracked; it
+ * returns false without writing anything while the window is full.
+ * Results are delivered by rpc_run(), rpc_async_wait_all() or any
+ * blocking call that happens to receive them. */
+bool          rpc_async_begin(uint16_t uid, rpc_result_cb_t cb, void* ctx, uint32_t timeout, uint16_t* seq);
+bool          rpc_async_wait_slot(uint32_t timeout);
+bool          rpc_async_wait_all(uint32_t timeout);
+unsigned      rpc_async_pending(void);
+void          rpc_async_set_window(unsigned window);
+
+/* Packets sent between rpc_batch_begin() and rpc_batch_end() are
+ * queued back-to-back, with a single UART flush at the end */
+void          rpc_batch_begin(void);
+void          rpc_batch_end(void);
+
 uint32_t      rpc_system_millis(void);
 int           rpc_uart_available(void);
 int           rpc_uart_read(void);
 size_t        rpc_uart_write(uint8_t data);
 void          rpc_uart_flush(void);
 
+/* Optional bulk transfers, the weak defaults use the byte-wise functions.
+ * rpc_uart_read_buf must not block: it returns what is already received. */
+size_t        rpc_uart_write_buf(const uint8_t* data, size_t len);
+size_t        rpc_uart_read_buf(uint8_t* data, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,6 +1,7 @@
 #ifndef BLYNK_RPC_CRC8_H
 #define BLYNK_RPC_CRC8_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include "BlynkRpcConfig.h"
 
@@ -27,6 +28,8 @@ void rpc_crc8_update(uint8_t* crc, uint8_t data) {
 #endif
 }
 
+void rpc_crc8_update_block(uint8_t* crc, const uint8_t* data, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,6 +15,14 @@
   #define RPC_INPUT_BUFFER        2048
 #endif
 
+#if defined(RPC_ASYNC_MAX_PENDING)
+  // Use the specified value
+#elif defined(__AVR_ATmega328P__) || defined(__AVR_ATmega32U4__)
+  #define RPC_ASYNC_MAX_PENDING   2
+#else
+  #define RPC_ASYNC_MAX_PENDING   8
+#endif
+
 #if defined(RPC_ENABLE_SMALL_CRC8)
   // Use the specified value
 #elif defined(__AVR_ATmega328P__) || defined(__AVR_ATmega32U4__)
@@ -23,5 +31,25 @@
   #define RPC_ENABLE_SMALL_CRC8   0
 #endif
 
+/* Bytes per step of the bulk CRC8: 1, 4 (+768 bytes of tables) or 8 (+1792 bytes).
+ * The tables are plain const arrays, which AVR keeps in RAM, so AVR
+ * defaults to 1 */
+#if RPC_ENABLE_SMALL_CRC8
+  #undef  RPC_CRC8_SLICES
+  #define RPC_CRC8_SLICES         1
+#elif defined(RPC_CRC8_SLICES)
+  // Use the specified value
+#elif defined(__AVR__)
+  #define RPC_CRC8_SLICES         1
+#elif defined(LINUX) || defined(ESP32)
+  #define RPC_CRC8_SLICES         8
+#else
+  #define RPC_CRC8_SLICES         4
+#endif
+
+#if RPC_CRC8_SLICES != 1 && RPC_CRC8_SLICES != 4 && RPC_CRC8_SLICES != 8
+  #error "RPC_CRC8_SLICES must be 1, 4 or 8"
+#endif
+
 #endif /* BLYNK_RPC_CONFIG_H */
 
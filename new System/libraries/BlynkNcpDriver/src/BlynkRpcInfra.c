@@ -1,5 +1,6 @@
 
 #include "BlynkRpc.h"
+#include "BlynkRpcUartFraming.h"
 
 static RpcStatus _rpc_status;
 static uint16_t  _rpc_seq_id;
@@ -8,6 +9,22 @@ static uint32_t _rpc_timeout_override = 0;
 uint32_t _rpc_last_rx_time = 0;
 uint32_t _rpc_last_tx_time = 0;
 
+typedef struct {
+  rpc_result_cb_t cb;
+  void*           ctx;
+  uint32_t        start;
+  uint32_t        timeout;
+  uint16_t        seq;
+  bool            used;
+} RpcPendingCall;
+
+/* Open addressing on seq id: ids are sequential, so a lookup
+ * normally hits the first probed slot */
+static RpcPendingCall _rpc_pending[RPC_ASYNC_MAX_PENDING];
+static unsigned       _rpc_pending_count;
+static unsigned       _rpc_window = RPC_ASYNC_MAX_PENDING;
+static uint8_t        _rpc_batch_depth;
+
 RpcStatus rpc_get_status(void) {
   return _rpc_status;
 }
@@ -47,6 +64,70 @@ const char* rpc_get_status_str(RpcStatus status) {
   return "unknown";
 }
 
+static
+RpcPendingCall* rpc_async_find(uint16_t seq)
+{
+  for (unsigned i = 0; i < RPC_ASYNC_MAX_PENDING; i++) {
+    RpcPendingCall* call = &_rpc_pending[(seq + i) % RPC_ASYNC_MAX_PENDING];
+    if (call->used && call->seq == seq) {
+      return call;
+    }
+  }
+  return NULL;
+}
+
+static
+bool rpc_async_complete(uint16_t seq, RpcStatus status, MessageBuffer* rets)
+{
+  RpcPendingCall* call = rpc_async_find(seq);
+  if (!call) {
+    return false;
+  }
+  /* Free the slot first, the callback may start a new call */
+  rpc_result_cb_t cb = call->cb;
+  void* ctx = call->ctx;
+  call->used = false;
+  _rpc_pending_count--;
+
+  if (cb) {
+    cb(seq, status, (status == RPC_STATUS_OK) ? rets : NULL, ctx);
+  }
+  return true;
+}
+
+static
+void rpc_async_expire(void)
+{
+  if (!_rpc_pending_count) {
+    return;
+  }
+  const uint32_t now = rpc_system_millis();
+  for (unsigned i = 0; i < RPC_ASYNC_MAX_PENDING; i++) {
+    RpcPendingCall* call = &_rpc_pending[i];
+    if (call->used && now - call->start >= call->timeout) {
+      rpc_async_complete(call->seq, RPC_STATUS_ERROR_TIMEOUT, NULL);
+    }
+  }
+}
+
+/* Time until the earliest pending call expires, capped at limit */
+static
+uint32_t rpc_async_time_left(uint32_t limit)
+{
+  const uint32_t now = rpc_system_millis();
+  for (unsigned i = 0; i < RPC_ASYNC_MAX_PENDING; i++) {
+    const RpcPendingCall* call = &_rpc_pending[i];
+    if (call->used) {
+      const uint32_t elapsed = now - call->start;
+      const uint32_t left = (call->timeout > elapsed) ? (call->timeout - elapsed) : 0;
+      if (left < limit) {
+        limit = left;
+      }
+    }
+  }
+  return limit;
+}
+
 static
 bool rpc_handle_msg(MessageBuffer* buff)
 {
@@ -56,6 +137,12 @@ bool rpc_handle_msg(MessageBuffer* buff)
       uint16_t id;
       MessageBuffer_readUInt16(buff, &id);
       rpc_invoke_handler(id, buff);
+  } else if (op == RPC_OP_RESULT) {
+      uint16_t seq = 0;
+      uint8_t status = RPC_STATUS_ERROR_GENERIC;
+      MessageBuffer_readUInt16(buff, &seq);
+      MessageBuffer_readUInt8(buff, &status);
+      return rpc_async_complete(seq, (RpcStatus)status, buff);
   } else {
       return false;
   }
@@ -63,6 +150,101 @@ bool rpc_handle_msg(MessageBuffer* buff)
   return true;
 }
 
+/* Receive and dispatch at most one message */
+static
+void rpc_async_poll(uint32_t timeout)
+{
+  MessageBuffer buff;
+  MessageBuffer_init(&buff, NULL, 0);
+  if (rpc_recv_msg(&buff, rpc_async_time_left(timeout))) {
+    _rpc_last_rx_time = rpc_system_millis();
+    rpc_handle_msg(&buff);
+  }
+  rpc_async_expire();
+}
+
+bool rpc_async_begin(uint16_t uid, rpc_result_cb_t cb, void* ctx, uint32_t timeout, uint16_t* seq)
+{
+  if (_rpc_timeout_override) {
+    timeout = _rpc_timeout_override;
+  }
+  /* Refuse before anything is written: a call on the wire is always
+   * tracked, so its result can't be lost */
+  if (_rpc_pending_count >= _rpc_window) {
+    return false;
+  }
+  const uint16_t id = MessageWriter_beginInvoke(uid);
+  /* count < window <= size, so a slot is free */
+  for (unsigned i = 0; i < RPC_ASYNC_MAX_PENDING; i++) {
+    RpcPendingCall* call = &_rpc_pending[(id + i) % RPC_ASYNC_MAX_PENDING];
+    if (!call->used) {
+      call->cb = cb;
+      call->ctx = ctx;
+      call->start = rpc_system_millis();
+      call->timeout = timeout;
+      call->seq = id;
+      call->used = true;
+      _rpc_pending_count++;
+      break;
+    }
+  }
+  if (seq) {
+    *seq = id;
+  }
+  return true;
+}
+
+bool rpc_async_wait_slot(uint32_t timeout)
+{
+  const uint32_t tstart = rpc_system_millis();
+  while (_rpc_pending_count >= _rpc_window) {
+    const uint32_t elapsed = rpc_system_millis() - tstart;
+    if (elapsed >= timeout) {
+      return false;
+    }
+    rpc_async_poll(timeout - elapsed);
+  }
+  return true;
+}
+
+bool rpc_async_wait_all(uint32_t timeout)
+{
+  const uint32_t tstart = rpc_system_millis();
+  while (_rpc_pending_count) {
+    const uint32_t elapsed = rpc_system_millis() - tstart;
+    if (elapsed >= timeout) {
+      return false;
+    }
+    rpc_async_poll(timeout - elapsed);
+  }
+  return true;
+}
+
+unsigned rpc_async_pending(void) {
+  return _rpc_pending_count;
+}
+
+void rpc_async_set_window(unsigned window) {
+  if (window < 1) {
+    window = 1;
+  } else if (window > RPC_ASYNC_MAX_PENDING) {
+    window = RPC_ASYNC_MAX_PENDING;
+  }
+  _rpc_window = window;
+}
+
+void rpc_batch_begin(void) {
+  if (_rpc_batch_depth++ == 0) {
+    RpcUartFraming_holdFlush(true);
+  }
+}
+
+void rpc_batch_end(void) {
+  if (_rpc_batch_depth && --_rpc_batch_depth == 0) {
+    RpcUartFraming_holdFlush(false);
+  }
+}
+
 RpcStatus rpc_wait_result(uint16_t expected_seq, MessageBuffer* buff, uint32_t timeout)
 {
   if (_rpc_timeout_override) {
@@ -84,15 +266,14 @@ RpcStatus rpc_wait_result(uint16_t expected_seq, MessageBuffer* buff, uint32_t t
       if (seq == expected_seq) {
         MessageBuffer_readUInt8(buff, &status);
         break;
-      } else {
-        // not our reply => skip it
-        continue;
       }
+      // not our reply => may complete an async call
     }
     // process unexpected messages
     MessageBuffer_rewind(buff);
     rpc_handle_msg(buff);
   }
+  rpc_async_expire();
   return (RpcStatus)status;
 }
 
@@ -103,4 +284,5 @@ void rpc_run(void) {
     _rpc_last_rx_time = rpc_system_millis();
     rpc_handle_msg(&buff);
   }
+  rpc_async_expire();
 }
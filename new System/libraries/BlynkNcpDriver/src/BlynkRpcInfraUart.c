@@ -3,26 +3,21 @@
 #include "BlynkRpcUartFraming.h"
 
 static uint8_t  inputData[RPC_INPUT_BUFFER];
-static unsigned inputDataLen;
+static size_t   inputDataLen;
 
 bool rpc_recv_msg(MessageBuffer* buff, uint32_t timeout)
 {
   MessageBuffer_reset(buff);
   const uint32_t tstart = rpc_system_millis();
   do {
-    while (RpcUartFraming_available()) {
-      // TODO: boundary check
-      inputData[inputDataLen++] = RpcUartFraming_read();
-    }
-
-    if (RpcUartFraming_finishedPacket()) {
-      unsigned packetSize = inputDataLen;
+    if (RpcUartFraming_receivePacket(inputData, sizeof(inputData), &inputDataLen)) {
+      const size_t packetSize = inputDataLen;
       inputDataLen = 0;
 
       //TRACE_HEX(">>", inputData, packetSize);
-      if (RpcUartFraming_checkPacketCRC()) {
+      if (RpcUartFraming_checkCRC(inputData, packetSize)) {
         MessageBuffer_setBuffer(buff, inputData, sizeof(inputData));
-        MessageBuffer_setWritten(buff, packetSize);
+        MessageBuffer_setWritten(buff, packetSize - 1);
         return true;
       } else {
         //LOG("NCP message CRC error");
@@ -29,14 +29,46 @@ typedef struct {
 
 typedef struct {
   RpcUartInputBuffer  buffer;
+  uint8_t   rx[64];     /* raw input of the bulk receive path */
+  uint8_t   rxPos;
+  uint8_t   rxLen;
   uint8_t   state;
   uint8_t   rcrc;
   uint8_t   wcrc;
   bool      escapeXonXoff;
+  bool      holdFlush;
+  bool      unflushed;
 } RpcUartFraming;
 
 static RpcUartFraming _self;
 
+/* Non-zero if any byte of w equals b */
+static inline
+uint32_t rpc_has_byte(uint32_t w, uint8_t b) {
+  w ^= 0x01010101UL * b;
+  return (w - 0x01010101UL) & ~w & 0x80808080UL;
+}
+
+RPC_ATTR_WEAK
+size_t rpc_uart_write_buf(const uint8_t* data, size_t len) {
+  size_t n = 0;
+  while (n < len && rpc_uart_write(data[n])) {
+    n++;
+  }
+  return n;
+}
+
+RPC_ATTR_WEAK
+size_t rpc_uart_read_buf(uint8_t* data, size_t len) {
+  size_t n = 0;
+  while (n < len && rpc_uart_available()) {
+    int c = rpc_uart_read();
+    if (c < 0) break;
+    data[n++] = (uint8_t)c;
+  }
+  return n;
+}
+
 void RpcUartFraming_init(void) {
   memset(&_self, 0, sizeof(_self));
   _self.state = STATE_BEG;
@@ -88,12 +120,48 @@ void RpcUartFraming_processInput(void) {
   }
 }
 
+static inline
+bool RpcUartFraming_needsEscape(uint8_t data) {
+  return data == BEG || data == END || data == ESC ||
+         (_self.escapeXonXoff && (data == XON || data == XOFF));
+}
+
+/* Length of the leading run that can be sent without escaping,
+ * checked a word at a time */
+static
+size_t RpcUartFraming_cleanRun(const uint8_t* data, size_t size) {
+  size_t n = 0;
+  for (; n + 4 <= size; n += 4) {
+    uint32_t w;
+    memcpy(&w, data + n, sizeof(w));
+    if (rpc_has_byte(w, BEG) | rpc_has_byte(w, END) | rpc_has_byte(w, ESC)) break;
+    if (_self.escapeXonXoff && (rpc_has_byte(w, XON) | rpc_has_byte(w, XOFF))) break;
+  }
+  while (n < size && !RpcUartFraming_needsEscape(data[n])) {
+    n++;
+  }
+  return n;
+}
+
+/* Length of the leading run of received packet data, up to ESC or END */
+static
+size_t RpcUartFraming_dataRun(const uint8_t* data, size_t size) {
+  size_t n = 0;
+  for (; n + 4 <= size; n += 4) {
+    uint32_t w;
+    memcpy(&w, data + n, sizeof(w));
+    if (rpc_has_byte(w, ESC) | rpc_has_byte(w, END)) break;
+  }
+  while (n < size && data[n] != ESC && data[n] != END) {
+    n++;
+  }
+  return n;
+}
+
 static
 size_t RpcUartFraming_writeByte(uint8_t data) {
   rpc_crc8_update(&_self.wcrc, data);
-  if (data == BEG || data == END || data == ESC ||
-      (_self.escapeXonXoff && (data == XON || data == XOFF))
-  ) {
+  if (RpcUartFraming_needsEscape(data)) {
     rpc_uart_write(ESC);
     data ^= 0xFF;
   }
@@ -109,7 +177,21 @@ void RpcUartFraming_beginPacket(void) {
 void RpcUartFraming_endPacket(void) {
   RpcUartFraming_writeByte(_self.wcrc);
   rpc_uart_write(END);
-  rpc_uart_flush();
+  if (_self.holdFlush) {
+    _self.unflushed = true;
+  } else {
+    rpc_uart_flush();
+  }
+}
+
+/* While held, packets are queued back-to-back in the UART TX buffer
+ * and the blocking flush is done once, when the hold is released */
+void RpcUartFraming_holdFlush(bool hold) {
+  _self.holdFlush = hold;
+  if (!hold && _self.unflushed) {
+    _self.unflushed = false;
+    rpc_uart_flush();
+  }
 }
 
 bool RpcUartFraming_finishedPacket(void) {
@@ -129,13 +211,89 @@ bool RpcUartFraming_checkPacketCRC(void) {
 
 size_t RpcUartFraming_write(const uint8_t *buffer, size_t size) {
   size_t n = 0;
-  while (size--) {
-    if (RpcUartFraming_writeByte(*buffer++)) n++;
-    else break;
+  while (n < size) {
+    const size_t run = RpcUartFraming_cleanRun(buffer + n, size - n);
+    if (run) {
+      const size_t written = rpc_uart_write_buf(buffer + n, run);
+      rpc_crc8_update_block(&_self.wcrc, buffer + n, written);
+      n += written;
+      if (written < run) break;
+    } else if (RpcUartFraming_writeByte(buffer[n])) {
+      n++;
+    } else {
+      break;
+    }
   }
   return n;
 }
 
+bool RpcUartFraming_receivePacket(uint8_t* buf, size_t size, size_t* len) {
+  for (;;) {
+    if (_self.rxPos == _self.rxLen) {
+      _self.rxPos = 0;
+      _self.rxLen = (uint8_t)rpc_uart_read_buf(_self.rx, sizeof(_self.rx));
+      if (!_self.rxLen) {
+        return false;
+      }
+    }
+    const uint8_t* in = _self.rx + _self.rxPos;
+    const size_t avail = _self.rxLen - _self.rxPos;
+
+    switch (_self.state) {
+      case STATE_BEG:
+      case STATE_END: {
+        const uint8_t* beg = (const uint8_t*)memchr(in, BEG, avail);
+        if (beg) {
+          _self.rxPos += (uint8_t)(beg - in + 1);
+          _self.state = STATE_DATA;
+          *len = 0;
+        } else {
+          _self.rxPos = _self.rxLen;
+        }
+        break;
+      }
+      case STATE_DATA: {
+        const size_t run = RpcUartFraming_dataRun(in, avail);
+        if (run > size - *len) {
+          /* Too long => drop it and resync on the next BEG */
+          _self.state = STATE_BEG;
+          *len = 0;
+        } else if (run) {
+          memcpy(buf + *len, in, run);
+          *len += run;
+          _self.rxPos += (uint8_t)run;
+        } else if (*in == ESC) {
+          _self.rxPos++;
+          _self.state = STATE_ESC;
+        } else { /* END */
+          _self.rxPos++;
+          _self.state = STATE_BEG;
+          return true;
+        }
+        break;
+      }
+      case STATE_ESC:
+        if (*len < size) {
+          buf[(*len)++] = *in ^ 0xFF;
+          _self.state = STATE_DATA;
+        } else {
+          _self.state = STATE_BEG;
+          *len = 0;
+        }
+        _self.rxPos++;
+        break;
+    }
+  }
+}
+
+bool RpcUartFraming_checkCRC(const uint8_t* packet, size_t len) {
+  if (!len) { return false; }
+  uint8_t crc;
+  rpc_crc8_reset(&crc);
+  rpc_crc8_update_block(&crc, packet, len - 1);
+  return crc == packet[len - 1];
+}
+
 int RpcUartFraming_available(void) {
   RpcUartFraming_processInput();
   return RpcUartFraming_hasPacketData() ? (_self.buffer.count - 1) : 0;
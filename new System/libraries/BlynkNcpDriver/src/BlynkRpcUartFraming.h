@@ -1,6 +1,7 @@
 #ifndef BLYNK_RPC_UART_FRAMING_H
 #define BLYNK_RPC_UART_FRAMING_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -13,6 +14,13 @@ void    RpcUartFraming_init(void);
 void    RpcUartFraming_beginPacket(void);
 size_t  RpcUartFraming_write(const uint8_t *buffer, size_t size);
 void    RpcUartFraming_endPacket(void);
+void    RpcUartFraming_holdFlush(bool hold);
+
+/* Bulk receive: decodes pending input straight into buf, *len tracks
+ * the bytes stored so far. Returns true when buf holds a complete packet
+ * (payload followed by its CRC). Do not mix with the byte-wise API below. */
+bool    RpcUartFraming_receivePacket(uint8_t* buf, size_t size, size_t* len);
+bool    RpcUartFraming_checkCRC(const uint8_t* packet, size_t len);
 
 int     RpcUartFraming_available(void);
 int     RpcUartFraming_read(void);
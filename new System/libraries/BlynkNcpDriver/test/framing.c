@@ -0,0 +1,325 @@
+/*
+ * Bit-exact equivalence of the bulk UART framing and CRC8 paths with
+ * the original byte-at-a-time implementation, plus a throughput
+ * benchmark.
+ *
+ * Build & run (from the library root), for each CRC8 configuration:
+ *   cc -std=gnu99 -O2 -I../../test -Isrc test/framing.c src/Blynk*.c src/Message*.c -o framing
+ *   cc ... -DRPC_CRC8_SLICES=4 ...
+ *   cc ... -DRPC_ENABLE_SMALL_CRC8=1 ...
+ *   ./framing          # tests
+ *   ./framing bench    # MB/s
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BlynkRpcClient.h"
+#include "BlynkRpcUartFraming.h"
+#include "BlynkRpcCRC8.h"
+#include "host_test.h"
+
+/*
+ * UART shims: output is captured, input is served in random chunks
+ */
+
+static uint8_t* tx_data;
+static size_t   tx_len, tx_cap;
+static const uint8_t* rx_data;
+static size_t   rx_len, rx_pos;
+static size_t   rx_max_chunk = 64;
+
+static void tx_put(const uint8_t* data, size_t len) {
+  if (tx_len + len > tx_cap) {
+    tx_cap = (tx_len + len) * 2;
+    tx_data = (uint8_t*)realloc(tx_data, tx_cap);
+  }
+  memcpy(tx_data + tx_len, data, len);
+  tx_len += len;
+}
+
+size_t rpc_uart_write(uint8_t data) {
+  tx_put(&data, 1);
+  return 1;
+}
+
+size_t rpc_uart_write_buf(const uint8_t* data, size_t len) {
+  tx_put(data, len);
+  return len;
+}
+
+int rpc_uart_available(void) {
+  return (int)(rx_len - rx_pos);
+}
+
+int rpc_uart_read(void) {
+  return (rx_pos < rx_len) ? rx_data[rx_pos++] : -1;
+}
+
+size_t rpc_uart_read_buf(uint8_t* data, size_t len) {
+  size_t n = 1 + (size_t)rand() % rx_max_chunk;
+  if (n > len) n = len;
+  if (n > rx_len - rx_pos) n = rx_len - rx_pos;
+  memcpy(data, rx_data + rx_pos, n);
+  rx_pos += n;
+  return n;
+}
+
+void rpc_uart_flush(void) {
+}
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+uint32_t rpc_system_millis(void) {
+  return (uint32_t)(now_s() * 1000);
+}
+
+/*
+ * Reference: the original per-byte framing, and a bitwise CRC8 to
+ * check the table driven ones against
+ */
+
+static uint8_t ref_crc8(uint8_t crc, const uint8_t* data, size_t len) {
+  while (len--) {
+    crc ^= *data++;
+    for (int i = 0; i < 8; i++) {
+      crc = (uint8_t)((crc << 1) ^ ((crc & 0x80) ? 0x07 : 0));
+    }
+  }
+  return crc;
+}
+
+static void ref_put_escaped(uint8_t data) {
+  if (data == 0xAA || data == 0xBB || data == 0xCC || data == 0x11 || data == 0x13) {
+    rpc_uart_write(0xCC);
+    data ^= 0xFF;
+  }
+  rpc_uart_write(data);
+}
+
+static void ref_encode(const uint8_t* data, size_t len) {
+  uint8_t crc = 0;
+  rpc_uart_write(0xAA);
+  for (size_t i = 0; i < len; i++) {
+    rpc_crc8_update(&crc, data[i]);
+    ref_put_escaped(data[i]);
+  }
+  ref_put_escaped(crc);
+  rpc_uart_write(0xBB);
+}
+
+static void new_encode(const uint8_t* data, size_t len) {
+  RpcUartFraming_beginPacket();
+  RpcUartFraming_write(data, len);
+  RpcUartFraming_endPacket();
+}
+
+/* Random payload where roughly one byte in `special` needs escaping */
+static void fill_random(uint8_t* data, size_t len, int special) {
+  static const uint8_t specials[] = { 0xAA, 0xBB, 0xCC, 0x11, 0x13 };
+  for (size_t i = 0; i < len; i++) {
+    if (special && rand() % special == 0) {
+      data[i] = specials[rand() % sizeof(specials)];
+    } else {
+      do { data[i] = (uint8_t)rand(); } while (
+        data[i] == 0xAA || data[i] == 0xBB || data[i] == 0xCC || data[i] == 0x11 || data[i] == 0x13);
+    }
+  }
+}
+
+static void test_crc8(void) {
+  uint8_t data[300 + 8];
+  int mismatches = 0;
+  printf("crc8 block == bitwise (slices: %d)\n", RPC_CRC8_SLICES);
+
+  fill_random(data, sizeof(data), 0);
+  for (size_t offset = 0; offset < 8; offset++) {
+    for (size_t len = 0; len <= 300; len++) {
+      for (uint8_t init = 0; init < 4; init++) {
+        uint8_t crc = init;
+        rpc_crc8_update_block(&crc, data + offset, len);
+        if (crc != ref_crc8(init, data + offset, len)) mismatches++;
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+}
+
+static void test_encoder(void) {
+  static uint8_t payload[600];
+  int mismatches = 0;
+  printf("encoder output == per-byte reference\n");
+
+  for (int iter = 0; iter < 2000; iter++) {
+    size_t len = (size_t)rand() % sizeof(payload);
+    int special = (iter % 4 == 0) ? 0 : 1 + rand() % 64;
+    fill_random(payload, len, special);
+
+    tx_len = 0;
+    ref_encode(payload, len);
+    size_t ref_len = tx_len;
+    uint8_t* ref = (uint8_t*)malloc(ref_len);
+    memcpy(ref, tx_data, ref_len);
+
+    /* Also split the payload across several write() calls */
+    tx_len = 0;
+    RpcUartFraming_beginPacket();
+    size_t pos = 0;
+    while (pos < len) {
+      size_t n = 1 + (size_t)rand() % 40;
+      if (n > len - pos) n = len - pos;
+      RpcUartFraming_write(payload + pos, n);
+      pos += n;
+    }
+    RpcUartFraming_endPacket();
+
+    if (tx_len != ref_len || memcmp(tx_data, ref, ref_len)) mismatches++;
+    free(ref);
+  }
+  CHECK(mismatches == 0);
+}
+
+static void test_decoder(void) {
+  enum { COUNT = 300 };
+  static uint8_t payloads[COUNT][600];
+  static size_t lengths[COUNT];
+  printf("decoder round trip, CRC errors and oversized packets\n");
+
+  tx_len = 0;
+  for (int i = 0; i < COUNT; i++) {
+    lengths[i] = (size_t)rand() % sizeof(payloads[i]);
+    fill_random(payloads[i], lengths[i], 1 + rand() % 32);
+    if (i % 7 == 0) {
+      uint8_t noise[] = { 0x00, 0xBB, 0x42, 0xCC };  /* junk between packets */
+      tx_put(noise, sizeof(noise));
+    }
+    ref_encode(payloads[i], lengths[i]);
+    if (i % 50 == 25) {
+      tx_data[tx_len - 3] ^= 0x01;  /* corrupt: must be rejected */
+    }
+  }
+  /* Too long for the input buffer, then a valid one */
+  static uint8_t big[RPC_INPUT_BUFFER + 10];
+  fill_random(big, sizeof(big), 16);
+  ref_encode(big, sizeof(big));
+  ref_encode(payloads[0], lengths[0]);
+
+  rx_data = tx_data;
+  rx_len = tx_len;
+  rx_pos = 0;
+
+  int received = 0, mismatches = 0;
+  int expected = 0;
+  MessageBuffer buff;
+  MessageBuffer_init(&buff, NULL, 0);
+  int idle = 0;
+  while (idle < 4) {
+    /* A rejected packet also returns false, keep going until input runs dry */
+    if (!rpc_recv_msg(&buff, 0)) {
+      if (rx_pos == rx_len) idle++;
+      continue;
+    }
+    while (expected % 50 == 25) expected++;  /* corrupted ones are skipped */
+    const int index = (expected < COUNT) ? expected : 0;
+    const size_t len = MessageBuffer_getWritten(&buff);
+    if (len != lengths[index] || memcmp(MessageBuffer_getBuffer(&buff), payloads[index], len)) {
+      mismatches++;
+    }
+    received++;
+    expected++;
+  }
+  CHECK(mismatches == 0);
+  CHECK(received == COUNT - COUNT / 50 + 1);
+  CHECK(rx_pos == rx_len);
+}
+
+/*
+ * Benchmark
+ */
+
+static void bench(void) {
+  enum { LEN = 1024, ROUNDS = 4000 };
+  static uint8_t payload[LEN];
+  double t;
+
+  printf("CRC8 (slices: %d)\n", RPC_CRC8_SLICES);
+  fill_random(payload, LEN, 0);
+  volatile uint8_t sink = 0;
+  t = now_s();
+  for (int r = 0; r < ROUNDS; r++) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < LEN; i++) rpc_crc8_update(&crc, payload[i]);
+    sink ^= crc;
+  }
+  printf("  byte-wise:  %7.1f MB/s\n", LEN * ROUNDS / (now_s() - t) / 1e6);
+  t = now_s();
+  for (int r = 0; r < ROUNDS; r++) {
+    uint8_t crc = 0;
+    rpc_crc8_update_block(&crc, payload, LEN);
+    sink ^= crc;
+  }
+  printf("  block:      %7.1f MB/s\n", LEN * ROUNDS / (now_s() - t) / 1e6);
+
+  static const int specials[] = { 0, 256, 32 };
+  for (unsigned k = 0; k < sizeof(specials) / sizeof(specials[0]); k++) {
+    fill_random(payload, LEN, specials[k]);
+    if (specials[k]) {
+      printf("Framing, 1 in %d bytes escaped\n", specials[k]);
+    } else {
+      printf("Framing, no escapes\n");
+    }
+
+    t = now_s();
+    for (int r = 0; r < ROUNDS; r++) { tx_len = 0; ref_encode(payload, LEN); }
+    printf("  encode, per-byte:  %7.1f MB/s\n", LEN * ROUNDS / (now_s() - t) / 1e6);
+    t = now_s();
+    for (int r = 0; r < ROUNDS; r++) { tx_len = 0; new_encode(payload, LEN); }
+    printf("  encode, bulk:      %7.1f MB/s\n", LEN * ROUNDS / (now_s() - t) / 1e6);
+
+    /* Decode the same frame repeatedly */
+    MessageBuffer buff;
+    MessageBuffer_init(&buff, NULL, 0);
+    rx_data = tx_data;
+    rx_len = tx_len;
+    rx_max_chunk = 64;
+    t = now_s();
+    for (int r = 0; r < ROUNDS; r++) {
+      rx_pos = 0;
+      RpcUartFraming_init();
+      while (!RpcUartFraming_finishedPacket() && RpcUartFraming_available()) {
+        while (RpcUartFraming_available()) RpcUartFraming_read();
+      }
+      RpcUartFraming_checkPacketCRC();
+    }
+    printf("  decode, per-byte:  %7.1f MB/s\n", LEN * ROUNDS / (now_s() - t) / 1e6);
+    t = now_s();
+    for (int r = 0; r < ROUNDS; r++) {
+      rx_pos = 0;
+      rpc_recv_msg(&buff, 0);
+    }
+    printf("  decode, bulk:      %7.1f MB/s\n", LEN * ROUNDS / (now_s() - t) / 1e6);
+  }
+  (void)sink;
+}
+
+int main(int argc, char* argv[]) {
+  srand(1);
+  RpcUartFraming_init();
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    bench();
+    return 0;
+  }
+
+  test_crc8();
+  test_encoder();
+  test_decoder();
+
+  return test_summary();
+}
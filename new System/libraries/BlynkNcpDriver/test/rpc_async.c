@@ -0,0 +1,448 @@
+/*
+ * Host test for asynchronous RPC calls over a PTY pair.
+ *
+ * The MCU side is this process, the NCP side is a forked emulator that
+ * echoes RPC_UID_NCP_PING, reports the number of oneway messages it
+ * received on RPC_UID_NCP_HASUID and never answers RPC_UID_NCP_REBOOT.
+ *
+ * Both sides pace their output like a UART at the selected baud rate:
+ * each byte reaches the PTY only once it would have left the wire,
+ * writes block once the TX FIFO is full and flush() waits until the
+ * last byte is out.
+ *
+ * Build & run (from the library root):
+ *   cc -std=gnu99 -O2 -I../../test -Isrc test/rpc_async.c src/Blynk*.c src/Message*.c \
+ *      -lutil -o rpc_async
+ *   ./rpc_async          # tests
+ *   ./rpc_async bench    # calls/s at 115200 and 2M baud
+ */
+
+#define _GNU_SOURCE
+
+#include <pty.h>
+#include <poll.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/wait.h>
+
+#include "BlynkRpcClient.h"
+#include "BlynkRpcUartFraming.h"
+#include "host_test.h"
+
+#define TX_FIFO_SIZE 128
+
+static int      uart_fd = -1;
+static uint64_t uart_byte_ns;
+static uint64_t uart_tx_free_at;
+static uint8_t  uart_tx[TX_FIFO_SIZE];
+static unsigned uart_tx_head, uart_tx_count;
+static uint8_t  uart_rx[256];
+static int      uart_rx_pos, uart_rx_len;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t t) {
+  uint64_t now = now_ns();
+  if (t > now) {
+    struct timespec ts = { (time_t)((t - now) / 1000000000ull), (long)((t - now) % 1000000000ull) };
+    nanosleep(&ts, NULL);
+  }
+}
+
+uint32_t rpc_system_millis(void) {
+  return (uint32_t)(now_ns() / 1000000ull);
+}
+
+/* Hand over every byte whose transmission has completed */
+static void uart_pump(void) {
+  const uint64_t now = now_ns();
+  unsigned sent = 0;
+  while (sent < uart_tx_count &&
+         uart_tx_free_at - (uart_tx_count - sent - 1) * uart_byte_ns <= now) {
+    sent++;
+  }
+  while (sent) {
+    unsigned chunk = TX_FIFO_SIZE - uart_tx_head;
+    if (chunk > sent) chunk = sent;
+    if (write(uart_fd, uart_tx + uart_tx_head, chunk) != (ssize_t)chunk) {
+      perror("write");
+      exit(1);
+    }
+    uart_tx_head = (uart_tx_head + chunk) % TX_FIFO_SIZE;
+    uart_tx_count -= chunk;
+    sent -= chunk;
+  }
+}
+
+int rpc_uart_available(void) {
+  uart_pump();
+  if (uart_rx_pos < uart_rx_len) {
+    return uart_rx_len - uart_rx_pos;
+  }
+  /* Nothing buffered: sleep until input arrives or the next TX byte is
+   * due, like yield() in the Arduino shim. Busy polling would starve
+   * the other side on a single core host. */
+  uint64_t wait = 1000000;
+  if (uart_tx_count) {
+    const uint64_t due = uart_tx_free_at - (uart_tx_count - 1) * uart_byte_ns;
+    const uint64_t now = now_ns();
+    wait = (due > now) ? (due - now) : 0;
+  }
+  struct timespec ts = { 0, (long)wait };
+  struct pollfd pfd = { uart_fd, POLLIN, 0 };
+  if (ppoll(&pfd, 1, &ts, NULL) > 0) {
+    ssize_t n = read(uart_fd, uart_rx, sizeof(uart_rx));
+    if (n > 0) {
+      uart_rx_pos = 0;
+      uart_rx_len = (int)n;
+      return uart_rx_len;
+    }
+  }
+  return 0;
+}
+
+int rpc_uart_read(void) {
+  if (!rpc_uart_available()) {
+    return -1;
+  }
+  return uart_rx[uart_rx_pos++];
+}
+
+size_t rpc_uart_write(uint8_t data) {
+  uart_pump();
+  /* FIFO full => block like HardwareSerial::write() */
+  if (uart_tx_count == TX_FIFO_SIZE) {
+    sleep_until(uart_tx_free_at - (TX_FIFO_SIZE - 1) * uart_byte_ns);
+    uart_pump();
+  }
+  const uint64_t now = now_ns();
+  if (uart_tx_free_at < now) {
+    uart_tx_free_at = now;
+  }
+  uart_tx_free_at += uart_byte_ns;
+  uart_tx[(uart_tx_head + uart_tx_count++) % TX_FIFO_SIZE] = data;
+  return 1;
+}
+
+void rpc_uart_flush(void) {
+  sleep_until(uart_tx_free_at);
+  uart_pump();
+}
+
+static void uart_open(int fd, uint32_t baud) {
+  uart_fd = fd;
+  uart_byte_ns = 10ull * 1000000000ull / baud;  /* 8N1 */
+  uart_tx_free_at = 0;
+  uart_tx_head = uart_tx_count = 0;
+  uart_rx_pos = uart_rx_len = 0;
+  RpcUartFraming_init();
+}
+
+/*
+ * NCP emulator
+ */
+
+static void ncp_emulator(void) {
+  MessageBuffer buff;
+  uint32_t oneway = 0;
+  MessageBuffer_init(&buff, NULL, 0);
+  for (;;) {
+    if (!rpc_recv_msg(&buff, 1000)) continue;
+
+    uint16_t op = 0, uid = 0, seq = 0;
+    MessageBuffer_readUInt16(&buff, &op);
+    MessageBuffer_readUInt16(&buff, &uid);
+    if (op == RPC_OP_ONEWAY) {
+      oneway++;
+      continue;
+    }
+    if (op != RPC_OP_INVOKE) continue;
+    MessageBuffer_readUInt16(&buff, &seq);
+
+    if (uid == RPC_UID_NCP_PING) {
+      uint32_t value = 0;
+      MessageBuffer_readUInt32(&buff, &value);
+      MessageWriter_beginResult(seq, RPC_STATUS_OK);
+      MessageWriter_writeUInt32(value);
+      MessageWriter_end();
+    } else if (uid == RPC_UID_NCP_HASUID) {
+      MessageWriter_beginResult(seq, RPC_STATUS_OK);
+      MessageWriter_writeUInt32(oneway);
+      MessageWriter_end();
+    }
+    /* RPC_UID_NCP_REBOOT: request is lost */
+  }
+}
+
+static pid_t ncp_pid;
+
+static void ncp_start(uint32_t baud) {
+  int master, slave;
+  struct termios tio;
+  if (openpty(&master, &slave, NULL, NULL, NULL) < 0) {
+    perror("openpty");
+    exit(1);
+  }
+  tcgetattr(slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+
+  ncp_pid = fork();
+  if (ncp_pid == 0) {
+    close(slave);
+    uart_open(master, baud);
+    ncp_emulator();
+    _exit(0);
+  }
+  close(master);
+  uart_open(slave, baud);
+}
+
+static void ncp_stop(void) {
+  kill(ncp_pid, SIGTERM);
+  waitpid(ncp_pid, NULL, 0);
+  close(uart_fd);
+}
+
+/*
+ * MCU side helpers
+ */
+
+static RpcStatus sync_call(uint16_t uid, uint32_t arg, uint32_t* ret) {
+  const uint16_t seq = MessageWriter_beginInvoke(uid);
+  MessageWriter_writeUInt32(arg);
+  MessageWriter_end();
+
+  MessageBuffer rsp;
+  MessageBuffer_init(&rsp, NULL, 0);
+  RpcStatus status = rpc_wait_result(seq, &rsp, RPC_TIMEOUT_DEFAULT);
+  if (status == RPC_STATUS_OK) {
+    MessageBuffer_readUInt32(&rsp, ret);
+  }
+  return status;
+}
+
+typedef struct {
+  unsigned  completed;
+  unsigned  errors;
+  unsigned  timeouts;
+  uint32_t  next_expected;
+  bool      in_order;
+} Results;
+
+static void on_ping(uint16_t seq, RpcStatus status, MessageBuffer* rets, void* ctx) {
+  Results* r = (Results*)ctx;
+  (void)seq;
+  r->completed++;
+  if (status == RPC_STATUS_ERROR_TIMEOUT) {
+    r->timeouts++;
+    return;
+  }
+  uint32_t value = 0;
+  if (status != RPC_STATUS_OK || !rets ||
+      !MessageBuffer_readUInt32(rets, &value) || MessageBuffer_availableToRead(rets)) {
+    r->errors++;
+    return;
+  }
+  if (value != r->next_expected++) {
+    r->in_order = false;
+  }
+}
+
+/* Tracked ping; false if the window was full and nothing was sent */
+static bool async_ping(uint32_t value, Results* r, uint32_t timeout) {
+  if (!rpc_async_begin(RPC_UID_NCP_PING, on_ping, r, timeout, NULL)) {
+    return false;
+  }
+  MessageWriter_writeUInt32(value);
+  MessageWriter_end();
+  return true;
+}
+
+static void test_sync_call(void) {
+  uint32_t ret = 0;
+  printf("sync call\n");
+  CHECK(sync_call(RPC_UID_NCP_PING, 1234, &ret) == RPC_STATUS_OK);
+  CHECK(ret == 1234);
+}
+
+static void test_pipelined_calls(void) {
+  Results r = { 0, 0, 0, 0, true };
+  unsigned max_pending = 0;
+  printf("pipelined calls with window 4\n");
+
+  rpc_async_set_window(4);
+  for (uint32_t i = 0; i < 200; i++) {
+    CHECK(rpc_async_wait_slot(RPC_TIMEOUT_DEFAULT));
+    CHECK(async_ping(i, &r, RPC_TIMEOUT_DEFAULT));
+    if (rpc_async_pending() > max_pending) {
+      max_pending = rpc_async_pending();
+    }
+  }
+  CHECK(rpc_async_wait_all(RPC_TIMEOUT_DEFAULT));
+  CHECK(r.completed == 200);
+  CHECK(r.errors == 0);
+  CHECK(r.timeouts == 0);
+  CHECK(r.in_order);
+  CHECK(max_pending <= 4);
+  CHECK(max_pending > 1);
+}
+
+static void test_timeout(void) {
+  Results r = { 0, 0, 0, 0, true };
+  printf("lost call times out\n");
+
+  rpc_async_set_window(RPC_ASYNC_MAX_PENDING);
+  CHECK(rpc_async_begin(RPC_UID_NCP_REBOOT, on_ping, &r, 100, NULL));
+  MessageWriter_end();
+
+  const uint32_t tstart = rpc_system_millis();
+  while (rpc_async_pending() && rpc_system_millis() - tstart < 1000) {
+    rpc_run();
+  }
+  CHECK(r.timeouts == 1);
+  CHECK(rpc_async_pending() == 0);
+  CHECK(rpc_system_millis() - tstart >= 90);
+}
+
+static void test_sync_while_pending(void) {
+  Results r = { 0, 0, 0, 100, true };
+  uint32_t ret = 0;
+  printf("sync call delivers pending async results\n");
+
+  async_ping(100, &r, RPC_TIMEOUT_DEFAULT);
+  async_ping(101, &r, RPC_TIMEOUT_DEFAULT);
+  CHECK(sync_call(RPC_UID_NCP_PING, 5678, &ret) == RPC_STATUS_OK);
+  CHECK(ret == 5678);
+  CHECK(r.completed == 2);
+  CHECK(r.in_order);
+  CHECK(rpc_async_pending() == 0);
+}
+
+static void test_window_full(void) {
+  Results r = { 0, 0, 0, 7, true };
+  uint16_t first = 0, second = 0;
+  printf("a call refused by a full window is not sent\n");
+
+  rpc_async_set_window(1);
+  CHECK(rpc_async_begin(RPC_UID_NCP_PING, on_ping, &r, RPC_TIMEOUT_DEFAULT, &first));
+  MessageWriter_writeUInt32(7);
+  MessageWriter_end();
+  CHECK(!rpc_async_begin(RPC_UID_NCP_PING, on_ping, &r, RPC_TIMEOUT_DEFAULT, &second));
+  CHECK(rpc_async_pending() == 1);
+
+  CHECK(rpc_async_wait_slot(RPC_TIMEOUT_DEFAULT));
+  CHECK(r.completed == 1 && r.errors == 0);
+  /* the refused call took no seq id: no invoke was started for it */
+  CHECK(rpc_async_begin(RPC_UID_NCP_PING, on_ping, &r, RPC_TIMEOUT_DEFAULT, &second));
+  MessageWriter_writeUInt32(8);
+  MessageWriter_end();
+  CHECK(second == (uint16_t)(first + 1));
+  CHECK(rpc_async_wait_all(RPC_TIMEOUT_DEFAULT));
+  CHECK(r.completed == 2 && r.errors == 0 && r.in_order);
+  rpc_async_set_window(RPC_ASYNC_MAX_PENDING);
+}
+
+static void test_oneway_batch(void) {
+  uint32_t before = 0, after = 0;
+  printf("batched oneway messages\n");
+
+  CHECK(sync_call(RPC_UID_NCP_HASUID, 0, &before) == RPC_STATUS_OK);
+  rpc_batch_begin();
+  for (int i = 0; i < 50; i++) {
+    rpc_blynk_virtualWrite(i, (buffer_t){ (uint8_t*)"123", 3 });
+  }
+  rpc_batch_begin();  /* nested */
+  rpc_blynk_syncAll();
+  rpc_batch_end();
+  rpc_batch_end();
+  CHECK(sync_call(RPC_UID_NCP_HASUID, 0, &after) == RPC_STATUS_OK);
+  CHECK(after - before == 51);
+}
+
+/*
+ * Benchmark
+ */
+
+static double elapsed_s(uint64_t tstart) {
+  return (now_ns() - tstart) / 1e9;
+}
+
+static void bench(uint32_t baud) {
+  const unsigned calls = (baud > 1000000) ? 2000 : 300;
+  uint64_t tstart;
+  uint32_t ret;
+
+  ncp_start(baud);
+  printf("%u baud\n", baud);
+
+  tstart = now_ns();
+  for (unsigned i = 0; i < calls; i++) {
+    sync_call(RPC_UID_NCP_PING, i, &ret);
+  }
+  printf("  sync calls:           %8.0f calls/s\n", calls / elapsed_s(tstart));
+
+  for (unsigned window = 2; window <= RPC_ASYNC_MAX_PENDING; window *= 2) {
+    Results r = { 0, 0, 0, 0, true };
+    rpc_async_set_window(window);
+    tstart = now_ns();
+    rpc_batch_begin();
+    for (unsigned i = 0; i < calls; i++) {
+      rpc_async_wait_slot(RPC_TIMEOUT_DEFAULT);
+      async_ping(i, &r, RPC_TIMEOUT_DEFAULT);
+    }
+    rpc_batch_end();
+    rpc_async_wait_all(RPC_TIMEOUT_DEFAULT);
+    printf("  async calls, window %u: %7.0f calls/s\n", window, calls / elapsed_s(tstart));
+  }
+
+  /* Oneway: the wire is the limit, batching frees the CPU from flush() */
+  tstart = now_ns();
+  for (unsigned i = 0; i < calls; i++) {
+    rpc_blynk_virtualWrite(1, (buffer_t){ (uint8_t*)"123", 3 });
+  }
+  double unbatched = elapsed_s(tstart);
+  tstart = now_ns();
+  rpc_batch_begin();
+  for (unsigned i = 0; i < calls; i++) {
+    rpc_blynk_virtualWrite(1, (buffer_t){ (uint8_t*)"123", 3 });
+  }
+  double queued = elapsed_s(tstart);
+  rpc_batch_end();
+  double batched = elapsed_s(tstart);
+  printf("  oneway, flush each:   %8.0f msgs/s\n", calls / unbatched);
+  printf("  oneway, batched:      %8.0f msgs/s (%.1f ms of CPU blocked in flush, was %.1f ms)\n",
+         calls / batched, (batched - queued) * 1e3, unbatched * 1e3);
+
+  ncp_stop();
+}
+
+int main(int argc, char* argv[]) {
+  signal(SIGPIPE, SIG_IGN);
+
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    bench(115200);
+    bench(2000000);
+    return 0;
+  }
+
+  ncp_start(2000000);
+  test_sync_call();
+  test_pipelined_calls();
+  test_timeout();
+  test_sync_while_pending();
+  test_window_full();
+  test_oneway_batch();
+  ncp_stop();
+
+  return test_summary();
+}
@@ -6,16 +6,26 @@
 
 #include "Arduino.h"
 
-#define printIIC(args)	Wire.write(args)
 inline size_t LiquidCrystal_I2C::write(uint8_t value) {
 	send(value, Rs);
 	return 1;
 }
 
+// print() and write() of strings land here: the whole string goes out
+// as one byte stream, split only where Wire's buffer is full
+size_t LiquidCrystal_I2C::write(const uint8_t *buffer, size_t size) {
+	if (size == 0) return 0;
+	streamBegin(Rs);
+	for (size_t i = 0; i < size; i++) {
+		streamSend(buffer[i], Rs);
+	}
+	streamEnd();
+	return size;
+}
+
 #else
 #include "WProgram.h"
 
-#define printIIC(args)	Wire.send(args)
 inline void LiquidCrystal_I2C::write(uint8_t value) {
 	send(value, Rs);
 }
@@ -45,11 +55,31 @@ inline void LiquidCrystal_I2C::write(uint8_t value) {
 // LiquidCrystal constructor is called).
 
 LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t lcd_Addr,uint8_t lcd_cols,uint8_t lcd_rows)
+  : _i2c(lcd_Addr, &Wire)
 {
   _Addr = lcd_Addr;
   _cols = lcd_cols;
   _rows = lcd_rows;
   _backlightval = LCD_NOBACKLIGHT;
+  _streamLen = 0;
+  setBusClock(LCD_I2C_DEFAULT_CLOCK);
+}
+
+void LiquidCrystal_I2C::setBusClock(uint32_t hz){
+	// A byte and its ack take 9 clocks, and the expander outputs change
+	// when the byte is acked. Pad each character with enough repeated
+	// bytes that the next enable pulse comes LCD_SETTLE_US later.
+	uint32_t khz = hz / 1000;
+	if (khz == 0) khz = 1;
+	uint32_t byteNs = 9000000UL / khz;
+	uint32_t bytes = ((uint32_t)LCD_SETTLE_US * 1000 + byteNs - 1) / byteNs;
+	_settleBytes = bytes > 255 ? 255 : bytes - 1;
+}
+
+// Every transfer after this waits its turn on the shared bus, so a page
+// redraw no longer holds off the clock or the expanders for its duration
+void LiquidCrystal_I2C::setBus(Adafruit_I2CBus *bus, uint8_t priority){
+	_i2c.setBus(bus, priority);
 }
 
 void LiquidCrystal_I2C::oled_init(){
@@ -63,7 +93,7 @@ void LiquidCrystal_I2C::init(){
 
 void LiquidCrystal_I2C::init_priv()
 {
-	Wire.begin();
+	_i2c.begin(false);
 	_displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
 	begin(_cols, _rows);  
 }
@@ -215,18 +245,22 @@ void LiquidCrystal_I2C::noAutoscroll(void) {
 void LiquidCrystal_I2C::createChar(uint8_t location, uint8_t charmap[]) {
 	location &= 0x7; // we only have 8 locations 0-7
 	command(LCD_SETCGRAMADDR | (location << 3));
+	streamBegin(Rs);
 	for (int i=0; i<8; i++) {
-		write(charmap[i]);
+		streamSend(charmap[i], Rs);
 	}
+	streamEnd();
 }
 
 //createChar with PROGMEM input
 void LiquidCrystal_I2C::createChar(uint8_t location, const char *charmap) {
 	location &= 0x7; // we only have 8 locations 0-7
 	command(LCD_SETCGRAMADDR | (location << 3));
+	streamBegin(Rs);
 	for (int i=0; i<8; i++) {
-	    	write(pgm_read_byte_near(charmap++));
+	    	streamSend(pgm_read_byte_near(charmap++), Rs);
 	}
+	streamEnd();
 }
 
 // Turn the (optional) backlight off/on
@@ -251,12 +285,48 @@ inline void LiquidCrystal_I2C::command(uint8_t value) {
 
 /************ low level data pushing commands **********/
 
-// write either command or data
+// write either command or data, in one I2C transaction
 void LiquidCrystal_I2C::send(uint8_t value, uint8_t mode) {
-	uint8_t highnib=value&0xf0;
-	uint8_t lownib=(value<<4)&0xf0;
-       write4bits((highnib)|mode);
-	write4bits((lownib)|mode); 
+	streamBegin(mode);
+	streamSend(value, mode);
+	streamEnd();
+}
+
+// Streaming: every byte written to the expander is one output state, so
+// a run of characters is a run of states in as few transactions as Wire
+// allows, gathered in _stream and written one buffer at a time. The bus clock provides the timing instead of delays: one byte
+// time (>= 9us up to 1MHz) holds En high long enough (> 450ns).
+
+// Starts a stream with RS set up before the first enable pulse
+void LiquidCrystal_I2C::streamBegin(uint8_t mode) {
+	_streamLen = 0;
+	streamByte(mode);
+}
+
+// RS stays the same within a stream, so the data lines may change in the
+// same byte that raises En: they only need to be stable when it falls
+void LiquidCrystal_I2C::streamSend(uint8_t value, uint8_t mode) {
+	uint8_t highnib=(value&0xf0)|mode;
+	uint8_t lownib=((value<<4)&0xf0)|mode;
+	streamByte(highnib | En);
+	streamByte(highnib);
+	streamByte(lownib | En);
+	streamByte(lownib);
+	for (uint8_t i = 0; i < _settleBytes; i++) {
+		streamByte(lownib);
+	}
+}
+
+void LiquidCrystal_I2C::streamByte(uint8_t _data) {
+	if (_streamLen == LCD_I2C_CHUNK) {
+		streamEnd();
+		_streamLen = 0;
+	}
+	_stream[_streamLen++] = _data | _backlightval;
+}
+
+void LiquidCrystal_I2C::streamEnd() {
+	_i2c.write(_stream, _streamLen);
 }
 
 void LiquidCrystal_I2C::write4bits(uint8_t value) {
@@ -265,9 +335,8 @@ void LiquidCrystal_I2C::write4bits(uint8_t value) {
 }
 
 void LiquidCrystal_I2C::expanderWrite(uint8_t _data){                                        
-	Wire.beginTransmission(_Addr);
-	printIIC((int)(_data) | _backlightval);
-	Wire.endTransmission();   
+	uint8_t state = _data | _backlightval;
+	_i2c.write(&state, 1);
 }
 
 void LiquidCrystal_I2C::pulseEnable(uint8_t _data){
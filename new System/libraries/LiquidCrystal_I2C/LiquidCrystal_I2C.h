@@ -5,6 +5,7 @@
 #include <inttypes.h>
 #include "Print.h" 
 #include <Wire.h>
+#include <Adafruit_I2CBus.h>
 
 // commands
 #define LCD_CLEARDISPLAY 0x01
@@ -52,6 +53,22 @@
 #define Rw B00000010  // Read/Write bit
 #define Rs B00000001  // Register select bit
 
+// Bytes per I2C transaction when streaming: Wire's transmit buffer
+#if defined(I2C_BUFFER_LENGTH)
+#define LCD_I2C_CHUNK I2C_BUFFER_LENGTH
+#elif defined(BUFFER_LENGTH)
+#define LCD_I2C_CHUNK BUFFER_LENGTH
+#else
+#define LCD_I2C_CHUNK 32
+#endif
+
+// Assumed I2C clock until setBusClock() says otherwise. Erring fast is
+// safe: a slower bus only stretches the settle time.
+#define LCD_I2C_DEFAULT_CLOCK 400000
+
+// Time the LCD needs after a byte before the next one (> 37us)
+#define LCD_SETTLE_US 50
+
 class LiquidCrystal_I2C : public Print {
 public:
   LiquidCrystal_I2C(uint8_t lcd_Addr,uint8_t lcd_cols,uint8_t lcd_rows);
@@ -83,12 +100,16 @@ public:
   void setCursor(uint8_t, uint8_t); 
 #if defined(ARDUINO) && ARDUINO >= 100
   virtual size_t write(uint8_t);
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  using Print::write;
 #else
   virtual void write(uint8_t);
 #endif
   void command(uint8_t);
   void init();
   void oled_init();
+  void setBusClock(uint32_t hz);	// the clock given to Wire.setClock(), sets the settle padding
+  void setBus(Adafruit_I2CBus *bus, uint8_t priority = I2C_PRIORITY_LOW);	// queue transfers behind the other devices on Wire
 
 ////compatibility API function aliases
 void blink_on();						// alias for blink()
@@ -117,6 +138,11 @@ private:
   void write4bits(uint8_t);
   void expanderWrite(uint8_t);
   void pulseEnable(uint8_t);
+  void streamBegin(uint8_t);
+  void streamSend(uint8_t, uint8_t);
+  void streamByte(uint8_t);
+  void streamEnd();
+  Adafruit_I2CDevice _i2c;
   uint8_t _Addr;
   uint8_t _displayfunction;
   uint8_t _displaycontrol;
@@ -126,6 +152,9 @@ private:
   uint8_t _cols;
   uint8_t _rows;
   uint8_t _backlightval;
+  uint8_t _settleBytes;
+  uint8_t _streamLen;
+  uint8_t _stream[LCD_I2C_CHUNK];
 };
 
 #endif
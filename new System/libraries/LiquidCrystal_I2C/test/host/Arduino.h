@@ -0,0 +1,17 @@
+// Host stand-in for the Arduino core: delays advance the I2C mock's clock
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define B00000001 1
+#define B00000010 2
+#define B00000100 4
+
+#define PROGMEM
+#define pgm_read_byte_near(p) (*(const uint8_t *)(p))
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long micros(void);
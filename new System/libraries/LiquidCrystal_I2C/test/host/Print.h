@@ -0,0 +1,27 @@
+// Host stand-in for the Arduino Print class
+#pragma once
+
+#include "Arduino.h"
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char *str) {
+    return str ? write((const uint8_t *)str, strlen(str)) : 0;
+  }
+  size_t write(const char *buffer, size_t size) {
+    return write((const uint8_t *)buffer, size);
+  }
+  size_t print(const char *str) {
+    return write(str);
+  }
+  size_t print(char c) {
+    return write((uint8_t)c);
+  }
+};
@@ -0,0 +1,23 @@
+// Host stand-in for TwoWire: the test records what goes on the bus
+#pragma once
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+class TwoWire {
+public:
+  void begin();
+  void end() {}
+  void setClock(uint32_t) {}
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  size_t write(int data) { return write((uint8_t)data); }
+  size_t write(const uint8_t *data, size_t len);
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(uint8_t, uint8_t, uint8_t = 1) { return 0; }
+  int available() { return 0; }
+  int read() { return -1; }
+};
+
+extern TwoWire Wire;
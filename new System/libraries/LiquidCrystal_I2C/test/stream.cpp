@@ -0,0 +1,356 @@
+/*
+ * Character streaming against a mock TwoWire and an HD44780 model that
+ * follows the PCF8574 outputs byte by byte: exact byte sequences, text and
+ * CGRAM contents, enable timing at several bus clocks, and a comparison
+ * of I2C transactions per string with the previous per-nibble writes.
+ * The display also runs queued on an Adafruit_I2CBus behind an expander.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -DARDUINO=100 -I../../test -I. -Itest/host -I../Adafruit_BusIO test/stream.cpp LiquidCrystal_I2C.cpp ../Adafruit_BusIO/Adafruit_I2CDevice.cpp ../Adafruit_BusIO/Adafruit_I2CBus.cpp -o stream
+ *   ./stream          # tests
+ *   ./stream bench    # transactions, bytes and bus time per string
+ */
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "LiquidCrystal_I2C.h"
+#include "host_test.h"
+
+/*
+ * I2C bus model: a transaction costs a start, the address byte and a
+ * stop; the expander updates its outputs as each data byte is acked.
+ * Idle time between transactions is not counted, which only makes the
+ * timing checks stricter.
+ */
+
+static uint32_t busClock = 100000;
+static double now_us;
+
+static double bits(double count) {
+  return count * 1e6 / busClock;
+}
+
+void delay(unsigned long ms) {
+  now_us += ms * 1000.0;
+}
+
+void delayMicroseconds(unsigned int us) {
+  now_us += us;
+}
+
+unsigned long micros(void) {
+  return (unsigned long)now_us;
+}
+
+/*
+ * HD44780 behind a PCF8574: P0 RS, P1 RW, P2 E, P3 backlight, P4-P7 D4-D7
+ */
+
+struct Lcd {
+  bool fourBit;
+  bool highNibble;      // next nibble is the high one
+  uint8_t pending;
+  uint8_t lastState;
+  bool cgram;
+  uint8_t addr;
+  uint8_t ddram[0x80];
+  uint8_t cgramData[64];
+  double busyUntil;
+  double eRiseAt;
+  int violations;
+
+  void reset() {
+    fourBit = false;
+    highNibble = true;
+    lastState = 0;
+    cgram = false;
+    addr = 0;
+    memset(ddram, ' ', sizeof(ddram));
+    memset(cgramData, 0, sizeof(cgramData));
+    busyUntil = 0;
+    eRiseAt = 0;
+    violations = 0;
+  }
+
+  void execute(uint8_t value, bool rs, double t) {
+    double duration = 37;
+    if (rs) {
+      if (cgram) cgramData[addr++ & 0x3F] = value;
+      else ddram[addr++ & 0x7F] = value;
+    } else if (value & 0x80) {
+      cgram = false;
+      addr = value & 0x7F;
+    } else if (value & 0x40) {
+      cgram = true;
+      addr = value & 0x3F;
+    } else if (value & 0x20) {
+      fourBit = !(value & 0x10);
+    } else if (value == 0x01) {
+      memset(ddram, ' ', sizeof(ddram));
+      cgram = false;
+      addr = 0;
+      duration = 1520;
+    } else if ((value & 0xFE) == 0x02) {
+      cgram = false;
+      addr = 0;
+      duration = 1520;
+    }
+    busyUntil = t + duration;
+  }
+
+  void output(uint8_t state, double t) {
+    bool eWas = lastState & En, eNow = state & En;
+    if (!eWas && eNow) {
+      // RS must be set up before E rises, and the LCD must be ready
+      if ((state & Rs) != (lastState & Rs)) violations++;
+      if (t < busyUntil) violations++;
+      eRiseAt = t;
+    } else if (eWas && !eNow) {
+      // Data and RS are sampled when E falls, after >= 450 ns high
+      if (t - eRiseAt < 0.45) violations++;
+      if ((state & 0xF3) != (lastState & 0xF3 & ~En)) violations++;
+      uint8_t nibble = state & 0xF0;
+      bool rs = state & Rs;
+      if (!fourBit) {
+        execute(nibble, rs, t);
+      } else if (highNibble) {
+        pending = nibble;
+        highNibble = false;
+      } else {
+        execute(pending | nibble >> 4, rs, t);
+        highNibble = true;
+      }
+    }
+    lastState = state;
+  }
+
+  std::string row(int r, int cols = 16) const {
+    return std::string((const char *)ddram + (r ? 0x40 : 0), cols);
+  }
+} lcd;
+
+/*
+ * TwoWire mock
+ */
+
+TwoWire Wire;
+
+struct Transaction {
+  uint8_t address;
+  std::vector<uint8_t> data;
+};
+
+static std::vector<Transaction> transactions;
+static bool inTransaction;
+static int overflows;
+
+void TwoWire::begin() {
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  transactions.push_back(Transaction());
+  transactions.back().address = address;
+  inTransaction = true;
+  now_us += bits(1 + 9);  // start and address
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (!inTransaction || transactions.back().data.size() == BUFFER_LENGTH) {
+    overflows++;
+    return 0;
+  }
+  transactions.back().data.push_back(data);
+  now_us += bits(9);
+  if (transactions.back().address == 0x27) lcd.output(data, now_us);
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n])) n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+  inTransaction = false;
+  now_us += bits(1);  // stop
+  return 0;
+}
+
+/*
+ * Tests
+ */
+
+static void start(LiquidCrystal_I2C &display, uint32_t clock) {
+  busClock = clock;
+  now_us = 0;
+  lcd.reset();
+  transactions.clear();
+  overflows = 0;
+  display.init();
+  display.backlight();
+}
+
+static void test_byte_sequence() {
+  printf("one character is one transaction: setup, two nibbles, padding\n");
+  LiquidCrystal_I2C display(0x27, 16, 2);
+  display.setBusClock(100000);
+  start(display, 100000);
+  transactions.clear();
+
+  display.write('A');
+  CHECK(transactions.size() == 1);
+  static const uint8_t expected[] = { 0x09, 0x4D, 0x49, 0x1D, 0x19 };
+  CHECK(transactions[0].address == 0x27);
+  CHECK(transactions[0].data == std::vector<uint8_t>(expected, expected + 5));
+
+  // At 400 kHz two repeated bytes keep the next enable pulse 50 us away
+  display.setBusClock(400000);
+  transactions.clear();
+  display.write('A');
+  static const uint8_t padded[] = { 0x09, 0x4D, 0x49, 0x1D, 0x19, 0x19, 0x19 };
+  CHECK(transactions[0].data == std::vector<uint8_t>(padded, padded + 7));
+}
+
+static void test_text(uint32_t clock, bool tell) {
+  printf("text, cursor and CGRAM at %u kHz%s\n", (unsigned)(clock / 1000),
+         tell ? "" : " (default padding)");
+  LiquidCrystal_I2C display(0x27, 16, 2);
+  if (tell) display.setBusClock(clock);
+  start(display, clock);
+
+  display.print("Hello, world!");
+  display.setCursor(2, 1);
+  size_t before = transactions.size();
+  display.print("Moisture 42%");
+  size_t used = transactions.size() - before, bytes = 0;
+  for (size_t i = before; i < transactions.size(); i++)
+    bytes += transactions[i].data.size();
+
+  CHECK(lcd.row(0) == "Hello, world!   ");
+  CHECK(lcd.row(1) == "  Moisture 42%  ");
+  // Every Wire buffer but the last one is full
+  CHECK(used == (bytes + LCD_I2C_CHUNK - 1) / LCD_I2C_CHUNK);
+
+  uint8_t bell[8] = { 4, 14, 14, 14, 31, 0, 4, 0 };
+  display.createChar(1, bell);
+  CHECK(!memcmp(lcd.cgramData + 8, bell, 8));
+
+  display.clear();
+  display.print("A long line that spans several Wire buffers");
+  CHECK(lcd.row(0, 40) == std::string("A long line that spans several Wire buffers", 40));
+
+  CHECK(lcd.violations == 0);
+  CHECK(overflows == 0);
+}
+
+static void test_fast_bus_untold() {
+  printf("the model catches a 1 MHz bus run with 400 kHz padding\n");
+  LiquidCrystal_I2C display(0x27, 16, 2);
+  start(display, 1000000);
+  display.print("Too fast");
+  CHECK(lcd.violations > 0);
+}
+
+static void test_shared_bus() {
+  printf("on a shared bus the display waits behind a queued expander write\n");
+  Adafruit_I2CBus bus;
+  Adafruit_I2CDevice expander(0x20);
+  Adafruit_I2CTransfer outputs;
+  static const uint8_t olat[3] = { 0x14, 0x3F, 0x00 };
+  LiquidCrystal_I2C display(0x27, 16, 2);
+  display.setBusClock(400000);
+  start(display, 400000);
+  display.setBus(&bus);
+
+  outputs.write(&expander, olat, sizeof(olat));
+  outputs.priority = I2C_PRIORITY_HIGH;
+  transactions.clear();
+  CHECK(bus.submit(&outputs));
+  display.print("Moisture 42%");
+  CHECK(!outputs.busy() && outputs.ok());
+  CHECK(transactions.size() > 1 && transactions[0].address == 0x20);
+  CHECK(bus.transactions() == transactions.size());
+  CHECK(lcd.row(0) == "Moisture 42%    ");
+
+  display.setBus(nullptr);
+  display.print("!");
+  CHECK(bus.transactions() + 1 == transactions.size());
+  CHECK(lcd.row(0) == "Moisture 42%!   ");
+  CHECK(lcd.violations == 0);
+  CHECK(overflows == 0);
+}
+
+/*
+ * Benchmark against the previous code: three single-byte transactions
+ * per nibble and 51 us of delays
+ */
+
+static void legacy_expander(uint8_t data) {
+  Wire.beginTransmission(0x27);
+  Wire.write((uint8_t)(data | LCD_BACKLIGHT));
+  Wire.endTransmission();
+}
+
+static void legacy_nibble(uint8_t value) {
+  legacy_expander(value);
+  legacy_expander(value | En);
+  delayMicroseconds(1);
+  legacy_expander(value & ~En);
+  delayMicroseconds(50);
+}
+
+static void legacy_print(const char *str) {
+  for (; *str; str++) {
+    legacy_nibble((*str & 0xF0) | Rs);
+    legacy_nibble(((*str << 4) & 0xF0) | Rs);
+  }
+}
+
+static void bench() {
+  const char *line = "Soil  42%  24.5C";  // one 16 column row
+  static const uint32_t clocks[] = { 100000, 400000 };
+
+  printf("16 character row      transactions  bytes   bus time\n");
+  for (uint32_t clock : clocks) {
+    LiquidCrystal_I2C display(0x27, 16, 2);
+    display.setBusClock(clock);
+    start(display, clock);
+
+    transactions.clear();
+    double t = now_us;
+    legacy_print(line);
+    size_t bytes = 0;
+    for (const Transaction &tr : transactions) bytes += tr.data.size();
+    printf("  %3u kHz, before:     %6zu      %5zu  %7.0f us\n", (unsigned)(clock / 1000),
+           transactions.size(), bytes, now_us - t);
+
+    transactions.clear();
+    t = now_us;
+    display.print(line);
+    bytes = 0;
+    for (const Transaction &tr : transactions) bytes += tr.data.size();
+    printf("  %3u kHz, streamed:   %6zu      %5zu  %7.0f us\n", (unsigned)(clock / 1000),
+           transactions.size(), bytes, now_us - t);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    bench();
+    return 0;
+  }
+
+  test_byte_sequence();
+  test_text(100000, true);
+  test_text(400000, true);
+  test_text(100000, false);
+  test_text(400000, false);
+  test_text(1000000, true);
+  test_fast_bus_untold();
+  test_shared_bus();
+
+  return test_summary();
+}
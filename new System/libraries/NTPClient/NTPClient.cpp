@@ -81,59 +81,202 @@ void NTPClient::begin(unsigned int port) {
   this->_udpSetup = true;
 }
 
+bool NTPClient::addServer(const char* serverName) {
+  if (this->_serverCount >= NTP_MAX_SERVERS - 1) return false;
+  this->_serverNames[this->_serverCount] = serverName;
+  this->_serverCount++;
+  return true;
+}
+
+bool NTPClient::addServer(IPAddress serverIP) {
+  if (this->_serverCount >= NTP_MAX_SERVERS - 1) return false;
+  this->_serverNames[this->_serverCount] = NULL;
+  this->_serverIPs[this->_serverCount] = serverIP;
+  this->_serverCount++;
+  return true;
+}
+
 bool NTPClient::forceUpdate() {
   #ifdef DEBUG_NTPClient
     Serial.println("Update from NTP Server");
   #endif
 
-  // flush any existing packets
-  while(this->_udp->parsePacket() != 0)
-    this->_udp->flush();
+  if (!this->_waiting) this->startRound();
+
+  while (this->_waiting) {
+    if (this->pollRound()) return true;
+    delay(1);
+  }
+
+  return this->_lastRoundOk;
+}
+
+bool NTPClient::update() {
+  if (!this->_waiting) {
+    unsigned long now = millis();
+    bool due;
+    if (!this->_attempted) {
+      due = true;                                                            // Update if there was no update yet.
+    } else if (this->_lastRoundOk) {
+      due = (now - this->_lastSync >= this->_updateInterval);                // Update after _updateInterval
+    } else {
+      due = (now - this->_lastAttempt >= min(this->_updateInterval, (unsigned long)NTP_RETRY_INTERVAL));
+    }
+    if (!due) return false;   // return false if update does not occur
+
+    if (!this->_udpSetup || this->_port != NTP_DEFAULT_LOCAL_PORT) this->begin(this->_port); // setup the UDP client if needed
+    this->startRound();
+    return false;
+  }
+
+  return this->pollRound();
+}
 
+bool NTPClient::isUpdating() const {
+  return this->_waiting;
+}
+
+void NTPClient::startRound() {
+  this->_attempted   = true;
+  this->_lastAttempt = millis();
+  this->_roundServer = 0;
+  this->_sampleCount = 0;
+  this->_waiting     = true;
   this->sendNTPPacket();
+}
 
-  // Wait till data is there or timeout...
-  byte timeout = 0;
-  int cb = 0;
-  do {
-    delay ( 10 );
-    cb = this->_udp->parsePacket();
-    if (timeout > 100) return false; // timeout after 1000 ms
-    timeout++;
-  } while (cb == 0);
+// One step of the round: check for the response of the current server,
+// move on to the next server on a response or a timeout
+bool NTPClient::pollRound() {
+  bool answered = this->readResponse();
 
-  this->_lastUpdate = millis() - (10 * (timeout + 1)); // Account for delay in reading the time
+  if (!answered && millis() - this->_requestSent < NTP_RESPONSE_TIMEOUT) {
+    return false;
+  }
 
-  this->_udp->read(this->_packetBuffer, NTP_PACKET_SIZE);
+  this->_roundServer++;
+  if (this->_roundServer <= this->_serverCount) {
+    this->sendNTPPacket();
+    return false;
+  }
 
-  unsigned long highWord = word(this->_packetBuffer[40], this->_packetBuffer[41]);
-  unsigned long lowWord = word(this->_packetBuffer[42], this->_packetBuffer[43]);
-  // combine the four bytes (two words) into a long integer
-  // this is NTP time (seconds since Jan 1 1900):
-  unsigned long secsSince1900 = highWord << 16 | lowWord;
+  this->_waiting = false;
+  return this->finishRound();
+}
 
-  this->_currentEpoc = secsSince1900 - SEVENZYYEARS;
+bool NTPClient::readResponse() {
+  int cb = this->_udp->parsePacket();
+  if (cb == 0) return false;
 
-  return true;  // return true after successful update
+  unsigned long received = millis();                                         // T4
+
+  if (cb < NTP_PACKET_SIZE) {
+    this->_udp->flush();
+    return false;
+  }
+  this->_udp->read(this->_packetBuffer, NTP_PACKET_SIZE);
+
+  byte* packet = this->_packetBuffer;
+
+  // Must be a server reply to this request, from a synchronized server
+  unsigned long originMillis = (unsigned long)packet[24] << 24 | (unsigned long)packet[25] << 16 | (unsigned long)packet[26] << 8 | packet[27];
+  unsigned long originId     = (unsigned long)packet[28] << 24 | (unsigned long)packet[29] << 16 | (unsigned long)packet[30] << 8 | packet[31];
+  byte leap    = packet[0] >> 6;
+  byte mode    = packet[0] & 0x07;
+  byte stratum = packet[1];
+  if (originMillis != this->_requestSent || originId != this->_requestId) return false;
+  if (mode != 4 || leap == 3 || stratum == 0 || stratum > 15) return true;
+
+  // Server receive (T2) and transmit (T3) timestamps, in ms since 1900
+  unsigned long secs2 = (unsigned long)packet[32] << 24 | (unsigned long)packet[33] << 16 | (unsigned long)packet[34] << 8 | packet[35];
+  unsigned long frac2 = (unsigned long)packet[36] << 24 | (unsigned long)packet[37] << 16 | (unsigned long)packet[38] << 8 | packet[39];
+  unsigned long secs3 = (unsigned long)packet[40] << 24 | (unsigned long)packet[41] << 16 | (unsigned long)packet[42] << 8 | packet[43];
+  unsigned long frac3 = (unsigned long)packet[44] << 24 | (unsigned long)packet[45] << 16 | (unsigned long)packet[46] << 8 | packet[47];
+  if (secs3 == 0) return true;
+
+  int64_t t2 = (int64_t)secs2 * 1000 + (((uint64_t)frac2 * 1000) >> 32);
+  int64_t t3 = (int64_t)secs3 * 1000 + (((uint64_t)frac3 * 1000) >> 32);
+
+  // Round trip without the time spent in the server: the reply left the
+  // server half of it before it arrived here
+  long roundTrip = (long)(received - this->_requestSent) - (long)(t3 - t2);
+  if (roundTrip < 0) roundTrip = 0;
+
+  Sample& sample = this->_samples[this->_sampleCount++];
+  sample.base  = t3 + roundTrip / 2 - (int64_t)SEVENZYYEARS * 1000 - received;
+  sample.delay = roundTrip;
+
+  return true;
 }
 
-bool NTPClient::update() {
-  if ((millis() - this->_lastUpdate >= this->_updateInterval)     // Update after _updateInterval
-    || this->_lastUpdate == 0) {                                // Update if there was no update yet.
-    if (!this->_udpSetup || this->_port != NTP_DEFAULT_LOCAL_PORT) this->begin(this->_port); // setup the UDP client if needed
-    return this->forceUpdate();
+// Keep the samples that agree with the median, then take the one with
+// the shortest round trip: it has the least room for path asymmetry
+bool NTPClient::finishRound() {
+  this->_lastRoundOk = false;
+  if (this->_sampleCount == 0) return false;
+
+  int64_t sorted[NTP_MAX_SERVERS];
+  for (uint8_t i = 0; i < this->_sampleCount; i++) {
+    uint8_t j = i;
+    for (; j > 0 && sorted[j - 1] > this->_samples[i].base; j--) sorted[j] = sorted[j - 1];
+    sorted[j] = this->_samples[i].base;
+  }
+  int64_t median = sorted[(this->_sampleCount - 1) / 2];
+
+  const Sample* best = NULL;
+  for (uint8_t i = 0; i < this->_sampleCount; i++) {
+    const Sample& sample = this->_samples[i];
+    int64_t distance = sample.base - median;
+    if (distance > NTP_AGREEMENT || distance < -NTP_AGREEMENT) continue;
+    if (best == NULL || sample.delay < best->delay) best = &sample;
   }
-  return false;   // return false if update does not occur
+
+  unsigned long now = millis();
+  int64_t epochMillis = best->base + now;
+
+  this->_lastOffset  = this->_timeSet ? (long)(epochMillis - this->getEpochMillis()) : 0;
+  this->_lastDelay   = best->delay;
+  this->_currentEpoc = (unsigned long)(epochMillis / 1000);
+  this->_currentMillis = (unsigned int)(epochMillis % 1000);
+  this->_lastUpdate  = now;
+  this->_lastSync    = now;
+  this->_timeSet     = true;
+  this->_lastRoundOk = true;
+
+  return true;  // return true after successful update
 }
 
 bool NTPClient::isTimeSet() const {
-  return (this->_lastUpdate != 0); // returns true if the time has been set, else false
+  return this->_timeSet; // returns true if the time has been set, else false
+}
+
+unsigned long NTPClient::getLastDelay() const {
+  return this->_lastDelay;
+}
+
+long NTPClient::getLastOffset() const {
+  return this->_lastOffset;
+}
+
+void NTPClient::setEpochTime(unsigned long epochTime, unsigned int ms) {
+  this->_currentEpoc   = epochTime - this->_timeOffset;
+  this->_currentMillis = ms % 1000;
+  this->_lastUpdate    = millis();
+  this->_timeSet       = true;
+}
+
+// UTC epoch in ms
+int64_t NTPClient::getEpochMillis() const {
+  return (int64_t)this->_currentEpoc * 1000 + this->_currentMillis + (millis() - this->_lastUpdate);
 }
 
 unsigned long NTPClient::getEpochTime() const {
   return this->_timeOffset + // User offset
-         this->_currentEpoc + // Epoch returned by the NTP server
-         ((millis() - this->_lastUpdate) / 1000); // Time since last update
+         (unsigned long)(this->getEpochMillis() / 1000); // Epoch returned by the NTP server plus time since last update
+}
+
+int NTPClient::getMillis() const {
+  return (int)(this->getEpochMillis() % 1000);
 }
 
 int NTPClient::getDay() const {
@@ -182,6 +325,10 @@ void NTPClient::setPoolServerName(const char* poolServerName) {
 }
 
 void NTPClient::sendNTPPacket() {
+  // flush any existing packets
+  while(this->_udp->parsePacket() != 0)
+    this->_udp->flush();
+
   // set all bytes in the buffer to 0
   memset(this->_packetBuffer, 0, NTP_PACKET_SIZE);
   // Initialize values needed to form NTP request
@@ -195,12 +342,27 @@ void NTPClient::sendNTPPacket() {
   this->_packetBuffer[14]  = 49;
   this->_packetBuffer[15]  = 52;
 
+  // The transmit timestamp comes back as the originate timestamp: use it
+  // to match the reply with this request
+  this->_requestSent = millis();
+  this->_requestId++;
+  for (int i = 0; i < 4; i++) {
+    this->_packetBuffer[40 + i] = this->_requestSent >> (24 - 8 * i);
+    this->_packetBuffer[44 + i] = this->_requestId >> (24 - 8 * i);
+  }
+
   // all NTP fields have been given values, now
   // you can send a packet requesting a timestamp:
-  if  (this->_poolServerName) {
-    this->_udp->beginPacket(this->_poolServerName, 123);
+  const char* serverName = this->_poolServerName;
+  IPAddress serverIP = this->_poolServerIP;
+  if (this->_roundServer > 0) {
+    serverName = this->_serverNames[this->_roundServer - 1];
+    serverIP = this->_serverIPs[this->_roundServer - 1];
+  }
+  if  (serverName) {
+    this->_udp->beginPacket(serverName, 123);
   } else {
-    this->_udp->beginPacket(this->_poolServerIP, 123);
+    this->_udp->beginPacket(serverIP, 123);
   }
   this->_udp->write(this->_packetBuffer, NTP_PACKET_SIZE);
   this->_udp->endPacket();
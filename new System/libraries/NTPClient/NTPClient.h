@@ -7,6 +7,10 @@
 #define SEVENZYYEARS 2208988800UL
 #define NTP_PACKET_SIZE 48
 #define NTP_DEFAULT_LOCAL_PORT 1337
+#define NTP_MAX_SERVERS 4           // Pool server plus up to 3 added with addServer()
+#define NTP_RESPONSE_TIMEOUT 1000   // In ms, per server
+#define NTP_RETRY_INTERVAL 10000    // In ms, after a round where no server answered
+#define NTP_AGREEMENT 250           // In ms, samples further than this from the median are dropped
 
 class NTPClient {
   private:
@@ -18,14 +22,46 @@ class NTPClient {
     unsigned int  _port           = NTP_DEFAULT_LOCAL_PORT;
     long          _timeOffset     = 0;
 
+    // Servers added with addServer(), queried after the pool server
+    const char*   _serverNames[NTP_MAX_SERVERS - 1];
+    IPAddress     _serverIPs[NTP_MAX_SERVERS - 1];
+    uint8_t       _serverCount    = 0;
+
     unsigned long _updateInterval = 60000;  // In ms
 
     unsigned long _currentEpoc    = 0;      // In s
-    unsigned long _lastUpdate     = 0;      // In ms
+    unsigned int  _currentMillis  = 0;      // In ms, sub-second part of _currentEpoc
+    unsigned long _lastUpdate     = 0;      // In ms, millis() when _currentEpoc was valid
+    bool          _timeSet        = false;
+
+    // Sync round: one request per server, sent one after the other
+    bool          _waiting        = false;
+    uint8_t       _roundServer    = 0;
+    unsigned long _requestSent    = 0;      // In ms
+    unsigned long _requestId      = 0;
+    unsigned long _lastAttempt    = 0;      // In ms
+    unsigned long _lastSync       = 0;      // In ms
+    bool          _attempted      = false;
+    bool          _lastRoundOk    = false;
+
+    struct Sample {
+      int64_t       base;                   // Epoch in ms at millis() == 0
+      unsigned long delay;                  // Round trip in ms
+    };
+    Sample        _samples[NTP_MAX_SERVERS];
+    uint8_t       _sampleCount    = 0;
+
+    long          _lastOffset     = 0;      // In ms
+    unsigned long _lastDelay      = 0;      // In ms
 
     byte          _packetBuffer[NTP_PACKET_SIZE];
 
     void          sendNTPPacket();
+    void          startRound();
+    bool          pollRound();
+    bool          readResponse();
+    bool          finishRound();
+    int64_t       getEpochMillis() const;
 
   public:
     NTPClient(UDP& udp);
@@ -59,21 +95,51 @@ class NTPClient {
      */
     void begin(unsigned int port);
 
+    /**
+     * Add a server queried in each update after the pool server. The
+     * sample with the shortest round trip among those that agree wins.
+     *
+     * @return false if NTP_MAX_SERVERS are already set
+     */
+    bool addServer(const char* serverName);
+    bool addServer(IPAddress serverIP);
+
     /**
      * This should be called in the main loop of your application. By default an update from the NTP Server is only
      * made every 60 seconds. This can be configured in the NTPClient constructor.
      *
-     * @return true on success, false on failure
+     * It never waits for the server: each call sends a request or checks for the
+     * response, so call it often while an update is in progress.
+     *
+     * @return true when an update completed in this call, else false
      */
     bool update();
 
     /**
-     * This will force the update from the NTP Server.
+     * This will force the update from the NTP Server, waiting for the
+     * response (up to NTP_RESPONSE_TIMEOUT per server).
      *
      * @return true on success, false on failure
      */
     bool forceUpdate();
 
+    /**
+     * @return true while an update is waiting for a server
+     */
+    bool isUpdating() const;
+
+    /**
+     * Round trip and clock correction of the last update, in ms
+     */
+    unsigned long getLastDelay() const;
+    long getLastOffset() const;
+
+    /**
+     * Set the time from another source, e.g. a RTC. Takes the same time
+     * base as getEpochTime(), with the time offset included.
+     */
+    void setEpochTime(unsigned long epochTime, unsigned int ms = 0);
+
     /**
      * This allows to check if the NTPClient successfully received a NTP packet and set the time.
      *
@@ -86,6 +152,11 @@ class NTPClient {
     int getMinutes() const;
     int getSeconds() const;
 
+    /**
+     * @return milliseconds into the current second
+     */
+    int getMillis() const;
+
     /**
      * Changes the time offset. Useful for changing timezones dynamically
      */
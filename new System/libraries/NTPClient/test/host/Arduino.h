@@ -0,0 +1,53 @@
+// Minimal Arduino core for building NTPClient on a POSIX host
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+inline unsigned long millis() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+inline void delay(unsigned long ms) {
+  usleep(ms * 1000);
+}
+
+inline void yield() {
+}
+
+inline int analogRead(uint8_t) {
+  return 0;
+}
+
+inline void randomSeed(unsigned long seed) {
+  srand(seed);
+}
+
+inline long random(long minValue, long maxValue) {
+  return minValue + rand() % (maxValue - minValue);
+}
+
+class String {
+  public:
+    String(const char* s = "") : _s(s) {}
+    String(unsigned long value) : _s(std::to_string(value)) {}
+    String(const std::string& s) : _s(s) {}
+    const char* c_str() const { return _s.c_str(); }
+    friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+    friend String operator+(const char* a, const String& b) { return String(a + b._s); }
+    friend String operator+(const String& a, const char* b) { return String(a._s + b); }
+  private:
+    std::string _s;
+};
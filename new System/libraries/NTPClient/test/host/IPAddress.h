@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+class IPAddress {
+  public:
+    IPAddress() : _address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : _address((uint32_t)a << 24 | (uint32_t)b << 16 | (uint32_t)c << 8 | d) {}
+    uint32_t hostOrder() const { return _address; }
+  private:
+    uint32_t _address;
+};
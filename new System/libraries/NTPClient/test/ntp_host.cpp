@@ -0,0 +1,385 @@
+/*
+ * NTPClient against local NTP stand-ins on the loopback interface:
+ * round trip compensation, non-blocking update(), multi-server
+ * filtering, timeouts and rejected replies.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=c++11 -O2 -I../../test -Itest/host -I. test/ntp_host.cpp NTPClient.cpp -lpthread -o ntp_host
+ *   ./ntp_host
+ *
+ * The stand-ins listen on 127.0.0.1 - 127.0.0.4, requests to port 123
+ * are redirected to their port.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <thread>
+#include <atomic>
+
+#include "NTPClient.h"
+#include "host_test.h"
+
+static uint16_t ntp_port;
+
+/*
+ * UDP over a non-blocking POSIX socket
+ */
+
+class PosixUDP : public UDP {
+  public:
+    uint8_t begin(uint16_t port) override {
+      stop();
+      _fd = socket(AF_INET, SOCK_DGRAM, 0);
+      sockaddr_in addr = address(INADDR_LOOPBACK, port);
+      if (bind(_fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        addr.sin_port = 0;  // default port taken, the tests don't care
+        bind(_fd, (sockaddr*)&addr, sizeof(addr));
+      }
+      fcntl(_fd, F_SETFL, O_NONBLOCK);
+      return 1;
+    }
+
+    void stop() override {
+      if (_fd >= 0) close(_fd);
+      _fd = -1;
+    }
+
+    int beginPacket(IPAddress ip, uint16_t port) override {
+      _to = address(ip.hostOrder(), port == 123 ? ntp_port : port);
+      _txLen = 0;
+      return 1;
+    }
+
+    // "s<n>.test" resolves to 127.0.0.<n>
+    int beginPacket(const char* host, uint16_t port) override {
+      int n = 0;
+      if (sscanf(host, "s%d.test", &n) != 1) return 0;
+      return beginPacket(IPAddress(127, 0, 0, n), port);
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+      size = min(size, sizeof(_tx) - _txLen);
+      memcpy(_tx + _txLen, buffer, size);
+      _txLen += size;
+      return size;
+    }
+
+    int endPacket() override {
+      return sendto(_fd, _tx, _txLen, 0, (sockaddr*)&_to, sizeof(_to)) == (ssize_t)_txLen;
+    }
+
+    int parsePacket() override {
+      ssize_t n = recv(_fd, _rx, sizeof(_rx), 0);
+      _rxLen = n > 0 ? n : 0;
+      _rxPos = 0;
+      return (int)_rxLen;
+    }
+
+    int read(unsigned char* buffer, size_t len) override {
+      len = min(len, _rxLen - _rxPos);
+      memcpy(buffer, _rx + _rxPos, len);
+      _rxPos += len;
+      return (int)len;
+    }
+
+    void flush() override {
+      _rxPos = _rxLen;
+    }
+
+    static sockaddr_in address(uint32_t ip, uint16_t port) {
+      sockaddr_in addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(ip);
+      addr.sin_port = htons(port);
+      return addr;
+    }
+
+  private:
+    int _fd = -1;
+    sockaddr_in _to;
+    uint8_t _tx[128];
+    size_t _txLen = 0;
+    uint8_t _rx[128];
+    size_t _rxLen = 0, _rxPos = 0;
+};
+
+/*
+ * NTP stand-in. The path delays are simulated by sleeping before the
+ * receive and after the transmit timestamp.
+ */
+
+enum Behaviour {
+  NORMAL,
+  SILENT,         // never answers
+  BAD_STRATUM,    // answers "unsynchronized"
+  WRONG_ORIGIN    // sends a reply to some other request first
+};
+
+struct Server {
+  long offset = 0;            // ms, server clock minus real time
+  unsigned long upDelay = 0;
+  unsigned long processing = 0;
+  unsigned long downDelay = 0;
+  Behaviour behaviour = NORMAL;
+  std::atomic<int> requests{0};
+  int fd = -1;
+};
+
+static Server servers[4];
+static std::atomic<bool> running{true};
+
+static int64_t real_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void put_timestamp(uint8_t* p, int64_t epochMs) {
+  uint32_t secs = (uint32_t)(epochMs / 1000 + SEVENZYYEARS);
+  uint32_t frac = (uint32_t)(((uint64_t)(epochMs % 1000) << 32) / 1000);
+  for (int i = 0; i < 4; i++) {
+    p[i]     = secs >> (24 - 8 * i);
+    p[4 + i] = frac >> (24 - 8 * i);
+  }
+}
+
+static void serve(Server* server) {
+  uint8_t packet[NTP_PACKET_SIZE];
+  while (running) {
+    sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t n = recvfrom(server->fd, packet, sizeof(packet), 0, (sockaddr*)&from, &fromLen);
+    if (n != NTP_PACKET_SIZE) continue;  // timeout, check running
+    server->requests++;
+    if (server->behaviour == SILENT) continue;
+
+    usleep(server->upDelay * 1000);
+    int64_t received = real_ms() + server->offset;
+    usleep(server->processing * 1000);
+
+    memcpy(packet + 24, packet + 40, 8);     // originate = client transmit
+    packet[0] = 0x24;                        // LI 0, version 4, mode 4 (server)
+    packet[1] = server->behaviour == BAD_STRATUM ? 0 : 2;
+    put_timestamp(packet + 32, received);
+    put_timestamp(packet + 40, real_ms() + server->offset);
+
+    usleep(server->downDelay * 1000);
+    if (server->behaviour == WRONG_ORIGIN) {
+      uint8_t other[NTP_PACKET_SIZE];
+      memcpy(other, packet, sizeof(other));
+      other[31] ^= 0x55;
+      put_timestamp(other + 40, real_ms() + server->offset + 7000);
+      sendto(server->fd, other, sizeof(other), 0, (sockaddr*)&from, fromLen);
+    }
+    sendto(server->fd, packet, sizeof(packet), 0, (sockaddr*)&from, fromLen);
+  }
+}
+
+static void reset_servers() {
+  for (Server& server : servers) {
+    server.offset = 0;
+    server.upDelay = server.processing = server.downDelay = 0;
+    server.behaviour = NORMAL;
+    server.requests = 0;
+  }
+  delay(50);  // let a stand-in that is still sleeping finish its reply
+}
+
+/*
+ * Tests
+ */
+
+// Client clock minus real time, in ms
+static long clock_error(const NTPClient& client) {
+  unsigned long secs;
+  int ms;
+  do {
+    secs = client.getEpochTime();
+    ms = client.getMillis();
+  } while (secs != client.getEpochTime());
+  return (long)((int64_t)secs * 1000 + ms - real_ms());
+}
+
+static long labs_(long v) {
+  return v < 0 ? -v : v;
+}
+
+static void test_round_trip() {
+  printf("round trip compensation\n");
+  reset_servers();
+  servers[0].upDelay = 60;
+  servers[0].processing = 40;
+  servers[0].downDelay = 60;
+
+  PosixUDP udp;
+  NTPClient client(udp, "s1.test");
+  client.begin();
+  CHECK(!client.isTimeSet());
+  CHECK(client.forceUpdate());
+  CHECK(client.isTimeSet());
+  printf("  delay %lu ms, error %ld ms\n", client.getLastDelay(), clock_error(client));
+  CHECK(labs_((long)client.getLastDelay() - 120) <= 15);
+  CHECK(labs_(clock_error(client)) <= 15);
+  client.end();
+}
+
+static void test_non_blocking() {
+  printf("update() does not block\n");
+  reset_servers();
+  servers[0].upDelay = 150;
+  servers[0].downDelay = 150;
+
+  PosixUDP udp;
+  NTPClient client(udp, "s1.test");
+  client.begin();
+
+  unsigned long longest = 0;
+  int calls = 0;
+  bool done = false;
+  unsigned long start = millis();
+  while (!done && millis() - start < 3000) {
+    unsigned long before = millis();
+    done = client.update();
+    longest = max(longest, millis() - before);
+    calls++;
+    if (calls == 1) CHECK(client.isUpdating());
+  }
+  printf("  %d calls, longest %lu ms, error %ld ms\n", calls, longest, clock_error(client));
+  CHECK(done);
+  CHECK(!client.isUpdating());
+  CHECK(longest <= 5);
+  CHECK(labs_(clock_error(client)) <= 15);
+
+  // Not due again until the update interval has passed
+  CHECK(!client.update());
+  CHECK(!client.isUpdating());
+  client.end();
+}
+
+static void test_multiple_servers() {
+  printf("falseticker dropped, shortest round trip wins\n");
+  reset_servers();
+  servers[0].offset = 5000;               // falseticker, fastest path
+  servers[0].upDelay = servers[0].downDelay = 5;
+  servers[1].upDelay = servers[1].downDelay = 40;
+  servers[2].upDelay = servers[2].downDelay = 10;
+  servers[3].offset = 120;
+  servers[3].upDelay = servers[3].downDelay = 25;
+
+  PosixUDP udp;
+  NTPClient client(udp, "s1.test");
+  CHECK(client.addServer("s2.test"));
+  CHECK(client.addServer(IPAddress(127, 0, 0, 3)));
+  CHECK(client.addServer("s4.test"));
+  CHECK(!client.addServer("s5.test"));
+  client.begin();
+  CHECK(client.forceUpdate());
+  printf("  delay %lu ms, error %ld ms\n", client.getLastDelay(), clock_error(client));
+  for (Server& server : servers) CHECK(server.requests == 1);
+  CHECK(labs_((long)client.getLastDelay() - 20) <= 10);
+  CHECK(labs_(clock_error(client)) <= 15);
+  client.end();
+}
+
+static void test_timeout() {
+  printf("silent server times out, next one answers\n");
+  reset_servers();
+  servers[0].behaviour = SILENT;
+
+  PosixUDP udp;
+  NTPClient client(udp, "s1.test");
+  client.addServer("s2.test");
+  client.begin();
+  unsigned long start = millis();
+  CHECK(client.forceUpdate());
+  unsigned long took = millis() - start;
+  printf("  took %lu ms, error %ld ms\n", took, clock_error(client));
+  CHECK(took >= NTP_RESPONSE_TIMEOUT && took < NTP_RESPONSE_TIMEOUT + 200);
+  CHECK(labs_(clock_error(client)) <= 15);
+
+  // Nobody answers: failure, the clock is left alone
+  servers[1].behaviour = SILENT;
+  client.setEpochTime(1000000000);
+  CHECK(!client.forceUpdate());
+  CHECK(client.getEpochTime() == 1000000000 + 2 * NTP_RESPONSE_TIMEOUT / 1000);
+  client.end();
+}
+
+static void test_rejected_replies() {
+  printf("replies to other requests and unsynchronized servers are ignored\n");
+  reset_servers();
+  servers[0].behaviour = WRONG_ORIGIN;
+
+  PosixUDP udp;
+  NTPClient client(udp, "s1.test");
+  client.begin();
+  CHECK(client.forceUpdate());
+  CHECK(labs_(clock_error(client)) <= 15);
+  client.end();
+
+  servers[0].behaviour = BAD_STRATUM;
+  PosixUDP udp2;
+  NTPClient client2(udp2, "s1.test");
+  client2.begin();
+  CHECK(!client2.forceUpdate());
+  CHECK(!client2.isTimeSet());
+  client2.end();
+}
+
+static void test_set_epoch_and_offset() {
+  printf("setEpochTime, time offset and last offset\n");
+  reset_servers();
+
+  PosixUDP udp;
+  NTPClient client(udp, "s1.test", 3600);
+  client.setEpochTime(1700003600, 250);
+  CHECK(client.isTimeSet());
+  CHECK(client.getEpochTime() == 1700003600);
+  CHECK(client.getMillis() >= 250 && client.getMillis() < 270);
+
+  // Start 2 s behind, the update reports the correction
+  client.begin();
+  int64_t now = real_ms() - 2000 + 3600000;
+  client.setEpochTime((unsigned long)(now / 1000), (unsigned int)(now % 1000));
+  CHECK(client.forceUpdate());
+  printf("  last offset %ld ms\n", client.getLastOffset());
+  CHECK(labs_(client.getLastOffset() - 2000) <= 15);
+  CHECK(labs_(clock_error(client) - 3600000) <= 15);
+  client.end();
+}
+
+int main() {
+  for (int i = 0; i < 4; i++) {
+    Server& server = servers[i];
+    server.fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = PosixUDP::address(0x7F000001 + i, ntp_port);
+    if (bind(server.fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+      printf("cannot bind 127.0.0.%d: %s\n", i + 1, strerror(errno));
+      return 1;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(server.fd, (sockaddr*)&addr, &len);
+    ntp_port = ntohs(addr.sin_port);
+    struct timeval timeout = { 0, 100000 };
+    setsockopt(server.fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  }
+  std::thread threads[4];
+  for (int i = 0; i < 4; i++) threads[i] = std::thread(serve, &servers[i]);
+
+  test_round_trip();
+  test_non_blocking();
+  test_multiple_servers();
+  test_timeout();
+  test_rejected_replies();
+  test_set_epoch_and_offset();
+
+  running = false;
+  for (std::thread& thread : threads) thread.join();
+
+  return test_summary();
+}
@@ -6,6 +6,7 @@
 #define DS3231_ALARM2 0x0B    ///< Alarm 2 register
 #define DS3231_CONTROL 0x0E   ///< Control register
 #define DS3231_STATUSREG 0x0F ///< Status register
+#define DS3231_AGINGREG 0x10  ///< Aging offset register
 #define DS3231_TEMPERATUREREG                                                  \
   0x11 ///< Temperature register (high byte - low byte is at 0x12), 10-bit
        ///< temperature value
@@ -117,6 +118,29 @@ float RTC_DS3231::getTemperature() {
   return (float)buffer[0] + (buffer[1] >> 6) * 0.25f;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Get the aging offset of the DS3231's oscillator
+    @return Aging offset, in steps of about 0.1 ppm
+*/
+/**************************************************************************/
+int8_t RTC_DS3231::getAgingOffset() {
+  return (int8_t)read_register(DS3231_AGINGREG);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Trim the DS3231's oscillator. A positive value slows it down,
+            a negative value speeds it up, by about 0.1 ppm per step at
+            25 degrees Celsius. The new value applies from the next
+            temperature conversion (every 64 seconds).
+    @param  offset Aging offset
+*/
+/**************************************************************************/
+void RTC_DS3231::setAgingOffset(int8_t offset) {
+  write_register(DS3231_AGINGREG, (uint8_t)offset);
+}
+
 /**************************************************************************/
 /*!
     @brief  Set alarm 1 for DS3231
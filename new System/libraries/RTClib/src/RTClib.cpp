@@ -77,150 +77,28 @@ void RTC_I2C::write_register(uint8_t reg, uint8_t val) {
 /**************************************************************************/
 uint8_t RTC_I2C::read_register(uint8_t reg) {
   uint8_t buffer[1];
-  i2c_dev->write(&reg, 1);
-  i2c_dev->read(buffer, 1);
+  i2c_dev->write_then_read(&reg, 1, buffer, 1);
   return buffer[0];
 }
 
-/**************************************************************************/
-// utility code, some of this could be exposed in the DateTime API if needed
-/**************************************************************************/
-
-/**
-  Number of days in each month, from January to November. December is not
-  needed. Omitting it avoids an incompatibility with Paul Stoffregen's Time
-  library. C.f. https://github.com/adafruit/RTClib/issues/114
-*/
-const uint8_t daysInMonth[] PROGMEM = {31, 28, 31, 30, 31, 30,
-                                       31, 31, 30, 31, 30};
-
-/**************************************************************************/
-/*!
-    @brief  Given a date, return number of days since 2000/01/01,
-            valid for 2000--2099
-    @param y Year
-    @param m Month
-    @param d Day
-    @return Number of days
-*/
-/**************************************************************************/
-static uint16_t date2days(uint16_t y, uint8_t m, uint8_t d) {
-  if (y >= 2000U)
-    y -= 2000U;
-  uint16_t days = d;
-  for (uint8_t i = 1; i < m; ++i)
-    days += pgm_read_byte(daysInMonth + i - 1);
-  if (m > 2 && y % 4 == 0)
-    ++days;
-  return days + 365 * y + (y + 3) / 4 - 1;
-}
-
-/**************************************************************************/
-/*!
-    @brief  Given a number of days, hours, minutes, and seconds, return the
-   total seconds
-    @param days Days
-    @param h Hours
-    @param m Minutes
-    @param s Seconds
-    @return Number of seconds total
-*/
-/**************************************************************************/
-static uint32_t time2ulong(uint16_t days, uint8_t h, uint8_t m, uint8_t s) {
-  return ((days * 24UL + h) * 60 + m) * 60 + s;
-}
-
 /**************************************************************************/
 /*!
-    @brief  Constructor from
-        [Unix time](https://en.wikipedia.org/wiki/Unix_time).
-
-    This builds a DateTime from an integer specifying the number of seconds
-    elapsed since the epoch: 1970-01-01 00:00:00. This number is analogous
-    to Unix time, with two small differences:
-
-     - The Unix epoch is specified to be at 00:00:00
-       [UTC](https://en.wikipedia.org/wiki/Coordinated_Universal_Time),
-       whereas this class has no notion of time zones. The epoch used in
-       this class is then at 00:00:00 on whatever time zone the user chooses
-       to use, ignoring changes in DST.
-
-     - Unix time is conventionally represented with signed numbers, whereas
-       this constructor takes an unsigned argument. Because of this, it does
-       _not_ suffer from the
-       [year 2038 problem](https://en.wikipedia.org/wiki/Year_2038_problem).
-
-    If called without argument, it returns the earliest time representable
-    by this class: 2000-01-01 00:00:00.
-
-    @see The `unixtime()` method is the converse of this constructor.
-
-    @param t Time elapsed in seconds since 1970-01-01 00:00:00.
+    @brief  Queue this RTC's transfers on a bus manager shared with the
+   other devices on its TwoWire, instead of driving it directly. Call after
+   begin(). The clock's registers auto-increment, so its reads may be merged
+   with other clients' reads of the same chip.
+    @param bus The bus manager, or NULL to drive the TwoWire directly again
+    @param priority One of i2c_priority_t
+    @return True if attached, false before begin()
 */
 /**************************************************************************/
-DateTime::DateTime(uint32_t t) {
-  t -= SECONDS_FROM_1970_TO_2000; // bring to 2000 timestamp from 1970
-
-  ss = t % 60;
-  t /= 60;
-  mm = t % 60;
-  t /= 60;
-  hh = t % 24;
-  uint16_t days = t / 24;
-  uint8_t leap;
-  for (yOff = 0;; ++yOff) {
-    leap = yOff % 4 == 0;
-    if (days < 365U + leap)
-      break;
-    days -= 365 + leap;
-  }
-  for (m = 1; m < 12; ++m) {
-    uint8_t daysPerMonth = pgm_read_byte(daysInMonth + m - 1);
-    if (leap && m == 2)
-      ++daysPerMonth;
-    if (days < daysPerMonth)
-      break;
-    days -= daysPerMonth;
-  }
-  d = days + 1;
-}
-
-/**************************************************************************/
-/*!
-    @brief  Constructor from (year, month, day, hour, minute, second).
-    @warning If the provided parameters are not valid (e.g. 31 February),
-           the constructed DateTime will be invalid.
-    @see   The `isValid()` method can be used to test whether the
-           constructed DateTime is valid.
-    @param year Either the full year (range: 2000--2099) or the offset from
-        year 2000 (range: 0--99).
-    @param month Month number (1--12).
-    @param day Day of the month (1--31).
-    @param hour,min,sec Hour (0--23), minute (0--59) and second (0--59).
-*/
-/**************************************************************************/
-DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour,
-                   uint8_t min, uint8_t sec) {
-  if (year >= 2000U)
-    year -= 2000U;
-  yOff = year;
-  m = month;
-  d = day;
-  hh = hour;
-  mm = min;
-  ss = sec;
+bool RTC_I2C::setBus(Adafruit_I2CBus *bus, uint8_t priority) {
+  if (!i2c_dev)
+    return false;
+  i2c_dev->setBus(bus, priority, true);
+  return true;
 }
 
-/**************************************************************************/
-/*!
-    @brief  Copy constructor.
-    @param copy DateTime to copy.
-*/
-/**************************************************************************/
-DateTime::DateTime(const DateTime &copy)
-    : yOff(copy.yOff), m(copy.m), d(copy.d), hh(copy.hh), mm(copy.mm),
-      ss(copy.ss) {}
-
 /**************************************************************************/
 /*!
     @brief  Convert a string containing two digits to uint8_t, e.g. "09" returns
@@ -544,94 +422,6 @@ uint8_t DateTime::twelveHour() const {
   }
 }
 
-/**************************************************************************/
-/*!
-    @brief  Return the day of the week.
-    @return Day of week as an integer from 0 (Sunday) to 6 (Saturday).
-*/
-/**************************************************************************/
-uint8_t DateTime::dayOfTheWeek() const {
-  uint16_t day = date2days(yOff, m, d);
-  return (day + 6) % 7; // Jan 1, 2000 is a Saturday, i.e. returns 6
-}
-
-/**************************************************************************/
-/*!
-    @brief  Return Unix time: seconds since 1 Jan 1970.
-
-    @see The `DateTime::DateTime(uint32_t)` constructor is the converse of
-        this method.
-
-    @return Number of seconds since 1970-01-01 00:00:00.
-*/
-/**************************************************************************/
-uint32_t DateTime::unixtime(void) const {
-  uint32_t t;
-  uint16_t days = date2days(yOff, m, d);
-  t = time2ulong(days, hh, mm, ss);
-  t += SECONDS_FROM_1970_TO_2000; // seconds from 1970 to 2000
-
-  return t;
-}
-
-/**************************************************************************/
-/*!
-    @brief  Convert the DateTime to seconds since 1 Jan 2000
-
-    The result can be converted back to a DateTime with:
-
-    ```cpp
-    DateTime(SECONDS_FROM_1970_TO_2000 + value)
-    ```
-
-    @return Number of seconds since 2000-01-01 00:00:00.
-*/
-/**************************************************************************/
-uint32_t DateTime::secondstime(void) const {
-  uint32_t t;
-  uint16_t days = date2days(yOff, m, d);
-  t = time2ulong(days, hh, mm, ss);
-  return t;
-}
-
-/**************************************************************************/
-/*!
-    @brief  Add a TimeSpan to the DateTime object
-    @param span TimeSpan object
-    @return New DateTime object with span added to it.
-*/
-/**************************************************************************/
-DateTime DateTime::operator+(const TimeSpan &span) const {
-  return DateTime(unixtime() + span.totalseconds());
-}
-
-/**************************************************************************/
-/*!
-    @brief  Subtract a TimeSpan from the DateTime object
-    @param span TimeSpan object
-    @return New DateTime object with span subtracted from it.
-*/
-/**************************************************************************/
-DateTime DateTime::operator-(const TimeSpan &span) const {
-  return DateTime(unixtime() - span.totalseconds());
-}
-
-/**************************************************************************/
-/*!
-    @brief  Subtract one DateTime from another
-
-    @note Since a TimeSpan cannot be negative, the subtracted DateTime
-        should be less (earlier) than or equal to the one it is
-        subtracted from.
-
-    @param right The DateTime object to subtract from self (the left object)
-    @return TimeSpan of the difference between DateTimes.
-*/
-/**************************************************************************/
-TimeSpan DateTime::operator-(const DateTime &right) const {
-  return TimeSpan(unixtime() - right.unixtime());
-}
-
 /**************************************************************************/
 /*!
     @author Anton Rieutskyi
@@ -709,56 +499,3 @@ String DateTime::timestamp(timestampOpt opt) const {
   }
   return String(buffer);
 }
-
-/**************************************************************************/
-/*!
-    @brief  Create a new TimeSpan object in seconds
-    @param seconds Number of seconds
-*/
-/**************************************************************************/
-TimeSpan::TimeSpan(int32_t seconds) : _seconds(seconds) {}
-
-/**************************************************************************/
-/*!
-    @brief  Create a new TimeSpan object using a number of
-   days/hours/minutes/seconds e.g. Make a TimeSpan of 3 hours and 45 minutes:
-   new TimeSpan(0, 3, 45, 0);
-    @param days Number of days
-    @param hours Number of hours
-    @param minutes Number of minutes
-    @param seconds Number of seconds
-*/
-/**************************************************************************/
-TimeSpan::TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t seconds)
-    : _seconds((int32_t)days * 86400L + (int32_t)hours * 3600 +
-               (int32_t)minutes * 60 + seconds) {}
-
-/**************************************************************************/
-/*!
-    @brief  Copy constructor, make a new TimeSpan using an existing one
-    @param copy The TimeSpan to copy
-*/
-/**************************************************************************/
-TimeSpan::TimeSpan(const TimeSpan &copy) : _seconds(copy._seconds) {}
-
-/**************************************************************************/
-/*!
-    @brief  Add two TimeSpans
-    @param right TimeSpan to add
-    @return New TimeSpan object, sum of left and right
-*/
-/**************************************************************************/
-TimeSpan TimeSpan::operator+(const TimeSpan &right) const {
-  return TimeSpan(_seconds + right._seconds);
-}
-
-/**************************************************************************/
-/*!
-    @brief  Subtract a TimeSpan
-    @param right TimeSpan to subtract
-    @return New TimeSpan object, right subtracted from left
-*/
-/**************************************************************************/
-TimeSpan TimeSpan::operator-(const TimeSpan &right) const {
-  return TimeSpan(_seconds - right._seconds);
-}
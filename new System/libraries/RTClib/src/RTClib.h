@@ -22,7 +22,7 @@
 #ifndef _RTCLIB_H_
 #define _RTCLIB_H_
 
-#include <Adafruit_I2CDevice.h>
+#include <Adafruit_I2CBus.h>
 #include <Arduino.h>
 
 class TimeSpan;
@@ -142,10 +142,61 @@ enum Pcf8563SqwPinMode {
 /**************************************************************************/
 class DateTime {
 public:
-  DateTime(uint32_t t = SECONDS_FROM_1970_TO_2000);
-  DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0,
-           uint8_t min = 0, uint8_t sec = 0);
-  DateTime(const DateTime &copy);
+  /*!
+      @brief  Constructor from
+          [Unix time](https://en.wikipedia.org/wiki/Unix_time).
+
+      This builds a DateTime from an integer specifying the number of
+      seconds elapsed since the epoch: 1970-01-01 00:00:00. This number is
+      analogous to Unix time, with two small differences:
+
+       - The Unix epoch is specified to be at 00:00:00
+         [UTC](https://en.wikipedia.org/wiki/Coordinated_Universal_Time),
+         whereas this class has no notion of time zones. The epoch used in
+         this class is then at 00:00:00 on whatever time zone the user
+         chooses to use, ignoring changes in DST.
+
+       - Unix time is conventionally represented with signed numbers,
+         whereas this constructor takes an unsigned argument. Because of
+         this, it does _not_ suffer from the
+         [year 2038 problem](https://en.wikipedia.org/wiki/Year_2038_problem).
+
+      If called without argument, it returns the earliest time representable
+      by this class: 2000-01-01 00:00:00.
+
+      The conversion takes constant time, and can be done at compile time.
+
+      @see The `unixtime()` method is the converse of this constructor.
+
+      @param t Time elapsed in seconds since 1970-01-01 00:00:00.
+  */
+  constexpr DateTime(uint32_t t = SECONDS_FROM_1970_TO_2000)
+      : yOff(yearFromDays(daysFrom2000(t))),
+        m(monthFromDays(daysFrom2000(t))), d(dayFromDays(daysFrom2000(t))),
+        hh((t - SECONDS_FROM_1970_TO_2000) / 3600 % 24),
+        mm((t - SECONDS_FROM_1970_TO_2000) / 60 % 60),
+        ss((t - SECONDS_FROM_1970_TO_2000) % 60) {}
+  /*!
+      @brief  Constructor from (year, month, day, hour, minute, second).
+      @warning If the provided parameters are not valid (e.g. 31 February),
+             the constructed DateTime will be invalid.
+      @see   The `isValid()` method can be used to test whether the
+             constructed DateTime is valid.
+      @param year Either the full year (range: 2000--2099) or the offset from
+          year 2000 (range: 0--99).
+      @param month Month number (1--12).
+      @param day Day of the month (1--31).
+      @param hour,min,sec Hour (0--23), minute (0--59) and second (0--59).
+  */
+  constexpr DateTime(uint16_t year, uint8_t month, uint8_t day,
+                     uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0)
+      : yOff(year >= 2000U ? year - 2000U : year), m(month), d(day), hh(hour),
+        mm(min), ss(sec) {}
+  /*!
+      @brief  Copy constructor.
+      @param copy DateTime to copy.
+  */
+  constexpr DateTime(const DateTime &copy) = default;
   DateTime(const char *date, const char *time);
   DateTime(const __FlashStringHelper *date, const __FlashStringHelper *time);
   DateTime(const char *iso8601date);
@@ -156,47 +207,113 @@ public:
       @brief  Return the year.
       @return Year (range: 2000--2099).
   */
-  uint16_t year() const { return 2000U + yOff; }
+  constexpr uint16_t year() const { return 2000U + yOff; }
   /*!
       @brief  Return the month.
       @return Month number (1--12).
   */
-  uint8_t month() const { return m; }
+  constexpr uint8_t month() const { return m; }
   /*!
       @brief  Return the day of the month.
       @return Day of the month (1--31).
   */
-  uint8_t day() const { return d; }
+  constexpr uint8_t day() const { return d; }
   /*!
       @brief  Return the hour
       @return Hour (0--23).
   */
-  uint8_t hour() const { return hh; }
+  constexpr uint8_t hour() const { return hh; }
 
   uint8_t twelveHour() const;
   /*!
       @brief  Return whether the time is PM.
       @return 0 if the time is AM, 1 if it's PM.
   */
-  uint8_t isPM() const { return hh >= 12; }
+  constexpr uint8_t isPM() const { return hh >= 12; }
   /*!
       @brief  Return the minute.
       @return Minute (0--59).
   */
-  uint8_t minute() const { return mm; }
+  constexpr uint8_t minute() const { return mm; }
   /*!
       @brief  Return the second.
       @return Second (0--59).
   */
-  uint8_t second() const { return ss; }
+  constexpr uint8_t second() const { return ss; }
+
+  /*!
+      @brief  Return the day of the week.
+      @return Day of week as an integer from 0 (Sunday) to 6 (Saturday).
+  */
+  constexpr uint8_t dayOfTheWeek() const {
+    return (date2days(yOff, m, d) + 6) % 7; // Jan 1, 2000 is a Saturday
+  }
+
+  /*!
+      @brief  Convert the DateTime to seconds since 1 Jan 2000
+
+      The result can be converted back to a DateTime with:
+
+      ```cpp
+      DateTime(SECONDS_FROM_1970_TO_2000 + value)
+      ```
+
+      @return Number of seconds since 2000-01-01 00:00:00.
+  */
+  constexpr uint32_t secondstime() const {
+    return ((date2days(yOff, m, d) * 24UL + hh) * 60 + mm) * 60 + ss;
+  }
 
-  uint8_t dayOfTheWeek() const;
+  /*!
+      @brief  Return Unix time: seconds since 1 Jan 1970.
 
-  /* 32-bit times as seconds since 2000-01-01. */
-  uint32_t secondstime() const;
+      @see The `DateTime::DateTime(uint32_t)` constructor is the converse of
+          this method.
 
-  /* 32-bit times as seconds since 1970-01-01. */
-  uint32_t unixtime(void) const;
+      @return Number of seconds since 1970-01-01 00:00:00.
+  */
+  constexpr uint32_t unixtime(void) const {
+    return secondstime() + SECONDS_FROM_1970_TO_2000;
+  }
+
+  /*!
+      @brief  Next time of day strictly after this DateTime, e.g. the next
+              7:30 is today if it is 7:29, tomorrow if it is 7:30.
+      @param hour,min,sec Time of day to look for.
+      @return DateTime of the next occurrence.
+  */
+  constexpr DateTime nextTime(uint8_t hour, uint8_t min, uint8_t sec = 0) const {
+    return fromSecondstime(
+        nextDaily(secondstime(), ((uint32_t)hour * 60 + min) * 60 + sec, 0, 1));
+  }
+
+  /*!
+      @brief  Next day of the week at a time of day, strictly after this
+              DateTime. If today is that day and the time has passed, the
+              result is a week later.
+      @param dayOfWeek Day of the week, from 0 (Sunday) to 6 (Saturday).
+      @param hour,min,sec Time of day to look for.
+      @return DateTime of the next occurrence.
+  */
+  constexpr DateTime nextDayOfTheWeek(uint8_t dayOfWeek, uint8_t hour = 0,
+                                      uint8_t min = 0, uint8_t sec = 0) const {
+    return fromSecondstime(nextDaily(secondstime(),
+                                     ((uint32_t)hour * 60 + min) * 60 + sec,
+                                     (dayOfWeek + 7 - dayOfTheWeek()) % 7, 7));
+  }
+
+  /*!
+      @brief  Next multiple of an interval strictly after this DateTime,
+              counted from 2000-01-01 00:00:00. Intervals that divide a day
+              (e.g. 15 minutes) are aligned to midnight.
+      @param interval Interval in seconds. 0 returns this DateTime.
+      @return DateTime of the next boundary.
+  */
+  constexpr DateTime nextInterval(uint32_t interval) const {
+    return interval == 0
+               ? *this
+               : fromSecondstime((secondstime() / interval + 1) * interval);
+  }
 
   /*!
       Format of the ISO 8601 timestamp generated by `timestamp()`. Each
@@ -209,9 +326,9 @@ public:
   };
   String timestamp(timestampOpt opt = TIMESTAMP_FULL) const;
 
-  DateTime operator+(const TimeSpan &span) const;
-  DateTime operator-(const TimeSpan &span) const;
-  TimeSpan operator-(const DateTime &right) const;
+  constexpr DateTime operator+(const TimeSpan &span) const;
+  constexpr DateTime operator-(const TimeSpan &span) const;
+  constexpr TimeSpan operator-(const DateTime &right) const;
   bool operator<(const DateTime &right) const;
 
   /*!
@@ -259,6 +376,80 @@ public:
   bool operator!=(const DateTime &right) const { return !(*this == right); }
 
 protected:
+  /*!
+      @brief  Days since 2000-01-01, valid for 2000--2099. Counted from
+              1996-03-01 so that each leap day ends a 4-year cycle, then
+              shifted back; months are counted from March, so that their
+              lengths follow a fixed 153-day pattern.
+      @param y Year offset from 2000
+      @param m Month
+      @param d Day
+      @return Number of days
+  */
+  static constexpr uint16_t date2days(uint8_t y, uint8_t m, uint8_t d) {
+    return 365U * (y + 4U - (m <= 2)) + (y + 4U - (m <= 2)) / 4 +
+           (153U * (m > 2 ? m - 3U : m + 9U) + 2) / 5 + d - 1 - 1401;
+  }
+  /*!
+      @brief  Days since 2000-01-01 of a Unix time
+      @param t Unix time
+      @return Number of days
+  */
+  static constexpr uint16_t daysFrom2000(uint32_t t) {
+    return (t - SECONDS_FROM_1970_TO_2000) / SECONDS_PER_DAY;
+  }
+  /*!
+      @brief  Day of the 4-year cycle starting on 1 March, and day of the
+              year starting on 1 March. The converse of `date2days()`.
+      @param days Days since 2000-01-01
+      @return Day number
+  */
+  static constexpr uint16_t dayOfCycle(uint16_t days) {
+    return (days + 1401U) % 1461;
+  }
+  static constexpr uint16_t yearOfCycle(uint16_t doc) {
+    return (doc - doc / 1460) / 365;
+  }
+  static constexpr uint16_t dayOfMarchYear(uint16_t days) {
+    return dayOfCycle(days) - 365 * yearOfCycle(dayOfCycle(days));
+  }
+  static constexpr uint8_t marchMonth(uint16_t days) {
+    return (5 * dayOfMarchYear(days) + 2) / 153;
+  }
+  static constexpr uint8_t yearFromDays(uint16_t days) {
+    return (days + 1401U) / 1461 * 4 + yearOfCycle(dayOfCycle(days)) +
+           (marchMonth(days) >= 10) - 4;
+  }
+  static constexpr uint8_t monthFromDays(uint16_t days) {
+    return marchMonth(days) < 10 ? marchMonth(days) + 3 : marchMonth(days) - 9;
+  }
+  static constexpr uint8_t dayFromDays(uint16_t days) {
+    return dayOfMarchYear(days) - (153U * marchMonth(days) + 2) / 5 + 1;
+  }
+  /*!
+      @brief  Seconds since 2000-01-01 of a time of day some days ahead,
+              one period later if that is not strictly after now
+      @param now Seconds since 2000-01-01
+      @param time Time of day in seconds
+      @param days Days ahead
+      @param period Days to add if the result would not be after now
+      @return Seconds since 2000-01-01
+  */
+  static constexpr uint32_t nextDaily(uint32_t now, uint32_t time,
+                                      uint8_t days, uint8_t period) {
+    return now - now % SECONDS_PER_DAY + time + SECONDS_PER_DAY * days +
+           (days == 0 && time <= now % SECONDS_PER_DAY ? SECONDS_PER_DAY * period
+                                                       : 0);
+  }
+  /*!
+      @brief  DateTime from seconds since 2000-01-01
+      @param t Seconds since 2000-01-01
+      @return DateTime
+  */
+  static constexpr DateTime fromSecondstime(uint32_t t) {
+    return DateTime(t + SECONDS_FROM_1970_TO_2000);
+  }
+
   uint8_t yOff; ///< Year offset from 2000
   uint8_t m;    ///< Month 1-12
   uint8_t d;    ///< Day 1-31
@@ -274,56 +465,125 @@ protected:
 /**************************************************************************/
 class TimeSpan {
 public:
-  TimeSpan(int32_t seconds = 0);
-  TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t seconds);
-  TimeSpan(const TimeSpan &copy);
+  /*!
+      @brief  Create a new TimeSpan object in seconds
+      @param seconds Number of seconds
+  */
+  constexpr TimeSpan(int32_t seconds = 0) : _seconds(seconds) {}
+  /*!
+      @brief  Create a new TimeSpan object using a number of
+     days/hours/minutes/seconds e.g. Make a TimeSpan of 3 hours and 45
+     minutes: new TimeSpan(0, 3, 45, 0);
+      @param days Number of days
+      @param hours Number of hours
+      @param minutes Number of minutes
+      @param seconds Number of seconds
+  */
+  constexpr TimeSpan(int16_t days, int8_t hours, int8_t minutes,
+                     int8_t seconds)
+      : _seconds((int32_t)days * 86400L + (int32_t)hours * 3600 +
+                 (int32_t)minutes * 60 + seconds) {}
+  /*!
+      @brief  Copy constructor, make a new TimeSpan using an existing one
+      @param copy The TimeSpan to copy
+  */
+  constexpr TimeSpan(const TimeSpan &copy) : _seconds(copy._seconds) {}
 
   /*!
       @brief  Number of days in the TimeSpan
               e.g. 4
       @return int16_t days
   */
-  int16_t days() const { return _seconds / 86400L; }
+  constexpr int16_t days() const { return _seconds / 86400L; }
   /*!
       @brief  Number of hours in the TimeSpan
               This is not the total hours, it includes the days
               e.g. 4 days, 3 hours - NOT 99 hours
       @return int8_t hours
   */
-  int8_t hours() const { return _seconds / 3600 % 24; }
+  constexpr int8_t hours() const { return _seconds / 3600 % 24; }
   /*!
       @brief  Number of minutes in the TimeSpan
               This is not the total minutes, it includes days/hours
               e.g. 4 days, 3 hours, 27 minutes
       @return int8_t minutes
   */
-  int8_t minutes() const { return _seconds / 60 % 60; }
+  constexpr int8_t minutes() const { return _seconds / 60 % 60; }
   /*!
       @brief  Number of seconds in the TimeSpan
               This is not the total seconds, it includes the days/hours/minutes
               e.g. 4 days, 3 hours, 27 minutes, 7 seconds
       @return int8_t seconds
   */
-  int8_t seconds() const { return _seconds % 60; }
+  constexpr int8_t seconds() const { return _seconds % 60; }
   /*!
       @brief  Total number of seconds in the TimeSpan, e.g. 358027
       @return int32_t seconds
   */
-  int32_t totalseconds() const { return _seconds; }
+  constexpr int32_t totalseconds() const { return _seconds; }
 
-  TimeSpan operator+(const TimeSpan &right) const;
-  TimeSpan operator-(const TimeSpan &right) const;
+  /*!
+      @brief  Add two TimeSpans
+      @param right TimeSpan to add
+      @return New TimeSpan object, sum of left and right
+  */
+  constexpr TimeSpan operator+(const TimeSpan &right) const {
+    return TimeSpan(_seconds + right._seconds);
+  }
+  /*!
+      @brief  Subtract a TimeSpan
+      @param right TimeSpan to subtract
+      @return New TimeSpan object, right subtracted from left
+  */
+  constexpr TimeSpan operator-(const TimeSpan &right) const {
+    return TimeSpan(_seconds - right._seconds);
+  }
 
 protected:
   int32_t _seconds; ///< Actual TimeSpan value is stored as seconds
 };
 
+/*!
+    @brief  Add a TimeSpan to the DateTime object
+    @param span TimeSpan object
+    @return New DateTime object with span added to it.
+*/
+constexpr DateTime DateTime::operator+(const TimeSpan &span) const {
+  return DateTime(unixtime() + span.totalseconds());
+}
+
+/*!
+    @brief  Subtract a TimeSpan from the DateTime object
+    @param span TimeSpan object
+    @return New DateTime object with span subtracted from it.
+*/
+constexpr DateTime DateTime::operator-(const TimeSpan &span) const {
+  return DateTime(unixtime() - span.totalseconds());
+}
+
+/*!
+    @brief  Subtract one DateTime from another
+
+    @note Since a TimeSpan cannot be negative, the subtracted DateTime
+        should be less (earlier) than or equal to the one it is
+        subtracted from.
+
+    @param right The DateTime object to subtract from self (the left object)
+    @return TimeSpan of the difference between DateTimes.
+*/
+constexpr TimeSpan DateTime::operator-(const DateTime &right) const {
+  return TimeSpan(unixtime() - right.unixtime());
+}
+
 /**************************************************************************/
 /*!
     @brief  A generic I2C RTC base class. DO NOT USE DIRECTLY
 */
 /**************************************************************************/
 class RTC_I2C {
+public:
+  bool setBus(Adafruit_I2CBus *bus, uint8_t priority = I2C_PRIORITY_HIGH);
+
 protected:
   /*!
       @brief  Convert a binary coded decimal value to binary. RTC stores
@@ -350,6 +610,7 @@ protected:
 /**************************************************************************/
 class RTC_DS1307 : RTC_I2C {
 public:
+  using RTC_I2C::setBus;
   bool begin(TwoWire *wireInstance = &Wire);
   void adjust(const DateTime &dt);
   uint8_t isrunning(void);
@@ -369,6 +630,7 @@ public:
 /**************************************************************************/
 class RTC_DS3231 : RTC_I2C {
 public:
+  using RTC_I2C::setBus;
   bool begin(TwoWire *wireInstance = &Wire);
   void adjust(const DateTime &dt);
   bool lostPower(void);
@@ -388,6 +650,8 @@ public:
   void disable32K(void);
   bool isEnabled32K(void);
   float getTemperature(); // in Celsius degree
+  int8_t getAgingOffset();
+  void setAgingOffset(int8_t offset);
   /*!
       @brief  Convert the day of the week to a representation suitable for
               storing in the DS3231: from 1 (Monday) to 7 (Sunday).
@@ -405,6 +669,7 @@ public:
 /**************************************************************************/
 class RTC_PCF8523 : RTC_I2C {
 public:
+  using RTC_I2C::setBus;
   bool begin(TwoWire *wireInstance = &Wire);
   void adjust(const DateTime &dt);
   bool lostPower(void);
@@ -432,6 +697,7 @@ public:
 /**************************************************************************/
 class RTC_PCF8563 : RTC_I2C {
 public:
+  using RTC_I2C::setBus;
   bool begin(TwoWire *wireInstance = &Wire);
   bool lostPower(void);
   void adjust(const DateTime &dt);
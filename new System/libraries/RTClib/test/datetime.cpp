@@ -0,0 +1,259 @@
+/*
+ * DateTime conversions against the original loop based implementation,
+ * every day from 2000 to 2099, the next occurrence queries, and a
+ * benchmark.
+ *
+ * Build & run (from the library root):
+ *   c++ -std=gnu++11 -O2 -I../../test -Itest/host -Isrc test/datetime.cpp src/RTClib.cpp -o datetime
+ *   ./datetime          # tests
+ *   ./datetime bench    # conversions per second
+ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "RTClib.h"
+#include "host_test.h"
+
+/*
+ * Conversions done at compile time
+ */
+
+static_assert(DateTime(2024, 2, 29, 12, 30, 15).unixtime() == 1709209815,
+              "unixtime()");
+static_assert(DateTime(1709209815).month() == 2 &&
+                  DateTime(1709209815).day() == 29 &&
+                  DateTime(1709209815).hour() == 12,
+              "DateTime(uint32_t)");
+static_assert(DateTime(2000, 1, 1).dayOfTheWeek() == 6, "dayOfTheWeek()");
+static_assert(DateTime(2024, 1, 31, 23).nextTime(7, 30).unixtime() ==
+                  DateTime(2024, 2, 1, 7, 30).unixtime(),
+              "nextTime()");
+static_assert((DateTime(2024, 3, 1) - TimeSpan(1, 0, 0, 0)).day() == 29,
+              "operator-(TimeSpan)");
+
+/*
+ * Reference: the original implementation
+ */
+
+static const uint8_t refDaysInMonth[] = {31, 28, 31, 30, 31, 30,
+                                         31, 31, 30, 31, 30};
+
+static uint16_t ref_date2days(uint16_t y, uint8_t m, uint8_t d) {
+  uint16_t days = d;
+  for (uint8_t i = 1; i < m; ++i)
+    days += refDaysInMonth[i - 1];
+  if (m > 2 && y % 4 == 0)
+    ++days;
+  return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+struct RefDate {
+  uint8_t yOff, m, d, hh, mm, ss;
+};
+
+static RefDate ref_from_unix(uint32_t t) {
+  RefDate r;
+  t -= SECONDS_FROM_1970_TO_2000;
+  r.ss = t % 60;
+  t /= 60;
+  r.mm = t % 60;
+  t /= 60;
+  r.hh = t % 24;
+  uint16_t days = t / 24;
+  uint8_t leap;
+  for (r.yOff = 0;; ++r.yOff) {
+    leap = r.yOff % 4 == 0;
+    if (days < 365U + leap)
+      break;
+    days -= 365 + leap;
+  }
+  for (r.m = 1; r.m < 12; ++r.m) {
+    uint8_t daysPerMonth = refDaysInMonth[r.m - 1];
+    if (leap && r.m == 2)
+      ++daysPerMonth;
+    if (days < daysPerMonth)
+      break;
+    days -= daysPerMonth;
+  }
+  r.d = days + 1;
+  return r;
+}
+
+static uint32_t ref_unixtime(const RefDate &r) {
+  uint16_t days = ref_date2days(r.yOff, r.m, r.d);
+  return ((days * 24UL + r.hh) * 60 + r.mm) * 60 + r.ss +
+         SECONDS_FROM_1970_TO_2000;
+}
+
+static bool same(const DateTime &dt, const RefDate &r) {
+  return dt.year() == 2000U + r.yOff && dt.month() == r.m && dt.day() == r.d &&
+         dt.hour() == r.hh && dt.minute() == r.mm && dt.second() == r.ss;
+}
+
+static void test_every_day() {
+  printf("every day 2000-2099 == reference, both ways\n");
+  const uint32_t first = SECONDS_FROM_1970_TO_2000;
+  const uint32_t days = 36525;
+  int mismatches = 0;
+
+  for (uint32_t day = 0; day < days; day++) {
+    // Both ends of the day and a few seconds in between
+    static const uint32_t times[] = {0, 1, 59, 3599, 43200, 86340, 86399};
+    for (uint32_t time : times) {
+      uint32_t t = first + day * 86400 + time;
+      RefDate r = ref_from_unix(t);
+      DateTime dt(t);
+      DateTime built(2000 + r.yOff, r.m, r.d, r.hh, r.mm, r.ss);
+      if (!same(dt, r) || dt.unixtime() != t || built.unixtime() != t ||
+          dt.secondstime() != t - first ||
+          dt.dayOfTheWeek() != (day + 6) % 7 || !dt.isValid()) {
+        if (mismatches++ < 5)
+          printf("  mismatch at %u\n", (unsigned)t);
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+
+  // Every second of one day
+  mismatches = 0;
+  for (uint32_t time = 0; time < 86400; time++) {
+    uint32_t t = first + 9000UL * 86400 + time;
+    if (!same(DateTime(t), ref_from_unix(t)) || DateTime(t).unixtime() != t)
+      mismatches++;
+  }
+  CHECK(mismatches == 0);
+
+  CHECK(DateTime(2099, 12, 31, 23, 59, 59).unixtime() == 4102444799UL);
+  CHECK(DateTime(4102444799UL) == DateTime(2099, 12, 31, 23, 59, 59));
+  CHECK(DateTime() == DateTime(2000, 1, 1));
+}
+
+static void test_invalid() {
+  printf("invalid dates are rejected\n");
+  CHECK(!DateTime(2023, 2, 29).isValid());
+  CHECK(DateTime(2024, 2, 29).isValid());
+  CHECK(!DateTime(2024, 2, 30).isValid());
+  CHECK(!DateTime(2024, 4, 31).isValid());
+  CHECK(!DateTime(2024, 13, 1).isValid());
+  CHECK(!DateTime(2024, 0, 1).isValid());
+  CHECK(!DateTime(2024, 1, 0).isValid());
+  CHECK(!DateTime(2024, 1, 1, 24).isValid());
+  CHECK(!DateTime(2100, 1, 1).isValid());
+}
+
+static void test_next() {
+  printf("next time of day, day of the week and interval\n");
+  const DateTime now(2024, 2, 28, 7, 30, 0); // a Wednesday
+
+  CHECK(now.nextTime(7, 31) == DateTime(2024, 2, 28, 7, 31));
+  CHECK(now.nextTime(7, 30) == DateTime(2024, 2, 29, 7, 30)); // not now
+  CHECK(now.nextTime(7, 29, 59) == DateTime(2024, 2, 29, 7, 29, 59));
+  CHECK(now.nextTime(0, 0) == DateTime(2024, 2, 29));
+  CHECK(DateTime(2023, 12, 31, 23, 59, 59).nextTime(0, 0) ==
+        DateTime(2024, 1, 1));
+  CHECK(DateTime(2023, 2, 28, 12).nextTime(6, 0) == DateTime(2023, 3, 1, 6));
+
+  CHECK(now.dayOfTheWeek() == 3);
+  CHECK(now.nextDayOfTheWeek(3, 8) == DateTime(2024, 2, 28, 8));
+  CHECK(now.nextDayOfTheWeek(3, 7, 30) == DateTime(2024, 3, 6, 7, 30));
+  CHECK(now.nextDayOfTheWeek(3, 6) == DateTime(2024, 3, 6, 6));
+  CHECK(now.nextDayOfTheWeek(4) == DateTime(2024, 2, 29));
+  CHECK(now.nextDayOfTheWeek(2, 23, 59) == DateTime(2024, 3, 5, 23, 59));
+  CHECK(now.nextDayOfTheWeek(0) == DateTime(2024, 3, 3));
+
+  CHECK(now.nextInterval(15 * 60) == DateTime(2024, 2, 28, 7, 45));
+  CHECK(DateTime(2024, 2, 28, 7, 44, 59).nextInterval(15 * 60) ==
+        DateTime(2024, 2, 28, 7, 45));
+  CHECK(now.nextInterval(3600) == DateTime(2024, 2, 28, 8));
+  CHECK(now.nextInterval(86400) == DateTime(2024, 2, 29));
+  CHECK(now.nextInterval(0) == now);
+
+  // Against a brute force search, every 7 minutes for a few weeks
+  int mismatches = 0;
+  for (uint32_t t = DateTime(2028, 2, 20).unixtime();
+       t < DateTime(2028, 3, 20).unixtime(); t += 7 * 60) {
+    DateTime at(t);
+    uint8_t dow = t / 86400 % 7;
+    DateTime nt = at.nextTime(6, 15);
+    DateTime nd = at.nextDayOfTheWeek(dow, 18);
+    uint32_t u = t + 1;
+    while (DateTime(u).hour() != 6 || DateTime(u).minute() != 15 ||
+           DateTime(u).second() != 0)
+      u += 1;
+    if (nt.unixtime() != u)
+      mismatches++;
+    u = t + 1;
+    while (DateTime(u).dayOfTheWeek() != dow || DateTime(u).hour() != 18 ||
+           DateTime(u).minute() != 0 || DateTime(u).second() != 0)
+      u += 60 - DateTime(u).second();
+    if (nd.unixtime() != u)
+      mismatches++;
+  }
+  CHECK(mismatches == 0);
+}
+
+/*
+ * Benchmark
+ */
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(void) {
+  enum { COUNT = 1 << 16, ROUNDS = 100 };
+  static uint32_t times[COUNT];
+  srand(1);
+  for (int i = 0; i < COUNT; i++)
+    times[i] = SECONDS_FROM_1970_TO_2000 + (uint32_t)rand() % 3155760000UL;
+
+  volatile uint32_t sink = 0;
+  double t = now_s();
+  for (int r = 0; r < ROUNDS; r++)
+    for (int i = 0; i < COUNT; i++)
+      sink += ref_from_unix(times[i]).d;
+  double ref = now_s() - t;
+  t = now_s();
+  for (int r = 0; r < ROUNDS; r++)
+    for (int i = 0; i < COUNT; i++)
+      sink += DateTime(times[i]).day();
+  double fast = now_s() - t;
+  printf("DateTime(uint32_t): %6.1f vs %6.1f M/s\n", COUNT * ROUNDS / ref / 1e6,
+         COUNT * ROUNDS / fast / 1e6);
+
+  static RefDate refs[COUNT];
+  static DateTime dates[COUNT];
+  for (int i = 0; i < COUNT; i++) {
+    refs[i] = ref_from_unix(times[i]);
+    dates[i] = DateTime(times[i]);
+  }
+  t = now_s();
+  for (int r = 0; r < ROUNDS; r++)
+    for (int i = 0; i < COUNT; i++)
+      sink += ref_unixtime(refs[i]);
+  ref = now_s() - t;
+  t = now_s();
+  for (int r = 0; r < ROUNDS; r++)
+    for (int i = 0; i < COUNT; i++)
+      sink += dates[i].unixtime();
+  fast = now_s() - t;
+  printf("unixtime():         %6.1f vs %6.1f M/s\n", COUNT * ROUNDS / ref / 1e6,
+         COUNT * ROUNDS / fast / 1e6);
+  (void)sink;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    bench();
+    return 0;
+  }
+
+  test_every_day();
+  test_invalid();
+  test_next();
+
+  return test_summary();
+}
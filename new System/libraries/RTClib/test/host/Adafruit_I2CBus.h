@@ -0,0 +1,13 @@
+// Declarations RTClib.h needs; the bus manager is never used here
+#pragma once
+
+#include "Adafruit_I2CDevice.h"
+
+typedef enum {
+  I2C_PRIORITY_HIGH = 0,
+  I2C_PRIORITY_NORMAL,
+  I2C_PRIORITY_LOW,
+  I2C_PRIORITIES
+} i2c_priority_t;
+
+class Adafruit_I2CBus;
@@ -0,0 +1,25 @@
+// Minimal Arduino core for building the DateTime code on a POSIX host
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+
+using std::min;
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define memcpy_P memcpy
+
+class __FlashStringHelper;
+
+class String {
+public:
+  String(const char *s = "") : _s(s) {}
+  const char *c_str() const { return _s.c_str(); }
+
+private:
+  std::string _s;
+};
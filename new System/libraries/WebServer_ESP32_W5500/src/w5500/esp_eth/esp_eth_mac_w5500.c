@@ -45,6 +45,8 @@
 #include "esp_intr_alloc.h"
 #include "esp_heap_caps.h"
 #include "esp_rom_gpio.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -60,6 +62,23 @@ static const char *TAG = "w5500.mac";
 #define W5500_TX_MEM_SIZE (0x4000)
 #define W5500_RX_MEM_SIZE (0x4000)
 
+// The W5500 accepts a command within a few SPI clocks, so command and
+// TX done polls busy-wait in microseconds and only start sleeping once
+// an operation takes longer than W5500_POLL_SPIN_US
+#define W5500_POLL_INTERVAL_US (2)
+#define W5500_POLL_SPIN_US     (500)
+
+// A full frame takes 1.2 ms on the wire at 10 Mbps
+#define W5500_SEND_TIMEOUT_MS  (10)
+
+// Receive buffers take a whole number of 4 byte words: the SPI DMA then
+// writes straight into them instead of going through a bounce buffer
+#define W5500_ALIGN_UP(len)    (((len) + 3) & ~3)
+#define W5500_RX_BUFFER_SIZE   W5500_ALIGN_UP(ETH_MAX_PACKET_SIZE + 2)
+
+// Transactions chained under one lock, see w5500_transfer()
+#define W5500_MAX_CHAINED      (3)
+
 ////////////////////////////////////////
 
 typedef struct
@@ -73,6 +92,15 @@ typedef struct
   int int_gpio_num;
   uint8_t addr[6];
   bool packets_remain;
+
+  // Only this driver moves SOCK0 RX_RD and TX_WR, so they are read from
+  // the chip once after OPEN and tracked here afterwards
+  uint16_t rx_rd;
+  uint16_t tx_wr;
+  bool rx_rd_valid;
+  bool tx_wr_valid;
+  bool tx_idle;               // last SEND completed: the whole TX memory is free
+  uint32_t spi_transactions;  // for diagnostics and the host tests
 } emac_w5500_t;
 
 ////////////////////////////////////////
@@ -91,99 +119,213 @@ static inline bool w5500_unlock(emac_w5500_t *emac)
 
 ////////////////////////////////////////
 
-static esp_err_t w5500_write(emac_w5500_t *emac, uint32_t address, const void *value, uint32_t len)
+static void w5500_trans_write(spi_transaction_t *trans, uint32_t address, const void *value, uint32_t len)
 {
-  esp_err_t ret = ESP_OK;
+  memset(trans, 0, sizeof(*trans));
+  trans->cmd = (address >> W5500_ADDR_OFFSET);
+  trans->addr = ((address & 0xFFFF) | (W5500_ACCESS_MODE_WRITE << W5500_RWB_OFFSET) | W5500_SPI_OP_MODE_VDM);
+  trans->length = 8 * len;
 
-  spi_transaction_t trans =
+  if (len <= 4)
   {
-    .cmd = (address >> W5500_ADDR_OFFSET),
-    .addr = ((address & 0xFFFF) | (W5500_ACCESS_MODE_WRITE << W5500_RWB_OFFSET) | W5500_SPI_OP_MODE_VDM),
-    .length = 8 * len,
-    .tx_buffer = value
-  };
-
-  if (w5500_lock(emac))
+    // registers go in the transaction itself, no DMA descriptor needed
+    trans->flags = SPI_TRANS_USE_TXDATA;
+    memcpy(trans->tx_data, value, len);
+  }
+  else
   {
-    if (spi_device_polling_transmit(emac->spi_hdl, &trans) != ESP_OK)
-    {
-      ESP_LOGE(TAG, "%s(%d): SPI transmit failed", __FUNCTION__, __LINE__);
-      ret = ESP_FAIL;
-    }
+    trans->tx_buffer = value;
+  }
+}
+
+////////////////////////////////////////
 
-    w5500_unlock(emac);
+static void w5500_trans_read(spi_transaction_t *trans, uint32_t address, void *value, uint32_t len)
+{
+  memset(trans, 0, sizeof(*trans));
+  trans->cmd = (address >> W5500_ADDR_OFFSET);
+  trans->addr = ((address & 0xFFFF) | (W5500_ACCESS_MODE_READ << W5500_RWB_OFFSET) | W5500_SPI_OP_MODE_VDM);
+  trans->length = 8 * len;
+  trans->user = value;
+
+  if (len <= 4)
+  {
+    // use direct reads for registers to prevent overwrites by 4-byte boundary writes
+    trans->flags = SPI_TRANS_USE_RXDATA;
   }
   else
   {
-    ret = ESP_ERR_TIMEOUT;
+    trans->rx_buffer = value;
   }
-
-  return ret;
 }
 
 ////////////////////////////////////////
 
-static esp_err_t w5500_read(emac_w5500_t *emac, uint32_t address, void *value, uint32_t len)
+// Runs the transactions back to back under one lock. A single one is
+// polled, the cheapest way for a short access; several are queued at once
+// so the SPI driver chains them without a round trip through this task.
+static esp_err_t w5500_transfer(emac_w5500_t *emac, spi_transaction_t *trans, int count)
 {
   esp_err_t ret = ESP_OK;
+  int queued = 0;
 
-  spi_transaction_t trans =
+  if (!w5500_lock(emac))
   {
-    // use direct reads for registers to prevent overwrites by 4-byte boundary writes
-    .flags = len <= 4 ? SPI_TRANS_USE_RXDATA : 0,
-    .cmd = (address >> W5500_ADDR_OFFSET),
-    .addr = ((address & 0xFFFF) | (W5500_ACCESS_MODE_READ << W5500_RWB_OFFSET) | W5500_SPI_OP_MODE_VDM),
-    .length = 8 * len,
-    .rx_buffer = value
-  };
+    return ESP_ERR_TIMEOUT;
+  }
 
-  if (w5500_lock(emac))
+  if (count == 1)
+  {
+    ret = spi_device_polling_transmit(emac->spi_hdl, trans);
+  }
+  else
   {
-    if (spi_device_polling_transmit(emac->spi_hdl, &trans) != ESP_OK)
+    while (queued < count && ret == ESP_OK)
     {
-      ESP_LOGE(TAG, "%s(%d): SPI transmit failed", __FUNCTION__, __LINE__);
-      ret = ESP_FAIL;
+      ret = spi_device_queue_trans(emac->spi_hdl, &trans[queued], portMAX_DELAY);
+
+      if (ret == ESP_OK)
+      {
+        queued++;
+      }
     }
 
-    w5500_unlock(emac);
+    // collect what was queued even after a failure
+    while (queued--)
+    {
+      spi_transaction_t *done = NULL;
+
+      if (spi_device_get_trans_result(emac->spi_hdl, &done, portMAX_DELAY) != ESP_OK)
+      {
+        ret = ESP_FAIL;
+      }
+    }
   }
-  else
+
+  emac->spi_transactions += count;
+  w5500_unlock(emac);
+
+  if (ret != ESP_OK)
   {
-    ret = ESP_ERR_TIMEOUT;
+    ESP_LOGE(TAG, "%s(%d): SPI transmit failed", __FUNCTION__, __LINE__);
+
+    return ESP_FAIL;
   }
 
-  if ((trans.flags & SPI_TRANS_USE_RXDATA) && len <= 4)
+  for (int i = 0; i < count; i++)
   {
-    memcpy(value, trans.rx_data, len);  // copy register values to output
+    if ((trans[i].flags & SPI_TRANS_USE_RXDATA) && trans[i].user)
+    {
+      memcpy(trans[i].user, trans[i].rx_data, trans[i].length / 8);  // copy register values to output
+    }
   }
 
-  return ret;
+  return ESP_OK;
 }
 
 ////////////////////////////////////////
 
-static esp_err_t w5500_send_command(emac_w5500_t *emac, uint8_t command, uint32_t timeout_ms)
+static esp_err_t w5500_write(emac_w5500_t *emac, uint32_t address, const void *value, uint32_t len)
 {
-  esp_err_t ret = ESP_OK;
+  spi_transaction_t trans;
 
-  ESP_GOTO_ON_ERROR(w5500_write(emac, W5500_REG_SOCK_CR(0), &command, sizeof(command)), err, TAG, "Write SCR failed");
+  w5500_trans_write(&trans, address, value, len);
 
-  // after W5500 accepts the command, the command register will be cleared automatically
-  uint32_t to = 0;
+  return w5500_transfer(emac, &trans, 1);
+}
+
+////////////////////////////////////////
+
+static esp_err_t w5500_read(emac_w5500_t *emac, uint32_t address, void *value, uint32_t len)
+{
+  spi_transaction_t trans;
+
+  w5500_trans_read(&trans, address, value, len);
+
+  return w5500_transfer(emac, &trans, 1);
+}
+
+////////////////////////////////////////
 
-  for (to = 0; to < timeout_ms / 10; to++)
+// Poll an 8-bit register until (value & mask) == expect, for at most
+// timeout_us. Spins for the first W5500_POLL_SPIN_US, then sleeps a tick
+// between reads.
+static esp_err_t w5500_wait_reg(emac_w5500_t *emac, uint32_t address, uint8_t mask, uint8_t expect,
+                                uint32_t timeout_us)
+{
+  esp_err_t ret = ESP_OK;
+  uint8_t value = 0;
+  int64_t start = esp_timer_get_time();
+
+  for (;;)
   {
-    ESP_GOTO_ON_ERROR(w5500_read(emac, W5500_REG_SOCK_CR(0), &command, sizeof(command)), err, TAG, "Read SCR failed");
+    ESP_GOTO_ON_ERROR(w5500_read(emac, address, &value, sizeof(value)), err, TAG, "Read register failed");
 
-    if (!command)
+    if ((value & mask) == expect)
     {
       break;
     }
 
-    vTaskDelay(pdMS_TO_TICKS(10));
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    if (elapsed >= timeout_us)
+    {
+      return ESP_ERR_TIMEOUT;
+    }
+
+    if (elapsed < W5500_POLL_SPIN_US)
+    {
+      esp_rom_delay_us(W5500_POLL_INTERVAL_US);
+    }
+    else
+    {
+      vTaskDelay(1);
+    }
   }
 
-  ESP_GOTO_ON_FALSE(to < timeout_ms / 10, ESP_ERR_TIMEOUT, err, TAG, "Send command timeout");
+err:
+  return ret;
+}
+
+////////////////////////////////////////
+
+static esp_err_t w5500_send_command(emac_w5500_t *emac, uint8_t command, uint32_t timeout_ms)
+{
+  esp_err_t ret = ESP_OK;
+
+  ESP_GOTO_ON_ERROR(w5500_write(emac, W5500_REG_SOCK_CR(0), &command, sizeof(command)), err, TAG, "Write SCR failed");
+
+  // after W5500 accepts the command, the command register will be cleared automatically
+  ESP_GOTO_ON_ERROR(w5500_wait_reg(emac, W5500_REG_SOCK_CR(0), 0xFF, 0, timeout_ms * 1000), err, TAG,
+                    "Send command timeout");
+
+err:
+  return ret;
+}
+
+////////////////////////////////////////
+
+// Write a 16-bit pointer register and issue a command in one chained
+// burst, reading the command register back in the same burst. Usually the
+// command is already accepted by then and no further poll is needed.
+static esp_err_t w5500_commit_command(emac_w5500_t *emac, uint32_t ptr_address, uint16_t ptr, uint8_t command)
+{
+  esp_err_t ret = ESP_OK;
+  spi_transaction_t trans[W5500_MAX_CHAINED];
+  uint8_t pending = 0;
+
+  ptr = __builtin_bswap16(ptr);
+  w5500_trans_write(&trans[0], ptr_address, &ptr, sizeof(ptr));
+  w5500_trans_write(&trans[1], W5500_REG_SOCK_CR(0), &command, sizeof(command));
+  w5500_trans_read(&trans[2], W5500_REG_SOCK_CR(0), &pending, sizeof(pending));
+
+  ESP_GOTO_ON_ERROR(w5500_transfer(emac, trans, 3), err, TAG, "Issue command failed");
+
+  if (pending)
+  {
+    ESP_GOTO_ON_ERROR(w5500_wait_reg(emac, W5500_REG_SOCK_CR(0), 0xFF, 0, 100 * 1000), err, TAG,
+                      "Send command timeout");
+  }
 
 err:
   return ret;
@@ -233,6 +375,56 @@ err:
 
 ////////////////////////////////////////
 
+static esp_err_t w5500_get_rx_rd(emac_w5500_t *emac, uint16_t *offset)
+{
+  esp_err_t ret = ESP_OK;
+
+  if (!emac->rx_rd_valid)
+  {
+    ESP_GOTO_ON_ERROR(w5500_read(emac, W5500_REG_SOCK_RX_RD(0), &emac->rx_rd, sizeof(emac->rx_rd)), err, TAG,
+                      "Read RX RD failed");
+    emac->rx_rd = __builtin_bswap16(emac->rx_rd);
+    emac->rx_rd_valid = true;
+  }
+
+  *offset = emac->rx_rd;
+
+err:
+  return ret;
+}
+
+////////////////////////////////////////
+
+static esp_err_t w5500_get_tx_wr(emac_w5500_t *emac, uint16_t *offset)
+{
+  esp_err_t ret = ESP_OK;
+
+  if (!emac->tx_wr_valid)
+  {
+    ESP_GOTO_ON_ERROR(w5500_read(emac, W5500_REG_SOCK_TX_WR(0), &emac->tx_wr, sizeof(emac->tx_wr)), err, TAG,
+                      "Read TX WR failed");
+    emac->tx_wr = __builtin_bswap16(emac->tx_wr);
+    emac->tx_wr_valid = true;
+  }
+
+  *offset = emac->tx_wr;
+
+err:
+  return ret;
+}
+
+////////////////////////////////////////
+
+// OPEN and CLOSE reinitialize the socket pointers
+static void w5500_forget_pointers(emac_w5500_t *emac)
+{
+  emac->rx_rd_valid = false;
+  emac->tx_wr_valid = false;
+  emac->tx_idle = false;
+}
+
+////////////////////////////////////////
+
 static esp_err_t w5500_write_buffer(emac_w5500_t *emac, const void *buffer, uint32_t len, uint16_t offset)
 {
   esp_err_t ret = ESP_OK;
@@ -317,6 +509,7 @@ static esp_err_t w5500_reset(emac_w5500_t *emac)
   }
 
   ESP_GOTO_ON_FALSE(to < emac->sw_reset_timeout_ms / 10, ESP_ERR_TIMEOUT, err, TAG, "Reset timeout");
+  w5500_forget_pointers(emac);
 
 err:
   return ret;
@@ -397,6 +590,7 @@ static esp_err_t emac_w5500_start(esp_eth_mac_t *mac)
   uint8_t reg_value = 0;
   /* open SOCK0 */
   ESP_GOTO_ON_ERROR(w5500_send_command(emac, W5500_SCR_OPEN, 100), err, TAG, "Issue OPEN command failed");
+  w5500_forget_pointers(emac);
 
   /* enable interrupt for SOCK0 */
   reg_value = W5500_SIMR_SOCK0;
@@ -416,6 +610,7 @@ static esp_err_t emac_w5500_stop(esp_eth_mac_t *mac)
   ESP_GOTO_ON_ERROR(w5500_write(emac, W5500_REG_SIMR, &reg_value, sizeof(reg_value)), err, TAG, "Write SIMR failed");
   /* close SOCK0 */
   ESP_GOTO_ON_ERROR(w5500_send_command(emac, W5500_SCR_CLOSE, 100), err, TAG, "Issue SCR_CLOSE command failed");
+  w5500_forget_pointers(emac);
 
 err:
   return ret;
@@ -439,12 +634,108 @@ IRAM_ATTR static void w5500_isr_handler(void *arg)
 
 ////////////////////////////////////////
 
+// Drain every frame the W5500 holds. RX_RSR is read once, each payload
+// is read together with the length header of the frame after it, and
+// RX_RD is handed back with a single RECV command for the whole batch.
+static esp_err_t w5500_drain_rx(emac_w5500_t *emac)
+{
+  esp_err_t ret = ESP_OK;
+  uint16_t remain_bytes = 0;
+  uint16_t offset = 0;
+  uint16_t header = 0;
+  uint16_t frame_len = 0;
+  uint8_t *buffer = NULL;
+
+  ESP_GOTO_ON_ERROR(w5500_get_rx_received_size(emac, &remain_bytes), err, TAG, "Get RX size failed");
+
+  if (!remain_bytes)
+  {
+    return ESP_OK;
+  }
+
+  ESP_GOTO_ON_ERROR(w5500_get_rx_rd(emac, &offset), err, TAG, "Get RX RD failed");
+  ESP_GOTO_ON_ERROR(w5500_read_buffer(emac, &header, sizeof(header), offset), err, TAG, "Read frame header failed");
+
+  frame_len = __builtin_bswap16(header); // data size includes 2 bytes of header
+
+  while (remain_bytes)
+  {
+    if (frame_len <= 2 || frame_len > remain_bytes || frame_len - 2 > ETH_MAX_PACKET_SIZE)
+    {
+      // out of step with the frame headers, drop everything received
+      ESP_LOGE(TAG, "Bad frame length %d, dropping %d bytes", frame_len, remain_bytes);
+      offset += remain_bytes;
+      break;
+    }
+
+    uint16_t rx_len = frame_len - 2;
+    remain_bytes -= frame_len;
+
+    buffer = heap_caps_malloc(W5500_RX_BUFFER_SIZE, MALLOC_CAP_DMA);
+
+    if (!buffer)
+    {
+      // the rest stays in the W5500 for the next interrupt
+      ESP_LOGE(TAG, "No mem for receive buffer");
+      break;
+    }
+
+    // read the payload, plus the next header when another frame follows
+    uint32_t read_len = rx_len + (remain_bytes ? sizeof(header) : 0);
+    ESP_GOTO_ON_ERROR(w5500_read_buffer(emac, buffer, W5500_ALIGN_UP(read_len), offset + 2), err, TAG,
+                      "Read payload failed, len=%d, offset=%d", rx_len, offset);
+
+    offset += frame_len;
+
+    if (remain_bytes)
+    {
+      memcpy(&header, buffer + rx_len, sizeof(header));
+      frame_len = __builtin_bswap16(header);
+    }
+
+    /* pass the buffer to stack (e.g. TCP/IP layer) */
+    emac->eth->stack_input(emac->eth, buffer, rx_len);
+    buffer = NULL;
+  }
+
+  if (offset != emac->rx_rd)
+  {
+    ESP_GOTO_ON_ERROR(w5500_commit_command(emac, W5500_REG_SOCK_RX_RD(0), offset, W5500_SCR_RECV), err, TAG,
+                      "Issue RECV command failed");
+    emac->rx_rd = offset;
+  }
+
+err:
+  free(buffer);
+
+  return ret;
+}
+
+////////////////////////////////////////
+
+static void w5500_handle_interrupt(emac_w5500_t *emac)
+{
+  uint8_t status = 0;
+
+  /* read interrupt status */
+  w5500_read(emac, W5500_REG_SOCK_IR(0), &status, sizeof(status));
+
+  /* packet received */
+  if (status & W5500_SIR_RECV)
+  {
+    status = W5500_SIR_RECV;
+    // clear interrupt status before draining, so a frame arriving meanwhile raises it again
+    w5500_write(emac, W5500_REG_SOCK_IR(0), &status, sizeof(status));
+
+    w5500_drain_rx(emac);
+  }
+}
+
+////////////////////////////////////////
+
 static void emac_w5500_task(void *arg)
 {
   emac_w5500_t *emac = (emac_w5500_t *)arg;
-  uint8_t status = 0;
-  uint8_t *buffer = NULL;
-  uint32_t length = 0;
 
   while (1)
   {
@@ -456,44 +747,7 @@ static void emac_w5500_task(void *arg)
       continue;                                                // -> just continue to check again
     }
 
-    /* read interrupt status */
-    w5500_read(emac, W5500_REG_SOCK_IR(0), &status, sizeof(status));
-
-    /* packet received */
-    if (status & W5500_SIR_RECV)
-    {
-      status = W5500_SIR_RECV;
-      // clear interrupt status
-      w5500_write(emac, W5500_REG_SOCK_IR(0), &status, sizeof(status));
-
-      do
-      {
-        length = ETH_MAX_PACKET_SIZE;
-        buffer = heap_caps_malloc(length, MALLOC_CAP_DMA);
-
-        if (!buffer)
-        {
-          ESP_LOGE(TAG, "No mem for receive buffer");
-          break;
-        }
-        else if (emac->parent.receive(&emac->parent, buffer, &length) == ESP_OK)
-        {
-          /* pass the buffer to stack (e.g. TCP/IP layer) */
-          if (length)
-          {
-            emac->eth->stack_input(emac->eth, buffer, length);
-          }
-          else
-          {
-            free(buffer);
-          }
-        }
-        else
-        {
-          free(buffer);
-        }
-      } while (emac->packets_remain);
-    }
+    w5500_handle_interrupt(emac);
   }
 
   vTaskDelete(NULL);
@@ -718,46 +972,60 @@ static esp_err_t emac_w5500_transmit(esp_eth_mac_t *mac, uint8_t *buf, uint32_t
   emac_w5500_t *emac = __containerof(mac, emac_w5500_t, parent);
   uint16_t offset = 0;
 
-  // check if there're free memory to store this packet
-  uint16_t free_size = 0;
-  ESP_GOTO_ON_ERROR(w5500_get_tx_free_size(emac, &free_size), err, TAG, "Get free size failed");
+  // check if there're free memory to store this packet. After a completed
+  // SEND the whole TX memory is free, no need to ask the W5500.
+  uint16_t free_size = W5500_TX_MEM_SIZE;
+
+  if (!emac->tx_idle)
+  {
+    ESP_GOTO_ON_ERROR(w5500_get_tx_free_size(emac, &free_size), err, TAG, "Get free size failed");
+  }
+
   ESP_GOTO_ON_FALSE(length <= free_size, ESP_ERR_NO_MEM, err, TAG, "Free size (%d) < send length (%d)", length,
                     free_size);
 
   // get current write pointer
-  ESP_GOTO_ON_ERROR(w5500_read(emac, W5500_REG_SOCK_TX_WR(0), &offset, sizeof(offset)), err, TAG, "Read TX WR failed");
-  offset = __builtin_bswap16(offset);
+  ESP_GOTO_ON_ERROR(w5500_get_tx_wr(emac, &offset), err, TAG, "Get TX WR failed");
 
   // copy data to tx memory
   ESP_GOTO_ON_ERROR(w5500_write_buffer(emac, buf, length, offset), err, TAG, "Write frame failed");
 
-  // update write pointer
+  // update write pointer and issue SEND command
   offset += length;
-  offset = __builtin_bswap16(offset);
-  ESP_GOTO_ON_ERROR(w5500_write(emac, W5500_REG_SOCK_TX_WR(0), &offset, sizeof(offset)), err, TAG, "Write TX WR failed");
-
-  // issue SEND command
-  ESP_GOTO_ON_ERROR(w5500_send_command(emac, W5500_SCR_SEND, 100), err, TAG, "Issue SEND command failed");
+  emac->tx_idle = false;
+  ESP_GOTO_ON_ERROR(w5500_commit_command(emac, W5500_REG_SOCK_TX_WR(0), offset, W5500_SCR_SEND), err, TAG,
+                    "Issue SEND command failed");
+  emac->tx_wr = offset;
 
-  // pooling the TX done event
-  int retry = 0;
-  uint8_t status = 0;
+  // poll the TX done event, checking the link once it is slow in coming
+  ret = w5500_wait_reg(emac, W5500_REG_SOCK_IR(0), W5500_SIR_SEND, W5500_SIR_SEND, W5500_POLL_SPIN_US);
 
-  while (!(status & W5500_SIR_SEND))
+  if (ret == ESP_ERR_TIMEOUT)
   {
-    ESP_GOTO_ON_ERROR(w5500_read(emac, W5500_REG_SOCK_IR(0), &status, sizeof(status)), err, TAG, "Read SOCK0 IR failed");
-
-    if ((retry++ > 3 && !is_w5500_sane_for_rxtx(emac)) || retry > 10)
+    if (!is_w5500_sane_for_rxtx(emac))
     {
       return ESP_FAIL;
     }
+
+    ret = w5500_wait_reg(emac, W5500_REG_SOCK_IR(0), W5500_SIR_SEND, W5500_SIR_SEND, W5500_SEND_TIMEOUT_MS * 1000);
   }
 
+  ESP_GOTO_ON_ERROR(ret, err, TAG, "SEND done timeout");
+
   // clear the event bit
-  status  = W5500_SIR_SEND;
+  uint8_t status = W5500_SIR_SEND;
   ESP_GOTO_ON_ERROR(w5500_write(emac, W5500_REG_SOCK_IR(0), &status, sizeof(status)), err, TAG, "Write SOCK0 IR failed");
 
+  emac->tx_idle = true;
+
 err:
+
+  if (ret != ESP_OK && ret != ESP_ERR_NO_MEM)
+  {
+    // the W5500 may or may not have taken the new write pointer
+    emac->tx_wr_valid = false;
+  }
+
   return ret;
 }
 
@@ -774,14 +1042,12 @@ static esp_err_t emac_w5500_receive(esp_eth_mac_t *mac, uint8_t *buf, uint32_t *
   uint16_t remain_bytes = 0;
   emac->packets_remain  = false;
 
-  w5500_get_rx_received_size(emac, &remain_bytes);
+  ESP_GOTO_ON_ERROR(w5500_get_rx_received_size(emac, &remain_bytes), err, TAG, "Get RX size failed");
 
   if (remain_bytes)
   {
     // get current read pointer
-    ESP_GOTO_ON_ERROR(w5500_read(emac, W5500_REG_SOCK_RX_RD(0), &offset, sizeof(offset)), err, TAG, "Read RX RD failed");
-
-    offset = __builtin_bswap16(offset);
+    ESP_GOTO_ON_ERROR(w5500_get_rx_rd(emac, &offset), err, TAG, "Get RX RD failed");
 
     // read head first
     ESP_GOTO_ON_ERROR(w5500_read_buffer(emac, &rx_len, sizeof(rx_len), offset), err, TAG, "Read frame header failed");
@@ -789,18 +1055,27 @@ static esp_err_t emac_w5500_receive(esp_eth_mac_t *mac, uint8_t *buf, uint32_t *
     rx_len = __builtin_bswap16(rx_len) - 2; // data size includes 2 bytes of header
     offset += 2;
 
-    // read the payload
-    ESP_GOTO_ON_ERROR(w5500_read_buffer(emac, buf, rx_len, offset), err, TAG, "Read payload failed, len=%d, offset=%d",
-                      rx_len, offset);
-
-    offset += rx_len;
+    if (rx_len > *length || rx_len + 2 > remain_bytes)
+    {
+      // out of step with the frame headers, drop everything received
+      ESP_LOGE(TAG, "Bad frame length %d, dropping %d bytes", rx_len, remain_bytes);
+      offset += remain_bytes - 2;
+      rx_len = 0;
+      remain_bytes = 2;
+    }
+    else
+    {
+      // read the payload
+      ESP_GOTO_ON_ERROR(w5500_read_buffer(emac, buf, rx_len, offset), err, TAG, "Read payload failed, len=%d, offset=%d",
+                        rx_len, offset);
 
-    // update read pointer
-    offset = __builtin_bswap16(offset);
-    ESP_GOTO_ON_ERROR(w5500_write(emac, W5500_REG_SOCK_RX_RD(0), &offset, sizeof(offset)), err, TAG, "Write RX RD failed");
+      offset += rx_len;
+    }
 
-    /* issue RECV command */
-    ESP_GOTO_ON_ERROR(w5500_send_command(emac, W5500_SCR_RECV, 100), err, TAG, "Issue RECV command failed");
+    // update read pointer and issue RECV command
+    ESP_GOTO_ON_ERROR(w5500_commit_command(emac, W5500_REG_SOCK_RX_RD(0), offset, W5500_SCR_RECV), err, TAG,
+                      "Issue RECV command failed");
+    emac->rx_rd = offset;
 
     // check if there're more data need to process
     remain_bytes -= rx_len + 2;
@@ -0,0 +1,230 @@
+/*
+ * Just enough of ESP-IDF to build the W5500 MAC driver on a host. SPI
+ * transactions, time and delays are provided by the test, which models
+ * the W5500 behind them.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK                0
+#define ESP_FAIL              -1
+#define ESP_ERR_NO_MEM        0x101
+#define ESP_ERR_INVALID_ARG   0x102
+#define ESP_ERR_INVALID_SIZE  0x104
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT       0x107
+
+#ifndef __containerof
+#define __containerof(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#endif
+
+#define IRAM_ATTR
+
+/*
+ * Logging and error checks
+ */
+
+extern int host_log_errors;
+
+#define ESP_LOGE(tag, fmt, ...) (host_log_errors++, host_log("E", tag, fmt, ##__VA_ARGS__))
+#define ESP_LOGW(tag, fmt, ...) host_log("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) host_log("I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) host_log("D", tag, fmt, ##__VA_ARGS__)
+
+void host_log(const char *level, const char *tag, const char *fmt, ...);
+
+#define ESP_GOTO_ON_ERROR(x, goto_tag, log_tag, format, ...) do {          \
+    esp_err_t err_rc_ = (x);                                              \
+    if (err_rc_ != ESP_OK) {                                              \
+      ESP_LOGE(log_tag, "%s(%d): " format, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+      ret = err_rc_;                                                      \
+      goto goto_tag;                                                      \
+    }                                                                     \
+  } while (0)
+
+#define ESP_GOTO_ON_FALSE(a, err_code, goto_tag, log_tag, format, ...) do { \
+    if (!(a)) {                                                           \
+      ESP_LOGE(log_tag, "%s(%d): " format, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+      ret = err_code;                                                     \
+      goto goto_tag;                                                      \
+    }                                                                     \
+  } while (0)
+
+/*
+ * FreeRTOS
+ */
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))  // 1 kHz tick
+#define portYIELD_FROM_ISR()
+
+void vTaskDelay(TickType_t ticks);
+
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                                 UBaseType_t prio, TaskHandle_t *handle, BaseType_t core)
+{
+  (void)fn; (void)name; (void)stack; (void)arg; (void)prio; (void)core;
+  *handle = (TaskHandle_t)1;
+  return pdPASS;
+}
+
+static inline void vTaskDelete(TaskHandle_t task) { (void)task; }
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) { (void)clear; (void)wait; return 1; }
+static inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) { (void)task; (void)woken; }
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) { return (SemaphoreHandle_t)1; }
+static inline void vSemaphoreDelete(SemaphoreHandle_t sem) { (void)sem; }
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) { (void)sem; (void)wait; return pdTRUE; }
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) { (void)sem; return pdTRUE; }
+
+static inline BaseType_t cpu_hal_get_core_id(void) { return 0; }
+
+/*
+ * Timer and delays, on the test's virtual clock
+ */
+
+int64_t esp_timer_get_time(void);
+void esp_rom_delay_us(uint32_t us);
+
+/*
+ * Heap
+ */
+
+#define MALLOC_CAP_DMA (1 << 3)
+#define heap_caps_malloc(size, caps) malloc(size)
+
+/*
+ * GPIO
+ */
+
+typedef int gpio_num_t;
+
+#define GPIO_MODE_INPUT   1
+#define GPIO_PULLUP_ONLY  0
+#define GPIO_INTR_NEGEDGE 2
+
+typedef void (*gpio_isr_t)(void *);
+
+static inline int gpio_get_level(int gpio) { (void)gpio; return 1; }
+static inline esp_err_t gpio_set_direction(int gpio, int mode) { (void)gpio; (void)mode; return ESP_OK; }
+static inline esp_err_t gpio_set_pull_mode(int gpio, int pull) { (void)gpio; (void)pull; return ESP_OK; }
+static inline esp_err_t gpio_set_intr_type(int gpio, int type) { (void)gpio; (void)type; return ESP_OK; }
+static inline esp_err_t gpio_intr_enable(int gpio) { (void)gpio; return ESP_OK; }
+static inline esp_err_t gpio_isr_handler_add(int gpio, gpio_isr_t isr, void *arg) { (void)gpio; (void)isr; (void)arg; return ESP_OK; }
+static inline esp_err_t gpio_isr_handler_remove(int gpio) { (void)gpio; return ESP_OK; }
+static inline esp_err_t gpio_reset_pin(int gpio) { (void)gpio; return ESP_OK; }
+static inline void esp_rom_gpio_pad_select_gpio(int gpio) { (void)gpio; }
+
+/*
+ * SPI master
+ */
+
+#define SPI_TRANS_USE_RXDATA (1 << 2)
+#define SPI_TRANS_USE_TXDATA (1 << 3)
+
+typedef struct
+{
+  uint32_t flags;
+  uint16_t cmd;
+  uint64_t addr;
+  size_t length;    // bits
+  size_t rxlength;
+  void *user;
+  union
+  {
+    const void *tx_buffer;
+    uint8_t tx_data[4];
+  };
+  union
+  {
+    void *rx_buffer;
+    uint8_t rx_data[4];
+  };
+} spi_transaction_t;
+
+typedef struct host_spi_device *spi_device_handle_t;
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans);
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans, TickType_t wait);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans, TickType_t wait);
+
+/*
+ * Ethernet driver framework
+ */
+
+#define ETH_MAX_PACKET_SIZE 1536
+#define ETH_MAC_FLAG_PIN_TO_CORE (1 << 1)
+
+typedef enum { ETH_LINK_UP, ETH_LINK_DOWN } eth_link_t;
+typedef enum { ETH_SPEED_10M, ETH_SPEED_100M } eth_speed_t;
+typedef enum { ETH_DUPLEX_HALF, ETH_DUPLEX_FULL } eth_duplex_t;
+typedef enum { ETH_STATE_LLINIT, ETH_STATE_DEINIT, ETH_STATE_LINK, ETH_STATE_SPEED, ETH_STATE_DUPLEX } esp_eth_state_t;
+
+typedef struct esp_eth_mediator_s esp_eth_mediator_t;
+
+struct esp_eth_mediator_s
+{
+  esp_err_t (*phy_reg_read)(esp_eth_mediator_t *eth, uint32_t phy_addr, uint32_t phy_reg, uint32_t *reg_value);
+  esp_err_t (*phy_reg_write)(esp_eth_mediator_t *eth, uint32_t phy_addr, uint32_t phy_reg, uint32_t reg_value);
+  esp_err_t (*stack_input)(esp_eth_mediator_t *eth, uint8_t *buffer, uint32_t length);
+  esp_err_t (*on_state_changed)(esp_eth_mediator_t *eth, esp_eth_state_t state, void *args);
+};
+
+typedef struct esp_eth_mac_s esp_eth_mac_t;
+
+struct esp_eth_mac_s
+{
+  esp_err_t (*set_mediator)(esp_eth_mac_t *mac, esp_eth_mediator_t *eth);
+  esp_err_t (*init)(esp_eth_mac_t *mac);
+  esp_err_t (*deinit)(esp_eth_mac_t *mac);
+  esp_err_t (*start)(esp_eth_mac_t *mac);
+  esp_err_t (*stop)(esp_eth_mac_t *mac);
+  esp_err_t (*transmit)(esp_eth_mac_t *mac, uint8_t *buf, uint32_t length);
+  esp_err_t (*receive)(esp_eth_mac_t *mac, uint8_t *buf, uint32_t *length);
+  esp_err_t (*read_phy_reg)(esp_eth_mac_t *mac, uint32_t phy_addr, uint32_t phy_reg, uint32_t *reg_value);
+  esp_err_t (*write_phy_reg)(esp_eth_mac_t *mac, uint32_t phy_addr, uint32_t phy_reg, uint32_t reg_value);
+  esp_err_t (*set_addr)(esp_eth_mac_t *mac, uint8_t *addr);
+  esp_err_t (*get_addr)(esp_eth_mac_t *mac, uint8_t *addr);
+  esp_err_t (*set_speed)(esp_eth_mac_t *mac, eth_speed_t speed);
+  esp_err_t (*set_duplex)(esp_eth_mac_t *mac, eth_duplex_t duplex);
+  esp_err_t (*set_link)(esp_eth_mac_t *mac, eth_link_t link);
+  esp_err_t (*set_promiscuous)(esp_eth_mac_t *mac, bool enable);
+  esp_err_t (*enable_flow_ctrl)(esp_eth_mac_t *mac, bool enable);
+  esp_err_t (*set_peer_pause_ability)(esp_eth_mac_t *mac, uint32_t ability);
+  esp_err_t (*del)(esp_eth_mac_t *mac);
+};
+
+typedef struct
+{
+  uint32_t sw_reset_timeout_ms;
+  uint32_t rx_task_stack_size;
+  uint32_t rx_task_prio;
+  int smi_mdc_gpio_num;
+  int smi_mdio_gpio_num;
+  uint32_t flags;
+} eth_mac_config_t;
+
+typedef struct
+{
+  spi_device_handle_t spi_hdl;
+  int int_gpio_num;
+} eth_w5500_config_t;
@@ -0,0 +1,708 @@
+/*
+ * W5500 MAC driver against a model of the chip's registers and socket
+ * buffers: batched receive across ring and pointer wrap-around, transmit,
+ * command polling, bad frame headers, and SPI transactions per frame.
+ *
+ * Build & run (from the library root):
+ *   cc -std=gnu11 -O2 -I../../test -Itest/host -Isrc/w5500/esp_eth test/w5500_mac.c -o w5500_mac
+ *   ./w5500_mac          # tests
+ *   ./w5500_mac bench    # SPI transactions and modelled bus time per frame
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "../src/w5500/esp_eth/esp_eth_mac_w5500.c"
+#include "host_test.h"
+
+/*
+ * Host environment
+ */
+
+int host_log_errors;
+static bool verbose;
+
+void host_log(const char *level, const char *tag, const char *fmt, ...)
+{
+  if (!verbose)
+  {
+    return;
+  }
+
+  va_list args;
+  va_start(args, fmt);
+  printf("  %s %s: ", level, tag);
+  vprintf(fmt, args);
+  printf("\n");
+  va_end(args);
+}
+
+// Bus model: a fixed cost per transaction (driver, CS, DMA setup) plus
+// 3 header bytes and the data at the SPI clock
+#define SIM_TRANS_OVERHEAD_US 10
+#define SIM_SPI_CLOCK_MHZ     20
+
+static struct
+{
+  uint8_t common[0x40];
+  uint8_t sock[0x30];
+  uint8_t tx[W5500_TX_MEM_SIZE];
+  uint8_t rx[W5500_RX_MEM_SIZE];
+
+  uint16_t rx_wr;        // where the next received frame goes
+  uint16_t tx_rd;        // what the chip has sent so far
+  uint16_t rx_rsr;
+
+  int cr_latency;        // reads of CR that still show a command
+  int cr_busy;
+  int send_latency;      // reads of IR before SEND_OK shows
+  int send_busy;
+  int reset_busy;
+
+  uint8_t sent[64][ETH_MAX_PACKET_SIZE];
+  uint16_t sent_len[64];
+  int sent_count;
+
+  uint32_t transactions;
+  uint32_t bytes;
+  uint32_t sleeps;
+  int64_t now_us;
+
+  spi_transaction_t *queued[8];
+  int queued_count;
+} sim;
+
+int64_t esp_timer_get_time(void)
+{
+  return sim.now_us;
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+  sim.now_us += us;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  sim.sleeps++;
+  sim.now_us += ticks * 1000;
+}
+
+static uint16_t sock_get16(uint8_t reg)
+{
+  return sim.sock[reg] << 8 | sim.sock[reg + 1];
+}
+
+static void sock_put16(uint8_t reg, uint16_t value)
+{
+  sim.sock[reg] = value >> 8;
+  sim.sock[reg + 1] = value & 0xFF;
+}
+
+#define SOCK(reg) ((W5500_REG_SOCK_##reg(0) >> W5500_ADDR_OFFSET) & 0xFF)
+
+static void sim_command(uint8_t command)
+{
+  switch (command)
+  {
+    case W5500_SCR_OPEN:
+      sim.sock[SOCK(SR)] = 0x42;  // MACRAW
+      sock_put16(SOCK(RX_RD), sim.rx_wr);
+      sock_put16(SOCK(TX_WR), sim.tx_rd);
+      sim.rx_rsr = 0;
+      break;
+
+    case W5500_SCR_CLOSE:
+      sim.sock[SOCK(SR)] = 0;
+      break;
+
+    case W5500_SCR_RECV:
+      sim.rx_rsr = sim.rx_wr - sock_get16(SOCK(RX_RD));
+      break;
+
+    case W5500_SCR_SEND:
+    {
+      uint16_t wr = sock_get16(SOCK(TX_WR));
+      uint16_t len = wr - sim.tx_rd;
+
+      if (sim.sent_count < 64 && len <= ETH_MAX_PACKET_SIZE)
+      {
+        for (uint16_t i = 0; i < len; i++)
+        {
+          sim.sent[sim.sent_count][i] = sim.tx[(uint16_t)(sim.tx_rd + i) % W5500_TX_MEM_SIZE];
+        }
+
+        sim.sent_len[sim.sent_count++] = len;
+      }
+
+      sim.tx_rd = wr;
+      sim.send_busy = sim.send_latency;
+
+      if (!sim.send_busy)
+      {
+        sim.sock[SOCK(IR)] |= W5500_SIR_SEND;
+      }
+
+      break;
+    }
+  }
+
+  sim.cr_busy = sim.cr_latency;
+  sim.sock[SOCK(CR)] = sim.cr_busy ? command : 0;
+}
+
+static uint8_t sim_read(uint8_t bsb, uint16_t addr)
+{
+  switch (bsb)
+  {
+    case W5500_BSB_COM_REG:
+      if (addr == (W5500_REG_MR >> W5500_ADDR_OFFSET) && sim.reset_busy && !--sim.reset_busy)
+      {
+        sim.common[addr] &= ~W5500_MR_RST;
+      }
+
+      return addr < sizeof(sim.common) ? sim.common[addr] : 0;
+
+    case W5500_BSB_SOCK_REG(0):
+      if (addr >= sizeof(sim.sock))
+      {
+        return 0;
+      }
+
+      if (addr == SOCK(CR) && sim.cr_busy && !--sim.cr_busy)
+      {
+        // this read still sees the command, the next one does not
+        uint8_t command = sim.sock[addr];
+        sim.sock[addr] = 0;
+        return command;
+      }
+
+      if (addr == SOCK(IR) && sim.send_busy && !--sim.send_busy)
+      {
+        sim.sock[addr] |= W5500_SIR_SEND;
+      }
+
+      if (addr == SOCK(RX_RSR) || addr == SOCK(RX_RSR) + 1)
+      {
+        return addr == SOCK(RX_RSR) ? sim.rx_rsr >> 8 : sim.rx_rsr & 0xFF;
+      }
+
+      if (addr == SOCK(TX_FSR) || addr == SOCK(TX_FSR) + 1)
+      {
+        uint16_t fsr = W5500_TX_MEM_SIZE - (uint16_t)(sock_get16(SOCK(TX_WR)) - sim.tx_rd);
+        return addr == SOCK(TX_FSR) ? fsr >> 8 : fsr & 0xFF;
+      }
+
+      return sim.sock[addr];
+
+    case W5500_BSB_SOCK_TX_BUF(0):
+      return sim.tx[addr % W5500_TX_MEM_SIZE];
+
+    case W5500_BSB_SOCK_RX_BUF(0):
+      return sim.rx[addr % W5500_RX_MEM_SIZE];
+  }
+
+  return 0;
+}
+
+static void sim_write(uint8_t bsb, uint16_t addr, uint8_t value)
+{
+  switch (bsb)
+  {
+    case W5500_BSB_COM_REG:
+      if (addr < sizeof(sim.common))
+      {
+        sim.common[addr] = value;
+      }
+
+      if (addr == (W5500_REG_MR >> W5500_ADDR_OFFSET) && (value & W5500_MR_RST))
+      {
+        sim.reset_busy = 2;
+      }
+
+      break;
+
+    case W5500_BSB_SOCK_REG(0):
+      if (addr == SOCK(CR))
+      {
+        sim_command(value);
+      }
+      else if (addr == SOCK(IR))
+      {
+        sim.sock[addr] &= ~value;  // write 1 to clear
+      }
+      else if (addr < sizeof(sim.sock))
+      {
+        sim.sock[addr] = value;
+      }
+
+      break;
+
+    case W5500_BSB_SOCK_TX_BUF(0):
+      sim.tx[addr % W5500_TX_MEM_SIZE] = value;
+      break;
+
+    case W5500_BSB_SOCK_RX_BUF(0):
+      sim.rx[addr % W5500_RX_MEM_SIZE] = value;
+      break;
+  }
+}
+
+static esp_err_t sim_transfer(spi_transaction_t *trans)
+{
+  uint16_t addr = trans->cmd;
+  uint8_t control = trans->addr & 0xFF;
+  uint8_t bsb = control >> W5500_BSB_OFFSET;
+  bool write = control & (1 << W5500_RWB_OFFSET);
+  uint32_t len = trans->length / 8;
+
+  const uint8_t *out = (trans->flags & SPI_TRANS_USE_TXDATA) ? trans->tx_data : trans->tx_buffer;
+  uint8_t *in = (trans->flags & SPI_TRANS_USE_RXDATA) ? trans->rx_data : trans->rx_buffer;
+
+  if ((control & 0x03) != W5500_SPI_OP_MODE_VDM || ((trans->flags & SPI_TRANS_USE_RXDATA) && len > 4))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  // The address counter is 16 bits; socket buffers wrap inside the chip
+  for (uint32_t i = 0; i < len; i++, addr++)
+  {
+    if (write)
+    {
+      sim_write(bsb, addr, out[i]);
+    }
+    else
+    {
+      in[i] = sim_read(bsb, addr);
+    }
+  }
+
+  sim.transactions++;
+  sim.bytes += 3 + len;
+  sim.now_us += SIM_TRANS_OVERHEAD_US + (3 + len) * 8 / SIM_SPI_CLOCK_MHZ;
+
+  return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans)
+{
+  (void)handle;
+
+  return sim_transfer(trans);
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans, TickType_t wait)
+{
+  (void)handle;
+  (void)wait;
+
+  if (sim.queued_count == 8)
+  {
+    return ESP_ERR_TIMEOUT;
+  }
+
+  sim.queued[sim.queued_count++] = trans;
+
+  return sim_transfer(trans);
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans, TickType_t wait)
+{
+  (void)handle;
+  (void)wait;
+
+  if (!sim.queued_count)
+  {
+    return ESP_ERR_TIMEOUT;
+  }
+
+  *trans = sim.queued[0];
+  memmove(sim.queued, sim.queued + 1, --sim.queued_count * sizeof(sim.queued[0]));
+
+  return ESP_OK;
+}
+
+// A frame arriving from the wire: length header, payload, RECV interrupt
+static bool sim_receive(const uint8_t *frame, uint16_t len)
+{
+  uint16_t used = sim.rx_wr - sock_get16(SOCK(RX_RD));
+
+  if (used + len + 2 > W5500_RX_MEM_SIZE)
+  {
+    return false;
+  }
+
+  uint16_t header = len + 2;
+  sim.rx[sim.rx_wr++ % W5500_RX_MEM_SIZE] = header >> 8;
+  sim.rx[sim.rx_wr++ % W5500_RX_MEM_SIZE] = header & 0xFF;
+
+  for (uint16_t i = 0; i < len; i++)
+  {
+    sim.rx[sim.rx_wr++ % W5500_RX_MEM_SIZE] = frame[i];
+  }
+
+  sim.rx_rsr += len + 2;
+  sim.sock[SOCK(IR)] |= W5500_SIR_RECV;
+
+  return true;
+}
+
+/*
+ * The TCP/IP stack side
+ */
+
+static struct
+{
+  uint8_t frames[64][ETH_MAX_PACKET_SIZE];
+  uint32_t len[64];
+  int count;
+} stack;
+
+static esp_err_t stack_input(esp_eth_mediator_t *eth, uint8_t *buffer, uint32_t length)
+{
+  (void)eth;
+
+  if (stack.count < 64 && length <= ETH_MAX_PACKET_SIZE)
+  {
+    memcpy(stack.frames[stack.count], buffer, length);
+    stack.len[stack.count++] = length;
+  }
+
+  free(buffer);
+
+  return ESP_OK;
+}
+
+static esp_err_t on_state_changed(esp_eth_mediator_t *eth, esp_eth_state_t state, void *args)
+{
+  (void)eth;
+  (void)state;
+  (void)args;
+
+  return ESP_OK;
+}
+
+static esp_eth_mediator_t mediator =
+{
+  .stack_input = stack_input,
+  .on_state_changed = on_state_changed,
+};
+
+/*
+ * Tests
+ */
+
+static unsigned int seed = 1;
+
+static void make_frame(uint8_t *frame, uint16_t len)
+{
+  for (uint16_t i = 0; i < len; i++)
+  {
+    frame[i] = rand_r(&seed);
+  }
+}
+
+// A fresh chip whose socket pointers start at base, and a started driver
+static esp_eth_mac_t *setup(uint16_t base)
+{
+  memset(&sim, 0, sizeof(sim));
+  memset(&stack, 0, sizeof(stack));
+  sim.common[W5500_REG_VERSIONR >> W5500_ADDR_OFFSET] = 0x04;
+  sim.common[W5500_REG_PHYCFGR >> W5500_ADDR_OFFSET] = 0xBF;  // link up
+  sim.rx_wr = base;
+  sim.tx_rd = base;
+  host_log_errors = 0;
+
+  eth_w5500_config_t w5500_config = { .spi_hdl = NULL, .int_gpio_num = 4 };
+  eth_mac_config_t mac_config = { .sw_reset_timeout_ms = 100, .rx_task_stack_size = 4096, .rx_task_prio = 1 };
+
+  esp_eth_mac_t *mac = esp_eth_mac_new_w5500(&w5500_config, &mac_config);
+  mac->set_mediator(mac, &mediator);
+
+  if (mac->init(mac) != ESP_OK || mac->start(mac) != ESP_OK)
+  {
+    return NULL;
+  }
+
+  sim.transactions = sim.bytes = sim.sleeps = 0;
+  sim.now_us = 0;
+
+  return mac;
+}
+
+static void test_init(void) {
+  printf("init and start set up SOCK0 in MAC RAW mode\n");
+  esp_eth_mac_t *mac = setup(0);
+
+  CHECK(mac != NULL);
+  CHECK(sim.sock[SOCK(SR)] == 0x42);
+  CHECK(sim.sock[SOCK(MR)] == (W5500_SMR_MAC_RAW | W5500_SMR_MAC_FILTER));
+  CHECK(sim.sock[SOCK(RXBUF_SIZE)] == 16);
+  CHECK(sim.common[W5500_REG_SIMR >> W5500_ADDR_OFFSET] == W5500_SIMR_SOCK0);
+  CHECK(host_log_errors == 0);
+
+  mac->set_promiscuous(mac, true);
+  CHECK(!(sim.sock[SOCK(MR)] & W5500_SMR_MAC_FILTER));
+  mac->del(mac);
+}
+
+static void test_rx_batches(void) {
+  printf("frames are drained in batches, across ring and pointer wrap\n");
+  // Pointers start just below the 16-bit wrap, the ring wraps every 16 KB
+  esp_eth_mac_t *mac = setup(0xF000);
+  emac_w5500_t *emac = __containerof(mac, emac_w5500_t, parent);
+  static uint8_t frames[16][ETH_MAX_PACKET_SIZE];
+  static uint16_t lens[16];
+  int total = 0, mismatches = 0;
+  uint32_t worst_extra = 0;
+
+  for (int round = 0; round < 3000; round++)
+  {
+    int count = 1 + rand_r(&seed) % 10;
+
+    for (int i = 0; i < count; i++)
+    {
+      // mostly small frames, some full size
+      lens[i] = rand_r(&seed) % 4 ? 60 + rand_r(&seed) % 200 : 1000 + rand_r(&seed) % 515;
+      make_frame(frames[i], lens[i]);
+
+      if (!sim_receive(frames[i], lens[i]))
+      {
+        count = i;
+      }
+    }
+
+    stack.count = 0;
+    uint32_t before = sim.transactions;
+    w5500_handle_interrupt(emac);
+    uint32_t used = sim.transactions - before;
+
+    if (stack.count != count)
+    {
+      mismatches++;
+      continue;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+      if (stack.len[i] != lens[i] || memcmp(stack.frames[i], frames[i], lens[i]))
+      {
+        mismatches++;
+      }
+    }
+
+    // One read per frame, plus a fixed cost per interrupt
+    if (used > count + worst_extra)
+    {
+      worst_extra = used - count;
+    }
+
+    total += count;
+  }
+
+  CHECK(mismatches == 0);
+  CHECK(total > 10000);
+  CHECK(worst_extra <= 10);
+  CHECK(sim.rx_rsr == 0);
+  CHECK(sock_get16(SOCK(RX_RD)) == sim.rx_wr);
+  CHECK(sim.sleeps == 0);
+  CHECK(host_log_errors == 0);
+  mac->del(mac);
+}
+
+static void test_rx_receive_api(void) {
+  printf("receive() still returns one frame per call\n");
+  esp_eth_mac_t *mac = setup(0x3F80);
+  emac_w5500_t *emac = __containerof(mac, emac_w5500_t, parent);
+  static uint8_t frames[3][ETH_MAX_PACKET_SIZE];
+  static uint8_t buf[ETH_MAX_PACKET_SIZE];
+  static const uint16_t lens[3] = { 60, 1514, 333 };
+
+  for (int i = 0; i < 3; i++)
+  {
+    make_frame(frames[i], lens[i]);
+    sim_receive(frames[i], lens[i]);
+  }
+
+  int i = 0;
+
+  do
+  {
+    uint32_t length = sizeof(buf);
+    CHECK(mac->receive(mac, buf, &length) == ESP_OK);
+    CHECK(length == lens[i] && !memcmp(buf, frames[i], length));
+    i++;
+  } while (emac->packets_remain && i < 5);
+
+  CHECK(i == 3);
+  CHECK(sim.rx_rsr == 0);
+
+  // Nothing left
+  uint32_t length = sizeof(buf);
+  CHECK(mac->receive(mac, buf, &length) == ESP_OK && length == 0);
+  mac->del(mac);
+}
+
+static void test_rx_bad_header(void) {
+  printf("a corrupt length header drops the data instead of overflowing\n");
+  esp_eth_mac_t *mac = setup(0);
+  emac_w5500_t *emac = __containerof(mac, emac_w5500_t, parent);
+  static uint8_t frame[100];
+
+  make_frame(frame, sizeof(frame));
+  sim_receive(frame, sizeof(frame));
+  sim_receive(frame, sizeof(frame));
+  sim.rx[102] = 0x7F;  // second header claims ~32 KB
+
+  w5500_handle_interrupt(emac);
+  CHECK(stack.count == 1);
+  CHECK(sim.rx_rsr == 0);
+  CHECK(host_log_errors > 0);
+
+  // The driver is back in step for the next frame
+  stack.count = 0;
+  sim_receive(frame, sizeof(frame));
+  w5500_handle_interrupt(emac);
+  CHECK(stack.count == 1 && !memcmp(stack.frames[0], frame, sizeof(frame)));
+  mac->del(mac);
+}
+
+static void test_tx(void) {
+  printf("frames are transmitted intact, without sleeping\n");
+  esp_eth_mac_t *mac = setup(0xFF00);
+  static uint8_t frames[64][ETH_MAX_PACKET_SIZE];
+  static uint16_t lens[64];
+  int mismatches = 0;
+
+  sim.send_latency = 3;  // SEND_OK shows on the third IR read
+
+  for (int i = 0; i < 64; i++)
+  {
+    lens[i] = 60 + rand_r(&seed) % (1514 - 60);
+    make_frame(frames[i], lens[i]);
+    CHECK(mac->transmit(mac, frames[i], lens[i]) == ESP_OK);
+  }
+
+  CHECK(sim.sent_count == 64);
+
+  for (int i = 0; i < sim.sent_count; i++)
+  {
+    if (sim.sent_len[i] != lens[i] || memcmp(sim.sent[i], frames[i], lens[i]))
+    {
+      mismatches++;
+    }
+  }
+
+  CHECK(mismatches == 0);
+  CHECK(sim.sleeps == 0);
+  // First frame reads TX_FSR and TX_WR, later ones use what the driver knows
+  CHECK(sim.transactions <= 64 * 9 + 4);
+  CHECK(host_log_errors == 0);
+  mac->del(mac);
+}
+
+static void test_tx_link_down(void) {
+  printf("transmit gives up quickly when the link is down\n");
+  esp_eth_mac_t *mac = setup(0);
+  static uint8_t frame[60];
+
+  sim.send_latency = 1000000;
+  sim.common[W5500_REG_PHYCFGR >> W5500_ADDR_OFFSET] = 0;
+
+  CHECK(mac->transmit(mac, frame, sizeof(frame)) == ESP_FAIL);
+  CHECK(sim.now_us < 2000);
+  mac->del(mac);
+}
+
+static void test_command_polling(void) {
+  printf("commands complete in microseconds, and time out when stuck\n");
+  esp_eth_mac_t *mac = setup(0);
+  emac_w5500_t *emac = __containerof(mac, emac_w5500_t, parent);
+
+  sim.cr_latency = 4;
+  CHECK(w5500_send_command(emac, W5500_SCR_CLOSE, 100) == ESP_OK);
+  CHECK(w5500_send_command(emac, W5500_SCR_OPEN, 100) == ESP_OK);
+  CHECK(sim.sleeps == 0);
+  CHECK(sim.now_us < 200);
+
+  sim.now_us = 0;
+  sim.cr_latency = 1000000;
+  CHECK(w5500_send_command(emac, W5500_SCR_CLOSE, 100) == ESP_ERR_TIMEOUT);
+  CHECK(sim.now_us >= 100000 && sim.now_us < 110000);
+  CHECK(sim.sleeps > 0 && sim.sleeps < 110);
+  mac->del(mac);
+}
+
+/*
+ * Benchmark
+ */
+
+static void bench(void) {
+  static uint8_t frame[ETH_MAX_PACKET_SIZE];
+  static const int batches[] = { 1, 2, 4, 8 };
+  static const uint16_t sizes[] = { 64, 590, 1514 };
+
+  printf("receive, per frame          trans   bytes      us\n");
+
+  for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+  {
+    for (unsigned b = 0; b < sizeof(batches) / sizeof(batches[0]); b++)
+    {
+      esp_eth_mac_t *mac = setup(0);
+      emac_w5500_t *emac = __containerof(mac, emac_w5500_t, parent);
+      int frames = 0;
+
+      for (int round = 0; round < 200; round++)
+      {
+        for (int i = 0; i < batches[b]; i++)
+        {
+          frames += sim_receive(frame, sizes[s]);
+        }
+
+        stack.count = 0;
+        w5500_handle_interrupt(emac);
+      }
+
+      printf("  %4d bytes, %d per IRQ:  %6.2f  %6.0f  %6.1f\n", sizes[s], batches[b],
+             (double)sim.transactions / frames, (double)sim.bytes / frames, (double)sim.now_us / frames);
+      mac->del(mac);
+    }
+  }
+
+  printf("transmit, per frame\n");
+
+  for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+  {
+    esp_eth_mac_t *mac = setup(0);
+
+    for (int i = 0; i < 64; i++)
+    {
+      mac->transmit(mac, frame, sizes[s]);
+    }
+
+    printf("  %4d bytes:              %6.2f  %6.0f  %6.1f\n", sizes[s], sim.transactions / 64.0,
+           sim.bytes / 64.0, sim.now_us / 64.0);
+    mac->del(mac);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  verbose = getenv("VERBOSE") != NULL;
+
+  if (argc > 1 && !strcmp(argv[1], "bench"))
+  {
+    bench();
+    return 0;
+  }
+
+  test_init();
+  test_rx_batches();
+  test_rx_receive_api();
+  test_rx_bad_header();
+  test_tx();
+  test_tx_link_down();
+  test_command_polling();
+
+  return test_summary();
+}
@@ -10,6 +10,7 @@
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
 #include <RTClib.h>
+#include <Adafruit_I2CBus.h>
 
 // WiFi AP for setup
 const char* ap_ssid = "Mushroom_Setup";
@@ -32,6 +33,9 @@ int lcdAddress = 0x27;
 // RTC
 RTC_DS3231 rtc;
 
+// Wire, shared by the LCD and the RTC; scanned once at boot
+Adafruit_I2CBus i2cBus;
+
 // Sensors
 DHT dht(DHT_PIN, DHT_TYPE);
 
@@ -93,6 +97,7 @@ void setup() {
   // Find and initialize LCD
   lcdAddress = findLCDAddress();
   if (lcdAddress != 0) {
+    lcd.setBus(&i2cBus);
     lcd.init();
     lcd.backlight();
     lcd.clear();
@@ -107,6 +112,7 @@ void setup() {
   // Initialize RTC
   if (rtc.begin()) {
     rtcFound = true;
+    rtc.setBus(&i2cBus);
     Serial.println("✅ RTC DS3231 found");
     
     // Set RTC time if needed (uncomment to set time)
@@ -177,24 +183,22 @@ void loop() {
 int findLCDAddress() {
   Serial.println("🔍 Scanning for LCD I2C address...");
   
-  for (int address = 1; address < 127; address++) {
-    Wire.beginTransmission(address);
-    int error = Wire.endTransmission();
+  // First device on the bus, as the old 1-126 probe loop found. This is
+  // the boot scan; later lookups answer from it.
+  int address = i2cBus.next();
+  if (address != 0) {
+    Serial.println("📍 Found I2C device at address: 0x" + String(address, HEX));
     
-    if (error == 0) {
-      Serial.println("📍 Found I2C device at address: 0x" + String(address, HEX));
-      
-      // Try to initialize LCD at this address
-      LiquidCrystal_I2C testLCD(address, 16, 2);
-      testLCD.init();
-      testLCD.backlight();
-      testLCD.clear();
-      testLCD.setCursor(0, 0);
-      testLCD.print("Test");
-      delay(100);
-      
-      return address;
-    }
+    // Try to initialize LCD at this address
+    LiquidCrystal_I2C testLCD(address, 16, 2);
+    testLCD.init();
+    testLCD.backlight();
+    testLCD.clear();
+    testLCD.setCursor(0, 0);
+    testLCD.print("Test");
+    delay(100);
+    
+    return address;
   }
   
   Serial.println("❌ No LCD found!");
@@ -0,0 +1,30 @@
+/*
+ * The checks shared by the host tests in libraries/<name>/test and the
+ * sketch test folders. CHECK() reports a failed condition and carries
+ * on; main() ends with test_summary(), which prints the verdict and
+ * gives the exit status. C and C++.
+ *
+ * Add -I../../test to the build from a library root, -I../test from a
+ * sketch folder.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+static int failures;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+      printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+      failures++;                                                     \
+    }                                                                 \
+  } while (0)
+
+static inline int test_summary(void) {
+  printf(failures ? "%d check(s) failed\n" : "all passed\n", failures);
+  return failures ? 1 : 0;
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,467 @@
+/*
+ * RDTRC Notify Library - Asynchronous LINE Notifications
+ * Version: 4.0
+ * Firmware made by: RDTRC
+ * Updated: 2024
+ *
+ * Features:
+ * - Bounded outbound queue, loop() never waits for HTTPS
+ * - Duplicate alerts within a time window are coalesced
+ * - One keep-alive TLS connection reused for every message
+ * - Background sender task with retry and exponential backoff
+ *
+ * - Server certificate checked against the LINE root CAs by default
+ *
+ * Usage:
+ * #include "RDTRC_Notify_Library.h"
+ * RDTRC_LineNotifier lineNotifier;
+ * lineNotifier.begin(lineToken);        // in setup()
+ * lineNotifier.send("Low water level"); // anywhere, returns immediately
+ */
+
+#ifndef RDTRC_NOTIFY_LIBRARY_H
+#define RDTRC_NOTIFY_LIBRARY_H
+
+#include <Arduino.h>
+
+#ifndef RDTRC_NOTIFY_QUEUE_SIZE
+#define RDTRC_NOTIFY_QUEUE_SIZE 8
+#endif
+
+#ifndef RDTRC_NOTIFY_MESSAGE_LENGTH
+#define RDTRC_NOTIFY_MESSAGE_LENGTH 256
+#endif
+
+// Remembers this many recently sent messages for coalescing
+#ifndef RDTRC_NOTIFY_HISTORY_SIZE
+#define RDTRC_NOTIFY_HISTORY_SIZE 8
+#endif
+
+// Result codes besides HTTP status codes
+#define RDTRC_NOTIFY_ERROR_CONNECTION -1
+#define RDTRC_NOTIFY_ERROR_OFFLINE -2
+
+// Queue, coalescing and retry policy. Has no network dependency so that it
+// can be exercised on the host with any sender.
+class RDTRC_NotifyQueue {
+  public:
+    struct Config {
+      unsigned long coalesceWindow;  // ms during which identical messages are merged
+      unsigned long retryDelay;      // ms before the first retry
+      unsigned long maxRetryDelay;   // ms cap for the exponential backoff
+      uint8_t maxAttempts;           // attempts before a message is dropped
+    };
+
+    struct Stats {
+      unsigned long queued;
+      unsigned long sent;
+      unsigned long coalesced;
+      unsigned long dropped;   // queue full
+      unsigned long failed;    // gave up after retries or rejected by server
+      unsigned long retries;
+    };
+
+  private:
+    struct Entry {
+      char message[RDTRC_NOTIFY_MESSAGE_LENGTH];
+      uint32_t hash;
+      uint16_t repeats;
+      uint8_t attempts;
+      unsigned long nextAttempt;
+    };
+
+    struct Sent {
+      uint32_t hash;
+      unsigned long time;
+    };
+
+    Entry entries[RDTRC_NOTIFY_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t count;
+    Sent history[RDTRC_NOTIFY_HISTORY_SIZE];
+    uint8_t historyNext;
+    Config config;
+    Stats stats;
+
+    static uint32_t hashMessage(const char* message, size_t length) {
+      // FNV-1a
+      uint32_t hash = 2166136261UL;
+      for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)message[i];
+        hash *= 16777619UL;
+      }
+      return hash;
+    }
+
+    bool sentRecently(uint32_t hash, unsigned long now) {
+      for (int i = 0; i < RDTRC_NOTIFY_HISTORY_SIZE; i++) {
+        if (history[i].time != 0 && history[i].hash == hash &&
+            now - history[i].time < config.coalesceWindow) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void pop() {
+      head = (head + 1) % RDTRC_NOTIFY_QUEUE_SIZE;
+      count--;
+    }
+
+  public:
+    RDTRC_NotifyQueue() {
+      config.coalesceWindow = 600000;  // 10 minutes
+      config.retryDelay = 2000;
+      config.maxRetryDelay = 300000;
+      config.maxAttempts = 5;
+      clear();
+    }
+
+    void setConfig(const Config& newConfig) {
+      config = newConfig;
+    }
+
+    const Config& getConfig() const {
+      return config;
+    }
+
+    const Stats& getStats() const {
+      return stats;
+    }
+
+    void clear() {
+      head = 0;
+      count = 0;
+      historyNext = 0;
+      memset(history, 0, sizeof(history));
+      memset(&stats, 0, sizeof(stats));
+    }
+
+    int size() const {
+      return count;
+    }
+
+    // Queue a message. Returns false if it was merged with an identical
+    // message or the queue is full.
+    bool push(const char* message, unsigned long now) {
+      // Only what fits in an entry is stored, so only that is compared
+      size_t length = strnlen(message, RDTRC_NOTIFY_MESSAGE_LENGTH - 1);
+      uint32_t hash = hashMessage(message, length);
+
+      // Identical message still waiting: just count the repeat
+      for (int i = 0; i < count; i++) {
+        Entry& entry = entries[(head + i) % RDTRC_NOTIFY_QUEUE_SIZE];
+        if (entry.hash == hash && strncmp(entry.message, message, length) == 0 &&
+            entry.message[length] == '\0') {
+          entry.repeats++;
+          stats.coalesced++;
+          return false;
+        }
+      }
+
+      if (sentRecently(hash, now)) {
+        stats.coalesced++;
+        return false;
+      }
+
+      if (count >= RDTRC_NOTIFY_QUEUE_SIZE) {
+        stats.dropped++;
+        return false;
+      }
+
+      Entry& entry = entries[(head + count) % RDTRC_NOTIFY_QUEUE_SIZE];
+      memcpy(entry.message, message, length);
+      entry.message[length] = '\0';
+      entry.hash = hash;
+      entry.repeats = 0;
+      entry.attempts = 0;
+      entry.nextAttempt = now;
+      count++;
+      stats.queued++;
+      return true;
+    }
+
+    // Copy the next message that is due into buffer. Returns false if the
+    // queue is empty or the head is still backing off.
+    bool next(char* buffer, size_t length, unsigned long now) {
+      if (count == 0) return false;
+      Entry& entry = entries[head];
+      if ((long)(now - entry.nextAttempt) < 0) return false;
+
+      if (entry.repeats > 0) {
+        snprintf(buffer, length, "%s (x%u)", entry.message, entry.repeats + 1);
+      } else {
+        strncpy(buffer, entry.message, length - 1);
+        buffer[length - 1] = '\0';
+      }
+      return true;
+    }
+
+    // Milliseconds until next() may return a message, or -1 if empty
+    long timeUntilNext(unsigned long now) const {
+      if (count == 0) return -1;
+      long wait = (long)(entries[head].nextAttempt - now);
+      return wait > 0 ? wait : 0;
+    }
+
+    // Report the outcome of sending the message returned by next()
+    void complete(int result, unsigned long now) {
+      if (count == 0) return;
+      Entry& entry = entries[head];
+
+      if (result >= 200 && result < 300) {
+        history[historyNext].hash = entry.hash;
+        history[historyNext].time = now ? now : 1;
+        historyNext = (historyNext + 1) % RDTRC_NOTIFY_HISTORY_SIZE;
+        stats.sent++;
+        pop();
+        return;
+      }
+
+      if (result == RDTRC_NOTIFY_ERROR_OFFLINE) {
+        // Not an attempt, try again later
+        entry.nextAttempt = now + config.retryDelay;
+        return;
+      }
+
+      // Server errors, rate limiting and network errors are worth retrying,
+      // other client errors (bad token, bad request) are not
+      bool retryable = result < 0 || result == 429 || result >= 500;
+      entry.attempts++;
+      if (!retryable || entry.attempts >= config.maxAttempts) {
+        stats.failed++;
+        pop();
+        return;
+      }
+
+      unsigned long backoff = config.retryDelay;
+      for (int i = 1; i < entry.attempts && backoff < config.maxRetryDelay; i++) {
+        backoff *= 2;
+      }
+      if (backoff > config.maxRetryDelay) backoff = config.maxRetryDelay;
+      entry.nextAttempt = now + backoff;
+      stats.retries++;
+    }
+};
+
+// Percent-encode a message for an application/x-www-form-urlencoded body
+inline String rdtrcFormEncode(const char* text) {
+  static const char hex[] = "0123456789ABCDEF";
+  String encoded;
+  encoded.reserve(strlen(text) * 3 / 2);
+  for (const char* p = text; *p; p++) {
+    char c = *p;
+    if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      encoded += c;
+    } else if (c == ' ') {
+      encoded += '+';
+    } else {
+      encoded += '%';
+      encoded += hex[(uint8_t)c >> 4];
+      encoded += hex[(uint8_t)c & 0x0F];
+    }
+  }
+  return encoded;
+}
+
+#ifdef ESP32
+
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+
+#ifndef RDTRC_NOTIFY_TASK_CORE
+#define RDTRC_NOTIFY_TASK_CORE 0
+#endif
+
+#ifndef RDTRC_NOTIFY_TASK_STACK
+#define RDTRC_NOTIFY_TASK_STACK 8192
+#endif
+
+// Roots that notify-api.line.me chains to: DigiCert Global Root G2 and
+// DigiCert Global Root CA. Use setCACert() if LINE changes its chain.
+static const char RDTRC_LINE_ROOT_CA[] = R"EOF(
+-----BEGIN CERTIFICATE-----
+MIIDjjCCAnagAwIBAgIQAzrx5qcRqaC7KGSxHQn65TANBgkqhkiG9w0BAQsFADBh
+MQswCQYDVQQGEwJVUzEVMBMGA1UEChMMRGlnaUNlcnQgSW5jMRkwFwYDVQQLExB3
+d3cuZGlnaWNlcnQuY29tMSAwHgYDVQQDExdEaWdpQ2VydCBHbG9iYWwgUm9vdCBH
+MjAeFw0xMzA4MDExMjAwMDBaFw0zODAxMTUxMjAwMDBaMGExCzAJBgNVBAYTAlVT
+MRUwEwYDVQQKEwxEaWdpQ2VydCBJbmMxGTAXBgNVBAsTEHd3dy5kaWdpY2VydC5j
+b20xIDAeBgNVBAMTF0RpZ2lDZXJ0IEdsb2JhbCBSb290IEcyMIIBIjANBgkqhkiG
+9w0BAQEFAAOCAQ8AMIIBCgKCAQEAuzfNNNx7a8myaJCtSnX/RrohCgiN9RlUyfuI
+2/Ou8jqJkTx65qsGGmvPrC3oXgkkRLpimn7Wo6h+4FR1IAWsULecYxpsMNzaHxmx
+1x7e/dfgy5SDN67sH0NO3Xss0r0upS/kqbitOtSZpLYl6ZtrAGCSYP9PIUkY92eQ
+q2EGnI/yuum06ZIya7XzV+hdG82MHauVBJVJ8zUtluNJbd134/tJS7SsVQepj5Wz
+tCO7TG1F8PapspUwtP1MVYwnSlcUfIKdzXOS0xZKBgyMUNGPHgm+F6HmIcr9g+UQ
+vIOlCsRnKPZzFBQ9RnbDhxSJITRNrw9FDKZJobq7nMWxM4MphQIDAQABo0IwQDAP
+BgNVHRMBAf8EBTADAQH/MA4GA1UdDwEB/wQEAwIBhjAdBgNVHQ4EFgQUTiJUIBiV
+5uNu5g/6+rkS7QYXjzkwDQYJKoZIhvcNAQELBQADggEBAGBnKJRvDkhj6zHd6mcY
+1Yl9PMWLSn/pvtsrF9+wX3N3KjITOYFnQoQj8kVnNeyIv/iPsGEMNKSuIEyExtv4
+NeF22d+mQrvHRAiGfzZ0JFrabA0UWTW98kndth/Jsw1HKj2ZL7tcu7XUIOGZX1NG
+Fdtom/DzMNU+MeKNhJ7jitralj41E6Vf8PlwUHBHQRFXGU7Aj64GxJUTFy8bJZ91
+8rGOmaFvE7FBcf6IKshPECBV1/MUReXgRPTqh5Uykw7+U0b6LJ3/iyK5S9kJRaTe
+pLiaWN0bfVKfjllDiIGknibVb63dDcY3fe0Dkhvld1927jyNxF1WW6LZZm6zNTfl
+MrY=
+-----END CERTIFICATE-----
+-----BEGIN CERTIFICATE-----
+MIIDrzCCApegAwIBAgIQCDvgVpBCRrGhdWrJWZHHSjANBgkqhkiG9w0BAQUFADBh
+MQswCQYDVQQGEwJVUzEVMBMGA1UEChMMRGlnaUNlcnQgSW5jMRkwFwYDVQQLExB3
+d3cuZGlnaWNlcnQuY29tMSAwHgYDVQQDExdEaWdpQ2VydCBHbG9iYWwgUm9vdCBD
+QTAeFw0wNjExMTAwMDAwMDBaFw0zMTExMTAwMDAwMDBaMGExCzAJBgNVBAYTAlVT
+MRUwEwYDVQQKEwxEaWdpQ2VydCBJbmMxGTAXBgNVBAsTEHd3dy5kaWdpY2VydC5j
+b20xIDAeBgNVBAMTF0RpZ2lDZXJ0IEdsb2JhbCBSb290IENBMIIBIjANBgkqhkiG
+9w0BAQEFAAOCAQ8AMIIBCgKCAQEA4jvhEXLeqKTTo1eqUKKPC3eQyaKl7hLOllsB
+CSDMAZOnTjC3U/dDxGkAV53ijSLdhwZAAIEJzs4bg7/fzTtxRuLWZscFs3YnFo97
+nh6Vfe63SKMI2tavegw5BmV/Sl0fvBf4q77uKNd0f3p4mVmFaG5cIzJLv07A6Fpt
+43C/dxC//AH2hdmoRBBYMql1GNXRor5H4idq9Joz+EkIYIvUX7Q6hL+hqkpMfT7P
+T19sdl6gSzeRntwi5m3OFBqOasv+zbMUZBfHWymeMr/y7vrTC0LUq7dBMtoM1O/4
+gdW7jVg/tRvoSSiicNoxBN33shbyTApOB6jtSj1etX+jkMOvJwIDAQABo2MwYTAO
+BgNVHQ8BAf8EBAMCAYYwDwYDVR0TAQH/BAUwAwEB/zAdBgNVHQ4EFgQUA95QNVbR
+TLtm8KPiGxvDl7I90VUwHwYDVR0jBBgwFoAUA95QNVbRTLtm8KPiGxvDl7I90VUw
+DQYJKoZIhvcNAQEFBQADggEBAMucN6pIExIK+t1EnE9SsPTfrgT1eXkIoyQY/Esr
+hMAtudXH/vTBH1jLuG2cenTnmCmrEbXjcKChzUyImZOMkXDiqw8cvpOp/2PV5Adg
+06O/nVsJ8dWO41P0jmP6P6fbtGbfYmbW0W5BjfIttep3Sp+dWOIrWcBAI+0tKIJF
+PnlUkiaY4IBIqDfv8NZ5YBberOgOzW6sRBc4L0na4UU+Krk2U886UAb3LujEV0ls
+YSEY1QSteDwsOoBrp+uvFRTp2InBuThs4pFsiv9kuXclVzDAGySj4dzp30d8tbQk
+CAUw7C29C79Fv1C5qfPrmAESrciIxpg0X40KPMbp1ZWVbd4=
+-----END CERTIFICATE-----
+)EOF";
+
+// LINE Notify dispatcher. send() only queues the message; a background task
+// owns the HTTPS connection and delivers the queue.
+class RDTRC_LineNotifier {
+  private:
+    RDTRC_NotifyQueue queue;
+    SemaphoreHandle_t lock;
+    TaskHandle_t task;
+    WiFiClientSecure client;
+    HTTPClient http;
+    String authorization;
+    char outgoing[RDTRC_NOTIFY_MESSAGE_LENGTH + 16];
+
+    int post(const char* message) {
+      if (WiFi.status() != WL_CONNECTED) return RDTRC_NOTIFY_ERROR_OFFLINE;
+
+      // With reuse enabled HTTPClient keeps the TLS session open between
+      // messages, so only the first one pays for the handshake
+      if (!http.begin(client, "https://notify-api.line.me/api/notify")) {
+        return RDTRC_NOTIFY_ERROR_CONNECTION;
+      }
+      http.addHeader("Content-Type", "application/x-www-form-urlencoded");
+      http.addHeader("Authorization", authorization);
+
+      int result = http.POST("message=" + rdtrcFormEncode(message));
+      http.end();
+
+      if (result < 0) {
+        result = RDTRC_NOTIFY_ERROR_CONNECTION;
+      }
+      return result;
+    }
+
+    void run() {
+      for (;;) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        bool due = queue.next(outgoing, sizeof(outgoing), millis());
+        long wait = queue.timeUntilNext(millis());
+        xSemaphoreGive(lock);
+
+        if (!due) {
+          // Sleep until a retry is due or send() wakes us up
+          ulTaskNotifyTake(pdTRUE, wait < 0 ? portMAX_DELAY : pdMS_TO_TICKS(wait));
+          continue;
+        }
+
+        int result = post(outgoing);
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        queue.complete(result, millis());
+        xSemaphoreGive(lock);
+
+        if (result >= 200 && result < 300) {
+          Serial.println("LINE notification sent");
+        } else {
+          Serial.println("LINE notification failed: " + String(result));
+        }
+      }
+    }
+
+    static void taskEntry(void* arg) {
+      static_cast<RDTRC_LineNotifier*>(arg)->run();
+    }
+
+  public:
+    RDTRC_LineNotifier() {
+      lock = nullptr;
+      task = nullptr;
+      client.setCACert(RDTRC_LINE_ROOT_CA);
+    }
+
+    // Start the sender task. Messages sent before begin() are dropped.
+    bool begin(const char* token) {
+      if (task) return true;
+      if (!token || strlen(token) < 10) return false;
+
+      authorization = "Bearer " + String(token);
+      http.setReuse(true);
+
+      lock = xSemaphoreCreateMutex();
+      if (!lock) return false;
+      return xTaskCreatePinnedToCore(taskEntry, "lineNotify", RDTRC_NOTIFY_TASK_STACK,
+                                     this, 1, &task, RDTRC_NOTIFY_TASK_CORE) == pdPASS;
+    }
+
+    // Verify the server against other root certificates. Call before begin().
+    void setCACert(const char* rootCA) {
+      client.setCACert(rootCA);
+    }
+
+    // Accept any server certificate. The token then goes to whoever answers,
+    // so only use this for testing. Call before begin().
+    void setInsecure() {
+      client.setInsecure();
+    }
+
+    void setConfig(const RDTRC_NotifyQueue::Config& config) {
+      if (lock) xSemaphoreTake(lock, portMAX_DELAY);
+      queue.setConfig(config);
+      if (lock) xSemaphoreGive(lock);
+    }
+
+    RDTRC_NotifyQueue::Stats getStats() {
+      if (lock) xSemaphoreTake(lock, portMAX_DELAY);
+      RDTRC_NotifyQueue::Stats stats = queue.getStats();
+      if (lock) xSemaphoreGive(lock);
+      return stats;
+    }
+
+    // Queue a message and return immediately
+    bool send(const String& message) {
+      return send(message.c_str());
+    }
+
+    bool send(const char* message) {
+      if (!task) return false;
+
+      xSemaphoreTake(lock, portMAX_DELAY);
+      bool queued = queue.push(message, millis());
+      xSemaphoreGive(lock);
+
+      if (queued) {
+        xTaskNotifyGive(task);
+      }
+      return queued;
+    }
+
+    int pending() {
+      if (!lock) return 0;
+      xSemaphoreTake(lock, portMAX_DELAY);
+      int count = queue.size();
+      xSemaphoreGive(lock);
+      return count;
+    }
+};
+
+#endif // ESP32
+
+#endif // RDTRC_NOTIFY_LIBRARY_H
@@ -0,0 +1,251 @@
+/*
+ * RDTRC Tasks Library - Control and Network Work on Separate Cores
+ * Version: 4.0
+ * Firmware made by: RDTRC
+ * Updated: 2024
+ *
+ * Features:
+ * - Control task pinned to core 1 above the network task's priority, so
+ *   a slow web request, Blynk reconnect or LCD message never delays a
+ *   sensor reading or a pump shut-off
+ * - Network task on core 0, next to the WiFi stack
+ * - Lock-free single producer, single consumer queues for commands in
+ *   and telemetry out
+ * - Snapshot double buffer: web and Blynk handlers read a consistent
+ *   copy of the control state without locks, and the control task never
+ *   waits for a reader
+ * - Fixed-size buffers, no heap allocation
+ *
+ * Usage:
+ * #include "RDTRC_Tasks_Library.h"
+ * RDTRC_Queue<Command, 8> commands;       // network -> control
+ * RDTRC_Queue<Event, 16> telemetry;       // control -> network
+ * RDTRC_Snapshot<State> controlState;     // control -> web, Blynk, LCD
+ * RDTRC_TaskSplit tasks;
+ * tasks.begin(controlStart, controlLoop, networkStart, networkLoop);  // in setup()
+ */
+
+#ifndef RDTRC_TASKS_LIBRARY_H
+#define RDTRC_TASKS_LIBRARY_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+
+// Bounded queue between exactly one producer task and one consumer task.
+// Capacity must be a power of two. Neither side ever blocks: push() fails
+// when the queue is full and pop() when it is empty.
+template <typename T, uint16_t Capacity>
+class RDTRC_Queue {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "RDTRC_Queue capacity must be a power of two");
+
+  private:
+    T items[Capacity];
+    std::atomic<uint16_t> head;      // next item to pop, written by the consumer
+    std::atomic<uint16_t> tail;      // next slot to fill, written by the producer
+    std::atomic<uint32_t> dropCount;
+
+  public:
+    RDTRC_Queue() : head(0), tail(0), dropCount(0) {
+    }
+
+    // Producer side
+    bool push(const T& item) {
+      uint16_t t = tail.load(std::memory_order_relaxed);
+      if ((uint16_t)(t - head.load(std::memory_order_acquire)) == Capacity) {
+        dropCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      items[t & (Capacity - 1)] = item;
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Consumer side
+    bool pop(T& item) {
+      uint16_t h = head.load(std::memory_order_relaxed);
+      if (h == tail.load(std::memory_order_acquire)) return false;
+      item = items[h & (Capacity - 1)];
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    uint16_t size() const {
+      return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const {
+      return size() == 0;
+    }
+
+    // Items refused because the queue was full
+    uint32_t dropped() const {
+      return dropCount.load(std::memory_order_relaxed);
+    }
+};
+
+// Latest value of a state struct, written by one task and read by any
+// number of others. The writer fills the buffer readers are not directed
+// to and then flips the sequence; a reader copies the current buffer and
+// retries only if a write finished during its copy. T must be plain data.
+template <typename T>
+class RDTRC_Snapshot {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "RDTRC_Snapshot needs a plain data type (no String members)");
+
+  private:
+    T buffers[2];
+    std::atomic<uint32_t> sequence;  // publications so far, latest in buffers[sequence & 1]
+
+  public:
+    RDTRC_Snapshot() : buffers(), sequence(0) {
+    }
+
+    // Writer side, never waits
+    void publish(const T& value) {
+      uint32_t next = sequence.load(std::memory_order_relaxed) + 1;
+      // Readers that saw a write to this buffer must also see the previous
+      // sequence change, so they know to retry
+      std::atomic_thread_fence(std::memory_order_release);
+      buffers[next & 1] = value;
+      sequence.store(next, std::memory_order_release);
+    }
+
+    // Reader side. Returns the number of the publication that was copied.
+    uint32_t read(T& value) const {
+      for (;;) {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        value = buffers[before & 1];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) return before;
+      }
+    }
+
+    T read() const {
+      T value;
+      read(value);
+      return value;
+    }
+
+    // Changes whenever a new value is published
+    uint32_t version() const {
+      return sequence.load(std::memory_order_acquire);
+    }
+};
+
+#ifdef ESP32
+
+#ifndef RDTRC_CONTROL_CORE
+#define RDTRC_CONTROL_CORE 1
+#endif
+
+#ifndef RDTRC_NETWORK_CORE
+#define RDTRC_NETWORK_CORE 0
+#endif
+
+// The control task must preempt everything else the sketch runs
+#ifndef RDTRC_CONTROL_PRIORITY
+#define RDTRC_CONTROL_PRIORITY 3
+#endif
+
+#ifndef RDTRC_NETWORK_PRIORITY
+#define RDTRC_NETWORK_PRIORITY 1
+#endif
+
+#ifndef RDTRC_CONTROL_TASK_STACK
+#define RDTRC_CONTROL_TASK_STACK 4096
+#endif
+
+// Web server, Blynk, OTA and JSON all run here
+#ifndef RDTRC_NETWORK_TASK_STACK
+#define RDTRC_NETWORK_TASK_STACK 12288
+#endif
+
+typedef void (*RDTRC_TaskFunction)();
+
+// Runs the sketch as two pinned tasks. Each start function runs once in
+// its own task, then the loop function is called forever; loop functions
+// must block (e.g. in RDTRC_Scheduler::idle()) to let lower priorities run.
+class RDTRC_TaskSplit {
+  private:
+    struct Side {
+      RDTRC_TaskFunction start;
+      RDTRC_TaskFunction loop;
+      TaskHandle_t handle;
+    };
+
+    Side control;
+    Side network;
+
+    static void taskEntry(void* arg) {
+      Side* side = static_cast<Side*>(arg);
+      // Wait until begin() has both tasks
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      if (side->start) side->start();
+      for (;;) {
+        side->loop();
+      }
+    }
+
+    static bool startTask(Side& side, const char* name, uint32_t stack,
+                          UBaseType_t priority, BaseType_t core) {
+      return xTaskCreatePinnedToCore(taskEntry, name, stack, &side,
+                                     priority, &side.handle, core) == pdPASS;
+    }
+
+  public:
+    RDTRC_TaskSplit() {
+      control.start = control.loop = NULL;
+      network.start = network.loop = NULL;
+      control.handle = network.handle = NULL;
+    }
+
+    // Call at the end of setup(), once everything both tasks share has
+    // been initialized. Start functions may be NULL. Returns false, with
+    // neither task running, if the two can't both be created.
+    bool begin(RDTRC_TaskFunction controlStart, RDTRC_TaskFunction controlLoop,
+               RDTRC_TaskFunction networkStart, RDTRC_TaskFunction networkLoop) {
+      if (control.handle || !controlLoop || !networkLoop) return false;
+
+      control.start = controlStart;
+      control.loop = controlLoop;
+      network.start = networkStart;
+      network.loop = networkLoop;
+
+      if (!startTask(control, "control", RDTRC_CONTROL_TASK_STACK,
+                     RDTRC_CONTROL_PRIORITY, RDTRC_CONTROL_CORE)) {
+        control.handle = NULL;
+        return false;
+      }
+      if (!startTask(network, "network", RDTRC_NETWORK_TASK_STACK,
+                     RDTRC_NETWORK_PRIORITY, RDTRC_NETWORK_CORE)) {
+        // Nothing of the control side has run yet, so the caller can run
+        // both sides itself
+        vTaskDelete(control.handle);
+        control.handle = network.handle = NULL;
+        return false;
+      }
+
+      xTaskNotifyGive(control.handle);
+      xTaskNotifyGive(network.handle);
+      return true;
+    }
+
+    bool isRunning() const {
+      return control.handle != NULL && network.handle != NULL;
+    }
+
+    // Unused stack in bytes, to tune the stack sizes
+    uint32_t controlStackFree() const {
+      return control.handle ? uxTaskGetStackHighWaterMark(control.handle) : 0;
+    }
+
+    uint32_t networkStackFree() const {
+      return network.handle ? uxTaskGetStackHighWaterMark(network.handle) : 0;
+    }
+};
+
+#endif // ESP32
+
+#endif // RDTRC_TASKS_LIBRARY_H
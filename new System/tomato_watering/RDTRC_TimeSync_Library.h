@@ -0,0 +1,247 @@
+/*
+ * RDTRC TimeSync Library - NTP Time Disciplined by a DS3231 RTC
+ * Version: 4.0
+ * Firmware made by: RDTRC
+ * Updated: 2024
+ *
+ * Features:
+ * - Non-blocking: NTP requests and RTC reads never wait in loop()
+ * - Time is valid at boot and while offline when a DS3231 is fitted
+ * - The RTC is compared with NTP at its second edge, to the millisecond
+ * - Measured drift trims the DS3231 aging offset (about 0.1 ppm per step)
+ * - The NTP interval grows to hours once the RTC keeps time
+ * - Between syncs the clock follows the RTC instead of millis()
+ *
+ * Usage:
+ * #include "RDTRC_TimeSync_Library.h"
+ * RDTRC_TimeSync timeSync;
+ * timeSync.begin(timeClient, rtc.begin() ? &rtc : NULL);  // in setup()
+ * timeSync.update(isWiFiConnected);                        // in loop()
+ * timeClient.getHours();                                   // as before
+ */
+
+#ifndef RDTRC_TIMESYNC_LIBRARY_H
+#define RDTRC_TIMESYNC_LIBRARY_H
+
+#include <Arduino.h>
+#include <NTPClient.h>
+#include <RTClib.h>
+
+// NTP interval until the RTC has been measured, in ms
+#ifndef RDTRC_TIMESYNC_MIN_INTERVAL
+#define RDTRC_TIMESYNC_MIN_INTERVAL 60000UL
+#endif
+
+// NTP interval once the RTC is measured, doubled up to the maximum
+// while the drift stays below RDTRC_TIMESYNC_STABLE_PPM
+#ifndef RDTRC_TIMESYNC_BASE_INTERVAL
+#define RDTRC_TIMESYNC_BASE_INTERVAL 3600000UL
+#endif
+
+#ifndef RDTRC_TIMESYNC_MAX_INTERVAL
+#define RDTRC_TIMESYNC_MAX_INTERVAL 21600000UL
+#endif
+
+#ifndef RDTRC_TIMESYNC_STABLE_PPM
+#define RDTRC_TIMESYNC_STABLE_PPM 0.5f
+#endif
+
+// RTC error above which the RTC is set instead of trimmed, in ms
+#ifndef RDTRC_TIMESYNC_STEP_MS
+#define RDTRC_TIMESYNC_STEP_MS 100
+#endif
+
+// How often the clock is re-anchored to the RTC between syncs, in ms
+#ifndef RDTRC_TIMESYNC_ANCHOR_INTERVAL
+#define RDTRC_TIMESYNC_ANCHOR_INTERVAL 600000UL
+#endif
+
+#define RDTRC_TIMESYNC_EDGE_TIMEOUT 1500  // ms, a running RTC ticks within 1 s
+
+class RDTRC_TimeSync {
+  private:
+    enum Edge : uint8_t {
+      EDGE_NONE,
+      EDGE_COMPARE,  // RTC against the fresh NTP time
+      EDGE_ANCHOR    // clock from the RTC
+    };
+
+    NTPClient* ntp;
+    RTC_DS3231* rtc;
+
+    Edge edge;
+    uint8_t edgeSecond;
+    unsigned long edgeStart;
+    unsigned long edgeLastPoll;
+
+    bool setPending;               // set the RTC at the next NTP second
+    unsigned long setSecond;
+
+    bool haveBaseline;
+    long baselineError;
+    unsigned long baselineTime;
+    unsigned long lastAnchor;
+
+    unsigned long interval;
+    long lastError;
+    float driftPpm;
+    bool rtcMeasured;
+
+    void setInterval(unsigned long value) {
+      interval = value;
+      ntp->setUpdateInterval(value);
+    }
+
+    void startEdge(Edge mode) {
+      edge = mode;
+      edgeSecond = rtc->now().second();
+      edgeStart = millis();
+      edgeLastPoll = edgeStart;
+    }
+
+    // The second changed somewhere between the previous read and this
+    // one: take the middle, so the estimate is off by half a loop pass
+    void pollEdge() {
+      unsigned long now = millis();
+      DateTime rtcNow = rtc->now();
+      if (rtcNow.second() == edgeSecond) {
+        if (now - edgeStart > RDTRC_TIMESYNC_EDGE_TIMEOUT) {
+          // Stopped oscillator: set it and start over
+          edge = EDGE_NONE;
+          scheduleSet();
+        }
+        edgeLastPoll = now;
+        return;
+      }
+
+      unsigned int sinceEdge = (now - edgeLastPoll) / 2;
+      Edge mode = edge;
+      edge = EDGE_NONE;
+
+      if (mode == EDGE_ANCHOR) {
+        ntp->setEpochTime(rtcNow.unixtime(), sinceEdge);
+        return;
+      }
+
+      int64_t ntpMs = (int64_t)ntp->getEpochTime() * 1000 + ntp->getMillis() - sinceEdge;
+      int64_t error = (int64_t)rtcNow.unixtime() * 1000 - ntpMs;
+      lastError = (long)constrain(error, -2000000000LL, 2000000000LL);
+      discipline(now);
+    }
+
+    void discipline(unsigned long now) {
+      if (lastError > RDTRC_TIMESYNC_STEP_MS || lastError < -RDTRC_TIMESYNC_STEP_MS) {
+        scheduleSet();
+        return;
+      }
+
+      if (!haveBaseline) {
+        haveBaseline = true;
+        baselineError = lastError;
+        baselineTime = now;
+        rtcMeasured = true;
+        setInterval(max(interval, RDTRC_TIMESYNC_BASE_INTERVAL));
+        return;
+      }
+
+      // Need a long enough window for the ms resolution to resolve 0.1 ppm
+      unsigned long elapsed = now - baselineTime;
+      if (elapsed < RDTRC_TIMESYNC_BASE_INTERVAL / 2) return;
+
+      // Positive drift: the RTC runs fast, a positive aging offset slows it
+      driftPpm = (float)(lastError - baselineError) * 1e6f / (float)elapsed;
+      int aging = rtc->getAgingOffset() + (int)lroundf(driftPpm * 10);
+      rtc->setAgingOffset((int8_t)constrain(aging, -127, 127));
+
+      baselineError = lastError;
+      baselineTime = now;
+
+      if (fabsf(driftPpm) < RDTRC_TIMESYNC_STABLE_PPM) {
+        setInterval(min(interval * 2, RDTRC_TIMESYNC_MAX_INTERVAL));
+      } else {
+        setInterval(RDTRC_TIMESYNC_BASE_INTERVAL);
+      }
+    }
+
+    void scheduleSet() {
+      setPending = true;
+      setSecond = ntp->getEpochTime();
+      haveBaseline = false;
+      rtcMeasured = false;
+      setInterval(RDTRC_TIMESYNC_MIN_INTERVAL);
+    }
+
+    // Writing the seconds register restarts the DS3231's countdown, so
+    // the RTC is set right after the NTP second turns over
+    void pollSet() {
+      unsigned long second = ntp->getEpochTime();
+      if (second == setSecond) return;
+      rtc->adjust(DateTime(second));
+      setPending = false;
+    }
+
+  public:
+    RDTRC_TimeSync()
+      : ntp(NULL), rtc(NULL), edge(EDGE_NONE), edgeSecond(0), edgeStart(0),
+        edgeLastPoll(0), setPending(false), setSecond(0), haveBaseline(false),
+        baselineError(0), baselineTime(0), lastAnchor(0),
+        interval(RDTRC_TIMESYNC_MIN_INTERVAL), lastError(0), driftPpm(0),
+        rtcMeasured(false) {
+    }
+
+    // rtc is NULL without a DS3231. The RTC keeps the same time base as
+    // the NTPClient, with its time offset included.
+    void begin(NTPClient& client, RTC_DS3231* clock = NULL) {
+      ntp = &client;
+      rtc = clock;
+      setInterval(RDTRC_TIMESYNC_MIN_INTERVAL);
+
+      if (rtc && !rtc->lostPower()) {
+        ntp->setEpochTime(rtc->now().unixtime());
+        lastAnchor = millis();
+      }
+    }
+
+    // Call on every loop() pass; online is false while WiFi is down
+    void update(bool online) {
+      if (!ntp) return;
+
+      if (online && ntp->update() && rtc) {
+        setPending = false;
+        startEdge(EDGE_COMPARE);
+        lastAnchor = millis();
+        return;
+      }
+      if (!rtc) return;
+
+      if (setPending) {
+        pollSet();
+      } else if (edge != EDGE_NONE) {
+        pollEdge();
+      } else if (rtcMeasured && !ntp->isUpdating() &&
+                 millis() - lastAnchor >= RDTRC_TIMESYNC_ANCHOR_INTERVAL) {
+        lastAnchor = millis();
+        startEdge(EDGE_ANCHOR);
+      }
+    }
+
+    bool hasRtc() const {
+      return rtc != NULL;
+    }
+
+    // RTC minus NTP at the last comparison, in ms
+    long getLastError() const {
+      return lastError;
+    }
+
+    // Drift of the RTC measured over the last NTP interval
+    float getDriftPpm() const {
+      return driftPpm;
+    }
+
+    unsigned long getSyncInterval() const {
+      return interval;
+    }
+};
+
+#endif // RDTRC_TIMESYNC_LIBRARY_H
@@ -0,0 +1,216 @@
+/*
+ * RDTRC_AlertEngine on synthetic sensor traces: hold time against
+ * readings that run late, hysteresis on a noisy signal, cooldown, offline
+ * sensors, several rules on one signal, a full event queue and millis()
+ * wrapping around. Times are passed in, so no clock is involved.
+ *
+ * Build & run (from the sketch folder):
+ *   c++ -std=gnu++11 -O2 -I../test -Itest/host test/alerts_host.cpp -o alerts_host
+ *   ./alerts_host
+ */
+
+#include <stdlib.h>
+#include <vector>
+
+#include "../RDTRC_Alert_Library.h"
+#include "host_test.h"
+
+enum { SIGNAL_WATER, SIGNAL_PH, SIGNAL_TEMPERATURE };
+
+struct Reading {
+  unsigned long time;
+  float value;
+};
+
+// Readings every interval ms from start, each up to jitter ms late
+static std::vector<Reading> trace(const std::vector<float>& values, unsigned long interval,
+                                  unsigned long jitter = 0, unsigned long start = 0) {
+  std::vector<Reading> readings;
+  for (size_t i = 0; i < values.size(); i++) {
+    unsigned long late = jitter ? rand() % (jitter + 1) : 0;
+    readings.push_back(Reading{ start + i * interval + late, values[i] });
+  }
+  return readings;
+}
+
+// Feed a trace and return the events it produced, in order
+static std::vector<RDTRC_AlertEvent> run(RDTRC_AlertEngine& alerts, uint8_t signal,
+                                         const std::vector<Reading>& readings) {
+  std::vector<RDTRC_AlertEvent> events;
+  RDTRC_AlertEvent event;
+  for (size_t i = 0; i < readings.size(); i++) {
+    alerts.update(signal, readings[i].value, readings[i].time);
+    while (alerts.poll(event)) events.push_back(event);
+  }
+  return events;
+}
+
+/*
+ * Tests
+ */
+
+static void test_hold_two_readings() {
+  printf("with the hold at half an interval, two consecutive readings raise, one does not\n");
+
+  static const unsigned long intervals[] = { 30000, 45000 };
+  for (unsigned long interval : intervals) {
+    unsigned long hold = interval / 2;
+
+    // a single low reading between good ones never raises
+    RDTRC_AlertEngine alerts;
+    int low = alerts.addRule(SIGNAL_WATER, RDTRC_ALERT_BELOW, 8, 2, hold);
+    CHECK(run(alerts, SIGNAL_WATER, trace({ 20, 5, 20, 5, 20, 5, 20 }, interval)).empty());
+    CHECK(!alerts.isActive(low));
+
+    // the second of two low readings raises, whether readings are on time
+    // or up to half an interval late
+    for (int round = 0; round < 200; round++) {
+      RDTRC_AlertEngine jittered;
+      jittered.addRule(SIGNAL_WATER, RDTRC_ALERT_BELOW, 8, 2, hold);
+      std::vector<Reading> readings = trace({ 20, 20, 5, 5, 5 }, interval, round ? hold : 0);
+      std::vector<RDTRC_AlertEvent> events = run(jittered, SIGNAL_WATER, readings);
+      CHECK(events.size() == 1);
+      if (events.size() == 1) {
+        CHECK(events[0].raised);
+        CHECK(events[0].time == readings[3].time);
+      }
+    }
+  }
+
+  // a hold of a whole interval, as the sketches had, needs a third
+  // reading as soon as the second one runs earlier than the first did
+  RDTRC_AlertEngine alerts;
+  alerts.addRule(SIGNAL_WATER, RDTRC_ALERT_BELOW, 8, 2, 45000);
+  std::vector<Reading> readings = { { 1000, 5 }, { 45500, 5 }, { 90000, 5 } };
+  std::vector<RDTRC_AlertEvent> events = run(alerts, SIGNAL_WATER, readings);
+  CHECK(events.size() == 1 && events[0].time == 90000);
+}
+
+static void test_hysteresis() {
+  printf("a noisy signal around the threshold raises once and clears past the band\n");
+  RDTRC_AlertEngine alerts;
+  int high = alerts.addRule(SIGNAL_TEMPERATURE, RDTRC_ALERT_ABOVE, 35, 1.0);
+
+  // 34.5 .. 35.5 noise: above the threshold half of the time, never below
+  // threshold - hysteresis
+  std::vector<float> values;
+  for (int i = 0; i < 100; i++) values.push_back(35 + ((i * 7) % 11 - 5) / 10.0f);
+  std::vector<RDTRC_AlertEvent> events = run(alerts, SIGNAL_TEMPERATURE, trace(values, 45000));
+  CHECK(events.size() == 1 && events[0].raised);
+  CHECK(alerts.isActive(high));
+
+  events = run(alerts, SIGNAL_TEMPERATURE, trace({ 34.2f, 34.0f, 33.9f }, 45000, 0, 100 * 45000));
+  CHECK(events.size() == 1);
+  if (events.size() == 1) {
+    CHECK(!events[0].raised);
+    CHECK(events[0].value < 34.0f);
+  }
+  CHECK(!alerts.isActive(high));
+}
+
+static void test_cooldown() {
+  printf("a rule that trips again during its cooldown raises once the cooldown ends\n");
+  RDTRC_AlertEngine alerts;
+  alerts.addRule(SIGNAL_WATER, RDTRC_ALERT_BELOW, 8, 2, 0, 1800000, RDTRC_ALERT_CRITICAL);
+
+  // low, refilled, low again a reading later and staying low
+  std::vector<float> values = { 5, 15 };
+  for (int i = 0; i < 60; i++) values.push_back(5);
+  // readings every 30 s: raise at 0, clear at 30 s, raise again at 30 min
+  std::vector<RDTRC_AlertEvent> events = run(alerts, SIGNAL_WATER, trace(values, 30000));
+  CHECK(events.size() == 3);
+  if (events.size() == 3) {
+    CHECK(events[0].raised && events[0].time == 0);
+    CHECK(!events[1].raised && events[1].time == 30000);
+    CHECK(events[2].raised && events[2].time == 1800000);
+    CHECK(events[2].severity == RDTRC_ALERT_CRITICAL);
+  }
+}
+
+static void test_offline_sensor() {
+  printf("offline readings (NaN) neither clear nor restart a pending condition\n");
+  RDTRC_AlertEngine alerts;
+  int low = alerts.addRule(SIGNAL_WATER, RDTRC_ALERT_BELOW, 8, 2, 22500);
+
+  std::vector<RDTRC_AlertEvent> events =
+      run(alerts, SIGNAL_WATER, trace({ 5, NAN, NAN, 5, NAN, 20, 12 }, 45000));
+  CHECK(events.size() == 2);
+  if (events.size() == 2) {
+    CHECK(events[0].raised && events[0].time == 3 * 45000);
+    CHECK(!events[1].raised && events[1].time == 5 * 45000);
+  }
+  CHECK(!alerts.isActive(low));
+  CHECK(alerts.value(SIGNAL_WATER) == 12);
+}
+
+static void test_rules_per_signal() {
+  printf("rules on one signal fire in declaration order, other signals are untouched\n");
+  RDTRC_AlertEngine alerts;
+  int lowPH = alerts.addRule(SIGNAL_PH, RDTRC_ALERT_BELOW, 6.0f, 0.2f);
+  int water = alerts.addRule(SIGNAL_WATER, RDTRC_ALERT_BELOW, 8, 2);
+  int highPH = alerts.addRule(SIGNAL_PH, RDTRC_ALERT_ABOVE, 7.0f, 0.2f);
+  int veryHighPH = alerts.addRule(SIGNAL_PH, RDTRC_ALERT_ABOVE, 8.0f, 0.2f, 0, 0, RDTRC_ALERT_CRITICAL);
+
+  std::vector<RDTRC_AlertEvent> events = run(alerts, SIGNAL_PH, trace({ 5.5f, 6.5f, 8.5f, 6.5f }, 45000));
+  CHECK(events.size() == 6);
+  if (events.size() == 6) {
+    CHECK(events[0].rule == lowPH && events[0].raised);
+    CHECK(events[1].rule == lowPH && !events[1].raised);
+    CHECK(events[2].rule == highPH && events[2].raised);
+    CHECK(events[3].rule == veryHighPH && events[3].raised);
+    CHECK(events[4].rule == highPH && !events[4].raised);
+    CHECK(events[5].rule == veryHighPH && !events[5].raised);
+  }
+  CHECK(!alerts.isActive(water));
+  CHECK(isnan(alerts.value(SIGNAL_WATER)));
+  CHECK(alerts.addRule(RDTRC_ALERT_MAX_SIGNALS, RDTRC_ALERT_BELOW, 1) == -1);
+}
+
+static void test_queue_full() {
+  printf("events beyond the queue are counted as dropped, not overwritten\n");
+  RDTRC_AlertEngine alerts;
+  alerts.addRule(SIGNAL_WATER, RDTRC_ALERT_BELOW, 8, 2);
+
+  // nobody polls: every transition is an event
+  for (int i = 0; i < 2 * RDTRC_ALERT_QUEUE_SIZE; i++) {
+    alerts.update(SIGNAL_WATER, i % 2 ? 20 : 5, i * 1000UL);
+  }
+  CHECK(alerts.pending() == RDTRC_ALERT_QUEUE_SIZE);
+  CHECK(alerts.dropped() == RDTRC_ALERT_QUEUE_SIZE);
+
+  RDTRC_AlertEvent event;
+  CHECK(alerts.poll(event) && event.raised && event.time == 0);
+}
+
+static void test_millis_wrap() {
+  printf("hold and cooldown work across the millis() wrap\n");
+  RDTRC_AlertEngine alerts;
+  alerts.addRule(SIGNAL_WATER, RDTRC_ALERT_BELOW, 8, 2, 22500, 1800000);
+
+  unsigned long start = 0UL - 60000;  // one minute before the wrap
+  std::vector<Reading> readings = trace({ 5, 5, 20, 5, 5 }, 45000, 0, start);
+  std::vector<RDTRC_AlertEvent> events = run(alerts, SIGNAL_WATER, readings);
+  // raised at the second reading, cleared, then held back by the cooldown
+  CHECK(events.size() == 2);
+  if (events.size() == 2) {
+    CHECK(events[0].raised && events[0].time == readings[1].time);
+    CHECK(!events[1].raised);
+  }
+
+  events = run(alerts, SIGNAL_WATER, trace({ 5 }, 45000, 0, readings[1].time + 1800000));
+  CHECK(events.size() == 1 && events[0].raised);
+}
+
+int main() {
+  srand(1);
+
+  test_hold_two_readings();
+  test_hysteresis();
+  test_cooldown();
+  test_offline_sensor();
+  test_rules_per_signal();
+  test_queue_full();
+  test_millis_wrap();
+
+  return test_summary();
+}
@@ -0,0 +1,154 @@
+// Minimal Arduino core for building the RDTRC task, scheduler, alert and
+// notify libraries on a POSIX host
+#pragma once
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using std::min;
+using std::max;
+
+#ifdef HOST_SIMULATED_CLOCK
+
+// Time only moves when the test sets it or something calls delay()
+inline unsigned long& hostMillis() {
+  static unsigned long now = 0;
+  return now;
+}
+
+inline unsigned long millis() {
+  return hostMillis();
+}
+
+inline unsigned long micros() {
+  return hostMillis() * 1000;
+}
+
+inline void delay(unsigned long ms) {
+  hostMillis() += ms;
+}
+
+#else
+
+inline unsigned long micros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+inline unsigned long millis() {
+  return micros() / 1000;
+}
+
+inline void delay(unsigned long ms) {
+  usleep(ms * 1000);
+}
+
+#endif // HOST_SIMULATED_CLOCK
+
+inline void yield() {
+}
+
+class String {
+  public:
+    String() {}
+    String(const char* s) : value(s ? s : "") {}
+    String(const std::string& s) : value(s) {}
+    explicit String(int n) : value(std::to_string(n)) {}
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.size(); }
+    void reserve(unsigned int size) { value.reserve(size); }
+    String& operator+=(char c) { value += c; return *this; }
+    String& operator+=(const String& s) { value += s.value; return *this; }
+    friend String operator+(const String& a, const String& b) { return a.value + b.value; }
+    friend String operator+(const char* a, const String& b) { return a + b.value; }
+    bool operator==(const char* s) const { return value == s; }
+
+  private:
+    std::string value;
+};
+
+struct HostSerial {
+  void println(const String&) {}
+};
+
+static HostSerial Serial __attribute__((unused));
+
+#ifdef ESP32
+
+// FreeRTOS on std::thread, enough for one task per object that sleeps in
+// ulTaskNotifyTake() until xTaskNotifyGive() or a timeout
+
+typedef std::mutex* SemaphoreHandle_t;
+typedef unsigned long TickType_t;
+typedef int BaseType_t;
+
+struct HostTask {
+  std::mutex lock;
+  std::condition_variable wake;
+  unsigned long notifications = 0;
+};
+typedef HostTask* TaskHandle_t;
+
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY ((TickType_t)-1)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+inline HostTask*& hostCurrentTask() {
+  static thread_local HostTask* task = nullptr;
+  return task;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new std::mutex; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t) { m->lock(); return pdTRUE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t m) { m->unlock(); return pdTRUE; }
+
+// Tasks run until the process exits, so their objects must outlive main()
+inline BaseType_t xTaskCreatePinnedToCore(void (*entry)(void*), const char*, uint32_t, void* arg,
+                                          unsigned, TaskHandle_t* handle, int) {
+  HostTask* task = new HostTask;
+  *handle = task;
+  std::thread([=] {
+    hostCurrentTask() = task;
+    entry(arg);
+  }).detach();
+  return pdPASS;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> guard(task->lock);
+  task->notifications++;
+  task->wake.notify_one();
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  HostTask* task = hostCurrentTask();
+  std::unique_lock<std::mutex> guard(task->lock);
+  auto notified = [task] { return task->notifications > 0; };
+  if (ticks == portMAX_DELAY) {
+    task->wake.wait(guard, notified);
+  } else {
+    task->wake.wait_for(guard, std::chrono::milliseconds(ticks), notified);
+  }
+  uint32_t count = task->notifications;
+  if (clear) {
+    task->notifications = 0;
+  } else if (count) {
+    task->notifications--;
+  }
+  return count;
+}
+
+#endif // ESP32
@@ -0,0 +1,57 @@
+// HTTPClient for host builds. Requests are written out in HTTP/1.1 wire
+// format and handed to hostHttpServer, which plays the remote end and
+// returns the status code. Like the TLS handshake on the device, the
+// connection is refused unless the client trusts hostHttpServerRoot or
+// was set to insecure.
+#pragma once
+
+#include <functional>
+
+#include "Arduino.h"
+#include "WiFiClientSecure.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+static std::function<int(const std::string& request)> hostHttpServer;
+static const char* hostHttpServerRoot = "";
+
+class HTTPClient {
+  public:
+    bool begin(WiFiClientSecure& client, const char* url) {
+      secure = &client;
+      std::string u(url);
+      size_t host = u.find("://") + 3;
+      size_t path = u.find('/', host);
+      this->host = u.substr(host, path - host);
+      this->path = u.substr(path);
+      headers.clear();
+      return true;
+    }
+
+    void setReuse(bool reuse) { this->reuse = reuse; }
+
+    void addHeader(const String& name, const String& value) {
+      headers += std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+    }
+
+    int POST(const String& body) {
+      bool trusted = secure->insecure ||
+                     (secure->caCert && strstr(secure->caCert, hostHttpServerRoot));
+      if (!trusted || !hostHttpServer) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+      std::string request = "POST " + path + " HTTP/1.1\r\nHost: " + host + "\r\n" +
+                            (reuse ? "Connection: keep-alive\r\n" : "Connection: close\r\n") +
+                            headers + "Content-Length: " + std::to_string(body.length()) +
+                            "\r\n\r\n" + body.c_str();
+      return hostHttpServer(request);
+    }
+
+    void end() {}
+
+  private:
+    WiFiClientSecure* secure = nullptr;
+    std::string host;
+    std::string path;
+    std::string headers;
+    bool reuse = false;
+};
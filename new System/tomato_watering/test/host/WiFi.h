@@ -0,0 +1,13 @@
+// WiFi status for host builds, set by the test
+#pragma once
+
+#include "Arduino.h"
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+
+struct HostWiFi {
+  volatile wl_status_t state = WL_CONNECTED;
+  wl_status_t status() { return state; }
+};
+
+static HostWiFi WiFi;
@@ -0,0 +1,14 @@
+// WiFiClientSecure for host builds: only remembers how the server
+// certificate is to be checked, for the HTTPClient stand-in
+#pragma once
+
+#include "Arduino.h"
+
+class WiFiClientSecure {
+  public:
+    void setCACert(const char* rootCA) { caCert = rootCA; insecure = false; }
+    void setInsecure() { caCert = nullptr; insecure = true; }
+
+    const char* caCert = nullptr;
+    bool insecure = false;
+};
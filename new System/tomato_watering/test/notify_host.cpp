@@ -0,0 +1,260 @@
+/*
+ * RDTRC_LineNotifier against a local stand-in for the LINE Notify API:
+ * requests carry the token and the form encoded message, the server
+ * certificate is checked against the LINE roots unless insecure mode is
+ * chosen explicitly, failures are retried, given up or held back while
+ * WiFi is down, and long messages are coalesced on what the queue keeps.
+ * The sender task runs on std::thread.
+ *
+ * Build & run (from the sketch folder):
+ *   c++ -std=gnu++11 -O2 -pthread -DESP32 -I../test -Itest/host test/notify_host.cpp -o notify_host
+ *   ./notify_host
+ */
+
+#include <stdlib.h>
+#include <deque>
+#include <vector>
+
+#include "../RDTRC_Notify_Library.h"
+#include "host_test.h"
+
+static const char* token = "test-token-0123456789";
+
+// Start of DigiCert Global Root G2, which the LINE chain ends in
+static const char* lineRoot = "MIIDjjCCAnagAwIBAgIQAzrx5qcRqaC7KGSxHQn65TAN";
+
+/*
+ * LINE Notify stand-in
+ */
+
+struct LineStandIn {
+  std::mutex lock;
+  std::vector<std::string> messages;  // decoded messages it accepted
+  std::deque<int> script;             // status codes to answer before 200
+  int requests = 0;
+  bool keepAlive = true;
+
+  static std::string formDecode(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++) {
+      if (text[i] == '+') {
+        out += ' ';
+      } else if (text[i] == '%' && i + 2 < text.size()) {
+        out += (char)strtol(text.substr(i + 1, 2).c_str(), nullptr, 16);
+        i += 2;
+      } else {
+        out += text[i];
+      }
+    }
+    return out;
+  }
+
+  int handle(const std::string& request) {
+    std::lock_guard<std::mutex> guard(lock);
+    requests++;
+    keepAlive = keepAlive && request.find("Connection: keep-alive\r\n") != std::string::npos;
+
+    if (request.compare(0, 34, "POST /api/notify HTTP/1.1\r\nHost: n") != 0 ||
+        request.find("Host: notify-api.line.me\r\n") == std::string::npos ||
+        request.find("Content-Type: application/x-www-form-urlencoded\r\n") == std::string::npos) {
+      return 400;
+    }
+    if (request.find("Authorization: Bearer " + std::string(token) + "\r\n") == std::string::npos) {
+      return 401;
+    }
+    if (!script.empty()) {
+      int status = script.front();
+      script.pop_front();
+      return status;
+    }
+
+    size_t body = request.find("\r\n\r\n") + 4;
+    if (request.compare(body, 8, "message=") != 0) return 400;
+    messages.push_back(formDecode(request.substr(body + 8)));
+    return 200;
+  }
+
+  void reset() {
+    std::lock_guard<std::mutex> guard(lock);
+    messages.clear();
+    script.clear();
+    requests = 0;
+  }
+
+  size_t received() {
+    std::lock_guard<std::mutex> guard(lock);
+    return messages.size();
+  }
+};
+
+static LineStandIn line;
+
+// Notifiers are never destroyed: their sender tasks run until exit
+static RDTRC_LineNotifier* newNotifier() {
+  RDTRC_LineNotifier* notifier = new RDTRC_LineNotifier;
+  RDTRC_NotifyQueue::Config config;
+  config.coalesceWindow = 60000;
+  config.retryDelay = 10;
+  config.maxRetryDelay = 40;
+  config.maxAttempts = 3;
+  notifier->setConfig(config);
+  return notifier;
+}
+
+// Wait until the notifier has nothing left to send
+static bool drained(RDTRC_LineNotifier* notifier, unsigned long timeout = 2000) {
+  unsigned long start = millis();
+  while (millis() - start < timeout) {
+    if (notifier->pending() == 0) return true;
+    delay(1);
+  }
+  return false;
+}
+
+/*
+ * Tests
+ */
+
+static void test_delivery() {
+  printf("messages reach LINE form encoded, with the token, over a verified connection\n");
+  line.reset();
+  hostHttpServerRoot = lineRoot;
+
+  RDTRC_LineNotifier* notifier = newNotifier();
+  CHECK(!notifier->send("before begin"));
+  CHECK(notifier->begin(token));
+
+  CHECK(notifier->send("Low water level: 12% & falling"));
+  CHECK(notifier->send("ความชื้นดิน 30%"));
+  CHECK(drained(notifier));
+
+  CHECK(line.received() == 2);
+  if (line.received() == 2) {
+    CHECK(line.messages[0] == "Low water level: 12% & falling");
+    CHECK(line.messages[1] == "ความชื้นดิน 30%");
+  }
+  CHECK(line.keepAlive);
+  CHECK(notifier->getStats().sent == 2);
+}
+
+static void test_certificate() {
+  printf("an untrusted server certificate is refused, insecure mode is an explicit opt-in\n");
+  line.reset();
+  hostHttpServerRoot = "some other root";
+
+  RDTRC_LineNotifier* verified = newNotifier();
+  CHECK(verified->begin(token));
+  CHECK(verified->send("to the wrong server"));
+  CHECK(drained(verified));
+  CHECK(line.requests == 0);
+  CHECK(verified->getStats().failed == 1);
+  CHECK(verified->getStats().retries == 2);
+
+  RDTRC_LineNotifier* insecure = newNotifier();
+  insecure->setInsecure();
+  CHECK(insecure->begin(token));
+  CHECK(insecure->send("accepted anyway"));
+  CHECK(drained(insecure));
+  CHECK(line.received() == 1);
+
+  // a custom root replaces the built-in ones
+  line.reset();
+  hostHttpServerRoot = "private root";
+  RDTRC_LineNotifier* custom = newNotifier();
+  custom->setCACert("-----BEGIN CERTIFICATE-----\nprivate root\n-----END CERTIFICATE-----\n");
+  CHECK(custom->begin(token));
+  CHECK(custom->send("to a private server"));
+  CHECK(drained(custom));
+  CHECK(line.received() == 1);
+}
+
+static void test_retries() {
+  printf("server errors and rate limits are retried, a rejected token is not\n");
+  line.reset();
+  hostHttpServerRoot = lineRoot;
+
+  RDTRC_LineNotifier* notifier = newNotifier();
+  CHECK(notifier->begin(token));
+  line.script = std::deque<int>{ 500, 429 };
+  CHECK(notifier->send("eventually"));
+  CHECK(drained(notifier));
+  CHECK(line.received() == 1);
+  CHECK(line.requests == 3);
+  CHECK(notifier->getStats().retries == 2);
+  CHECK(notifier->getStats().sent == 1);
+
+  line.reset();
+  RDTRC_LineNotifier* rejected = newNotifier();
+  CHECK(rejected->begin("wrong-token-0123456789"));
+  CHECK(rejected->send("never"));
+  CHECK(drained(rejected));
+  CHECK(line.requests == 1);
+  CHECK(rejected->getStats().failed == 1);
+  CHECK(rejected->getStats().retries == 0);
+}
+
+static void test_offline() {
+  printf("messages wait while WiFi is down and duplicates are coalesced\n");
+  line.reset();
+  hostHttpServerRoot = lineRoot;
+
+  RDTRC_LineNotifier* notifier = newNotifier();
+  CHECK(notifier->begin(token));
+
+  WiFi.state = WL_DISCONNECTED;
+  CHECK(notifier->send("pump stalled"));
+  CHECK(!notifier->send("pump stalled"));
+  delay(100);
+  CHECK(line.requests == 0);
+  CHECK(notifier->pending() == 1);
+
+  WiFi.state = WL_CONNECTED;
+  CHECK(drained(notifier));
+  CHECK(line.received() == 1);
+  if (line.received() == 1) {
+    CHECK(line.messages[0] == "pump stalled (x2)");
+  }
+  CHECK(notifier->getStats().failed == 0);
+
+  // sent recently: merged instead of sent again
+  CHECK(!notifier->send("pump stalled"));
+  CHECK(notifier->getStats().coalesced == 2);
+}
+
+static void test_long_messages() {
+  printf("messages longer than an entry are coalesced on the part that is kept\n");
+  RDTRC_NotifyQueue queue;
+  std::string text(RDTRC_NOTIFY_MESSAGE_LENGTH + 40, 'w');
+
+  CHECK(queue.push(text.c_str(), 1000));
+  CHECK(!queue.push(text.c_str(), 2000));
+  // differs only past the cut: stored the same, so the same message
+  text[RDTRC_NOTIFY_MESSAGE_LENGTH + 10] = 'x';
+  CHECK(!queue.push(text.c_str(), 3000));
+  CHECK(queue.size() == 1);
+  CHECK(queue.getStats().coalesced == 2);
+
+  char buffer[RDTRC_NOTIFY_MESSAGE_LENGTH + 16];
+  CHECK(queue.next(buffer, sizeof(buffer), 3000));
+  CHECK(strlen(buffer) == RDTRC_NOTIFY_MESSAGE_LENGTH - 1 + strlen(" (x3)"));
+
+  // and once sent, a repeat within the window is held back
+  queue.complete(200, 4000);
+  CHECK(!queue.push(text.c_str(), 5000));
+  CHECK(queue.size() == 0);
+  // a message that differs within the kept part is a new one
+  text[0] = 'x';
+  CHECK(queue.push(text.c_str(), 5000));
+}
+
+int main() {
+  hostHttpServer = [](const std::string& request) { return line.handle(request); };
+
+  test_delivery();
+  test_certificate();
+  test_retries();
+  test_offline();
+  test_long_messages();
+
+  return test_summary();
+}
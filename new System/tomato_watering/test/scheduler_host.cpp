@@ -0,0 +1,330 @@
+/*
+ * RDTRC_Scheduler on a simulated clock: periodic jobs keep their phase
+ * whatever their callbacks cost, missed periods are skipped rather than
+ * replayed, one-shots, cancel and reschedule (also from callbacks), many
+ * jobs against a brute-force reference, idle() sleep lengths and the
+ * millis() wrap. The benchmark counts loop wakeups for the sketches' job
+ * set over a simulated day.
+ *
+ * Build & run (from the sketch folder):
+ *   c++ -std=gnu++11 -O2 -I../test -Itest/host test/scheduler_host.cpp -o scheduler_host
+ *   ./scheduler_host          # tests
+ *   ./scheduler_host bench    # wakeups per simulated day
+ */
+
+#define HOST_SIMULATED_CLOCK
+
+#include <stdlib.h>
+#include <vector>
+
+#include "../RDTRC_Scheduler_Library.h"
+#include "host_test.h"
+
+struct Run {
+  int job;
+  unsigned long time;
+};
+
+static std::vector<Run> runs;
+static unsigned long jobCost;  // ms each callback takes
+
+static void record(int job) {
+  runs.push_back(Run{ job, millis() });
+  delay(jobCost);
+}
+
+static void job0() { record(0); }
+static void job1() { record(1); }
+static void job2() { record(2); }
+static void job3() { record(3); }
+static void job4() { record(4); }
+static void job5() { record(5); }
+static void job6() { record(6); }
+static void job7() { record(7); }
+
+static RDTRC_JobCallback const callbacks[] = { job0, job1, job2, job3, job4, job5, job6, job7 };
+
+static std::vector<unsigned long> timesOf(int job) {
+  std::vector<unsigned long> times;
+  for (size_t i = 0; i < runs.size(); i++) {
+    if (runs[i].job == job) times.push_back(runs[i].time);
+  }
+  return times;
+}
+
+// The sketches' loop(): run due jobs, then sleep until the next one
+static void loopUntil(RDTRC_Scheduler& scheduler, unsigned long end, unsigned long maxSleep = RDTRC_SCHED_IO_POLL) {
+  while ((long)(millis() - end) < 0) {
+    scheduler.run();
+    scheduler.idle(min(maxSleep, end - millis()));
+  }
+}
+
+static void reset(unsigned long now = 0) {
+  hostMillis() = now;
+  runs.clear();
+  jobCost = 0;
+}
+
+/*
+ * Tests
+ */
+
+static void test_phase() {
+  printf("periodic jobs keep their phase when callbacks take time\n");
+  reset();
+  RDTRC_Scheduler scheduler;
+  jobCost = 137;
+  scheduler.every(1000, job0, 500);
+  scheduler.every(45000, job1, 45000);
+  loopUntil(scheduler, 10 * 60000UL);
+
+  std::vector<unsigned long> fast = timesOf(0);
+  std::vector<unsigned long> slow = timesOf(1);
+  CHECK(fast.size() == 600);
+  CHECK(slow.size() == 13);
+  bool onTime = true;
+  for (size_t i = 0; i < slow.size(); i++) {
+    onTime = onTime && slow[i] == 45000 * (i + 1);
+  }
+  CHECK(onTime);
+  // the fast job is only ever late by the slow job's cost, never drifts
+  bool noDrift = true;
+  for (size_t i = 0; i < fast.size(); i++) {
+    noDrift = noDrift && fast[i] - (500 + 1000 * i) <= 137;
+  }
+  CHECK(noDrift);
+  CHECK(fast.back() == 500 + 1000 * 599);
+  CHECK(scheduler.maxLateness() <= 137);
+}
+
+static void test_missed_periods() {
+  printf("after a stall, a periodic job runs once and restarts from now\n");
+  reset();
+  RDTRC_Scheduler scheduler;
+  scheduler.every(1000, job0, 1000);
+  loopUntil(scheduler, 3500);
+  CHECK(runs.size() == 3);
+
+  delay(10000);  // e.g. a blocking WiFi reconnect
+  scheduler.run();
+  CHECK(runs.size() == 4);
+  scheduler.run();
+  CHECK(runs.size() == 4);
+  CHECK(scheduler.maxLateness() == 13500 - 4000);
+  CHECK(scheduler.timeUntilNext() == 1000);
+
+  loopUntil(scheduler, 16000);
+  std::vector<unsigned long> times = timesOf(0);
+  CHECK(times.size() == 6);
+  CHECK(times[4] == 14500 && times[5] == 15500);
+}
+
+static void test_one_shot_and_cancel() {
+  printf("one-shots run once; cancel, reschedule and setPeriod take effect\n");
+  reset();
+  RDTRC_Scheduler scheduler;
+  int once = scheduler.after(5000, job0);
+  int periodic = scheduler.every(2000, job1, 2000);
+  int cancelled = scheduler.after(3000, job2);
+  CHECK(scheduler.jobCount() == 3);
+
+  scheduler.cancel(cancelled);
+  CHECK(!scheduler.isScheduled(cancelled));
+  loopUntil(scheduler, 6000);
+  CHECK(timesOf(0).size() == 1 && timesOf(0)[0] == 5000);
+  CHECK(!scheduler.isScheduled(once));
+  CHECK(timesOf(1).size() == 2);
+  CHECK(timesOf(2).empty());
+
+  // run right away, then every 500 ms from there
+  scheduler.setPeriod(periodic, 500);
+  scheduler.reschedule(periodic, 0);
+  scheduler.run();
+  CHECK(timesOf(1).size() == 3 && timesOf(1)[2] == 6000);
+  loopUntil(scheduler, 7100);
+  CHECK(timesOf(1).size() == 5 && timesOf(1)[4] == 7000);
+
+  // freed slots are reused
+  CHECK(scheduler.after(100, job3) >= 0);
+  scheduler.cancel(periodic);
+  scheduler.cancel(periodic);
+  CHECK(scheduler.jobCount() == 1);
+}
+
+static RDTRC_Scheduler* nested;
+static int nestedId;
+static int selfId;
+
+static void cancelOther() {
+  record(6);
+  // cancel the other periodic job and queue a one-shot that is already due
+  nested->cancel(nestedId);
+  nested->after(0, job7);
+}
+
+static void runAgainNow() {
+  record(5);
+  nested->reschedule(selfId, 0);
+}
+
+static void test_callbacks_change_jobs() {
+  printf("callbacks may add, cancel and reschedule jobs, and run() still returns\n");
+  reset();
+  RDTRC_Scheduler scheduler;
+  nested = &scheduler;
+  scheduler.every(1000, cancelOther, 1000);
+  nestedId = scheduler.every(1000, job1, 1500);
+
+  hostMillis() = 1000;
+  scheduler.run();
+  CHECK(!scheduler.isScheduled(nestedId));
+  CHECK(runs.size() == 2);
+  if (runs.size() == 2) {
+    CHECK(runs[0].job == 6 && runs[1].job == 7);
+  }
+  loopUntil(scheduler, 3000);
+  CHECK(timesOf(1).empty());
+  CHECK(timesOf(6).size() == 2);
+
+  // a job that keeps itself due runs at most once per job in the table
+  reset();
+  RDTRC_Scheduler busy;
+  nested = &busy;
+  selfId = busy.every(1000, runAgainNow);
+  busy.after(0, job0);
+  busy.run();
+  CHECK(timesOf(5).size() <= 2);
+  CHECK(timesOf(0).size() == 1);
+  CHECK(busy.timeUntilNext() == 0);
+}
+
+static void test_limits() {
+  printf("the job table fills up and bad arguments are refused\n");
+  reset();
+  RDTRC_Scheduler scheduler;
+  CHECK(scheduler.every(0, job0) == -1);
+  CHECK(scheduler.after(10, NULL) == -1);
+  for (int i = 0; i < RDTRC_SCHED_MAX_JOBS; i++) {
+    CHECK(scheduler.after(1000 + i, callbacks[i % 8]) == i);
+  }
+  CHECK(scheduler.after(10, job0) == -1);
+  CHECK(scheduler.timeUntilNext() == 1000);
+
+  RDTRC_Scheduler empty;
+  CHECK(empty.timeUntilNext() == ULONG_MAX);
+  empty.cancel(-1);
+  empty.cancel(RDTRC_SCHED_MAX_JOBS);
+  empty.reschedule(3, 0);
+  CHECK(empty.jobCount() == 0);
+}
+
+static void test_against_reference() {
+  printf("many jobs run exactly when a brute-force reference says they should\n");
+  srand(7);
+  for (int round = 0; round < 50; round++) {
+    reset();
+    RDTRC_Scheduler scheduler;
+    unsigned long period[8], first[8];
+    for (int j = 0; j < 8; j++) {
+      period[j] = 1 + rand() % 5000;
+      first[j] = rand() % 5000;
+      scheduler.every(period[j], callbacks[j], first[j]);
+    }
+    const unsigned long end = 120000;
+    loopUntil(scheduler, end);
+
+    bool match = true;
+    for (int j = 0; j < 8; j++) {
+      std::vector<unsigned long> times = timesOf(j);
+      std::vector<unsigned long> expected;
+      for (unsigned long t = first[j]; t < end; t += period[j]) expected.push_back(t);
+      match = match && times == expected;
+    }
+    CHECK(match);
+    // in deadline order, ties in any order
+    bool ordered = true;
+    for (size_t i = 1; i < runs.size(); i++) ordered = ordered && runs[i - 1].time <= runs[i].time;
+    CHECK(ordered);
+    CHECK(scheduler.maxLateness() == 0);
+  }
+}
+
+static void test_idle() {
+  printf("idle() sleeps until the next job, at most the I/O poll interval\n");
+  reset();
+  RDTRC_Scheduler scheduler;
+  scheduler.after(25, job0);
+
+  scheduler.idle();
+  CHECK(millis() == RDTRC_SCHED_IO_POLL);
+  scheduler.idle(1000);
+  CHECK(millis() == 25);
+  scheduler.idle(1000);  // a job is due: no sleep
+  CHECK(millis() == 25);
+  CHECK(scheduler.wakeups() == 2);
+  scheduler.run();
+  scheduler.idle(1000);  // nothing left: the full maxSleep
+  CHECK(millis() == 1025);
+}
+
+static void test_wrap() {
+  printf("deadlines stay ordered across the millis() wrap\n");
+  reset(0UL - 2500);
+  RDTRC_Scheduler scheduler;
+  scheduler.every(1000, job0, 1000);
+  scheduler.after(3000, job1);
+  loopUntil(scheduler, 4000);
+
+  std::vector<unsigned long> times = timesOf(0);
+  CHECK(times.size() == 6);
+  CHECK(times[0] == 0UL - 1500 && times[2] == 500 && times[5] == 3500);
+  CHECK(timesOf(1).size() == 1 && timesOf(1)[0] == 500);
+  CHECK(runs[2].job == 0 && runs[3].job == 1);
+  CHECK(scheduler.maxLateness() == 0);
+}
+
+/*
+ * Benchmark
+ */
+
+static void benchmark() {
+  printf("loop wakeups per simulated day with the tomato job set:\n");
+  static const unsigned long pollIntervals[] = { 1, RDTRC_SCHED_IO_POLL, 100, ULONG_MAX };
+
+  for (unsigned long poll : pollIntervals) {
+    reset();
+    RDTRC_Scheduler scheduler;
+    scheduler.every(45000, job0, 45000);    // sensors
+    scheduler.every(60000, job1, 60000);    // watering schedule
+    scheduler.every(900000, job2, 900000);  // data log
+    scheduler.every(300000, job3, 300000);  // maintenance
+    loopUntil(scheduler, 86400000UL, poll);
+
+    char label[48];
+    if (poll == ULONG_MAX) {
+      snprintf(label, sizeof(label), "no I/O polling");
+    } else {
+      snprintf(label, sizeof(label), "I/O poll %lu ms", poll);
+    }
+    printf("  %-20s %10lu wakeups %8lu job runs\n", label, scheduler.wakeups(), scheduler.runs());
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    benchmark();
+    return 0;
+  }
+
+  test_phase();
+  test_missed_periods();
+  test_one_shot_and_cancel();
+  test_callbacks_change_jobs();
+  test_limits();
+  test_against_reference();
+  test_idle();
+  test_wrap();
+
+  return test_summary();
+}
@@ -0,0 +1,351 @@
+/*
+ * RDTRC_Queue and RDTRC_Snapshot under real threads, and control loop
+ * latency with network stalls: everything in one loop() against the
+ * control and network task split, on std::thread.
+ *
+ * Build & run (from the sketch folder):
+ *   c++ -std=gnu++11 -O2 -pthread -I../test -Itest/host test/tasks_host.cpp -o tasks_host
+ *   ./tasks_host          # tests
+ *   ./tasks_host bench    # latency figures over a longer run
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../RDTRC_Tasks_Library.h"
+#include "../RDTRC_Scheduler_Library.h"
+#include "host_test.h"
+
+/*
+ * Queue
+ */
+
+static void test_queue_single_thread() {
+  printf("queue fills, drains in order and counts drops\n");
+  RDTRC_Queue<int, 8> queue;
+  int value = -1;
+
+  CHECK(queue.empty());
+  CHECK(!queue.pop(value));
+  for (int i = 0; i < 8; i++) CHECK(queue.push(i));
+  CHECK(!queue.push(8));
+  CHECK(queue.size() == 8);
+  CHECK(queue.dropped() == 1);
+
+  // Wrap the indices around many times
+  bool inOrder = true;
+  int next = 0;
+  for (int i = 8; i < 100000; i++) {
+    inOrder &= queue.pop(value) && value == next++;
+    inOrder &= queue.push(i);
+  }
+  CHECK(inOrder);
+  CHECK(queue.size() == 8);
+}
+
+static void test_queue_threads() {
+  printf("queue between two threads: every item once, in order\n");
+  static RDTRC_Queue<uint32_t, 16> queue;
+  const uint32_t count = 500000;
+
+  std::thread producer([&]() {
+    for (uint32_t i = 0; i < count; i++) {
+      while (!queue.push(i)) std::this_thread::yield();
+    }
+  });
+
+  uint32_t expected = 0, value;
+  bool inOrder = true;
+  while (expected < count) {
+    if (!queue.pop(value)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (value != expected) inOrder = false;
+    expected++;
+  }
+  producer.join();
+
+  CHECK(inOrder);
+  CHECK(queue.empty());
+}
+
+/*
+ * Snapshot
+ */
+
+struct Sample {
+  uint32_t sequence;
+  float values[30];
+  uint32_t check;
+};
+
+static void test_snapshot_threads() {
+  printf("snapshot readers never see a torn value\n");
+  static RDTRC_Snapshot<Sample> snapshot;
+  std::atomic<bool> done(false);
+  std::atomic<int> torn(0), backwards(0);
+  std::atomic<long> reads(0);
+
+  Sample first = snapshot.read();
+  CHECK(first.sequence == 0 && first.check == 0);
+
+  auto reader = [&]() {
+    uint32_t last = 0;
+    long count = 0;
+    while (!done.load()) {
+      Sample s;
+      uint32_t version = snapshot.read(s);
+      bool same = s.check == s.sequence * 7;
+      for (int i = 0; i < 30; i++) same &= s.values[i] == (float)s.sequence;
+      if (!same) torn++;
+      if (s.sequence < last || version != s.sequence) backwards++;
+      last = s.sequence;
+      count++;
+    }
+    reads += count;
+  };
+
+  std::thread a(reader), b(reader);
+  Sample s;
+  for (uint32_t i = 1; i <= 100000; i++) {
+    s.sequence = i;
+    for (int j = 0; j < 30; j++) s.values[j] = (float)i;
+    s.check = i * 7;
+    snapshot.publish(s);
+    if (i % 64 == 0) std::this_thread::yield();
+  }
+  done = true;
+  a.join();
+  b.join();
+
+  CHECK(torn == 0);
+  CHECK(backwards == 0);
+  CHECK(reads > 0);
+  CHECK(snapshot.version() == 100000);
+}
+
+/*
+ * Control latency: a pump is switched on every 250 ms and must be switched
+ * off 100 ms later, sensors are sampled every 20 ms. The network side
+ * polls every millisecond and, every 0.3 to 1 s, blocks for 0.2 to 1.5 s
+ * like a LINE HTTPS post, a Blynk reconnect or an LCD message. In one loop() the
+ * stall delays the pump shut-off; with the split it only delays the network.
+ */
+
+struct Stats {
+  std::vector<double> samples;  // ms
+
+  void add(double ms) {
+    samples.push_back(ms);
+  }
+
+  double average() const {
+    double sum = 0;
+    for (double v : samples) sum += v;
+    return samples.empty() ? 0 : sum / samples.size();
+  }
+
+  double percentile(double p) const {
+    if (samples.empty()) return 0;
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[(size_t)(p * (sorted.size() - 1))];
+  }
+
+  double maximum() const {
+    return percentile(1.0);
+  }
+};
+
+struct Command {
+  unsigned long sentAt;  // us
+};
+
+struct Event {
+  uint32_t pumpCycle;
+};
+
+struct State {
+  uint32_t samples;
+  uint32_t pumpCycles;
+  float moisture[4];
+};
+
+static RDTRC_Scheduler control;
+static RDTRC_Queue<Command, 8> commands;
+static RDTRC_Queue<Event, 16> telemetry;
+static RDTRC_Snapshot<State> controlState;
+
+static Stats pumpLateness, sampleJitter, commandLatency;
+static State state;
+static unsigned long pumpArmedAt, lastSample, nextStall;
+static std::atomic<bool> running;
+static unsigned int networkSeed;
+static long eventsSeen, stalls, tornStates;
+
+static void pumpOff() {
+  pumpLateness.add((micros() - pumpArmedAt) / 1000.0 - 100);
+  state.pumpCycles++;
+  Event event = { state.pumpCycles };
+  telemetry.push(event);
+  controlState.publish(state);
+}
+
+static void pumpOn() {
+  pumpArmedAt = micros();
+  control.after(100, pumpOff);
+}
+
+static void sampleSensors() {
+  unsigned long now = micros();
+  if (lastSample) sampleJitter.add(fabs((now - lastSample) / 1000.0 - 20));
+  lastSample = now;
+  state.samples++;
+  for (int i = 0; i < 4; i++) state.moisture[i] = (float)state.samples;
+  controlState.publish(state);
+}
+
+static void handleCommands() {
+  Command command;
+  while (commands.pop(command)) {
+    commandLatency.add((micros() - command.sentAt) / 1000.0);
+  }
+}
+
+static void controlPass() {
+  handleCommands();
+  control.run();
+  control.idle(RDTRC_SCHED_IO_POLL);
+}
+
+// One pass of web, Blynk and OTA polling
+static void networkPass() {
+  static unsigned long lastCommand;
+
+  Event event;
+  while (telemetry.pop(event)) eventsSeen++;
+
+  State s = controlState.read();
+  for (int i = 0; i < 4; i++) {
+    if (s.moisture[i] != (float)s.samples) tornStates++;
+  }
+
+  if (millis() - lastCommand >= 300) {
+    lastCommand = millis();
+    Command command = { micros() };
+    commands.push(command);
+  }
+
+  // Parsing and JSON work, then occasionally a blocking call
+  unsigned long busy = micros();
+  while (micros() - busy < 200) {
+  }
+  if ((long)(millis() - nextStall) >= 0) {
+    stalls++;
+    delay(200 + rand_r(&networkSeed) % 1300);
+    nextStall = millis() + 300 + rand_r(&networkSeed) % 700;
+  }
+}
+
+static void resetRun() {
+  control = RDTRC_Scheduler();
+  pumpLateness = sampleJitter = commandLatency = Stats();
+  state = State();
+  lastSample = 0;
+  networkSeed = 1;
+  nextStall = millis() + 300;
+  eventsSeen = stalls = tornStates = 0;
+  Command command;
+  while (commands.pop(command)) {
+  }
+  Event event;
+  while (telemetry.pop(event)) {
+  }
+}
+
+static void runSingleLoop(unsigned long durationMs) {
+  resetRun();
+  control.every(250, pumpOn);
+  control.every(20, sampleSensors);
+
+  unsigned long start = millis();
+  while (millis() - start < durationMs) {
+    networkPass();
+    controlPass();
+  }
+}
+
+static void runSplit(unsigned long durationMs) {
+  resetRun();
+  control.every(250, pumpOn);
+  control.every(20, sampleSensors);
+
+  running = true;
+  std::thread controlTask([]() {
+    control.begin();
+    while (running) controlPass();
+  });
+  std::thread networkTask([]() {
+    while (running) {
+      networkPass();
+      delay(1);
+    }
+  });
+
+  delay(durationMs);
+  running = false;
+  controlTask.join();
+  networkTask.join();
+}
+
+static void report(const char* name) {
+  printf("  %s, %ld network stalls\n", name, stalls);
+  printf("    pump off late:   avg %7.1f  p99 %7.1f  max %7.1f ms  (%zu)\n",
+         pumpLateness.average(), pumpLateness.percentile(0.99),
+         pumpLateness.maximum(), pumpLateness.samples.size());
+  printf("    sample jitter:   avg %7.1f  p99 %7.1f  max %7.1f ms  (%zu)\n",
+         sampleJitter.average(), sampleJitter.percentile(0.99),
+         sampleJitter.maximum(), sampleJitter.samples.size());
+  printf("    command latency: avg %7.1f  p99 %7.1f  max %7.1f ms  (%zu)\n",
+         commandLatency.average(), commandLatency.percentile(0.99),
+         commandLatency.maximum(), commandLatency.samples.size());
+}
+
+static void test_latency(unsigned long durationMs, bool verbose) {
+  printf("control latency with network stalls, one loop vs split\n");
+
+  runSingleLoop(durationMs);
+  double singleJitter = sampleJitter.maximum();
+  if (verbose) report("one loop()");
+
+  runSplit(durationMs);
+  if (verbose) report("control and network tasks");
+
+  CHECK(stalls > 0);
+  CHECK(singleJitter >= 150);
+  CHECK(pumpLateness.samples.size() >= durationMs / 250 - 2);
+  CHECK(pumpLateness.maximum() < 50);
+  CHECK(sampleJitter.percentile(0.99) < 20);
+  CHECK(tornStates == 0);
+  CHECK(telemetry.dropped() == 0);
+  // Events still queued when the run stopped are not counted
+  CHECK(eventsSeen + telemetry.size() == (long)pumpLateness.samples.size());
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && !strcmp(argv[1], "bench")) {
+    test_latency(20000, true);
+    return 0;
+  }
+
+  test_queue_single_thread();
+  test_queue_threads();
+  test_snapshot_threads();
+  test_latency(3000, false);
+
+  return test_summary();
+}
@@ -40,8 +40,14 @@
 #include <ArduinoOTA.h>
 #include <DHT.h>
 #include <Wire.h>
+#include <RTClib.h>
 #include <LiquidCrystal_I2C.h>
 #include "RDTRC_LCD_Library.h"
+#include "RDTRC_Notify_Library.h"
+#include "RDTRC_Alert_Library.h"
+#include "RDTRC_TimeSync_Library.h"
+#include "RDTRC_Scheduler_Library.h"
+#include "RDTRC_Tasks_Library.h"
 
 // System Configuration
 #define FIRMWARE_VERSION "4.0"
@@ -106,6 +112,14 @@ const char* lineToken = "YOUR_LINE_NOTIFY_TOKEN";
 #define WET_SOIL_THRESHOLD 70           // Above 70% moisture = wet
 #define WATER_TANK_HEIGHT 50            // cm
 #define LOW_WATER_THRESHOLD 10          // cm
+#define ZONE_WATERING_GAP 5000          // pause between zones of one watering run
+
+// Alert rate limiting
+// A condition must show in two consecutive sensor readings before it alerts.
+// Holding it for half an interval lets a reading that runs late still count.
+#define SENSOR_READ_INTERVAL 45000      // 45 seconds
+#define ALERT_HOLD_TIME (SENSOR_READ_INTERVAL / 2)
+#define ALERT_COOLDOWN 1800000          // at most one alert per rule every 30 minutes
 
 // Environmental thresholds
 #define DAYLIGHT_THRESHOLD 500          // ADC value
@@ -131,8 +145,31 @@ const char* lineToken = "YOUR_LINE_NOTIFY_TOKEN";
 WebServer server(80);
 WiFiUDP ntpUDP;
 NTPClient timeClient(ntpUDP, "pool.ntp.org", 25200, 60000); // UTC+7 Thailand
+RTC_DS3231 rtc;                 // Optional, keeps time offline and between NTP syncs
+RDTRC_TimeSync timeSync;
+RDTRC_Scheduler scheduler;         // network task: schedule, logging, maintenance
+RDTRC_Scheduler controlScheduler;  // control task: sensors and valves
+RDTRC_TaskSplit tasks;
 DHT dht(DHT_PIN, DHT_TYPE);
 RDTRC_LCD systemLCD;
+Adafruit_I2CBus i2cBus;         // Wire, shared by the LCD and the RTC
+RDTRC_LineNotifier lineNotifier;
+RDTRC_AlertEngine alertEngine;
+
+// Signals fed to the alert engine from readSensors(), one moisture
+// signal per zone starting at SIGNAL_ZONE_MOISTURE
+enum AlertSignal {
+  SIGNAL_WATER_LEVEL,
+  SIGNAL_TEMPERATURE,
+  SIGNAL_HUMIDITY,
+  SIGNAL_ZONE_MOISTURE
+};
+
+// Alert rule handles, assigned in setupAlerts()
+int lowWaterRule = -1;
+int highTempRule = -1;
+int lowHumidityRule = -1;
+int drySoilRule[NUM_ZONES];
 
 // Sensor status tracking
 struct SensorStatus {
@@ -158,8 +195,6 @@ SensorStatus lcdSensor;
 bool isWiFiConnected = false;
 bool isHotspotMode = false;
 unsigned long lastHeartbeat = 0;
-unsigned long lastDataLog = 0;
-unsigned long lastStatusCheck = 0;
 unsigned long lastLCDUpdate = 0;
 unsigned long bootTime = 0;
 int currentLCDZone = 0; // 0-3 for zones, 4 for system info
@@ -223,6 +258,76 @@ struct DailyStats {
 
 DailyStats todayStats;
 
+// The control task owns the sensors, pump, valves and alert engine, and
+// the variables above that hold their readings and watering counters.
+// The network task reaches them only through the queues and snapshot below.
+enum ControlCommandType : uint8_t {
+  CMD_WATER_ZONE,       // zone, duration
+  CMD_WATER_DRY_ZONES,  // scheduled watering, duration per zone
+  CMD_RESET_DAILY
+};
+
+struct ControlCommand {
+  ControlCommandType type;
+  int8_t zone;
+  unsigned long duration;
+};
+
+enum ControlEventType : uint8_t {
+  EVENT_READINGS,           // fresh sensor readings in controlState
+  EVENT_ALERT,              // rule, raised, value
+  EVENT_WATERING_STARTED,   // zone, duration
+  EVENT_WATERING_DONE,      // zone, duration
+  EVENT_WATERING_REFUSED,   // zone, value = water level
+  EVENT_EMERGENCY_WATERING  // zone, value = moisture
+};
+
+struct ControlEvent {
+  ControlEventType type;
+  int8_t zone;
+  int16_t rule;
+  bool raised;
+  float value;
+  unsigned long duration;
+};
+
+struct ZoneState {
+  int moistureLevel;
+  int targetMoisture;
+  bool isWatering;
+  bool enabled;
+  bool sensorOnline;
+  unsigned long totalWateringTime;
+};
+
+// Everything the web server, Blynk, the LCD and the log show
+struct ControlState {
+  float ambientTemperature;
+  float ambientHumidity;
+  int lightLevel;
+  bool isDaylight;
+  float waterLevel;
+  float flowRate;
+  int dailyWateringCycles;
+  bool dhtOnline;
+  bool lightOnline;
+  bool waterLevelOnline;
+  ZoneState zones[NUM_ZONES];
+  unsigned long maxLateness;  // worst control job delay, ms
+};
+
+RDTRC_Queue<ControlCommand, 8> commands;   // network -> control
+RDTRC_Queue<ControlEvent, 16> telemetry;   // control -> network
+RDTRC_Snapshot<ControlState> controlState;
+
+// Watering run, control task only: time still to water per zone (0 when
+// not queued), the zone whose valve is open and whether the pause after
+// the last zone is still running
+unsigned long pendingWatering[NUM_ZONES];
+int activeZone = -1;
+unsigned long activeDuration = 0;
+bool zoneGapPending = false;
+
 // Enhanced LCD Display Class for Multi-Zone
 class MultiZoneLCD {
   private:
@@ -248,14 +353,15 @@ class MultiZoneLCD {
         lastZoneSwitch = millis();
       }
       
+      ControlState state = controlState.read();
       if (currentZone < 4) {
         // Show zone data
         baseLCD->updateStatus(
           zones[currentZone].name,
-          ambientTemperature,
-          ambientHumidity,
-          zones[currentZone].moistureLevel,
-          zones[currentZone].isWatering ? "Watering" : "Idle",
+          state.ambientTemperature,
+          state.ambientHumidity,
+          state.zones[currentZone].moistureLevel,
+          state.zones[currentZone].isWatering ? "Watering" : "Idle",
           isWiFiConnected,
           false,
           todayStats.alerts
@@ -264,10 +370,10 @@ class MultiZoneLCD {
         // Show system info
         baseLCD->updateStatus(
           SYSTEM_NAME,
-          ambientTemperature,
-          ambientHumidity,
-          (int)waterLevel,
-          "Cycles: " + String(dailyWateringCycles),
+          state.ambientTemperature,
+          state.ambientHumidity,
+          (int)state.waterLevel,
+          "Cycles: " + String(state.dailyWateringCycles),
           isWiFiConnected,
           false,
           todayStats.alerts
@@ -294,10 +400,23 @@ void setupWiFi();
 void setupWebServer();
 void setupBlynk();
 void setupOTA();
+void setupAlerts();
 void displayBootScreen();
 void handleSystemLoop();
 void readSensors();
+void controlStart();
+void controlLoop();
+void networkStart();
+void networkLoop();
+void handleCommands();
+void handleTelemetry();
+bool sendCommand(ControlCommandType type, int zone = -1, unsigned long duration = 0);
+void sendEvent(ControlEventType type, int zone = -1, float value = 0, unsigned long duration = 0);
+void publishState();
+void sensorJob();
+void maintenanceJob();
 void checkWateringSchedule();
+void checkEmergencyWatering();
 void initializeSensors();
 void checkSensorStatus();
 void updateSensorStatus(int sensorIndex, bool isOnline, float value);
@@ -305,7 +424,10 @@ void handleSensorError(int sensorIndex, String sensorName);
 void gracefulDegradation();
 bool canOperateWithOfflineSensors();
 String getSensorStatusString();
-void waterZone(int zoneIndex, unsigned long duration);
+void queueWatering(int zoneIndex, unsigned long duration);
+void startNextZone();
+void endZoneGap();
+void finishWatering();
 void handleWebInterface();
 void sendLineNotification(String message);
 void handleManualControls();
@@ -314,7 +436,7 @@ void updateLCDDisplay();
 void saveSettings();
 void loadSettings();
 void performSystemMaintenance();
-void checkAlerts();
+void handleAlert(const ControlEvent& event);
 
 void setup() {
   Serial.begin(115200);
@@ -324,6 +446,20 @@ void setup() {
   displayBootScreen();
   setupSystem();
   
+  // Sensors and valves run on the control task, so a slow web request,
+  // Blynk reconnect or LCD message never holds up a pump shut-off
+  controlScheduler.every(SENSOR_READ_INTERVAL, sensorJob, SENSOR_READ_INTERVAL);
+  scheduler.every(60000, checkWateringSchedule, 60000);
+  scheduler.every(900000, logData, 900000);
+  scheduler.every(300000, maintenanceJob, 300000);
+  
+  if (!tasks.begin(controlStart, controlLoop, networkStart, networkLoop)) {
+    // loop() runs both sides instead
+    Serial.println("Failed to start control and network tasks, running them from loop()");
+    controlStart();
+    networkStart();
+  }
+  
   Serial.println("RDTRC Tomato Watering System with LCD Ready!");
   Serial.println("Web Interface: http://tomato-water.local");
   Serial.println("Blynk App: Connected");
@@ -336,6 +472,36 @@ void setup() {
 }
 
 void loop() {
+  if (tasks.isRunning()) {
+    // Everything runs in the control and network tasks
+    vTaskDelete(NULL);
+  }
+  
+  // The tasks could not be started: both sides take turns here
+  controlLoop();
+  networkLoop();
+}
+
+void controlStart() {
+  controlScheduler.begin();
+}
+
+void controlLoop() {
+  handleCommands();
+  controlScheduler.run();
+  
+  // Sleep until the next job; sendCommand() wakes the task early. When
+  // loop() runs both sides, networkLoop() does the sleeping.
+  if (tasks.isRunning()) {
+    controlScheduler.idle(1000);
+  }
+}
+
+void networkStart() {
+  scheduler.begin();
+}
+
+void networkLoop() {
   handleSystemLoop();
   
   // Handle web server
@@ -349,6 +515,9 @@ void loop() {
   // Handle OTA updates
   ArduinoOTA.handle();
   
+  // Readings, alerts and watering progress from the control task
+  handleTelemetry();
+  
   // Handle manual controls
   handleManualControls();
   
@@ -358,34 +527,182 @@ void loop() {
   // Update LCD display
   updateLCDDisplay();
   
-  // Read sensors every 45 seconds
-  static unsigned long lastSensorRead = 0;
-  if (millis() - lastSensorRead > 45000) {
-    readSensors();
-    lastSensorRead = millis();
+  // Run the jobs that are due, then sleep until the next one; web,
+  // Blynk and OTA are polled again after at most RDTRC_SCHED_IO_POLL ms
+  scheduler.run();
+  scheduler.idle(RDTRC_SCHED_IO_POLL);
+}
+
+// Network task side: queue a command for the control task
+bool sendCommand(ControlCommandType type, int zone, unsigned long duration) {
+  ControlCommand command;
+  command.type = type;
+  command.zone = zone;
+  command.duration = duration;
+  if (!commands.push(command)) {
+    Serial.println("Control command dropped, queue full");
+    return false;
+  }
+  controlScheduler.wake();
+  return true;
+}
+
+// Control task side: report to the network task
+void sendEvent(ControlEventType type, int zone, float value, unsigned long duration) {
+  ControlEvent event;
+  event.type = type;
+  event.zone = zone;
+  event.rule = -1;
+  event.raised = false;
+  event.value = value;
+  event.duration = duration;
+  if (telemetry.push(event)) {
+    scheduler.wake();
   }
-  
-  // Check watering schedule every minute
-  static unsigned long lastScheduleCheck = 0;
-  if (millis() - lastScheduleCheck > 60000) {
-    checkWateringSchedule();
-    lastScheduleCheck = millis();
+}
+
+void handleCommands() {
+  ControlCommand command;
+  while (commands.pop(command)) {
+    switch (command.type) {
+      case CMD_WATER_ZONE:
+        queueWatering(command.zone, command.duration);
+        break;
+      case CMD_WATER_DRY_ZONES:
+        // Water all zones that need it, one after another
+        for (int i = 0; i < NUM_ZONES; i++) {
+          if (zones[i].enabled && zones[i].moistureLevel < DRY_SOIL_THRESHOLD) {
+            queueWatering(i, command.duration);
+          }
+        }
+        break;
+      case CMD_RESET_DAILY:
+        dailyWateringCycles = 0;
+        todayStats.wateringCycles = 0;
+        todayStats.totalWateringTime = 0;
+        publishState();
+        break;
+    }
   }
-  
-  // Log data every 15 minutes
-  if (millis() - lastDataLog > 900000) {
-    logData();
-    lastDataLog = millis();
+}
+
+// Copy the control task's variables for the other task to read
+void publishState() {
+  ControlState state;
+  state.ambientTemperature = ambientTemperature;
+  state.ambientHumidity = ambientHumidity;
+  state.lightLevel = lightLevel;
+  state.isDaylight = isDaylight;
+  state.waterLevel = waterLevel;
+  state.flowRate = flowRate;
+  state.dailyWateringCycles = dailyWateringCycles;
+  state.dhtOnline = dhtSensor.isOnline;
+  state.lightOnline = lightSensor.isOnline;
+  state.waterLevelOnline = waterLevelSensor.isOnline;
+  for (int i = 0; i < NUM_ZONES; i++) {
+    state.zones[i].moistureLevel = zones[i].moistureLevel;
+    state.zones[i].targetMoisture = zones[i].targetMoisture;
+    state.zones[i].isWatering = zones[i].isWatering;
+    state.zones[i].enabled = zones[i].enabled;
+    state.zones[i].sensorOnline = soilSensors[i].isOnline;
+    state.zones[i].totalWateringTime = zones[i].totalWateringTime;
+  }
+  state.maxLateness = controlScheduler.maxLateness();
+  controlState.publish(state);
+}
+
+void sensorJob() {
+  readSensors();
+  checkEmergencyWatering();
+  
+  // Forward alert events raised by this reading
+  RDTRC_AlertEvent alert;
+  while (alertEngine.poll(alert)) {
+    ControlEvent event;
+    event.type = EVENT_ALERT;
+    event.zone = -1;
+    event.rule = alert.rule;
+    event.raised = alert.raised;
+    event.value = alert.value;
+    event.duration = 0;
+    if (telemetry.push(event)) {
+      scheduler.wake();
+    }
   }
   
-  // System status check every 5 minutes
-  if (millis() - lastStatusCheck > 300000) {
-    performSystemMaintenance();
-    checkAlerts();
-    lastStatusCheck = millis();
+  publishState();
+  sendEvent(EVENT_READINGS);
+}
+
+void maintenanceJob() {
+  performSystemMaintenance();
+}
+
+void handleTelemetry() {
+  ControlEvent event;
+  while (telemetry.pop(event)) {
+    switch (event.type) {
+      case EVENT_READINGS: {
+        // Update Blynk with sensor data (only if sensors are online)
+        if (!isWiFiConnected) break;
+        ControlState state = controlState.read();
+        if (state.dhtOnline) {
+          Blynk.virtualWrite(V1, state.ambientTemperature);
+          Blynk.virtualWrite(V2, state.ambientHumidity);
+        }
+        if (state.waterLevelOnline) {
+          Blynk.virtualWrite(V3, state.waterLevel);
+        }
+        if (state.lightOnline) {
+          Blynk.virtualWrite(V4, state.lightLevel);
+        }
+        for (int i = 0; i < NUM_ZONES; i++) {
+          if (state.zones[i].sensorOnline) {
+            Blynk.virtualWrite(V10 + i, state.zones[i].moistureLevel);
+          }
+        }
+        break;
+      }
+      
+      case EVENT_ALERT:
+        handleAlert(event);
+        break;
+      
+      case EVENT_WATERING_STARTED:
+        Serial.println("Starting watering " + zones[event.zone].name + " for " + String(event.duration/1000) + " seconds");
+        systemLCD.showDebug("Watering", zones[event.zone].name);
+        break;
+      
+      case EVENT_WATERING_DONE: {
+        ControlState state = controlState.read();
+        
+        // Send notification
+        String waterMsg = "Tomato Zone Watered!\n";
+        waterMsg += "Zone: " + zones[event.zone].name + "\n";
+        waterMsg += "Duration: " + String(event.duration/1000) + " seconds\n";
+        waterMsg += "Soil Moisture: " + String(state.zones[event.zone].moistureLevel) + "%\n";
+        waterMsg += "Daily Cycles: " + String(state.dailyWateringCycles);
+        sendLineNotification(waterMsg);
+        
+        Serial.println("Watering completed for " + zones[event.zone].name);
+        systemLCD.showMessage("Watered", zones[event.zone].name, 3000);
+        
+        // Save watering data
+        saveSettings();
+        break;
+      }
+      
+      case EVENT_WATERING_REFUSED:
+        Serial.println("Watering skipped for " + zones[event.zone].name + " - water level " + String(event.value) + "cm");
+        systemLCD.showAlert("LOW WATER", 3000);
+        break;
+      
+      case EVENT_EMERGENCY_WATERING:
+        Serial.println("Emergency watering for " + zones[event.zone].name + " - very dry soil");
+        systemLCD.showMessage("Emergency", zones[event.zone].name);
+        break;
+    }
   }
-  
-  delay(100);
 }
 
 void displayBootScreen() {
@@ -468,9 +785,19 @@ void setupSystem() {
   setupBlynk();
   setupOTA();
   
+  // Start background LINE notification sender
+  lineNotifier.begin(lineToken);
+  
+  // Declare alert rules before the first sensor reading
+  setupAlerts();
+  
   // Initialize NTP
   timeClient.begin();
-  timeClient.update();
+  timeClient.addServer("time.google.com");
+  timeClient.addServer("time.cloudflare.com");
+  bool rtcFound = rtc.begin();
+  if (rtcFound) rtc.setBus(&i2cBus);
+  timeSync.begin(timeClient, rtcFound ? &rtc : NULL);
   
   // Initialize today's stats
   todayStats.date = "01/01/2024";
@@ -492,6 +819,7 @@ void setupSystem() {
   
   // Initial sensor reading
   readSensors();
+  publishState();
   
   // Send startup notification
   String startupMsg = "RDTRC Tomato Watering System Started!\n";
@@ -517,7 +845,11 @@ void setupLCD() {
   // Initialize I2C
   Wire.begin(I2C_SDA, I2C_SCL);
   
-  // Scan for I2C devices first
+  // Transfers from both tasks queue on one worker, clock first
+  i2cBus.begin();
+  systemLCD.setBus(i2cBus);
+  
+  // Scan for I2C devices first; the LCD's address comes from this scan
   systemLCD.scanI2C();
   
   // Initialize LCD with auto detection
@@ -582,6 +914,7 @@ void setupWebServer() {
   server.on("/", handleWebInterface);
   
   server.on("/api/status", HTTP_GET, []() {
+    ControlState state = controlState.read();
     JsonDocument doc;
     doc["system_name"] = SYSTEM_NAME;
     doc["version"] = FIRMWARE_VERSION;
@@ -589,13 +922,14 @@ void setupWebServer() {
     doc["uptime"] = millis() - bootTime;
     doc["wifi_connected"] = isWiFiConnected;
     doc["wifi_signal"] = WiFi.RSSI();
-    doc["ambient_temperature"] = ambientTemperature;
-    doc["ambient_humidity"] = ambientHumidity;
-    doc["light_level"] = lightLevel;
-    doc["is_daylight"] = isDaylight;
-    doc["water_level"] = waterLevel;
-    doc["flow_rate"] = flowRate;
-    doc["daily_watering_cycles"] = dailyWateringCycles;
+    doc["ambient_temperature"] = state.ambientTemperature;
+    doc["ambient_humidity"] = state.ambientHumidity;
+    doc["light_level"] = state.lightLevel;
+    doc["is_daylight"] = state.isDaylight;
+    doc["water_level"] = state.waterLevel;
+    doc["flow_rate"] = state.flowRate;
+    doc["daily_watering_cycles"] = state.dailyWateringCycles;
+    doc["control_max_lateness"] = state.maxLateness;
     doc["timestamp"] = timeClient.getEpochTime();
     doc["lcd_connected"] = systemLCD.isLCDConnected();
     doc["lcd_address"] = "0x" + String(systemLCD.getLCDAddress(), HEX);
@@ -606,10 +940,10 @@ void setupWebServer() {
     for (int i = 0; i < NUM_ZONES; i++) {
       JsonObject zoneObj = zonesArray.createNestedObject();
       zoneObj["name"] = zones[i].name;
-      zoneObj["moisture"] = zones[i].moistureLevel;
-      zoneObj["target_moisture"] = zones[i].targetMoisture;
-      zoneObj["is_watering"] = zones[i].isWatering;
-      zoneObj["enabled"] = zones[i].enabled;
+      zoneObj["moisture"] = state.zones[i].moistureLevel;
+      zoneObj["target_moisture"] = state.zones[i].targetMoisture;
+      zoneObj["is_watering"] = state.zones[i].isWatering;
+      zoneObj["enabled"] = state.zones[i].enabled;
     }
     
     String response;
@@ -625,9 +959,12 @@ void setupWebServer() {
     unsigned long duration = durationStr.toInt() * 1000; // Convert to milliseconds
     
     if (zone >= 0 && zone < NUM_ZONES && duration >= MIN_WATERING_DURATION && duration <= MAX_WATERING_DURATION) {
-      waterZone(zone, duration);
-      systemLCD.showDebug("Manual Water", "Zone " + String(zone + 1));
+      if (!sendCommand(CMD_WATER_ZONE, zone, duration)) {
+        server.send(503, "application/json", "{\"error\":\"busy\"}");
+        return;
+      }
       server.send(200, "application/json", "{\"status\":\"watering_started\",\"zone\":" + String(zone) + ",\"duration\":" + String(duration) + "}");
+      systemLCD.showDebug("Manual Water", "Zone " + String(zone + 1));
     } else {
       server.send(400, "application/json", "{\"error\":\"invalid_parameters\"}");
     }
@@ -646,12 +983,13 @@ void setupBlynk() {
     systemLCD.showDebug("Blynk", "Connected");
     
     // Send initial data to Blynk
-    Blynk.virtualWrite(V1, ambientTemperature);
-    Blynk.virtualWrite(V2, ambientHumidity);
-    Blynk.virtualWrite(V3, waterLevel);
-    Blynk.virtualWrite(V4, lightLevel);
+    ControlState state = controlState.read();
+    Blynk.virtualWrite(V1, state.ambientTemperature);
+    Blynk.virtualWrite(V2, state.ambientHumidity);
+    Blynk.virtualWrite(V3, state.waterLevel);
+    Blynk.virtualWrite(V4, state.lightLevel);
     for (int i = 0; i < NUM_ZONES; i++) {
-      Blynk.virtualWrite(V10 + i, zones[i].moistureLevel);
+      Blynk.virtualWrite(V10 + i, state.zones[i].moistureLevel);
     }
   }
 }
@@ -708,9 +1046,7 @@ void handleSystemLoop() {
   }
   
   // Update time
-  if (isWiFiConnected) {
-    timeClient.update();
-  }
+  timeSync.update(isWiFiConnected);
 }
 
 void handleLCDControls() {
@@ -763,6 +1099,8 @@ void readSensors() {
       ambientHumidity = 0;
     } else {
       updateSensorStatus(-1, true, ambientTemperature);
+      alertEngine.update(SIGNAL_TEMPERATURE, ambientTemperature, millis());
+      alertEngine.update(SIGNAL_HUMIDITY, ambientHumidity, millis());
     }
   }
   
@@ -803,6 +1141,7 @@ void readSensors() {
       if (waterLevel < 0) waterLevel = 0;
       if (waterLevel > WATER_TANK_HEIGHT) waterLevel = WATER_TANK_HEIGHT;
       updateSensorStatus(-5, true, waterLevel);
+      alertEngine.update(SIGNAL_WATER_LEVEL, waterLevel, millis());
     } else {
       handleSensorError(-5, waterLevelSensor.sensorName);
     }
@@ -837,6 +1176,9 @@ void readSensors() {
       if (zones[i].moistureLevel < 0) zones[i].moistureLevel = 0;
       if (zones[i].moistureLevel > 100) zones[i].moistureLevel = 100;
       updateSensorStatus(i, true, zones[i].moistureLevel);
+      if (zones[i].enabled) {
+        alertEngine.update(SIGNAL_ZONE_MOISTURE + i, zones[i].moistureLevel, millis());
+      }
     }
   }
   
@@ -852,29 +1194,9 @@ void readSensors() {
   // Check sensor status and apply graceful degradation
   checkSensorStatus();
   gracefulDegradation();
-  
-  // Update Blynk with sensor data (only if sensors are online)
-  if (isWiFiConnected) {
-    if (dhtSensor.isOnline) {
-      Blynk.virtualWrite(V1, ambientTemperature);
-      Blynk.virtualWrite(V2, ambientHumidity);
-    }
-    if (waterLevelSensor.isOnline) {
-      Blynk.virtualWrite(V3, waterLevel);
-    }
-    if (lightSensor.isOnline) {
-      Blynk.virtualWrite(V4, lightLevel);
-    }
-    for (int i = 0; i < NUM_ZONES; i++) {
-      if (soilSensors[i].isOnline) {
-        Blynk.virtualWrite(V10 + i, zones[i].moistureLevel);
-      }
-    }
-  }
 }
 
 void checkWateringSchedule() {
-  timeClient.update();
   int currentHour = timeClient.getHours();
   int currentMinute = timeClient.getMinutes();
   
@@ -884,126 +1206,158 @@ void checkWateringSchedule() {
         wateringTimes[i].minute == currentMinute) {
       
       Serial.println("Scheduled watering time: " + wateringTimes[i].description);
-      systemLCD.showMessage("Watering Time", wateringTimes[i].description, 3000);
       
-      // Water all zones that need it
-      for (int j = 0; j < NUM_ZONES; j++) {
-        if (zones[j].enabled && zones[j].moistureLevel < DRY_SOIL_THRESHOLD) {
-          waterZone(j, DEFAULT_WATERING_DURATION);
-          delay(5000); // Wait between zones
-        }
-      }
+      // The control task waters the dry zones one after another
+      sendCommand(CMD_WATER_DRY_ZONES, -1, DEFAULT_WATERING_DURATION);
+      systemLCD.showMessage("Watering Time", wateringTimes[i].description, 3000);
       break;
     }
   }
-  
-  // Also check for emergency watering (very dry soil)
+}
+
+// Control task, after each sensor reading
+void checkEmergencyWatering() {
   for (int i = 0; i < NUM_ZONES; i++) {
-    if (zones[i].enabled && zones[i].moistureLevel < 20 && !zones[i].isWatering) {
-      Serial.println("Emergency watering for " + zones[i].name + " - very dry soil");
-      systemLCD.showMessage("Emergency", zones[i].name);
-      waterZone(i, DEFAULT_WATERING_DURATION);
+    if (zones[i].enabled && zones[i].moistureLevel < 20 &&
+        i != activeZone && pendingWatering[i] == 0) {
+      sendEvent(EVENT_EMERGENCY_WATERING, i, zones[i].moistureLevel);
+      queueWatering(i, DEFAULT_WATERING_DURATION);
     }
   }
 }
 
-void waterZone(int zoneIndex, unsigned long duration) {
+// Control task. Zones are watered one at a time; a zone already queued
+// or being watered is not queued twice.
+void queueWatering(int zoneIndex, unsigned long duration) {
   if (zoneIndex < 0 || zoneIndex >= NUM_ZONES) return;
+  if (zoneIndex == activeZone || pendingWatering[zoneIndex] > 0) return;
+  
+  pendingWatering[zoneIndex] = duration;
+  startNextZone();
+}
+
+void startNextZone() {
+  if (activeZone >= 0 || zoneGapPending) return;
+  
+  int zoneIndex = -1;
+  for (int i = 0; i < NUM_ZONES && zoneIndex < 0; i++) {
+    if (pendingWatering[i] > 0) zoneIndex = i;
+  }
+  if (zoneIndex < 0) return;
+  
+  unsigned long duration = pendingWatering[zoneIndex];
+  pendingWatering[zoneIndex] = 0;
+  
   if (waterLevel < LOW_WATER_THRESHOLD) {
-    systemLCD.showAlert("LOW WATER", 3000);
+    sendEvent(EVENT_WATERING_REFUSED, zoneIndex, waterLevel);
+    startNextZone();
     return;
   }
   
-  Serial.println("Starting watering " + zones[zoneIndex].name + " for " + String(duration/1000) + " seconds");
-  systemLCD.showDebug("Watering", zones[zoneIndex].name);
-  
   // Turn on pump
   digitalWrite(WATER_PUMP_PIN, HIGH);
-  systemLCD.showDebug("Pump", "ON");
   
   // Open valve for specific zone
   digitalWrite(zones[zoneIndex].valvePin, HIGH);
   zones[zoneIndex].isWatering = true;
   zones[zoneIndex].lastWatered = millis();
+  activeZone = zoneIndex;
+  activeDuration = duration;
   
-  systemLCD.showDebug("Valve Open", zones[zoneIndex].name);
+  // Shut off from the control task's own scheduler, on time whatever the
+  // network side is doing
+  controlScheduler.after(duration, finishWatering);
   
-  // Wait for watering duration
-  delay(duration);
+  publishState();
+  sendEvent(EVENT_WATERING_STARTED, zoneIndex, 0, duration);
+}
+
+void finishWatering() {
+  if (activeZone < 0) return;
+  int zoneIndex = activeZone;
   
   // Close valve
   digitalWrite(zones[zoneIndex].valvePin, LOW);
   zones[zoneIndex].isWatering = false;
-  zones[zoneIndex].totalWateringTime += duration;
+  zones[zoneIndex].totalWateringTime += activeDuration;
   
   // Turn off pump
   digitalWrite(WATER_PUMP_PIN, LOW);
-  systemLCD.showDebug("Watering", "Complete");
   
   // Update statistics
   dailyWateringCycles++;
   todayStats.wateringCycles++;
-  todayStats.totalWateringTime += duration;
-  
-  // Send notification
-  String waterMsg = "Tomato Zone Watered!\n";
-  waterMsg += "Zone: " + zones[zoneIndex].name + "\n";
-  waterMsg += "Duration: " + String(duration/1000) + " seconds\n";
-  waterMsg += "Soil Moisture: " + String(zones[zoneIndex].moistureLevel) + "%\n";
-  waterMsg += "Daily Cycles: " + String(dailyWateringCycles);
-  sendLineNotification(waterMsg);
+  todayStats.totalWateringTime += activeDuration;
   
-  systemLCD.showMessage("Watered", zones[zoneIndex].name, 3000);
+  activeZone = -1;
+  publishState();
+  sendEvent(EVENT_WATERING_DONE, zoneIndex, 0, activeDuration);
   
-  // Save watering data
-  saveSettings();
-  
-  Serial.println("Watering completed for " + zones[zoneIndex].name);
+  // Wait between zones; zones queued meanwhile wait for the gap too
+  zoneGapPending = true;
+  if (controlScheduler.after(ZONE_WATERING_GAP, endZoneGap) < 0) {
+    endZoneGap();
+  }
 }
 
-void checkAlerts() {
-  // Low water alert
-  if (waterLevel < LOW_WATER_THRESHOLD) {
-    String alertMsg = "Low Water Level Alert!\n";
-    alertMsg += "Current Level: " + String(waterLevel) + "cm\n";
-    alertMsg += "Please refill the water tank.";
-    sendLineNotification(alertMsg);
-    systemLCD.showAlert("LOW WATER");
-    todayStats.alerts++;
+void endZoneGap() {
+  zoneGapPending = false;
+  startNextZone();
+}
+
+void setupAlerts() {
+  // signal, comparator, threshold, hysteresis, hold time, cooldown, severity
+  lowWaterRule = alertEngine.addRule(SIGNAL_WATER_LEVEL, RDTRC_ALERT_BELOW, LOW_WATER_THRESHOLD,
+                                     2, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_CRITICAL);
+  highTempRule = alertEngine.addRule(SIGNAL_TEMPERATURE, RDTRC_ALERT_ABOVE, TEMP_MAX,
+                                     1.0, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_WARNING);
+  lowHumidityRule = alertEngine.addRule(SIGNAL_HUMIDITY, RDTRC_ALERT_BELOW, HUMIDITY_MIN,
+                                        3.0, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_WARNING);
+  for (int i = 0; i < NUM_ZONES; i++) {
+    drySoilRule[i] = alertEngine.addRule(SIGNAL_ZONE_MOISTURE + i, RDTRC_ALERT_BELOW, SOIL_MOISTURE_VERY_DRY,
+                                         5, ALERT_HOLD_TIME, ALERT_COOLDOWN, RDTRC_ALERT_CRITICAL);
+  }
+}
+
+void handleAlert(const ControlEvent& event) {
+  // Only transitions reach here, steady conditions produce no events
+  if (!event.raised) {
+    Serial.println("Alert cleared (rule " + String(event.rule) + "), value: " + String(event.value));
+    return;
   }
   
-  // High temperature alert
-  if (ambientTemperature > HIGH_TEMP_THRESHOLD) {
-    String alertMsg = "High Temperature Alert!\n";
-    alertMsg += "Current: " + String(ambientTemperature) + "C\n";
+  String alertMsg;
+  if (event.rule == lowWaterRule) {
+    alertMsg = "Low Water Level Alert!\n";
+    alertMsg += "Current Level: " + String(event.value) + "cm\n";
+    alertMsg += "Please refill the water tank.";
+    systemLCD.showAlert("LOW WATER");
+  } else if (event.rule == highTempRule) {
+    alertMsg = "High Temperature Alert!\n";
+    alertMsg += "Current: " + String(event.value) + "C\n";
     alertMsg += "Consider additional watering.";
-    sendLineNotification(alertMsg);
     systemLCD.showAlert("HIGH TEMP");
-    todayStats.alerts++;
-  }
-  
-  // Low humidity alert
-  if (ambientHumidity < LOW_HUMIDITY_THRESHOLD) {
-    String alertMsg = "Low Humidity Alert!\n";
-    alertMsg += "Current: " + String(ambientHumidity) + "%\n";
+  } else if (event.rule == lowHumidityRule) {
+    alertMsg = "Low Humidity Alert!\n";
+    alertMsg += "Current: " + String(event.value) + "%\n";
     alertMsg += "Plants may need more water.";
-    sendLineNotification(alertMsg);
     systemLCD.showAlert("LOW HUMIDITY");
-    todayStats.alerts++;
-  }
-  
-  // Dry soil alerts
-  for (int i = 0; i < NUM_ZONES; i++) {
-    if (zones[i].enabled && zones[i].moistureLevel < 15) {
-      String alertMsg = "Critical Dry Soil Alert!\n";
-      alertMsg += "Zone: " + zones[i].name + "\n";
-      alertMsg += "Moisture: " + String(zones[i].moistureLevel) + "%\n";
-      alertMsg += "Immediate watering recommended.";
-      sendLineNotification(alertMsg);
-      systemLCD.showAlert("DRY SOIL Z" + String(i+1));
-      todayStats.alerts++;
+  } else {
+    int zone = -1;
+    for (int i = 0; i < NUM_ZONES; i++) {
+      if (event.rule == drySoilRule[i]) zone = i;
     }
+    if (zone < 0) return;
+    
+    alertMsg = "Critical Dry Soil Alert!\n";
+    alertMsg += "Zone: " + zones[zone].name + "\n";
+    alertMsg += "Moisture: " + String((int)event.value) + "%\n";
+    alertMsg += "Immediate watering recommended.";
+    systemLCD.showAlert("DRY SOIL Z" + String(zone + 1));
   }
+  
+  sendLineNotification(alertMsg);
+  todayStats.alerts++;
 }
 
 void handleManualControls() {
@@ -1031,16 +1385,17 @@ void handleManualControls() {
 }
 
 void logData() {
+  ControlState state = controlState.read();
   JsonDocument doc;
   doc["timestamp"] = timeClient.getEpochTime();
   doc["uptime"] = millis() - bootTime;
-  doc["ambient_temperature"] = ambientTemperature;
-  doc["ambient_humidity"] = ambientHumidity;
-  doc["light_level"] = lightLevel;
-  doc["is_daylight"] = isDaylight;
-  doc["water_level"] = waterLevel;
-  doc["flow_rate"] = flowRate;
-  doc["daily_watering_cycles"] = dailyWateringCycles;
+  doc["ambient_temperature"] = state.ambientTemperature;
+  doc["ambient_humidity"] = state.ambientHumidity;
+  doc["light_level"] = state.lightLevel;
+  doc["is_daylight"] = state.isDaylight;
+  doc["water_level"] = state.waterLevel;
+  doc["flow_rate"] = state.flowRate;
+  doc["daily_watering_cycles"] = state.dailyWateringCycles;
   doc["wifi_signal"] = WiFi.RSSI();
   doc["free_memory"] = ESP.getFreeHeap();
   doc["lcd_connected"] = systemLCD.isLCDConnected();
@@ -1050,9 +1405,9 @@ void logData() {
   for (int i = 0; i < NUM_ZONES; i++) {
     JsonObject zoneObj = zonesArray.createNestedObject();
     zoneObj["name"] = zones[i].name;
-    zoneObj["moisture"] = zones[i].moistureLevel;
-    zoneObj["is_watering"] = zones[i].isWatering;
-    zoneObj["total_watering_time"] = zones[i].totalWateringTime;
+    zoneObj["moisture"] = state.zones[i].moistureLevel;
+    zoneObj["is_watering"] = state.zones[i].isWatering;
+    zoneObj["total_watering_time"] = state.zones[i].totalWateringTime;
   }
   
   String logData;
@@ -1066,17 +1421,18 @@ void logData() {
 }
 
 void saveSettings() {
+  ControlState state = controlState.read();
   JsonDocument doc;
-  doc["daily_watering_cycles"] = dailyWateringCycles;
+  doc["daily_watering_cycles"] = state.dailyWateringCycles;
   doc["today_date"] = todayStats.date;
   
   // Save zone settings
   JsonArray zonesArray = doc.createNestedArray("zones");
   for (int i = 0; i < NUM_ZONES; i++) {
     JsonObject zoneObj = zonesArray.createNestedObject();
-    zoneObj["target_moisture"] = zones[i].targetMoisture;
-    zoneObj["enabled"] = zones[i].enabled;
-    zoneObj["total_watering_time"] = zones[i].totalWateringTime;
+    zoneObj["target_moisture"] = state.zones[i].targetMoisture;
+    zoneObj["enabled"] = state.zones[i].enabled;
+    zoneObj["total_watering_time"] = state.zones[i].totalWateringTime;
   }
   
   File configFile = SPIFFS.open("/config.json", "w");
@@ -1125,10 +1481,8 @@ void performSystemMaintenance() {
     Serial.println("New day started - stats reset");
     systemLCD.showDebug("New Day", "Stats Reset");
     
-    // Reset daily stats
-    dailyWateringCycles = 0;
-    todayStats.wateringCycles = 0;
-    todayStats.totalWateringTime = 0;
+    // Reset daily stats; the watering counters belong to the control task
+    sendCommand(CMD_RESET_DAILY);
     todayStats.avgTemperature = 0;
     todayStats.avgHumidity = 0;
     todayStats.alerts = 0;
@@ -1136,23 +1490,12 @@ void performSystemMaintenance() {
 }
 
 void sendLineNotification(String message) {
-  if (!isWiFiConnected || strlen(lineToken) < 10) return;
+  if (strlen(lineToken) < 10) return;
   
-  HTTPClient http;
-  http.begin("https://notify-api.line.me/api/notify");
-  http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-  http.addHeader("Authorization", "Bearer " + String(lineToken));
-  
-  String payload = "message=" + message;
-  int httpResponseCode = http.POST(payload);
-  
-  if (httpResponseCode == 200) {
-    Serial.println("LINE notification sent");
-  } else {
-    Serial.println("LINE notification failed: " + String(httpResponseCode));
+  // Queued for the background sender, so alerts never stall loop()
+  if (!lineNotifier.send(message)) {
+    Serial.println("LINE notification not queued (duplicate or queue full)");
   }
-  
-  http.end();
 }
 
 void handleWebInterface() {
@@ -1239,41 +1582,41 @@ void handleWebInterface() {
 // Blynk Virtual Pin Handlers
 BLYNK_WRITE(V20) { // Manual watering Zone 1
   if (param.asInt() == 1) {
-    waterZone(0, DEFAULT_WATERING_DURATION);
+    sendCommand(CMD_WATER_ZONE, 0, DEFAULT_WATERING_DURATION);
     systemLCD.showDebug("Blynk Water", "Zone 1");
   }
 }
 
 BLYNK_WRITE(V21) { // Manual watering Zone 2
   if (param.asInt() == 1) {
-    waterZone(1, DEFAULT_WATERING_DURATION);
+    sendCommand(CMD_WATER_ZONE, 1, DEFAULT_WATERING_DURATION);
     systemLCD.showDebug("Blynk Water", "Zone 2");
   }
 }
 
 BLYNK_WRITE(V22) { // Manual watering Zone 3
   if (param.asInt() == 1) {
-    waterZone(2, DEFAULT_WATERING_DURATION);
+    sendCommand(CMD_WATER_ZONE, 2, DEFAULT_WATERING_DURATION);
     systemLCD.showDebug("Blynk Water", "Zone 3");
   }
 }
 
 BLYNK_WRITE(V23) { // Manual watering Zone 4
   if (param.asInt() == 1) {
-    waterZone(3, DEFAULT_WATERING_DURATION);
+    sendCommand(CMD_WATER_ZONE, 3, DEFAULT_WATERING_DURATION);
     systemLCD.showDebug("Blynk Water", "Zone 4");
   }
 }
 
 // Read-only pins for Blynk dashboard
-BLYNK_READ(V1) { Blynk.virtualWrite(V1, ambientTemperature); }
-BLYNK_READ(V2) { Blynk.virtualWrite(V2, ambientHumidity); }
-BLYNK_READ(V3) { Blynk.virtualWrite(V3, waterLevel); }
-BLYNK_READ(V4) { Blynk.virtualWrite(V4, lightLevel); }
-BLYNK_READ(V10) { Blynk.virtualWrite(V10, zones[0].moistureLevel); }
-BLYNK_READ(V11) { Blynk.virtualWrite(V11, zones[1].moistureLevel); }
-BLYNK_READ(V12) { Blynk.virtualWrite(V12, zones[2].moistureLevel); }
-BLYNK_READ(V13) { Blynk.virtualWrite(V13, zones[3].moistureLevel); }
+BLYNK_READ(V1) { Blynk.virtualWrite(V1, controlState.read().ambientTemperature); }
+BLYNK_READ(V2) { Blynk.virtualWrite(V2, controlState.read().ambientHumidity); }
+BLYNK_READ(V3) { Blynk.virtualWrite(V3, controlState.read().waterLevel); }
+BLYNK_READ(V4) { Blynk.virtualWrite(V4, controlState.read().lightLevel); }
+BLYNK_READ(V10) { Blynk.virtualWrite(V10, controlState.read().zones[0].moistureLevel); }
+BLYNK_READ(V11) { Blynk.virtualWrite(V11, controlState.read().zones[1].moistureLevel); }
+BLYNK_READ(V12) { Blynk.virtualWrite(V12, controlState.read().zones[2].moistureLevel); }
+BLYNK_READ(V13) { Blynk.virtualWrite(V13, controlState.read().zones[3].moistureLevel); }
 
 // Sensor Offline Detection Functions
 void initializeSensors() {